@@ -0,0 +1,934 @@
+//==========================================================================
+//
+// File: GMFBatch.cpp
+//
+// Desc: Game Media Formats - Headless parallel batch converter
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#include <stdio.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <process.h>
+#include <direct.h>
+#define strcasecmp _stricmp
+#define stat _stat64
+#ifndef S_ISDIR
+#define S_ISDIR(m) (((m) & S_IFMT) == S_IFDIR)
+#define S_ISREG(m) (((m) & S_IFMT) == S_IFREG)
+#endif
+#else
+#include <pthread.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <time.h>
+#endif
+
+#include "MediaReaders.h"
+#include "MediaWriters.h"
+#include "ArchiveDirectory.h"
+
+#ifdef _WIN32
+#define PATH_SEPARATOR '\\'
+#else
+#define PATH_SEPARATOR '/'
+#endif
+
+// Maximum length of a list file line
+#define MAX_LIST_LINE	4096
+
+//==========================================================================
+// Timer
+//==========================================================================
+
+static double GetTime(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER liCounter, liFrequency;
+	QueryPerformanceCounter(&liCounter);
+	QueryPerformanceFrequency(&liFrequency);
+	return (double)liCounter.QuadPart / (double)liFrequency.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+//==========================================================================
+// Lock and thread wrappers
+//==========================================================================
+
+#ifdef _WIN32
+
+typedef CRITICAL_SECTION BATCH_LOCK;
+typedef HANDLE BATCH_THREAD;
+
+#define InitLock(p)		InitializeCriticalSection(p)
+#define DeleteLock(p)	DeleteCriticalSection(p)
+#define Lock(p)			EnterCriticalSection(p)
+#define Unlock(p)		LeaveCriticalSection(p)
+
+#else
+
+typedef pthread_mutex_t BATCH_LOCK;
+typedef pthread_t BATCH_THREAD;
+
+#define InitLock(p)		pthread_mutex_init((p), NULL)
+#define DeleteLock(p)	pthread_mutex_destroy(p)
+#define Lock(p)			pthread_mutex_lock(p)
+#define Unlock(p)		pthread_mutex_unlock(p)
+
+#endif
+
+static DWORD GetProcessorCount(void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	return (si.dwNumberOfProcessors > 0) ? si.dwNumberOfProcessors : 1;
+#else
+	long lCount = sysconf(_SC_NPROCESSORS_ONLN);
+	return (lCount > 0) ? (DWORD)lCount : 1;
+#endif
+}
+
+//==========================================================================
+// Output formats table
+//==========================================================================
+
+typedef CMediaWriter* (*PFN_CREATE_WRITER)(void);
+
+static CMediaWriter* CreateAVIWriter(void) { return new CAVIWriter(); }
+static CMediaWriter* CreateY4MWriter(void) { return new CY4MWriter(); }
+
+typedef struct tagBATCH_FORMAT {
+	const char			*pszName;		// Format name (as given in the command line)
+	const char			*pszExtension;	// Output file extension
+	PFN_CREATE_WRITER	pfnCreate;		// Writer creation function
+} BATCH_FORMAT;
+
+static const BATCH_FORMAT g_Formats[] = {
+	{ "avi",	"avi",	CreateAVIWriter	},
+	{ "y4m",	"y4m",	CreateY4MWriter	}
+};
+
+#define BATCH_FORMATS (sizeof(g_Formats) / sizeof(g_Formats[0]))
+
+// Input file extensions picked when scanning directories
+static const char *g_pszInputExtensions[] = { "vqa", "roq", "mve", "cin" };
+
+#define INPUT_EXTENSIONS (sizeof(g_pszInputExtensions) / sizeof(g_pszInputExtensions[0]))
+
+//==========================================================================
+// Job list
+//==========================================================================
+
+typedef struct tagBATCH_JOB {
+	char		*pszInput;		// Input file name
+	char		*pszOutput;		// Output file name
+	LONGLONG	llSize;			// Input file size
+	HRESULT		hr;				// Conversion result
+	const char	*pszStage;		// Conversion stage which has failed
+	DWORD		nFrames;		// Video frames converted
+	BOOL		bTruncated;		// Has the input file been cut off?
+	double		dSeconds;		// Conversion time
+} BATCH_JOB;
+
+typedef struct tagBATCH_CONTEXT {
+	BATCH_JOB			*pJobs;			// Jobs array
+	DWORD				nJobs;			// Number of jobs
+	DWORD				nMaxJobs;		// Allocated jobs
+	const BATCH_FORMAT	*pFormat;		// Output format
+	const char			*pszOutputDir;	// Output directory (NULL: next to the input)
+	BOOL				bQuiet;			// Report failures only
+	DWORD				nDecodeThreads;	// Threads per video decoder
+	BATCH_LOCK			lock;			// Guards the fields below
+	DWORD				iNextJob;		// Next job to pick up
+	DWORD				nDoneJobs;		// Jobs finished
+} BATCH_CONTEXT;
+
+static char* CopyString(const char *psz, size_t cch)
+{
+	char *pszCopy = (char*)malloc(cch + 1);
+	if (pszCopy) {
+		CopyMemory(pszCopy, psz, cch);
+		pszCopy[cch] = '\0';
+	}
+	return pszCopy;
+}
+
+static BOOL IsSeparator(char ch)
+{
+#ifdef _WIN32
+	return (ch == '\\') || (ch == '/');
+#else
+	return (ch == '/');
+#endif
+}
+
+// Build the output file name. The path is the input file path (or
+// the one the archive member would have if extracted), the relative
+// name is that path below the scanned directory (or just the name)
+static char* GetOutputFileName(const BATCH_CONTEXT *pContext, const char *pszPath, const char *pszRelative)
+{
+	const char *pszBase = (pContext->pszOutputDir) ? pszRelative : pszPath;
+	size_t cchDir = (pContext->pszOutputDir) ? strlen(pContext->pszOutputDir) : 0;
+
+	// Cut the extension off
+	size_t cchBase = strlen(pszBase);
+	for (size_t i = cchBase; i > 0; i--) {
+		if (IsSeparator(pszBase[i - 1]))
+			break;
+		if (pszBase[i - 1] == '.') {
+			cchBase = i - 1;
+			break;
+		}
+	}
+
+	const char *pszExtension = pContext->pFormat->pszExtension;
+	char *pszOutput = (char*)malloc(cchDir + 1 + cchBase + 1 + strlen(pszExtension) + 1);
+	if (pszOutput == NULL)
+		return NULL;
+
+	char *psz = pszOutput;
+	if (cchDir) {
+		CopyMemory(psz, pContext->pszOutputDir, cchDir);
+		psz += cchDir;
+		if (!IsSeparator(psz[-1]))
+			*psz++ = PATH_SEPARATOR;
+	}
+	CopyMemory(psz, pszBase, cchBase);
+	psz += cchBase;
+	sprintf(psz, ".%s", pszExtension);
+
+	return pszOutput;
+}
+
+static HRESULT AddJob(BATCH_CONTEXT *pContext, const char *pszInput, const char *pszPath, const char *pszRelative, LONGLONG llSize)
+{
+	if (pContext->nJobs == pContext->nMaxJobs) {
+		DWORD nMaxJobs = (pContext->nMaxJobs) ? (pContext->nMaxJobs * 2) : 256;
+		BATCH_JOB *pJobs = (BATCH_JOB*)realloc(pContext->pJobs, nMaxJobs * sizeof(BATCH_JOB));
+		if (pJobs == NULL)
+			return E_OUTOFMEMORY;
+		pContext->pJobs = pJobs;
+		pContext->nMaxJobs = nMaxJobs;
+	}
+
+	BATCH_JOB *pJob = &pContext->pJobs[pContext->nJobs];
+	ZeroMemory(pJob, sizeof(BATCH_JOB));
+	pJob->pszInput	= CopyString(pszInput, strlen(pszInput));
+	pJob->pszOutput	= GetOutputFileName(pContext, pszPath, pszRelative);
+	pJob->llSize	= llSize;
+	if ((pJob->pszInput == NULL) || (pJob->pszOutput == NULL)) {
+		free(pJob->pszInput);
+		free(pJob->pszOutput);
+		return E_OUTOFMEMORY;
+	}
+
+	pContext->nJobs++;
+	return NOERROR;
+}
+
+static BOOL HasInputExtension(const char *pszName)
+{
+	const char *pszExtension = strrchr(pszName, '.');
+	if (pszExtension == NULL)
+		return FALSE;
+
+	for (DWORD i = 0; i < INPUT_EXTENSIONS; i++)
+		if (strcasecmp(pszExtension + 1, g_pszInputExtensions[i]) == 0)
+			return TRUE;
+
+	return FALSE;
+}
+
+// Add the media files found in the directory tree. The root length
+// is the length of the scanned directory path prefix to cut off
+static HRESULT ScanDirectory(BATCH_CONTEXT *pContext, const char *pszDir, size_t cchRoot)
+{
+#ifdef _WIN32
+
+	char *pszPattern = (char*)malloc(strlen(pszDir) + 3);
+	if (pszPattern == NULL)
+		return E_OUTOFMEMORY;
+	sprintf(pszPattern, "%s\\*", pszDir);
+
+	WIN32_FIND_DATAA fd;
+	HANDLE hFind = FindFirstFileA(pszPattern, &fd);
+	free(pszPattern);
+	if (hFind == INVALID_HANDLE_VALUE)
+		return E_FAIL;
+
+	HRESULT hr = NOERROR;
+	do {
+		const char *pszName = fd.cFileName;
+
+#else
+
+	DIR *pDir = opendir(pszDir);
+	if (pDir == NULL)
+		return E_FAIL;
+
+	HRESULT hr = NOERROR;
+	struct dirent *pEntry;
+	while ((SUCCEEDED(hr)) && ((pEntry = readdir(pDir)) != NULL)) {
+		const char *pszName = pEntry->d_name;
+
+#endif
+
+		if ((strcmp(pszName, ".") == 0) || (strcmp(pszName, "..") == 0))
+			continue;
+
+		char *pszPath = (char*)malloc(strlen(pszDir) + 1 + strlen(pszName) + 1);
+		if (pszPath == NULL) {
+			hr = E_OUTOFMEMORY;
+			break;
+		}
+		sprintf(pszPath, "%s%c%s", pszDir, PATH_SEPARATOR, pszName);
+
+		struct stat st;
+		if (stat(pszPath, &st) == 0) {
+			if (S_ISDIR(st.st_mode))
+				hr = ScanDirectory(pContext, pszPath, cchRoot);
+			else if ((S_ISREG(st.st_mode)) && (HasInputExtension(pszName)))
+				hr = AddJob(pContext, pszPath, pszPath, pszPath + cchRoot, (LONGLONG)st.st_size);
+		}
+
+		free(pszPath);
+
+#ifdef _WIN32
+	} while ((SUCCEEDED(hr)) && (FindNextFileA(hFind, &fd)));
+	FindClose(hFind);
+#else
+	}
+	closedir(pDir);
+#endif
+
+	return hr;
+}
+
+static const char* GetArchiveErrorText(HRESULT hr)
+{
+	switch (hr) {
+		case E_INVALIDARG:				return "no such archive member (or the range is out of the file)";
+		case E_NOTIMPL:					return "the member is compressed or encrypted (only stored members are read in place)";
+		case VFW_E_INVALID_FILE_FORMAT:	return "not a ZIP (PK3), MIX or Fallout 2 DAT archive";
+		case E_OUTOFMEMORY:				return "out of memory";
+		default:						return "cannot read the archive";
+	}
+}
+
+// Add the archive member. The member is converted as if it were
+// extracted to the directory named after the archive, so that
+// "movies.mix|intro.vqa" goes to "movies/intro.avi"
+static HRESULT AddArchiveMember(BATCH_CONTEXT *pContext, const char *pszInput, const char *pszArchive, const char *pszMember)
+{
+	FILE *pFile = fopen(pszArchive, "rb");
+	if (pFile == NULL) {
+		fprintf(stderr, "%s: no such file\n", pszArchive);
+		return E_FAIL;
+	}
+	LONGLONG llOffset = 0, llSize = 0;
+	HRESULT hr = GetArchiveMemberRange(pFile, pszMember, &llOffset, &llSize);
+	fclose(pFile);
+	if (FAILED(hr)) {
+		fprintf(stderr, "%s: %s\n", pszInput, GetArchiveErrorText(hr));
+		return hr;
+	}
+
+	// Cut the archive extension off
+	size_t cchArchive = strlen(pszArchive);
+	size_t cchName = cchArchive;
+	while ((cchName > 0) && (!IsSeparator(pszArchive[cchName - 1])))
+		cchName--;
+	for (size_t i = cchArchive; i > cchName; i--)
+		if (pszArchive[i - 1] == '.') {
+			cchArchive = i - 1;
+			break;
+		}
+
+	char *pszPath = (char*)malloc(cchArchive + 1 + strlen(pszMember) + 1);
+	if (pszPath == NULL)
+		return E_OUTOFMEMORY;
+	CopyMemory(pszPath, pszArchive, cchArchive);
+	sprintf(pszPath + cchArchive, "%c%s", PATH_SEPARATOR, pszMember);
+
+	// The archives use either slash in the member names
+	for (char *pch = pszPath + cchArchive; *pch; pch++)
+		if ((*pch == '\\') || (*pch == '/'))
+			*pch = PATH_SEPARATOR;
+
+	hr = AddJob(pContext, pszInput, pszPath, pszPath + cchName, llSize);
+	free(pszPath);
+	return hr;
+}
+
+// Add the command line input: a file, a directory, an archive member
+// (archive|member) or a list file (@name)
+static HRESULT AddInput(BATCH_CONTEXT *pContext, const char *pszInput)
+{
+	if (pszInput[0] == '@') {
+
+		FILE *pFile = fopen(pszInput + 1, "rt");
+		if (pFile == NULL) {
+			fprintf(stderr, "%s: cannot open the list file\n", pszInput + 1);
+			return E_FAIL;
+		}
+
+		HRESULT hr = NOERROR;
+		char szLine[MAX_LIST_LINE];
+		while ((SUCCEEDED(hr)) && (fgets(szLine, sizeof(szLine), pFile))) {
+			size_t cch = strlen(szLine);
+			while ((cch > 0) && ((szLine[cch - 1] == '\n') || (szLine[cch - 1] == '\r')))
+				szLine[--cch] = '\0';
+			if (cch > 0)
+				hr = AddInput(pContext, szLine);
+		}
+
+		fclose(pFile);
+		return hr;
+	}
+
+	char *pszArchive = NULL;
+	const char *pszMember = NULL;
+	HRESULT hr = SplitArchivePath(pszInput, &pszArchive, &pszMember);
+	if (FAILED(hr))
+		return hr;
+	if (pszArchive) {
+		hr = AddArchiveMember(pContext, pszInput, pszArchive, pszMember);
+		free(pszArchive);
+		return hr;
+	}
+
+	struct stat st;
+	if (stat(pszInput, &st) != 0) {
+		fprintf(stderr, "%s: no such file or directory\n", pszInput);
+		return E_FAIL;
+	}
+
+	if (S_ISDIR(st.st_mode)) {
+		size_t cchRoot = strlen(pszInput);
+		if ((cchRoot > 0) && (!IsSeparator(pszInput[cchRoot - 1])))
+			cchRoot++;
+		return ScanDirectory(pContext, pszInput, cchRoot);
+	}
+
+	// Explicitly given files are taken whatever their extension is
+	const char *pszName = pszInput + strlen(pszInput);
+	while ((pszName > pszInput) && (!IsSeparator(pszName[-1])))
+		pszName--;
+	return AddJob(pContext, pszInput, pszInput, pszName, (LONGLONG)st.st_size);
+}
+
+static int CompareJobOutputs(const void *pA, const void *pB)
+{
+	return strcmp(((const BATCH_JOB*)pA)->pszOutput, ((const BATCH_JOB*)pB)->pszOutput);
+}
+
+// Largest files go first, so that the pool does not end up waiting
+// for a single long conversion started last
+static int CompareJobSizes(const void *pA, const void *pB)
+{
+	LONGLONG llA = ((const BATCH_JOB*)pA)->llSize;
+	LONGLONG llB = ((const BATCH_JOB*)pB)->llSize;
+	if (llA != llB)
+		return (llA > llB) ? -1 : 1;
+	return strcmp(((const BATCH_JOB*)pA)->pszInput, ((const BATCH_JOB*)pB)->pszInput);
+}
+
+// Create the directories on the output file path
+static void CreateOutputDirectories(const char *pszOutput)
+{
+	char *pszPath = CopyString(pszOutput, strlen(pszOutput));
+	if (pszPath == NULL)
+		return;
+
+	for (char *psz = pszPath + 1; *psz; psz++) {
+		if (!IsSeparator(*psz))
+			continue;
+		char ch = *psz;
+		*psz = '\0';
+#ifdef _WIN32
+		_mkdir(pszPath);
+#else
+		mkdir(pszPath, 0777);
+#endif
+		*psz = ch;
+	}
+
+	free(pszPath);
+}
+
+//==========================================================================
+// Conversion pipeline. Each file gets its own reader, decoders and
+// writer, so the jobs share nothing but the job list
+//==========================================================================
+
+static HRESULT ConvertFile(const BATCH_CONTEXT *pContext, BATCH_JOB *pJob)
+{
+	CMediaReader *pReader = NULL;
+	CBaseDecoder *pVideoDecoder = NULL;
+	CBaseDecoder *pAudioDecoder = NULL;
+	CMediaWriter *pWriter = NULL;
+	BYTE *pbVideo = NULL;
+	BYTE *pbAudio = NULL;
+	DWORD cbVideo = 0, cbAudio = 0;
+	const MEDIA_INFO *pInfo = NULL;
+
+	// Open the input file and set up the decoders
+	pJob->pszStage = "open";
+	HRESULT hr = OpenMediaFile(pJob->pszInput, &pReader);
+	if (FAILED(hr))
+		goto Done;
+	pInfo = pReader->GetInfo();
+
+	pJob->pszStage = "decoder setup";
+	pReader->SetDecodeThreads(pContext->nDecodeThreads);
+	pVideoDecoder = pReader->CreateVideoDecoder(&hr);
+	if (FAILED(hr))
+		goto Done;
+	pAudioDecoder = pReader->CreateAudioDecoder(&hr);
+	if (FAILED(hr))
+		goto Done;
+
+	cbVideo = pVideoDecoder->GetMaxOutputSize(0);
+	pbVideo = (BYTE*)malloc(cbVideo);
+	if (pbVideo == NULL) {
+		hr = E_OUTOFMEMORY;
+		goto Done;
+	}
+
+	// Create the output file
+	pJob->pszStage = "create";
+	CreateOutputDirectories(pJob->pszOutput);
+	pWriter = pContext->pFormat->pfnCreate();
+	hr = pWriter->Open(pJob->pszOutput, pInfo);
+	if (FAILED(hr))
+		goto Done;
+
+	// Walk the packets
+	for (;;) {
+
+		pJob->pszStage = "read";
+		MEDIA_PACKET packet;
+		hr = pReader->ReadPacket(packet);
+		if (hr != S_OK)
+			break;
+
+		GMF_FRAME frame;
+		ZeroMemory(&frame, sizeof(frame));
+
+		if (packet.iStream == MEDIA_STREAM_VIDEO) {
+
+			pJob->pszStage = "video decoding";
+			frame.pbBuffer		= pbVideo;
+			frame.cbBuffer		= cbVideo;
+			frame.pbPrevious	= pbVideo;	// The writers leave the frame intact
+			frame.iFrame		= pJob->nFrames;
+			hr = pVideoDecoder->Decode(packet.pbData, packet.cbData, frame);
+			if (FAILED(hr))
+				break;
+			if (hr != S_OK)
+				continue;
+
+			pJob->pszStage = "write";
+			hr = pWriter->WriteVideoFrame(frame);
+			if (FAILED(hr))
+				break;
+			pJob->nFrames++;
+
+		} else {
+
+			const BYTE *pbPCM = packet.pbData;
+			DWORD cbPCM = packet.cbData;
+
+			if (pAudioDecoder) {
+
+				pJob->pszStage = "audio decoding";
+				DWORD cbMax = pAudioDecoder->GetMaxOutputSize(packet.cbData);
+				if (cbMax > cbAudio) {
+					BYTE *pb = (BYTE*)realloc(pbAudio, cbMax);
+					if (pb == NULL) {
+						hr = E_OUTOFMEMORY;
+						break;
+					}
+					pbAudio = pb;
+					cbAudio = cbMax;
+				}
+
+				frame.pbBuffer	= pbAudio;
+				frame.cbBuffer	= cbAudio;
+				hr = pAudioDecoder->Decode(packet.pbData, packet.cbData, frame);
+				if (FAILED(hr))
+					break;
+				if (hr != S_OK)
+					continue;
+
+				pbPCM = pbAudio;
+				cbPCM = frame.cbData;
+			}
+
+			pJob->pszStage = "write";
+			hr = pWriter->WriteAudio(pbPCM, cbPCM);
+			if (FAILED(hr))
+				break;
+		}
+	}
+	if (FAILED(hr))
+		goto Done;
+
+	pJob->bTruncated = pReader->IsTruncated();
+
+	pJob->pszStage = "write";
+	hr = pWriter->Close();
+
+Done:
+
+	// Deleting the writer removes an unfinished output file
+	if (pWriter)
+		delete pWriter;
+	if (pVideoDecoder) {
+		pVideoDecoder->Cleanup();
+		delete pVideoDecoder;
+	}
+	if (pAudioDecoder) {
+		pAudioDecoder->Cleanup();
+		delete pAudioDecoder;
+	}
+	if (pReader)
+		delete pReader;
+	free(pbVideo);
+	free(pbAudio);
+
+	return hr;
+}
+
+static const char* GetErrorText(HRESULT hr)
+{
+	switch (hr) {
+		case VFW_E_INVALID_FILE_FORMAT:	return "not a valid VQA/ROQ/MVE/CIN file";
+		case E_INVALIDARG:				return "the stream does not fit the output container limits";
+		case E_OUTOFMEMORY:				return "out of memory";
+		default:						return NULL;
+	}
+}
+
+static void ReportJob(BATCH_CONTEXT *pContext, const BATCH_JOB *pJob)
+{
+	if (FAILED(pJob->hr)) {
+		const char *pszError = GetErrorText(pJob->hr);
+		if (pszError)
+			fprintf(stderr, "%s: %s failed: %s\n", pJob->pszInput, pJob->pszStage, pszError);
+		else
+			fprintf(stderr, "%s: %s failed (0x%08lX)\n", pJob->pszInput, pJob->pszStage, (unsigned long)pJob->hr);
+		return;
+	}
+
+	if (pJob->bTruncated)
+		fprintf(stderr, "%s: warning: the file is truncated\n", pJob->pszInput);
+
+	if (!pContext->bQuiet)
+		printf(
+			"[%lu/%lu] %s -> %s: %lu frames, %.2f s\n",
+			(unsigned long)pContext->nDoneJobs,
+			(unsigned long)pContext->nJobs,
+			pJob->pszInput,
+			pJob->pszOutput,
+			(unsigned long)pJob->nFrames,
+			pJob->dSeconds
+		);
+}
+
+//==========================================================================
+// Worker pool
+//==========================================================================
+
+#ifdef _WIN32
+static unsigned __stdcall WorkerThread(void *pParam)
+#else
+static void* WorkerThread(void *pParam)
+#endif
+{
+	BATCH_CONTEXT *pContext = (BATCH_CONTEXT*)pParam;
+
+	for (;;) {
+
+		// Pick up the next job
+		Lock(&pContext->lock);
+		DWORD iJob = pContext->iNextJob;
+		if (iJob < pContext->nJobs)
+			pContext->iNextJob++;
+		Unlock(&pContext->lock);
+
+		if (iJob >= pContext->nJobs)
+			break;
+
+		BATCH_JOB *pJob = &pContext->pJobs[iJob];
+		double dStart = GetTime();
+		pJob->hr = ConvertFile(pContext, pJob);
+		pJob->dSeconds = GetTime() - dStart;
+
+		Lock(&pContext->lock);
+		pContext->nDoneJobs++;
+		ReportJob(pContext, pJob);
+		fflush(stdout);
+		Unlock(&pContext->lock);
+	}
+
+	return 0;
+}
+
+static HRESULT RunJobs(BATCH_CONTEXT *pContext, DWORD nThreads)
+{
+	if (nThreads > pContext->nJobs)
+		nThreads = pContext->nJobs;
+
+	BATCH_THREAD *pThreads = (BATCH_THREAD*)malloc(nThreads * sizeof(BATCH_THREAD));
+	if (pThreads == NULL)
+		return E_OUTOFMEMORY;
+
+	InitLock(&pContext->lock);
+	pContext->iNextJob	= 0;
+	pContext->nDoneJobs	= 0;
+
+	// Start the workers. If some of them fail to start the rest
+	// will do the work (and the calling thread helps if none start)
+	DWORD nStarted = 0;
+	for (DWORD i = 0; i < nThreads; i++) {
+#ifdef _WIN32
+		pThreads[nStarted] = (HANDLE)_beginthreadex(NULL, 0, WorkerThread, pContext, 0, NULL);
+		if (pThreads[nStarted] != 0)
+			nStarted++;
+#else
+		if (pthread_create(&pThreads[nStarted], NULL, WorkerThread, pContext) == 0)
+			nStarted++;
+#endif
+	}
+	if (nStarted == 0)
+		WorkerThread(pContext);
+
+	for (DWORD i = 0; i < nStarted; i++) {
+#ifdef _WIN32
+		WaitForSingleObject(pThreads[i], INFINITE);
+		CloseHandle(pThreads[i]);
+#else
+		pthread_join(pThreads[i], NULL);
+#endif
+	}
+
+	DeleteLock(&pContext->lock);
+	free(pThreads);
+
+	return NOERROR;
+}
+
+//==========================================================================
+// Command line
+//==========================================================================
+
+static void PrintUsage(void)
+{
+	printf(
+		"Usage: gmfbatch [options] input...\n"
+		"\n"
+		"Inputs are VQA/ROQ/MVE/CIN files, directories (scanned recursively\n"
+		"for *.vqa, *.roq, *.mve and *.cin), archive members and list files\n"
+		"(@name, one input per line).\n"
+		"\n"
+		"An archive member is given as ARCHIVE|NAME (stored members of ZIP/PK3,\n"
+		"MIX and Fallout 2 DAT archives) or ARCHIVE|@OFFSET[,SIZE] (any file\n"
+		"range), and is read in place without extraction. Its output goes to\n"
+		"the directory named after the archive.\n"
+		"\n"
+		"Options:\n"
+		"  -f FORMAT  output format (default: avi):\n"
+		"               avi  uncompressed RGB24 (YV12 for ROQ) + PCM, up to 2 GB\n"
+		"               y4m  YUV4MPEG2 4:2:0 + PCM in a .wav file alongside\n"
+		"  -o DIR     output directory (default: next to the input files);\n"
+		"             the directory structure of the scanned inputs is kept\n"
+		"  -j N       number of parallel conversions (default: CPU count); with\n"
+		"             fewer files the spare threads decode the 8-bit VQA frames\n"
+		"  -q         report failures only\n"
+		"  -h         print this help (also --help)\n"
+		"  --         treat the rest of the arguments as inputs\n"
+	);
+}
+
+int main(int argc, char *argv[])
+{
+	BATCH_CONTEXT context;
+	ZeroMemory(&context, sizeof(context));
+	context.pFormat = &g_Formats[0];
+
+	DWORD nThreads = GetProcessorCount();
+	int iFirstInput = argc;
+
+	// Parse the options
+	for (int i = 1; i < argc; i++) {
+
+		const char *pszArg = argv[i];
+
+		// Long options: "--" ends the options (so that the inputs 
+		// may start with a dash), "--help" is the only other one
+		if ((pszArg[0] == '-') && (pszArg[1] == '-')) {
+			if (pszArg[2] == '\0') {
+				iFirstInput = i + 1;
+				break;
+			}
+			if (strcmp(pszArg, "--help") == 0) {
+				PrintUsage();
+				return 0;
+			}
+			fprintf(stderr, "Invalid argument: %s\n", pszArg);
+			PrintUsage();
+			return 2;
+		}
+
+		// The first argument which is not an option starts the inputs
+		if ((pszArg[0] != '-') || (pszArg[1] == '\0')) {
+			iFirstInput = i;
+			break;
+		}
+
+		// All other options are single letters
+		if (pszArg[2] != '\0') {
+			fprintf(stderr, "Invalid argument: %s\n", pszArg);
+			PrintUsage();
+			return 2;
+		}
+
+		if ((pszArg[1] == 'h') || (pszArg[1] == '?')) {
+			PrintUsage();
+			return 0;
+		}
+		if (pszArg[1] == 'q') {
+			context.bQuiet = TRUE;
+			continue;
+		}
+
+		// All other options take a value
+		if (i + 1 >= argc) {
+			fprintf(stderr, "Option %s requires a value\n", pszArg);
+			return 2;
+		}
+		const char *pszValue = argv[++i];
+
+		BOOL bIsValid = TRUE;
+		switch (pszArg[1]) {
+			case 'f':
+				bIsValid = FALSE;
+				for (DWORD j = 0; j < BATCH_FORMATS; j++)
+					if (strcmp(g_Formats[j].pszName, pszValue) == 0) {
+						context.pFormat = &g_Formats[j];
+						bIsValid = TRUE;
+					}
+				break;
+			case 'o':
+				context.pszOutputDir = pszValue;
+				break;
+			case 'j':
+				{
+					char *pszEnd = NULL;
+					unsigned long ulValue = strtoul(pszValue, &pszEnd, 10);
+					bIsValid = (pszEnd != pszValue) && (*pszEnd == '\0') && (ulValue > 0);
+					nThreads = (DWORD)ulValue;
+				}
+				break;
+			default:
+				bIsValid = FALSE;
+				break;
+		}
+
+		if (!bIsValid) {
+			fprintf(stderr, "Invalid argument: %s %s\n", pszArg, pszValue);
+			PrintUsage();
+			return 2;
+		}
+	}
+
+	if (iFirstInput >= argc) {
+		PrintUsage();
+		return 2;
+	}
+
+	// Collect the jobs
+	for (int i = iFirstInput; i < argc; i++)
+		if (FAILED(AddInput(&context, argv[i])))
+			return 1;
+
+	if (context.nJobs == 0) {
+		fprintf(stderr, "No input files found\n");
+		return 1;
+	}
+
+	// Two inputs must not end up in the same output file
+	qsort(context.pJobs, context.nJobs, sizeof(BATCH_JOB), CompareJobOutputs);
+	for (DWORD i = 1; i < context.nJobs; i++)
+		if (strcmp(context.pJobs[i - 1].pszOutput, context.pJobs[i].pszOutput) == 0) {
+			fprintf(
+				stderr,
+				"%s and %s would both be converted to %s\n",
+				context.pJobs[i - 1].pszInput,
+				context.pJobs[i].pszInput,
+				context.pJobs[i].pszOutput
+			);
+			return 1;
+		}
+	qsort(context.pJobs, context.nJobs, sizeof(BATCH_JOB), CompareJobSizes);
+
+	// With fewer files than threads the spare threads help to
+	// decode the frames
+	context.nDecodeThreads = (nThreads > context.nJobs) ? nThreads / context.nJobs : 1;
+
+	// Run the conversions
+	double dStart = GetTime();
+	if (FAILED(RunJobs(&context, nThreads))) {
+		fprintf(stderr, "Cannot start the conversion\n");
+		return 1;
+	}
+	double dSeconds = GetTime() - dStart;
+
+	// Summary
+	DWORD nFailed = 0;
+	double dFrames = 0;
+	for (DWORD i = 0; i < context.nJobs; i++) {
+		if (FAILED(context.pJobs[i].hr))
+			nFailed++;
+		else
+			dFrames += context.pJobs[i].nFrames;
+		free(context.pJobs[i].pszInput);
+		free(context.pJobs[i].pszOutput);
+	}
+	free(context.pJobs);
+
+	printf(
+		"%lu files converted, %lu failed, %.0f frames in %.2f s (%.1f frames/s, %lu jobs)\n",
+		(unsigned long)(context.nJobs - nFailed),
+		(unsigned long)nFailed,
+		dFrames,
+		dSeconds,
+		(dSeconds > 0) ? dFrames / dSeconds : 0.0,
+		(unsigned long)((nThreads < context.nJobs) ? nThreads : context.nJobs)
+	);
+
+	return (nFailed == 0) ? 0 : 1;
+}
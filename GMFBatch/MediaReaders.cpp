@@ -0,0 +1,1018 @@
+//==========================================================================
+//
+// File: MediaReaders.cpp
+//
+// Desc: Game Media Formats - Implementation of portable media file readers
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#include "MediaReaders.h"
+#include "ArchiveDirectory.h"
+#include "VQAVideoDecoder.h"
+#include "ROQVideoDecoder.h"
+#include "MVEVideoDecoder.h"
+#include "CINVideoDecoder.h"
+#include "ContinuousIMAADPCMDecoder.h"
+#include "ROQADPCMDecoder.h"
+#include "MVEADPCMDecoder.h"
+#include "WSADPCMDecoder.h"
+
+#ifdef _WIN32
+#define fseeko _fseeki64
+#endif
+
+// Input file buffer size
+#define MEDIA_FILE_BUFFER	0x40000
+
+// Sanity limits for the CIN header (there is no signature to check)
+#define CIN_MAX_DIMENSION	4096
+#define CIN_MAX_SAMPLE_RATE	96000
+
+//==========================================================================
+// CMediaReader methods
+//==========================================================================
+
+CMediaReader::CMediaReader(FILE *pFile) :
+	m_pFile(pFile),
+	m_llBase(0),
+	m_llSize(-1),
+	m_llPosition(0),
+	m_bTruncated(FALSE),
+	m_pbPacket(NULL),
+	m_cbPacket(0),
+	m_nDecodeThreads(1)
+{
+	ZeroMemory(&m_Info, sizeof(m_Info));
+}
+
+CMediaReader::~CMediaReader()
+{
+	if (m_pbPacket)
+		free(m_pbPacket);
+	if (m_pFile)
+		fclose(m_pFile);
+}
+
+HRESULT CMediaReader::ReadData(void *pBuffer, DWORD cbData)
+{
+	if (cbData == 0)
+		return NOERROR;
+
+	// Don't read past the end of the media data
+	DWORD cbAvailable = cbData;
+	if ((m_llSize >= 0) && (m_llPosition + cbData > m_llSize))
+		cbAvailable = (m_llPosition < m_llSize) ? (DWORD)(m_llSize - m_llPosition) : 0;
+
+	size_t cbRead = (cbAvailable) ? fread(pBuffer, 1, cbAvailable, m_pFile) : 0;
+	m_llPosition += cbRead;
+
+	if (cbRead == cbData)
+		return NOERROR;
+	if (ferror(m_pFile))
+		return E_FAIL;
+
+	// The file has ended: it's the normal end if we've read nothing
+	if (cbRead == 0)
+		return S_FALSE;
+
+	m_bTruncated = TRUE;
+	return S_FALSE;
+}
+
+HRESULT CMediaReader::SkipData(DWORD cbData)
+{
+	if (cbData == 0)
+		return NOERROR;
+
+	return Seek(m_llPosition + cbData);
+}
+
+HRESULT CMediaReader::Seek(LONGLONG llPosition)
+{
+	if (fseeko(m_pFile, m_llBase + llPosition, SEEK_SET) != 0)
+		return E_FAIL;
+
+	m_llPosition = llPosition;
+	return NOERROR;
+}
+
+HRESULT CMediaReader::SetRange(LONGLONG llBase, LONGLONG llSize)
+{
+	m_llBase = llBase;
+	m_llSize = llSize;
+	return Seek(0);
+}
+
+BYTE* CMediaReader::GetPacketBuffer(DWORD cbData)
+{
+	if (cbData > m_cbPacket) {
+		BYTE *pbPacket = (BYTE*)realloc(m_pbPacket, cbData);
+		if (pbPacket == NULL)
+			return NULL;
+		m_pbPacket = pbPacket;
+		m_cbPacket = cbData;
+	}
+	return m_pbPacket;
+}
+
+HRESULT CMediaReader::ReadPacketData(DWORD cbPrefix, DWORD cbData)
+{
+	BYTE *pbPacket = GetPacketBuffer(cbPrefix + cbData);
+	if (pbPacket == NULL)
+		return E_OUTOFMEMORY;
+
+	HRESULT hr = ReadData(pbPacket + cbPrefix, cbData);
+
+	// A chunk cut off by the end of the file is not delivered
+	if (hr == S_FALSE)
+		m_bTruncated = TRUE;
+
+	return hr;
+}
+
+CBaseDecoder* CMediaReader::CreateAudioDecoder(HRESULT *phr)
+{
+	// Plain PCM soundtrack by default
+	*phr = NOERROR;
+	return NULL;
+}
+
+//==========================================================================
+// VQA reader
+//==========================================================================
+
+class CVQAReader : public CMediaReader {
+
+	VQA_INFO	m_VQAInfo;		// VQA header
+	DWORD		m_dwAudioType;	// Audio chunk ID (0 if there is no audio)
+
+public:
+
+	CVQAReader(FILE *pFile) : CMediaReader(pFile), m_dwAudioType(0) {};
+
+	HRESULT Initialize(void);
+	HRESULT ReadPacket(MEDIA_PACKET& packet);
+	CBaseDecoder* CreateVideoDecoder(HRESULT *phr);
+	CBaseDecoder* CreateAudioDecoder(HRESULT *phr);
+};
+
+HRESULT CVQAReader::Initialize(void)
+{
+	// Read and verify the file header
+	VQA_FILE_HEADER header;
+	if (ReadData(&header, sizeof(header)) != S_OK)
+		return VFW_E_INVALID_FILE_FORMAT;
+	if (
+		(header.dwFileID	!= VQA_ID_FORM)	||
+		(header.dwFormatID	!= VQA_ID_WVQA)
+	)
+		return VFW_E_INVALID_FILE_FORMAT;
+
+	// Scan the chunks for the header and the audio type
+	ZeroMemory(&m_VQAInfo, sizeof(m_VQAInfo));
+	BOOL bFoundInfo = FALSE;
+	for (int i = 0; i < VQA_CHUNKS_TO_SCAN; i++) {
+
+		// Align the position
+		if ((m_llPosition % 2) && (SkipData(1) != S_OK))
+			break;
+
+		VQA_CHUNK_HEADER chunkheader;
+		if (ReadData(&chunkheader, sizeof(chunkheader)) != S_OK)
+			break;
+
+		DWORD cbChunk = SWAPDWORD(chunkheader.cbSize);
+		LONGLONG llNextChunk = m_llPosition + cbChunk;
+
+		switch (chunkheader.dwID) {
+
+			case VQA_ID_VQHD:
+				if ((cbChunk < sizeof(m_VQAInfo)) || (ReadData(&m_VQAInfo, sizeof(m_VQAInfo)) != S_OK))
+					return VFW_E_INVALID_FILE_FORMAT;
+				bFoundInfo = TRUE;
+				break;
+
+			case VQA_ID_SND0:
+			case VQA_ID_SND1:
+			case VQA_ID_SND2:
+				m_dwAudioType = chunkheader.dwID;
+				break;
+		}
+
+		if ((bFoundInfo) && (m_dwAudioType != 0))
+			break;
+
+		if (Seek(llNextChunk) != S_OK)
+			break;
+	}
+
+	if (
+		(!bFoundInfo)						||
+		(m_VQAInfo.wVideoWidth		== 0)	||
+		(m_VQAInfo.wVideoHeight		== 0)	||
+		(m_VQAInfo.bBlockWidth		== 0)	||
+		(m_VQAInfo.bBlockHeight		== 0)	||
+		(m_VQAInfo.nFramesPerSecond	== 0)
+	)
+		return VFW_E_INVALID_FILE_FORMAT;
+
+	m_Info.dwWidth			= m_VQAInfo.wVideoWidth;
+	m_Info.dwHeight			= m_VQAInfo.wVideoHeight;
+	m_Info.dwVideoFormat	= (m_VQAInfo.nColors == 0) ? MEDIA_VIDEO_RGB555 : MEDIA_VIDEO_RGB8;
+	m_Info.dwRate			= m_VQAInfo.nFramesPerSecond;
+	m_Info.dwScale			= 1;
+
+	if (m_dwAudioType != 0) {
+
+		// Correct the audio info fields (as the splitter does)
+		if (m_VQAInfo.wAudioSampleRate == 0)
+			m_VQAInfo.wAudioSampleRate = 22050;
+		if (m_VQAInfo.nAudioChannels == 0)
+			m_VQAInfo.nAudioChannels = 1;
+		if (m_VQAInfo.nAudioBits == 0)
+			m_VQAInfo.nAudioBits = 8;
+
+		m_Info.nChannels		= m_VQAInfo.nAudioChannels;
+		m_Info.nSamplesPerSec	= m_VQAInfo.wAudioSampleRate;
+		m_Info.wBitsPerSample	= m_VQAInfo.nAudioBits;
+
+		// WS ADPCM decodes to 8 bits and IMA ADPCM to 16 bits only
+		// (the decompressor filters reject other resolutions as well)
+		m_Info.bHasAudio =
+			((m_VQAInfo.nAudioChannels == 1) || (m_VQAInfo.nAudioChannels == 2)) &&
+			(
+				(m_dwAudioType == VQA_ID_SND0) ||
+				((m_dwAudioType == VQA_ID_SND1) && (m_VQAInfo.nAudioBits == 8)) ||
+				((m_dwAudioType == VQA_ID_SND2) && (m_VQAInfo.nAudioBits == 16))
+			);
+	}
+
+	// Rewind to the first chunk
+	return Seek(sizeof(VQA_FILE_HEADER));
+}
+
+HRESULT CVQAReader::ReadPacket(MEDIA_PACKET& packet)
+{
+	for (;;) {
+
+		// Align the position
+		if (m_llPosition % 2) {
+			HRESULT hr = SkipData(1);
+			if (hr != S_OK)
+				return hr;
+		}
+
+		VQA_CHUNK_HEADER chunkheader;
+		HRESULT hr = ReadData(&chunkheader, sizeof(chunkheader));
+		if (hr != S_OK)
+			return hr;
+
+		DWORD cbChunk = SWAPDWORD(chunkheader.cbSize);
+
+		switch (chunkheader.dwID) {
+
+			case VQA_ID_VQFR:
+			case VQA_ID_VQFL:
+				packet.iStream = MEDIA_STREAM_VIDEO;
+				break;
+
+			case VQA_ID_SND0:
+			case VQA_ID_SND1:
+			case VQA_ID_SND2:
+				if ((m_Info.bHasAudio) && (chunkheader.dwID == m_dwAudioType)) {
+					packet.iStream = MEDIA_STREAM_AUDIO;
+					break;
+				}
+				// Fall through
+
+			default:
+				// We pay no attention to other chunks
+				hr = SkipData(cbChunk);
+				if (hr != S_OK)
+					return hr;
+				continue;
+		}
+
+		hr = ReadPacketData(0, cbChunk);
+		if (hr != S_OK)
+			return hr;
+
+		packet.pbData = m_pbPacket;
+		packet.cbData = cbChunk;
+		return NOERROR;
+	}
+}
+
+CBaseDecoder* CVQAReader::CreateVideoDecoder(HRESULT *phr)
+{
+	CVQAVideoDecoder *pDecoder = new CVQAVideoDecoder();
+	pDecoder->SetThreadCount(m_nDecodeThreads);
+	*phr = pDecoder->SetFormat(&m_VQAInfo, sizeof(m_VQAInfo));
+	if (SUCCEEDED(*phr))
+		*phr = pDecoder->Initialize();
+	return pDecoder;
+}
+
+CBaseDecoder* CVQAReader::CreateAudioDecoder(HRESULT *phr)
+{
+	*phr = NOERROR;
+
+	if (m_dwAudioType == VQA_ID_SND1) {
+
+		WSADPCMWAVEFORMAT format;
+		format.nChannels		= m_VQAInfo.nAudioChannels;
+		format.nSamplesPerSec	= m_VQAInfo.wAudioSampleRate;
+		format.wBitsPerSample	= m_VQAInfo.nAudioBits;
+
+		CWSADPCMDecoder *pDecoder = new CWSADPCMDecoder();
+		*phr = pDecoder->SetFormat(&format, sizeof(format));
+		return pDecoder;
+
+	} else if (m_dwAudioType == VQA_ID_SND2) {
+
+		BYTE pbFormat[sizeof(CIMAADPCMWAVEFORMAT) + sizeof(CIMAADPCMINFO)];
+		CIMAADPCMWAVEFORMAT *pFormat = (CIMAADPCMWAVEFORMAT*)pbFormat;
+		DWORD cbFormat = sizeof(CIMAADPCMWAVEFORMAT) + (m_VQAInfo.nAudioChannels - 1) * sizeof(CIMAADPCMINFO);
+		ZeroMemory(pbFormat, sizeof(pbFormat));
+
+		pFormat->nChannels			= m_VQAInfo.nAudioChannels;
+		pFormat->nSamplesPerSec		= m_VQAInfo.wAudioSampleRate;
+		pFormat->wBitsPerSample		= m_VQAInfo.nAudioBits;
+		pFormat->bIsHiNibbleFirst	= FALSE;
+		pFormat->dwReserved			= (m_VQAInfo.nAudioChannels == 1)
+			? CIMAADPCM_INTERLEAVING_NORMAL
+			: (
+				(m_VQAInfo.wVersion < 3)
+				? CIMAADPCM_INTERLEAVING_DOUBLE
+				: CIMAADPCM_INTERLEAVING_SPLIT
+			);
+
+		CCIMAADPCMDecoder *pDecoder = new CCIMAADPCMDecoder();
+		*phr = pDecoder->SetFormat(pFormat, cbFormat);
+		if (SUCCEEDED(*phr))
+			*phr = pDecoder->Initialize();
+		return pDecoder;
+	}
+
+	return NULL;
+}
+
+//==========================================================================
+// ROQ reader
+//==========================================================================
+
+class CROQReader : public CMediaReader {
+
+	ROQ_VIDEO_FORMAT	m_ROQFormat;	// Video format
+	WORD				m_wAudioID;		// Audio chunk ID (0 if there is no audio)
+
+public:
+
+	CROQReader(FILE *pFile) : CMediaReader(pFile), m_wAudioID(0) {};
+
+	HRESULT Initialize(void);
+	HRESULT ReadPacket(MEDIA_PACKET& packet);
+	CBaseDecoder* CreateVideoDecoder(HRESULT *phr);
+	CBaseDecoder* CreateAudioDecoder(HRESULT *phr);
+};
+
+HRESULT CROQReader::Initialize(void)
+{
+	// Read and verify the file header
+	ROQ_CHUNK_HEADER header;
+	if (ReadData(&header, sizeof(header)) != S_OK)
+		return VFW_E_INVALID_FILE_FORMAT;
+	if (
+		(header.wID			!= ROQ_ID_ID)	||
+		(header.cbSize		!= ROQ_ID_SIZE)	||
+		(header.wArgument	== 0)
+	)
+		return VFW_E_INVALID_FILE_FORMAT;
+
+	ZeroMemory(&m_ROQFormat, sizeof(m_ROQFormat));
+	m_ROQFormat.nFramesPerSecond = header.wArgument;
+
+	// Scan the chunks for the video info and the audio type
+	for (int i = 0; i < ROQ_CHUNKS_TO_SCAN; i++) {
+
+		if (ReadData(&header, sizeof(header)) != S_OK)
+			break;
+
+		LONGLONG llNextChunk = m_llPosition + header.cbSize;
+
+		if (header.wID == ROQ_CHUNK_VIDEO_INFO) {
+
+			ROQ_VIDEO_INFO videoinfo;
+			if ((header.cbSize < sizeof(videoinfo)) || (ReadData(&videoinfo, sizeof(videoinfo)) != S_OK))
+				return VFW_E_INVALID_FILE_FORMAT;
+
+			m_ROQFormat.wWidth				= videoinfo.wWidth;
+			m_ROQFormat.wHeight				= videoinfo.wHeight;
+			m_ROQFormat.wBlockDimension		= videoinfo.wBlockDimension;
+			m_ROQFormat.wSubBlockDimension	= videoinfo.wSubBlockDimension;
+
+		} else if (
+			(header.wID == ROQ_CHUNK_SOUND_MONO) ||
+			(header.wID == ROQ_CHUNK_SOUND_STEREO)
+		)
+			m_wAudioID = header.wID;
+
+		if ((m_ROQFormat.wWidth != 0) && (m_wAudioID != 0))
+			break;
+
+		if (Seek(llNextChunk) != S_OK)
+			break;
+	}
+
+	if ((m_ROQFormat.wWidth == 0) || (m_ROQFormat.wHeight == 0))
+		return VFW_E_INVALID_FILE_FORMAT;
+
+	m_Info.dwWidth			= m_ROQFormat.wWidth;
+	m_Info.dwHeight			= m_ROQFormat.wHeight;
+	m_Info.dwVideoFormat	= MEDIA_VIDEO_YV12;
+	m_Info.dwRate			= m_ROQFormat.nFramesPerSecond;
+	m_Info.dwScale			= 1;
+
+	if (m_wAudioID != 0) {
+		m_Info.bHasAudio		= TRUE;
+		m_Info.nChannels		= (m_wAudioID == ROQ_CHUNK_SOUND_STEREO) ? 2 : 1;
+		m_Info.nSamplesPerSec	= ROQ_SAMPLE_RATE;
+		m_Info.wBitsPerSample	= ROQ_SAMPLE_BITS;
+	}
+
+	// Rewind to the first chunk
+	return Seek(sizeof(ROQ_CHUNK_HEADER));
+}
+
+HRESULT CROQReader::ReadPacket(MEDIA_PACKET& packet)
+{
+	for (;;) {
+
+		ROQ_CHUNK_HEADER header;
+		HRESULT hr = ReadData(&header, sizeof(header));
+		if (hr != S_OK)
+			return hr;
+
+		switch (header.wID) {
+
+			// Video chunks are delivered together with their headers
+			case ROQ_CHUNK_VIDEO_CODEBOOK:
+			case ROQ_CHUNK_VIDEO_FRAME:
+
+				hr = ReadPacketData(sizeof(header), header.cbSize);
+				if (hr != S_OK)
+					return hr;
+				CopyMemory(m_pbPacket, &header, sizeof(header));
+
+				packet.iStream	= MEDIA_STREAM_VIDEO;
+				packet.pbData	= m_pbPacket;
+				packet.cbData	= sizeof(header) + header.cbSize;
+				return NOERROR;
+
+			// Audio chunks are prefixed with the initial prediction
+			case ROQ_CHUNK_SOUND_MONO:
+			case ROQ_CHUNK_SOUND_STEREO:
+
+				if (header.wID != m_wAudioID)
+					break;
+
+				hr = ReadPacketData(sizeof(WORD), header.cbSize);
+				if (hr != S_OK)
+					return hr;
+				*((WORD*)m_pbPacket) = header.wArgument;
+
+				packet.iStream	= MEDIA_STREAM_AUDIO;
+				packet.pbData	= m_pbPacket;
+				packet.cbData	= sizeof(WORD) + header.cbSize;
+				return NOERROR;
+		}
+
+		// We pay no attention to other chunks
+		hr = SkipData(header.cbSize);
+		if (hr != S_OK)
+			return hr;
+	}
+}
+
+CBaseDecoder* CROQReader::CreateVideoDecoder(HRESULT *phr)
+{
+	CROQVideoDecoder *pDecoder = new CROQVideoDecoder();
+	*phr = pDecoder->SetFormat(&m_ROQFormat, sizeof(m_ROQFormat));
+	if (SUCCEEDED(*phr))
+		*phr = pDecoder->Initialize();
+	return pDecoder;
+}
+
+CBaseDecoder* CROQReader::CreateAudioDecoder(HRESULT *phr)
+{
+	*phr = NOERROR;
+	if (!m_Info.bHasAudio)
+		return NULL;
+
+	ROQADPCMWAVEFORMAT format;
+	format.nChannels		= m_Info.nChannels;
+	format.nSamplesPerSec	= ROQ_SAMPLE_RATE;
+	format.wBitsPerSample	= ROQ_SAMPLE_BITS;
+
+	CROQADPCMDecoder *pDecoder = new CROQADPCMDecoder();
+	*phr = pDecoder->SetFormat(&format, sizeof(format));
+	return pDecoder;
+}
+
+//==========================================================================
+// MVE reader
+//==========================================================================
+
+class CMVEReader : public CMediaReader {
+
+	MVE_VIDEO_INFO	m_VideoInfo;			// Video info
+	MVE_AUDIO_INFO	m_AudioInfo;			// Audio info
+	BOOL			m_bIsAudioCompressed;	// Is the soundtrack compressed?
+	WORD			m_nSampleSize;			// Uncompressed audio sample size
+
+	LONGLONG		m_llChunkEnd;			// End of the current chunk
+
+public:
+
+	CMVEReader(FILE *pFile) :
+		CMediaReader(pFile),
+		m_bIsAudioCompressed(FALSE),
+		m_nSampleSize(0),
+		m_llChunkEnd(0)
+	{};
+
+	HRESULT Initialize(void);
+	HRESULT ReadPacket(MEDIA_PACKET& packet);
+	CBaseDecoder* CreateVideoDecoder(HRESULT *phr);
+	CBaseDecoder* CreateAudioDecoder(HRESULT *phr);
+};
+
+HRESULT CMVEReader::Initialize(void)
+{
+	// Read and verify the file header
+	MVE_HEADER header;
+	if (ReadData(&header, sizeof(header)) != S_OK)
+		return VFW_E_INVALID_FILE_FORMAT;
+	if (
+		(memcmp(header.szID, MVE_IDSTR_MVE, sizeof(header.szID)) != 0)	||
+		(header.wMagic1 != MVE_ID_MAGIC1)								||
+		(header.wMagic2 != MVE_ID_MAGIC2)								||
+		(header.wMagic3 != MVE_ID_MAGIC3)
+	)
+		return VFW_E_INVALID_FILE_FORMAT;
+
+	// Scan the chunks for the video, audio and timer info
+	ZeroMemory(&m_VideoInfo, sizeof(m_VideoInfo));
+	ZeroMemory(&m_AudioInfo, sizeof(m_AudioInfo));
+	BOOL bFoundVideoInfo = FALSE;
+	BOOL bFoundAudioInfo = FALSE;
+	BOOL bFoundTimerData = FALSE;
+	MVE_TIMER_DATA timerdata = {0};
+	for (int i = 0; i < MVE_CHUNKS_TO_SCAN; i++) {
+
+		MVE_CHUNK_HEADER chunkheader;
+		if (ReadData(&chunkheader, sizeof(chunkheader)) != S_OK)
+			break;
+
+		LONGLONG llChunkEnd = m_llPosition + chunkheader.cbData;
+
+		// Walk the subchunks of this chunk
+		while (m_llPosition + (LONGLONG)sizeof(MVE_CHUNK_HEADER) <= llChunkEnd) {
+
+			MVE_CHUNK_HEADER subchunkheader;
+			if (ReadData(&subchunkheader, sizeof(subchunkheader)) != S_OK)
+				break;
+
+			LONGLONG llNextSubchunk = m_llPosition + subchunkheader.cbData;
+			DWORD cbInfo = subchunkheader.cbData;
+
+			switch (subchunkheader.bType) {
+
+				case MVE_SUBCHUNK_TIMER:
+					if (ReadData(&timerdata, (cbInfo < sizeof(timerdata)) ? cbInfo : (DWORD)sizeof(timerdata)) == S_OK)
+						bFoundTimerData = TRUE;
+					break;
+
+				case MVE_SUBCHUNK_AUDIOINFO:
+					if (ReadData(&m_AudioInfo, (cbInfo < sizeof(m_AudioInfo)) ? cbInfo : (DWORD)sizeof(m_AudioInfo)) == S_OK) {
+						m_bIsAudioCompressed = (subchunkheader.bSubtype >= 1) && (m_AudioInfo.wFlags & MVE_AUDIO_COMPRESSED);
+						bFoundAudioInfo = TRUE;
+					}
+					break;
+
+				case MVE_SUBCHUNK_VIDEOINFO:
+					if (
+						(!bFoundVideoInfo) &&
+						(ReadData(&m_VideoInfo, (cbInfo < sizeof(m_VideoInfo)) ? cbInfo : (DWORD)sizeof(m_VideoInfo)) == S_OK)
+					)
+						bFoundVideoInfo = TRUE;
+					break;
+			}
+
+			if (Seek(llNextSubchunk) != S_OK)
+				break;
+		}
+
+		if ((bFoundVideoInfo) && (bFoundAudioInfo) && (bFoundTimerData))
+			break;
+
+		if (Seek(llChunkEnd) != S_OK)
+			break;
+	}
+
+	if ((!bFoundVideoInfo) || (m_VideoInfo.wWidth == 0) || (m_VideoInfo.wHeight == 0))
+		return VFW_E_INVALID_FILE_FORMAT;
+
+	// Frame duration in microseconds
+	DWORD dwFrameDelta = (bFoundTimerData)
+		? (timerdata.dwRate * timerdata.wSubdivision)
+		: (MVE_FRAME_DELTA_DEFAULT / 10);
+	if (dwFrameDelta == 0)
+		dwFrameDelta = MVE_FRAME_DELTA_DEFAULT / 10;
+
+	m_Info.dwWidth			= m_VideoInfo.wWidth * 8;
+	m_Info.dwHeight			= m_VideoInfo.wHeight * 8;
+	m_Info.dwVideoFormat	= (m_VideoInfo.wHiColor) ? MEDIA_VIDEO_RGB555 : MEDIA_VIDEO_RGB8;
+	m_Info.dwRate			= 1000000;
+	m_Info.dwScale			= dwFrameDelta;
+
+	if ((bFoundAudioInfo) && (m_AudioInfo.wSampleRate != 0)) {
+		m_Info.bHasAudio		= TRUE;
+		m_Info.nChannels		= (m_AudioInfo.wFlags & MVE_AUDIO_STEREO) ? 2 : 1;
+		m_Info.nSamplesPerSec	= m_AudioInfo.wSampleRate;
+		m_Info.wBitsPerSample	= (m_AudioInfo.wFlags & MVE_AUDIO_16BIT) ? 16 : 8;
+		m_nSampleSize			= m_Info.nChannels * m_Info.wBitsPerSample / 8;
+	}
+
+	// Rewind to the first chunk
+	m_llChunkEnd = sizeof(MVE_HEADER);
+	return Seek(sizeof(MVE_HEADER));
+}
+
+HRESULT CMVEReader::ReadPacket(MEDIA_PACKET& packet)
+{
+	for (;;) {
+
+		HRESULT hr = NOERROR;
+
+		// Step into the next chunk when the current one is exhausted
+		if (m_llPosition + (LONGLONG)sizeof(MVE_CHUNK_HEADER) > m_llChunkEnd) {
+
+			if ((m_llPosition != m_llChunkEnd) && ((hr = Seek(m_llChunkEnd)) != S_OK))
+				return hr;
+
+			MVE_CHUNK_HEADER chunkheader;
+			hr = ReadData(&chunkheader, sizeof(chunkheader));
+			if (hr != S_OK)
+				return hr;
+
+			m_llChunkEnd = m_llPosition + chunkheader.cbData;
+			continue;
+		}
+
+		MVE_CHUNK_HEADER subchunkheader;
+		hr = ReadData(&subchunkheader, sizeof(subchunkheader));
+		if (hr != S_OK)
+			return hr;
+
+		DWORD cbData = subchunkheader.cbData;
+
+		switch (subchunkheader.bType) {
+
+			// The end of the movie
+			case MVE_SUBCHUNK_STOP:
+				return S_FALSE;
+
+			// Video subchunks are delivered with their type and subtype
+			case MVE_SUBCHUNK_PALETTE_GRAD:
+			case MVE_SUBCHUNK_PALETTE:
+			case MVE_SUBCHUNK_PALETTE_RLE:
+			case MVE_SUBCHUNK_VIDEOINFO:
+			case MVE_SUBCHUNK_VIDEOMAP:
+			case MVE_SUBCHUNK_VIDEODATA:
+			case MVE_SUBCHUNK_VIDEOCMD:
+
+				hr = ReadPacketData(2, cbData);
+				if (hr != S_OK)
+					return hr;
+				m_pbPacket[0] = subchunkheader.bType;
+				m_pbPacket[1] = subchunkheader.bSubtype;
+
+				packet.iStream	= MEDIA_STREAM_VIDEO;
+				packet.pbData	= m_pbPacket;
+				packet.cbData	= 2 + cbData;
+				return NOERROR;
+
+			// Audio subchunks are delivered without the audio header
+			case MVE_SUBCHUNK_AUDIODATA:
+			case MVE_SUBCHUNK_AUDIOSILENCE:
+
+				if ((!m_Info.bHasAudio) || (cbData < sizeof(MVE_AUDIO_HEADER)))
+					break;
+
+				hr = ReadPacketData(0, cbData);
+				if (hr != S_OK)
+					return hr;
+
+				{
+					MVE_AUDIO_HEADER audioheader;
+					CopyMemory(&audioheader, m_pbPacket, sizeof(audioheader));
+
+					// Only the first stream is delivered
+					if (!(audioheader.wStreamMask & 1))
+						continue;
+
+					if (subchunkheader.bType == MVE_SUBCHUNK_AUDIOSILENCE) {
+
+						if (audioheader.cbPCMData < m_nSampleSize)
+							continue;
+
+						// Fill the buffer with silence in the stream format
+						BOOL bIs16Bit = (m_AudioInfo.wFlags & MVE_AUDIO_16BIT) != 0;
+						WORD wCompressionRatio = (m_bIsAudioCompressed) ? 2 : 1;
+						DWORD cbFillSize = (bIs16Bit)
+							? (m_nSampleSize + (audioheader.cbPCMData - m_nSampleSize) / wCompressionRatio)
+							: audioheader.cbPCMData;
+
+						BYTE *pbPacket = GetPacketBuffer(cbFillSize);
+						if (pbPacket == NULL)
+							return E_OUTOFMEMORY;
+						FillMemory(pbPacket, cbFillSize, (bIs16Bit) ? 0x00 : 0x80);
+						cbData = cbFillSize;
+
+					} else {
+
+						cbData -= sizeof(MVE_AUDIO_HEADER);
+						MoveMemory(m_pbPacket, m_pbPacket + sizeof(MVE_AUDIO_HEADER), cbData);
+					}
+				}
+
+				packet.iStream	= MEDIA_STREAM_AUDIO;
+				packet.pbData	= m_pbPacket;
+				packet.cbData	= cbData;
+				return NOERROR;
+		}
+
+		// We pay no attention to other subchunks
+		hr = SkipData(cbData);
+		if (hr != S_OK)
+			return hr;
+	}
+}
+
+CBaseDecoder* CMVEReader::CreateVideoDecoder(HRESULT *phr)
+{
+	CMVEVideoDecoder *pDecoder = new CMVEVideoDecoder();
+	*phr = pDecoder->SetFormat(&m_VideoInfo, sizeof(m_VideoInfo));
+	if (SUCCEEDED(*phr))
+		*phr = pDecoder->Initialize();
+	return pDecoder;
+}
+
+CBaseDecoder* CMVEReader::CreateAudioDecoder(HRESULT *phr)
+{
+	*phr = NOERROR;
+	if ((!m_Info.bHasAudio) || (!m_bIsAudioCompressed))
+		return NULL;
+
+	CMVEADPCMDecoder *pDecoder = new CMVEADPCMDecoder();
+	*phr = pDecoder->SetFormat(&m_AudioInfo, sizeof(m_AudioInfo));
+	return pDecoder;
+}
+
+//==========================================================================
+// CIN reader
+//==========================================================================
+
+class CCINReader : public CMediaReader {
+
+	CIN_HEADER	m_CINHeader;		// File header
+	DWORD		m_cbAudioChunk;		// Audio data size per frame
+	BOOL		m_bUseCorrection;	// Does the audio chunk size alternate?
+	BOOL		m_bDoCorrection;	// Is the current audio chunk one byte larger?
+	BOOL		m_bAudioPending;	// Is the audio chunk next in the file?
+
+public:
+
+	CCINReader(FILE *pFile) :
+		CMediaReader(pFile),
+		m_cbAudioChunk(0),
+		m_bUseCorrection(FALSE),
+		m_bDoCorrection(FALSE),
+		m_bAudioPending(FALSE)
+	{};
+
+	HRESULT Initialize(void);
+	HRESULT ReadPacket(MEDIA_PACKET& packet);
+	CBaseDecoder* CreateVideoDecoder(HRESULT *phr);
+};
+
+HRESULT CCINReader::Initialize(void)
+{
+	// Read and sanity-check the file header
+	if (ReadData(&m_CINHeader, sizeof(m_CINHeader)) != S_OK)
+		return VFW_E_INVALID_FILE_FORMAT;
+	if (
+		(m_CINHeader.dwVideoWidth		== 0)					||
+		(m_CINHeader.dwVideoWidth		> CIN_MAX_DIMENSION)	||
+		(m_CINHeader.dwVideoHeight		== 0)					||
+		(m_CINHeader.dwVideoHeight		> CIN_MAX_DIMENSION)	||
+		(m_CINHeader.dwAudioSampleRate	> CIN_MAX_SAMPLE_RATE)	||
+		(m_CINHeader.dwAudioSampleWidth	> 2)					||
+		(m_CINHeader.nAudioChannels		> 2)
+	)
+		return VFW_E_INVALID_FILE_FORMAT;
+
+	m_Info.dwWidth			= m_CINHeader.dwVideoWidth;
+	m_Info.dwHeight			= m_CINHeader.dwVideoHeight;
+	m_Info.dwVideoFormat	= MEDIA_VIDEO_RGB8;
+	m_Info.dwRate			= CIN_FPS;
+	m_Info.dwScale			= 1;
+
+	// The audio data is always there, even if there is no soundtrack
+	DWORD nAvgBytesPerSec =
+		m_CINHeader.dwAudioSampleRate	*
+		m_CINHeader.dwAudioSampleWidth	*
+		m_CINHeader.nAudioChannels;
+	m_cbAudioChunk		= nAvgBytesPerSec / CIN_FPS;
+	m_bUseCorrection	= nAvgBytesPerSec % CIN_FPS;
+	m_bDoCorrection		= FALSE;
+
+	if (nAvgBytesPerSec != 0) {
+		m_Info.bHasAudio		= TRUE;
+		m_Info.nChannels		= (WORD)m_CINHeader.nAudioChannels;
+		m_Info.nSamplesPerSec	= m_CINHeader.dwAudioSampleRate;
+		m_Info.wBitsPerSample	= (WORD)(m_CINHeader.dwAudioSampleWidth * 8);
+	}
+
+	return NOERROR;
+}
+
+HRESULT CCINReader::ReadPacket(MEDIA_PACKET& packet)
+{
+	HRESULT hr = NOERROR;
+
+	// Audio data follows the video data of the same frame
+	if (m_bAudioPending) {
+
+		m_bAudioPending = FALSE;
+
+		DWORD cbAudio = m_cbAudioChunk;
+		if (m_bUseCorrection) {
+			if (m_bDoCorrection)
+				cbAudio++;
+			m_bDoCorrection = !m_bDoCorrection;
+		}
+
+		hr = ReadPacketData(0, cbAudio);
+		if (hr != S_OK)
+			return hr;
+
+		if (cbAudio != 0) {
+			packet.iStream	= MEDIA_STREAM_AUDIO;
+			packet.pbData	= m_pbPacket;
+			packet.cbData	= cbAudio;
+			return NOERROR;
+		}
+	}
+
+	// Frame command
+	DWORD dwCommand = 0;
+	hr = ReadData(&dwCommand, sizeof(dwCommand));
+	if (hr != S_OK)
+		return hr;
+	if (dwCommand == CIN_COMMAND_EOF)
+		return S_FALSE;
+
+	DWORD cbCommand = sizeof(dwCommand) + ((dwCommand == CIN_COMMAND_PALETTE) ? 0x300 : 0);
+
+	// The palette (if any) and the video data size
+	BYTE *pbPacket = GetPacketBuffer(cbCommand + sizeof(DWORD));
+	if (pbPacket == NULL)
+		return E_OUTOFMEMORY;
+	CopyMemory(pbPacket, &dwCommand, sizeof(dwCommand));
+	hr = ReadPacketData(sizeof(dwCommand), cbCommand - sizeof(dwCommand) + sizeof(DWORD));
+	if (hr != S_OK)
+		return hr;
+
+	DWORD cbVideo = 0;
+	CopyMemory(&cbVideo, m_pbPacket + cbCommand, sizeof(DWORD));
+
+	// The sample consists of the command, the palette and the video data
+	hr = ReadPacketData(cbCommand, cbVideo);
+	if (hr != S_OK)
+		return hr;
+
+	m_bAudioPending = TRUE;
+
+	packet.iStream	= MEDIA_STREAM_VIDEO;
+	packet.pbData	= m_pbPacket;
+	packet.cbData	= cbCommand + cbVideo;
+	return NOERROR;
+}
+
+CBaseDecoder* CCINReader::CreateVideoDecoder(HRESULT *phr)
+{
+	CCINVideoDecoder *pDecoder = new CCINVideoDecoder();
+	*phr = pDecoder->SetFormat(&m_CINHeader, sizeof(m_CINHeader));
+	return pDecoder;
+}
+
+//==========================================================================
+// Reader factory
+//==========================================================================
+
+HRESULT OpenMediaFile(const char *pszFileName, CMediaReader **ppReader)
+{
+	*ppReader = NULL;
+
+	// Archive member is read in place
+	char *pszArchive = NULL;
+	const char *pszMember = NULL;
+	HRESULT hr = SplitArchivePath(pszFileName, &pszArchive, &pszMember);
+	if (FAILED(hr))
+		return hr;
+
+	FILE *pFile = fopen((pszArchive) ? pszArchive : pszFileName, "rb");
+	free(pszArchive);
+	if (pFile == NULL)
+		return E_FAIL;
+	setvbuf(pFile, NULL, _IOFBF, MEDIA_FILE_BUFFER);
+
+	LONGLONG llBase = 0, llSize = -1;
+	if (pszMember) {
+		hr = GetArchiveMemberRange(pFile, pszMember, &llBase, &llSize);
+		if (FAILED(hr)) {
+			fclose(pFile);
+			return hr;
+		}
+	}
+
+	// Peek the file signature
+	BYTE pbSignature[sizeof(MVE_HEADER)];
+	ZeroMemory(pbSignature, sizeof(pbSignature));
+	size_t cbSignature = sizeof(pbSignature);
+	if ((llSize >= 0) && (llSize < (LONGLONG)cbSignature))
+		cbSignature = (size_t)llSize;
+	if (fseeko(pFile, llBase, SEEK_SET) != 0) {
+		fclose(pFile);
+		return E_FAIL;
+	}
+	cbSignature = fread(pbSignature, 1, cbSignature, pFile);
+
+	const VQA_FILE_HEADER *pVQAHeader = (const VQA_FILE_HEADER*)pbSignature;
+	const ROQ_CHUNK_HEADER *pROQHeader = (const ROQ_CHUNK_HEADER*)pbSignature;
+
+	CMediaReader *pReader = NULL;
+	if (
+		(cbSignature >= sizeof(VQA_FILE_HEADER)) &&
+		(pVQAHeader->dwFileID	== VQA_ID_FORM)	&&
+		(pVQAHeader->dwFormatID	== VQA_ID_WVQA)
+	)
+		pReader = new CVQAReader(pFile);
+	else if (
+		(cbSignature >= sizeof(ROQ_CHUNK_HEADER)) &&
+		(pROQHeader->wID	== ROQ_ID_ID) &&
+		(pROQHeader->cbSize	== ROQ_ID_SIZE)
+	)
+		pReader = new CROQReader(pFile);
+	else if (
+		(cbSignature >= sizeof(MVE_HEADER)) &&
+		(memcmp(pbSignature, MVE_IDSTR_MVE, strlen(MVE_IDSTR_MVE)) == 0)
+	)
+		pReader = new CMVEReader(pFile);
+	else
+		pReader = new CCINReader(pFile);
+
+	if (pReader == NULL) {
+		fclose(pFile);
+		return E_OUTOFMEMORY;
+	}
+
+	hr = pReader->SetRange(llBase, llSize);
+	if (SUCCEEDED(hr))
+		hr = pReader->Initialize();
+	if (FAILED(hr)) {
+		delete pReader;
+		return hr;
+	}
+
+	*ppReader = pReader;
+	return NOERROR;
+}
@@ -0,0 +1,142 @@
+//==========================================================================
+//
+// File: MediaReaders.h
+//
+// Desc: Game Media Formats - Header file for portable media file readers
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#ifndef __GMF_MEDIA_READERS_H__
+#define __GMF_MEDIA_READERS_H__
+
+#include <stdio.h>
+
+#include "BaseDecoder.h"
+
+//==========================================================================
+// Constants
+//==========================================================================
+
+// Decoded video formats (all of them are top-down)
+#define MEDIA_VIDEO_RGB8	0	// 8-bit palettized
+#define MEDIA_VIDEO_RGB555	1	// 16-bit RGB 5:5:5
+#define MEDIA_VIDEO_YV12	2	// Planar 4:2:0 (Y, V, U planes)
+
+// Stream indices
+#define MEDIA_STREAM_VIDEO	0
+#define MEDIA_STREAM_AUDIO	1
+
+//==========================================================================
+// Structures
+//==========================================================================
+
+// Media file properties. The audio fields describe the decoded PCM data
+typedef struct tagMEDIA_INFO {
+	DWORD	dwWidth;			// Video width
+	DWORD	dwHeight;			// Video height
+	DWORD	dwVideoFormat;		// Decoded video format (MEDIA_VIDEO_*)
+	DWORD	dwRate;				// Frame rate is dwRate / dwScale
+	DWORD	dwScale;			// ----||----
+	BOOL	bHasAudio;			// Is there a soundtrack we can decode?
+	WORD	nChannels;			// Number of channels
+	DWORD	nSamplesPerSec;		// Sample rate
+	WORD	wBitsPerSample;		// Sample resolution
+} MEDIA_INFO;
+
+// Stream data block as the corresponding splitter would deliver it
+typedef struct tagMEDIA_PACKET {
+	DWORD		iStream;		// Stream index (MEDIA_STREAM_*)
+	const BYTE	*pbData;		// Packet data (valid until the next read)
+	DWORD		cbData;			// Packet data size
+} MEDIA_PACKET;
+
+//==========================================================================
+// Base media reader class. A reader walks the file chunks the same
+// way the DirectShow splitter does and hands out the packets which
+// the GMFCodec decoders accept as is
+//==========================================================================
+
+class CMediaReader {
+
+protected:
+
+	FILE		*m_pFile;		// Input file
+	LONGLONG	m_llBase;		// File offset of the media data
+	LONGLONG	m_llSize;		// Size of the media data (-1: up to the end of the file)
+	LONGLONG	m_llPosition;	// Current position (relative to the base)
+	MEDIA_INFO	m_Info;			// Media properties (set by Initialize())
+	BOOL		m_bTruncated;	// Has the file ended in the middle of a chunk?
+
+	BYTE		*m_pbPacket;	// Packet buffer
+	DWORD		m_cbPacket;		// Packet buffer size
+
+	DWORD		m_nDecodeThreads;	// Threads the video decoder may use
+
+	// File access helpers. ReadData() returns S_FALSE if the file
+	// ends right at the current position
+	HRESULT ReadData(void *pBuffer, DWORD cbData);
+	HRESULT SkipData(DWORD cbData);
+	HRESULT Seek(LONGLONG llPosition);
+
+	// Get the packet buffer of at least the specified size
+	BYTE* GetPacketBuffer(DWORD cbData);
+
+	// Read the chunk data into the packet buffer (after the
+	// specified number of prefix bytes)
+	HRESULT ReadPacketData(DWORD cbPrefix, DWORD cbData);
+
+public:
+
+	CMediaReader(FILE *pFile);
+	virtual ~CMediaReader();
+
+	// Read the media data from the part of the file (an archive
+	// member). Should be called before Initialize()
+	HRESULT SetRange(LONGLONG llBase, LONGLONG llSize);
+
+	// Number of threads the video decoder may use to decode the frame
+	// (the decoders which can't split the frame ignore it). Should be
+	// called before CreateVideoDecoder()
+	void SetDecodeThreads(DWORD nThreads) { m_nDecodeThreads = nThreads; };
+
+	// Read the file header and set up the media properties
+	virtual HRESULT Initialize(void) = 0;
+
+	// Get the next packet. Returns S_FALSE at the end of the file
+	virtual HRESULT ReadPacket(MEDIA_PACKET& packet) = 0;
+
+	// Create the decoders set up for the file streams. The audio
+	// decoder is NULL if the soundtrack is plain PCM
+	virtual CBaseDecoder* CreateVideoDecoder(HRESULT *phr) = 0;
+	virtual CBaseDecoder* CreateAudioDecoder(HRESULT *phr);
+
+	const MEDIA_INFO* GetInfo(void) { return &m_Info; };
+	BOOL IsTruncated(void) { return m_bTruncated; };
+};
+
+//==========================================================================
+// Reader factory. Detects the file type by its header (CIN files have
+// no signature, so their header fields are sanity-checked instead).
+// The file name may also be an archive member path ("archive|member",
+// see ArchiveDirectory.h), the member is read in place then
+//==========================================================================
+
+HRESULT OpenMediaFile(const char *pszFileName, CMediaReader **ppReader);
+
+#endif
@@ -0,0 +1,865 @@
+//==========================================================================
+//
+// File: MediaWriters.cpp
+//
+// Desc: Game Media Formats - Implementation of raw AVI/WAV/Y4M file writers
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#include <stddef.h>
+
+#include "MediaWriters.h"
+
+// Output file buffer size
+#define MEDIA_FILE_BUFFER	0x40000
+
+// AVI 1.0 file size limit (the index offsets are often read as signed)
+#define AVI_MAX_FILE_SIZE	0x7FFFFFFF
+
+// AVI flags
+#define AVI_HASINDEX		0x00000010
+#define AVI_ISINTERLEAVED	0x00000100
+#define AVI_KEYFRAME		0x00000010
+
+// Chunk IDs
+#define AVI_ID_RIFF	((DWORD)mmioFOURCC('R','I','F','F'))
+#define AVI_ID_AVI	((DWORD)mmioFOURCC('A','V','I',' '))
+#define AVI_ID_LIST	((DWORD)mmioFOURCC('L','I','S','T'))
+#define AVI_ID_HDRL	((DWORD)mmioFOURCC('h','d','r','l'))
+#define AVI_ID_AVIH	((DWORD)mmioFOURCC('a','v','i','h'))
+#define AVI_ID_STRL	((DWORD)mmioFOURCC('s','t','r','l'))
+#define AVI_ID_STRH	((DWORD)mmioFOURCC('s','t','r','h'))
+#define AVI_ID_STRF	((DWORD)mmioFOURCC('s','t','r','f'))
+#define AVI_ID_MOVI	((DWORD)mmioFOURCC('m','o','v','i'))
+#define AVI_ID_IDX1	((DWORD)mmioFOURCC('i','d','x','1'))
+#define AVI_ID_VIDS	((DWORD)mmioFOURCC('v','i','d','s'))
+#define AVI_ID_AUDS	((DWORD)mmioFOURCC('a','u','d','s'))
+#define AVI_ID_00DB	((DWORD)mmioFOURCC('0','0','d','b'))
+#define AVI_ID_01WB	((DWORD)mmioFOURCC('0','1','w','b'))
+#define AVI_ID_YV12	((DWORD)mmioFOURCC('Y','V','1','2'))
+
+#define WAV_ID_WAVE	((DWORD)mmioFOURCC('W','A','V','E'))
+#define WAV_ID_FMT	((DWORD)mmioFOURCC('f','m','t',' '))
+#define WAV_ID_DATA	((DWORD)mmioFOURCC('d','a','t','a'))
+
+#define WAVE_FORMAT_PCM_TAG	1
+
+//==========================================================================
+// File structures (the same layout as the Win32 ones)
+//==========================================================================
+
+#pragma pack(1)
+
+typedef struct tagRIFF_CHUNK_HEADER {
+	DWORD	dwID;		// Chunk ID
+	DWORD	cbSize;		// Chunk data size
+} RIFF_CHUNK_HEADER;
+
+typedef struct tagAVI_MAIN_HEADER {
+	DWORD	dwMicroSecPerFrame;
+	DWORD	dwMaxBytesPerSec;
+	DWORD	dwPaddingGranularity;
+	DWORD	dwFlags;
+	DWORD	dwTotalFrames;
+	DWORD	dwInitialFrames;
+	DWORD	dwStreams;
+	DWORD	dwSuggestedBufferSize;
+	DWORD	dwWidth;
+	DWORD	dwHeight;
+	DWORD	dwReserved[4];
+} AVI_MAIN_HEADER;
+
+typedef struct tagAVI_STREAM_HEADER {
+	DWORD	fccType;
+	DWORD	fccHandler;
+	DWORD	dwFlags;
+	WORD	wPriority;
+	WORD	wLanguage;
+	DWORD	dwInitialFrames;
+	DWORD	dwScale;
+	DWORD	dwRate;
+	DWORD	dwStart;
+	DWORD	dwLength;
+	DWORD	dwSuggestedBufferSize;
+	DWORD	dwQuality;
+	DWORD	dwSampleSize;
+	SHORT	rcFrame[4];
+} AVI_STREAM_HEADER;
+
+typedef struct tagAVI_BITMAP_INFO_HEADER {
+	DWORD	biSize;
+	LONG	biWidth;
+	LONG	biHeight;
+	WORD	biPlanes;
+	WORD	biBitCount;
+	DWORD	biCompression;
+	DWORD	biSizeImage;
+	LONG	biXPelsPerMeter;
+	LONG	biYPelsPerMeter;
+	DWORD	biClrUsed;
+	DWORD	biClrImportant;
+} AVI_BITMAP_INFO_HEADER;
+
+typedef struct tagAVI_WAVE_FORMAT {
+	WORD	wFormatTag;
+	WORD	nChannels;
+	DWORD	nSamplesPerSec;
+	DWORD	nAvgBytesPerSec;
+	WORD	nBlockAlign;
+	WORD	wBitsPerSample;
+	WORD	cbSize;
+} AVI_WAVE_FORMAT;
+
+struct tagAVI_INDEX_ENTRY {
+	DWORD	dwChunkID;
+	DWORD	dwFlags;
+	DWORD	dwChunkOffset;
+	DWORD	dwChunkLength;
+};
+
+// Complete AVI header (up to the "movi" list data)
+typedef struct tagAVI_FILE_HEADER {
+	RIFF_CHUNK_HEADER		riff;
+	DWORD					dwRIFFType;
+	RIFF_CHUNK_HEADER		hdrl;
+	DWORD					dwHdrlType;
+	RIFF_CHUNK_HEADER		avih;
+	AVI_MAIN_HEADER			main;
+	RIFF_CHUNK_HEADER		strlVideo;
+	DWORD					dwStrlVideoType;
+	RIFF_CHUNK_HEADER		strhVideo;
+	AVI_STREAM_HEADER		streamVideo;
+	RIFF_CHUNK_HEADER		strfVideo;
+	AVI_BITMAP_INFO_HEADER	formatVideo;
+	RIFF_CHUNK_HEADER		strlAudio;		// |
+	DWORD					dwStrlAudioType;// |
+	RIFF_CHUNK_HEADER		strhAudio;		// | -- Only if there is audio
+	AVI_STREAM_HEADER		streamAudio;	// |
+	RIFF_CHUNK_HEADER		strfAudio;		// |
+	AVI_WAVE_FORMAT			formatAudio;	// |
+} AVI_FILE_HEADER;
+
+#define AVI_AUDIO_STREAM_HEADERS_SIZE (sizeof(AVI_FILE_HEADER) - offsetof(AVI_FILE_HEADER, strlAudio))
+
+typedef struct tagWAV_FILE_HEADER {
+	RIFF_CHUNK_HEADER	riff;
+	DWORD				dwRIFFType;
+	RIFF_CHUNK_HEADER	fmt;
+	WORD				wFormatTag;
+	WORD				nChannels;
+	DWORD				nSamplesPerSec;
+	DWORD				nAvgBytesPerSec;
+	WORD				nBlockAlign;
+	WORD				wBitsPerSample;
+	RIFF_CHUNK_HEADER	data;
+} WAV_FILE_HEADER;
+
+#pragma pack()
+
+//==========================================================================
+// Helpers
+//==========================================================================
+
+static char* CopyFileName(const char *pszFileName)
+{
+	char *pszCopy = (char*)malloc(strlen(pszFileName) + 1);
+	if (pszCopy)
+		strcpy(pszCopy, pszFileName);
+	return pszCopy;
+}
+
+static HRESULT WriteData(FILE *pFile, const void *pData, DWORD cbData)
+{
+	if ((cbData != 0) && (fwrite(pData, cbData, 1, pFile) != 1))
+		return E_FAIL;
+	return NOERROR;
+}
+
+// Close the output file and remove it if it's incomplete
+static void DiscardOutputFile(FILE **ppFile, char **ppszFileName)
+{
+	if (*ppFile) {
+		fclose(*ppFile);
+		*ppFile = NULL;
+		if (*ppszFileName)
+			remove(*ppszFileName);
+	}
+	if (*ppszFileName) {
+		free(*ppszFileName);
+		*ppszFileName = NULL;
+	}
+}
+
+// Open the output file
+static HRESULT OpenOutputFile(const char *pszFileName, FILE **ppFile, char **ppszFileName)
+{
+	*ppszFileName = CopyFileName(pszFileName);
+	if (*ppszFileName == NULL)
+		return E_OUTOFMEMORY;
+
+	*ppFile = fopen(pszFileName, "wb");
+	if (*ppFile == NULL) {
+		free(*ppszFileName);
+		*ppszFileName = NULL;
+		return E_FAIL;
+	}
+	setvbuf(*ppFile, NULL, _IOFBF, MEDIA_FILE_BUFFER);
+
+	return NOERROR;
+}
+
+// Finish the output file
+static HRESULT FinishOutputFile(FILE **ppFile, char **ppszFileName)
+{
+	HRESULT hr = (fflush(*ppFile) == 0) ? NOERROR : E_FAIL;
+	if (fclose(*ppFile) != 0)
+		hr = E_FAIL;
+	*ppFile = NULL;
+
+	if (FAILED(hr))
+		remove(*ppszFileName);
+	free(*ppszFileName);
+	*ppszFileName = NULL;
+
+	return hr;
+}
+
+static WORD GetBlockAlign(const MEDIA_INFO *pInfo)
+{
+	return (WORD)(pInfo->nChannels * pInfo->wBitsPerSample / 8);
+}
+
+// Convert a decoded frame row to 8-bit R, G, B triples
+static void ConvertRowToRGB(const MEDIA_INFO *pInfo, const GMF_FRAME& frame, DWORD y, BYTE *pbRGB)
+{
+	DWORD dwWidth = pInfo->dwWidth;
+
+	if (pInfo->dwVideoFormat == MEDIA_VIDEO_RGB8) {
+
+		const BYTE *pbRow = frame.pbBuffer + y * dwWidth;
+		const GMF_PALETTE_ENTRY *pPalette = frame.pPalette;
+
+		if (pPalette == NULL) {
+			for (DWORD x = 0; x < dwWidth; x++, pbRGB += 3)
+				pbRGB[0] = pbRGB[1] = pbRGB[2] = pbRow[x];
+			return;
+		}
+
+		for (DWORD x = 0; x < dwWidth; x++, pbRGB += 3) {
+			const GMF_PALETTE_ENTRY *pEntry = &pPalette[pbRow[x]];
+			pbRGB[0] = pEntry->bRed;
+			pbRGB[1] = pEntry->bGreen;
+			pbRGB[2] = pEntry->bBlue;
+		}
+
+	} else if (pInfo->dwVideoFormat == MEDIA_VIDEO_RGB555) {
+
+		const BYTE *pbRow = frame.pbBuffer + y * dwWidth * 2;
+
+		for (DWORD x = 0; x < dwWidth; x++, pbRow += 2, pbRGB += 3) {
+			WORD wPixel = (WORD)(pbRow[0] | (pbRow[1] << 8));
+			BYTE bRed	= (wPixel >> 10) & 0x1F;
+			BYTE bGreen	= (wPixel >> 5) & 0x1F;
+			BYTE bBlue	= wPixel & 0x1F;
+			pbRGB[0] = (bRed << 3) | (bRed >> 2);
+			pbRGB[1] = (bGreen << 3) | (bGreen >> 2);
+			pbRGB[2] = (bBlue << 3) | (bBlue >> 2);
+		}
+	}
+}
+
+// BT.601 studio range RGB to YUV conversion
+#define RGB_TO_Y(r, g, b) ((BYTE)((( 66 * (r) + 129 * (g) +  25 * (b) + 128) >> 8) +  16))
+#define RGB_TO_U(r, g, b) ((BYTE)(((-38 * (r) -  74 * (g) + 112 * (b) + 128) >> 8) + 128))
+#define RGB_TO_V(r, g, b) ((BYTE)(((112 * (r) -  94 * (g) -  18 * (b) + 128) >> 8) + 128))
+
+// Convert a decoded frame to the planar Y, U, V (I420) image. The chroma
+// planes have the dimensions rounded up for the odd-sized frames
+static HRESULT ConvertFrameToI420(const MEDIA_INFO *pInfo, const GMF_FRAME& frame, BYTE *pbImage)
+{
+	DWORD dwWidth		= pInfo->dwWidth;
+	DWORD dwHeight		= pInfo->dwHeight;
+	DWORD dwCWidth		= (dwWidth + 1) / 2;
+	DWORD dwCHeight		= (dwHeight + 1) / 2;
+
+	BYTE *pbY = pbImage;
+	BYTE *pbU = pbY + dwWidth * dwHeight;
+	BYTE *pbV = pbU + dwCWidth * dwCHeight;
+
+	// The planar source only needs the chroma planes swapped
+	if (pInfo->dwVideoFormat == MEDIA_VIDEO_YV12) {
+		DWORD cbCPlane = (dwWidth / 2) * (dwHeight / 2);
+		const BYTE *pbSource = frame.pbBuffer;
+		CopyMemory(pbY, pbSource, dwWidth * dwHeight);
+		pbSource += dwWidth * dwHeight;
+		CopyMemory(pbV, pbSource, cbCPlane);
+		pbSource += cbCPlane;
+		CopyMemory(pbU, pbSource, cbCPlane);
+		return NOERROR;
+	}
+
+	// Convert a pair of rows at a time
+	BYTE *pbRGB = (BYTE*)malloc(2 * dwWidth * 3);
+	if (pbRGB == NULL)
+		return E_OUTOFMEMORY;
+	BYTE *pbRGB0 = pbRGB;
+	BYTE *pbRGB1 = pbRGB + dwWidth * 3;
+
+	for (DWORD y = 0; y < dwHeight; y += 2) {
+
+		BOOL bHasRow1 = (y + 1 < dwHeight);
+		ConvertRowToRGB(pInfo, frame, y, pbRGB0);
+		if (bHasRow1)
+			ConvertRowToRGB(pInfo, frame, y + 1, pbRGB1);
+		else
+			CopyMemory(pbRGB1, pbRGB0, dwWidth * 3);
+
+		BYTE *pbY0 = pbY + y * dwWidth;
+		BYTE *pbY1 = pbY0 + dwWidth;
+		for (DWORD x = 0; x < dwWidth; x++) {
+			const BYTE *p0 = pbRGB0 + 3 * x;
+			const BYTE *p1 = pbRGB1 + 3 * x;
+			pbY0[x] = RGB_TO_Y(p0[0], p0[1], p0[2]);
+			if (bHasRow1)
+				pbY1[x] = RGB_TO_Y(p1[0], p1[1], p1[2]);
+		}
+
+		BYTE *pbURow = pbU + (y / 2) * dwCWidth;
+		BYTE *pbVRow = pbV + (y / 2) * dwCWidth;
+		for (DWORD cx = 0; cx < dwCWidth; cx++) {
+
+			DWORD x0 = 2 * cx;
+			DWORD x1 = (x0 + 1 < dwWidth) ? (x0 + 1) : x0;
+			const BYTE *p00 = pbRGB0 + 3 * x0, *p01 = pbRGB0 + 3 * x1;
+			const BYTE *p10 = pbRGB1 + 3 * x0, *p11 = pbRGB1 + 3 * x1;
+
+			int r = (p00[0] + p01[0] + p10[0] + p11[0] + 2) >> 2;
+			int g = (p00[1] + p01[1] + p10[1] + p11[1] + 2) >> 2;
+			int b = (p00[2] + p01[2] + p10[2] + p11[2] + 2) >> 2;
+			pbURow[cx] = RGB_TO_U(r, g, b);
+			pbVRow[cx] = RGB_TO_V(r, g, b);
+		}
+	}
+
+	free(pbRGB);
+	return NOERROR;
+}
+
+//==========================================================================
+// CWAVWriter methods
+//==========================================================================
+
+CWAVWriter::CWAVWriter() :
+	m_pFile(NULL),
+	m_pszFileName(NULL),
+	m_cbData(0)
+{
+}
+
+CWAVWriter::~CWAVWriter()
+{
+	DiscardOutputFile(&m_pFile, &m_pszFileName);
+}
+
+HRESULT CWAVWriter::Open(const char *pszFileName, const MEDIA_INFO *pInfo)
+{
+	if ((!pInfo->bHasAudio) || (GetBlockAlign(pInfo) == 0))
+		return E_INVALIDARG;
+
+	HRESULT hr = OpenOutputFile(pszFileName, &m_pFile, &m_pszFileName);
+	if (FAILED(hr))
+		return hr;
+
+	// The sizes are set when the file is closed
+	WAV_FILE_HEADER header;
+	header.riff.dwID		= AVI_ID_RIFF;
+	header.riff.cbSize		= 0;
+	header.dwRIFFType		= WAV_ID_WAVE;
+	header.fmt.dwID			= WAV_ID_FMT;
+	header.fmt.cbSize		= 16;
+	header.wFormatTag		= WAVE_FORMAT_PCM_TAG;
+	header.nChannels		= pInfo->nChannels;
+	header.nSamplesPerSec	= pInfo->nSamplesPerSec;
+	header.nBlockAlign		= GetBlockAlign(pInfo);
+	header.nAvgBytesPerSec	= header.nBlockAlign * pInfo->nSamplesPerSec;
+	header.wBitsPerSample	= pInfo->wBitsPerSample;
+	header.data.dwID		= WAV_ID_DATA;
+	header.data.cbSize		= 0;
+
+	m_cbData = 0;
+	return WriteData(m_pFile, &header, sizeof(header));
+}
+
+HRESULT CWAVWriter::WriteAudio(const BYTE *pbData, DWORD cbData)
+{
+	if (m_pFile == NULL)
+		return E_UNEXPECTED;
+
+	// Check the RIFF size limit
+	if (cbData > 0xFFFFFFFF - sizeof(WAV_FILE_HEADER) - 1 - m_cbData)
+		return E_INVALIDARG;
+
+	HRESULT hr = WriteData(m_pFile, pbData, cbData);
+	if (SUCCEEDED(hr))
+		m_cbData += cbData;
+	return hr;
+}
+
+HRESULT CWAVWriter::Close(void)
+{
+	if (m_pFile == NULL)
+		return E_UNEXPECTED;
+
+	// Pad the data chunk
+	HRESULT hr = NOERROR;
+	if (m_cbData % 2)
+		hr = WriteData(m_pFile, "", 1);
+
+	// Patch the chunk sizes
+	DWORD cbRIFF = sizeof(WAV_FILE_HEADER) - sizeof(RIFF_CHUNK_HEADER) + m_cbData + (m_cbData % 2);
+	if (
+		(SUCCEEDED(hr)) &&
+		(
+			(fseek(m_pFile, offsetof(WAV_FILE_HEADER, riff.cbSize), SEEK_SET) != 0) ||
+			(FAILED(WriteData(m_pFile, &cbRIFF, sizeof(cbRIFF)))) ||
+			(fseek(m_pFile, offsetof(WAV_FILE_HEADER, data.cbSize), SEEK_SET) != 0) ||
+			(FAILED(WriteData(m_pFile, &m_cbData, sizeof(m_cbData))))
+		)
+	)
+		hr = E_FAIL;
+
+	if (FAILED(hr)) {
+		DiscardOutputFile(&m_pFile, &m_pszFileName);
+		return hr;
+	}
+
+	return FinishOutputFile(&m_pFile, &m_pszFileName);
+}
+
+//==========================================================================
+// CAVIWriter methods
+//==========================================================================
+
+CAVIWriter::CAVIWriter() :
+	m_pFile(NULL),
+	m_pszFileName(NULL),
+	m_pbFrame(NULL),
+	m_cbFrame(0),
+	m_pIndex(NULL),
+	m_nIndexEntries(0),
+	m_nMaxIndexEntries(0),
+	m_dwMoviPosition(0),
+	m_cbMovi(0),
+	m_nFrames(0),
+	m_cbAudio(0)
+{
+	ZeroMemory(&m_Info, sizeof(m_Info));
+}
+
+CAVIWriter::~CAVIWriter()
+{
+	DiscardOutputFile(&m_pFile, &m_pszFileName);
+	if (m_pbFrame)
+		free(m_pbFrame);
+	if (m_pIndex)
+		free(m_pIndex);
+}
+
+HRESULT CAVIWriter::WriteHeaders(void)
+{
+	AVI_FILE_HEADER header;
+	ZeroMemory(&header, sizeof(header));
+
+	BOOL bHasAudio = m_Info.bHasAudio;
+	DWORD cbHeader = sizeof(header) - ((bHasAudio) ? 0 : AVI_AUDIO_STREAM_HEADERS_SIZE);
+	DWORD cbIndex = m_nIndexEntries * sizeof(AVI_INDEX_ENTRY);
+	WORD nBlockAlign = GetBlockAlign(&m_Info);
+
+	header.riff.dwID		= AVI_ID_RIFF;
+	header.riff.cbSize		=
+		cbHeader - sizeof(RIFF_CHUNK_HEADER) +		// Headers
+		sizeof(RIFF_CHUNK_HEADER) + sizeof(DWORD) +	// "movi" list header
+		m_cbMovi +									// "movi" list data
+		sizeof(RIFF_CHUNK_HEADER) + cbIndex;		// Index
+	header.dwRIFFType		= AVI_ID_AVI;
+
+	header.hdrl.dwID		= AVI_ID_LIST;
+	header.hdrl.cbSize		= cbHeader - offsetof(AVI_FILE_HEADER, dwHdrlType);
+	header.dwHdrlType		= AVI_ID_HDRL;
+
+	// Main header
+	header.avih.dwID					= AVI_ID_AVIH;
+	header.avih.cbSize					= sizeof(AVI_MAIN_HEADER);
+	header.main.dwMicroSecPerFrame		= (DWORD)(((LONGLONG)1000000 * m_Info.dwScale) / m_Info.dwRate);
+	header.main.dwFlags					= AVI_HASINDEX | AVI_ISINTERLEAVED;
+	header.main.dwTotalFrames			= m_nFrames;
+	header.main.dwStreams				= (bHasAudio) ? 2 : 1;
+	header.main.dwSuggestedBufferSize	= m_cbFrame;
+	header.main.dwWidth					= m_Info.dwWidth;
+	header.main.dwHeight				= m_Info.dwHeight;
+	header.main.dwMaxBytesPerSec		= (DWORD)(
+		((LONGLONG)m_cbFrame * m_Info.dwRate) / m_Info.dwScale +
+		((bHasAudio) ? nBlockAlign * m_Info.nSamplesPerSec : 0)
+	);
+
+	// Video stream
+	header.strlVideo.dwID			= AVI_ID_LIST;
+	header.strlVideo.cbSize			= offsetof(AVI_FILE_HEADER, strlAudio) - offsetof(AVI_FILE_HEADER, dwStrlVideoType);
+	header.dwStrlVideoType			= AVI_ID_STRL;
+	header.strhVideo.dwID			= AVI_ID_STRH;
+	header.strhVideo.cbSize			= sizeof(AVI_STREAM_HEADER);
+	header.streamVideo.fccType		= AVI_ID_VIDS;
+	header.streamVideo.dwScale		= m_Info.dwScale;
+	header.streamVideo.dwRate		= m_Info.dwRate;
+	header.streamVideo.dwLength		= m_nFrames;
+	header.streamVideo.dwSuggestedBufferSize	= m_cbFrame;
+	header.streamVideo.dwQuality	= 0xFFFFFFFF;
+	header.streamVideo.rcFrame[2]	= (SHORT)m_Info.dwWidth;
+	header.streamVideo.rcFrame[3]	= (SHORT)m_Info.dwHeight;
+	header.strfVideo.dwID			= AVI_ID_STRF;
+	header.strfVideo.cbSize			= sizeof(AVI_BITMAP_INFO_HEADER);
+	header.formatVideo.biSize		= sizeof(AVI_BITMAP_INFO_HEADER);
+	header.formatVideo.biWidth		= (LONG)m_Info.dwWidth;
+	header.formatVideo.biHeight		= (LONG)m_Info.dwHeight;
+	header.formatVideo.biPlanes		= 1;
+	header.formatVideo.biSizeImage	= m_cbFrame;
+	if (m_Info.dwVideoFormat == MEDIA_VIDEO_YV12) {
+		header.streamVideo.fccHandler		= AVI_ID_YV12;
+		header.formatVideo.biBitCount		= 12;
+		header.formatVideo.biCompression	= AVI_ID_YV12;
+	} else
+		header.formatVideo.biBitCount		= 24;
+
+	// Audio stream
+	if (bHasAudio) {
+		header.strlAudio.dwID			= AVI_ID_LIST;
+		header.strlAudio.cbSize			= sizeof(AVI_FILE_HEADER) - offsetof(AVI_FILE_HEADER, dwStrlAudioType);
+		header.dwStrlAudioType			= AVI_ID_STRL;
+		header.strhAudio.dwID			= AVI_ID_STRH;
+		header.strhAudio.cbSize			= sizeof(AVI_STREAM_HEADER);
+		header.streamAudio.fccType		= AVI_ID_AUDS;
+		header.streamAudio.dwScale		= nBlockAlign;
+		header.streamAudio.dwRate		= nBlockAlign * m_Info.nSamplesPerSec;
+		header.streamAudio.dwLength		= m_cbAudio / nBlockAlign;
+		header.streamAudio.dwSuggestedBufferSize	= nBlockAlign * m_Info.nSamplesPerSec;
+		header.streamAudio.dwQuality	= 0xFFFFFFFF;
+		header.streamAudio.dwSampleSize	= nBlockAlign;
+		header.strfAudio.dwID			= AVI_ID_STRF;
+		header.strfAudio.cbSize			= sizeof(AVI_WAVE_FORMAT);
+		header.formatAudio.wFormatTag		= WAVE_FORMAT_PCM_TAG;
+		header.formatAudio.nChannels		= m_Info.nChannels;
+		header.formatAudio.nSamplesPerSec	= m_Info.nSamplesPerSec;
+		header.formatAudio.nAvgBytesPerSec	= nBlockAlign * m_Info.nSamplesPerSec;
+		header.formatAudio.nBlockAlign		= nBlockAlign;
+		header.formatAudio.wBitsPerSample	= m_Info.wBitsPerSample;
+	}
+
+	// "movi" list header
+	RIFF_CHUNK_HEADER movi;
+	movi.dwID	= AVI_ID_LIST;
+	movi.cbSize	= sizeof(DWORD) + m_cbMovi;
+	DWORD dwMoviType = AVI_ID_MOVI;
+
+	if (fseek(m_pFile, 0, SEEK_SET) != 0)
+		return E_FAIL;
+	if (
+		(FAILED(WriteData(m_pFile, &header, cbHeader)))		||
+		(FAILED(WriteData(m_pFile, &movi, sizeof(movi))))	||
+		(FAILED(WriteData(m_pFile, &dwMoviType, sizeof(dwMoviType))))
+	)
+		return E_FAIL;
+
+	m_dwMoviPosition = cbHeader + sizeof(movi);
+
+	return NOERROR;
+}
+
+HRESULT CAVIWriter::Open(const char *pszFileName, const MEDIA_INFO *pInfo)
+{
+	if (
+		(pInfo->dwWidth == 0)	|| (pInfo->dwWidth > 0x7FFF)	||
+		(pInfo->dwHeight == 0)	|| (pInfo->dwHeight > 0x7FFF)	||
+		(pInfo->dwRate == 0)	|| (pInfo->dwScale == 0)
+	)
+		return E_INVALIDARG;
+
+	m_Info = *pInfo;
+	if ((m_Info.bHasAudio) && (GetBlockAlign(&m_Info) == 0))
+		m_Info.bHasAudio = FALSE;
+
+	// Converted frame buffer (DIB rows are DWORD-aligned)
+	m_cbFrame = (m_Info.dwVideoFormat == MEDIA_VIDEO_YV12)
+		? (m_Info.dwWidth * m_Info.dwHeight * 3) / 2
+		: ((m_Info.dwWidth * 3 + 3) & ~3) * m_Info.dwHeight;
+	m_pbFrame = (BYTE*)malloc(m_cbFrame);
+	if (m_pbFrame == NULL)
+		return E_OUTOFMEMORY;
+	ZeroMemory(m_pbFrame, m_cbFrame);
+
+	HRESULT hr = OpenOutputFile(pszFileName, &m_pFile, &m_pszFileName);
+	if (FAILED(hr))
+		return hr;
+
+	m_nIndexEntries	= 0;
+	m_cbMovi		= 0;
+	m_nFrames		= 0;
+	m_cbAudio		= 0;
+
+	// Write the headers with zero sizes (they're rewritten on Close())
+	return WriteHeaders();
+}
+
+HRESULT CAVIWriter::WriteChunk(DWORD dwID, const BYTE *pbData, DWORD cbData, DWORD dwFlags)
+{
+	if (m_pFile == NULL)
+		return E_UNEXPECTED;
+
+	DWORD cbChunk = sizeof(RIFF_CHUNK_HEADER) + cbData + (cbData % 2);
+
+	// Check the file size limit (taking the index into account)
+	LONGLONG llFileSize =
+		(LONGLONG)m_dwMoviPosition + sizeof(DWORD) + m_cbMovi + cbChunk +
+		sizeof(RIFF_CHUNK_HEADER) + (LONGLONG)(m_nIndexEntries + 1) * sizeof(AVI_INDEX_ENTRY);
+	if (llFileSize > AVI_MAX_FILE_SIZE)
+		return E_INVALIDARG;
+
+	// Grow the index
+	if (m_nIndexEntries == m_nMaxIndexEntries) {
+		DWORD nMaxIndexEntries = (m_nMaxIndexEntries) ? (m_nMaxIndexEntries * 2) : 1024;
+		AVI_INDEX_ENTRY *pIndex = (AVI_INDEX_ENTRY*)realloc(m_pIndex, nMaxIndexEntries * sizeof(AVI_INDEX_ENTRY));
+		if (pIndex == NULL)
+			return E_OUTOFMEMORY;
+		m_pIndex = pIndex;
+		m_nMaxIndexEntries = nMaxIndexEntries;
+	}
+
+	RIFF_CHUNK_HEADER header;
+	header.dwID		= dwID;
+	header.cbSize	= cbData;
+	if (
+		(FAILED(WriteData(m_pFile, &header, sizeof(header))))	||
+		(FAILED(WriteData(m_pFile, pbData, cbData)))			||
+		((cbData % 2) && (FAILED(WriteData(m_pFile, "", 1))))
+	)
+		return E_FAIL;
+
+	// Index offsets are relative to the "movi" list type
+	AVI_INDEX_ENTRY *pEntry = &m_pIndex[m_nIndexEntries++];
+	pEntry->dwChunkID		= dwID;
+	pEntry->dwFlags			= dwFlags;
+	pEntry->dwChunkOffset	= sizeof(DWORD) + m_cbMovi;
+	pEntry->dwChunkLength	= cbData;
+
+	m_cbMovi += cbChunk;
+
+	return NOERROR;
+}
+
+HRESULT CAVIWriter::WriteVideoFrame(const GMF_FRAME& frame)
+{
+	if (m_Info.dwVideoFormat == MEDIA_VIDEO_YV12) {
+
+		// YV12 goes to the file as is
+		if (frame.cbData < m_cbFrame)
+			return E_INVALIDARG;
+		CopyMemory(m_pbFrame, frame.pbBuffer, m_cbFrame);
+
+	} else {
+
+		// Bottom-up BGR rows
+		DWORD cbStride = (m_Info.dwWidth * 3 + 3) & ~3;
+		for (DWORD y = 0; y < m_Info.dwHeight; y++) {
+			BYTE *pbRow = m_pbFrame + (m_Info.dwHeight - 1 - y) * cbStride;
+			ConvertRowToRGB(&m_Info, frame, y, pbRow);
+			for (DWORD x = 0; x < m_Info.dwWidth; x++, pbRow += 3) {
+				BYTE bRed = pbRow[0];
+				pbRow[0] = pbRow[2];
+				pbRow[2] = bRed;
+			}
+		}
+	}
+
+	HRESULT hr = WriteChunk(AVI_ID_00DB, m_pbFrame, m_cbFrame, AVI_KEYFRAME);
+	if (SUCCEEDED(hr))
+		m_nFrames++;
+	return hr;
+}
+
+HRESULT CAVIWriter::WriteAudio(const BYTE *pbData, DWORD cbData)
+{
+	if ((!m_Info.bHasAudio) || (cbData == 0))
+		return NOERROR;
+
+	HRESULT hr = WriteChunk(AVI_ID_01WB, pbData, cbData, AVI_KEYFRAME);
+	if (SUCCEEDED(hr))
+		m_cbAudio += cbData;
+	return hr;
+}
+
+HRESULT CAVIWriter::Close(void)
+{
+	if (m_pFile == NULL)
+		return E_UNEXPECTED;
+
+	// Write the index and rewrite the headers with the final sizes
+	RIFF_CHUNK_HEADER header;
+	header.dwID		= AVI_ID_IDX1;
+	header.cbSize	= m_nIndexEntries * sizeof(AVI_INDEX_ENTRY);
+	if (
+		(FAILED(WriteData(m_pFile, &header, sizeof(header))))						||
+		(FAILED(WriteData(m_pFile, m_pIndex, header.cbSize)))						||
+		(FAILED(WriteHeaders()))
+	) {
+		DiscardOutputFile(&m_pFile, &m_pszFileName);
+		return E_FAIL;
+	}
+
+	return FinishOutputFile(&m_pFile, &m_pszFileName);
+}
+
+//==========================================================================
+// CY4MWriter methods
+//==========================================================================
+
+CY4MWriter::CY4MWriter() :
+	m_pFile(NULL),
+	m_pszFileName(NULL),
+	m_pAudioWriter(NULL),
+	m_pbFrame(NULL),
+	m_cbFrame(0)
+{
+	ZeroMemory(&m_Info, sizeof(m_Info));
+}
+
+CY4MWriter::~CY4MWriter()
+{
+	DiscardOutputFile(&m_pFile, &m_pszFileName);
+	if (m_pAudioWriter)
+		delete m_pAudioWriter;
+	if (m_pbFrame)
+		free(m_pbFrame);
+}
+
+HRESULT CY4MWriter::Open(const char *pszFileName, const MEDIA_INFO *pInfo)
+{
+	if (
+		(pInfo->dwWidth == 0)	||
+		(pInfo->dwHeight == 0)	||
+		(pInfo->dwRate == 0)	||
+		(pInfo->dwScale == 0)	||
+		// Planar source chroma can't be rounded up
+		((pInfo->dwVideoFormat == MEDIA_VIDEO_YV12) && ((pInfo->dwWidth % 2) || (pInfo->dwHeight % 2)))
+	)
+		return E_INVALIDARG;
+
+	m_Info = *pInfo;
+
+	m_cbFrame =
+		m_Info.dwWidth * m_Info.dwHeight +
+		2 * ((m_Info.dwWidth + 1) / 2) * ((m_Info.dwHeight + 1) / 2);
+	m_pbFrame = (BYTE*)malloc(m_cbFrame);
+	if (m_pbFrame == NULL)
+		return E_OUTOFMEMORY;
+
+	HRESULT hr = OpenOutputFile(pszFileName, &m_pFile, &m_pszFileName);
+	if (FAILED(hr))
+		return hr;
+
+	if (
+		fprintf(
+			m_pFile,
+			"YUV4MPEG2 W%lu H%lu F%lu:%lu Ip A1:1 C420jpeg\n",
+			(unsigned long)m_Info.dwWidth,
+			(unsigned long)m_Info.dwHeight,
+			(unsigned long)m_Info.dwRate,
+			(unsigned long)m_Info.dwScale
+		) < 0
+	)
+		return E_FAIL;
+
+	// The soundtrack goes to the WAV file with the same name
+	if ((m_Info.bHasAudio) && (GetBlockAlign(&m_Info) != 0)) {
+
+		char *pszAudioFileName = (char*)malloc(strlen(pszFileName) + 5);
+		if (pszAudioFileName == NULL)
+			return E_OUTOFMEMORY;
+		strcpy(pszAudioFileName, pszFileName);
+
+		char *pszExtension = strrchr(pszAudioFileName, '.');
+		char *pszSeparator = strrchr(pszAudioFileName, '/');
+#ifdef _WIN32
+		if ((pszSeparator == NULL) || (strrchr(pszAudioFileName, '\\') > pszSeparator))
+			pszSeparator = strrchr(pszAudioFileName, '\\');
+#endif
+		if ((pszExtension == NULL) || ((pszSeparator != NULL) && (pszExtension < pszSeparator)))
+			pszExtension = pszAudioFileName + strlen(pszAudioFileName);
+		strcpy(pszExtension, ".wav");
+
+		m_pAudioWriter = new CWAVWriter();
+		hr = m_pAudioWriter->Open(pszAudioFileName, &m_Info);
+		free(pszAudioFileName);
+		if (FAILED(hr))
+			return hr;
+	}
+
+	return NOERROR;
+}
+
+HRESULT CY4MWriter::WriteVideoFrame(const GMF_FRAME& frame)
+{
+	if (m_pFile == NULL)
+		return E_UNEXPECTED;
+
+	HRESULT hr = ConvertFrameToI420(&m_Info, frame, m_pbFrame);
+	if (FAILED(hr))
+		return hr;
+
+	if (
+		(FAILED(WriteData(m_pFile, "FRAME\n", 6))) ||
+		(FAILED(WriteData(m_pFile, m_pbFrame, m_cbFrame)))
+	)
+		return E_FAIL;
+
+	return NOERROR;
+}
+
+HRESULT CY4MWriter::WriteAudio(const BYTE *pbData, DWORD cbData)
+{
+	if (m_pAudioWriter == NULL)
+		return NOERROR;
+
+	return m_pAudioWriter->WriteAudio(pbData, cbData);
+}
+
+HRESULT CY4MWriter::Close(void)
+{
+	if (m_pFile == NULL)
+		return E_UNEXPECTED;
+
+	// Finish the soundtrack first, so that a failure removes both files
+	if (m_pAudioWriter != NULL) {
+		HRESULT hr = m_pAudioWriter->Close();
+		if (FAILED(hr)) {
+			DiscardOutputFile(&m_pFile, &m_pszFileName);
+			return hr;
+		}
+	}
+
+	return FinishOutputFile(&m_pFile, &m_pszFileName);
+}
@@ -0,0 +1,144 @@
+//==========================================================================
+//
+// File: MediaWriters.h
+//
+// Desc: Game Media Formats - Header file for raw AVI/WAV/Y4M file writers
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#ifndef __GMF_MEDIA_WRITERS_H__
+#define __GMF_MEDIA_WRITERS_H__
+
+#include "MediaReaders.h"
+
+//==========================================================================
+// Base media writer class. The writer takes the decoded frames in the
+// format given by MEDIA_INFO and converts them to its own format.
+// Close() must be called to finish the file; if the writer is deleted
+// without it (or Close() fails) the output files are removed
+//==========================================================================
+
+class CMediaWriter {
+
+public:
+
+	virtual ~CMediaWriter() {};
+
+	virtual HRESULT Open(const char *pszFileName, const MEDIA_INFO *pInfo) = 0;
+	virtual HRESULT WriteVideoFrame(const GMF_FRAME& frame) = 0;
+	virtual HRESULT WriteAudio(const BYTE *pbData, DWORD cbData) = 0;
+	virtual HRESULT Close(void) = 0;
+
+	// Output file name extension (without the dot)
+	virtual const char* GetExtension(void) = 0;
+};
+
+//==========================================================================
+// WAV writer (PCM data only, video frames are dropped)
+//==========================================================================
+
+class CWAVWriter : public CMediaWriter {
+
+	FILE	*m_pFile;		// Output file
+	char	*m_pszFileName;	// Output file name (to remove it on failure)
+	DWORD	m_cbData;		// PCM data written so far
+
+public:
+
+	CWAVWriter();
+	~CWAVWriter();
+
+	HRESULT Open(const char *pszFileName, const MEDIA_INFO *pInfo);
+	HRESULT WriteVideoFrame(const GMF_FRAME& frame) { return NOERROR; };
+	HRESULT WriteAudio(const BYTE *pbData, DWORD cbData);
+	HRESULT Close(void);
+	const char* GetExtension(void) { return "wav"; };
+};
+
+//==========================================================================
+// Raw AVI writer: uncompressed 24-bit RGB video (YV12 for the planar
+// sources) and PCM audio, chunks in the order they come from the
+// decoders. This is AVI 1.0, so the file size is limited to 2 GB
+//==========================================================================
+
+typedef struct tagAVI_INDEX_ENTRY AVI_INDEX_ENTRY;
+
+class CAVIWriter : public CMediaWriter {
+
+	FILE		*m_pFile;			// Output file
+	char		*m_pszFileName;		// Output file name (to remove it on failure)
+	MEDIA_INFO	m_Info;				// Source media properties
+
+	BYTE		*m_pbFrame;			// Converted frame buffer
+	DWORD		m_cbFrame;			// Converted frame size
+
+	AVI_INDEX_ENTRY	*m_pIndex;		// Chunk index
+	DWORD		m_nIndexEntries;	// Number of index entries
+	DWORD		m_nMaxIndexEntries;	// Allocated index entries
+
+	DWORD		m_dwMoviPosition;	// File position of the "movi" list
+	DWORD		m_cbMovi;			// "movi" list data size so far
+	DWORD		m_nFrames;			// Video frames written
+	DWORD		m_cbAudio;			// Audio data written
+
+	// Write (or rewrite) the file headers up to the "movi" list data
+	HRESULT WriteHeaders(void);
+
+	HRESULT WriteChunk(DWORD dwID, const BYTE *pbData, DWORD cbData, DWORD dwFlags);
+
+public:
+
+	CAVIWriter();
+	~CAVIWriter();
+
+	HRESULT Open(const char *pszFileName, const MEDIA_INFO *pInfo);
+	HRESULT WriteVideoFrame(const GMF_FRAME& frame);
+	HRESULT WriteAudio(const BYTE *pbData, DWORD cbData);
+	HRESULT Close(void);
+	const char* GetExtension(void) { return "avi"; };
+};
+
+//==========================================================================
+// YUV4MPEG2 writer: 4:2:0 video in the given file and PCM audio
+// (if any) in a WAV file with the same name
+//==========================================================================
+
+class CY4MWriter : public CMediaWriter {
+
+	FILE		*m_pFile;			// Output file
+	char		*m_pszFileName;		// Output file name (to remove it on failure)
+	MEDIA_INFO	m_Info;				// Source media properties
+	CWAVWriter	*m_pAudioWriter;	// Soundtrack writer
+
+	BYTE		*m_pbFrame;			// Converted frame buffer
+	DWORD		m_cbFrame;			// Converted frame size
+
+public:
+
+	CY4MWriter();
+	~CY4MWriter();
+
+	HRESULT Open(const char *pszFileName, const MEDIA_INFO *pInfo);
+	HRESULT WriteVideoFrame(const GMF_FRAME& frame);
+	HRESULT WriteAudio(const BYTE *pbData, DWORD cbData);
+	HRESULT Close(void);
+	const char* GetExtension(void) { return "y4m"; };
+};
+
+#endif
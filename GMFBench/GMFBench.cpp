@@ -0,0 +1,607 @@
+//==========================================================================
+//
+// File: GMFBench.cpp
+//
+// Desc: Game Media Formats - Decoder microbenchmark
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#include <stdio.h>
+
+#ifndef _WIN32
+#include <time.h>
+#endif
+
+#include "StreamGenerators.h"
+#include "VQAVideoDecoder.h"
+#include "ROQVideoDecoder.h"
+#include "MVEVideoDecoder.h"
+#include "CINVideoDecoder.h"
+#include "ContinuousIMAADPCMDecoder.h"
+#include "ROQADPCMDecoder.h"
+#include "MVEADPCMDecoder.h"
+#include "WSADPCMDecoder.h"
+
+//==========================================================================
+// Timer
+//==========================================================================
+
+static double GetTime(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER liCounter, liFrequency;
+	QueryPerformanceCounter(&liCounter);
+	QueryPerformanceFrequency(&liFrequency);
+	return (double)liCounter.QuadPart / (double)liFrequency.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+//==========================================================================
+// Decoder creation functions. Each one sets up the decoder format
+// from the stream format block and allocates the decoder buffers
+//==========================================================================
+
+// Number of threads decoding the frame (for the decoders which can
+// split the frame)
+static DWORD g_nDecodeThreads = 1;
+
+static CBaseDecoder* CreateVQADecoder(const CGenStream *pStream, HRESULT *phr)
+{
+	CVQAVideoDecoder *pDecoder = new CVQAVideoDecoder();
+	pDecoder->SetThreadCount(g_nDecodeThreads);
+	*phr = pDecoder->SetFormat((const VQA_INFO*)pStream->GetFormat(), pStream->GetFormatSize());
+	if (SUCCEEDED(*phr))
+		*phr = pDecoder->Initialize();
+	return pDecoder;
+}
+
+static CBaseDecoder* CreateROQDecoder(const CGenStream *pStream, HRESULT *phr)
+{
+	CROQVideoDecoder *pDecoder = new CROQVideoDecoder();
+	*phr = pDecoder->SetFormat((const ROQ_VIDEO_FORMAT*)pStream->GetFormat(), pStream->GetFormatSize());
+	if (SUCCEEDED(*phr))
+		*phr = pDecoder->Initialize();
+	return pDecoder;
+}
+
+static CBaseDecoder* CreateMVEDecoder(const CGenStream *pStream, HRESULT *phr)
+{
+	CMVEVideoDecoder *pDecoder = new CMVEVideoDecoder();
+	*phr = pDecoder->SetFormat((const MVE_VIDEO_INFO*)pStream->GetFormat(), pStream->GetFormatSize());
+	if (SUCCEEDED(*phr))
+		*phr = pDecoder->Initialize();
+	return pDecoder;
+}
+
+static CBaseDecoder* CreateCINDecoder(const CGenStream *pStream, HRESULT *phr)
+{
+	CCINVideoDecoder *pDecoder = new CCINVideoDecoder();
+	*phr = pDecoder->SetFormat((const CIN_HEADER*)pStream->GetFormat(), pStream->GetFormatSize());
+	return pDecoder;
+}
+
+static CBaseDecoder* CreateCIMAADPCMDecoder(const CGenStream *pStream, HRESULT *phr)
+{
+	CCIMAADPCMDecoder *pDecoder = new CCIMAADPCMDecoder();
+	*phr = pDecoder->SetFormat((const CIMAADPCMWAVEFORMAT*)pStream->GetFormat(), pStream->GetFormatSize());
+	if (SUCCEEDED(*phr))
+		*phr = pDecoder->Initialize();
+	return pDecoder;
+}
+
+static CBaseDecoder* CreateROQADPCMDecoder(const CGenStream *pStream, HRESULT *phr)
+{
+	CROQADPCMDecoder *pDecoder = new CROQADPCMDecoder();
+	*phr = pDecoder->SetFormat((const ROQADPCMWAVEFORMAT*)pStream->GetFormat(), pStream->GetFormatSize());
+	return pDecoder;
+}
+
+static CBaseDecoder* CreateMVEADPCMDecoder(const CGenStream *pStream, HRESULT *phr)
+{
+	CMVEADPCMDecoder *pDecoder = new CMVEADPCMDecoder();
+	*phr = pDecoder->SetFormat((const MVE_AUDIO_INFO*)pStream->GetFormat(), pStream->GetFormatSize());
+	return pDecoder;
+}
+
+static CBaseDecoder* CreateWSADPCMDecoder(const CGenStream *pStream, HRESULT *phr)
+{
+	CWSADPCMDecoder *pDecoder = new CWSADPCMDecoder();
+	*phr = pDecoder->SetFormat((const WSADPCMWAVEFORMAT*)pStream->GetFormat(), pStream->GetFormatSize());
+	return pDecoder;
+}
+
+//==========================================================================
+// Codecs table
+//==========================================================================
+
+typedef HRESULT (*PFN_GENERATE_STREAM)(CGenStream *pStream, const GEN_PARAMS *pParams);
+typedef CBaseDecoder* (*PFN_CREATE_DECODER)(const CGenStream *pStream, HRESULT *phr);
+
+typedef struct tagBENCH_CODEC {
+	const char			*pszName;		// Codec name (as given in the command line)
+	const char			*pszDesc;		// Codec description
+	BOOL				bIsVideo;		// Is it a video codec?
+	DWORD				cbSample;		// Output sample size (audio only)
+	PFN_GENERATE_STREAM	pfnGenerate;	// Stream generator
+	PFN_CREATE_DECODER	pfnCreate;		// Decoder creation function
+} BENCH_CODEC;
+
+static const BENCH_CODEC g_Codecs[] = {
+	{ "vqa8",		"VQA v2 8-bit, 4x2 blocks (VPTZ)",		TRUE,	0,	GenerateVQA8Stream,			CreateVQADecoder		},
+	{ "vqa16",		"VQA v3 hi-color, 4x4 blocks (VPRZ)",	TRUE,	0,	GenerateVQA16Stream,		CreateVQADecoder		},
+	{ "roq",		"ROQ video (YV12 output)",				TRUE,	0,	GenerateROQStream,			CreateROQDecoder		},
+	{ "mve8",		"MVE 8-bit video",						TRUE,	0,	GenerateMVE8Stream,			CreateMVEDecoder		},
+	{ "mve16",		"MVE hi-color video",					TRUE,	0,	GenerateMVE16Stream,		CreateMVEDecoder		},
+	{ "cin",		"CIN Huffman video",					TRUE,	0,	GenerateCINStream,			CreateCINDecoder		},
+	{ "cima",		"Continuous IMA ADPCM, stereo",			FALSE,	2,	GenerateCIMAADPCMStream,	CreateCIMAADPCMDecoder	},
+	{ "roqadpcm",	"ROQ DPCM, stereo",						FALSE,	2,	GenerateROQADPCMStream,		CreateROQADPCMDecoder	},
+	{ "mveadpcm",	"MVE DPCM, stereo",						FALSE,	2,	GenerateMVEADPCMStream,		CreateMVEADPCMDecoder	},
+	{ "wsadpcm",	"WS ADPCM, mono 8-bit",					FALSE,	1,	GenerateWSADPCMStream,		CreateWSADPCMDecoder	}
+};
+
+#define BENCH_CODECS (sizeof(g_Codecs) / sizeof(g_Codecs[0]))
+
+//==========================================================================
+// Benchmark result
+//==========================================================================
+
+typedef struct tagBENCH_RESULT {
+	const BENCH_CODEC	*pCodec;		// Codec benchmarked
+	DWORD				dwWidth;		// Actual frame width (0 for audio)
+	DWORD				dwHeight;		// Actual frame height (0 for audio)
+	DWORD				nFrames;		// Frames decoded in the timed passes
+	DWORD				nErrors;		// Decode() failures
+	double				dInputBytes;	// Input bytes consumed in the timed passes
+	double				dOutputUnits;	// Pixels (video) or samples (audio) produced
+	double				dSeconds;		// Total decoding time
+	double				dLatency50;		// Median frame latency (seconds)
+	double				dLatency99;		// 99th percentile frame latency (seconds)
+} BENCH_RESULT;
+
+static int CompareDoubles(const void *pA, const void *pB)
+{
+	double dA = *(const double*)pA, dB = *(const double*)pB;
+	return (dA < dB) ? -1 : ((dA > dB) ? 1 : 0);
+}
+
+// Nearest-rank percentile of the sorted array
+static double GetPercentile(const double *pdValues, DWORD nValues, DWORD dwPercent)
+{
+	if (nValues == 0)
+		return 0.0;
+	DWORD iRank = (nValues * dwPercent + 99) / 100;
+	return pdValues[(iRank > 0) ? iRank - 1 : 0];
+}
+
+//==========================================================================
+// Benchmark run. A frame is the run of data blocks up to (and including)
+// the one the decoder returns S_OK for, so the codebook/palette/map
+// blocks are timed along with the frame they belong to
+//==========================================================================
+
+static HRESULT RunBenchmark(
+	const BENCH_CODEC *pCodec,
+	const GEN_PARAMS *pParams,
+	DWORD nWarmupPasses,
+	DWORD nPasses,
+	BENCH_RESULT *pResult
+)
+{
+	ZeroMemory(pResult, sizeof(BENCH_RESULT));
+	pResult->pCodec = pCodec;
+
+	// Generate the stream (not timed)
+	CGenStream stream;
+	HRESULT hr = pCodec->pfnGenerate(&stream, pParams);
+	if (FAILED(hr))
+		return hr;
+	pResult->dwWidth	= stream.GetWidth();
+	pResult->dwHeight	= stream.GetHeight();
+
+	// Create the decoder
+	CBaseDecoder *pDecoder = pCodec->pfnCreate(&stream, &hr);
+	if (pDecoder == NULL)
+		return E_OUTOFMEMORY;
+	if (FAILED(hr)) {
+		delete pDecoder;
+		return hr;
+	}
+
+	// Allocate the output buffer large enough for any block
+	DWORD cbOutput = 0;
+	for (DWORD i = 0; i < stream.GetBlockCount(); i++) {
+		DWORD cbMax = pDecoder->GetMaxOutputSize(stream.GetBlockSize(i));
+		if (cbMax > cbOutput)
+			cbOutput = cbMax;
+	}
+	BYTE *pbOutput = (BYTE*)malloc(cbOutput);
+	double *pdLatency = (double*)malloc((stream.GetBlockCount() * nPasses + 1) * sizeof(double));
+	if ((pbOutput == NULL) || (pdLatency == NULL)) {
+		free(pbOutput);
+		free(pdLatency);
+		delete pDecoder;
+		return E_OUTOFMEMORY;
+	}
+
+	for (DWORD iPass = 0; iPass < nWarmupPasses + nPasses; iPass++) {
+
+		BOOL bIsTimed = (iPass >= nWarmupPasses);
+		DWORD iFrame = 0;
+
+		// Each pass starts over from the first frame
+		pDecoder->Reset();
+
+		double dStart = GetTime();
+		for (DWORD i = 0; i < stream.GetBlockCount(); i++) {
+
+			GMF_FRAME frame;
+			ZeroMemory(&frame, sizeof(frame));
+			frame.pbBuffer		= pbOutput;
+			frame.cbBuffer		= cbOutput;
+			frame.pbPrevious	= (pCodec->bIsVideo) ? pbOutput : NULL;
+			frame.iFrame		= iFrame;
+
+			hr = pDecoder->Decode(stream.GetBlock(i), stream.GetBlockSize(i), frame);
+			if (FAILED(hr)) {
+				if (bIsTimed)
+					pResult->nErrors++;
+				continue;
+			}
+			if (hr != S_OK)
+				continue;
+
+			double dEnd = GetTime();
+			if (bIsTimed) {
+				pdLatency[pResult->nFrames++] = dEnd - dStart;
+				pResult->dSeconds += dEnd - dStart;
+				pResult->dOutputUnits += (pCodec->bIsVideo)
+					? (double)stream.GetWidth() * (double)stream.GetHeight()
+					: (double)(frame.cbData / pCodec->cbSample);
+			}
+			dStart = dEnd;
+			iFrame++;
+		}
+
+		if (bIsTimed)
+			pResult->dInputBytes += (double)stream.GetDataSize();
+	}
+
+	// Frame latency percentiles
+	qsort(pdLatency, pResult->nFrames, sizeof(double), CompareDoubles);
+	pResult->dLatency50 = GetPercentile(pdLatency, pResult->nFrames, 50);
+	pResult->dLatency99 = GetPercentile(pdLatency, pResult->nFrames, 99);
+
+	pDecoder->Cleanup();
+	delete pDecoder;
+	free(pbOutput);
+	free(pdLatency);
+
+	return NOERROR;
+}
+
+//==========================================================================
+// Results output
+//==========================================================================
+
+static double GetRate(double dAmount, double dSeconds)
+{
+	return (dSeconds > 0.0) ? dAmount / dSeconds / 1e6 : 0.0;
+}
+
+static void PrintTableHeader(FILE *pFile)
+{
+	fprintf(
+		pFile,
+		"%-9s %11s %7s %10s %10s %10s %9s %9s %6s\n",
+		"codec", "size", "frames", "fps", "in MB/s", "out MP/s", "p50 ms", "p99 ms", "errors"
+	);
+}
+
+static void PrintTableRow(FILE *pFile, const BENCH_RESULT *pResult)
+{
+	char szSize[32];
+	if (pResult->pCodec->bIsVideo)
+		sprintf(szSize, "%lux%lu", (unsigned long)pResult->dwWidth, (unsigned long)pResult->dwHeight);
+	else
+		sprintf(szSize, "-");
+
+	fprintf(
+		pFile,
+		"%-9s %11s %7lu %10.1f %10.2f %10.2f %9.3f %9.3f %6lu\n",
+		pResult->pCodec->pszName,
+		szSize,
+		(unsigned long)pResult->nFrames,
+		(pResult->dSeconds > 0.0) ? pResult->nFrames / pResult->dSeconds : 0.0,
+		GetRate(pResult->dInputBytes, pResult->dSeconds),
+		GetRate(pResult->dOutputUnits, pResult->dSeconds),
+		pResult->dLatency50 * 1e3,
+		pResult->dLatency99 * 1e3,
+		(unsigned long)pResult->nErrors
+	);
+	fflush(pFile);
+}
+
+static void WriteJSON(
+	FILE *pFile,
+	const GEN_PARAMS *pParams,
+	DWORD nPasses,
+	const BENCH_RESULT *pResults,
+	DWORD nResults
+)
+{
+	fprintf(pFile, "{\n");
+	fprintf(pFile, "  \"frames\": %lu,\n", (unsigned long)pParams->nFrames);
+	fprintf(pFile, "  \"passes\": %lu,\n", (unsigned long)nPasses);
+	fprintf(pFile, "  \"churn\": %lu,\n", (unsigned long)pParams->nChurnFrames);
+	fprintf(pFile, "  \"codebook_parts\": %lu,\n", (unsigned long)pParams->nCodebookParts);
+	fprintf(pFile, "  \"audio_block\": %lu,\n", (unsigned long)pParams->cbAudioBlock);
+	fprintf(pFile, "  \"seed\": %lu,\n", (unsigned long)pParams->dwSeed);
+	fprintf(pFile, "  \"threads\": %lu,\n", (unsigned long)g_nDecodeThreads);
+	fprintf(pFile, "  \"results\": [");
+	for (DWORD i = 0; i < nResults; i++) {
+		const BENCH_RESULT *pResult = pResults + i;
+		fprintf(pFile, "%s\n    {", (i > 0) ? "," : "");
+		fprintf(pFile, "\"codec\": \"%s\", ", pResult->pCodec->pszName);
+		fprintf(pFile, "\"type\": \"%s\", ", (pResult->pCodec->bIsVideo) ? "video" : "audio");
+		fprintf(pFile, "\"width\": %lu, ", (unsigned long)pResult->dwWidth);
+		fprintf(pFile, "\"height\": %lu, ", (unsigned long)pResult->dwHeight);
+		fprintf(pFile, "\"frames\": %lu, ", (unsigned long)pResult->nFrames);
+		fprintf(pFile, "\"errors\": %lu, ", (unsigned long)pResult->nErrors);
+		fprintf(pFile, "\"input_bytes\": %.0f, ", pResult->dInputBytes);
+		fprintf(pFile, "\"output_units\": %.0f, ", pResult->dOutputUnits);
+		fprintf(pFile, "\"seconds\": %.6f, ", pResult->dSeconds);
+		fprintf(pFile, "\"fps\": %.3f, ", (pResult->dSeconds > 0.0) ? pResult->nFrames / pResult->dSeconds : 0.0);
+		fprintf(pFile, "\"input_mb_per_s\": %.3f, ", GetRate(pResult->dInputBytes, pResult->dSeconds));
+		fprintf(pFile, "\"output_mp_per_s\": %.3f, ", GetRate(pResult->dOutputUnits, pResult->dSeconds));
+		fprintf(pFile, "\"latency_p50_ms\": %.4f, ", pResult->dLatency50 * 1e3);
+		fprintf(pFile, "\"latency_p99_ms\": %.4f}", pResult->dLatency99 * 1e3);
+	}
+	fprintf(pFile, "\n  ]\n}\n");
+}
+
+//==========================================================================
+// Command line
+//==========================================================================
+
+#define MAX_RESOLUTIONS 16
+
+static void PrintUsage(void)
+{
+	printf(
+		"Usage: gmfbench [options] [codec ...]\n"
+		"\n"
+		"Options:\n"
+		"  -r WxH    add video resolution (default: 320x200 640x480 1280x720 1920x1080)\n"
+		"  -n N      frames (audio blocks) per stream (default: 60)\n"
+		"  -p N      timed passes over the stream (default: 3)\n"
+		"  -w N      warm-up passes (default: 1)\n"
+		"  -c N      codebook/palette refresh period in frames, 0 = never (default: 8)\n"
+		"  -k N      send each refreshed VQA codebook in N parts, 0 = whole (default: 0)\n"
+		"  -a N      compressed audio block size (default: 4096)\n"
+		"  -s N      random seed (default: 1)\n"
+		"  -t N      threads decoding the 8-bit VQA frame, 0 = CPU count (default: 1)\n"
+		"  -j FILE   write JSON results to FILE (- for stdout, the table goes to stderr)\n"
+		"  -l        list codecs\n"
+		"\n"
+		"MB/s is 10^6 input bytes per second, MP/s is 10^6 output pixels\n"
+		"(video) or samples (audio) per second.\n"
+	);
+}
+
+static BOOL ParseNumber(const char *psz, DWORD *pdwValue)
+{
+	char *pszEnd = NULL;
+	unsigned long ulValue = strtoul(psz, &pszEnd, 10);
+	if ((pszEnd == psz) || (*pszEnd != '\0'))
+		return FALSE;
+	*pdwValue = (DWORD)ulValue;
+	return TRUE;
+}
+
+static const BENCH_CODEC* FindCodec(const char *pszName)
+{
+	for (DWORD i = 0; i < BENCH_CODECS; i++)
+		if (strcmp(g_Codecs[i].pszName, pszName) == 0)
+			return &g_Codecs[i];
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	GEN_PARAMS params;
+	params.dwWidth			= 0;
+	params.dwHeight			= 0;
+	params.nFrames			= 60;
+	params.nChurnFrames		= 8;
+	params.nCodebookParts	= 0;
+	params.cbAudioBlock		= 4096;
+	params.dwSeed			= 1;
+	params.bUncompressed	= FALSE;
+
+	DWORD nPasses = 3, nWarmupPasses = 1;
+	const char *pszJSONFile = NULL;
+
+	DWORD pdwWidths[MAX_RESOLUTIONS], pdwHeights[MAX_RESOLUTIONS];
+	DWORD nResolutions = 0;
+
+	const BENCH_CODEC *pCodecs[BENCH_CODECS];
+	DWORD nCodecs = 0;
+
+	// Parse the command line
+	for (int i = 1; i < argc; i++) {
+
+		const char *pszArg = argv[i];
+		BOOL bIsValid = TRUE;
+
+		if ((pszArg[0] == '-') && (pszArg[1] != '\0') && (pszArg[2] == '\0')) {
+
+			if ((pszArg[1] == 'h') || (pszArg[1] == '?')) {
+				PrintUsage();
+				return 0;
+			}
+			if (pszArg[1] == 'l') {
+				for (DWORD j = 0; j < BENCH_CODECS; j++)
+					printf("%-9s %s\n", g_Codecs[j].pszName, g_Codecs[j].pszDesc);
+				return 0;
+			}
+
+			// All other options take a value
+			if (i + 1 >= argc) {
+				fprintf(stderr, "Option %s requires a value\n", pszArg);
+				return 2;
+			}
+			const char *pszValue = argv[++i];
+
+			switch (pszArg[1]) {
+				case 'r':
+					{
+						unsigned long ulWidth = 0, ulHeight = 0;
+						bIsValid =
+							(sscanf(pszValue, "%lux%lu", &ulWidth, &ulHeight) == 2) &&
+							(ulWidth > 0) && (ulHeight > 0) &&
+							(nResolutions < MAX_RESOLUTIONS);
+						if (bIsValid) {
+							pdwWidths[nResolutions] = (DWORD)ulWidth;
+							pdwHeights[nResolutions] = (DWORD)ulHeight;
+							nResolutions++;
+						}
+					}
+					break;
+				case 'n':
+					bIsValid = ParseNumber(pszValue, &params.nFrames) && (params.nFrames > 0);
+					break;
+				case 'p':
+					bIsValid = ParseNumber(pszValue, &nPasses) && (nPasses > 0);
+					break;
+				case 'w':
+					bIsValid = ParseNumber(pszValue, &nWarmupPasses);
+					break;
+				case 'c':
+					bIsValid = ParseNumber(pszValue, &params.nChurnFrames);
+					break;
+				case 'k':
+					bIsValid = ParseNumber(pszValue, &params.nCodebookParts);
+					break;
+				case 'a':
+					bIsValid = ParseNumber(pszValue, &params.cbAudioBlock) && (params.cbAudioBlock > 0);
+					break;
+				case 's':
+					bIsValid = ParseNumber(pszValue, &params.dwSeed);
+					break;
+				case 't':
+					bIsValid = ParseNumber(pszValue, &g_nDecodeThreads);
+					break;
+				case 'j':
+					pszJSONFile = pszValue;
+					break;
+				default:
+					bIsValid = FALSE;
+					break;
+			}
+
+		} else {
+
+			const BENCH_CODEC *pCodec = FindCodec(pszArg);
+			bIsValid = (pCodec != NULL) && (nCodecs < BENCH_CODECS);
+			if (bIsValid)
+				pCodecs[nCodecs++] = pCodec;
+		}
+
+		if (!bIsValid) {
+			fprintf(stderr, "Invalid argument: %s\n", pszArg);
+			PrintUsage();
+			return 2;
+		}
+	}
+
+	// Default codecs and resolutions
+	if (nCodecs == 0)
+		for (nCodecs = 0; nCodecs < BENCH_CODECS; nCodecs++)
+			pCodecs[nCodecs] = &g_Codecs[nCodecs];
+	if (nResolutions == 0) {
+		static const DWORD pdwDefaultSizes[][2] = {
+			{ 320, 200 }, { 640, 480 }, { 1280, 720 }, { 1920, 1080 }
+		};
+		for (nResolutions = 0; nResolutions < 4; nResolutions++) {
+			pdwWidths[nResolutions] = pdwDefaultSizes[nResolutions][0];
+			pdwHeights[nResolutions] = pdwDefaultSizes[nResolutions][1];
+		}
+	}
+
+	// Video codecs run at every resolution, audio codecs just once
+	BENCH_RESULT *pResults = (BENCH_RESULT*)malloc(nCodecs * nResolutions * sizeof(BENCH_RESULT));
+	if (pResults == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	DWORD nResults = 0;
+	BOOL bHasFailed = FALSE;
+
+	// The table goes to stderr when JSON is written to stdout
+	FILE *pTable = ((pszJSONFile != NULL) && (strcmp(pszJSONFile, "-") == 0)) ? stderr : stdout;
+
+	PrintTableHeader(pTable);
+	for (DWORD i = 0; i < nCodecs; i++) {
+		DWORD nRuns = (pCodecs[i]->bIsVideo) ? nResolutions : 1;
+		for (DWORD j = 0; j < nRuns; j++) {
+
+			params.dwWidth	= pdwWidths[j];
+			params.dwHeight	= pdwHeights[j];
+
+			HRESULT hr = RunBenchmark(pCodecs[i], &params, nWarmupPasses, nPasses, &pResults[nResults]);
+			if (FAILED(hr)) {
+				fprintf(
+					stderr,
+					"%s %lux%lu: benchmark failed (0x%08lX)\n",
+					pCodecs[i]->pszName,
+					(unsigned long)params.dwWidth,
+					(unsigned long)params.dwHeight,
+					(unsigned long)hr
+				);
+				bHasFailed = TRUE;
+				continue;
+			}
+			if (pResults[nResults].nErrors > 0)
+				bHasFailed = TRUE;
+
+			PrintTableRow(pTable, &pResults[nResults++]);
+		}
+	}
+
+	// Write JSON results
+	if (pszJSONFile != NULL) {
+		FILE *pFile = (strcmp(pszJSONFile, "-") == 0) ? stdout : fopen(pszJSONFile, "w");
+		if (pFile == NULL) {
+			fprintf(stderr, "Cannot open %s\n", pszJSONFile);
+			bHasFailed = TRUE;
+		} else {
+			WriteJSON(pFile, &params, nPasses, pResults, nResults);
+			if (pFile != stdout)
+				fclose(pFile);
+		}
+	}
+
+	free(pResults);
+
+	return (bHasFailed) ? 1 : 0;
+}
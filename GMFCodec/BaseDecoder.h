@@ -0,0 +1,63 @@
+//==========================================================================
+//
+// File: BaseDecoder.h
+//
+// Desc: Game Media Formats - Header file for the base decoder class
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#ifndef __GMF_BASE_DECODER_H__
+#define __GMF_BASE_DECODER_H__
+
+#include "CodecTypes.h"
+
+//==========================================================================
+// Base decoder class
+//
+// All decoders are platform-neutral: they know nothing about DirectShow,
+// COM or media samples and just turn a compressed data block into the
+// uncompressed frame (or PCM data block). The decoder object keeps the
+// inter-frame state, so a separate object should be used for each stream.
+//
+// Decode() returns S_OK when the output buffer has been filled in,
+// S_FALSE when the data block has been consumed but there's nothing to
+// output (e.g. codebook or palette chunk) and an error code otherwise.
+//==========================================================================
+
+class CBaseDecoder {
+
+public:
+
+	virtual ~CBaseDecoder() {}
+
+	// Decode the data block to the output buffer described by the frame
+	virtual HRESULT Decode(const BYTE *pbData, DWORD cbData, GMF_FRAME& frame) = 0;
+
+	// Maximum size of the output buffer the decoder may fill in
+	// for the data block of the specified size
+	virtual DWORD GetMaxOutputSize(DWORD cbData) = 0;
+
+	// Reset inter-frame state (e.g. after flush/seek)
+	virtual void Reset(void) {}
+
+	// Release all the decoder buffers
+	virtual void Cleanup(void) {}
+};
+
+#endif
@@ -0,0 +1,271 @@
+//==========================================================================
+//
+// File: CINVideoDecoder.cpp
+//
+// Desc: Game Media Formats - Implementation of CIN video decoder
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#include "CINVideoDecoder.h"
+
+//==========================================================================
+// CCINVideoDecoder methods
+//==========================================================================
+
+CCINVideoDecoder::CCINVideoDecoder() :
+	m_pFormat(NULL)	// No format block at this time
+{
+	ZeroMemory(m_Palette, sizeof(m_Palette));
+}
+
+CCINVideoDecoder::~CCINVideoDecoder()
+{
+	// Free the format block
+	ResetFormat();
+}
+
+HRESULT CCINVideoDecoder::SetFormat(const CIN_HEADER *pFormat, DWORD cbFormat)
+{
+	// Check the pointer and the format block size
+	if (pFormat == NULL)
+		return E_POINTER;
+	if (cbFormat < sizeof(CIN_HEADER))
+		return E_INVALIDARG;
+
+	// Free the old format block and allocate a new one
+	if (m_pFormat)
+		free(m_pFormat);
+	m_pFormat = (CIN_HEADER*)malloc(cbFormat);
+	if (m_pFormat == NULL)
+		return E_OUTOFMEMORY;
+
+	// Copy format block to the allocated storage
+	CopyMemory(m_pFormat, pFormat, cbFormat);
+
+	// Set up Huffman nodes and tree
+	for (int i = 0; i < 256; i++) {
+		for (int j = 0; j < HUFFMAN_TOKENS; j++)
+			m_HuffmanNodes[i][j].iCount = (int)m_pFormat->bHuffmanTable[i][j];
+		HuffmanBuildTree(i);
+	}
+
+	return NOERROR;
+}
+
+void CCINVideoDecoder::ResetFormat(void)
+{
+	// Free the format block
+	if (m_pFormat) {
+		free(m_pFormat);
+		m_pFormat = NULL;
+	}
+}
+
+DWORD CCINVideoDecoder::GetFrameSize(void)
+{
+	if (m_pFormat == NULL)
+		return 0;
+
+	return m_pFormat->dwVideoWidth * m_pFormat->dwVideoHeight;
+}
+
+HRESULT CCINVideoDecoder::Decode(const BYTE *pbData, DWORD cbData, GMF_FRAME& frame)
+{
+	// We should have the format block at this time
+	if (m_pFormat == NULL)
+		return E_UNEXPECTED;
+
+	// Check the output buffer
+	DWORD cbFrame = GetFrameSize();
+	if ((frame.pbBuffer == NULL) || (frame.cbBuffer < cbFrame))
+		return E_INVALIDARG;
+
+	// Reset the output frame info
+	frame.cbData = 0;
+	frame.pPalette = m_Palette;
+	frame.iPaletteStart = 0;
+	frame.nPaletteEntries = 0;
+
+	// Data block starts with the command DWORD
+	if ((pbData == NULL) || (cbData < 4))
+		return E_INVALIDARG;
+
+	// Check if the frame contains new palette
+	const BYTE *pbHuffmanData = NULL;
+	if (*((DWORD*)pbData) == CIN_COMMAND_PALETTE) {
+
+		// Get the palette pointer from the input data
+		const BYTE *pbPalette = pbData + 4;
+		if (cbData < 4 + 3 * 256)
+			return E_UNEXPECTED;
+
+		// Fill in the palette
+		for (int i = 0; i < 256; i++) {
+			m_Palette[i].bRed	= *pbPalette++;
+			m_Palette[i].bGreen	= *pbPalette++;
+			m_Palette[i].bBlue	= *pbPalette++;
+		}
+		frame.iPaletteStart		= 0;
+		frame.nPaletteEntries	= 256;
+
+		// Set up Huffman data pointer
+		pbHuffmanData = pbPalette;
+
+	} else
+		pbHuffmanData = pbData + 4;
+
+	// Set up Huffman count
+	LONG lHuffmanCount = (LONG)cbData;
+	lHuffmanCount -= (LONG)(pbHuffmanData - pbData);
+	if (lHuffmanCount < 4)
+		return E_UNEXPECTED;
+
+	// Sanity check of the decoded data length
+	if (*((DWORD*)pbHuffmanData) > cbFrame)
+		return E_UNEXPECTED;
+
+	// Call the decoder function to decompress the frame
+	if (!HuffmanDecode(pbHuffmanData, lHuffmanCount, frame.pbBuffer))
+		return E_FAIL;
+
+	// The data length is the uncompressed frame size
+	frame.cbData = cbFrame;
+
+	return NOERROR;
+}
+
+//==========================================================================
+// Huffman decoder methods implementation.
+// Source code taken from xcinplay program 
+// by Dr. Tim Ferguson (timf@csse.monash.edu.au)
+//==========================================================================
+
+/* -------------------------------------------------------------------------
+ *  Decodes input Huffman data using the Huffman table.
+ *
+ *  Input:   data = encoded data to be decoded.
+ *           len = length of encoded data.
+ *           image = a buffer for the decoded image data.
+ */
+BOOL CCINVideoDecoder::HuffmanDecode(const BYTE *data, long len, BYTE *image)
+{
+	CIN_HUFFMAN_NODE *hnodes;
+	long i, dec_len;
+	int prev;
+	register BYTE v = 0;
+	register int bit_pos, node_num, dat_pos;
+
+	/* read count */
+	dec_len  = (*data++ & 0xff);
+	dec_len |= (*data++ & 0xff) << 8;
+	dec_len |= (*data++ & 0xff) << 16;
+	dec_len |= (*data++ & 0xff) << 24;
+
+	prev = bit_pos = dat_pos = 0;
+	for (i = 0; i < dec_len; i++) {
+
+		node_num = m_nHuffmanNodes[prev];
+		hnodes = m_HuffmanNodes[prev];
+
+		while (node_num >= HUFFMAN_TOKENS) {
+
+			if (!bit_pos) {
+				if (dat_pos > len) {
+					// Huffman decode error
+					return FALSE;
+				}
+				bit_pos = 8;
+				v = data[dat_pos++];
+			}
+
+			node_num = hnodes[node_num].iChildren[v & 0x01];
+			v = v >> 1;
+			bit_pos--;
+		}
+
+		*image++ = prev = node_num;
+	}
+
+	return TRUE;
+}
+
+/* -------------------------------------------------------------------------
+ *  Find the lowest probability node in a Huffman table, and mark it as
+ *  being assigned to a higher probability.
+ *  Returns the node index of the lowest unused node, or -1 if all nodes
+ *  are used.
+ */
+int CCINVideoDecoder::HuffmanSmallestNode(CIN_HUFFMAN_NODE *hnodes, int num_hnodes)
+{
+	int i;
+	int best, best_node;
+
+	best = 99999999;
+	best_node = -1;
+	for (i = 0; i < num_hnodes; i++) {
+
+		if (hnodes[i].bUsed) continue;
+		if (!hnodes[i].iCount) continue;
+		if (hnodes[i].iCount < best) {
+			best = hnodes[i].iCount;
+			best_node = i;
+		}
+	}
+
+	if (best_node == -1) return -1;
+	hnodes[best_node].bUsed = 1;
+	return best_node;
+}
+
+/* -------------------------------------------------------------------------
+ *  Build the Huffman tree using the generated/loaded probabilities histogram.
+ *
+ *  On completion:
+ *   m_HuffmanNodes[prev][i < HUFFMAN_TOKENS] - are the nodes at the base of the tree.
+ *   m_HuffmanNodes[prev][i >= HUFFMAN_TOKENS] - are used to construct the tree.
+ *   m_nHuffmanNodes[prev] - contains the index to the root node of the tree.
+ *     That is: m_HuffmanNodes[prev][m_nHuffmanNodes[prev]] is the root node.
+ */
+void CCINVideoDecoder::HuffmanBuildTree(int prev)
+{
+	CIN_HUFFMAN_NODE *node, *hnodes;
+	int num_hnodes, i;
+
+	num_hnodes = HUFFMAN_TOKENS;
+	hnodes = m_HuffmanNodes[prev];
+	for (i = 0; i < HUFFMAN_TOKENS * 2; i++) hnodes[i].bUsed = 0;
+
+	while (1) {
+
+		node = &hnodes[num_hnodes];	/* next free node */
+
+		/* pick two lowest counts */
+		node->iChildren[0] = HuffmanSmallestNode(hnodes, num_hnodes);
+		if (node->iChildren[0] == -1) break;	/* reached the root node */
+
+		node->iChildren[1] = HuffmanSmallestNode(hnodes, num_hnodes);
+		if (node->iChildren[1] == -1) break;	/* reached the root node */
+
+		/* combine nodes probability for new node */
+		node->iCount = hnodes[node->iChildren[0]].iCount + hnodes[node->iChildren[1]].iCount;
+		num_hnodes++;
+	}
+
+	m_nHuffmanNodes[prev] = num_hnodes - 1;
+}
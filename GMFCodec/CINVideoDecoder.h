@@ -0,0 +1,82 @@
+//==========================================================================
+//
+// File: CINVideoDecoder.h
+//
+// Desc: Game Media Formats - Header file for CIN video decoder
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#ifndef __GMF_CIN_VIDEO_DECODER_H__
+#define __GMF_CIN_VIDEO_DECODER_H__
+
+#include "BaseDecoder.h"
+#include "CINSpecs.h"
+
+//==========================================================================
+// CIN video decoder class
+//==========================================================================
+
+class CCINVideoDecoder : public CBaseDecoder {
+
+	// ---- Huffman decoder stuff ----
+	// Source code taken from xcinplay program 
+	// by Dr. Tim Ferguson (timf@csse.monash.edu.au)
+
+	typedef struct tagCIN_HUFFMAN_NODE {
+		int iCount;
+		BYTE bUsed;
+		int iChildren[2];
+	} CIN_HUFFMAN_NODE;
+
+	CIN_HUFFMAN_NODE m_HuffmanNodes[256][HUFFMAN_TOKENS * 2];
+	int m_nHuffmanNodes[256];
+
+	// Current palette
+	GMF_PALETTE_ENTRY m_Palette[256];
+
+	// Format block
+	CIN_HEADER *m_pFormat;
+
+	// ---- Huffman decoder methods ----
+	// Source code taken from xcinplay program 
+	// by Dr. Tim Ferguson (timf@csse.monash.edu.au)
+	BOOL HuffmanDecode(const BYTE *data, long len, BYTE *image);
+	int HuffmanSmallestNode(CIN_HUFFMAN_NODE *hnodes, int num_hnodes);
+	void HuffmanBuildTree(int prev);
+
+public:
+
+	// Constructor/destructor
+	CCINVideoDecoder();
+	~CCINVideoDecoder();
+
+	// Format setup methods
+	HRESULT SetFormat(const CIN_HEADER *pFormat, DWORD cbFormat);
+	void ResetFormat(void);
+	const CIN_HEADER* GetFormat(void) { return m_pFormat; };
+
+	// Uncompressed frame size
+	DWORD GetFrameSize(void);
+
+	// CBaseDecoder methods
+	HRESULT Decode(const BYTE *pbData, DWORD cbData, GMF_FRAME& frame);
+	DWORD GetMaxOutputSize(DWORD cbData) { return GetFrameSize(); };
+};
+
+#endif
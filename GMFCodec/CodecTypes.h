@@ -0,0 +1,143 @@
+//==========================================================================
+//
+// File: CodecTypes.h
+//
+// Desc: Game Media Formats - Portable types and structures used by
+//       the platform-neutral decoders
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#ifndef __GMF_CODEC_TYPES_H__
+#define __GMF_CODEC_TYPES_H__
+
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#ifdef _WIN32
+
+// On Windows the basic types come from the platform SDK
+#include <windows.h>
+#include <mmsystem.h>
+#include <vfwmsgs.h>
+
+#else
+
+#include <stdint.h>
+
+//==========================================================================
+// Basic types (the same sizes as their Win32 counterparts)
+//==========================================================================
+
+typedef uint8_t		BYTE;
+typedef uint16_t	WORD;
+typedef uint32_t	DWORD;
+typedef int32_t		LONG;
+typedef int64_t		LONGLONG;
+typedef int16_t		SHORT;
+typedef signed char	CHAR;
+typedef int			BOOL;
+typedef uint32_t	UINT;
+typedef int32_t		HRESULT;
+
+#ifndef TRUE
+#define TRUE	1
+#endif
+#ifndef FALSE
+#define FALSE	0
+#endif
+
+#ifndef NULL
+#define NULL	0
+#endif
+
+//==========================================================================
+// Result codes (the same values as their Win32 counterparts)
+//==========================================================================
+
+#define S_OK					((HRESULT)0x00000000L)
+#define S_FALSE					((HRESULT)0x00000001L)
+#define NOERROR					S_OK
+#define E_FAIL					((HRESULT)0x80004005L)
+#define E_POINTER				((HRESULT)0x80004003L)
+#define E_UNEXPECTED			((HRESULT)0x8000FFFFL)
+#define E_NOTIMPL				((HRESULT)0x80004001L)
+#define E_OUTOFMEMORY			((HRESULT)0x8007000EL)
+#define E_INVALIDARG			((HRESULT)0x80070057L)
+#define VFW_E_BUFFER_OVERFLOW	((HRESULT)0x8004020EL)
+#define VFW_E_INVALID_FILE_FORMAT	((HRESULT)0x8004022FL)
+
+#define SUCCEEDED(hr)	(((HRESULT)(hr)) >= 0)
+#define FAILED(hr)		(((HRESULT)(hr)) < 0)
+
+//==========================================================================
+// Utility macros
+//==========================================================================
+
+#define LOBYTE(w)	((BYTE)(((DWORD)(w)) & 0xFF))
+#define HIBYTE(w)	((BYTE)((((DWORD)(w)) >> 8) & 0xFF))
+
+#define mmioFOURCC(ch0, ch1, ch2, ch3) (				\
+	((DWORD)(BYTE)(ch0)) | ((DWORD)(BYTE)(ch1) << 8) |	\
+	((DWORD)(BYTE)(ch2) << 16) | ((DWORD)(BYTE)(ch3) << 24)	\
+)
+
+#define CopyMemory(d, s, n)		memcpy((d), (s), (n))
+#define MoveMemory(d, s, n)		memmove((d), (s), (n))
+#define FillMemory(d, n, b)		memset((d), (b), (n))
+#define ZeroMemory(d, n)		memset((d), 0, (n))
+
+#endif
+
+#ifndef ASSERT
+#define ASSERT(x) assert(x)
+#endif
+
+//==========================================================================
+// Structures
+//==========================================================================
+
+// Palette entry as delivered by the decoders (8 bits per component)
+typedef struct tagGMF_PALETTE_ENTRY {
+	BYTE	bRed;
+	BYTE	bGreen;
+	BYTE	bBlue;
+} GMF_PALETTE_ENTRY;
+
+// Decoded frame descriptor. The caller supplies the output buffer and
+// (for the video decoders) the frame index, the decoder fills in the
+// decoded data length and the palette change information (if any).
+// A video caller which owns its output buffers and keeps the previous 
+// output frame intact may pass it along (it may be the output buffer 
+// itself), so the decoders which keep the unchanged pixels can decode 
+// straight to the output buffer. Once the caller has passed it, it 
+// should keep passing it. The buffers handed over to someone else 
+// (such as the delivered media samples) must not be passed
+typedef struct tagGMF_FRAME {
+	BYTE	*pbBuffer;			// Output buffer (supplied by the caller)
+	DWORD	cbBuffer;			// Output buffer size (supplied by the caller)
+	const BYTE *pbPrevious;		// Previous output frame (supplied by the caller, NULL if not kept)
+	DWORD	cbData;				// Decoded data length (set by the decoder)
+	DWORD	iFrame;				// Frame index (supplied by the caller)
+	const GMF_PALETTE_ENTRY *pPalette;	// Current palette (set by the decoder)
+	WORD	iPaletteStart;		// First changed palette entry (set by the decoder)
+	WORD	nPaletteEntries;	// Number of changed palette entries (0 if none)
+} GMF_FRAME;
+
+#endif
@@ -0,0 +1,235 @@
+//==========================================================================
+//
+// File: ContinuousIMAADPCMDecoder.cpp
+//
+// Desc: Game Media Formats - Implementation of continuous IMA ADPCM decoder
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#include "ContinuousIMAADPCMDecoder.h"
+
+//==========================================================================
+// IMA ADPCM decompression macros and tables
+//==========================================================================
+
+// Extract the nibble (upper nibble for TRUE, lower one for FALSE)
+#define NIBBLE(b,n) ((n) ? (((b) & 0xF0) >> 4) : ((b) & 0x0F))
+
+const CHAR CCIMAADPCMDecoder::g_chIndexAdjust[]=
+{ -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8 };
+
+const LONG CCIMAADPCMDecoder::g_lStepTable[]=
+{
+	7,		8,		9,		10,		11,		12,		13,		14,		16,
+	17,		19,		21,		23,		25,		28,		31,		34,		37,
+	41,		45,		50,		55,		60,		66,		73,		80,		88,
+	97,		107,	118,	130,	143,	157,	173,	190,	209,
+	230,	253,	279,	307,	337,	371,	408,	449,	494,
+	544,	598,	658,	724,	796,	876,	963,	1060,	1166,
+	1282,	1411,	1552,	1707,	1878,	2066,	2272,	2499,	2749,
+	3024,	3327,	3660,	4026,	4428,	4871,	5358,	5894,	6484,
+	7132,	7845,	8630,	9493,	10442,	11487,	12635,	13899,	15289,
+	16818,	18500,	20350,	22385,	24623,	27086,	29794,	32767
+};
+
+//==========================================================================
+
+//==========================================================================
+// CCIMAADPCMDecoder methods
+//==========================================================================
+
+CCIMAADPCMDecoder::CCIMAADPCMDecoder() :
+	m_pFormat(NULL),	// No format block at this time
+	m_pInfo(NULL)		// No info array at this time
+{
+}
+
+CCIMAADPCMDecoder::~CCIMAADPCMDecoder()
+{
+	// Free the info blocks array
+	Cleanup();
+
+	// Free the format block
+	ResetFormat();
+}
+
+HRESULT CCIMAADPCMDecoder::SetFormat(const CIMAADPCMWAVEFORMAT *pFormat, DWORD cbFormat)
+{
+	// Check the pointer and the format block size
+	if (pFormat == NULL)
+		return E_POINTER;
+	if (
+		(cbFormat < sizeof(CIMAADPCMWAVEFORMAT)) ||
+		(pFormat->nChannels == 0) ||
+		(cbFormat < sizeof(CIMAADPCMWAVEFORMAT) + (pFormat->nChannels - 1) * sizeof(CIMAADPCMINFO))
+	)
+		return E_INVALIDARG;
+
+	// Free the old format block and allocate a new one
+	if (m_pFormat)
+		free(m_pFormat);
+	m_pFormat = (CIMAADPCMWAVEFORMAT*)malloc(cbFormat);
+	if (m_pFormat == NULL)
+		return E_OUTOFMEMORY;
+
+	// Copy format block to the allocated storage
+	CopyMemory(m_pFormat, pFormat, cbFormat);
+
+	return NOERROR;
+}
+
+void CCIMAADPCMDecoder::ResetFormat(void)
+{
+	// Free the format block
+	if (m_pFormat) {
+		free(m_pFormat);
+		m_pFormat = NULL;
+	}
+}
+
+HRESULT CCIMAADPCMDecoder::Initialize(void)
+{
+	// We should have the format block at this time
+	if (m_pFormat == NULL)
+		return E_UNEXPECTED;
+
+	// Free the info blocks array left from the previous session (if any)
+	Cleanup();
+
+	// Allocate info blocks array
+	m_pInfo = (CIMAADPCMINFO*)malloc(m_pFormat->nChannels * sizeof(CIMAADPCMINFO));
+	if (m_pInfo == NULL)
+		return E_OUTOFMEMORY;
+
+	// Set the initial sample and index values
+	CopyMemory(m_pInfo, m_pFormat->pInit, m_pFormat->nChannels * sizeof(CIMAADPCMINFO));
+
+	return NOERROR;
+}
+
+void CCIMAADPCMDecoder::Cleanup(void)
+{
+	// Free the info blocks array
+	if (m_pInfo) {
+		free(m_pInfo);
+		m_pInfo = NULL;
+	}
+}
+
+void CCIMAADPCMDecoder::SetInitialState(const CIMAADPCMINFO *pInit)
+{
+	if ((m_pFormat == NULL) || (m_pInfo == NULL) || (pInit == NULL))
+		return;
+
+	// Set the new initial parameters
+	for (WORD i = 0; i < m_pFormat->nChannels; i++) {
+		m_pInfo[i].lSample = pInit[i].lSample;
+		m_pInfo[i].chIndex = pInit[i].chIndex;
+	}
+}
+
+void CCIMAADPCMDecoder::DecompressNibble(
+	BYTE bCode,
+	LONG *plSample,
+	CHAR *pchIndex
+)
+{
+	// Compose sample delta
+	LONG			lDelta  = g_lStepTable[*pchIndex] >> 3; 
+	if (bCode & 1)	lDelta += g_lStepTable[*pchIndex] >> 2;
+	if (bCode & 2)	lDelta += g_lStepTable[*pchIndex] >> 1;
+	if (bCode & 4)	lDelta += g_lStepTable[*pchIndex];
+
+	// Update the current sample value
+	if (bCode & 8)
+		*plSample -= lDelta;
+	else
+		*plSample += lDelta;
+
+	// Clip the sample value (if needed)
+	if		(*plSample > 32767)		*plSample = 32767;
+    else if	(*plSample < -32768)	*plSample = -32768;
+
+	// Update the current index value
+	*pchIndex += g_chIndexAdjust[bCode];
+
+	// Clip the index value (if needed)
+	if		(*pchIndex < 0)		*pchIndex = 0;
+    else if	(*pchIndex > 88)	*pchIndex = 88;
+}
+
+void CCIMAADPCMDecoder::Decompress(
+	const BYTE *pbInput,
+	LONG lInputLength,
+	SHORT *piOutput
+)
+{
+	// Set up the first nibble to be processed
+	BOOL bIsCurrentNibbleHigh = m_pFormat->bIsHiNibbleFirst;
+
+	// Walk the input buffer until its length is exhausted
+	while (lInputLength > 0) {
+
+		// Process a nibble per channel for all channels
+		for (WORD i = 0; i < m_pFormat->nChannels; i++) {
+
+			// Decompress the current nibble code
+			DecompressNibble(
+				NIBBLE(*pbInput, bIsCurrentNibbleHigh),
+				&(m_pInfo[i].lSample),
+				&(m_pInfo[i].chIndex)
+			);
+
+			// Place the sample into the output buffer
+			*piOutput = (SHORT)m_pInfo[i].lSample;
+			piOutput++;
+
+			// Advance the current nibble
+			bIsCurrentNibbleHigh = !bIsCurrentNibbleHigh;
+			
+			// If the next nibble is what the first nibble should be
+			// then we have to advance to the next byte
+			if (bIsCurrentNibbleHigh == m_pFormat->bIsHiNibbleFirst) {
+				pbInput++;
+				lInputLength--;
+			}
+		}
+	}
+}
+
+HRESULT CCIMAADPCMDecoder::Decode(const BYTE *pbData, DWORD cbData, GMF_FRAME& frame)
+{
+	// We should be initialized at this time
+	if ((m_pFormat == NULL) || (m_pInfo == NULL))
+		return E_UNEXPECTED;
+
+	// Check the output buffer. Output data length 
+	// is four times larger the input's one
+	DWORD cbOutData = GetMaxOutputSize(cbData);
+	if ((frame.pbBuffer == NULL) || (frame.cbBuffer < cbOutData))
+		return E_INVALIDARG;
+
+	// Decompress the input buffer to the output one
+	Decompress(pbData, (LONG)cbData, (SHORT*)frame.pbBuffer);
+
+	// Set the output data length
+	frame.cbData = cbOutData;
+
+	return NOERROR;
+}
@@ -0,0 +1,82 @@
+//==========================================================================
+//
+// File: ContinuousIMAADPCMDecoder.h
+//
+// Desc: Game Media Formats - Header file for continuous IMA ADPCM decoder
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#ifndef __GMF_CONTINUOUS_IMA_ADPCM_DECODER_H__
+#define __GMF_CONTINUOUS_IMA_ADPCM_DECODER_H__
+
+#include "BaseDecoder.h"
+#include "ContinuousIMAADPCM.h"
+
+//==========================================================================
+// Continuous IMA ADPCM decoder class
+//==========================================================================
+
+class CCIMAADPCMDecoder : public CBaseDecoder {
+
+	// ---- IMA ADPCM decompression tables ----
+	static const CHAR g_chIndexAdjust[];
+	static const LONG g_lStepTable[];
+
+	// Format block
+	CIMAADPCMWAVEFORMAT *m_pFormat;
+
+	// Current decompressor state (array of info blocks)
+	CIMAADPCMINFO *m_pInfo;
+
+	// Utility decompression method. Note that this method relies
+	// on the pointers' validity and does not check them
+	void DecompressNibble(BYTE bCode, LONG *plSample, CHAR *pchIndex);
+
+	// Actual decompression method. Note that you should supply 
+	// to this method the compressed data block containing the 
+	// integral number of (uncompressed) samples. That means 
+	// the compressed data block should have the length being
+	// the multiple of ((nChannels * 2) / 4) bytes
+	void Decompress(const BYTE *pbInput, LONG lInputLength, SHORT *piOutput);
+
+public:
+
+	// Constructor/destructor
+	CCIMAADPCMDecoder();
+	~CCIMAADPCMDecoder();
+
+	// Format setup methods
+	HRESULT SetFormat(const CIMAADPCMWAVEFORMAT *pFormat, DWORD cbFormat);
+	void ResetFormat(void);
+	const CIMAADPCMWAVEFORMAT* GetFormat(void) { return m_pFormat; };
+
+	// Decoder state allocation (the format should be set)
+	HRESULT Initialize(void);
+
+	// Set the new initial sample and index values for all channels
+	// (the array should contain an info block for each channel)
+	void SetInitialState(const CIMAADPCMINFO *pInit);
+
+	// CBaseDecoder methods
+	HRESULT Decode(const BYTE *pbData, DWORD cbData, GMF_FRAME& frame);
+	DWORD GetMaxOutputSize(DWORD cbData) { return cbData * 4; };
+	void Cleanup(void);
+};
+
+#endif
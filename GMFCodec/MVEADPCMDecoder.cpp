@@ -0,0 +1,172 @@
+//==========================================================================
+//
+// File: MVEADPCMDecoder.cpp
+//
+// Desc: Game Media Formats - Implementation of MVE ADPCM decoder
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#include "MVEADPCMDecoder.h"
+
+//==========================================================================
+// MVE ADPCM decompression table
+//==========================================================================
+
+const SHORT CMVEADPCMDecoder::g_iStepTable[] =
+{
+         0,      1,      2,      3,      4,      5,      6,      7,
+         8,      9,     10,     11,     12,     13,     14,     15,
+        16,     17,     18,     19,     20,     21,     22,     23,
+        24,     25,     26,     27,     28,     29,     30,     31,
+        32,     33,     34,     35,     36,     37,     38,     39,
+        40,     41,     42,     43,     47,     51,     56,     61,
+        66,     72,     79,     86,     94,    102,    112,    122,
+       133,    145,    158,    173,    189,    206,    225,    245,
+       267,    292,    318,    348,    379,    414,    452,    493,
+       538,    587,    640,    699,    763,    832,    908,    991,
+      1081,   1180,   1288,   1405,   1534,   1673,   1826,   1993,
+      2175,   2373,   2590,   2826,   3084,   3365,   3672,   4008,
+      4373,   4772,   5208,   5683,   6202,   6767,   7385,   8059,
+      8794,   9597,  10472,  11428,  12471,  13609,  14851,  16206,
+     17685,  19298,  21060,  22981,  25078,  27367,  29864,  32589,
+    -29973, -26728, -23186, -19322, -15105, -10503,  -5481,     -1,
+         1,      1,   5481,  10503,  15105,  19322,  23186,  26728,
+     29973, -32589, -29864, -27367, -25078, -22981, -21060, -19298,
+    -17685, -16206, -14851, -13609, -12471, -11428, -10472,  -9597,
+     -8794,  -8059,  -7385,  -6767,  -6202,  -5683,  -5208,  -4772,
+     -4373,  -4008,  -3672,  -3365,  -3084,  -2826,  -2590,  -2373,
+     -2175,  -1993,  -1826,  -1673,  -1534,  -1405,  -1288,  -1180,
+     -1081,   -991,   -908,   -832,   -763,   -699,   -640,   -587,
+      -538,   -493,   -452,   -414,   -379,   -348,   -318,   -292,
+      -267,   -245,   -225,   -206,   -189,   -173,   -158,   -145,
+      -133,   -122,   -112,   -102,    -94,    -86,    -79,    -72,
+       -66,    -61,    -56,    -51,    -47,    -43,    -42,    -41,
+       -40,    -39,    -38,    -37,    -36,    -35,    -34,    -33,
+       -32,    -31,    -30,    -29,    -28,    -27,    -26,    -25,
+       -24,    -23,    -22,    -21,    -20,    -19,    -18,    -17,
+       -16,    -15,    -14,    -13,    -12,    -11,    -10,     -9,
+        -8,     -7,     -6,     -5,     -4,     -3,     -2,     -1
+};
+
+//==========================================================================
+// CMVEADPCMDecoder methods
+//==========================================================================
+
+CMVEADPCMDecoder::CMVEADPCMDecoder() :
+	m_pFormat(NULL)	// No format block at this time
+{
+}
+
+CMVEADPCMDecoder::~CMVEADPCMDecoder()
+{
+	// Free the format block
+	ResetFormat();
+}
+
+HRESULT CMVEADPCMDecoder::SetFormat(const MVE_AUDIO_INFO *pFormat, DWORD cbFormat)
+{
+	// Check the pointer and the format block size
+	if (pFormat == NULL)
+		return E_POINTER;
+	if (cbFormat < sizeof(MVE_AUDIO_INFO))
+		return E_INVALIDARG;
+
+	// Free the old format block and allocate a new one
+	if (m_pFormat)
+		free(m_pFormat);
+	m_pFormat = (MVE_AUDIO_INFO*)malloc(cbFormat);
+	if (m_pFormat == NULL)
+		return E_OUTOFMEMORY;
+
+	// Copy format block to the allocated storage
+	CopyMemory(m_pFormat, pFormat, cbFormat);
+
+	return NOERROR;
+}
+
+void CMVEADPCMDecoder::ResetFormat(void)
+{
+	// Free the format block
+	if (m_pFormat) {
+		free(m_pFormat);
+		m_pFormat = NULL;
+	}
+}
+
+HRESULT CMVEADPCMDecoder::Decode(const BYTE *pbData, DWORD cbData, GMF_FRAME& frame)
+{
+	// We should have the format block at this time
+	if (m_pFormat == NULL)
+		return E_UNEXPECTED;
+
+	// Set up the number of channels
+	WORD nChannels = (m_pFormat->wFlags & MVE_AUDIO_STEREO) ? 2 : 1;
+
+	// Data block starts with the initial sample values
+	if ((pbData == NULL) || (cbData < nChannels * sizeof(SHORT)))
+		return E_INVALIDARG;
+
+	// Check the output buffer
+	if ((frame.pbBuffer == NULL) || (frame.cbBuffer < GetMaxOutputSize(cbData)))
+		return E_INVALIDARG;
+
+	const BYTE *pbInBuffer = pbData;
+	LONG lInDataLength = (LONG)cbData;
+	SHORT *piOutBuffer = (SHORT*)frame.pbBuffer;
+
+	// Current sample values
+	SHORT piSample[2];
+
+	LONG lOutDataLength = 0;
+
+	// Initialize sample values
+	for (WORD i = 0; i < nChannels; i++) {
+		piSample[i] = *((SHORT*)pbInBuffer);
+		pbInBuffer += 2;
+		lInDataLength -= 2;
+		*piOutBuffer++ = piSample[i];
+		lOutDataLength += 2;
+	}
+
+	// Walk the input buffer until its length is exhausted
+	while (lInDataLength > 0) {
+
+		// Process a byte per channel for all channels
+		int i = 0;
+		for (i = 0; (i < nChannels) && (lInDataLength > 0); i++) {
+
+			// Calculate the current sample
+			piSample[i] += g_iStepTable[*pbInBuffer++];
+			lInDataLength--;
+
+			// Clip the sample value (if needed)
+			if		(piSample[i] > 32767)	piSample[i] = 32767;
+			else if	(piSample[i] < -32768)	piSample[i] = -32768;
+
+			// Place the sample into the output buffer
+			*piOutBuffer++ = piSample[i];
+			lOutDataLength += 2;
+		}
+	}
+
+	// Set the output data length
+	frame.cbData = (DWORD)lOutDataLength;
+
+	return NOERROR;
+}
@@ -0,0 +1,156 @@
+//==========================================================================
+//
+// File: ROQADPCMDecoder.cpp
+//
+// Desc: Game Media Formats - Implementation of ROQ ADPCM decoder
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#include "ROQADPCMDecoder.h"
+
+//==========================================================================
+// CROQADPCMDecoder methods
+//==========================================================================
+
+CROQADPCMDecoder::CROQADPCMDecoder() :
+	m_pFormat(NULL)	// No format block at this time
+{
+}
+
+CROQADPCMDecoder::~CROQADPCMDecoder()
+{
+	// Free the format block
+	ResetFormat();
+}
+
+HRESULT CROQADPCMDecoder::SetFormat(const ROQADPCMWAVEFORMAT *pFormat, DWORD cbFormat)
+{
+	// Check the pointer and the format block size
+	if (pFormat == NULL)
+		return E_POINTER;
+	if (cbFormat < sizeof(ROQADPCMWAVEFORMAT))
+		return E_INVALIDARG;
+
+	// We support only mono or stereo sound
+	if ((pFormat->nChannels != 1) && (pFormat->nChannels != 2))
+		return E_INVALIDARG;
+
+	// Free the old format block and allocate a new one
+	if (m_pFormat)
+		free(m_pFormat);
+	m_pFormat = (ROQADPCMWAVEFORMAT*)malloc(cbFormat);
+	if (m_pFormat == NULL)
+		return E_OUTOFMEMORY;
+
+	// Copy format block to the allocated storage
+	CopyMemory(m_pFormat, pFormat, cbFormat);
+
+	return NOERROR;
+}
+
+void CROQADPCMDecoder::ResetFormat(void)
+{
+	// Free the format block
+	if (m_pFormat) {
+		free(m_pFormat);
+		m_pFormat = NULL;
+	}
+}
+
+void CROQADPCMDecoder::Decompress(
+	WORD wInitialPrediction,
+	const BYTE *pbInput,
+	LONG lInputLength,
+	SHORT *piOutput
+)
+{
+	// Allocate the array for current sample values
+	SHORT *piSample = new SHORT[m_pFormat->nChannels];
+	if (piSample == NULL)
+		return;
+
+	// Initialize sample values
+	if (m_pFormat->nChannels == 1)
+		piSample[0] = (SHORT)wInitialPrediction;
+	else if (m_pFormat->nChannels == 2) {
+		piSample[0] = (SHORT)((WORD)HIBYTE(wInitialPrediction) << 8);
+		piSample[1] = (SHORT)((WORD)LOBYTE(wInitialPrediction) << 8);
+	} else
+		ASSERT(false); // We support only mono or stereo sound
+
+	// Walk the input buffer until its length is exhausted
+	while (lInputLength > 0) {
+
+		// Process a byte per channel for all channels
+		for (WORD i = 0; i < m_pFormat->nChannels; i++) {
+
+			// Calculate the predition error
+			SHORT iPredictionError;
+			if (*pbInput < 128)
+				iPredictionError = (*pbInput) * (*pbInput);
+			else
+				iPredictionError = - (*pbInput - 128) * (*pbInput - 128);
+			pbInput++;
+			lInputLength--;
+
+			// Calculate the current sample
+			piSample[i] += iPredictionError;
+
+			// Clip the sample value (if needed)
+			if		(piSample[i] > 32767)	piSample[i] = 32767;
+			else if	(piSample[i] < -32768)	piSample[i] = -32768;
+
+			// Place the sample into the output buffer
+			*piOutput = piSample[i];
+			piOutput++;
+		}
+	}
+
+	// Free the current sample values array
+	delete[] piSample;
+}
+
+HRESULT CROQADPCMDecoder::Decode(const BYTE *pbData, DWORD cbData, GMF_FRAME& frame)
+{
+	// We should have the format block at this time
+	if (m_pFormat == NULL)
+		return E_UNEXPECTED;
+
+	// Data block starts with the initial prediction
+	if ((pbData == NULL) || (cbData < sizeof(WORD)))
+		return E_INVALIDARG;
+
+	// Check the output buffer
+	DWORD cbOutData = (cbData - sizeof(WORD)) * 2;
+	if ((frame.pbBuffer == NULL) || (frame.cbBuffer < cbOutData))
+		return E_INVALIDARG;
+
+	// Decompress the input buffer to the output one
+	Decompress(
+		*((WORD*)pbData),
+		pbData + sizeof(WORD),
+		cbData - sizeof(WORD),
+		(SHORT*)frame.pbBuffer
+	);
+
+	// Set the output data length
+	frame.cbData = cbOutData;
+
+	return NOERROR;
+}
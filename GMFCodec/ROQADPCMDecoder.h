@@ -0,0 +1,67 @@
+//==========================================================================
+//
+// File: ROQADPCMDecoder.h
+//
+// Desc: Game Media Formats - Header file for ROQ ADPCM decoder
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#ifndef __GMF_ROQ_ADPCM_DECODER_H__
+#define __GMF_ROQ_ADPCM_DECODER_H__
+
+#include "BaseDecoder.h"
+#include "ROQSpecs.h"
+
+//==========================================================================
+// ROQ ADPCM decoder class
+//
+// The data block passed to Decode() starts with the initial prediction
+// WORD (the chunk argument) followed by the ADPCM data.
+//==========================================================================
+
+class CROQADPCMDecoder : public CBaseDecoder {
+
+	// Format block
+	ROQADPCMWAVEFORMAT *m_pFormat;
+
+	// Decompression method
+	void Decompress(
+		WORD wInitialPrediction,
+		const BYTE *pbInput,
+		LONG lInputLength,
+		SHORT *piOutput
+	);
+
+public:
+
+	// Constructor/destructor
+	CROQADPCMDecoder();
+	~CROQADPCMDecoder();
+
+	// Format setup methods
+	HRESULT SetFormat(const ROQADPCMWAVEFORMAT *pFormat, DWORD cbFormat);
+	void ResetFormat(void);
+	const ROQADPCMWAVEFORMAT* GetFormat(void) { return m_pFormat; };
+
+	// CBaseDecoder methods
+	HRESULT Decode(const BYTE *pbData, DWORD cbData, GMF_FRAME& frame);
+	DWORD GetMaxOutputSize(DWORD cbData) { return cbData * 2; };
+};
+
+#endif
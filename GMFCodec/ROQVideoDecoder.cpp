@@ -0,0 +1,588 @@
+//==========================================================================
+//
+// File: ROQVideoDecoder.cpp
+//
+// Desc: Game Media Formats - Implementation of ROQ video decoder
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#include "ROQVideoDecoder.h"
+
+// SSE2 kernels (x86/x64 only, picked at run time)
+#if (!defined(GMF_NO_SIMD)) && (defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__))
+#define GMF_ROQ_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SSE2_KERNEL
+#else
+#include <cpuid.h>
+#define SSE2_KERNEL __attribute__((target("sse2")))
+#endif
+#endif
+
+//==========================================================================
+// Motion compensation kernels
+//==========================================================================
+
+#define uiclp(i) ((i) < 0 ? 0 : ((i) > 255 ? 255 : (i)))
+#define avg2(a,b) uiclp((((int)(a)+(int)(b)+1)>>1))
+#define avg4(a,b,c,d) uiclp((((int)(a)+(int)(b)+(int)(c)+(int)(d)+2)>>2))
+
+// Copy the chroma block of the previous frame. The motion vector is
+// in the luma pixels, so the odd vector component points halfway 
+// between the chroma samples, which are interpolated then
+static void ApplyMotionChroma(BYTE *pa, const BYTE *pb, DWORD cs, int size, int iHalfPel)
+{
+	int i, j;
+
+	switch (iHalfPel) {
+
+		case 0:
+			for (i = 0; i < size; i++, pa += cs, pb += cs)
+				CopyMemory(pa, pb, size);
+			break;
+
+		case 1:
+			for (i = 0; i < size; i++, pa += cs, pb += cs)
+				for (j = 0; j < size; j++)
+					pa[j] = avg2(pb[j], pb[j+1]);
+			break;
+
+		case 2:
+			for (i = 0; i < size; i++, pa += cs, pb += cs)
+				for (j = 0; j < size; j++)
+					pa[j] = avg2(pb[j], pb[cs+j]);
+			break;
+
+		case 3:
+			for (i = 0; i < size; i++, pa += cs, pb += cs)
+				for (j = 0; j < size; j++)
+					pa[j] = avg4(pb[j], pb[j+1], pb[cs+j], pb[cs+j+1]);
+			break;
+	}
+}
+
+// Generic 8x8 motion compensation kernel. The luma rows are moved 
+// as a whole
+static void ApplyMotion8x8Generic(
+	BYTE *pbY,
+	const BYTE *pbPrevY,
+	BYTE *pbV,
+	const BYTE *pbPrevV,
+	DWORD cbCPlane,
+	DWORD cbYStride,
+	DWORD cbCStride,
+	int iHalfPel
+)
+{
+	for (int i = 0; i < 8; i++, pbY += cbYStride, pbPrevY += cbYStride)
+		CopyMemory(pbY, pbPrevY, 8);
+
+	ApplyMotionChroma(pbV, pbPrevV, cbCStride, 4, iHalfPel);
+	ApplyMotionChroma(pbV + cbCPlane, pbPrevV + cbCPlane, cbCStride, 4, iHalfPel);
+}
+
+#ifdef GMF_ROQ_SSE2
+
+// Load/store 4x4 chroma block as a vector (a row per dword)
+SSE2_KERNEL static inline __m128i LoadChroma4x4(const BYTE *pb, DWORD cs)
+{
+	int pRows[4];
+	for (int i = 0; i < 4; i++, pb += cs)
+		CopyMemory(&pRows[i], pb, 4);
+	return _mm_set_epi32(pRows[3], pRows[2], pRows[1], pRows[0]);
+}
+
+SSE2_KERNEL static inline void StoreChroma4x4(BYTE *pa, DWORD cs, __m128i xmmBlock)
+{
+	for (int i = 0; i < 4; i++, pa += cs) {
+		int iRow = _mm_cvtsi128_si32(xmmBlock);
+		CopyMemory(pa, &iRow, 4);
+		xmmBlock = _mm_srli_si128(xmmBlock, 4);
+	}
+}
+
+// SSE2 8x8 motion compensation kernel. The luma rows are moved with
+// the 64-bit loads/stores, the chroma is interpolated 16 samples at
+// a time (the 4-sample average is done in 16 bits to round it the 
+// same way as the generic kernel does)
+SSE2_KERNEL static void ApplyMotion8x8SSE2(
+	BYTE *pbY,
+	const BYTE *pbPrevY,
+	BYTE *pbV,
+	const BYTE *pbPrevV,
+	DWORD cbCPlane,
+	DWORD cbYStride,
+	DWORD cbCStride,
+	int iHalfPel
+)
+{
+	for (int i = 0; i < 8; i++, pbY += cbYStride, pbPrevY += cbYStride)
+		_mm_storel_epi64((__m128i*)pbY, _mm_loadl_epi64((const __m128i*)pbPrevY));
+
+	if (iHalfPel == 0) {
+		ApplyMotionChroma(pbV, pbPrevV, cbCStride, 4, 0);
+		ApplyMotionChroma(pbV + cbCPlane, pbPrevV + cbCPlane, cbCStride, 4, 0);
+		return;
+	}
+
+	const __m128i xmmZero = _mm_setzero_si128();
+	const __m128i xmmTwo = _mm_set1_epi16(2);
+
+	for (int k = 0; k < 2; k++, pbV += cbCPlane, pbPrevV += cbCPlane) {
+
+		__m128i xmmBlock = LoadChroma4x4(pbPrevV, cbCStride);
+
+		if (iHalfPel == 1)
+			xmmBlock = _mm_avg_epu8(xmmBlock, LoadChroma4x4(pbPrevV + 1, cbCStride));
+		else if (iHalfPel == 2)
+			xmmBlock = _mm_avg_epu8(xmmBlock, LoadChroma4x4(pbPrevV + cbCStride, cbCStride));
+		else {
+			__m128i xmmRight = LoadChroma4x4(pbPrevV + 1, cbCStride);
+			__m128i xmmDown = LoadChroma4x4(pbPrevV + cbCStride, cbCStride);
+			__m128i xmmDownRight = LoadChroma4x4(pbPrevV + cbCStride + 1, cbCStride);
+			__m128i xmmLo = _mm_add_epi16(
+				_mm_add_epi16(_mm_unpacklo_epi8(xmmBlock, xmmZero), _mm_unpacklo_epi8(xmmRight, xmmZero)),
+				_mm_add_epi16(_mm_unpacklo_epi8(xmmDown, xmmZero), _mm_unpacklo_epi8(xmmDownRight, xmmZero))
+			);
+			__m128i xmmHi = _mm_add_epi16(
+				_mm_add_epi16(_mm_unpackhi_epi8(xmmBlock, xmmZero), _mm_unpackhi_epi8(xmmRight, xmmZero)),
+				_mm_add_epi16(_mm_unpackhi_epi8(xmmDown, xmmZero), _mm_unpackhi_epi8(xmmDownRight, xmmZero))
+			);
+			xmmLo = _mm_srli_epi16(_mm_add_epi16(xmmLo, xmmTwo), 2);
+			xmmHi = _mm_srli_epi16(_mm_add_epi16(xmmHi, xmmTwo), 2);
+			xmmBlock = _mm_packus_epi16(xmmLo, xmmHi);
+		}
+
+		StoreChroma4x4(pbV, cbCStride, xmmBlock);
+	}
+}
+
+// Check if the processor supports SSE2
+static BOOL IsSSE2Supported(void)
+{
+#if defined(_M_X64) || defined(__x86_64__)
+	// All x64 processors do
+	return TRUE;
+#elif defined(_MSC_VER)
+	int pInfo[4];
+	__cpuid(pInfo, 1);
+	return (pInfo[3] & (1 << 26)) != 0;
+#else
+	unsigned int uEAX, uEBX, uECX, uEDX;
+	return (__get_cpuid(1, &uEAX, &uEBX, &uECX, &uEDX)) && ((uEDX & bit_SSE2) != 0);
+#endif
+}
+
+#endif
+
+//==========================================================================
+// CROQVideoDecoder methods
+//==========================================================================
+
+CROQVideoDecoder::CROQVideoDecoder() :
+	m_pFormat(NULL),		// No format block at this time
+	m_pPreviousFrame(NULL),	// No previous frame buffer at this time
+	m_pCurrentFrame(NULL),	// No current frame buffer at this time
+	m_wYStride(0),			// |
+	m_wCStride(0),			// | -- No image strides at this time
+	m_pfnApplyMotion8x8(NULL)	// No kernel at this time
+{
+	ZeroMemory(m_Cells, 256 * sizeof(ROQ_CELL));
+	ZeroMemory(m_QCells, 256 * sizeof(ROQ_QCELL));
+}
+
+CROQVideoDecoder::~CROQVideoDecoder()
+{
+	// Free the frame buffers
+	Cleanup();
+
+	// Free the format block
+	ResetFormat();
+}
+
+HRESULT CROQVideoDecoder::SetFormat(const ROQ_VIDEO_FORMAT *pFormat, DWORD cbFormat)
+{
+	// Check the pointer and the format block size
+	if (pFormat == NULL)
+		return E_POINTER;
+	if (cbFormat < sizeof(ROQ_VIDEO_FORMAT))
+		return E_INVALIDARG;
+
+	// Free the old format block and allocate a new one
+	if (m_pFormat)
+		free(m_pFormat);
+	m_pFormat = (ROQ_VIDEO_FORMAT*)malloc(cbFormat);
+	if (m_pFormat == NULL)
+		return E_OUTOFMEMORY;
+
+	// Copy format block to the allocated storage
+	CopyMemory(m_pFormat, pFormat, cbFormat);
+
+	// Set up image parameters (strides)
+	m_wYStride = m_pFormat->wWidth;
+	m_wCStride = m_pFormat->wWidth / 2;
+
+	return NOERROR;
+}
+
+void CROQVideoDecoder::ResetFormat(void)
+{
+	// Free the format block
+	if (m_pFormat) {
+		free(m_pFormat);
+		m_pFormat = NULL;
+	}
+}
+
+DWORD CROQVideoDecoder::GetFrameSize(void)
+{
+	if (m_pFormat == NULL)
+		return 0;
+
+	return (m_pFormat->wWidth * m_pFormat->wHeight * 12) / 8; // 12 bits per pixel
+}
+
+HRESULT CROQVideoDecoder::Initialize(void)
+{
+	// We should have the format block at this time
+	if (m_pFormat == NULL)
+		return E_UNEXPECTED;
+
+	// Free the buffers left from the previous session (if any)
+	Cleanup();
+
+	// Allocate frame buffers (YV12 as the output frame)
+	DWORD cbFrame = GetFrameSize();
+	m_pPreviousFrame = (BYTE*)malloc(cbFrame);
+	if (m_pPreviousFrame == NULL)
+		return E_OUTOFMEMORY;
+	m_pCurrentFrame = (BYTE*)malloc(cbFrame);
+	if (m_pCurrentFrame == NULL) {
+		Cleanup();
+		return E_OUTOFMEMORY;
+	}
+
+	// Pick the motion compensation kernel
+	m_pfnApplyMotion8x8 = ApplyMotion8x8Generic;
+#ifdef GMF_ROQ_SSE2
+	if (IsSSE2Supported())
+		m_pfnApplyMotion8x8 = ApplyMotion8x8SSE2;
+#endif
+
+	// Zero frame buffers memory and the codebooks
+	ZeroMemory(m_pPreviousFrame, cbFrame);
+	ZeroMemory(m_pCurrentFrame, cbFrame);
+	ZeroMemory(m_Cells, 256 * sizeof(ROQ_CELL));
+	ZeroMemory(m_QCells, 256 * sizeof(ROQ_QCELL));
+
+	return NOERROR;
+}
+
+void CROQVideoDecoder::Cleanup(void)
+{
+	// Free the previous frame buffer
+	if (m_pPreviousFrame) {
+		free(m_pPreviousFrame);
+		m_pPreviousFrame = NULL;
+	}
+
+	// Free the current frame buffer
+	if (m_pCurrentFrame) {
+		free(m_pCurrentFrame);
+		m_pCurrentFrame = NULL;
+	}
+}
+
+HRESULT CROQVideoDecoder::Decode(const BYTE *pbData, DWORD cbData, GMF_FRAME& frame)
+{
+	// We should be initialized at this time
+	if ((m_pFormat == NULL) || (m_pCurrentFrame == NULL))
+		return E_UNEXPECTED;
+
+	// Reset the output frame info
+	frame.cbData = 0;
+	frame.pPalette = NULL;
+	frame.iPaletteStart = 0;
+	frame.nPaletteEntries = 0;
+
+	// Data block starts with the chunk header
+	if ((pbData == NULL) || (cbData < sizeof(ROQ_CHUNK_HEADER)))
+		return E_INVALIDARG;
+	const ROQ_CHUNK_HEADER *pHeader = (const ROQ_CHUNK_HEADER*)pbData;
+	const BYTE *pbInBuffer = pbData + sizeof(ROQ_CHUNK_HEADER);
+	DWORD cbChunk = cbData - sizeof(ROQ_CHUNK_HEADER);
+	if (pHeader->cbSize < cbChunk)
+		cbChunk = pHeader->cbSize;
+
+	// Fill in the codebooks if we have to
+	if (pHeader->wID == ROQ_CHUNK_VIDEO_CODEBOOK) {
+
+		// Extract codebook sizes
+		WORD nCells = HIBYTE(pHeader->wArgument);
+		if (nCells == 0)
+			nCells = 256;
+		WORD nQCells = LOBYTE(pHeader->wArgument);
+		if ((nQCells == 0) && (nCells * sizeof(ROQ_CELL) < pHeader->cbSize))
+			nQCells = 256;
+
+		// Sanity check of the codebooks size
+		if (nCells * sizeof(ROQ_CELL) + nQCells * sizeof(ROQ_QCELL) > cbChunk)
+			return E_UNEXPECTED;
+
+		// Copy 2x2 codebook
+		CopyMemory(m_Cells, pbInBuffer, nCells * sizeof(ROQ_CELL));
+		pbInBuffer += nCells * sizeof(ROQ_CELL);
+
+		// Copy 4x4 codebook
+		CopyMemory(m_QCells, pbInBuffer, nQCells * sizeof(ROQ_QCELL));
+
+		// We should not deliver any frame
+		return S_FALSE;
+
+	}
+
+	// Now it must be video frame chunk
+	if (pHeader->wID != ROQ_CHUNK_VIDEO_FRAME)
+		return S_FALSE;
+
+	// Check the output buffer
+	DWORD cbFrame = GetFrameSize();
+	if ((frame.pbBuffer == NULL) || (frame.cbBuffer < cbFrame))
+		return E_INVALIDARG;
+
+	// Call the decoder function to decompress the frame
+	ROQVideoDecodeFrame(
+		pbInBuffer,
+		cbChunk,
+		pHeader->wArgument
+	);
+
+	// Copy the frame to the output buffer
+	CopyMemory(frame.pbBuffer, m_pCurrentFrame, cbFrame);
+
+	// Swap frame buffers if it's not the first frame
+	if (frame.iFrame == 0)
+		CopyMemory(m_pPreviousFrame, m_pCurrentFrame, cbFrame);
+	else {
+		BYTE *pTemp = m_pPreviousFrame;
+		m_pPreviousFrame = m_pCurrentFrame;
+		m_pCurrentFrame = pTemp;
+	}
+
+	// The data length is the uncompressed frame size
+	frame.cbData = cbFrame;
+
+	return NOERROR;
+}
+
+//==========================================================================
+// ROQ video decoder methods implementation.
+// Source code taken from roqvideo.c
+// by Dr. Tim Ferguson (timf@csse.monash.edu.au)
+//==========================================================================
+
+void CROQVideoDecoder::ApplyVector2x2(int x, int y, ROQ_CELL *cell)
+{
+	unsigned char *yptr;
+
+	// Luma rows go as a whole
+	yptr = GetYPlane(m_pCurrentFrame) + (y * m_wYStride) + x;
+	CopyMemory(yptr, &cell->y0, 2);
+	CopyMemory(yptr + m_wYStride, &cell->y2, 2);
+
+	// The 2x2 cell has a single chroma sample
+	GetUPlane(m_pCurrentFrame)[(y/2) * (m_wCStride) + x/2] = cell->u;
+	GetVPlane(m_pCurrentFrame)[(y/2) * (m_wCStride) + x/2] = cell->v;
+}
+
+void CROQVideoDecoder::ApplyVector4x4(int x, int y, ROQ_CELL *cell)
+{
+	unsigned char *yptr, *uptr, *vptr;
+	unsigned char row[4];
+
+	yptr = GetYPlane(m_pCurrentFrame) + (y * m_wYStride) + x;
+	uptr = GetUPlane(m_pCurrentFrame) + (y/2) * (m_wCStride) + x/2;
+	vptr = GetVPlane(m_pCurrentFrame) + (y/2) * (m_wCStride) + x/2;
+
+	// Each cell pixel covers 2x2 luma pixels, so there are two
+	// distinct luma rows, each written twice
+	row[0] = row[1] = cell->y0;
+	row[2] = row[3] = cell->y1;
+	CopyMemory(yptr, row, 4);
+	CopyMemory(yptr + m_wYStride, row, 4);
+	row[0] = row[1] = cell->y2;
+	row[2] = row[3] = cell->y3;
+	CopyMemory(yptr + 2 * m_wYStride, row, 4);
+	CopyMemory(yptr + 3 * m_wYStride, row, 4);
+
+	// The chroma is the same over the 2x2 samples
+	uptr[0] = uptr[1] = uptr[m_wCStride] = uptr[m_wCStride + 1] = cell->u;
+	vptr[0] = vptr[1] = vptr[m_wCStride] = vptr[m_wCStride + 1] = cell->v;
+}
+
+
+void CROQVideoDecoder::ApplyMotion4x4(int x, int y, unsigned char mv, char mean_x, char mean_y)
+{
+	int i, mx, my;
+	unsigned char *pa;
+	const unsigned char *pb;
+
+	mx = x + 8 - (mv >> 4) - mean_x;
+	my = y + 8 - (mv & 0xf) - mean_y;
+
+	// The 4x4 block rows are too short for the SIMD kernels
+	// to make a difference, so the rows just go as a whole
+	pa = GetYPlane(m_pCurrentFrame) + (y * m_wYStride) + x;
+	pb = GetYPlane(m_pPreviousFrame) + (my * m_wYStride) + mx;
+	for (i = 0; i < 4; i++, pa += m_wYStride, pb += m_wYStride)
+		CopyMemory(pa, pb, 4);
+
+	ApplyMotionChroma(
+		GetUPlane(m_pCurrentFrame) + (y/2) * (m_wCStride) + x/2,
+		GetUPlane(m_pPreviousFrame) + (my >> 1) * (m_wCStride) + (mx >> 1),
+		m_wCStride,
+		2,
+		((my & 0x01) << 1) | (mx & 0x01)
+	);
+	ApplyMotionChroma(
+		GetVPlane(m_pCurrentFrame) + (y/2) * (m_wCStride) + x/2,
+		GetVPlane(m_pPreviousFrame) + (my >> 1) * (m_wCStride) + (mx >> 1),
+		m_wCStride,
+		2,
+		((my & 0x01) << 1) | (mx & 0x01)
+	);
+}
+
+void CROQVideoDecoder::ApplyMotion8x8(int x, int y, unsigned char mv, char mean_x, char mean_y)
+{
+	int mx, my;
+
+	mx = x + 8 - (mv >> 4) - mean_x;
+	my = y + 8 - (mv & 0xf) - mean_y;
+
+	m_pfnApplyMotion8x8(
+		GetYPlane(m_pCurrentFrame) + (y * m_wYStride) + x,
+		GetYPlane(m_pPreviousFrame) + (my * m_wYStride) + mx,
+		GetVPlane(m_pCurrentFrame) + (y/2) * (m_wCStride) + x/2,
+		GetVPlane(m_pPreviousFrame) + (my >> 1) * (m_wCStride) + (mx >> 1),
+		(DWORD)(GetUPlane(m_pCurrentFrame) - GetVPlane(m_pCurrentFrame)),
+		m_wYStride,
+		m_wCStride,
+		((my & 0x01) << 1) | (mx & 0x01)
+	);
+}
+
+#define RoQ_ID_MOT	0x00
+#define RoQ_ID_FCC	0x01
+#define RoQ_ID_SLD	0x02
+#define RoQ_ID_CCC	0x03
+
+void CROQVideoDecoder::ROQVideoDecodeFrame(
+	const BYTE *pbData,
+	DWORD dwSize,
+	WORD wArgument
+)
+{
+	int k, vqflg = 0, vqflg_pos = -1;
+	int vqid, xpos, ypos, xp, yp, x, y;
+	DWORD bpos;
+	ROQ_QCELL *qcell;
+
+	bpos = xpos = ypos = 0;
+	while (bpos < dwSize) {
+		for (yp = ypos; yp < ypos + 16; yp += 8)
+			for (xp = xpos; xp < xpos + 16; xp += 8) {
+				if (vqflg_pos < 0) {
+					vqflg = pbData[bpos++];
+					vqflg |= (pbData[bpos++] << 8);
+					vqflg_pos = 7;
+				}
+				vqid = (vqflg >> (vqflg_pos * 2)) & 0x3;
+				vqflg_pos--;
+
+				switch (vqid) {
+					case RoQ_ID_MOT:
+						// Skip the block
+						/* ApplyMotion8x8(xp, yp, 0, 8, 8); */
+						break;
+					case RoQ_ID_FCC:
+						ApplyMotion8x8(xp, yp, pbData[bpos++], wArgument >> 8, wArgument & 0xff);
+						break;
+					case RoQ_ID_SLD:
+						qcell = m_QCells + pbData[bpos++];
+						ApplyVector4x4(xp, yp, m_Cells + qcell->idx[0]);
+						ApplyVector4x4(xp+4, yp, m_Cells + qcell->idx[1]);
+						ApplyVector4x4(xp, yp+4, m_Cells + qcell->idx[2]);
+						ApplyVector4x4(xp+4, yp+4, m_Cells + qcell->idx[3]);
+						break;
+					case RoQ_ID_CCC:
+						for (k = 0; k < 4; k++) {
+							x = xp; y = yp;
+							if (k & 0x01) x += 4;
+							if (k & 0x02) y += 4;
+
+							if (vqflg_pos < 0) {
+								vqflg = pbData[bpos++];
+								vqflg |= (pbData[bpos++] << 8);
+								vqflg_pos = 7;
+							}
+							vqid = (vqflg >> (vqflg_pos * 2)) & 0x3;
+							vqflg_pos--;
+							switch (vqid) {
+								case RoQ_ID_MOT:
+									// Skip the block
+									/* ApplyMotion4x4(x, y, 0, 8, 8); */
+									break;
+								case RoQ_ID_FCC:
+									ApplyMotion4x4(x, y, pbData[bpos++], wArgument >> 8, wArgument & 0xff);
+									break;
+								case RoQ_ID_SLD:
+									qcell = m_QCells + pbData[bpos++];
+									ApplyVector2x2(x, y, m_Cells + qcell->idx[0]);
+									ApplyVector2x2(x+2, y, m_Cells + qcell->idx[1]);
+									ApplyVector2x2(x, y+2, m_Cells + qcell->idx[2]);
+									ApplyVector2x2(x+2, y+2, m_Cells + qcell->idx[3]);
+									break;
+								case RoQ_ID_CCC:
+									ApplyVector2x2(x, y, m_Cells + pbData[bpos]);
+									ApplyVector2x2(x+2, y, m_Cells + pbData[bpos+1]);
+									ApplyVector2x2(x, y+2, m_Cells + pbData[bpos+2]);
+									ApplyVector2x2(x+2, y+2, m_Cells + pbData[bpos+3]);
+									bpos += 4;
+									break;
+							}
+						}
+						break;
+					default:
+						// Unknown VQ code
+						break;
+				}
+			}
+
+		xpos += 16;
+		if (xpos >= m_pFormat->wWidth) {
+			xpos -= m_pFormat->wWidth;
+			ypos += 16;
+		}
+		if (ypos >= m_pFormat->wHeight)
+			break;
+	}
+}
@@ -0,0 +1,116 @@
+//==========================================================================
+//
+// File: ROQVideoDecoder.h
+//
+// Desc: Game Media Formats - Header file for ROQ video decoder
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#ifndef __GMF_ROQ_VIDEO_DECODER_H__
+#define __GMF_ROQ_VIDEO_DECODER_H__
+
+#include "BaseDecoder.h"
+#include "ROQSpecs.h"
+
+//==========================================================================
+// ROQ video decoder class
+//
+// The data block passed to Decode() is the whole ROQ chunk (including
+// the chunk header). Codebook chunks update the codebooks and produce
+// no output. The output frame is YV12 (12 bits per pixel), and so are
+// the working frames: the chroma is kept at the quarter resolution, and
+// the motion vectors with the odd components take the chroma halfway
+// between the samples of the previous frame.
+//==========================================================================
+
+class CROQVideoDecoder : public CBaseDecoder {
+
+	// Motion compensation kernel. It copies the block of the previous
+	// frame, the chroma being interpolated when the motion vector has
+	// the odd components (bit 0 of iHalfPel for X, bit 1 for Y)
+	typedef void (*PFN_APPLY_MOTION)(
+		BYTE *pbY,				// Luma block in the current frame
+		const BYTE *pbPrevY,	// Luma block in the previous frame
+		BYTE *pbV,				// V block in the current frame
+		const BYTE *pbPrevV,	// V block in the previous frame
+		DWORD cbCPlane,			// Offset of the U plane from the V one
+		DWORD cbYStride,		// Luma stride
+		DWORD cbCStride,		// Chroma stride
+		int iHalfPel			// Chroma half-pel flags
+	);
+
+	// ---- ROQ video decoder stuff ----
+	// Source code taken from roqvideo.c
+	// by Dr. Tim Ferguson (timf@csse.monash.edu.au)
+
+	// Previous frame data
+	BYTE *m_pPreviousFrame, *m_pCurrentFrame;
+
+	// Strides for Y and Cb/Cr planes
+	WORD m_wYStride;
+	WORD m_wCStride;
+
+	// 2x2 and 4x4 codebooks
+	ROQ_CELL m_Cells[256];
+	ROQ_QCELL m_QCells[256];
+
+	// Format block
+	ROQ_VIDEO_FORMAT *m_pFormat;
+
+	// 8x8 motion compensation kernel (picked for the processor)
+	PFN_APPLY_MOTION m_pfnApplyMotion8x8;
+
+	// ---- ROQ video decoder methods ----
+	// Source code taken from roqvideo.c 
+	// by Dr. Tim Ferguson (timf@csse.monash.edu.au)
+	void ApplyVector2x2(int x, int y, ROQ_CELL *cell);
+	void ApplyVector4x4(int x, int y, ROQ_CELL *cell);
+	void ApplyMotion4x4(int x, int y, unsigned char mv, char mean_x, char mean_y);
+	void ApplyMotion8x8(int x, int y, unsigned char mv, char mean_x, char mean_y);
+	void ROQVideoDecodeFrame(const BYTE *pbData, DWORD dwSize, WORD wArgument);
+
+	// Utility YUV plane pointers methods (the frames are YV12)
+	inline BYTE* GetYPlane(BYTE *pbImage) { return pbImage; };
+	inline BYTE* GetUPlane(BYTE *pbImage) { return pbImage + 5 * m_pFormat->wWidth * m_pFormat->wHeight / 4; };
+	inline BYTE* GetVPlane(BYTE *pbImage) { return pbImage + m_pFormat->wWidth * m_pFormat->wHeight; };
+
+public:
+
+	// Constructor/destructor
+	CROQVideoDecoder();
+	~CROQVideoDecoder();
+
+	// Format setup methods
+	HRESULT SetFormat(const ROQ_VIDEO_FORMAT *pFormat, DWORD cbFormat);
+	void ResetFormat(void);
+	const ROQ_VIDEO_FORMAT* GetFormat(void) { return m_pFormat; };
+
+	// Uncompressed frame size
+	DWORD GetFrameSize(void);
+
+	// Decoder buffers allocation (the format should be set)
+	HRESULT Initialize(void);
+
+	// CBaseDecoder methods
+	HRESULT Decode(const BYTE *pbData, DWORD cbData, GMF_FRAME& frame);
+	DWORD GetMaxOutputSize(DWORD cbData) { return GetFrameSize(); };
+	void Cleanup(void);
+};
+
+#endif
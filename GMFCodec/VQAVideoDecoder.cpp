@@ -0,0 +1,1179 @@
+//==========================================================================
+//
+// File: VQAVideoDecoder.cpp
+//
+// Desc: Game Media Formats - Implementation of VQA video decoder
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#include "VQAVideoDecoder.h"
+
+#define LE_16(x) (*((WORD*)(x)))
+
+// The smallest 8-bit frame (in blocks) worth splitting into bands, and
+// the number of bands per thread (so the threads finish close together)
+#define VQA_MIN_TILED_BLOCKS	8192
+#define VQA_BANDS_PER_THREAD	4
+
+//==========================================================================
+// Block fill kernels. The real VQAs use 4x2 and 4x4 blocks, so there are
+// kernels with the block geometry fixed at compile time for them: each
+// block row is a single 32-bit (8-bit video) or 64-bit (HiColor video)
+// load and store, and the rows are unrolled. The other geometries are
+// handled by the generic kernels
+//==========================================================================
+
+static void FillBlockGeneric(
+	BYTE *pbImage,
+	const BYTE *pbBlock,
+	DWORD cbImageXStride,
+	DWORD nRows,
+	DWORD cbRow
+)
+{
+	for (DWORD i = 0; i < nRows; i++) {
+		CopyMemory(pbImage, pbBlock, cbRow);
+		pbImage += cbImageXStride;
+		pbBlock += cbRow;
+	}
+}
+
+static void FillBlockSolidGeneric(
+	BYTE *pbImage,
+	BYTE bColor,
+	DWORD cbImageXStride,
+	DWORD nRows,
+	DWORD cbRow
+)
+{
+	for (DWORD i = 0; i < nRows; i++) {
+		FillMemory(pbImage, cbRow, bColor);
+		pbImage += cbImageXStride;
+	}
+}
+
+// The constant size copies compile to plain loads and stores (and 
+// they do not care about the alignment of the image and codebook)
+template <DWORD nRows, DWORD cbRow>
+static void FillBlockFixed(
+	BYTE *pbImage,
+	const BYTE *pbBlock,
+	DWORD cbImageXStride,
+	DWORD,
+	DWORD
+)
+{
+	for (DWORD i = 0; i < nRows; i++)
+		CopyMemory(pbImage + i * cbImageXStride, pbBlock + i * cbRow, cbRow);
+}
+
+// The solid blocks are 8-bit only, so the color is broadcast to 
+// the 4-pixel row once and stored as is
+template <DWORD nRows>
+static void FillBlockSolidFixed(
+	BYTE *pbImage,
+	BYTE bColor,
+	DWORD cbImageXStride,
+	DWORD,
+	DWORD
+)
+{
+	DWORD dwRow = 0x01010101 * bColor;
+	for (DWORD i = 0; i < nRows; i++)
+		CopyMemory(pbImage + i * cbImageXStride, &dwRow, sizeof(dwRow));
+}
+
+//==========================================================================
+// CVQAVideoDecoder methods
+//==========================================================================
+
+CVQAVideoDecoder::CVQAVideoDecoder() :
+	m_pCurrentFrame(NULL),				// No frame buffer at this time
+	m_bIsFrameDecoded(FALSE),			// No frame decoded at this time
+	m_cbPalette(0),						// No palette data at this time
+	m_pDecodeBuffer(NULL),				// No decode buffer at this time
+	m_cbMaxDecodeBuffer(0),				// No decode buffer size at this time
+	m_pCodebook(NULL),					// No current codebook at this time
+	m_pNextCodebook(NULL),				// No next codebook at this time
+	m_cbNextCodebook(0),				// No next codebook parts at this time
+	m_nNextCodebookParts(0),			// No next codebook parts at this time
+	m_bIsNextCodebookCompressed(FALSE),	// Default: non-compressed codebook
+	m_bIsNextCodebookDecoding(FALSE),	// No next codebook parts at this time
+	m_pDecodedCodebook(NULL),			// No decompressed codebook at this time
+	m_bSolidColorMarker(0),				// No solid color marker at this time
+	m_pFormat(NULL),					// No format block at this time
+	m_pCodebookTable(NULL),				// No codebook descriptor table
+	m_nCodebooks(0),					// No codebook descriptor table
+	m_pbCodebookFrames(NULL),			// No codebook switch bitmap
+	m_nCodebookFrames(0),				// No codebook switch bitmap
+	m_nBlocksX(0),						// |
+	m_nBlocksY(0),						// |
+	m_nBlocks(0),						// |
+	m_cbBlock(0),						// |-- No image/block parameters at this time
+	m_cbBlockStride(0),					// |
+	m_cbImageXStride(0),				// |
+	m_cbImageYStride(0),				// |
+	m_pfnFillBlock(FillBlockGeneric),			// Generic kernels at this time
+	m_pfnFillBlockSolid(FillBlockSolidGeneric),	// Generic kernels at this time
+	m_nThreads(1)						// Default: serial decoding
+{
+	ZeroMemory(m_Palette, sizeof(m_Palette));
+}
+
+CVQAVideoDecoder::~CVQAVideoDecoder()
+{
+	// Perform decoder clean-up
+	Cleanup();
+
+	// Free the format block
+	ResetFormat();
+}
+
+HRESULT CVQAVideoDecoder::SetFormat(const VQA_INFO *pFormat, DWORD cbFormat)
+{
+	// Check the pointer and the format block size
+	if (pFormat == NULL)
+		return E_POINTER;
+	if (cbFormat < sizeof(VQA_INFO))
+		return E_INVALIDARG;
+
+	// Check the values we're going to divide by
+	if (
+		(pFormat->bBlockWidth == 0) ||
+		(pFormat->bBlockHeight == 0)
+	)
+		return E_INVALIDARG;
+
+	// Free the old format block and allocate a new one
+	ResetFormat();
+	m_pFormat = (VQA_INFO*)malloc(cbFormat);
+	if (m_pFormat == NULL)
+		return E_OUTOFMEMORY;
+
+	// Copy format block to the allocated storage
+	CopyMemory(m_pFormat, pFormat, cbFormat);
+
+	// Set up full codebook table
+	m_nCodebooks = (cbFormat - sizeof(VQA_INFO)) / sizeof(VQA_CIND_ENTRY);
+	m_pCodebookTable = (m_nCodebooks > 0) ? (VQA_CIND_ENTRY*)((BYTE*)m_pFormat + sizeof(VQA_INFO)) : NULL;
+
+	// The 8-bit video without the codebook parts count switches to 
+	// the new codebook at the frames listed in the table, so turn the
+	// table into the frame-indexed bitmap to look the frames up at 
+	// once. The lookup depends on the frame index only, so it does
+	// not care about seeking
+	if ((m_pFormat->nCBParts == 0) && (m_pFormat->nColors != 0) && (m_nCodebooks > 0)) {
+
+		// Find out how many frames the bitmap should cover
+		DWORD i = 0;
+		for (i = 0; i < m_nCodebooks; i++)
+			if ((m_pCodebookTable[i].cbSize != 0) && (m_pCodebookTable[i].iFrame >= m_nCodebookFrames))
+				m_nCodebookFrames = m_pCodebookTable[i].iFrame + 1;
+
+		// Allocate and fill in the bitmap
+		if (m_nCodebookFrames > 0) {
+			m_pbCodebookFrames = (BYTE*)malloc((m_nCodebookFrames + 7) / 8);
+			if (m_pbCodebookFrames == NULL) {
+				ResetFormat();
+				return E_OUTOFMEMORY;
+			}
+			ZeroMemory(m_pbCodebookFrames, (m_nCodebookFrames + 7) / 8);
+			for (i = 0; i < m_nCodebooks; i++)
+				if (m_pCodebookTable[i].cbSize != 0)
+					m_pbCodebookFrames[m_pCodebookTable[i].iFrame / 8] |= 1 << (m_pCodebookTable[i].iFrame % 8);
+		}
+	}
+
+	// Set up the solid color marker byte
+	m_bSolidColorMarker = (
+							(m_pFormat->bBlockHeight == 4) ||
+							(m_pFormat->wVersion == 1)
+						) ? 0xFF : 0x0F;
+
+	// Set up block/image parameters
+	WORD cbPixel = ((m_pFormat->nColors == 0) ? 2 : 1);
+	m_nBlocksX = m_pFormat->wVideoWidth / m_pFormat->bBlockWidth;
+	m_nBlocksY = m_pFormat->wVideoHeight / m_pFormat->bBlockHeight;
+	m_nBlocks = m_nBlocksX * m_nBlocksY;
+	m_cbBlock = m_pFormat->bBlockWidth * m_pFormat->bBlockHeight * cbPixel;
+	m_cbBlockStride = m_pFormat->bBlockWidth * cbPixel;
+	m_cbImageXStride = m_pFormat->wVideoWidth * cbPixel;
+	m_cbImageYStride = m_cbImageXStride * (m_pFormat->bBlockHeight - 1);
+
+	// Select the block fill kernels for the block geometry
+	if ((m_pFormat->bBlockWidth == 4) && (m_pFormat->bBlockHeight == 2)) {
+		m_pfnFillBlock		= (cbPixel == 1) ? FillBlockFixed<2, 4> : FillBlockFixed<2, 8>;
+		m_pfnFillBlockSolid	= FillBlockSolidFixed<2>;
+	} else if ((m_pFormat->bBlockWidth == 4) && (m_pFormat->bBlockHeight == 4)) {
+		m_pfnFillBlock		= (cbPixel == 1) ? FillBlockFixed<4, 4> : FillBlockFixed<4, 8>;
+		m_pfnFillBlockSolid	= FillBlockSolidFixed<4>;
+	}
+
+	return NOERROR;
+}
+
+void CVQAVideoDecoder::ResetFormat(void)
+{
+	// Free the format block
+	if (m_pFormat) {
+		free(m_pFormat);
+		m_pFormat = NULL;
+	}
+
+	// Reset codebook descriptor table
+	m_pCodebookTable = NULL;
+	m_nCodebooks = 0;
+
+	// Free the codebook switch bitmap
+	if (m_pbCodebookFrames) {
+		free(m_pbCodebookFrames);
+		m_pbCodebookFrames = NULL;
+	}
+	m_nCodebookFrames = 0;
+
+	// Reset format-specific parameters
+	m_bSolidColorMarker = 0;
+	m_nBlocksX = 0;
+	m_nBlocksY = 0;
+	m_nBlocks = 0;
+	m_cbBlock = 0;
+	m_cbBlockStride = 0;
+	m_cbImageXStride = 0;
+	m_cbImageYStride = 0;
+	m_pfnFillBlock = FillBlockGeneric;
+	m_pfnFillBlockSolid = FillBlockSolidGeneric;
+}
+
+DWORD CVQAVideoDecoder::GetFrameSize(void)
+{
+	if (m_pFormat == NULL)
+		return 0;
+
+	return m_pFormat->wVideoWidth * m_pFormat->wVideoHeight * ((m_pFormat->nColors == 0) ? 2 : 1);
+}
+
+HRESULT CVQAVideoDecoder::Initialize(void)
+{
+	// We should have the format block at this time
+	if (m_pFormat == NULL)
+		return E_UNEXPECTED;
+
+	// Free the buffers left from the previous session (if any)
+	Cleanup();
+
+	// Allocate frame buffer (for HiColor video only)
+	if (m_pFormat->nColors == 0) {
+		DWORD cbFrame = GetFrameSize();
+		m_pCurrentFrame = (BYTE*)malloc(cbFrame);
+		if (m_pCurrentFrame == NULL) {
+			Cleanup();
+			return E_OUTOFMEMORY;
+		}
+		ZeroMemory(m_pCurrentFrame, cbFrame);
+	}
+	m_bIsFrameDecoded = FALSE;
+
+	// Reset palette data size
+	m_cbPalette = 0;
+
+	// Allocate decode buffer
+	m_cbMaxDecodeBuffer = 3 * m_nBlocks; // Maximum 3 bytes per block
+	m_pDecodeBuffer = (BYTE*)malloc(m_cbMaxDecodeBuffer);
+	if (m_pDecodeBuffer == NULL) {
+		Cleanup();
+		return E_OUTOFMEMORY;
+	}
+
+	// Allocate codebooks
+	m_pCodebook = (BYTE*)malloc(MAX_CODEBOOK_SIZE);
+	if (m_pCodebook == NULL) {
+		Cleanup();
+		return E_OUTOFMEMORY;
+	}
+	m_pNextCodebook = (BYTE*)malloc(MAX_CODEBOOK_SIZE);
+	if (m_pNextCodebook == NULL) {
+		Cleanup();
+		return E_OUTOFMEMORY;
+	}
+	m_pDecodedCodebook = (BYTE*)malloc(MAX_CODEBOOK_SIZE);
+	if (m_pDecodedCodebook == NULL) {
+		Cleanup();
+		return E_OUTOFMEMORY;
+	}
+	m_cbNextCodebook = 0;
+	m_nNextCodebookParts = 0;
+	m_bIsNextCodebookCompressed = FALSE;
+	m_bIsNextCodebookDecoding = FALSE;
+	InitFormat80State(m_NextCodebookState);
+
+	// Start the threads for the tiled decoding (the calling 
+	// thread decodes the bands as well)
+	DWORD nThreads = (m_nThreads == 0) ? CWorkerPool::GetProcessorCount() : m_nThreads;
+	if ((m_pFormat->nColors != 0) && (m_nBlocks >= VQA_MIN_TILED_BLOCKS) && (nThreads > 1)) {
+		HRESULT hr = m_WorkerPool.Start(nThreads - 1);
+		if (FAILED(hr)) {
+			Cleanup();
+			return hr;
+		}
+	}
+
+	// Zero palette and the codebooks
+	ZeroMemory(m_pPalette, MAX_PALETTE_SIZE);
+	ZeroMemory(m_pCodebook, MAX_CODEBOOK_SIZE);
+	ZeroMemory(m_pNextCodebook, MAX_CODEBOOK_SIZE);
+	ZeroMemory(m_pDecodedCodebook, MAX_CODEBOOK_SIZE);
+
+	return NOERROR;
+}
+
+void CVQAVideoDecoder::Cleanup(void)
+{
+	m_WorkerPool.Stop();
+
+	if (m_pCurrentFrame) {
+		free(m_pCurrentFrame);
+		m_pCurrentFrame = NULL;
+	}
+
+	m_cbPalette = 0;
+
+	if (m_pDecodeBuffer) {
+		free(m_pDecodeBuffer);
+		m_pDecodeBuffer = NULL;
+		m_cbMaxDecodeBuffer = 0;
+	}
+
+	if (m_pCodebook) {
+		free(m_pCodebook);
+		m_pCodebook = NULL;
+	}
+
+	if (m_pNextCodebook) {
+		free(m_pNextCodebook);
+		m_pNextCodebook = NULL;
+		m_cbNextCodebook = 0;
+		m_nNextCodebookParts = 0;
+		m_bIsNextCodebookCompressed = FALSE;
+	}
+
+	if (m_pDecodedCodebook) {
+		free(m_pDecodedCodebook);
+		m_pDecodedCodebook = NULL;
+		m_bIsNextCodebookDecoding = FALSE;
+	}
+}
+
+void CVQAVideoDecoder::Reset(void)
+{
+	// Reset codebook accumulation stuff so that after flush we will
+	// be able to receive codebook parts from the scratch
+	m_cbNextCodebook = 0;
+	m_nNextCodebookParts = 0;
+	m_bIsNextCodebookDecoding = FALSE;
+	InitFormat80State(m_NextCodebookState);
+}
+
+void CVQAVideoDecoder::FillBlock(BYTE *pbImage, WORD wIndex)
+{
+	// Sanity check of the index
+	if (wIndex * m_cbBlock >= MAX_CODEBOOK_SIZE)
+		return;
+
+	m_pfnFillBlock(
+		pbImage,
+		m_pCodebook + wIndex * m_cbBlock,
+		m_cbImageXStride,
+		m_pFormat->bBlockHeight,
+		m_cbBlockStride
+	);
+}
+
+void CVQAVideoDecoder::FillBlockSolid(BYTE *pbImage, BYTE bColor)
+{
+	m_pfnFillBlockSolid(
+		pbImage,
+		bColor,
+		m_cbImageXStride,
+		m_pFormat->bBlockHeight,
+		m_cbBlockStride
+	);
+}
+
+#define VALIDATEREAD(p,n,t,e) if ((p) + (n) > (t)) return (e);
+
+HRESULT CVQAVideoDecoder::DecodeVPTR(const BYTE *pbData, DWORD cbData, BYTE *pbImage, const BYTE *pbPrevious)
+{
+	// There should be format block
+	ASSERT(m_pFormat);
+
+	// 8-bit video
+	if (m_pFormat->nColors != 0) {
+
+		// Each block has its lo/hi values at the position given by
+		// the block index, so find out how many blocks have both
+		// values in the data and decode those blocks
+		int iIncrement = (m_pFormat->wVersion == 1) ? 2 : 1;
+		LONG cbLoVal = (LONG)cbData;
+		LONG cbHiVal = (LONG)cbData - ((m_pFormat->wVersion == 1) ? 1 : (LONG)m_nBlocks);
+		DWORD nBlocks = m_nBlocks;
+		if (cbLoVal <= 0)
+			nBlocks = 0;
+		else if ((DWORD)((cbLoVal + iIncrement - 1) / iIncrement) < nBlocks)
+			nBlocks = (DWORD)((cbLoVal + iIncrement - 1) / iIncrement);
+		if (cbHiVal <= 0)
+			nBlocks = 0;
+		else if ((DWORD)((cbHiVal + iIncrement - 1) / iIncrement) < nBlocks)
+			nBlocks = (DWORD)((cbHiVal + iIncrement - 1) / iIncrement);
+
+		if ((m_WorkerPool.GetThreadCount() > 0) && (nBlocks >= VQA_MIN_TILED_BLOCKS)) {
+
+			// Split the frame into the block row bands
+			DWORD nBands = (m_WorkerPool.GetThreadCount() + 1) * VQA_BANDS_PER_THREAD;
+			DWORD nBandRows = (m_nBlocksY + nBands - 1) / nBands;
+
+			VQA_BAND_JOB job;
+			job.pDecoder	= this;
+			job.pbData		= pbData;
+			job.pbImage		= pbImage;
+			job.nBlocks		= nBlocks;
+			job.nBandBlocks	= nBandRows * m_nBlocksX;
+
+			m_WorkerPool.Run(DecodeBand, &job, (nBlocks + job.nBandBlocks - 1) / job.nBandBlocks);
+
+		} else
+			DecodeBlocks(pbData, 0, nBlocks, pbImage);
+
+		// The data ends before the last block
+		return (nBlocks < m_nBlocks) ? E_UNEXPECTED : NOERROR;
+	}
+
+	// HiColor video. The blocks the commands skip (and the ones past
+	// the end of the data) keep the previous frame pixels, so copy
+	// them over unless the image is the previous frame itself
+	DWORD iKeptBlock = 0;
+	HRESULT hr = DecodeHiColorBlocks(pbData, cbData, pbImage, pbPrevious, iKeptBlock);
+	if (pbPrevious != NULL)
+		CopyBlocks(pbImage, pbPrevious, iKeptBlock, m_nBlocks - iKeptBlock);
+
+	return hr;
+}
+
+// Check the data the same way, but let the caller know the blocks from
+// which on the frame has not been filled in
+#define VALIDATEBLOCKREAD(p,n,t,e) \
+	if ((p) + (n) > (t)) { \
+		if (!bIsKeeping) \
+			iKeptBlock = iBlock; \
+		return (e); \
+	}
+
+HRESULT CVQAVideoDecoder::DecodeHiColorBlocks(
+	const BYTE *pbData,
+	DWORD cbData,
+	BYTE *pbImage,
+	const BYTE *pbPrevious,
+	DWORD& iKeptBlock
+)
+{
+	// Set up the data threshold
+	const BYTE *pbDataThreshould = pbData + cbData;
+
+	// Command completion flag
+	BOOL bIsCommandComplete = TRUE;
+
+	// First block done flag (for VQA_CODE_PUT_ARRAY)
+	BOOL bIsFirstBlockDone = FALSE;
+
+	// Command code, block index and count
+	WORD wCode = 0, wIndex = 0, wCount = 0;
+
+	// Does the command keep the blocks (rather than fill them in)?
+	// The run of the kept blocks from iKeptBlock on is copied from the
+	// previous frame when a command fills the blocks in again (or by
+	// the caller when the decoding is over)
+	BOOL bIsKeeping = FALSE;
+	BYTE *pbFrame = pbImage;
+	DWORD iBlock = 0;
+	iKeptBlock = 0;
+
+	// Cycle through all blocks. The HiColor commands run across the 
+	// blocks, so the blocks are decoded one after another
+	for (WORD y = 0; y < m_nBlocksY; y++) {
+		for (WORD x = 0; x < m_nBlocksX; x++, iBlock++) {
+
+			if (bIsCommandComplete) {
+
+				// Get the next value from the input buffer
+				VALIDATEBLOCKREAD(pbData, 2, pbDataThreshould, E_UNEXPECTED);
+				WORD wValue = LE_16(pbData);
+				pbData += 2;
+
+				// Get command code
+				wCode = (wValue >> 13) & 7;
+
+				// Parse command code
+				switch (wCode) {
+
+					case VQA_CODE_SKIP:
+						wCount = wValue & 0x1FFF;
+						break;
+					case VQA_CODE_REPEAT_SHORT:
+						wIndex = wValue & 0xFF;
+						wCount = (((wValue >> 8) & 0x1F) + 1) * 2;
+						break;
+					case VQA_CODE_PUT_ARRAY:
+						wIndex = wValue & 0xFF;
+						wCount = (((wValue >> 8) & 0x1F) + 1) * 2;
+						bIsFirstBlockDone = FALSE;
+						break;
+					case VQA_CODE_PUT:
+						wIndex = wValue & 0x1FFF;
+						break;
+					case VQA_CODE_REPEAT_LONG:
+						wIndex = wValue & 0x1FFF;
+						VALIDATEBLOCKREAD(pbData, 1, pbDataThreshould, E_UNEXPECTED);
+						wCount = *pbData++;
+						break;
+					default:
+						// Unknown command code
+						break;
+				}
+
+				// Reset command completion flag
+				bIsCommandComplete = FALSE;
+
+				// Start the run of the kept blocks or copy it over
+				BOOL bIsCommandKeeping =
+					(wCode != VQA_CODE_REPEAT_SHORT) &&
+					(wCode != VQA_CODE_PUT_ARRAY) &&
+					(wCode != VQA_CODE_PUT) &&
+					(wCode != VQA_CODE_REPEAT_LONG);
+				if (bIsCommandKeeping != bIsKeeping) {
+					if (bIsCommandKeeping)
+						iKeptBlock = iBlock;
+					else if (pbPrevious != NULL)
+						CopyBlocks(pbFrame, pbPrevious, iKeptBlock, iBlock - iKeptBlock);
+					bIsKeeping = bIsCommandKeeping;
+				}
+			}
+
+			// Execute command code
+			switch (wCode) {
+
+				case VQA_CODE_SKIP:
+					wCount--;
+					bIsCommandComplete = (wCount == 0);
+					break;
+				case VQA_CODE_REPEAT_SHORT:
+					FillBlock(pbImage, wIndex);
+					wCount--;
+					bIsCommandComplete = (wCount == 0);
+					break;
+				case VQA_CODE_PUT_ARRAY:
+					if (bIsFirstBlockDone) {
+						VALIDATEBLOCKREAD(pbData, 1, pbDataThreshould, E_UNEXPECTED);
+						FillBlock(pbImage, *pbData++);
+						wCount--;
+						bIsCommandComplete = (wCount == 0);
+					} else {
+						FillBlock(pbImage, wIndex);
+						bIsFirstBlockDone = TRUE;
+					}
+					break;
+				case VQA_CODE_PUT:
+					FillBlock(pbImage, wIndex);
+					bIsCommandComplete = TRUE;
+					break;
+				case VQA_CODE_REPEAT_LONG:
+					FillBlock(pbImage, wIndex);
+					wCount--;
+					bIsCommandComplete = (wCount == 0);
+					break;
+				default:
+					// Unknown command code
+					break;
+			}
+			pbImage += m_cbBlockStride;
+		}
+		pbImage += m_cbImageYStride;
+	}
+
+	if (!bIsKeeping)
+		iKeptBlock = iBlock;
+
+	return NOERROR;
+}
+
+void CVQAVideoDecoder::CopyBlocks(BYTE *pbImage, const BYTE *pbPrevious, DWORD iFirstBlock, DWORD nBlocks)
+{
+	// Copy the run a block row at a time
+	while (nBlocks > 0) {
+
+		DWORD x = iFirstBlock % m_nBlocksX;
+		DWORD nRunBlocks = m_nBlocksX - x;
+		if (nRunBlocks > nBlocks)
+			nRunBlocks = nBlocks;
+
+		DWORD cbOffset = (iFirstBlock / m_nBlocksX) * (m_nBlocksX * m_cbBlockStride + m_cbImageYStride) + x * m_cbBlockStride;
+		for (DWORD i = 0; i < m_pFormat->bBlockHeight; i++, cbOffset += m_cbImageXStride)
+			CopyMemory(pbImage + cbOffset, pbPrevious + cbOffset, nRunBlocks * m_cbBlockStride);
+
+		iFirstBlock += nRunBlocks;
+		nBlocks -= nRunBlocks;
+	}
+}
+
+void CVQAVideoDecoder::DecodeBlocks(const BYTE *pbData, DWORD iFirstBlock, DWORD iLastBlock, BYTE *pbImage)
+{
+	if (iFirstBlock >= iLastBlock)
+		return;
+
+	// Set up lo/hi value data pointers and their increment
+	int iIncrement = (m_pFormat->wVersion == 1) ? 2 : 1;
+	const BYTE *pbLoVal = pbData + iFirstBlock * iIncrement;
+	const BYTE *pbHiVal = ((m_pFormat->wVersion == 1) ? (pbData + 1) : (pbData + m_nBlocks)) + iFirstBlock * iIncrement;
+
+	// Find the first block in the image
+	DWORD x = iFirstBlock % m_nBlocksX;
+	pbImage += (iFirstBlock / m_nBlocksX) * (m_nBlocksX * m_cbBlockStride + m_cbImageYStride) + x * m_cbBlockStride;
+
+	for (DWORD i = iFirstBlock; i < iLastBlock; i++) {
+
+		// Parse values and fill the block
+		if (*pbHiVal == m_bSolidColorMarker)
+			FillBlockSolid(
+				pbImage,
+				(m_pFormat->wVersion == 1)
+				? (~(*pbLoVal))
+				: (*pbLoVal)
+			);
+		else
+			FillBlock(
+				pbImage,
+				(((*pbHiVal) << 8) + (*pbLoVal)) >>
+				((m_pFormat->wVersion == 1) ? 3 : 0)
+			);
+
+		// Advance pointers
+		pbLoVal += iIncrement;
+		pbHiVal += iIncrement;
+		pbImage += m_cbBlockStride;
+		if (++x == m_nBlocksX) {
+			x = 0;
+			pbImage += m_cbImageYStride;
+		}
+	}
+}
+
+void CVQAVideoDecoder::DecodeBand(void *pContext, DWORD iBand)
+{
+	VQA_BAND_JOB *pJob = (VQA_BAND_JOB*)pContext;
+
+	DWORD iFirstBlock = iBand * pJob->nBandBlocks;
+	DWORD iLastBlock = iFirstBlock + pJob->nBandBlocks;
+	if (iLastBlock > pJob->nBlocks)
+		iLastBlock = pJob->nBlocks;
+
+	pJob->pDecoder->DecodeBlocks(pJob->pbData, iFirstBlock, iLastBlock, pJob->pbImage);
+}
+
+void CVQAVideoDecoder::PutNewCodebook(void)
+{
+	if ((m_bIsNextCodebookCompressed) && (m_bIsNextCodebookDecoding)) {
+
+		// The parts have been decompressed as they arrived, so 
+		// just finish up (if the last part is cut short) and swap
+		// the codebook pointers
+		DecodeFormat80Part(
+			m_pNextCodebook,
+			m_cbNextCodebook,
+			m_pDecodedCodebook,
+			MAX_CODEBOOK_SIZE,
+			m_NextCodebookState,
+			TRUE
+		);
+		BYTE *pTemp = m_pCodebook;
+		m_pCodebook = m_pDecodedCodebook;
+		m_pDecodedCodebook = pTemp;
+
+	} else if (m_bIsNextCodebookCompressed) {
+
+		// Decompress the codebook
+		int cbCodebook = MAX_CODEBOOK_SIZE;
+		DecodeFormat80(m_pNextCodebook, m_cbNextCodebook, m_pCodebook, cbCodebook);
+
+	} else {
+
+		// Swap the codebook pointers
+		BYTE *pTemp = m_pCodebook;
+		m_pCodebook = m_pNextCodebook;
+		m_pNextCodebook = pTemp;
+
+	}
+
+	// Reset the accumulation stuff
+	m_cbNextCodebook = 0;
+	m_nNextCodebookParts = 0;
+	m_bIsNextCodebookDecoding = FALSE;
+	InitFormat80State(m_NextCodebookState);
+}
+
+HRESULT CVQAVideoDecoder::Decode(const BYTE *pbData, DWORD cbData, GMF_FRAME& frame)
+{
+	// We should be initialized at this time
+	if ((m_pFormat == NULL) || (m_pCodebook == NULL))
+		return E_UNEXPECTED;
+
+	// Check the output buffer
+	LONG lOutDataLength = (LONG)GetFrameSize();
+	if ((frame.pbBuffer == NULL) || (frame.cbBuffer < (DWORD)lOutDataLength))
+		return E_INVALIDARG;
+	BYTE *pbOutBuffer = frame.pbBuffer;
+
+	// Reset the output frame info
+	frame.cbData = 0;
+	frame.pPalette = m_Palette;
+	frame.iPaletteStart = 0;
+	frame.nPaletteEntries = 0;
+
+	// HiColor frame keeps the skipped blocks of the previous frame.
+	// If the caller has kept the previous frame, decode straight to
+	// the output buffer and copy the skipped blocks from there (none
+	// if it's the output buffer itself). Otherwise decode to the frame
+	// buffer and copy all of it to the output buffer
+	BYTE *pbImage = pbOutBuffer;
+	const BYTE *pbPrevious = NULL;
+	if (m_pFormat->nColors == 0) {
+		if ((frame.pbPrevious != NULL) && (m_bIsFrameDecoded)) {
+			if (frame.pbPrevious != pbOutBuffer)
+				pbPrevious = frame.pbPrevious;
+		} else
+			pbImage = m_pCurrentFrame;
+	}
+
+	// Set up incoming data pointer and length
+	const BYTE *pbInBuffer = pbData;
+	LONG lInDataLength = (LONG)cbData;
+
+	// Check if we have accumulated the full codebook
+	if (m_pFormat->nCBParts == 0) {
+
+		// Check if this frame should use new full codebook
+		// (see the codebook switch bitmap in SetFormat())
+		if (
+			(frame.iFrame < m_nCodebookFrames) &&
+			(m_pbCodebookFrames[frame.iFrame / 8] & (1 << (frame.iFrame % 8)))
+		)
+			PutNewCodebook();
+
+	} else if (m_nNextCodebookParts == m_pFormat->nCBParts)
+		PutNewCodebook();
+
+	// Reset the flag indicating we've found and processed frame data
+	BOOL bIsFramePrepared = FALSE;
+
+	HRESULT hr = NOERROR;
+
+	// Parse incoming data
+	while (lInDataLength > 0) {
+
+		// Check if we have enough data for chunk header
+		if (lInDataLength < (LONG)sizeof(VQA_CHUNK_HEADER))
+			break;
+
+		// Get the chunk header
+		const VQA_CHUNK_HEADER *pHeader = (const VQA_CHUNK_HEADER*)pbInBuffer;
+		pbInBuffer += sizeof(VQA_CHUNK_HEADER);
+		lInDataLength -= sizeof(VQA_CHUNK_HEADER);
+
+		DWORD cbChunk = SWAPDWORD(pHeader->cbSize);
+
+		// Check that the chunk does not exceed incoming data threshold
+		if ((DWORD)lInDataLength < cbChunk)
+			break;
+
+		int cbCodebook;
+		int cbDecodeBuffer;
+
+		// Check the chunk type
+		switch (pHeader->dwID) {
+
+			// Full codebook (compressed)
+			case VQA_ID_CBFZ:
+
+				// Decompress the codebook
+				cbCodebook = MAX_CODEBOOK_SIZE;
+				DecodeFormat80(pbInBuffer, cbChunk, m_pCodebook, cbCodebook);
+				break;
+
+			// Full codebook (non-compressed)
+			case VQA_ID_CBF0:
+
+				// Copy the codebook
+				if (cbChunk > MAX_CODEBOOK_SIZE)
+					return E_UNEXPECTED;
+				CopyMemory(m_pCodebook, pbInBuffer, cbChunk);
+				break;
+
+			// Codebook part
+			case VQA_ID_CBPZ:
+			case VQA_ID_CBP0:
+
+				m_bIsNextCodebookCompressed = pHeader->dwID == VQA_ID_CBPZ;
+
+				// Sanity check of the codebook size
+				if (m_cbNextCodebook + cbChunk > MAX_CODEBOOK_SIZE)
+					return E_UNEXPECTED;
+
+				// The compressed parts are decompressed as they arrive
+				// (unless there are the non-compressed ones among them), 
+				// so the frame switching to the codebook does not have 
+				// to decompress all of it
+				if (m_nNextCodebookParts == 0)
+					m_bIsNextCodebookDecoding = m_bIsNextCodebookCompressed;
+				else if (!m_bIsNextCodebookCompressed)
+					m_bIsNextCodebookDecoding = FALSE;
+
+				// Append this part to the next codebook
+				CopyMemory(m_pNextCodebook + m_cbNextCodebook, pbInBuffer, cbChunk);
+				m_cbNextCodebook += cbChunk;
+				m_nNextCodebookParts++;
+
+				// Decompress the commands this part completes
+				if (m_bIsNextCodebookDecoding)
+					DecodeFormat80Part(
+						m_pNextCodebook,
+						m_cbNextCodebook,
+						m_pDecodedCodebook,
+						MAX_CODEBOOK_SIZE,
+						m_NextCodebookState,
+						FALSE
+					);
+				break;
+
+			// Palette (compressed)
+			case VQA_ID_CPLZ:
+
+				// Decompress the palette
+				m_cbPalette = MAX_PALETTE_SIZE;
+				DecodeFormat80(pbInBuffer, cbChunk, m_pPalette, m_cbPalette);
+				break;
+
+			// Palette (non-compressed)
+			case VQA_ID_CPL0:
+
+				// Sanity check of the palette size
+				if (cbChunk > MAX_PALETTE_SIZE)
+					return E_UNEXPECTED;
+
+				// Copy the palette data and set its size
+				CopyMemory(m_pPalette, pbInBuffer, m_cbPalette = (int)cbChunk);
+				break;
+
+			// Vector pointer data (non-compressed)
+			case VQA_ID_VPTR:
+
+				// Decode frame data
+				DecodeVPTR(pbInBuffer, cbChunk, pbImage, pbPrevious);
+
+				// Copy image data to output buffer (if needed)
+				if (pbImage != pbOutBuffer)
+					CopyMemory(pbOutBuffer, pbImage, lOutDataLength);
+
+				// We've processed the frame data, so set the flags
+				// (more frame data would go on top of this one)
+				bIsFramePrepared = TRUE;
+				m_bIsFrameDecoded = TRUE;
+				pbPrevious = NULL;
+				break;
+
+			// Vector pointer data (compressed)
+			case VQA_ID_VPTZ:
+			case VQA_ID_VPRZ:
+
+				// Decompress the data
+				cbDecodeBuffer = m_cbMaxDecodeBuffer;
+				hr = DecodeFormat80(pbInBuffer, cbChunk, m_pDecodeBuffer, cbDecodeBuffer);
+				if (FAILED(hr))
+					break;
+
+				// Decode frame data
+				DecodeVPTR(m_pDecodeBuffer, (DWORD)cbDecodeBuffer, pbImage, pbPrevious);
+
+				// Copy image data to output buffer (if needed)
+				if (pbImage != pbOutBuffer)
+					CopyMemory(pbOutBuffer, pbImage, lOutDataLength);
+
+				// We've processed the frame data, so set the flags
+				// (more frame data would go on top of this one)
+				bIsFramePrepared = TRUE;
+				m_bIsFrameDecoded = TRUE;
+				pbPrevious = NULL;
+				break;
+
+			default:
+
+				// Just skip over this chunk
+				break;
+		}
+
+		// Align to even boundary
+		if (cbChunk % 2)
+			cbChunk++;
+
+		// Advance data pointer and data size
+		pbInBuffer += cbChunk;
+		lInDataLength -= cbChunk;
+	}
+
+	// If there's no frame prepared, quit with no error
+	if (!bIsFramePrepared)
+		return S_FALSE;
+
+	// If we've booked palette change previously, do it now
+	if (m_cbPalette > 0) {
+
+		// Sanity check of the palette size
+		if (m_cbPalette > MAX_PALETTE_SIZE)
+			return E_UNEXPECTED;
+
+		// Convert the palette to 8 bits per component
+		BYTE *pbPalette = m_pPalette;
+		for (int i = 0; i < m_cbPalette / 3; i++) {
+			m_Palette[i].bRed	= (*pbPalette++) << 2;
+			m_Palette[i].bGreen	= (*pbPalette++) << 2;
+			m_Palette[i].bBlue	= (*pbPalette++) << 2;
+		}
+		frame.iPaletteStart		= 0;
+		frame.nPaletteEntries	= (WORD)(m_cbPalette / 3);
+
+		// Reset the stored palette size
+		m_cbPalette = 0;
+	}
+
+	// The data length is the uncompressed frame size
+	frame.cbData = (DWORD)lOutDataLength;
+
+	return NOERROR;
+}
+
+//==========================================================================
+// Format80 (LCW) decoder. The command set is the one of vqavideo.c
+// by Mike Melanson (melanson@pcisys.net). Each command is validated
+// once and its bytes are moved in bulk rather than one by one
+//==========================================================================
+
+// Copy the bytes that don't overlap. Most commands move just a few
+// bytes, so the short copies are done with two overlapping moves
+// instead of the call
+static inline void CopyFormat80Bytes(BYTE *pbDest, const BYTE *pbSrc, int count)
+{
+	if (count >= 8) {
+		if (count > 16) {
+			memcpy(pbDest, pbSrc, count);
+			return;
+		}
+		LONGLONG llHead, llTail;
+		memcpy(&llHead, pbSrc, 8);
+		memcpy(&llTail, pbSrc + count - 8, 8);
+		memcpy(pbDest, &llHead, 8);
+		memcpy(pbDest + count - 8, &llTail, 8);
+	} else if (count >= 4) {
+		DWORD dwHead, dwTail;
+		memcpy(&dwHead, pbSrc, 4);
+		memcpy(&dwTail, pbSrc + count - 4, 4);
+		memcpy(pbDest, &dwHead, 4);
+		memcpy(pbDest + count - 4, &dwTail, 4);
+	} else if (count > 0) {
+		pbDest[0] = pbSrc[0];
+		pbDest[count >> 1] = pbSrc[count >> 1];
+		pbDest[count - 1] = pbSrc[count - 1];
+	}
+}
+
+// Copy the bytes from the output position to the current one (both
+// positions should be checked). The overlapping copy repeats the
+// pattern of the distance length, so it goes byte by byte unless the
+// pattern is a single byte or as long as the 8-byte moves
+static inline void CopyFormat80Reference(BYTE *pbDest, const BYTE *pbSrc, int count)
+{
+	int distance = (int)(pbDest - pbSrc);
+
+	if ((distance >= count) || (distance <= -count))
+		CopyFormat80Bytes(pbDest, pbSrc, count);
+	else if (distance == 1)
+		memset(pbDest, *pbSrc, count);
+	else {
+		if (distance >= 8) {
+			for (; count >= 8; count -= 8, pbDest += 8, pbSrc += 8) {
+				LONGLONG llChunk;
+				memcpy(&llChunk, pbSrc, 8);
+				memcpy(pbDest, &llChunk, 8);
+			}
+		}
+		while (count-- > 0)
+			*pbDest++ = *pbSrc++;
+	}
+}
+
+HRESULT CVQAVideoDecoder::DecodeFormat80(
+	const unsigned char *src,
+	int src_size,
+	unsigned char *dest,
+	int& dest_size
+)
+{
+	FORMAT80_STATE state;
+	InitFormat80State(state);
+
+	HRESULT hr = DecodeFormat80Part(src, src_size, dest, dest_size, state, TRUE);
+	if (SUCCEEDED(hr))
+		dest_size = state.iDest;
+
+	return hr;
+}
+
+void CVQAVideoDecoder::InitFormat80State(FORMAT80_STATE& state)
+{
+	state.iSrc	= 0;
+	state.iDest	= 0;
+	state.hr	= S_FALSE;
+}
+
+// Check that the data has the bytes of the command. If it's not the
+// last part, the command waits for the next part then
+#define FORMAT80_NEED(n) \
+	if (src_index + (n) > src_size) { \
+		if (bIsLastPart) \
+			return state.hr = E_UNEXPECTED; \
+		state.iSrc = command_index; \
+		state.iDest = dest_index; \
+		return S_FALSE; \
+	}
+
+HRESULT CVQAVideoDecoder::DecodeFormat80Part(
+	const unsigned char *src,
+	int src_size,
+	unsigned char *dest,
+	int dest_size,
+	FORMAT80_STATE& state,
+	BOOL bIsLastPart
+)
+{
+	// The decoding is over (finished or failed)
+	if (state.hr != S_FALSE)
+		return state.hr;
+
+	int src_index = state.iSrc;
+	int dest_index = state.iDest;
+	int command_index = src_index;
+	int count;
+	int src_pos;
+
+	// Set up modification flag (the long copies take the offsets
+	// relative to the current position then)
+	if (src_index == 0) {
+		FORMAT80_NEED(1);
+		if (src[0] == 0x00)
+			src_index++;
+	}
+	int mod = src[0] == 0x00;
+
+	while (src_index < src_size) {
+
+		command_index = src_index;
+		unsigned char code = src[src_index];
+
+		// 0x80 means that frame is finished
+		if (code == 0x80)
+			break;
+
+		if (dest_index >= dest_size)
+			return state.hr = VFW_E_BUFFER_OVERFLOW;
+
+		src_index++;
+
+		if (code == 0xFF) {
+
+			// Long copy
+			FORMAT80_NEED(4);
+			count = LE_16(&src[src_index]);
+			src_pos = (mod) ? (dest_index - LE_16(&src[src_index + 2])) : LE_16(&src[src_index + 2]);
+			src_index += 4;
+
+		} else if (code == 0xFE) {
+
+			// Fill
+			FORMAT80_NEED(3);
+			count = LE_16(&src[src_index]);
+			if (dest_index + count > dest_size)
+				return state.hr = VFW_E_BUFFER_OVERFLOW;
+			memset(&dest[dest_index], src[src_index + 2], count);
+			src_index += 3;
+			dest_index += count;
+			continue;
+
+		} else if ((code & 0xC0) == 0xC0) {
+
+			// Medium copy
+			count = (code & 0x3F) + 3;
+			FORMAT80_NEED(2);
+			src_pos = (mod) ? (dest_index - LE_16(&src[src_index])) : LE_16(&src[src_index]);
+			src_index += 2;
+
+		} else if (code > 0x80) {
+
+			// Literal run
+			count = code & 0x3F;
+			if (dest_index + count > dest_size)
+				return state.hr = VFW_E_BUFFER_OVERFLOW;
+			FORMAT80_NEED(count);
+			CopyFormat80Bytes(&dest[dest_index], &src[src_index], count);
+			src_index += count;
+			dest_index += count;
+			continue;
+
+		} else {
+
+			// Short copy (always relative)
+			count = ((code & 0x70) >> 4) + 3;
+			FORMAT80_NEED(1);
+			src_pos = dest_index - (((code & 0x0F) << 8) | src[src_index]);
+			src_index++;
+		}
+
+		// Copy the earlier output
+		if (dest_index + count > dest_size)
+			return state.hr = VFW_E_BUFFER_OVERFLOW;
+		if ((src_pos < 0) || (src_pos + count > dest_size))
+			return state.hr = E_UNEXPECTED;
+		CopyFormat80Reference(&dest[dest_index], &dest[src_pos], count);
+		dest_index += count;
+	}
+
+	state.iSrc = src_index;
+	state.iDest = dest_index;
+
+	// The data has ended with no end marker, so the next part
+	// may carry on
+	if ((src_index >= src_size) && (!bIsLastPart))
+		return S_FALSE;
+
+	return state.hr = NOERROR;
+}
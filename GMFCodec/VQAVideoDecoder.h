@@ -0,0 +1,181 @@
+//==========================================================================
+//
+// File: VQAVideoDecoder.h
+//
+// Desc: Game Media Formats - Header file for VQA video decoder
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#ifndef __GMF_VQA_VIDEO_DECODER_H__
+#define __GMF_VQA_VIDEO_DECODER_H__
+
+#include "BaseDecoder.h"
+#include "WorkerPool.h"
+#include "VQASpecs.h"
+
+//==========================================================================
+// VQA video decoder class
+//==========================================================================
+
+class CVQAVideoDecoder : public CBaseDecoder {
+
+public:
+
+	// Format80 decoding state of the data arriving in parts
+	typedef struct tagFORMAT80_STATE {
+		int		iSrc;		// Position of the next command in the data
+		int		iDest;		// Output size so far
+		HRESULT	hr;			// Result (S_FALSE while the decoding goes on)
+	} FORMAT80_STATE;
+
+private:
+
+	// Block fill kernels. The kernels specialized for the block 
+	// geometry ignore the row count and size passed to them
+	typedef void (*PFN_FILL_BLOCK)(
+		BYTE *pbImage,			// Top left pixel of the block in the image
+		const BYTE *pbBlock,	// Codebook entry
+		DWORD cbImageXStride,	// Image stride along X axis
+		DWORD nRows,			// Block height
+		DWORD cbRow				// Size of the block row
+	);
+	typedef void (*PFN_FILL_BLOCK_SOLID)(
+		BYTE *pbImage,			// Top left pixel of the block in the image
+		BYTE bColor,			// Block color
+		DWORD cbImageXStride,	// Image stride along X axis
+		DWORD nRows,			// Block height
+		DWORD cbRow				// Size of the block row
+	);
+
+	// Block row band job of the tiled decoding (8-bit video)
+	typedef struct tagVQA_BAND_JOB {
+		CVQAVideoDecoder	*pDecoder;		// Decoder
+		const BYTE			*pbData;		// VPTR data
+		BYTE				*pbImage;		// Image
+		DWORD				nBlocks;		// Number of blocks to decode
+		DWORD				nBandBlocks;	// Number of blocks in the band
+	} VQA_BAND_JOB;
+
+	// ---- Decoder data ----
+
+	BYTE *m_pCurrentFrame;				// Current frame buffer
+	BOOL m_bIsFrameDecoded;				// Has any frame been decoded yet?
+	BYTE m_pPalette[MAX_PALETTE_SIZE];	// Decompressed palette buffer
+	int m_cbPalette;					// Size of palette data
+	GMF_PALETTE_ENTRY m_Palette[256];	// Palette delivered with the frame
+	BYTE *m_pDecodeBuffer;				// Decompressed VPTR buffer
+	int m_cbMaxDecodeBuffer;			// Size of decompressed VPTR buffer
+	BYTE *m_pCodebook;					// Current codebook
+	BYTE *m_pNextCodebook;				// Next codebook buffer
+	DWORD m_cbNextCodebook;				// Size of the accumulated codebook parts
+	BYTE m_nNextCodebookParts;			// Number of the accumulated codebook parts
+	BOOL m_bIsNextCodebookCompressed;	// Is the next codebook compressed?
+	BOOL m_bIsNextCodebookDecoding;		// Are the parts decompressed as they arrive?
+	BYTE *m_pDecodedCodebook;			// Next codebook decompressed so far
+	FORMAT80_STATE m_NextCodebookState;	// Next codebook decompression state
+	BYTE m_bSolidColorMarker;			// Byte value indicating solid color block
+
+	// Format block
+	VQA_INFO *m_pFormat;				// Video info
+	VQA_CIND_ENTRY *m_pCodebookTable;	// Full codebook descriptor table
+	DWORD m_nCodebooks;					// Number of full codebook descriptors
+	BYTE *m_pbCodebookFrames;			// Bitmap of the frames switching to new codebook
+	DWORD m_nCodebookFrames;			// Number of frames the bitmap covers
+
+	// Pre-calculated values
+	DWORD m_nBlocksX;					// Number of blocks along X axis
+	DWORD m_nBlocksY;					// Number of blocks along Y axis
+	DWORD m_nBlocks;					// Total number of blocks in the image
+	DWORD m_cbBlock;					// Size of the block
+	DWORD m_cbBlockStride;				// Block stride
+	DWORD m_cbImageXStride;				// Image stride along X axis
+	DWORD m_cbImageYStride;				// Image stride along Y axis
+	PFN_FILL_BLOCK m_pfnFillBlock;				// Block fill kernel
+	PFN_FILL_BLOCK_SOLID m_pfnFillBlockSolid;	// Solid block fill kernel
+
+	// Tiled decoding
+	DWORD m_nThreads;					// Number of decoding threads
+	CWorkerPool m_WorkerPool;			// Threads decoding the bands
+
+	// Video decoder methods
+	HRESULT DecodeVPTR(const BYTE *pbData, DWORD cbData, BYTE *pbImage, const BYTE *pbPrevious);
+	HRESULT DecodeHiColorBlocks(const BYTE *pbData, DWORD cbData, BYTE *pbImage, const BYTE *pbPrevious, DWORD& iKeptBlock);
+	void CopyBlocks(BYTE *pbImage, const BYTE *pbPrevious, DWORD iFirstBlock, DWORD nBlocks);
+	void DecodeBlocks(const BYTE *pbData, DWORD iFirstBlock, DWORD iLastBlock, BYTE *pbImage);
+	static void DecodeBand(void *pContext, DWORD iBand);
+	void FillBlock(BYTE *pbImage, WORD wIndex);
+	void FillBlockSolid(BYTE *pbImage, BYTE bColor);
+	void PutNewCodebook(void);
+
+public:
+
+	// Constructor/destructor
+	CVQAVideoDecoder();
+	~CVQAVideoDecoder();
+
+	// Format setup methods
+	HRESULT SetFormat(const VQA_INFO *pFormat, DWORD cbFormat);
+	void ResetFormat(void);
+	const VQA_INFO* GetFormat(void) { return m_pFormat; };
+
+	// Uncompressed frame size
+	DWORD GetFrameSize(void);
+
+	// Number of threads decoding the 8-bit video frame (0 means
+	// the processor count). The blocks of such a frame are decoded
+	// independently, so the frame is split into block row bands
+	// when it's large enough. Takes effect on Initialize()
+	void SetThreadCount(DWORD nThreads) { m_nThreads = nThreads; };
+
+	// Decoder buffers allocation (the format should be set)
+	HRESULT Initialize(void);
+
+	// CBaseDecoder methods
+	HRESULT Decode(const BYTE *pbData, DWORD cbData, GMF_FRAME& frame);
+	DWORD GetMaxOutputSize(DWORD cbData) { return GetFrameSize(); };
+	void Reset(void);
+	void Cleanup(void);
+
+	// Format80 (LCW) decoder. The command set is the one of
+	// vqavideo.c by Mike Melanson (melanson@pcisys.net)
+	static HRESULT DecodeFormat80(
+		const unsigned char *src,
+		int src_size,
+		unsigned char *dest,
+		int& dest_size
+	);
+
+	// Format80 decoder for the data arriving in parts. The data is
+	// the parts received so far, and each call decodes the commands
+	// the new part has completed. A part which ends in the middle of
+	// a command returns S_FALSE and the command waits for the next
+	// part. The result for the last part and the output size in the
+	// state are the same as DecodeFormat80() gives for the whole data
+	static void InitFormat80State(FORMAT80_STATE& state);
+	static HRESULT DecodeFormat80Part(
+		const unsigned char *src,
+		int src_size,
+		unsigned char *dest,
+		int dest_size,
+		FORMAT80_STATE& state,
+		BOOL bIsLastPart
+	);
+};
+
+#endif
@@ -0,0 +1,214 @@
+//==========================================================================
+//
+// File: WSADPCMDecoder.cpp
+//
+// Desc: Game Media Formats - Implementation of WS ADPCM decoder
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#include "WSADPCMDecoder.h"
+
+//==========================================================================
+// WS ADPCM decompression tables
+//==========================================================================
+
+const CHAR CWSADPCMDecoder::g_chWSTable2bit[]=
+{ -2, -1, 0, 1 };
+
+const CHAR CWSADPCMDecoder::g_chWSTable4bit[]=
+{ -9, -8, -6, -5, -4, -3, -2, -1, 0, 1, 2, 3, 4, 5, 6, 8 };
+
+
+//==========================================================================
+// CWSADPCMDecoder methods
+//==========================================================================
+
+CWSADPCMDecoder::CWSADPCMDecoder() :
+	m_pFormat(NULL)	// No format block at this time
+{
+}
+
+CWSADPCMDecoder::~CWSADPCMDecoder()
+{
+	// Free the format block
+	ResetFormat();
+}
+
+HRESULT CWSADPCMDecoder::SetFormat(const WSADPCMWAVEFORMAT *pFormat, DWORD cbFormat)
+{
+	// Check the pointer and the format block size
+	if (pFormat == NULL)
+		return E_POINTER;
+	if (cbFormat < sizeof(WSADPCMWAVEFORMAT))
+		return E_INVALIDARG;
+
+	// Free the old format block and allocate a new one
+	if (m_pFormat)
+		free(m_pFormat);
+	m_pFormat = (WSADPCMWAVEFORMAT*)malloc(cbFormat);
+	if (m_pFormat == NULL)
+		return E_OUTOFMEMORY;
+
+	// Copy format block to the allocated storage
+	CopyMemory(m_pFormat, pFormat, cbFormat);
+
+	return NOERROR;
+}
+
+void CWSADPCMDecoder::ResetFormat(void)
+{
+	// Free the format block
+	if (m_pFormat) {
+		free(m_pFormat);
+		m_pFormat = NULL;
+	}
+}
+
+void CWSADPCMDecoder::Clip8BitSample(SHORT *piSample)
+{
+	if (*piSample > 0xFF)	*piSample = 0xFF;
+	if (*piSample < 0)		*piSample = 0;
+}
+
+void CWSADPCMDecoder::Decompress(
+	WORD wInSize,
+	const BYTE *pbInput,
+	WORD wOutSize,
+	BYTE *pbOutput
+)
+{
+	BYTE	bCode;
+	CHAR	chCount;
+	WORD	wIn;
+	SHORT	iOut;
+
+	// Initialize sample value
+	iOut = 0x80;
+
+	// Non-compressed block
+	if (wInSize == wOutSize) {
+		for (; wOutSize > 0; wOutSize--)
+			*pbOutput++ = *pbInput++;
+		return;
+	}
+
+	// Process data until it's exhausted
+	while (wOutSize > 0) {
+
+		wIn = *pbInput++;
+		wIn <<= 2;
+		bCode = HIBYTE(wIn);
+		chCount = LOBYTE(wIn) >> 2;
+		switch (bCode) {
+
+			case 2:
+				if (chCount & 0x20) {
+					chCount <<= 3;
+					iOut += chCount >> 3;
+					*pbOutput++ = (BYTE)iOut;
+					wOutSize--;
+				} else {
+					for (chCount++; chCount > 0; chCount--, wOutSize--)
+						*pbOutput++ = *pbInput++;
+					iOut = pbOutput[-1];
+				}
+				break;
+
+			case 1:
+				for (chCount++; chCount > 0; chCount--) {
+
+					bCode = *pbInput++;
+
+					iOut += g_chWSTable4bit[bCode & 0x0F];
+					Clip8BitSample(&iOut);
+					*pbOutput++ = (BYTE)iOut;
+
+					iOut += g_chWSTable4bit[bCode >> 4];
+					Clip8BitSample(&iOut);
+					*pbOutput++ = (BYTE)iOut;
+
+					wOutSize -= 2;
+				}
+				break;
+
+			case 0:
+				for (chCount++; chCount > 0; chCount--) {
+
+					bCode = *pbInput++;
+
+					iOut += g_chWSTable2bit[bCode & 0x03];
+					Clip8BitSample(&iOut);
+					*pbOutput++ = (BYTE)iOut;
+
+					iOut += g_chWSTable2bit[(bCode >> 2) & 0x03];
+					Clip8BitSample(&iOut);
+					*pbOutput++ =(BYTE)iOut;
+
+					iOut += g_chWSTable2bit[(bCode >> 4) & 0x03];
+					Clip8BitSample(&iOut);
+					*pbOutput++ = (BYTE)iOut;
+
+					iOut += g_chWSTable2bit[(bCode >> 6) & 0x03];
+					Clip8BitSample(&iOut);
+					*pbOutput++ = (BYTE)iOut;
+
+					wOutSize -= 4;
+				}
+				break;
+
+			default:
+				for (chCount++; chCount > 0; chCount--, wOutSize--)
+					*pbOutput++ = (BYTE)iOut;
+				break;
+		}
+	}
+}
+
+HRESULT CWSADPCMDecoder::Decode(const BYTE *pbData, DWORD cbData, GMF_FRAME& frame)
+{
+	// We should have the format block at this time
+	if (m_pFormat == NULL)
+		return E_UNEXPECTED;
+
+	// Data block starts with the info header
+	if ((pbData == NULL) || (cbData < sizeof(WSADPCMINFO)))
+		return E_INVALIDARG;
+	const WSADPCMINFO *pInfo = (const WSADPCMINFO*)pbData;
+
+	// Sanity check of the compressed data size
+	if (sizeof(WSADPCMINFO) + pInfo->wInSize > cbData)
+		return E_UNEXPECTED;
+
+	// Check the output buffer
+	if ((frame.pbBuffer == NULL) || (frame.cbBuffer < pInfo->wOutSize))
+		return E_INVALIDARG;
+
+	// Decompress the input buffer to the output one
+	Decompress(
+		pInfo->wInSize,
+		pbData + sizeof(WSADPCMINFO),
+		pInfo->wOutSize,
+		frame.pbBuffer
+	);
+
+	// Set the output data length
+	frame.cbData = pInfo->wOutSize;
+
+	return NOERROR;
+}
@@ -0,0 +1,69 @@
+//==========================================================================
+//
+// File: WSADPCMDecoder.h
+//
+// Desc: Game Media Formats - Header file for WS ADPCM decoder
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#ifndef __GMF_WS_ADPCM_DECODER_H__
+#define __GMF_WS_ADPCM_DECODER_H__
+
+#include "BaseDecoder.h"
+#include "WSADPCM.h"
+
+//==========================================================================
+// WS ADPCM decoder class
+//
+// The data block passed to Decode() starts with WSADPCMINFO header
+// followed by the compressed data.
+//==========================================================================
+
+class CWSADPCMDecoder : public CBaseDecoder {
+
+	// ---- WS ADPDCM decompression tables ----
+	static const CHAR g_chWSTable2bit[];
+	static const CHAR g_chWSTable4bit[];
+
+	// Format block
+	WSADPCMWAVEFORMAT *m_pFormat;
+
+	// Utility method (sample clipping)
+	static void Clip8BitSample(SHORT *iSample);
+
+	// Decompression method
+	void Decompress(WORD wInSize, const BYTE *pbInput, WORD wOutSize, BYTE *pbOutput);
+
+public:
+
+	// Constructor/destructor
+	CWSADPCMDecoder();
+	~CWSADPCMDecoder();
+
+	// Format setup methods
+	HRESULT SetFormat(const WSADPCMWAVEFORMAT *pFormat, DWORD cbFormat);
+	void ResetFormat(void);
+	const WSADPCMWAVEFORMAT* GetFormat(void) { return m_pFormat; };
+
+	// CBaseDecoder methods
+	HRESULT Decode(const BYTE *pbData, DWORD cbData, GMF_FRAME& frame);
+	DWORD GetMaxOutputSize(DWORD cbData) { return cbData * 64; };
+};
+
+#endif
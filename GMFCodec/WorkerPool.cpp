@@ -0,0 +1,235 @@
+//==========================================================================
+//
+// File: WorkerPool.cpp
+//
+// Desc: Game Media Formats - Implementation of the decoder worker pool
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#include "WorkerPool.h"
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+//==========================================================================
+// Lock and event wrappers
+//==========================================================================
+
+#ifdef _WIN32
+
+#define InitLock(p)			InitializeCriticalSection(p)
+#define DeleteLock(p)		DeleteCriticalSection(p)
+#define Lock(p)				EnterCriticalSection(p)
+#define Unlock(p)			LeaveCriticalSection(p)
+
+#define InitEvent(p)		InitializeConditionVariable(p)
+#define DeleteEvent(p)
+#define WaitEvent(p, l)		SleepConditionVariableCS((p), (l), INFINITE)
+#define SignalEvent(p)		WakeAllConditionVariable(p)
+
+#else
+
+#define InitLock(p)			pthread_mutex_init((p), NULL)
+#define DeleteLock(p)		pthread_mutex_destroy(p)
+#define Lock(p)				pthread_mutex_lock(p)
+#define Unlock(p)			pthread_mutex_unlock(p)
+
+#define InitEvent(p)		pthread_cond_init((p), NULL)
+#define DeleteEvent(p)		pthread_cond_destroy(p)
+#define WaitEvent(p, l)		pthread_cond_wait((p), (l))
+#define SignalEvent(p)		pthread_cond_broadcast(p)
+
+#endif
+
+//==========================================================================
+// CWorkerPool methods
+//==========================================================================
+
+CWorkerPool::CWorkerPool() :
+	m_pThreads(NULL),		// No threads at this time
+	m_nThreads(0),			// No threads at this time
+	m_bIsStopping(FALSE),	// Not stopping at this time
+	m_pfnWorkItem(NULL),	// |
+	m_pContext(NULL),		// |
+	m_nItems(0),			// |-- No batch at this time
+	m_iNextItem(0),			// |
+	m_nDoneItems(0)			// |
+{
+	InitLock(&m_Lock);
+	InitEvent(&m_evWork);
+	InitEvent(&m_evDone);
+}
+
+CWorkerPool::~CWorkerPool()
+{
+	// Stop the threads (if any)
+	Stop();
+
+	DeleteEvent(&m_evDone);
+	DeleteEvent(&m_evWork);
+	DeleteLock(&m_Lock);
+}
+
+HRESULT CWorkerPool::Start(DWORD nThreads)
+{
+	// Stop the threads left from the previous session (if any)
+	Stop();
+
+	if (nThreads == 0)
+		return NOERROR;
+
+	m_pThreads = (POOL_THREAD*)malloc(nThreads * sizeof(POOL_THREAD));
+	if (m_pThreads == NULL)
+		return E_OUTOFMEMORY;
+
+	m_bIsStopping = FALSE;
+	for (DWORD i = 0; i < nThreads; i++) {
+#ifdef _WIN32
+		m_pThreads[m_nThreads] = (HANDLE)_beginthreadex(NULL, 0, WorkerThread, this, 0, NULL);
+		if (m_pThreads[m_nThreads] != 0)
+			m_nThreads++;
+#else
+		if (pthread_create(&m_pThreads[m_nThreads], NULL, WorkerThread, this) == 0)
+			m_nThreads++;
+#endif
+	}
+
+	return NOERROR;
+}
+
+void CWorkerPool::Stop(void)
+{
+	// Let the threads finish the batch (if any) and quit
+	Wait();
+
+	Lock(&m_Lock);
+	m_bIsStopping = TRUE;
+	SignalEvent(&m_evWork);
+	Unlock(&m_Lock);
+
+	for (DWORD i = 0; i < m_nThreads; i++) {
+#ifdef _WIN32
+		WaitForSingleObject(m_pThreads[i], INFINITE);
+		CloseHandle(m_pThreads[i]);
+#else
+		pthread_join(m_pThreads[i], NULL);
+#endif
+	}
+
+	if (m_pThreads) {
+		free(m_pThreads);
+		m_pThreads = NULL;
+	}
+	m_nThreads = 0;
+	m_bIsStopping = FALSE;
+}
+
+void CWorkerPool::Submit(PFN_WORK_ITEM pfnWorkItem, void *pContext, DWORD nItems)
+{
+	// Finish the previous batch (if any)
+	Wait();
+
+	Lock(&m_Lock);
+	m_pfnWorkItem	= pfnWorkItem;
+	m_pContext		= pContext;
+	m_nItems		= nItems;
+	m_iNextItem		= 0;
+	m_nDoneItems	= 0;
+	if (m_nThreads > 0)
+		SignalEvent(&m_evWork);
+	Unlock(&m_Lock);
+}
+
+void CWorkerPool::Wait(void)
+{
+	// Pick up the items not taken by the threads yet
+	DoItems();
+
+	// Wait for the items the threads are busy with
+	Lock(&m_Lock);
+	while (m_nDoneItems < m_nItems)
+		WaitEvent(&m_evDone, &m_Lock);
+	m_pfnWorkItem	= NULL;
+	m_pContext		= NULL;
+	m_nItems		= 0;
+	m_iNextItem		= 0;
+	m_nDoneItems	= 0;
+	Unlock(&m_Lock);
+}
+
+void CWorkerPool::DoItems(void)
+{
+	Lock(&m_Lock);
+	while (m_iNextItem < m_nItems) {
+
+		// Pick up the next item
+		DWORD iItem = m_iNextItem++;
+		PFN_WORK_ITEM pfnWorkItem = m_pfnWorkItem;
+		void *pContext = m_pContext;
+		Unlock(&m_Lock);
+
+		pfnWorkItem(pContext, iItem);
+
+		Lock(&m_Lock);
+		if (++m_nDoneItems == m_nItems)
+			SignalEvent(&m_evDone);
+	}
+	Unlock(&m_Lock);
+}
+
+#ifdef _WIN32
+unsigned __stdcall CWorkerPool::WorkerThread(void *pParam)
+#else
+void* CWorkerPool::WorkerThread(void *pParam)
+#endif
+{
+	CWorkerPool *pPool = (CWorkerPool*)pParam;
+
+	for (;;) {
+
+		// Wait for the batch items or the stop request
+		Lock(&pPool->m_Lock);
+		while ((!pPool->m_bIsStopping) && (pPool->m_iNextItem >= pPool->m_nItems))
+			WaitEvent(&pPool->m_evWork, &pPool->m_Lock);
+		BOOL bIsStopping = pPool->m_bIsStopping;
+		Unlock(&pPool->m_Lock);
+
+		if (bIsStopping)
+			break;
+
+		pPool->DoItems();
+	}
+
+	return 0;
+}
+
+DWORD CWorkerPool::GetProcessorCount(void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	return (si.dwNumberOfProcessors > 0) ? si.dwNumberOfProcessors : 1;
+#else
+	long lCount = sysconf(_SC_NPROCESSORS_ONLN);
+	return (lCount > 0) ? (DWORD)lCount : 1;
+#endif
+}
@@ -0,0 +1,121 @@
+//==========================================================================
+//
+// File: WorkerPool.h
+//
+// Desc: Game Media Formats - Header file for the decoder worker pool
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#ifndef __GMF_WORKER_POOL_H__
+#define __GMF_WORKER_POOL_H__
+
+#include "CodecTypes.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+//==========================================================================
+// Worker pool class
+//
+// The pool runs a batch of work items (e.g. the image bands of a frame)
+// on its threads. The thread which waits for the batch picks up the
+// items as well, so the batch gets done even with no threads started.
+// There's one batch at a time, and the items of the batch should not
+// depend on each other.
+//==========================================================================
+
+class CWorkerPool {
+
+public:
+
+	// Work item function
+	typedef void (*PFN_WORK_ITEM)(
+		void *pContext,			// Batch context
+		DWORD iItem				// Item index
+	);
+
+private:
+
+#ifdef _WIN32
+	typedef CRITICAL_SECTION	POOL_LOCK;
+	typedef CONDITION_VARIABLE	POOL_EVENT;
+	typedef HANDLE				POOL_THREAD;
+#else
+	typedef pthread_mutex_t		POOL_LOCK;
+	typedef pthread_cond_t		POOL_EVENT;
+	typedef pthread_t			POOL_THREAD;
+#endif
+
+	POOL_LOCK m_Lock;				// Guards the fields below
+	POOL_EVENT m_evWork;			// Signalled when there's a new batch or the pool stops
+	POOL_EVENT m_evDone;			// Signalled when the batch is done
+
+	POOL_THREAD *m_pThreads;		// Worker threads
+	DWORD m_nThreads;				// Number of worker threads
+	BOOL m_bIsStopping;				// Should the threads quit?
+
+	PFN_WORK_ITEM m_pfnWorkItem;	// Batch work item function
+	void *m_pContext;				// Batch context
+	DWORD m_nItems;					// Number of batch items
+	DWORD m_iNextItem;				// Next item to pick up
+	DWORD m_nDoneItems;				// Items done
+
+	// Pick up and do the items until there are none left
+	void DoItems(void);
+
+#ifdef _WIN32
+	static unsigned __stdcall WorkerThread(void *pParam);
+#else
+	static void* WorkerThread(void *pParam);
+#endif
+
+public:
+
+	// Constructor/destructor
+	CWorkerPool();
+	~CWorkerPool();
+
+	// Start the worker threads (besides the calling one). If some
+	// of them fail to start, the pool works with the rest
+	HRESULT Start(DWORD nThreads);
+
+	// Wait for the batch (if any) and stop the threads
+	void Stop(void);
+
+	// Number of worker threads running
+	DWORD GetThreadCount(void) { return m_nThreads; };
+
+	// Hand out the batch to the threads and return at once
+	void Submit(PFN_WORK_ITEM pfnWorkItem, void *pContext, DWORD nItems);
+
+	// Help with the batch items and wait for the batch to be done
+	void Wait(void);
+
+	// Do the batch and return when it's done
+	void Run(PFN_WORK_ITEM pfnWorkItem, void *pContext, DWORD nItems) {
+		Submit(pfnWorkItem, pContext, nItems);
+		Wait();
+	};
+
+	// Number of the processors in the system
+	static DWORD GetProcessorCount(void);
+};
+
+#endif
@@ -26,6 +26,7 @@
 
 #include "ContinuousIMAADPCM.h"
 #include "ADPCMInterleaver.h"
+#include "StreamTrace.h"
 #include "resource.h"
 
 // Extract the nibble (upper nibble for TRUE, lower one for FALSE)
@@ -136,6 +137,10 @@ HRESULT CADPCMInterleaver::Transform(
 	CheckPointer(pOut, E_POINTER);
 	ValidateReadPtr(pOut, sizeof(IMediaSample));
 
+	// The interleaver lives in the graph together with the splitter
+	// which holds the trace session, so there's no need to start it
+	CTraceSpan span("Transform", m_pName, "time", GetTraceSampleTime(pIn));
+
 	// Get the input sample's buffer
 	BYTE *pbInBuffer = NULL;
 	HRESULT hr = pIn->GetPointer(&pbInBuffer);
@@ -87,16 +87,6 @@ const AMOVIESETUP_FILTER g_sudAPCParser = {
 // APC parser file type setup data
 //==========================================================================
 
-const GMF_FILETYPE_PATTERN sudAPCPatterns[] = {
-	{ 0,	4,	APC_IDSTR_CRYO	},
-	{ 4,	4,	APC_IDSTR_APC	},
-	{ 8,	4,	APC_IDSTR_VER	}
-};
-
-const GMF_FILETYPE_ENTRY sudAPCEntries[] = {
-	{ 3, sudAPCPatterns }
-};
-
 const TCHAR *sudAPCExtensions[] = {
 	TEXT(".apc")
 };
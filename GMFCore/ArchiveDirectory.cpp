@@ -0,0 +1,661 @@
+//==========================================================================
+//
+// File: ArchiveDirectory.cpp
+//
+// Desc: Game Media Formats - Implementation of game archive directories
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#include <ctype.h>
+#include <sys/stat.h>
+
+#include "ArchiveDirectory.h"
+
+#ifdef _WIN32
+#define fseeko _fseeki64
+#define ftello _ftelli64
+#define stat _stat64
+#endif
+
+// ZIP signatures
+#define ZIP_ID_LOCAL_HEADER		0x04034B50	// "PK\3\4"
+#define ZIP_ID_CENTRAL_HEADER	0x02014B50	// "PK\1\2"
+#define ZIP_ID_END				0x06054B50	// "PK\5\6"
+#define ZIP_ID_END64			0x06064B50	// "PK\6\6"
+#define ZIP_ID_END64_LOCATOR	0x07064B50	// "PK\6\7"
+
+// ZIP structure sizes
+#define ZIP_LOCAL_HEADER_SIZE	30
+#define ZIP_CENTRAL_HEADER_SIZE	46
+#define ZIP_END_SIZE			22
+#define ZIP_END64_SIZE			56
+#define ZIP_END64_LOCATOR_SIZE	20
+#define ZIP_MAX_COMMENT			0xFFFF
+
+// ZIP64 extra field ID
+#define ZIP_EXTRA_ZIP64			0x0001
+
+// MIX index flags (Red Alert layout)
+#define MIX_FLAG_CHECKSUM		0x00010000
+#define MIX_FLAG_ENCRYPTED		0x00020000
+
+// Size of the MIX checksum (SHA-1) following the body
+#define MIX_CHECKSUM_SIZE		20
+
+// Largest directory we agree to load into memory
+#define ARCHIVE_MAX_DIRECTORY	0x10000000
+
+//==========================================================================
+// Little-endian field access (the archive structures are not aligned,
+// so the fields are picked byte by byte)
+//==========================================================================
+
+static WORD GetLE16(const BYTE *pb)
+{
+	return (WORD)(pb[0] | (pb[1] << 8));
+}
+
+static DWORD GetLE32(const BYTE *pb)
+{
+	return (DWORD)pb[0] | ((DWORD)pb[1] << 8) | ((DWORD)pb[2] << 16) | ((DWORD)pb[3] << 24);
+}
+
+static LONGLONG GetLE64(const BYTE *pb)
+{
+	return (LONGLONG)GetLE32(pb) | ((LONGLONG)GetLE32(pb + 4) << 32);
+}
+
+// Read the archive bytes at the specified offset
+static HRESULT ReadAt(FILE *pFile, LONGLONG llOffset, void *pBuffer, DWORD cbData)
+{
+	if (fseeko(pFile, llOffset, SEEK_SET) != 0)
+		return E_FAIL;
+	if (fread(pBuffer, 1, cbData, pFile) != cbData)
+		return (ferror(pFile)) ? E_FAIL : S_FALSE;
+	return NOERROR;
+}
+
+static LONGLONG GetArchiveFileSize(FILE *pFile)
+{
+	if (fseeko(pFile, 0, SEEK_END) != 0)
+		return -1;
+	return ftello(pFile);
+}
+
+//==========================================================================
+// CArchiveDirectory methods
+//==========================================================================
+
+CArchiveDirectory::CArchiveDirectory() :
+	m_pEntries(NULL),
+	m_nEntries(0),
+	m_nMaxEntries(0)
+{
+}
+
+CArchiveDirectory::~CArchiveDirectory()
+{
+	for (DWORD i = 0; i < m_nEntries; i++)
+		free(m_pEntries[i].pszName);
+	free(m_pEntries);
+}
+
+HRESULT CArchiveDirectory::AddEntry(
+	const char *pszName,
+	DWORD cchName,
+	DWORD dwID,
+	LONGLONG llOffset,
+	LONGLONG llSize,
+	BOOL bIsStored
+)
+{
+	if (m_nEntries == m_nMaxEntries) {
+		DWORD nMaxEntries = (m_nMaxEntries) ? (m_nMaxEntries * 2) : 256;
+		ARCHIVE_ENTRY *pEntries = (ARCHIVE_ENTRY*)realloc(m_pEntries, nMaxEntries * sizeof(ARCHIVE_ENTRY));
+		if (pEntries == NULL)
+			return E_OUTOFMEMORY;
+		m_pEntries = pEntries;
+		m_nMaxEntries = nMaxEntries;
+	}
+
+	ARCHIVE_ENTRY *pEntry = &m_pEntries[m_nEntries];
+	pEntry->pszName = NULL;
+	if (pszName) {
+		pEntry->pszName = (char*)malloc(cchName + 1);
+		if (pEntry->pszName == NULL)
+			return E_OUTOFMEMORY;
+		CopyMemory(pEntry->pszName, pszName, cchName);
+		pEntry->pszName[cchName] = '\0';
+	}
+	pEntry->dwID		= dwID;
+	pEntry->llOffset	= llOffset;
+	pEntry->llSize		= llSize;
+	pEntry->bIsStored	= bIsStored;
+
+	m_nEntries++;
+	return NOERROR;
+}
+
+BOOL CArchiveDirectory::IsSameName(const char *pszA, const char *pszB)
+{
+	for (; (*pszA) && (*pszB); pszA++, pszB++) {
+		char chA = (*pszA == '\\') ? '/' : (char)toupper((BYTE)*pszA);
+		char chB = (*pszB == '\\') ? '/' : (char)toupper((BYTE)*pszB);
+		if (chA != chB)
+			return FALSE;
+	}
+	return (*pszA == *pszB);
+}
+
+const ARCHIVE_ENTRY* CArchiveDirectory::FindEntry(const char *pszName)
+{
+	for (DWORD i = 0; i < m_nEntries; i++)
+		if ((m_pEntries[i].pszName) && (IsSameName(m_pEntries[i].pszName, pszName)))
+			return &m_pEntries[i];
+	return NULL;
+}
+
+HRESULT CArchiveDirectory::GetEntryRange(
+	FILE *pFile,
+	const ARCHIVE_ENTRY *pEntry,
+	LONGLONG *pllOffset,
+	LONGLONG *pllSize
+)
+{
+	*pllOffset	= pEntry->llOffset;
+	*pllSize	= pEntry->llSize;
+	return NOERROR;
+}
+
+//==========================================================================
+// CZIPDirectory methods
+//==========================================================================
+
+HRESULT CZIPDirectory::Parse(FILE *pFile, LONGLONG llFileSize)
+{
+	if (llFileSize < ZIP_END_SIZE)
+		return S_FALSE;
+
+	// Find the end of central directory record. It's followed by
+	// the archive comment, so look for its signature backwards
+	DWORD cbTail = (llFileSize < ZIP_END_SIZE + ZIP_MAX_COMMENT) ? (DWORD)llFileSize : ZIP_END_SIZE + ZIP_MAX_COMMENT;
+	LONGLONG llTail = llFileSize - cbTail;
+	BYTE *pbTail = (BYTE*)malloc(cbTail);
+	if (pbTail == NULL)
+		return E_OUTOFMEMORY;
+	HRESULT hr = ReadAt(pFile, llTail, pbTail, cbTail);
+	if (hr != S_OK) {
+		free(pbTail);
+		return (FAILED(hr)) ? hr : S_FALSE;
+	}
+
+	LONG iEnd = (LONG)cbTail - ZIP_END_SIZE;
+	while (
+		(iEnd >= 0) &&
+		(
+			(GetLE32(pbTail + iEnd) != ZIP_ID_END) ||
+			(iEnd + ZIP_END_SIZE + GetLE16(pbTail + iEnd + 20) > (LONG)cbTail)
+		)
+	)
+		iEnd--;
+	if (iEnd < 0) {
+		free(pbTail);
+		return S_FALSE;
+	}
+
+	LONGLONG nEntries		= GetLE16(pbTail + iEnd + 10);
+	LONGLONG cbDirectory	= GetLE32(pbTail + iEnd + 12);
+	LONGLONG llDirectory	= GetLE32(pbTail + iEnd + 16);
+	LONGLONG llEnd			= llTail + iEnd;
+	free(pbTail);
+
+	// ZIP64 archive keeps the real values in its own record
+	if ((nEntries == 0xFFFF) || (cbDirectory == 0xFFFFFFFF) || (llDirectory == 0xFFFFFFFF)) {
+
+		BYTE pbLocator[ZIP_END64_LOCATOR_SIZE];
+		if (
+			(llEnd < ZIP_END64_LOCATOR_SIZE) ||
+			(ReadAt(pFile, llEnd - ZIP_END64_LOCATOR_SIZE, pbLocator, sizeof(pbLocator)) != S_OK) ||
+			(GetLE32(pbLocator) != ZIP_ID_END64_LOCATOR)
+		)
+			return VFW_E_INVALID_FILE_FORMAT;
+
+		BYTE pbEnd64[ZIP_END64_SIZE];
+		if (
+			(ReadAt(pFile, GetLE64(pbLocator + 8), pbEnd64, sizeof(pbEnd64)) != S_OK) ||
+			(GetLE32(pbEnd64) != ZIP_ID_END64)
+		)
+			return VFW_E_INVALID_FILE_FORMAT;
+
+		nEntries	= GetLE64(pbEnd64 + 32);
+		cbDirectory	= GetLE64(pbEnd64 + 40);
+		llDirectory	= GetLE64(pbEnd64 + 48);
+	}
+
+	if (
+		(llDirectory < 0) ||
+		(cbDirectory < 0) ||
+		(cbDirectory > ARCHIVE_MAX_DIRECTORY) ||
+		(llDirectory + cbDirectory > llEnd)
+	)
+		return VFW_E_INVALID_FILE_FORMAT;
+
+	// Load the central directory and walk its entries
+	BYTE *pbDirectory = (BYTE*)malloc((size_t)cbDirectory + 1);
+	if (pbDirectory == NULL)
+		return E_OUTOFMEMORY;
+	hr = ReadAt(pFile, llDirectory, pbDirectory, (DWORD)cbDirectory);
+	if (hr != S_OK) {
+		free(pbDirectory);
+		return (FAILED(hr)) ? hr : VFW_E_INVALID_FILE_FORMAT;
+	}
+
+	DWORD iPos = 0;
+	for (LONGLONG i = 0; i < nEntries; i++) {
+
+		const BYTE *pb = pbDirectory + iPos;
+		if (
+			(iPos + ZIP_CENTRAL_HEADER_SIZE > cbDirectory) ||
+			(GetLE32(pb) != ZIP_ID_CENTRAL_HEADER)
+		) {
+			hr = VFW_E_INVALID_FILE_FORMAT;
+			break;
+		}
+
+		WORD		wFlags		= GetLE16(pb + 8);
+		WORD		wMethod		= GetLE16(pb + 10);
+		LONGLONG	cbPacked	= GetLE32(pb + 20);
+		LONGLONG	cbSize		= GetLE32(pb + 24);
+		DWORD		cchName		= GetLE16(pb + 28);
+		DWORD		cbExtra		= GetLE16(pb + 30);
+		DWORD		cbComment	= GetLE16(pb + 32);
+		LONGLONG	llHeader	= GetLE32(pb + 42);
+
+		DWORD cbEntry = ZIP_CENTRAL_HEADER_SIZE + cchName + cbExtra + cbComment;
+		if (iPos + cbEntry > cbDirectory) {
+			hr = VFW_E_INVALID_FILE_FORMAT;
+			break;
+		}
+
+		// The ZIP64 extra field has only the values not fitting
+		// the header fields, in the order of the header
+		const BYTE *pbExtra = pb + ZIP_CENTRAL_HEADER_SIZE + cchName;
+		for (DWORD j = 0; j + 4 <= cbExtra; ) {
+			WORD wID = GetLE16(pbExtra + j);
+			DWORD cbField = GetLE16(pbExtra + j + 2);
+			if (j + 4 + cbField > cbExtra)
+				break;
+			if (wID == ZIP_EXTRA_ZIP64) {
+				const BYTE *pbField = pbExtra + j + 4;
+				const BYTE *pbFieldEnd = pbField + cbField;
+				if ((cbSize == 0xFFFFFFFF) && (pbField + 8 <= pbFieldEnd)) {
+					cbSize = GetLE64(pbField);
+					pbField += 8;
+				}
+				if ((cbPacked == 0xFFFFFFFF) && (pbField + 8 <= pbFieldEnd)) {
+					cbPacked = GetLE64(pbField);
+					pbField += 8;
+				}
+				if ((llHeader == 0xFFFFFFFF) && (pbField + 8 <= pbFieldEnd))
+					llHeader = GetLE64(pbField);
+			}
+			j += 4 + cbField;
+		}
+
+		// Skip the directories
+		const char *pszName = (const char*)(pb + ZIP_CENTRAL_HEADER_SIZE);
+		if ((cchName > 0) && (pszName[cchName - 1] != '/')) {
+
+			// The data offset is known once the local header is read
+			// (see GetEntryRange()), so the entry keeps the header offset
+			hr = AddEntry(
+				pszName,
+				cchName,
+				0,
+				llHeader,
+				cbPacked,
+				(wMethod == 0) && !(wFlags & 1)	// Stored and not encrypted
+			);
+			if (FAILED(hr))
+				break;
+		}
+
+		iPos += cbEntry;
+	}
+
+	free(pbDirectory);
+	return hr;
+}
+
+HRESULT CZIPDirectory::GetEntryRange(
+	FILE *pFile,
+	const ARCHIVE_ENTRY *pEntry,
+	LONGLONG *pllOffset,
+	LONGLONG *pllSize
+)
+{
+	BYTE pbHeader[ZIP_LOCAL_HEADER_SIZE];
+	if (
+		(ReadAt(pFile, pEntry->llOffset, pbHeader, sizeof(pbHeader)) != S_OK) ||
+		(GetLE32(pbHeader) != ZIP_ID_LOCAL_HEADER)
+	)
+		return VFW_E_INVALID_FILE_FORMAT;
+
+	*pllOffset	= pEntry->llOffset + ZIP_LOCAL_HEADER_SIZE + GetLE16(pbHeader + 26) + GetLE16(pbHeader + 28);
+	*pllSize	= pEntry->llSize;
+	return NOERROR;
+}
+
+//==========================================================================
+// CMIXDirectory methods
+//==========================================================================
+
+DWORD CMIXDirectory::GetNameID(const char *pszName)
+{
+	// The name is upper-cased and taken as little-endian DWORDs
+	// (the last one zero-padded) which are added with 1-bit rotation
+	size_t cchName = strlen(pszName);
+	DWORD dwID = 0;
+	for (size_t i = 0; i < cchName; i += 4) {
+		DWORD dwValue = 0;
+		for (size_t j = 0; (j < 4) && (i + j < cchName); j++)
+			dwValue |= (DWORD)(BYTE)toupper((BYTE)pszName[i + j]) << (8 * j);
+		dwID = ((dwID << 1) | (dwID >> 31)) + dwValue;
+	}
+	return dwID;
+}
+
+HRESULT CMIXDirectory::Parse(FILE *pFile, LONGLONG llFileSize)
+{
+	BYTE pbHeader[10];
+	if (ReadAt(pFile, 0, pbHeader, sizeof(pbHeader)) != S_OK)
+		return S_FALSE;
+
+	// The Tiberian Dawn header starts with the number of files, the
+	// Red Alert one starts with the flags whose low word is zero
+	DWORD nFiles, cbBody, cbHeader, cbChecksum = 0;
+	if (GetLE16(pbHeader) != 0) {
+		nFiles		= GetLE16(pbHeader);
+		cbBody		= GetLE32(pbHeader + 2);
+		cbHeader	= 6;
+	} else {
+		DWORD dwFlags = GetLE32(pbHeader);
+		if (dwFlags & ~(MIX_FLAG_CHECKSUM | MIX_FLAG_ENCRYPTED))
+			return S_FALSE;
+		if (dwFlags & MIX_FLAG_ENCRYPTED)
+			return E_NOTIMPL;
+		if (dwFlags & MIX_FLAG_CHECKSUM)
+			cbChecksum = MIX_CHECKSUM_SIZE;
+		nFiles		= GetLE16(pbHeader + 4);
+		cbBody		= GetLE32(pbHeader + 6);
+		cbHeader	= 10;
+	}
+
+	// There is no signature, so the sizes have to fit exactly
+	// (counting the checksum after the body if the flags say so)
+	LONGLONG llBody = cbHeader + 12 * (LONGLONG)nFiles;
+	if ((nFiles == 0) || (llBody + cbBody + cbChecksum != llFileSize))
+		return S_FALSE;
+
+	DWORD cbIndex = 12 * nFiles;
+	BYTE *pbIndex = (BYTE*)malloc(cbIndex);
+	if (pbIndex == NULL)
+		return E_OUTOFMEMORY;
+	HRESULT hr = ReadAt(pFile, cbHeader, pbIndex, cbIndex);
+	if (hr != S_OK) {
+		free(pbIndex);
+		return (FAILED(hr)) ? hr : S_FALSE;
+	}
+
+	for (DWORD i = 0; i < nFiles; i++) {
+
+		DWORD dwID		= GetLE32(pbIndex + 12 * i);
+		DWORD dwOffset	= GetLE32(pbIndex + 12 * i + 4);
+		DWORD cbSize	= GetLE32(pbIndex + 12 * i + 8);
+		if ((LONGLONG)dwOffset + cbSize > cbBody) {
+			hr = S_FALSE;
+			break;
+		}
+
+		hr = AddEntry(NULL, 0, dwID, llBody + dwOffset, cbSize, TRUE);
+		if (FAILED(hr))
+			break;
+	}
+
+	free(pbIndex);
+	return hr;
+}
+
+const ARCHIVE_ENTRY* CMIXDirectory::FindEntry(const char *pszName)
+{
+	DWORD dwID = GetNameID(pszName);
+	for (DWORD i = 0; i < m_nEntries; i++)
+		if (m_pEntries[i].dwID == dwID)
+			return &m_pEntries[i];
+	return NULL;
+}
+
+//==========================================================================
+// CDATDirectory methods
+//==========================================================================
+
+HRESULT CDATDirectory::Parse(FILE *pFile, LONGLONG llFileSize)
+{
+	// The archive ends with the directory size and the archive size
+	BYTE pbTail[8];
+	if ((llFileSize < 12) || (ReadAt(pFile, llFileSize - 8, pbTail, sizeof(pbTail)) != S_OK))
+		return S_FALSE;
+
+	DWORD cbTree = GetLE32(pbTail);
+	if (
+		((LONGLONG)GetLE32(pbTail + 4) != llFileSize) ||
+		(cbTree < 4) ||
+		((LONGLONG)cbTree + 8 > llFileSize) ||
+		(cbTree > ARCHIVE_MAX_DIRECTORY)
+	)
+		return S_FALSE;
+
+	LONGLONG llTree = llFileSize - 8 - cbTree;
+	BYTE *pbTree = (BYTE*)malloc(cbTree);
+	if (pbTree == NULL)
+		return E_OUTOFMEMORY;
+	HRESULT hr = ReadAt(pFile, llTree, pbTree, cbTree);
+	if (hr != S_OK) {
+		free(pbTree);
+		return (FAILED(hr)) ? hr : S_FALSE;
+	}
+
+	// Each entry is the name length, the name, the compression
+	// flag, the real size, the packed size and the data offset
+	DWORD nFiles = GetLE32(pbTree);
+	DWORD iPos = 4;
+	for (DWORD i = 0; i < nFiles; i++) {
+
+		if (iPos + 4 > cbTree) {
+			hr = S_FALSE;
+			break;
+		}
+		DWORD cchName = GetLE32(pbTree + iPos);
+		if ((cchName > cbTree) || (iPos + 4 + cchName + 13 > cbTree)) {
+			hr = S_FALSE;
+			break;
+		}
+
+		const BYTE *pb = pbTree + iPos + 4 + cchName;
+		BYTE		bType		= pb[0];
+		DWORD		cbSize		= GetLE32(pb + 1);
+		DWORD		cbPacked	= GetLE32(pb + 5);
+		DWORD		dwOffset	= GetLE32(pb + 9);
+		if ((LONGLONG)dwOffset + cbPacked > llTree) {
+			hr = S_FALSE;
+			break;
+		}
+
+		hr = AddEntry(
+			(const char*)(pbTree + iPos + 4),
+			cchName,
+			0,
+			dwOffset,
+			(bType == 0) ? cbSize : cbPacked,
+			(bType == 0)
+		);
+		if (FAILED(hr))
+			break;
+
+		iPos += 4 + cchName + 13;
+	}
+
+	free(pbTree);
+	return hr;
+}
+
+//==========================================================================
+// Archive types table
+//==========================================================================
+
+static CArchiveDirectory* CreateZIPDirectory(void) { return new CZIPDirectory(); }
+static CArchiveDirectory* CreateDATDirectory(void) { return new CDATDirectory(); }
+static CArchiveDirectory* CreateMIXDirectory(void) { return new CMIXDirectory(); }
+
+// The types are tried in order, so the ones with weaker checks go last
+const ARCHIVE_FORMAT g_ArchiveFormats[] = {
+	{ "ZIP",	CreateZIPDirectory	},
+	{ "DAT",	CreateDATDirectory	},
+	{ "MIX",	CreateMIXDirectory	}
+};
+
+const int g_nArchiveFormats = sizeof(g_ArchiveFormats) / sizeof(g_ArchiveFormats[0]);
+
+//==========================================================================
+// Archive helpers
+//==========================================================================
+
+HRESULT OpenArchiveDirectory(FILE *pFile, CArchiveDirectory **ppDirectory)
+{
+	*ppDirectory = NULL;
+
+	LONGLONG llFileSize = GetArchiveFileSize(pFile);
+	if (llFileSize < 0)
+		return E_FAIL;
+
+	// Report the most specific failure if no type fits
+	HRESULT hrFailure = VFW_E_INVALID_FILE_FORMAT;
+	for (int i = 0; i < g_nArchiveFormats; i++) {
+
+		CArchiveDirectory *pDirectory = g_ArchiveFormats[i].pfnCreate();
+		if (pDirectory == NULL)
+			return E_OUTOFMEMORY;
+
+		HRESULT hr = pDirectory->Parse(pFile, llFileSize);
+		if (hr == S_OK) {
+			*ppDirectory = pDirectory;
+			return NOERROR;
+		}
+
+		delete pDirectory;
+		if (hr == E_OUTOFMEMORY)
+			return hr;
+		if (FAILED(hr))
+			hrFailure = hr;
+	}
+
+	return hrFailure;
+}
+
+HRESULT SplitArchivePath(const char *pszPath, char **ppszArchive, const char **ppszMember)
+{
+	*ppszArchive	= NULL;
+	*ppszMember		= NULL;
+
+	const char *pszSeparator = strrchr(pszPath, ARCHIVE_MEMBER_SEPARATOR);
+	if (pszSeparator == NULL)
+		return S_FALSE;
+
+	// The separator may be a part of the file name where the
+	// file system allows that
+	struct stat st;
+	if (stat(pszPath, &st) == 0)
+		return S_FALSE;
+
+	size_t cchArchive = pszSeparator - pszPath;
+	*ppszArchive = (char*)malloc(cchArchive + 1);
+	if (*ppszArchive == NULL)
+		return E_OUTOFMEMORY;
+	CopyMemory(*ppszArchive, pszPath, cchArchive);
+	(*ppszArchive)[cchArchive] = '\0';
+	*ppszMember = pszSeparator + 1;
+
+	return NOERROR;
+}
+
+HRESULT GetArchiveMemberRange(
+	FILE *pFile,
+	const char *pszMember,
+	LONGLONG *pllOffset,
+	LONGLONG *pllSize
+)
+{
+	LONGLONG llFileSize = GetArchiveFileSize(pFile);
+	if (llFileSize < 0)
+		return E_FAIL;
+
+	// Byte range: offset and (optionally) size
+	if (pszMember[0] == ARCHIVE_RANGE_PREFIX) {
+
+		char *pszEnd = NULL;
+		LONGLONG llOffset = (LONGLONG)strtoull(pszMember + 1, &pszEnd, 0);
+		if (pszEnd == pszMember + 1)
+			return E_INVALIDARG;
+
+		LONGLONG llSize = llFileSize - llOffset;
+		if (*pszEnd == ',') {
+			const char *pszSize = pszEnd + 1;
+			llSize = (LONGLONG)strtoull(pszSize, &pszEnd, 0);
+			if (pszEnd == pszSize)
+				return E_INVALIDARG;
+		}
+
+		if ((*pszEnd != '\0') || (llOffset < 0) || (llSize < 0) || (llOffset + llSize > llFileSize))
+			return E_INVALIDARG;
+
+		*pllOffset	= llOffset;
+		*pllSize	= llSize;
+		return NOERROR;
+	}
+
+	// Member name
+	CArchiveDirectory *pDirectory = NULL;
+	HRESULT hr = OpenArchiveDirectory(pFile, &pDirectory);
+	if (FAILED(hr))
+		return hr;
+
+	const ARCHIVE_ENTRY *pEntry = pDirectory->FindEntry(pszMember);
+	if (pEntry == NULL)
+		hr = E_INVALIDARG;
+	else if (!pEntry->bIsStored)
+		hr = E_NOTIMPL;
+	else
+		hr = pDirectory->GetEntryRange(pFile, pEntry, pllOffset, pllSize);
+
+	if ((SUCCEEDED(hr)) && (*pllOffset + *pllSize > llFileSize))
+		hr = VFW_E_INVALID_FILE_FORMAT;
+
+	delete pDirectory;
+	return hr;
+}
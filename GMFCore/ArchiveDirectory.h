@@ -0,0 +1,198 @@
+//==========================================================================
+//
+// File: ArchiveDirectory.h
+//
+// Desc: Game Media Formats - Header file for game archive directories
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#ifndef __GMF_ARCHIVE_DIRECTORY_H__
+#define __GMF_ARCHIVE_DIRECTORY_H__
+
+#include <stdio.h>
+
+// The directories are used both by the archive source filter and by
+// the standalone tools, so this header does not depend on DirectShow
+#include "CodecTypes.h"
+
+// Separator of the archive file name and the member name in the
+// member path ("movies.mix|intro.vqa"). The member name may also be
+// a plain byte range of the archive file ("data.res|@0x1000,0x20000")
+#define ARCHIVE_MEMBER_SEPARATOR	'|'
+#define ARCHIVE_RANGE_PREFIX		'@'
+
+//==========================================================================
+// Archive member
+//==========================================================================
+
+typedef struct tagARCHIVE_ENTRY {
+	char		*pszName;	// Member name (NULL if the archive keeps no names)
+	DWORD		dwID;		// Member ID (name hash for the archives keeping no names)
+	LONGLONG	llOffset;	// Offset of the member data (or its local header) in the archive
+	LONGLONG	llSize;		// Size of the member data
+	BOOL		bIsStored;	// Is the member data stored as is (i.e. can it be streamed)?
+} ARCHIVE_ENTRY;
+
+//==========================================================================
+// Base archive directory class
+//
+// The derived classes parse the directory of a particular archive
+// layout. The archive type is given by the first Parse() to succeed,
+// so Parse() should check the archive signature before anything else.
+//==========================================================================
+
+class CArchiveDirectory {
+
+protected:
+
+	ARCHIVE_ENTRY	*m_pEntries;	// Directory entries
+	DWORD			m_nEntries;		// Number of entries
+	DWORD			m_nMaxEntries;	// Allocated entries
+
+	// Add the directory entry (the name is copied and may be NULL)
+	HRESULT AddEntry(
+		const char *pszName,
+		DWORD cchName,
+		DWORD dwID,
+		LONGLONG llOffset,
+		LONGLONG llSize,
+		BOOL bIsStored
+	);
+
+	// Do the member names match? (case-insensitive, either slash
+	// matches either slash)
+	static BOOL IsSameName(const char *pszA, const char *pszB);
+
+public:
+
+	CArchiveDirectory();
+	virtual ~CArchiveDirectory();
+
+	// Format name of the archive
+	virtual const char* GetName(void) = 0;
+
+	// Parse the archive directory. Returns S_FALSE if the file is
+	// not an archive of this type
+	virtual HRESULT Parse(FILE *pFile, LONGLONG llFileSize) = 0;
+
+	// Find the member by name. Returns NULL if there is no such member
+	virtual const ARCHIVE_ENTRY* FindEntry(const char *pszName);
+
+	// Get the archive file range the member data occupies (the
+	// directories which do not know the exact data offset after
+	// Parse() read the member header here)
+	virtual HRESULT GetEntryRange(
+		FILE *pFile,
+		const ARCHIVE_ENTRY *pEntry,
+		LONGLONG *pllOffset,
+		LONGLONG *pllSize
+	);
+
+	DWORD GetEntryCount(void) { return m_nEntries; };
+	const ARCHIVE_ENTRY* GetEntry(DWORD iEntry) { return (iEntry < m_nEntries) ? &m_pEntries[iEntry] : NULL; };
+};
+
+//==========================================================================
+// ZIP (PK3) archive directory. Only the stored (not deflated) members
+// can be streamed
+//==========================================================================
+
+class CZIPDirectory : public CArchiveDirectory {
+
+public:
+
+	const char* GetName(void) { return "ZIP"; };
+	HRESULT Parse(FILE *pFile, LONGLONG llFileSize);
+	HRESULT GetEntryRange(
+		FILE *pFile,
+		const ARCHIVE_ENTRY *pEntry,
+		LONGLONG *pllOffset,
+		LONGLONG *pllSize
+	);
+};
+
+//==========================================================================
+// Westwood MIX archive directory. The archive keeps the name hashes
+// only, so the members are looked up by the hash of the name. The
+// encrypted (Red Alert) index is not supported
+//==========================================================================
+
+class CMIXDirectory : public CArchiveDirectory {
+
+public:
+
+	// Get the MIX ID of the member name
+	static DWORD GetNameID(const char *pszName);
+
+	const char* GetName(void) { return "MIX"; };
+	HRESULT Parse(FILE *pFile, LONGLONG llFileSize);
+	const ARCHIVE_ENTRY* FindEntry(const char *pszName);
+};
+
+//==========================================================================
+// Fallout 2 DAT archive directory. Only the uncompressed members
+// can be streamed
+//==========================================================================
+
+class CDATDirectory : public CArchiveDirectory {
+
+public:
+
+	const char* GetName(void) { return "DAT"; };
+	HRESULT Parse(FILE *pFile, LONGLONG llFileSize);
+};
+
+//==========================================================================
+// Archive types table. A new archive layout is supported by deriving
+// its directory class and adding it here
+//==========================================================================
+
+typedef CArchiveDirectory* (*PFN_CREATE_DIRECTORY)(void);
+
+typedef struct tagARCHIVE_FORMAT {
+	const char				*pszName;	// Archive type name
+	PFN_CREATE_DIRECTORY	pfnCreate;	// Directory creation function
+} ARCHIVE_FORMAT;
+
+extern const ARCHIVE_FORMAT g_ArchiveFormats[];
+extern const int g_nArchiveFormats;
+
+//==========================================================================
+// Archive helpers
+//==========================================================================
+
+// Parse the directory of the archive trying all archive types.
+// Returns VFW_E_INVALID_FILE_FORMAT if none of them fits
+HRESULT OpenArchiveDirectory(FILE *pFile, CArchiveDirectory **ppDirectory);
+
+// Split the member path into the archive file name (allocated with
+// malloc()) and the member name (pointing into the path). Returns
+// S_FALSE if the path has no member separator
+HRESULT SplitArchivePath(const char *pszPath, char **ppszArchive, const char **ppszMember);
+
+// Get the archive file range of the member. The member is either
+// a name looked up in the archive directory or a byte range
+HRESULT GetArchiveMemberRange(
+	FILE *pFile,
+	const char *pszMember,
+	LONGLONG *pllOffset,
+	LONGLONG *pllSize
+);
+
+#endif
@@ -0,0 +1,37 @@
+//==========================================================================
+//
+// File: ArchiveGUID.h
+//
+// Desc: Game Media Formats - Definitions of archive source GUIDs
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License 
+// along with this program; if not, write to the Free Software 
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#ifndef __GMF_ARCHIVE_GUID_H__
+#define __GMF_ARCHIVE_GUID_H__
+
+#include <initguid.h>
+
+//
+// Archive source filter
+//
+// {3EC55C97-8637-4787-A11C-429810EDD5DC}
+DEFINE_GUID(CLSID_ArchiveSource, 
+0x3ec55c97, 0x8637, 0x4787, 0xa1, 0x1c, 0x42, 0x98, 0x10, 0xed, 0xd5, 0xdc);
+
+#endif
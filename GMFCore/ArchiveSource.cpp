@@ -0,0 +1,768 @@
+//==========================================================================
+//
+// File: ArchiveSource.cpp
+//
+// Desc: Game Media Formats - Implementation of archive source filter
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#include "ArchiveGUID.h"
+#include "ArchiveSource.h"
+#include "FileTypePatterns.h"
+
+#include "HNMGUID.h"
+#include "APCGUID.h"
+#include "CINGUID.h"
+#include "ROQGUID.h"
+#include "FSTGUID.h"
+#include "VQAGUID.h"
+#include "MVEGUID.h"
+#include "VMDGUID.h"
+#include "H263GUID.h"
+
+#include <stdio.h>
+
+//==========================================================================
+// Archive source setup data
+//==========================================================================
+
+// Global filter name
+const WCHAR g_wszArchiveSourceName[]	= L"ANX Archive Source";
+
+const AMOVIESETUP_MEDIATYPE sudArchiveStreamType = {
+	&MEDIATYPE_Stream,
+	&MEDIASUBTYPE_NULL
+};
+
+const AMOVIESETUP_PIN sudArchiveSourcePins[] = {
+	{	// Output pin
+		L"Output",				// Pin name
+		FALSE,					// Is it rendered
+		TRUE,					// Is it an output
+		FALSE,					// Allowed none
+		FALSE,					// Allowed many
+		&CLSID_NULL,			// Connects to filter
+		L"Input",				// Connects to pin
+		1,						// Number of types
+		&sudArchiveStreamType	// Media types
+	}
+};
+
+const AMOVIESETUP_FILTER g_sudArchiveSource = {
+	&CLSID_ArchiveSource,	// CLSID of filter
+	g_wszArchiveSourceName,	// Filter name
+	MERIT_UNLIKELY,			// Filter merit
+	1,						// Number of pins
+	sudArchiveSourcePins	// Pin information
+};
+
+//==========================================================================
+// Archive member types
+//
+// The member subtype is found by the same patterns the splitters
+// register for the standalone files. The formats having no patterns
+// are found by the member name extension only.
+//==========================================================================
+
+typedef struct tagARCHIVE_MEMBER_TYPE {
+	const GUID					*pSubtype;		// Media subtype
+	const GMF_FILETYPE_ENTRY	*pEntries;		// File type entries (NULL if none)
+	UINT						nEntries;		// Number of entries
+	const char					*pszExtension;	// Name extensions (separated by ';')
+} ARCHIVE_MEMBER_TYPE;
+
+static const ARCHIVE_MEMBER_TYPE g_ArchiveMemberTypes[] = {
+	{ &MEDIASUBTYPE_HNM,	sudHNMEntries,	1,	".hnm;.hns"	},
+	{ &MEDIASUBTYPE_APC,	sudAPCEntries,	1,	".apc"		},
+	{ &MEDIASUBTYPE_CIN,	NULL,			0,	".cin"		},
+	{ &MEDIASUBTYPE_ROQ,	sudROQEntries,	1,	".roq"		},
+	{ &MEDIASUBTYPE_FST,	sudFSTEntries,	1,	".fst"		},
+	{ &MEDIASUBTYPE_VQA,	sudVQAEntries,	1,	".vqa"		},
+	{ &MEDIASUBTYPE_MVE,	sudMVEEntries,	1,	".mve;.mv8"	},
+	{ &MEDIASUBTYPE_VMD,	sudVMDEntries,	1,	".vmd"		},
+	{ &MEDIASUBTYPE_H263,	NULL,			0,	".263"		}
+};
+
+static const int g_nArchiveMemberTypes = sizeof(g_ArchiveMemberTypes) / sizeof(g_ArchiveMemberTypes[0]);
+
+// Number of member starting bytes to match the patterns against
+#define ARCHIVE_SIGNATURE_SIZE	256
+
+//==========================================================================
+// CArchiveOutputPin methods
+//==========================================================================
+
+CArchiveOutputPin::CArchiveOutputPin(
+	CArchiveSourceFilter *pFilter,
+	CCritSec *pLock,
+	HRESULT *phr
+) :
+	CBasePin(
+		NAME("Archive Output Pin"),
+		pFilter,
+		pLock,
+		phr,
+		L"Output",
+		PINDIR_OUTPUT
+	),
+	m_pFilter(pFilter),
+	m_pHead(NULL),
+	m_pTail(NULL),
+	m_evRequest(TRUE),	// Manual reset
+	m_bFlushing(FALSE),
+	m_bQueriedForAsyncReader(FALSE)
+{
+}
+
+CArchiveOutputPin::~CArchiveOutputPin()
+{
+	// Drop the requests nobody picked up
+	while (m_pHead) {
+		ARCHIVE_REQUEST *pRequest = m_pHead;
+		m_pHead = pRequest->pNext;
+		delete pRequest;
+	}
+	m_pTail = NULL;
+}
+
+STDMETHODIMP CArchiveOutputPin::NonDelegatingQueryInterface(REFIID riid, void **ppv)
+{
+	CheckPointer(ppv, E_POINTER);
+
+	if (riid == IID_IAsyncReader) {
+		m_bQueriedForAsyncReader = TRUE;
+		return GetInterface((IAsyncReader*)this, ppv);
+	} else
+		return CBasePin::NonDelegatingQueryInterface(riid, ppv);
+}
+
+HRESULT CArchiveOutputPin::CheckMediaType(const CMediaType *pmt)
+{
+	CheckPointer(pmt, E_POINTER);
+
+	if (
+		(*pmt->Type() == *m_pFilter->m_mt.Type()) &&
+		(*pmt->Subtype() == *m_pFilter->m_mt.Subtype())
+	)
+		return S_OK;
+
+	return S_FALSE;
+}
+
+HRESULT CArchiveOutputPin::GetMediaType(int iPosition, CMediaType *pMediaType)
+{
+	CheckPointer(pMediaType, E_POINTER);
+
+	if (iPosition < 0)
+		return E_INVALIDARG;
+	if (iPosition > 0)
+		return VFW_S_NO_MORE_ITEMS;
+
+	*pMediaType = m_pFilter->m_mt;
+
+	return S_OK;
+}
+
+HRESULT CArchiveOutputPin::CheckConnect(IPin *pPin)
+{
+	m_bQueriedForAsyncReader = FALSE;
+
+	return CBasePin::CheckConnect(pPin);
+}
+
+HRESULT CArchiveOutputPin::CompleteConnect(IPin *pReceivePin)
+{
+	// The downstream pin should pull the data itself
+	if (!m_bQueriedForAsyncReader)
+		return VFW_E_NO_TRANSPORT;
+
+	return CBasePin::CompleteConnect(pReceivePin);
+}
+
+HRESULT CArchiveOutputPin::BreakConnect(void)
+{
+	m_bQueriedForAsyncReader = FALSE;
+
+	return CBasePin::BreakConnect();
+}
+
+HRESULT CArchiveOutputPin::ReadSample(IMediaSample *pSample)
+{
+	// Get the byte range of the sample
+	REFERENCE_TIME tStart, tStop;
+	HRESULT hr = pSample->GetTime(&tStart, &tStop);
+	if (FAILED(hr))
+		return hr;
+
+	LONGLONG llPosition	= tStart / UNITS;
+	LONG lLength		= (LONG)((tStop - tStart) / UNITS);
+	if ((llPosition < 0) || (lLength < 0) || (lLength > pSample->GetSize()))
+		return E_INVALIDARG;
+
+	BYTE *pbBuffer = NULL;
+	hr = pSample->GetPointer(&pbBuffer);
+	if (FAILED(hr))
+		return hr;
+
+	LONG lRead = 0;
+	hr = m_pFilter->ReadMember(llPosition, lLength, pbBuffer, &lRead);
+	if (FAILED(hr))
+		return hr;
+
+	pSample->SetActualDataLength(lRead);
+
+	// Cut the sample at the member end
+	if (lRead < lLength) {
+		tStop = tStart + (REFERENCE_TIME)lRead * UNITS;
+		pSample->SetTime(&tStart, &tStop);
+	}
+
+	return hr;
+}
+
+STDMETHODIMP CArchiveOutputPin::RequestAllocator(
+	IMemAllocator *pPreferred,
+	ALLOCATOR_PROPERTIES *pProps,
+	IMemAllocator **ppActual
+)
+{
+	CheckPointer(pProps, E_POINTER);
+	CheckPointer(ppActual, E_POINTER);
+
+	*ppActual = NULL;
+
+	// The reads need no particular alignment
+	if (pProps->cbAlign == 0)
+		pProps->cbAlign = 1;
+
+	ALLOCATOR_PROPERTIES apActual;
+	HRESULT hr;
+
+	// Try the allocator offered by the downstream pin first
+	if (pPreferred) {
+		hr = pPreferred->SetProperties(pProps, &apActual);
+		if (SUCCEEDED(hr)) {
+			pPreferred->AddRef();
+			*ppActual = pPreferred;
+			return S_OK;
+		}
+	}
+
+	// Create our own allocator
+	hr = NOERROR;
+	CMemAllocator *pMemAllocator = new CMemAllocator(NAME("Archive Allocator"), NULL, &hr);
+	if (pMemAllocator == NULL)
+		return E_OUTOFMEMORY;
+	if (FAILED(hr)) {
+		delete pMemAllocator;
+		return hr;
+	}
+
+	IMemAllocator *pAllocator = NULL;
+	hr = pMemAllocator->QueryInterface(IID_IMemAllocator, (void**)&pAllocator);
+	if (FAILED(hr)) {
+		delete pMemAllocator;
+		return hr;
+	}
+
+	hr = pAllocator->SetProperties(pProps, &apActual);
+	if (FAILED(hr)) {
+		pAllocator->Release();
+		return hr;
+	}
+
+	*ppActual = pAllocator;
+
+	return S_OK;
+}
+
+STDMETHODIMP CArchiveOutputPin::Request(IMediaSample *pSample, DWORD_PTR dwUser)
+{
+	CheckPointer(pSample, E_POINTER);
+
+	{
+		CAutoLock lock(&m_csRequests);
+
+		if (m_bFlushing)
+			return VFW_E_WRONG_STATE;
+	}
+
+	ARCHIVE_REQUEST *pRequest = new ARCHIVE_REQUEST;
+	if (pRequest == NULL)
+		return E_OUTOFMEMORY;
+
+	// The archive file is local, so the request is completed right
+	// away (the read errors are reported by WaitForNext())
+	pRequest->pSample	= pSample;
+	pRequest->dwUser	= dwUser;
+	pRequest->hr		= ReadSample(pSample);
+	pRequest->pNext		= NULL;
+
+	CAutoLock lock(&m_csRequests);
+
+	if (m_pTail)
+		m_pTail->pNext = pRequest;
+	else
+		m_pHead = pRequest;
+	m_pTail = pRequest;
+
+	m_evRequest.Set();
+
+	return S_OK;
+}
+
+STDMETHODIMP CArchiveOutputPin::WaitForNext(
+	DWORD dwTimeout,
+	IMediaSample **ppSample,
+	DWORD_PTR *pdwUser
+)
+{
+	CheckPointer(ppSample, E_POINTER);
+	CheckPointer(pdwUser, E_POINTER);
+
+	*ppSample	= NULL;
+	*pdwUser	= 0;
+
+	for (;;) {
+
+		{
+			CAutoLock lock(&m_csRequests);
+
+			ARCHIVE_REQUEST *pRequest = m_pHead;
+			if (pRequest) {
+
+				// Dequeue the request
+				m_pHead = pRequest->pNext;
+				if (m_pHead == NULL) {
+					m_pTail = NULL;
+					if (!m_bFlushing)
+						m_evRequest.Reset();
+				}
+
+				*ppSample	= pRequest->pSample;
+				*pdwUser	= pRequest->dwUser;
+
+				// The requests handed out while flushing are cancelled
+				HRESULT hr = (m_bFlushing) ? VFW_E_WRONG_STATE : pRequest->hr;
+
+				delete pRequest;
+
+				return hr;
+			}
+
+			if (m_bFlushing)
+				return VFW_E_WRONG_STATE;
+		}
+
+		if (!m_evRequest.Wait(dwTimeout))
+			return VFW_E_TIMEOUT;
+	}
+}
+
+STDMETHODIMP CArchiveOutputPin::SyncReadAligned(IMediaSample *pSample)
+{
+	CheckPointer(pSample, E_POINTER);
+
+	return ReadSample(pSample);
+}
+
+STDMETHODIMP CArchiveOutputPin::SyncRead(LONGLONG llPosition, LONG lLength, BYTE *pBuffer)
+{
+	CheckPointer(pBuffer, E_POINTER);
+
+	LONG lRead = 0;
+
+	return m_pFilter->ReadMember(llPosition, lLength, pBuffer, &lRead);
+}
+
+STDMETHODIMP CArchiveOutputPin::Length(LONGLONG *pTotal, LONGLONG *pAvailable)
+{
+	CheckPointer(pTotal, E_POINTER);
+	CheckPointer(pAvailable, E_POINTER);
+
+	*pTotal		= m_pFilter->GetMemberSize();
+	*pAvailable	= *pTotal;
+
+	return S_OK;
+}
+
+STDMETHODIMP CArchiveOutputPin::BeginFlush(void)
+{
+	CAutoLock lock(&m_csRequests);
+
+	// Release the waiting WaitForNext() callers
+	m_bFlushing = TRUE;
+	m_evRequest.Set();
+
+	return S_OK;
+}
+
+STDMETHODIMP CArchiveOutputPin::EndFlush(void)
+{
+	CAutoLock lock(&m_csRequests);
+
+	m_bFlushing = FALSE;
+	if (m_pHead == NULL)
+		m_evRequest.Reset();
+
+	return S_OK;
+}
+
+//==========================================================================
+// CArchiveSourceFilter methods
+//==========================================================================
+
+CArchiveSourceFilter::CArchiveSourceFilter(LPUNKNOWN pUnk, HRESULT *phr) :
+	CBaseFilter(
+		NAME("Archive Source"),
+		pUnk,
+		&m_csFilter,
+		CLSID_ArchiveSource
+	),
+	m_pOutputPin(NULL),
+	m_wszFileName(NULL),
+	m_hFile(INVALID_HANDLE_VALUE),
+	m_llBase(0),
+	m_llSize(0)
+{
+	m_pOutputPin = new CArchiveOutputPin(this, &m_csFilter, phr);
+	if (m_pOutputPin == NULL) {
+		if (phr)
+			*phr = E_OUTOFMEMORY;
+	}
+}
+
+CArchiveSourceFilter::~CArchiveSourceFilter()
+{
+	if (m_pOutputPin)
+		delete m_pOutputPin;
+
+	Close();
+}
+
+CUnknown* WINAPI CArchiveSourceFilter::CreateInstance(LPUNKNOWN pUnk, HRESULT *phr)
+{
+	CArchiveSourceFilter *pNewObject = new CArchiveSourceFilter(pUnk, phr);
+	if (pNewObject == NULL)
+		*phr = E_OUTOFMEMORY;
+
+	return pNewObject;
+}
+
+STDMETHODIMP CArchiveSourceFilter::NonDelegatingQueryInterface(REFIID riid, void **ppv)
+{
+	CheckPointer(ppv, E_POINTER);
+
+	if (riid == IID_IFileSourceFilter)
+		return GetInterface((IFileSourceFilter*)this, ppv);
+	else
+		return CBaseFilter::NonDelegatingQueryInterface(riid, ppv);
+}
+
+int CArchiveSourceFilter::GetPinCount(void)
+{
+	// The pin appears once the member is loaded
+	return (m_hFile != INVALID_HANDLE_VALUE) ? 1 : 0;
+}
+
+CBasePin* CArchiveSourceFilter::GetPin(int n)
+{
+	if ((n == 0) && (m_hFile != INVALID_HANDLE_VALUE))
+		return m_pOutputPin;
+
+	return NULL;
+}
+
+void CArchiveSourceFilter::Close(void)
+{
+	if (m_hFile != INVALID_HANDLE_VALUE) {
+		CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+
+	if (m_wszFileName) {
+		delete[] m_wszFileName;
+		m_wszFileName = NULL;
+	}
+
+	m_llBase = 0;
+	m_llSize = 0;
+	m_mt.InitMediaType();
+}
+
+const GUID* CArchiveSourceFilter::GetMemberSubtype(const char *pszMember)
+{
+	// Match the member signature first
+	BYTE pbSignature[ARCHIVE_SIGNATURE_SIZE];
+	LONG cbSignature = 0;
+	if (FAILED(ReadMember(0, ARCHIVE_SIGNATURE_SIZE, pbSignature, &cbSignature)))
+		cbSignature = 0;
+
+	for (int iType = 0; iType < g_nArchiveMemberTypes; iType++) {
+
+		const ARCHIVE_MEMBER_TYPE *pType = &g_ArchiveMemberTypes[iType];
+
+		for (UINT iEntry = 0; iEntry < pType->nEntries; iEntry++)
+			if (MatchFileTypeEntry(&pType->pEntries[iEntry], pbSignature, cbSignature))
+				return pType->pSubtype;
+	}
+
+	// Then try the name extension (the member given by the byte
+	// range has no name)
+	const char *pszExtension = strrchr(pszMember, '.');
+	if ((pszExtension == NULL) || (pszMember[0] == ARCHIVE_RANGE_PREFIX))
+		return &GUID_NULL;
+
+	size_t cchExtension = strlen(pszExtension);
+
+	for (int iType = 0; iType < g_nArchiveMemberTypes; iType++) {
+
+		const char *pszList = g_ArchiveMemberTypes[iType].pszExtension;
+
+		while (*pszList) {
+
+			const char *pszEnd = strchr(pszList, ';');
+			size_t cchItem = (pszEnd) ? (size_t)(pszEnd - pszList) : strlen(pszList);
+
+			if ((cchItem == cchExtension) && (_strnicmp(pszList, pszExtension, cchItem) == 0))
+				return g_ArchiveMemberTypes[iType].pSubtype;
+
+			pszList += cchItem;
+			if (*pszList == ';')
+				pszList++;
+		}
+	}
+
+	return &GUID_NULL;
+}
+
+STDMETHODIMP CArchiveSourceFilter::Load(LPCOLESTR pszFileName, const AM_MEDIA_TYPE *pmt)
+{
+	CheckPointer(pszFileName, E_POINTER);
+
+	CAutoLock lock(&m_csFilter);
+
+	// Only one member per filter instance
+	if (m_hFile != INVALID_HANDLE_VALUE)
+		return E_UNEXPECTED;
+
+	// Skip the protocol (the graph builder passes the full URL)
+	LPCWSTR wszPath = pszFileName;
+	size_t cchPrefix = wcslen(ARCHIVE_PROTOCOL_PREFIX);
+	if (_wcsnicmp(wszPath, ARCHIVE_PROTOCOL_PREFIX, cchPrefix) == 0)
+		wszPath += cchPrefix;
+
+	// Split the path at the last separator (as SplitArchivePath() does)
+	LPCWSTR wszSeparator = wcsrchr(wszPath, (WCHAR)ARCHIVE_MEMBER_SEPARATOR);
+	if ((wszSeparator == NULL) || (wszSeparator == wszPath) || (wszSeparator[1] == L'\0'))
+		return E_INVALIDARG;
+
+	size_t cchArchive = wszSeparator - wszPath;
+	WCHAR *wszArchive = new WCHAR[cchArchive + 1];
+	if (wszArchive == NULL)
+		return E_OUTOFMEMORY;
+	CopyMemory(wszArchive, wszPath, cchArchive * sizeof(WCHAR));
+	wszArchive[cchArchive] = L'\0';
+
+	// The archive directories keep the ANSI member names
+	char szMember[MAX_PATH];
+	if (!WideCharToMultiByte(CP_ACP, 0, wszSeparator + 1, -1, szMember, MAX_PATH, NULL, NULL)) {
+		delete[] wszArchive;
+		return E_INVALIDARG;
+	}
+
+	// Locate the member data in the archive
+	FILE *pFile = _wfopen(wszArchive, L"rb");
+	if (pFile == NULL) {
+		delete[] wszArchive;
+		return VFW_E_NOT_FOUND;
+	}
+
+	LONGLONG llBase, llSize;
+	HRESULT hr = GetArchiveMemberRange(pFile, szMember, &llBase, &llSize);
+	fclose(pFile);
+	if (FAILED(hr)) {
+		delete[] wszArchive;
+		return hr;
+	}
+
+	// Open the archive for the member reads
+	m_hFile = CreateFileW(
+		wszArchive,
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		NULL,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL,
+		NULL
+	);
+	delete[] wszArchive;
+	if (m_hFile == INVALID_HANDLE_VALUE)
+		return AmHresultFromWin32(GetLastError());
+
+	m_llBase = llBase;
+	m_llSize = llSize;
+
+	// Remember the member path
+	size_t cchFileName = wcslen(pszFileName);
+	m_wszFileName = new WCHAR[cchFileName + 1];
+	if (m_wszFileName == NULL) {
+		Close();
+		return E_OUTOFMEMORY;
+	}
+	CopyMemory(m_wszFileName, pszFileName, (cchFileName + 1) * sizeof(WCHAR));
+
+	// Take the media type given by the caller or find one
+	m_mt.InitMediaType();
+	m_mt.SetType(&MEDIATYPE_Stream);
+	if ((pmt) && (pmt->subtype != GUID_NULL))
+		m_mt.SetSubtype(&pmt->subtype);
+	else
+		m_mt.SetSubtype(GetMemberSubtype(szMember));
+
+	return S_OK;
+}
+
+STDMETHODIMP CArchiveSourceFilter::GetCurFile(LPOLESTR *ppszFileName, AM_MEDIA_TYPE *pmt)
+{
+	CheckPointer(ppszFileName, E_POINTER);
+
+	CAutoLock lock(&m_csFilter);
+
+	*ppszFileName = NULL;
+
+	if (m_wszFileName == NULL)
+		return E_FAIL;
+
+	DWORD cbFileName = sizeof(WCHAR) * (lstrlenW(m_wszFileName) + 1);
+	*ppszFileName = (LPOLESTR)CoTaskMemAlloc(cbFileName);
+	if (*ppszFileName == NULL)
+		return E_OUTOFMEMORY;
+	CopyMemory(*ppszFileName, m_wszFileName, cbFileName);
+
+	if (pmt)
+		CopyMediaType(pmt, &m_mt);
+
+	return S_OK;
+}
+
+HRESULT CArchiveSourceFilter::ReadMember(
+	LONGLONG llPosition,
+	LONG lLength,
+	BYTE *pBuffer,
+	LONG *plRead
+)
+{
+	CAutoLock lock(&m_csFile);
+
+	*plRead = 0;
+
+	if (m_hFile == INVALID_HANDLE_VALUE)
+		return E_UNEXPECTED;
+	if ((llPosition < 0) || (lLength < 0))
+		return E_INVALIDARG;
+
+	// Cut the read at the member end
+	LONG lToRead = lLength;
+	if (llPosition >= m_llSize)
+		lToRead = 0;
+	else if (llPosition + lToRead > m_llSize)
+		lToRead = (LONG)(m_llSize - llPosition);
+
+	if (lToRead > 0) {
+
+		LARGE_INTEGER liPosition;
+		liPosition.QuadPart = m_llBase + llPosition;
+		if (!SetFilePointerEx(m_hFile, liPosition, NULL, FILE_BEGIN))
+			return AmHresultFromWin32(GetLastError());
+
+		DWORD cbRead = 0;
+		if (!ReadFile(m_hFile, pBuffer, lToRead, &cbRead, NULL))
+			return AmHresultFromWin32(GetLastError());
+
+		*plRead = (LONG)cbRead;
+	}
+
+	return (*plRead == lLength) ? S_OK : S_FALSE;
+}
+
+HRESULT CArchiveSourceFilter::RegisterProtocol(BOOL bRegister)
+{
+	// Compose registry path
+	TCHAR szPath[MAX_PATH];
+	wsprintf(
+		szPath,
+		TEXT("%ls"),
+		ARCHIVE_PROTOCOL
+	);
+
+	// Delete the key if it exists
+	RegDeleteKey(HKEY_CLASSES_ROOT, szPath);
+
+	if (!bRegister)
+		return NOERROR;
+
+	// Convert source filter CLSID to string
+	OLECHAR szSrcFlt[CHARS_IN_GUID];
+	if (!StringFromGUID2(CLSID_ArchiveSource, szSrcFlt, CHARS_IN_GUID))
+		return E_FAIL;
+
+	// Convert CLSID string from OLECHAR to TCHAR
+	TCHAR szSourceFilter[MAX_PATH];
+	wsprintf(
+		szSourceFilter,
+		TEXT("%ls"),
+		szSrcFlt
+	);
+
+	// Create the key
+	HKEY hk;
+	DWORD dwDisposition;
+	LONG lr = RegCreateKeyEx(
+		HKEY_CLASSES_ROOT,
+		szPath,
+		0,
+		NULL,
+		REG_OPTION_NON_VOLATILE,
+		KEY_SET_VALUE,
+		NULL,
+		&hk,
+		&dwDisposition
+	);
+	if (lr != ERROR_SUCCESS)
+		return AmHresultFromWin32(lr);
+
+	// Set the source filter CLSID, so the graph builder hands
+	// the protocol URLs to the archive source
+	lr = RegSetValueEx(
+		hk,
+		TEXT("Source Filter"),
+		0,
+		REG_SZ,
+		(LPBYTE)szSourceFilter,
+		sizeof(TCHAR) * (lstrlen(szSourceFilter) + 1)
+	);
+	RegCloseKey(hk);
+	if (lr != ERROR_SUCCESS) {
+		RegDeleteKey(HKEY_CLASSES_ROOT, szPath);
+		return AmHresultFromWin32(lr);
+	}
+
+	return NOERROR;
+}
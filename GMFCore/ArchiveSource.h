@@ -0,0 +1,193 @@
+//==========================================================================
+//
+// File: ArchiveSource.h
+//
+// Desc: Game Media Formats - Header file for archive source filter
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#ifndef __GMF_ARCHIVE_SOURCE_H__
+#define __GMF_ARCHIVE_SOURCE_H__
+
+#include <streams.h>
+
+#include "ArchiveDirectory.h"
+
+// Protocol of the archive member URLs ("gmfarc:movies.mix|intro.vqa").
+// The protocol is registered to the archive source, so such URLs can
+// be rendered as any other file
+#define ARCHIVE_PROTOCOL		L"gmfarc"
+#define ARCHIVE_PROTOCOL_PREFIX	L"gmfarc:"
+
+class CArchiveSourceFilter;
+
+//==========================================================================
+// Archive output pin class
+//
+// The pin provides IAsyncReader for the member data range of the
+// archive file, so the splitters connected to it see the member as
+// a standalone file. The reads are done right in Request() and
+// the completed requests are handed out by WaitForNext() in order.
+//==========================================================================
+
+class CArchiveOutputPin : public CBasePin, public IAsyncReader
+{
+
+	// Completed request
+	typedef struct tagARCHIVE_REQUEST {
+		IMediaSample				*pSample;	// Request sample
+		DWORD_PTR					dwUser;		// User context
+		HRESULT						hr;			// Read result
+		struct tagARCHIVE_REQUEST	*pNext;		// Next request in the queue
+	} ARCHIVE_REQUEST;
+
+	CArchiveSourceFilter *m_pFilter;	// Parent filter
+
+	CCritSec			m_csRequests;	// Requests queue protection
+	ARCHIVE_REQUEST		*m_pHead;		// First completed request
+	ARCHIVE_REQUEST		*m_pTail;		// Last completed request
+	CAMEvent			m_evRequest;	// Set when the queue is not empty or flushing
+	BOOL				m_bFlushing;	// Is the pin flushing?
+
+	// Did the downstream pin query IAsyncReader? (the connection
+	// is refused if not, since there is nothing else to pull data)
+	BOOL m_bQueriedForAsyncReader;
+
+	// Read the data of the sample according to its time stamps
+	// (which are the byte positions times UNITS)
+	HRESULT ReadSample(IMediaSample *pSample);
+
+public:
+
+	CArchiveOutputPin(
+		CArchiveSourceFilter *pFilter,	// Parent filter
+		CCritSec *pLock,				// Critical section protecting filter state
+		HRESULT *phr					// Success or error code
+	);
+	~CArchiveOutputPin();
+
+	DECLARE_IUNKNOWN
+
+	STDMETHODIMP NonDelegatingQueryInterface(REFIID riid, void **ppv);
+
+	// ---- CBasePin methods -----
+
+	HRESULT CheckMediaType(const CMediaType *pmt);
+	HRESULT GetMediaType(int iPosition, CMediaType *pMediaType);
+	HRESULT CheckConnect(IPin *pPin);
+	HRESULT CompleteConnect(IPin *pReceivePin);
+	HRESULT BreakConnect(void);
+
+	// ---- IAsyncReader methods -----
+
+	STDMETHODIMP RequestAllocator(
+		IMemAllocator *pPreferred,
+		ALLOCATOR_PROPERTIES *pProps,
+		IMemAllocator **ppActual
+	);
+	STDMETHODIMP Request(IMediaSample *pSample, DWORD_PTR dwUser);
+	STDMETHODIMP WaitForNext(
+		DWORD dwTimeout,
+		IMediaSample **ppSample,
+		DWORD_PTR *pdwUser
+	);
+	STDMETHODIMP SyncReadAligned(IMediaSample *pSample);
+	STDMETHODIMP SyncRead(LONGLONG llPosition, LONG lLength, BYTE *pBuffer);
+	STDMETHODIMP Length(LONGLONG *pTotal, LONGLONG *pAvailable);
+
+	// IPin has the same flushing methods, but they are never called
+	// on an output pin, so these are IAsyncReader's ones
+	STDMETHODIMP BeginFlush(void);
+	STDMETHODIMP EndFlush(void);
+
+};
+
+//==========================================================================
+// Archive source filter class
+//
+// The filter opens the archive member given by the member path
+// ("archive|member", see ArchiveDirectory.h) and serves its data
+// range through the output pin. The pin media type subtype is found
+// by the member signature (or by its name extension).
+//==========================================================================
+
+class CArchiveSourceFilter : public CBaseFilter, public IFileSourceFilter
+{
+
+	friend class CArchiveOutputPin;
+
+	CCritSec m_csFilter;	// Filter state protection
+	CCritSec m_csFile;		// Archive file access protection
+
+	CArchiveOutputPin *m_pOutputPin;	// Output pin
+
+	LPWSTR		m_wszFileName;	// Member path given to Load()
+	HANDLE		m_hFile;		// Archive file
+	LONGLONG	m_llBase;		// Archive file offset of the member data
+	LONGLONG	m_llSize;		// Size of the member data
+	CMediaType	m_mt;			// Output media type
+
+	CArchiveSourceFilter(LPUNKNOWN pUnk, HRESULT *phr);
+	~CArchiveSourceFilter();
+
+	// Find the output media subtype by the member data signature
+	// and name. Returns GUID_NULL if the member type is not known
+	const GUID* GetMemberSubtype(const char *pszMember);
+
+	// Close the archive and forget the member
+	void Close(void);
+
+public:
+
+	static CUnknown* WINAPI CreateInstance(LPUNKNOWN pUnk, HRESULT *phr);
+
+	// Register (or unregister) the archive member URL protocol
+	static HRESULT RegisterProtocol(BOOL bRegister);
+
+	DECLARE_IUNKNOWN
+
+	STDMETHODIMP NonDelegatingQueryInterface(REFIID riid, void **ppv);
+
+	// ---- CBaseFilter methods -----
+
+	int GetPinCount(void);
+	CBasePin* GetPin(int n);
+
+	// ---- IFileSourceFilter methods -----
+
+	STDMETHODIMP Load(LPCOLESTR pszFileName, const AM_MEDIA_TYPE *pmt);
+	STDMETHODIMP GetCurFile(LPOLESTR *ppszFileName, AM_MEDIA_TYPE *pmt);
+
+	// Read the member data (the position is relative to the member
+	// start). The read is cut off at the member end, the number of
+	// bytes read is returned in *plRead
+	HRESULT ReadMember(LONGLONG llPosition, LONG lLength, BYTE *pBuffer, LONG *plRead);
+
+	LONGLONG GetMemberSize(void) { return m_llSize; };
+
+};
+
+//==========================================================================
+// Archive source setup data
+//==========================================================================
+
+extern const WCHAR g_wszArchiveSourceName[];
+extern const AMOVIESETUP_FILTER g_sudArchiveSource;
+
+#endif
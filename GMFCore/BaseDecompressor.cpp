@@ -0,0 +1,238 @@
+//==========================================================================
+//
+// File: BaseDecompressor.cpp
+//
+// Desc: Game Media Formats - Implementation of base decompressor filter
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#include "BaseDecompressor.h"
+
+//==========================================================================
+// CBaseDecompressorFilter methods
+//==========================================================================
+
+CBaseDecompressorFilter::CBaseDecompressorFilter(
+	TCHAR *pName,
+	LPUNKNOWN pUnk,
+	REFCLSID clsid
+) :
+	CTransformFilter(pName, pUnk, clsid)
+{
+	// No statistics yet
+	ZeroMemory(&m_Statistics, sizeof(GMF_FILTER_STATISTICS));
+	ZeroMemory(&m_PinStatistics, sizeof(GMF_PIN_STATISTICS));
+
+	// Start the stream trace (if it's enabled)
+	StartStreamTrace();
+}
+
+CBaseDecompressorFilter::~CBaseDecompressorFilter()
+{
+	// Stop the stream trace (if this is the last filter)
+	StopStreamTrace();
+}
+
+STDMETHODIMP CBaseDecompressorFilter::NonDelegatingQueryInterface(REFIID riid, void **ppv)
+{
+	// Check and validate the pointer
+	CheckPointer(ppv, E_POINTER);
+	ValidateReadWritePtr(ppv, sizeof(PVOID));
+
+	// Expose IFilterStatistics (and the base-class interfaces)
+	if (riid == IID_IFilterStatistics)
+		return GetInterface((IFilterStatistics*)this, ppv);
+	else
+		return CTransformFilter::NonDelegatingQueryInterface(riid, ppv);
+}
+
+HRESULT CBaseDecompressorFilter::Receive(IMediaSample *pSample)
+{
+	ASSERT(pSample);
+	ASSERT(m_pOutput != NULL);
+
+	// Pass the other streams' samples on
+	AM_SAMPLE2_PROPERTIES * const pProps = m_pInput->SampleProps();
+	if (pProps->dwStreamId != AM_STREAM_MEDIA)
+		return m_pOutput->Deliver(pSample);
+
+	LONG lInDataLength = pSample->GetActualDataLength();
+
+	// The preroll samples only bring the decoder state up to the 
+	// seek point (the splitter delivers them ahead of the frame the 
+	// playback starts from), so their output is not delivered
+	BOOL bIsPreroll = (pSample->IsPreroll() == S_OK);
+
+	// Set up the output sample
+	LONGLONG llStartTime = GetStatisticsTime();
+	IMediaSample *pOutSample = NULL;
+	HRESULT hr = InitializeOutputSample(pSample, &pOutSample);
+	LONGLONG llWaitTime = GetStatisticsTime() - llStartTime;
+
+	// Scope for the locking
+	{
+		// Protect the statistics
+		CAutoLock statlock(&m_csStatistics);
+
+		// Update the input and allocator wait counters
+		m_Statistics.llSamplesReceived++;
+		m_Statistics.llBytesReceived			+= lInDataLength;
+		m_PinStatistics.llAllocatorWaitTime		+= llWaitTime;
+		if (llWaitTime > GMF_STATISTICS_WAIT_THRESHOLD)
+			m_PinStatistics.llAllocatorWaits++;
+	}
+
+	if (FAILED(hr))
+		return hr;
+
+	// Have the derived class transform the data. The trace 
+	// stream name is the filter name in the graph
+	llStartTime = GetStatisticsTime();
+	{
+		CTraceSpan span("Transform", m_pName, "time", GetTraceSampleTime(pSample));
+		hr = Transform(pSample, pOutSample);
+	}
+	LONGLONG llProcessingTime = GetStatisticsTime() - llStartTime;
+
+	// Scope for the locking
+	{
+		// Protect the statistics
+		CAutoLock statlock(&m_csStatistics);
+
+		m_Statistics.llProcessingTime += llProcessingTime;
+		if ((hr == S_FALSE) && (!bIsPreroll))
+			m_Statistics.llSamplesRejected++;
+	}
+
+	if (FAILED(hr)) {
+		DbgLog((LOG_TRACE, 1, TEXT("Error from transform")));
+	} else if ((hr == NOERROR) && (!bIsPreroll)) {
+
+		LONG lOutDataLength = pOutSample->GetActualDataLength();
+
+		// Deliver the sample
+		llStartTime = GetStatisticsTime();
+		hr = m_pOutput->Deliver(pOutSample);
+		LONGLONG llDeliveryTime = GetStatisticsTime() - llStartTime;
+		m_bSampleSkipped = FALSE;
+
+		// Scope for the locking
+		{
+			// Protect the statistics
+			CAutoLock statlock(&m_csStatistics);
+
+			// Update the delivery counters
+			if (SUCCEEDED(hr)) {
+				m_PinStatistics.llSamplesDelivered++;
+				m_PinStatistics.llBytesDelivered += lOutDataLength;
+			}
+			m_PinStatistics.llDeliveryTime += llDeliveryTime;
+		}
+
+	} else {
+
+		// S_FALSE from Transform() means that the sample should not
+		// be delivered, but we should not return S_FALSE from Receive()
+		// as it means the end of the stream. Release the sample before
+		// notifying to avoid deadlocks (just as the base class does).
+		// Dropping the preroll sample output is no quality change
+		pOutSample->Release();
+		if (!bIsPreroll) {
+			m_bSampleSkipped = TRUE;
+			if (!m_bQualityChanged) {
+				NotifyEvent(EC_QUALITY_CHANGE, 0, 0);
+				m_bQualityChanged = TRUE;
+			}
+		}
+		return NOERROR;
+	}
+
+	// Release the output buffer. If the connected pin still
+	// needs it, it will have addrefed it itself
+	pOutSample->Release();
+
+	return hr;
+}
+
+STDMETHODIMP CBaseDecompressorFilter::GetStatistics(GMF_FILTER_STATISTICS *pStatistics)
+{
+	// Check and validate the pointer
+	CheckPointer(pStatistics, E_POINTER);
+	ValidateWritePtr(pStatistics, sizeof(GMF_FILTER_STATISTICS));
+
+	// Protect the statistics
+	CAutoLock statlock(&m_csStatistics);
+
+	*pStatistics = m_Statistics;
+
+	// Add the output pin counters
+	pStatistics->llSamplesDelivered		= m_PinStatistics.llSamplesDelivered;
+	pStatistics->llDeliveryTime			= m_PinStatistics.llDeliveryTime;
+	pStatistics->llAllocatorWaits		= m_PinStatistics.llAllocatorWaits;
+	pStatistics->llAllocatorWaitTime	= m_PinStatistics.llAllocatorWaitTime;
+
+	return NOERROR;
+}
+
+STDMETHODIMP CBaseDecompressorFilter::GetOutputPinStatistics(int iPin, GMF_PIN_STATISTICS *pStatistics)
+{
+	// Check and validate the pointer
+	CheckPointer(pStatistics, E_POINTER);
+	ValidateWritePtr(pStatistics, sizeof(GMF_PIN_STATISTICS));
+
+	// There's only one output pin
+	if (iPin != 0)
+		return E_INVALIDARG;
+
+	// Protect the statistics
+	CAutoLock statlock(&m_csStatistics);
+
+	*pStatistics = m_PinStatistics;
+
+	return NOERROR;
+}
+
+STDMETHODIMP CBaseDecompressorFilter::GetChunkTypeCount(int *pnCount)
+{
+	// Check and validate the pointer
+	CheckPointer(pnCount, E_POINTER);
+	ValidateWritePtr(pnCount, sizeof(int));
+
+	// There are no chunks in the decompressor input
+	*pnCount = 0;
+
+	return NOERROR;
+}
+
+STDMETHODIMP CBaseDecompressorFilter::GetChunkStatistics(int iType, GMF_CHUNK_STATISTICS *pStatistics)
+{
+	// There are no chunk types to report
+	return E_INVALIDARG;
+}
+
+STDMETHODIMP CBaseDecompressorFilter::ResetStatistics(void)
+{
+	// Protect the statistics
+	CAutoLock statlock(&m_csStatistics);
+
+	ZeroMemory(&m_Statistics, sizeof(GMF_FILTER_STATISTICS));
+	ZeroMemory(&m_PinStatistics, sizeof(GMF_PIN_STATISTICS));
+
+	return NOERROR;
+}
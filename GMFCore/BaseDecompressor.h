@@ -0,0 +1,84 @@
+//==========================================================================
+//
+// File: BaseDecompressor.h
+//
+// Desc: Game Media Formats - Header file for base decompressor filter
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#ifndef __GMF_BASE_DECOMPRESSOR_H__
+#define __GMF_BASE_DECOMPRESSOR_H__
+
+#include <streams.h>
+
+#include "FilterStatistics.h"
+#include "StreamTrace.h"
+
+//==========================================================================
+// Base decompressor filter class
+//
+// Transform filter which collects the performance counters and exposes
+// them via IFilterStatistics. The derived class implements Transform()
+// and the media type methods as it would do for CTransformFilter.
+// The decompressor has no chunks to count and its only output pin
+// has no queue, so the chunk type count and the queue depth are zeros
+//==========================================================================
+
+class CBaseDecompressorFilter :	public CTransformFilter,
+								public IFilterStatistics
+{
+
+public:
+
+	DECLARE_IUNKNOWN
+
+	// Overridden to expose IFilterStatistics
+	STDMETHODIMP NonDelegatingQueryInterface(REFIID riid, void **ppv);
+
+	// Overridden to collect the statistics. Does the same as the
+	// base-class method, but measures the buffer wait, Transform()
+	// and delivery times separately (and traces Transform() calls)
+	HRESULT Receive(IMediaSample *pSample);
+
+	// IFilterStatistics methods
+	STDMETHODIMP GetStatistics(GMF_FILTER_STATISTICS *pStatistics);
+	STDMETHODIMP GetOutputPinStatistics(int iPin, GMF_PIN_STATISTICS *pStatistics);
+	STDMETHODIMP GetChunkTypeCount(int *pnCount);
+	STDMETHODIMP GetChunkStatistics(int iType, GMF_CHUNK_STATISTICS *pStatistics);
+	STDMETHODIMP ResetStatistics(void);
+
+protected:
+
+	// Construction/destruction
+	CBaseDecompressorFilter(
+		TCHAR *pName,	// Object name
+		LPUNKNOWN pUnk,	// Controlling IUnknown
+		REFCLSID clsid	// CLSID of the filter
+	);
+	virtual ~CBaseDecompressorFilter();
+
+	// ---- Statistics ----
+
+	CCritSec m_csStatistics;				// Statistics protection
+	GMF_FILTER_STATISTICS m_Statistics;		// Filter-wide counters
+	GMF_PIN_STATISTICS m_PinStatistics;		// Output pin counters
+
+};
+
+#endif
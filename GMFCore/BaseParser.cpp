@@ -30,6 +30,32 @@
 
 #include <commctrl.h>
 
+// Get the name of the file read by the filter the pin belongs to
+// (S_FALSE if that filter does not read a file). The caller should
+// free the name with CoTaskMemFree()
+static HRESULT GetSourceFileName(IPin *pPin, LPOLESTR *ppszFileName)
+{
+	*ppszFileName = NULL;
+
+	PIN_INFO pi;
+	HRESULT hr = pPin->QueryPinInfo(&pi);
+	if (FAILED(hr))
+		return S_FALSE;
+	if (pi.pFilter == NULL)
+		return S_FALSE;
+	IFileSourceFilter *pFileSource = NULL;
+	hr = pi.pFilter->QueryInterface(IID_IFileSourceFilter, (void**)&pFileSource);
+	pi.pFilter->Release();
+	if (FAILED(hr))
+		return S_FALSE;
+	hr = pFileSource->GetCurFile(ppszFileName, NULL);
+	pFileSource->Release();
+	if (FAILED(hr) || (*ppszFileName == NULL))
+		return S_FALSE;
+
+	return S_OK;
+}
+
 //==========================================================================
 // CParserPullPin methods
 //==========================================================================
@@ -42,6 +68,14 @@ CParserPullPin::CParserPullPin(CParserInputPin *pParentPin) :
 
 HRESULT CParserPullPin::Receive(IMediaSample *pSample)
 {
+	// The sample times are file positions in reference units
+	CTraceSpan span(
+		"PullPin::Receive",
+		m_pParentPin->Name(),
+		"position",
+		GetTraceSampleTime(pSample) / UNITS
+	);
+
 	// Delegate Receive to the containing input pin
 	return m_pParentPin->Receive(pSample);
 }
@@ -70,295 +104,1881 @@ void CParserPullPin::OnError(HRESULT hr)
 }
 
 //==========================================================================
-// CParserInputPin methods
+// CParserMappedAllocator methods
 //==========================================================================
 
-CParserInputPin::CParserInputPin(
-	TCHAR *pObjectName,
-	CBaseParserFilter *pFilter,
-	CCritSec *pFilterLock,
-	CCritSec *pReceiveLock,
-	HRESULT *phr,
-	LPCWSTR pName
-) :
-	CBaseInputPin(pObjectName, pFilter, pFilterLock, phr, pName),
-	m_pReceiveLock(pReceiveLock),
-	m_PullPin(this)
+CParserMappedAllocator::CParserMappedAllocator(HRESULT *phr) :
+	CBaseAllocator(NAME("Parser Mapped Allocator"), NULL, phr),
+	m_hMapping(NULL),
+	m_pbView(NULL),
+	m_llFileSize(0)
 {
-	ASSERT(pFilter);
-	ASSERT(pFilterLock);
-	ASSERT(pReceiveLock);
-	ASSERT(phr);
 }
 
-HRESULT CParserInputPin::CheckConnect(IPin *pPin)
+CParserMappedAllocator::~CParserMappedAllocator()
 {
-	// Check and validate the pointer
-	CheckPointer(pPin, E_POINTER);
-	ValidateReadPtr(pPin, sizeof(IPin));
+	Decommit();
+	ReallyFree();
+	Close();
 
-	// Perform base-class checking
-	HRESULT hr = CBaseInputPin::CheckConnect(pPin);
-	if (FAILED(hr))
-		return hr;
+	// The view is unmapped by the decommit, but just in case...
+	if (m_pbView) {
+		UnmapViewOfFile(m_pbView);
+		m_pbView = NULL;
+	}
+}
 
-	// Try to connect pullpin to the upstream pin
-	IUnknown *pUnk = NULL;
-	hr = pPin->QueryInterface(IID_IUnknown, (void**)&pUnk);
-	if (FAILED(hr))
-		return hr;
-	CBaseParserFilter *pFilter = (CBaseParserFilter*)m_pFilter;
-	hr = m_PullPin.Connect(pUnk, m_pAllocator, pFilter->IsSyncInput());
-	pUnk->Release();
+HRESULT CParserMappedAllocator::Open(LPCWSTR pszFileName, LONGLONG llFileSize)
+{
+	// Check the pointer
+	CheckPointer(pszFileName, E_POINTER);
+
+	// Protect the allocator state
+	CAutoLock lock(this);
+
+	// Close the previous mapping (if any)
+	Close();
+
+	// Open the file. The upstream filter has opened it for
+	// reading, so we should share the read access only
+	HANDLE hFile = CreateFileW(
+		pszFileName,
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		NULL,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL,
+		NULL
+	);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return HRESULT_FROM_WIN32(GetLastError());
+
+	// Make sure it's the file the upstream filter reads
+	LARGE_INTEGER liFileSize;
+	if (
+		!GetFileSizeEx(hFile, &liFileSize)	||
+		(liFileSize.QuadPart != llFileSize)	||
+		(llFileSize == 0)
+	) {
+		CloseHandle(hFile);
+		return E_FAIL;
+	}
+
+	// Create the mapping object (it keeps the file open itself)
+	m_hMapping = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	HRESULT hr = (m_hMapping) ? NOERROR : HRESULT_FROM_WIN32(GetLastError());
+	CloseHandle(hFile);
 	if (FAILED(hr))
 		return hr;
-	
-	// Provide the filter with IAsyncReader to perform its
-	// checks and output pins creation
-	IAsyncReader *pReader = m_PullPin.GetReader();
-	ASSERT(pReader);
-	hr = pFilter->Initialize(pPin, pReader);
-	pReader->Release();
-	if (FAILED(hr)) {
-		m_PullPin.Disconnect();
-		return hr;
+
+	m_llFileSize = llFileSize;
+
+	return NOERROR;
+}
+
+void CParserMappedAllocator::Close(void)
+{
+	// Protect the allocator state
+	CAutoLock lock(this);
+
+	if (m_hMapping) {
+		CloseHandle(m_hMapping);
+		m_hMapping = NULL;
 	}
+}
 
-	// Get the input allocator properties from the parent filter
-	ALLOCATOR_PROPERTIES apRequest;
-	hr = pFilter->GetInputAllocatorProperties(&apRequest);
+HRESULT CParserMappedAllocator::GetSlice(
+	LONGLONG llPosition,
+	LONG lDataSize,
+	IMediaSample **ppSample
+)
+{
+	// Check the pointer
+	CheckPointer(ppSample, E_POINTER);
+
+	// Check the data range
+	if (
+		(llPosition < 0)	||
+		(lDataSize <= 0)	||
+		(llPosition + lDataSize > m_llFileSize)
+	)
+		return E_INVALIDARG;
+
+	// Get a free sample (wait for it if there's none)
+	IMediaSample *pSample = NULL;
+	HRESULT hr = GetBuffer(&pSample, NULL, NULL, 0);
 	if (FAILED(hr)) {
-		pFilter->Shutdown();
-		m_PullPin.Disconnect();
+		*ppSample = NULL;
 		return hr;
 	}
 
-	// Request an allocator with the desired properties
-	hr = m_PullPin.DecideAllocator(NULL, &apRequest);
+	// Point the sample to the data. The view cannot be unmapped 
+	// while the sample is out, so there's no need to lock
+	ASSERT(m_pbView);
+	hr = ((CMediaSample*)pSample)->SetPointer(m_pbView + llPosition, lDataSize);
 	if (FAILED(hr)) {
-		pFilter->Shutdown();
-		m_PullPin.Disconnect();
+		pSample->Release();
+		*ppSample = NULL;
 		return hr;
 	}
 
-	// Make sure we obtained the allocator we wanted
-	if (!m_PullPin.m_pAlloc) {
-		pFilter->Shutdown();
-		m_PullPin.Disconnect();
-		return E_FAIL;
-	}
-	ALLOCATOR_PROPERTIES apActual;
-	hr = m_PullPin.m_pAlloc->GetProperties(&apActual);
-	if (FAILED(hr)) {
-		pFilter->Shutdown();
-		m_PullPin.Disconnect();
+	*ppSample = pSample;
+
+	return NOERROR;
+}
+
+HRESULT CParserMappedAllocator::Alloc(void)
+{
+	// Protect the allocator state
+	CAutoLock lock(this);
+
+	// Check if the properties have been set
+	HRESULT hr = CBaseAllocator::Alloc();
+	if (FAILED(hr))
 		return hr;
-	}
-	if (
-		(apActual.cBuffers	< apRequest.cBuffers)	||
-		(apActual.cbBuffer	< apRequest.cbBuffer)	||
-		(apActual.cbAlign	% apRequest.cbAlign)	||
-		(apActual.cbPrefix	!= apRequest.cbPrefix)
-	) {
-		pFilter->Shutdown();
-		m_PullPin.Disconnect();
-		return E_FAIL;
+
+	// Map the view of the whole file
+	if (m_pbView == NULL) {
+		if (m_hMapping == NULL)
+			return E_UNEXPECTED;
+		m_pbView = (BYTE*)MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0);
+		if (m_pbView == NULL)
+			return HRESULT_FROM_WIN32(GetLastError());
 	}
 
-	// Set the default start/stop positions (we must do it AFTER 
-	// deciding on the pullpin's allocator)
-	hr = pFilter->SetDefaultPositions();
-	if (FAILED(hr)) {
-		pFilter->Shutdown();
-		m_PullPin.Disconnect();
-		return hr;
+	// If the properties haven't changed, the samples are already there
+	if (hr == S_FALSE)
+		return NOERROR;
+
+	// Delete the old samples
+	ReallyFree();
+
+	// Create the new samples (with no buffers until they're handed out)
+	for (; m_lAllocated < m_lCount; m_lAllocated++) {
+		hr = NOERROR;
+		CMediaSample *pSample = new CMediaSample(
+			NAME("Parser Mapped Sample"),
+			this,
+			&hr,
+			NULL,
+			0
+		);
+		if (pSample == NULL)
+			return E_OUTOFMEMORY;
+		if (FAILED(hr)) {
+			delete pSample;
+			return hr;
+		}
+		m_lFree.Add(pSample);
 	}
 
+	m_bChanged = FALSE;
+
 	return NOERROR;
 }
 
-HRESULT CParserInputPin::BreakConnect(void)
+void CParserMappedAllocator::Free(void)
 {
-	// Delete the output pins
-	HRESULT hr = ((CBaseParserFilter*)m_pFilter)->Shutdown();
-	if (FAILED(hr))
-		return hr;
+	// All samples are back, so the view can be unmapped (the 
+	// samples are kept until the allocator is deleted)
+	if (m_pbView) {
+		UnmapViewOfFile(m_pbView);
+		m_pbView = NULL;
+	}
+}
 
-	// Disconnect the pullpin
-	hr = m_PullPin.Disconnect();
-	if (FAILED(hr))
-		return hr;
+void CParserMappedAllocator::ReallyFree(void)
+{
+	// All samples should be on the free list
+	ASSERT(m_lAllocated == m_lFree.GetCount());
 
-	// Let the base class break its connection
-	return CBaseInputPin::BreakConnect();
+	// Delete the samples
+	CMediaSample *pSample;
+	while ((pSample = m_lFree.RemoveHead()) != NULL)
+		delete pSample;
+
+	m_lAllocated = 0;
 }
 
-HRESULT CParserInputPin::Active(void)
+//==========================================================================
+// CParserReaderThread methods
+//==========================================================================
+
+CParserReaderThread::CParserReaderThread(CParserInputPin *pParentPin) :
+	m_pParentPin(pParentPin),
+	m_State(TM_Exit),
+	m_tStart(0),
+	m_tStop(MAX_TIME)
 {
-	// Perform the base-class activation
-	HRESULT hr = CBaseInputPin::Active();
-	if (FAILED(hr))
-		return hr;
+	ASSERT(pParentPin);
+}
 
-	// Initialize parser
-	CBaseParserFilter *pFilter = (CBaseParserFilter*)m_pFilter;
-	hr = pFilter->InitializeParser();
-	if (FAILED(hr))
-		return hr;
+CParserReaderThread::~CParserReaderThread()
+{
+	// The derived class should have stopped the thread 
+	// (as it's the one to unblock it)
+	ASSERT(!ThreadExists());
+}
 
-	// Activate the pullpin
-	hr = m_PullPin.Active();
-	if (FAILED(hr)) {
-		pFilter->ShutdownParser();
-		return hr;
+HRESULT CParserReaderThread::Seek(REFERENCE_TIME tStart, REFERENCE_TIME tStop)
+{
+	CAutoLock lock(&m_csAccess);
+
+	ThreadMsg AtStart = m_State;
+
+	// Stop delivering while changing the positions
+	if (AtStart == TM_Start) {
+		m_pParentPin->BeginFlush();
+		PauseThread();
+		m_pParentPin->EndFlush();
 	}
 
+	m_tStart	= tStart;
+	m_tStop		= tStop;
+
+	HRESULT hr = NOERROR;
+	if (AtStart == TM_Start)
+		hr = StartThread();
+
+	return hr;
+}
+
+HRESULT CParserReaderThread::Active(void)
+{
+	ASSERT(!ThreadExists());
+	return StartThread();
+}
+
+HRESULT CParserReaderThread::Inactive(void)
+{
+	StopThread();
+
 	return NOERROR;
 }
 
-HRESULT CParserInputPin::Inactive(void)
+DWORD CParserReaderThread::ThreadProc(void)
 {
-	// Deactivate the pullpin
-	HRESULT hr = m_PullPin.Inactive();
-	if (FAILED(hr))
-		return hr;
+	for (;;) {
+		DWORD dwRequest = GetRequest();
+		switch (dwRequest) {
 
-	// Shutdown parser
-	CBaseParserFilter *pFilter = (CBaseParserFilter*)m_pFilter;
-	hr = pFilter->ShutdownParser();
-	if (FAILED(hr))
-		return hr;
+			case TM_Exit:
+				Reply(NOERROR);
+				return 0;
 
-	// Set the default start/stop positions, so that next time
-	// we'll run the playback it'll start from the file beginning
-	hr = pFilter->SetDefaultPositions();
+			case TM_Pause:
+				// We're paused already
+				Reply(NOERROR);
+				break;
+
+			case TM_Start:
+				Reply(NOERROR);
+				Process();
+				break;
+		}
+
+		// We're idle now, so let the derived class clean up
+		Cleanup();
+	}
+}
+
+HRESULT CParserReaderThread::StartThread(void)
+{
+	CAutoLock lock(&m_csAccess);
+
+	IMemAllocator *pAlloc = GetAllocator();
+	if (!IsConnected() || !pAlloc)
+		return E_UNEXPECTED;
+
+	// Commit the allocator (it may have been decommitted to unblock
+	// the thread, so do it even if the thread is already there)
+	HRESULT hr = pAlloc->Commit();
 	if (FAILED(hr))
 		return hr;
 
-	// Instead of the base-class deactivation just set the flags.
-	// We should not call the base-class implementation as it 
-	// tries to decommit allocator while we have none
-	m_bRunTimeError = FALSE;
-	m_bFlushing = FALSE;
-	
-	return NOERROR;
+	// Start the thread
+	if (!ThreadExists()) {
+		if (!Create())
+			return E_FAIL;
+	}
+
+	m_State = TM_Start;
+
+	return (HRESULT)CallWorker(m_State);
+}
+
+HRESULT CParserReaderThread::PauseThread(void)
+{
+	CAutoLock lock(&m_csAccess);
+
+	if (!ThreadExists())
+		return E_UNEXPECTED;
+
+	BeginUnblock();
+
+	m_State = TM_Pause;
+	HRESULT hr = (HRESULT)CallWorker(TM_Pause);
+
+	EndUnblock();
+
+	return hr;
+}
+
+HRESULT CParserReaderThread::StopThread(void)
+{
+	CAutoLock lock(&m_csAccess);
+
+	if (!ThreadExists())
+		return S_FALSE;
+
+	BeginUnblock();
+
+	m_State = TM_Exit;
+	HRESULT hr = (HRESULT)CallWorker(TM_Exit);
+
+	EndUnblock();
+
+	// Wait for the thread to completely exit
+	Close();
+
+	// Decommit the allocator
+	IMemAllocator *pAlloc = GetAllocator();
+	if (pAlloc)
+		pAlloc->Decommit();
+
+	return hr;
+}
+
+//==========================================================================
+// CParserMappedReader methods
+//==========================================================================
+
+CParserMappedReader::CParserMappedReader(CParserInputPin *pParentPin) :
+	CParserReaderThread(pParentPin),
+	m_pAlloc(NULL),
+	m_llFileSize(0),
+	m_cbSlice(0)
+{
+}
+
+CParserMappedReader::~CParserMappedReader()
+{
+	Disconnect();
+}
+
+HRESULT CParserMappedReader::Connect(
+	IPin *pPin,
+	IAsyncReader *pReader,
+	ALLOCATOR_PROPERTIES *pProps
+)
+{
+	// Check the pointers
+	CheckPointer(pPin, E_POINTER);
+	CheckPointer(pReader, E_POINTER);
+	CheckPointer(pProps, E_POINTER);
+
+	CAutoLock lock(&m_csAccess);
+
+	Disconnect();
+
+	// The whole file should be available and not too large to map
+	LONGLONG llTotal = 0, llAvailable = 0;
+	HRESULT hr = pReader->Length(&llTotal, &llAvailable);
+	if (
+		(hr != S_OK)					||
+		(llAvailable < llTotal)			||
+		(llTotal <= 0)					||
+		(llTotal > PARSER_MAX_MAPPED_SIZE)
+	)
+		return S_FALSE;
+
+	// Find out the file the upstream filter reads
+	LPOLESTR pszFileName = NULL;
+	hr = GetSourceFileName(pPin, &pszFileName);
+	if (hr != S_OK)
+		return S_FALSE;
+
+	// Create the allocator
+	hr = NOERROR;
+	m_pAlloc = new CParserMappedAllocator(&hr);
+	if (m_pAlloc == NULL) {
+		CoTaskMemFree(pszFileName);
+		return E_OUTOFMEMORY;
+	}
+	m_pAlloc->AddRef();
+	if (FAILED(hr)) {
+		CoTaskMemFree(pszFileName);
+		Disconnect();
+		return hr;
+	}
+
+	// Map the file (if we cannot, it's not an error -- the 
+	// pullpin will be used then)
+	hr = m_pAlloc->Open(pszFileName, llTotal);
+	CoTaskMemFree(pszFileName);
+	if (FAILED(hr)) {
+		Disconnect();
+		return S_FALSE;
+	}
+
+	// Set the number of slices and their size. The slices 
+	// need no alignment as they're not read from the file
+	ALLOCATOR_PROPERTIES apRequest, apActual;
+	apRequest.cBuffers	= pProps->cBuffers;
+	apRequest.cbBuffer	= pProps->cbBuffer;
+	apRequest.cbAlign	= 1;
+	apRequest.cbPrefix	= 0;
+	hr = m_pAlloc->SetProperties(&apRequest, &apActual);
+	if (FAILED(hr)) {
+		Disconnect();
+		return hr;
+	}
+
+	m_llFileSize	= llTotal;
+	m_cbSlice		= apActual.cbBuffer;
+	m_tStart		= 0;
+	m_tStop			= llTotal * UNITS;
+
+	return NOERROR;
+}
+
+HRESULT CParserMappedReader::Disconnect(void)
+{
+	CAutoLock lock(&m_csAccess);
+
+	StopThread();
+
+	// The samples still held downstream keep 
+	// the allocator (and the view) alive
+	if (m_pAlloc) {
+		m_pAlloc->Close();
+		m_pAlloc->Release();
+		m_pAlloc = NULL;
+	}
+
+	return NOERROR;
+}
+
+void CParserMappedReader::BeginUnblock(void)
+{
+	// The view is unmapped when the last sample is back
+	// (unless the allocator is committed again before that)
+	m_pAlloc->Decommit();
+}
+
+void CParserMappedReader::Process(void)
+{
+	// Work out the file range to deliver
+	LONGLONG llStart	= m_tStart / UNITS;
+	LONGLONG llStop		= (m_tStop < m_llFileSize * UNITS) ? m_tStop / UNITS : m_llFileSize;
+
+	BOOL bDiscontinuity = TRUE;
+	for (LONGLONG llCurrent = llStart; llCurrent < llStop; ) {
+
+		// Break out without calling EndOfStream() if 
+		// we're asked to do something different
+		DWORD dwRequest;
+		if (CheckRequest(&dwRequest))
+			return;
+
+		// Get the next slice of the file
+		LONG lSliceSize = (LONG)min(m_cbSlice, llStop - llCurrent);
+		IMediaSample *pSample = NULL;
+		HRESULT hr = m_pAlloc->GetSlice(llCurrent, lSliceSize, &pSample);
+		if (FAILED(hr))
+			return;
+
+		// The sample times are relative to the start position 
+		// (just as the pullpin sets them)
+		REFERENCE_TIME rtStart	= (llCurrent - llStart) * UNITS;
+		REFERENCE_TIME rtStop	= rtStart + lSliceSize * UNITS;
+		pSample->SetTime(&rtStart, &rtStop);
+		pSample->SetDiscontinuity(bDiscontinuity);
+		bDiscontinuity = FALSE;
+
+		// Scope for the span
+		{
+			CTraceSpan span("MappedReader::Receive", m_pParentPin->Name(), "position", llCurrent);
+
+			// Deliver the slice to the parent pin
+			hr = m_pParentPin->Receive(pSample);
+		}
+		pSample->Release();
+
+		// Stop if error, or if the parser said to stop
+		if (hr != S_OK)
+			return;
+
+		llCurrent += lSliceSize;
+	}
+
+	m_pParentPin->EndOfStream();
+}
+
+//==========================================================================
+// CParserPrefetchReader methods
+//==========================================================================
+
+CParserPrefetchReader::CParserPrefetchReader(
+	CParserInputPin *pParentPin,
+	CBaseParserFilter *pFilter
+) :
+	CParserReaderThread(pParentPin),
+	m_pFilter(pFilter),
+	m_pReader(NULL),
+	m_pAlloc(NULL),
+	m_llLength(0),
+	m_cbAlign(1),
+	m_cbMaxRequest(0),
+	m_cbStallRequest(0),
+	m_nQuietRequests(0),
+	m_dwNextRequest(0),
+	m_dwNextCollect(0)
+{
+	ASSERT(pFilter);
+
+	// No requests in flight at this time
+	ZeroMemory(m_pCompleted, sizeof(m_pCompleted));
+}
+
+CParserPrefetchReader::~CParserPrefetchReader()
+{
+	Disconnect();
+}
+
+HRESULT CParserPrefetchReader::Connect(IAsyncReader *pReader, IMemAllocator *pAlloc)
+{
+	// Check the pointers
+	CheckPointer(pReader, E_POINTER);
+	CheckPointer(pAlloc, E_POINTER);
+
+	CAutoLock lock(&m_csAccess);
+
+	Disconnect();
+
+	// Get the buffer size and alignment (the requests 
+	// should be aligned just as the pullpin's ones)
+	ALLOCATOR_PROPERTIES apActual;
+	HRESULT hr = pAlloc->GetProperties(&apActual);
+	if (FAILED(hr))
+		return hr;
+
+	// Get the file length
+	LONGLONG llTotal = 0, llAvailable = 0;
+	hr = pReader->Length(&llTotal, &llAvailable);
+	if (FAILED(hr))
+		return hr;
+
+	m_pReader = pReader;
+	m_pReader->AddRef();
+	m_pAlloc = pAlloc;
+	m_pAlloc->AddRef();
+
+	m_llLength			= llTotal;
+	m_cbAlign			= max(apActual.cbAlign, 1);
+	m_cbMaxRequest		= apActual.cbBuffer;
+	m_cbStallRequest	= 0;
+	m_nQuietRequests	= 0;
+	m_tStart			= 0;
+	m_tStop				= llTotal * UNITS;
+
+	return NOERROR;
+}
+
+HRESULT CParserPrefetchReader::Disconnect(void)
+{
+	CAutoLock lock(&m_csAccess);
+
+	StopThread();
+
+	if (m_pReader) {
+		m_pReader->Release();
+		m_pReader = NULL;
+	}
+	if (m_pAlloc) {
+		m_pAlloc->Release();
+		m_pAlloc = NULL;
+	}
+
+	return NOERROR;
+}
+
+void CParserPrefetchReader::BeginUnblock(void)
+{
+	m_pReader->BeginFlush();
+}
+
+void CParserPrefetchReader::EndUnblock(void)
+{
+	m_pReader->EndFlush();
+}
+
+void CParserPrefetchReader::Cleanup(void)
+{
+	// Flush the reader to get the requests in flight back. We may be
+	// inside the flush already, but the premature EndFlush() does no 
+	// harm now that we're idle (see CPullPin)
+	m_pReader->BeginFlush();
+	for (;;) {
+		IMediaSample *pSample = NULL;
+		DWORD_PTR dwUnused;
+		m_pReader->WaitForNext(0, &pSample, &dwUnused);
+		if (pSample == NULL)
+			break;
+		pSample->Release();
+	}
+	m_pReader->EndFlush();
+
+	// Release the completed requests which have not been collected
+	for (int i = 0; i < PARSER_MAX_REQUESTS; i++) {
+		if (m_pCompleted[i]) {
+			m_pCompleted[i]->Release();
+			m_pCompleted[i] = NULL;
+		}
+	}
+	m_dwNextRequest = 0;
+	m_dwNextCollect = 0;
+}
+
+LONG CParserPrefetchReader::GetRequestSize(void)
+{
+	// Put several average chunks into a request, so that most of
+	// the chunks lie within one input buffer, but don't go below 
+	// the size grown by the stalls
+	LONG cbRequest = max(
+		m_pFilter->GetAverageChunkSize() * PARSER_CHUNKS_PER_REQUEST,
+		m_cbStallRequest
+	);
+
+	// Nothing is known yet -- read as the pullpin does
+	if (cbRequest <= 0)
+		cbRequest = m_cbMaxRequest;
+
+	// Fit the size into the buffer and align it
+	cbRequest = max(cbRequest, PARSER_MIN_REQUEST_SIZE);
+	cbRequest = min(cbRequest, m_cbMaxRequest);
+	cbRequest -= cbRequest % m_cbAlign;
+
+	return max(cbRequest, m_cbAlign);
+}
+
+HRESULT CParserPrefetchReader::QueueRequest(
+	IMediaSample *pSample,
+	LONGLONG *pllCurrent,
+	LONGLONG llAlignStop,
+	BOOL bDiscontinuity
+)
+{
+	// The sample times are the file positions to read
+	LONGLONG llRequestStop = min(*pllCurrent + GetRequestSize(), llAlignStop);
+	REFERENCE_TIME rtStart	= *pllCurrent * UNITS;
+	REFERENCE_TIME rtStop	= llRequestStop * UNITS;
+	HRESULT hr = pSample->SetTime(&rtStart, &rtStop);
+	if (SUCCEEDED(hr))
+		hr = pSample->SetDiscontinuity(bDiscontinuity);
+	if (FAILED(hr)) {
+		pSample->Release();
+		return hr;
+	}
+
+	// Queue the request (the request number comes back with it)
+	hr = m_pReader->Request(pSample, (DWORD_PTR)m_dwNextRequest);
+	if (FAILED(hr)) {
+		pSample->Release();
+		return hr;
+	}
+
+	m_dwNextRequest++;
+	*pllCurrent = llRequestStop;
+
+	return NOERROR;
+}
+
+HRESULT CParserPrefetchReader::CollectRequest(IMediaSample **ppSample)
+{
+	ASSERT(m_dwNextCollect != m_dwNextRequest);
+
+	// Wait until the oldest request is completed
+	LONGLONG llStartTime = GetStatisticsTime();
+	int iCollect = m_dwNextCollect % PARSER_MAX_REQUESTS;
+	while (m_pCompleted[iCollect] == NULL) {
+		IMediaSample *pSample = NULL;
+		DWORD_PTR dwRequest = 0;
+		HRESULT hr = m_pReader->WaitForNext(INFINITE, &pSample, &dwRequest);
+		if (FAILED(hr)) {
+			if (pSample)
+				pSample->Release();
+			return hr;
+		}
+		m_pCompleted[dwRequest % PARSER_MAX_REQUESTS] = pSample;
+	}
+	LONGLONG llStallTime = GetStatisticsTime() - llStartTime;
+
+	*ppSample = m_pCompleted[iCollect];
+	m_pCompleted[iCollect] = NULL;
+	m_dwNextCollect++;
+
+	// Having to wait means the parser outruns the reader, so grow
+	// the requests to cut down their number. If there's no waiting 
+	// for a while, shrink them back
+	if (llStallTime > GMF_STATISTICS_WAIT_THRESHOLD) {
+		m_cbStallRequest = min(2 * GetRequestSize(), m_cbMaxRequest);
+		m_nQuietRequests = 0;
+	} else if (++m_nQuietRequests == PARSER_QUIET_REQUESTS) {
+		m_cbStallRequest /= 2;
+		m_nQuietRequests = 0;
+	}
+
+	m_pFilter->UpdateStallStatistics(llStallTime);
+
+	return NOERROR;
+}
+
+void CParserPrefetchReader::Process(void)
+{
+	// Is there anything to do?
+	if (m_tStop <= m_tStart) {
+		m_pParentPin->EndOfStream();
+		return;
+	}
+
+	// Align the start position downwards and the stop position 
+	// upwards (it may be past the stop, but that doesn't matter)
+	LONGLONG llStart		= (m_tStart / UNITS) - (m_tStart / UNITS) % m_cbAlign;
+	LONGLONG llStop			= min(m_tStop / UNITS, m_llLength);
+	LONGLONG llAlignStop	= llStop + (m_cbAlign - llStop % m_cbAlign) % m_cbAlign;
+
+	LONGLONG llCurrent = llStart;
+	BOOL bDiscontinuity = TRUE;
+	for (;;) {
+
+		// Break out without calling EndOfStream() if 
+		// we're asked to do something different
+		DWORD dwRequest;
+		if (CheckRequest(&dwRequest))
+			return;
+
+		// Keep as many requests in flight as there are free buffers.
+		// Wait for a free buffer only if there's nothing in flight
+		while (
+			(llCurrent < llAlignStop) &&
+			((LONG)(m_dwNextRequest - m_dwNextCollect) < PARSER_MAX_REQUESTS)
+		) {
+			BOOL bWait = (m_dwNextRequest == m_dwNextCollect);
+			IMediaSample *pSample = NULL;
+			HRESULT hr = m_pAlloc->GetBuffer(&pSample, NULL, NULL, (bWait) ? 0 : AM_GBF_NOWAIT);
+			if (FAILED(hr)) {
+				if (bWait)
+					return;
+				break;
+			}
+			hr = QueueRequest(pSample, &llCurrent, llAlignStop, bDiscontinuity);
+			if (FAILED(hr))
+				return;
+			bDiscontinuity = FALSE;
+		}
+
+		// Everything has been delivered
+		if (m_dwNextRequest == m_dwNextCollect)
+			break;
+
+		// Collect the oldest request
+		IMediaSample *pSample = NULL;
+		HRESULT hr = CollectRequest(&pSample);
+		if (FAILED(hr))
+			return;
+
+		// Fix up the sample if it's past the actual stop (for the 
+		// alignment) and make its times relative to the aligned 
+		// start time (just as the pullpin does)
+		REFERENCE_TIME rtStart, rtStop;
+		hr = pSample->GetTime(&rtStart, &rtStop);
+		if (SUCCEEDED(hr)) {
+			rtStop = min(rtStop, llStop * UNITS);
+			rtStart	-= llStart * UNITS;
+			rtStop	-= llStart * UNITS;
+			hr = pSample->SetTime(&rtStart, &rtStop);
+		}
+		if (FAILED(hr)) {
+			pSample->Release();
+			return;
+		}
+
+		// Scope for the span
+		{
+			CTraceSpan span("PrefetchReader::Receive", m_pParentPin->Name(), "position", rtStart / UNITS + llStart);
+
+			// Deliver the sample to the parent pin
+			hr = m_pParentPin->Receive(pSample);
+		}
+		pSample->Release();
+
+		// Stop if error, or if the parser said to stop
+		if (hr != S_OK)
+			return;
+	}
+
+	m_pParentPin->EndOfStream();
+}
+
+//==========================================================================
+// CParserInputPin methods
+//==========================================================================
+
+CParserInputPin::CParserInputPin(
+	TCHAR *pObjectName,
+	CBaseParserFilter *pFilter,
+	CCritSec *pFilterLock,
+	CCritSec *pReceiveLock,
+	HRESULT *phr,
+	LPCWSTR pName
+) :
+	CBaseInputPin(pObjectName, pFilter, pFilterLock, phr, pName),
+	m_pReceiveLock(pReceiveLock),
+	m_PullPin(this),
+	m_MappedReader(this),
+	m_PrefetchReader(this, pFilter)
+{
+	ASSERT(pFilter);
+	ASSERT(pFilterLock);
+	ASSERT(pReceiveLock);
+	ASSERT(phr);
+}
+
+HRESULT CParserInputPin::CheckConnect(IPin *pPin)
+{
+	// Check and validate the pointer
+	CheckPointer(pPin, E_POINTER);
+	ValidateReadPtr(pPin, sizeof(IPin));
+
+	// Perform base-class checking
+	HRESULT hr = CBaseInputPin::CheckConnect(pPin);
+	if (FAILED(hr))
+		return hr;
+
+	// Try to connect pullpin to the upstream pin
+	IUnknown *pUnk = NULL;
+	hr = pPin->QueryInterface(IID_IUnknown, (void**)&pUnk);
+	if (FAILED(hr))
+		return hr;
+	CBaseParserFilter *pFilter = (CBaseParserFilter*)m_pFilter;
+	hr = m_PullPin.Connect(pUnk, m_pAllocator, pFilter->IsSyncInput());
+	pUnk->Release();
+	if (FAILED(hr))
+		return hr;
+	
+	// Open the chunk index of the file (if there's no index, the 
+	// filter works without it, so we ignore the failure). That's 
+	// done first, so that the filter may use the index when it 
+	// initializes
+	pFilter->OpenChunkIndex(pPin);
+
+	// Provide the filter with IAsyncReader to perform its
+	// checks and output pins creation
+	IAsyncReader *pReader = m_PullPin.GetReader();
+	ASSERT(pReader);
+	hr = pFilter->Initialize(pPin, pReader);
+	pReader->Release();
+	if (FAILED(hr)) {
+		pFilter->CloseChunkIndex();
+		m_PullPin.Disconnect();
+		return hr;
+	}
+
+	// Get the input allocator properties from the parent filter
+	ALLOCATOR_PROPERTIES apRequest;
+	hr = pFilter->GetInputAllocatorProperties(&apRequest);
+	if (FAILED(hr)) {
+		pFilter->Shutdown();
+		m_PullPin.Disconnect();
+		return hr;
+	}
+
+	// Request an allocator with the desired properties
+	hr = m_PullPin.DecideAllocator(NULL, &apRequest);
+	if (FAILED(hr)) {
+		pFilter->Shutdown();
+		m_PullPin.Disconnect();
+		return hr;
+	}
+
+	// Make sure we obtained the allocator we wanted
+	if (!m_PullPin.m_pAlloc) {
+		pFilter->Shutdown();
+		m_PullPin.Disconnect();
+		return E_FAIL;
+	}
+	ALLOCATOR_PROPERTIES apActual;
+	hr = m_PullPin.m_pAlloc->GetProperties(&apActual);
+	if (FAILED(hr)) {
+		pFilter->Shutdown();
+		m_PullPin.Disconnect();
+		return hr;
+	}
+	if (
+		(apActual.cBuffers	< apRequest.cBuffers)	||
+		(apActual.cbBuffer	< apRequest.cbBuffer)	||
+		(apActual.cbAlign	% apRequest.cbAlign)	||
+		(apActual.cbPrefix	!= apRequest.cbPrefix)
+	) {
+		pFilter->Shutdown();
+		m_PullPin.Disconnect();
+		return E_FAIL;
+	}
+
+	// Try to map the input file if the memory-mapped input is 
+	// enabled. If the file cannot be mapped, the pullpin is used
+	if (pFilter->IsMappedInput()) {
+		pReader = m_PullPin.GetReader();
+		hr = m_MappedReader.Connect(pPin, pReader, &apActual);
+		pReader->Release();
+		if (FAILED(hr)) {
+			pFilter->Shutdown();
+			m_PullPin.Disconnect();
+			return hr;
+		}
+	}
+
+	// Otherwise use the adaptive read-ahead instead of the 
+	// pullpin's thread (unless the synchronous mode is chosen)
+	if (
+		!m_MappedReader.IsConnected()	&&
+		!pFilter->IsSyncInput()			&&
+		pFilter->IsAdaptiveReadAhead()
+	) {
+		pReader = m_PullPin.GetReader();
+		hr = m_PrefetchReader.Connect(pReader, m_PullPin.m_pAlloc);
+		pReader->Release();
+		if (FAILED(hr)) {
+			pFilter->Shutdown();
+			m_PullPin.Disconnect();
+			return hr;
+		}
+	}
+
+	// Set the default start/stop positions (we must do it AFTER 
+	// deciding on the pullpin's allocator)
+	hr = pFilter->SetDefaultPositions();
+	if (FAILED(hr)) {
+		pFilter->Shutdown();
+		m_MappedReader.Disconnect();
+		m_PrefetchReader.Disconnect();
+		m_PullPin.Disconnect();
+		return hr;
+	}
+
+	return NOERROR;
+}
+
+HRESULT CParserInputPin::BreakConnect(void)
+{
+	// Delete the output pins
+	HRESULT hr = ((CBaseParserFilter*)m_pFilter)->Shutdown();
+	if (FAILED(hr))
+		return hr;
+
+	// Unmap the input file (if it's been mapped)
+	hr = m_MappedReader.Disconnect();
+	if (FAILED(hr))
+		return hr;
+
+	// Release the read-ahead's reader and allocator
+	hr = m_PrefetchReader.Disconnect();
+	if (FAILED(hr))
+		return hr;
+
+	// Disconnect the pullpin
+	hr = m_PullPin.Disconnect();
+	if (FAILED(hr))
+		return hr;
+
+	// Let the base class break its connection
+	return CBaseInputPin::BreakConnect();
+}
+
+HRESULT CParserInputPin::Active(void)
+{
+	// Perform the base-class activation
+	HRESULT hr = CBaseInputPin::Active();
+	if (FAILED(hr))
+		return hr;
+
+	// Map the view of the input file. If it cannot be mapped now 
+	// (e.g. there's no room left in the address space), the pullpin 
+	// and its allocator are used instead
+	if (m_MappedReader.IsConnected()) {
+		hr = m_MappedReader.GetAllocator()->Commit();
+		if (FAILED(hr))
+			m_MappedReader.Disconnect();
+	}
+
+	// Initialize parser
+	CBaseParserFilter *pFilter = (CBaseParserFilter*)m_pFilter;
+	hr = pFilter->InitializeParser();
+	if (FAILED(hr)) {
+		DecommitMappedAllocator();
+		return hr;
+	}
+
+	// Activate the reference allocator (before the pullpin 
+	// starts delivering the samples)
+	hr = pFilter->ActivateReferenceAllocator(GetInputAllocator());
+	if (FAILED(hr)) {
+		pFilter->ShutdownParser();
+		DecommitMappedAllocator();
+		return hr;
+	}
+
+	// Record the chunk index along the playback (if needed)
+	pFilter->StartIndexRecording();
+
+	// Activate the pullpin (or the reader thread used instead of it)
+	CParserReaderThread *pReaderThread = GetReaderThread();
+	if (pReaderThread)
+		hr = pReaderThread->Active();
+	else
+		hr = m_PullPin.Active();
+	if (FAILED(hr)) {
+		pFilter->StopIndexRecording();
+		pFilter->DeactivateReferenceAllocator();
+		pFilter->ShutdownParser();
+		DecommitMappedAllocator();
+		return hr;
+	}
+
+	return NOERROR;
+}
+
+void CParserInputPin::DecommitMappedAllocator(void)
+{
+	// Unmap the view committed by Active() (if any)
+	if (m_MappedReader.IsConnected())
+		m_MappedReader.GetAllocator()->Decommit();
+}
+
+HRESULT CParserInputPin::Inactive(void)
+{
+	// Deactivate the pullpin (or the reader thread used instead of it)
+	HRESULT hr;
+	CParserReaderThread *pReaderThread = GetReaderThread();
+	if (pReaderThread)
+		hr = pReaderThread->Inactive();
+	else
+		hr = m_PullPin.Inactive();
+	if (FAILED(hr))
+		return hr;
+
+	// The incomplete chunk index is of no use
+	CBaseParserFilter *pFilter = (CBaseParserFilter*)m_pFilter;
+	pFilter->StopIndexRecording();
+
+	// Shutdown parser
+	hr = pFilter->ShutdownParser();
+	if (FAILED(hr))
+		return hr;
+
+	// Deactivate the reference allocator
+	hr = pFilter->DeactivateReferenceAllocator();
+	if (FAILED(hr))
+		return hr;
+
+	// Set the default start/stop positions, so that next time
+	// we'll run the playback it'll start from the file beginning
+	hr = pFilter->SetDefaultPositions();
+	if (FAILED(hr))
+		return hr;
+
+	// Instead of the base-class deactivation just set the flags.
+	// We should not call the base-class implementation as it 
+	// tries to decommit allocator while we have none
+	m_bRunTimeError = FALSE;
+	m_bFlushing = FALSE;
+	
+	return NOERROR;
+}
+
+HRESULT CParserInputPin::CheckMediaType(const CMediaType* pmt)
+{
+	// Delegate the call to the parent filter
+	return ((CBaseParserFilter*)m_pFilter)->CheckInputType(pmt);
+}
+
+HRESULT CParserInputPin::GetMediaType(int iPosition, CMediaType *pMediaType)
+{
+	// Delegate the call to the parent filter
+	return ((CBaseParserFilter*)m_pFilter)->GetInputType(iPosition, pMediaType);
+}
+
+STDMETHODIMP CParserInputPin::Receive(IMediaSample *pSample)
+{
+	CAutoLock lock(m_pReceiveLock);
+
+	// Check whether it's all right with pSample in the base-class 
+	// implementation and return if not
+	HRESULT hr = CBaseInputPin::Receive(pSample);
+	if (hr != S_OK)
+		return hr;
+
+	// Delegate the call on to the parent filter
+	return ((CBaseParserFilter*)m_pFilter)->Receive(pSample);
+}
+
+CParserReaderThread* CParserInputPin::GetReaderThread(void)
+{
+	if (m_MappedReader.IsConnected())
+		return &m_MappedReader;
+	else if (m_PrefetchReader.IsConnected())
+		return &m_PrefetchReader;
+	else
+		return NULL;
+}
+
+IMemAllocator* CParserInputPin::GetInputAllocator(void)
+{
+	CParserReaderThread *pReaderThread = GetReaderThread();
+	if (pReaderThread)
+		return pReaderThread->GetAllocator();
+	else
+		return m_PullPin.m_pAlloc;
+}
+
+HRESULT CParserInputPin::Seek(LONGLONG llStart, LONGLONG llStop)
+{
+	// Hold the filter lock so that the pullpin allocator is kept 
+	// intact inside the method
+	CAutoLock lock(m_pLock);
+
+	// Convert file positions to media time and seek the pullpin
+	REFERENCE_TIME rtStart, rtStop;
+	rtStart	= llStart * UNITS;
+	if (llStop < MAXLONGLONG)
+		rtStop = llStop * UNITS;
+	else
+		rtStop = MAXLONGLONG;
+	HRESULT hr;
+	CParserReaderThread *pReaderThread = GetReaderThread();
+	if (pReaderThread)
+		hr = pReaderThread->Seek(rtStart, rtStop);
+	else
+		hr = m_PullPin.Seek(rtStart, rtStop);
+	if (FAILED(hr))
+		return hr;
+
+	// Get the alignment of the input allocator
+	ALLOCATOR_PROPERTIES apActual;
+	IMemAllocator *pAlloc = GetInputAllocator();
+	ASSERT(pAlloc);
+	hr = pAlloc->GetProperties(&apActual);
+	if (FAILED(hr))
+		return hr;
+
+	// Set the adjustment length
+	((CBaseParserFilter*)m_pFilter)->SetAdjustment(m_PullPin.AlignDown(llStart, apActual.cbAlign));
+
+	return NOERROR;
+}
+
+STDMETHODIMP CParserInputPin::BeginFlush(void)
+{
+	CAutoLock lock(m_pLock);
+
+	// Perform the base-class BeginFlush
+	HRESULT hr = CBaseInputPin::BeginFlush();
+	if (FAILED(hr))
+		return hr;
+
+	// Delegate the call on to the parent filter
+	return ((CBaseParserFilter*)m_pFilter)->BeginFlush();
+}
+
+STDMETHODIMP CParserInputPin::EndFlush(void)
+{
+	CAutoLock lock(m_pLock);
+
+	// Delegate the call to the parent filter
+	HRESULT hr = ((CBaseParserFilter*)m_pFilter)->EndFlush();
+	if (FAILED(hr))
+		return hr;
+
+	// Perform the base-class EndFlush
+	return CBaseInputPin::EndFlush();
+}
+
+STDMETHODIMP CParserInputPin::NewSegment(
+	REFERENCE_TIME tStart, 
+	REFERENCE_TIME tStop, 
+	double dRate
+)
+{
+	CAutoLock lock(m_pReceiveLock);
+
+	// Delegate the call to the parent filter
+	HRESULT hr = ((CBaseParserFilter*)m_pFilter)->NewSegment(tStart, tStop, dRate);
+	if (FAILED(hr))
+		return hr;
+
+	// Perform the base-class NewSegment
+	return CBaseInputPin::NewSegment(tStart, tStop, dRate);
+}
+
+STDMETHODIMP CParserInputPin::EndOfStream(void)
+{
+	CAutoLock lock(m_pReceiveLock);
+
+	// Check if we can accept end of stream message
+	HRESULT hr = CheckStreaming();
+	if (hr != S_OK)
+		return hr;
+
+	// Delegate the call to the parent filter
+	hr = ((CBaseParserFilter*)m_pFilter)->EndOfStream();
+	if (FAILED(hr))
+		return hr;
+	
+	// Perform the base-class EndOfStream
+	return CBaseInputPin::EndOfStream();
+}
+
+//==========================================================================
+// CParserOutputQueue methods
+//==========================================================================
+
+CParserOutputQueue::CParserOutputQueue(
+	IPin *pInputPin,
+	HRESULT *phr,
+	BOOL bAuto,
+	BOOL bQueue,
+	LONG lBatchSize,
+	BOOL bBatchExact,
+	LPCWSTR pName
+) :
+	m_pPin(pInputPin),
+	m_pInputPin(NULL),
+	m_lBatchSize(lBatchSize),
+	m_bBatchExact(bBatchExact && (lBatchSize > 1)),
+	m_ppSamples(NULL),
+	m_nBatched(0),
+	m_pRing(NULL),
+	m_lHead(0),
+	m_lTail(0),
+	m_hDataEvent(NULL),
+	m_hSpaceEvent(NULL),
+	m_hFlushEvent(NULL),
+	m_lConsumerWaiting(0),
+	m_lProducerWaiting(0),
+	m_hThread(NULL),
+	m_bTerminate(FALSE),
+	m_bFlushing(FALSE),
+	m_hr(S_OK)
+{
+	ASSERT(m_lBatchSize > 0);
+
+	if (FAILED(*phr))
+		return;
+
+	// Check the downstream pin and cache its IMemInputPin interface
+	*phr = pInputPin->QueryInterface(IID_IMemInputPin, (void**)&m_pInputPin);
+	if (FAILED(*phr))
+		return;
+
+	// Wrap the downstream pin to trace the deliveries. Nothing is 
+	// delivered yet, so it's safe to replace the pin now
+	if (IsStreamTraceEnabled()) {
+		CTraceMemInputPin *pTracePin = new CTraceMemInputPin(m_pInputPin, pName);
+		if (pTracePin) {
+			m_pInputPin->Release();
+			m_pInputPin = pTracePin;
+		}
+	}
+
+	// See if we should ask the downstream pin
+	if (bAuto) {
+		HRESULT hr = m_pInputPin->ReceiveCanBlock();
+		if (SUCCEEDED(hr))
+			bQueue = (hr == S_OK);
+	}
+
+	// Create the sample batch
+	m_ppSamples = new IMediaSample*[m_lBatchSize];
+	if (m_ppSamples == NULL) {
+		*phr = E_OUTOFMEMORY;
+		return;
+	}
+
+	// That's all for the direct delivery
+	if (!bQueue)
+		return;
+
+	// Allocate the ring
+	m_pRing = new QUEUE_ENTRY[PARSER_QUEUE_SIZE];
+	if (m_pRing == NULL) {
+		*phr = E_OUTOFMEMORY;
+		return;
+	}
+
+	// Create the events
+	m_hDataEvent	= CreateEvent(NULL, FALSE, FALSE, NULL);
+	m_hSpaceEvent	= CreateEvent(NULL, FALSE, FALSE, NULL);
+	m_hFlushEvent	= CreateEvent(NULL, FALSE, FALSE, NULL);
+	if (
+		(m_hDataEvent == NULL) ||
+		(m_hSpaceEvent == NULL) ||
+		(m_hFlushEvent == NULL)
+	) {
+		*phr = AmHresultFromWin32(GetLastError());
+		return;
+	}
+
+	// Start the queue thread
+	DWORD dwThreadId;
+	m_hThread = CreateThread(
+		NULL,
+		0,
+		InitialThreadProc,
+		(LPVOID)this,
+		0,
+		&dwThreadId
+	);
+	if (m_hThread == NULL)
+		*phr = AmHresultFromWin32(GetLastError());
+}
+
+CParserOutputQueue::~CParserOutputQueue()
+{
+	// Stop the queue thread
+	if (m_hThread) {
+		InterlockedExchange(&m_bTerminate, TRUE);
+		SetEvent(m_hDataEvent);
+		WaitForSingleObject(m_hThread, INFINITE);
+		CloseHandle(m_hThread);
+	}
+
+	// Release the samples left in the ring and in the batch
+	if (m_pRing) {
+		while (GetRingCount() > 0) {
+			QUEUE_ENTRY *pEntry = &m_pRing[m_lHead & (PARSER_QUEUE_SIZE - 1)];
+			if (pEntry->dwType == QUEUE_SAMPLE)
+				pEntry->pSample->Release();
+			m_lHead++;
+		}
+		delete[] m_pRing;
+	}
+	if (m_ppSamples) {
+		ReleaseBatch();
+		delete[] m_ppSamples;
+	}
+
+	// Close the events
+	if (m_hDataEvent)
+		CloseHandle(m_hDataEvent);
+	if (m_hSpaceEvent)
+		CloseHandle(m_hSpaceEvent);
+	if (m_hFlushEvent)
+		CloseHandle(m_hFlushEvent);
+
+	// Free the downstream pin interface
+	if (m_pInputPin)
+		m_pInputPin->Release();
+}
+
+HRESULT CParserOutputQueue::Receive(IMediaSample *pSample)
+{
+	// Discard the sample if the delivery failed or we're flushing
+	HRESULT hr = m_hr;
+	if (hr != S_OK) {
+		pSample->Release();
+		return hr;
+	}
+
+	// Deliver the sample right away if there's no queue thread
+	if (!IsQueued()) {
+		m_ppSamples[m_nBatched++] = pSample;
+		if (!m_bBatchExact || (m_nBatched >= m_lBatchSize))
+			SendBatch();
+		return m_hr;
+	}
+
+	// Pass the sample to the queue thread
+	QUEUE_ENTRY Entry = { QUEUE_SAMPLE, pSample, 0, 0, 0.0 };
+	PushEntry(&Entry);
+
+	return S_OK;
+}
+
+void CParserOutputQueue::EOS(void)
+{
+	if (IsQueued()) {
+		PushControl(QUEUE_EOS);
+		return;
+	}
+
+	// Send the partial batch and then the end of stream
+	SendBatch();
+	if (m_hr == S_OK)
+		m_pPin->EndOfStream();
+}
+
+void CParserOutputQueue::BeginFlush(void)
+{
+	if (IsQueued()) {
+
+		// Make the queue thread drop everything it has (including the 
+		// batched samples, so that the upstream gets its buffers back) 
+		// and then flush the downstream pin, which makes the thread
+		// return if it's blocked in the delivery
+		InterlockedExchange(&m_bFlushing, TRUE);
+		SetResult(S_FALSE);
+		SetEvent(m_hDataEvent);
+		m_pPin->BeginFlush();
+
+	} else {
+
+		// Flush the downstream pin first as the delivery can be 
+		// blocked on the streaming thread
+		m_pPin->BeginFlush();
+		InterlockedExchange(&m_bFlushing, TRUE);
+		SetResult(S_FALSE);
+	}
+}
+
+void CParserOutputQueue::EndFlush(void)
+{
+	if (IsQueued()) {
+
+		// The producer is idle now, so the flush mark is the last entry
+		// and the thread acknowledges it after it has dropped everything
+		// pushed before it
+		PushControl(QUEUE_FLUSH);
+		WaitForSingleObject(m_hFlushEvent, INFINITE);
+
+	} else
+		ReleaseBatch();
+
+	InterlockedExchange(&m_bFlushing, FALSE);
+	m_pPin->EndFlush();
+
+	// Get ready for the new data (that cancels the sticky result)
+	InterlockedExchange(&m_hr, S_OK);
+}
+
+void CParserOutputQueue::NewSegment(
+	REFERENCE_TIME tStart,
+	REFERENCE_TIME tStop,
+	double dRate
+)
+{
+	if (m_hr != S_OK)
+		return;
+
+	if (IsQueued()) {
+		QUEUE_ENTRY Entry = { QUEUE_NEW_SEGMENT, NULL, tStart, tStop, dRate };
+		PushEntry(&Entry);
+		return;
+	}
+
+	// Send the partial batch and then the new segment
+	SendBatch();
+	m_pPin->NewSegment(tStart, tStop, dRate);
+}
+
+BOOL CParserOutputQueue::IsQueued(void)
+{
+	return (m_hThread != NULL);
+}
+
+LONG CParserOutputQueue::GetQueueDepth(void)
+{
+	// The samples are either batched or waiting in the ring for the 
+	// queue thread (if there's one). Both counters are read without 
+	// a lock, so the value is approximate (and the ring count also
+	// includes the control entries)
+	LONG lDepth = m_nBatched;
+	if (m_pRing)
+		lDepth += GetRingCount();
+
+	return lDepth;
+}
+
+LONG CParserOutputQueue::GetRingCount(void)
+{
+	// The counters are free-running, so the difference holds even 
+	// when they wrap around
+	return (LONG)((ULONG)m_lTail - (ULONG)m_lHead);
+}
+
+void CParserOutputQueue::SetResult(HRESULT hr)
+{
+	InterlockedCompareExchange(&m_hr, hr, S_OK);
+}
+
+void CParserOutputQueue::SendBatch(void)
+{
+	if ((m_nBatched > 0) && !m_bFlushing && (m_hr == S_OK)) {
+		LONG nProcessed;
+		SetResult(m_pInputPin->ReceiveMultiple(m_ppSamples, m_nBatched, &nProcessed));
+	}
+
+	ReleaseBatch();
+}
+
+void CParserOutputQueue::ReleaseBatch(void)
+{
+	for (LONG i = 0; i < m_nBatched; i++)
+		m_ppSamples[i]->Release();
+	m_nBatched = 0;
+}
+
+void CParserOutputQueue::PushEntry(const QUEUE_ENTRY *pEntry)
+{
+	// Wait for a free entry. The flag is set before the count is 
+	// checked again, so the thread either sees the flag when it pops 
+	// or we see the popped entry
+	while (GetRingCount() >= PARSER_QUEUE_SIZE) {
+		InterlockedExchange(&m_lProducerWaiting, 1);
+		if (GetRingCount() >= PARSER_QUEUE_SIZE)
+			WaitForSingleObject(m_hSpaceEvent, INFINITE);
+		InterlockedExchange(&m_lProducerWaiting, 0);
+	}
+
+	// Fill in the entry and publish it (the interlocked increment is
+	// a full barrier, so the thread never sees the index before the 
+	// entry contents)
+	m_pRing[m_lTail & (PARSER_QUEUE_SIZE - 1)] = *pEntry;
+	InterlockedIncrement(&m_lTail);
+
+	// Wake the thread up only if it's waiting and has something to do
+	// (that's a full batch if the batch should be exact). The batch 
+	// counter does not change while the thread waits
+	if (m_lConsumerWaiting) {
+		if (
+			(pEntry->dwType != QUEUE_SAMPLE) ||
+			!m_bBatchExact ||
+			(GetRingCount() + m_nBatched >= m_lBatchSize)
+		) {
+			if (InterlockedExchange(&m_lConsumerWaiting, 0))
+				SetEvent(m_hDataEvent);
+		}
+	}
+}
+
+void CParserOutputQueue::PushControl(DWORD dwType)
+{
+	QUEUE_ENTRY Entry = { dwType, NULL, 0, 0, 0.0 };
+	PushEntry(&Entry);
+}
+
+void CParserOutputQueue::WaitForData(void)
+{
+	// Tell the producer we're about to wait and check the ring once 
+	// more (the producer might have pushed before it saw the flag).
+	// A stale event signal makes the thread just loop once more
+	InterlockedExchange(&m_lConsumerWaiting, 1);
+	if (
+		(GetRingCount() == 0) &&
+		!m_bTerminate &&
+		!(m_bFlushing && (m_nBatched > 0))
+	)
+		WaitForSingleObject(m_hDataEvent, INFINITE);
+	InterlockedExchange(&m_lConsumerWaiting, 0);
+}
+
+DWORD WINAPI CParserOutputQueue::InitialThreadProc(LPVOID pv)
+{
+	HRESULT hrCoInit = CAMThread::CoInitializeHelper();
+
+	CParserOutputQueue *pQueue = (CParserOutputQueue*)pv;
+	DWORD dwReturn = pQueue->ThreadProc();
+
+	if (hrCoInit == S_OK)
+		CoUninitialize();
+
+	return dwReturn;
+}
+
+DWORD CParserOutputQueue::ThreadProc(void)
+{
+	while (TRUE) {
+
+		// Control entry which ends the batch (if any)
+		QUEUE_ENTRY Control = { QUEUE_SAMPLE, NULL, 0, 0, 0.0 };
+
+		// Pop the samples until the batch is full or a control entry
+		// shows up. If the batch is not exact, whatever is popped by 
+		// the time the ring gets empty is sent
+		while (m_nBatched < m_lBatchSize) {
+
+			if (m_bTerminate)
+				return 0;
+
+			// Drop the batched samples as soon as the flush begins
+			if (m_bFlushing)
+				ReleaseBatch();
+
+			// Wait for the producer if the ring is empty
+			if (GetRingCount() == 0) {
+				if ((m_nBatched > 0) && !m_bBatchExact)
+					break;
+				WaitForData();
+				continue;
+			}
+
+			// Take the entry (the samples popped during the flush are dropped)
+			QUEUE_ENTRY *pEntry = &m_pRing[m_lHead & (PARSER_QUEUE_SIZE - 1)];
+			if (pEntry->dwType == QUEUE_SAMPLE) {
+				if (m_bFlushing)
+					pEntry->pSample->Release();
+				else
+					m_ppSamples[m_nBatched++] = pEntry->pSample;
+			} else
+				Control = *pEntry;
+
+			// Give the entry back to the producer and wake it up if it 
+			// waits for a free entry
+			InterlockedIncrement(&m_lHead);
+			if (m_lProducerWaiting) {
+				if (InterlockedExchange(&m_lProducerWaiting, 0))
+					SetEvent(m_hSpaceEvent);
+			}
+
+			if (Control.dwType != QUEUE_SAMPLE)
+				break;
+		}
+
+		// Deliver the batch
+		SendBatch();
+
+		// Handle the control entry
+		switch (Control.dwType) {
+
+			case QUEUE_EOS:
+				if (!m_bFlushing && (m_hr == S_OK))
+					m_pPin->EndOfStream();
+				break;
+
+			case QUEUE_NEW_SEGMENT:
+				if (!m_bFlushing)
+					m_pPin->NewSegment(Control.tStart, Control.tStop, Control.dRate);
+				break;
+
+			case QUEUE_FLUSH:
+				SetEvent(m_hFlushEvent);
+				break;
+
+		}
+	}
+}
+
+//==========================================================================
+// CParserReferenceSample methods
+//==========================================================================
+
+CParserReferenceSample::CParserReferenceSample(
+	CParserReferenceAllocator *pAllocator,
+	HRESULT *phr
+) :
+	CMediaSample(
+		NAME("Parser Reference Sample"),
+		pAllocator,
+		phr,
+		NULL,	// No buffer until the sample is handed out
+		0
+	),
+	m_pInputSample(NULL)
+{
 }
 
-HRESULT CParserInputPin::CheckMediaType(const CMediaType* pmt)
+//==========================================================================
+// CParserReferenceAllocator methods
+//==========================================================================
+
+CParserReferenceAllocator::CParserReferenceAllocator(HRESULT *phr) :
+	CBaseAllocator(NAME("Parser Reference Allocator"), NULL, phr),
+	m_nMaxLoans(0)
 {
-	// Delegate the call to the parent filter
-	return ((CBaseParserFilter*)m_pFilter)->CheckInputType(pmt);
+	// No input samples lent at this time
+	ZeroMemory(m_Loan, sizeof(m_Loan));
 }
 
-HRESULT CParserInputPin::GetMediaType(int iPosition, CMediaType *pMediaType)
+CParserReferenceAllocator::~CParserReferenceAllocator()
 {
-	// Delegate the call to the parent filter
-	return ((CBaseParserFilter*)m_pFilter)->GetInputType(iPosition, pMediaType);
+	Decommit();
+	ReallyFree();
 }
 
-STDMETHODIMP CParserInputPin::Receive(IMediaSample *pSample)
+HRESULT CParserReferenceAllocator::Activate(LONG nSamples, LONG nMaxLoans)
 {
-	CAutoLock lock(m_pReceiveLock);
+	// Protect the allocator state
+	CAutoLock lock(this);
 
-	// Check whether it's all right with pSample in the base-class 
-	// implementation and return if not
-	HRESULT hr = CBaseInputPin::Receive(pSample);
-	if (hr != S_OK)
-		return hr;
+	m_nMaxLoans = min(nMaxLoans, PARSER_MAX_LOANS);
 
-	// Delegate the call on to the parent filter
-	return ((CBaseParserFilter*)m_pFilter)->Receive(pSample);
+	// Set the number of samples (unless it's already set). The samples
+	// have no buffers, so the buffer size does not matter
+	if (m_lCount != nSamples) {
+		ALLOCATOR_PROPERTIES apRequest, apActual;
+		apRequest.cBuffers	= nSamples;
+		apRequest.cbBuffer	= 1;
+		apRequest.cbAlign	= 1;
+		apRequest.cbPrefix	= 0;
+		HRESULT hr = SetProperties(&apRequest, &apActual);
+		if (FAILED(hr))
+			return hr;
+	}
+
+	return Commit();
 }
 
-HRESULT CParserInputPin::Seek(LONGLONG llStart, LONGLONG llStop)
+HRESULT CParserReferenceAllocator::GetReferenceSample(
+	IMediaSample *pInputSample,
+	BYTE *pbData,
+	LONG lDataSize,
+	IMediaSample **ppSample
+)
 {
-	// Hold the filter lock so that the pullpin allocator is kept 
-	// intact inside the method
-	CAutoLock lock(m_pLock);
+	// Check the pointers
+	CheckPointer(pInputSample, E_POINTER);
+	CheckPointer(pbData, E_POINTER);
+	CheckPointer(ppSample, E_POINTER);
+
+	// Protect the allocator state
+	CAutoLock lock(this);
+
+	// Find the loan of the input sample (or a free entry for it)
+	LONG iLoan, iFree = -1;
+	for (iLoan = 0; iLoan < m_nMaxLoans; iLoan++) {
+		if (m_Loan[iLoan].pSample == pInputSample)
+			break;
+		if ((m_Loan[iLoan].pSample == NULL) && (iFree == -1))
+			iFree = iLoan;
+	}
+	if (iLoan == m_nMaxLoans) {
+		// No more input samples can be lent
+		if (iFree == -1)
+			return S_FALSE;
+		iLoan = iFree;
+	}
 
-	// Convert file positions to media time and seek the pullpin
-	REFERENCE_TIME rtStart, rtStop;
-	rtStart	= llStart * UNITS;
-	if (llStop < MAXLONGLONG)
-		rtStop = llStop * UNITS;
-	else
-		rtStop = MAXLONGLONG;
-	HRESULT hr = m_PullPin.Seek(rtStart, rtStop);
+	// Get a free sample (if there's none, don't wait for it)
+	IMediaSample *pSample = NULL;
+	HRESULT hr = GetBuffer(&pSample, NULL, NULL, AM_GBF_NOWAIT);
 	if (FAILED(hr))
-		return hr;
+		return S_FALSE;
 
-	// Get the alignment of the pullpin's allocator
-	ALLOCATOR_PROPERTIES apActual;
-	ASSERT(m_PullPin.m_pAlloc);
-	hr = m_PullPin.m_pAlloc->GetProperties(&apActual);
-	if (FAILED(hr))
+	// Point the sample to the data
+	CParserReferenceSample *pReferenceSample = (CParserReferenceSample*)pSample;
+	hr = pReferenceSample->SetPointer(pbData, lDataSize);
+	if (SUCCEEDED(hr))
+		hr = pReferenceSample->SetActualDataLength(0);
+	if (FAILED(hr)) {
+		pSample->Release();
 		return hr;
+	}
 
-	// Set the adjustment length
-	((CBaseParserFilter*)m_pFilter)->SetAdjustment(m_PullPin.AlignDown(llStart, apActual.cbAlign));
+	// Lend the input sample to the reference sample
+	if (m_Loan[iLoan].pSample == NULL) {
+		pInputSample->AddRef();
+		m_Loan[iLoan].pSample = pInputSample;
+	}
+	m_Loan[iLoan].nSamples++;
+	pReferenceSample->m_pInputSample = pInputSample;
+
+	*ppSample = pSample;
 
 	return NOERROR;
 }
 
-STDMETHODIMP CParserInputPin::BeginFlush(void)
+STDMETHODIMP CParserReferenceAllocator::ReleaseBuffer(IMediaSample *pSample)
 {
-	CAutoLock lock(m_pLock);
+	CheckPointer(pSample, E_POINTER);
 
-	// Perform the base-class BeginFlush
-	HRESULT hr = CBaseInputPin::BeginFlush();
-	if (FAILED(hr))
-		return hr;
+	CParserReferenceSample *pReferenceSample = (CParserReferenceSample*)pSample;
+	IMediaSample *pInputSample = NULL;
 
-	// Delegate the call on to the parent filter
-	return ((CBaseParserFilter*)m_pFilter)->BeginFlush();
+	// Scope for the locking
+	{
+		// Protect the allocator state
+		CAutoLock lock(this);
+
+		// Return the loan. The last reference sample 
+		// using the input sample gives it back
+		for (LONG iLoan = 0; iLoan < PARSER_MAX_LOANS; iLoan++) {
+			if (
+				(m_Loan[iLoan].pSample != NULL) &&
+				(m_Loan[iLoan].pSample == pReferenceSample->m_pInputSample)
+			) {
+				if (--m_Loan[iLoan].nSamples == 0) {
+					pInputSample = m_Loan[iLoan].pSample;
+					m_Loan[iLoan].pSample = NULL;
+				}
+				break;
+			}
+		}
+		pReferenceSample->m_pInputSample = NULL;
+		pReferenceSample->SetPointer(NULL, 0);
+	}
+
+	// Release the input sample outside the lock, as that
+	// puts it back to the pullpin's allocator free list
+	if (pInputSample)
+		pInputSample->Release();
+
+	// Put the sample back to the free list (that may also 
+	// complete the decommit and delete the allocator)
+	return CBaseAllocator::ReleaseBuffer(pSample);
 }
 
-STDMETHODIMP CParserInputPin::EndFlush(void)
+HRESULT CParserReferenceAllocator::Alloc(void)
 {
-	CAutoLock lock(m_pLock);
+	// Protect the allocator state
+	CAutoLock lock(this);
 
-	// Delegate the call to the parent filter
-	HRESULT hr = ((CBaseParserFilter*)m_pFilter)->EndFlush();
+	// Check if the properties have been set
+	HRESULT hr = CBaseAllocator::Alloc();
 	if (FAILED(hr))
 		return hr;
 
-	// Perform the base-class EndFlush
-	return CBaseInputPin::EndFlush();
-}
+	// If the properties haven't changed, the samples are already there
+	if (hr == S_FALSE)
+		return NOERROR;
 
-STDMETHODIMP CParserInputPin::NewSegment(
-	REFERENCE_TIME tStart, 
-	REFERENCE_TIME tStop, 
-	double dRate
-)
-{
-	CAutoLock lock(m_pReceiveLock);
+	// Delete the old samples
+	ReallyFree();
 
-	// Delegate the call to the parent filter
-	HRESULT hr = ((CBaseParserFilter*)m_pFilter)->NewSegment(tStart, tStop, dRate);
-	if (FAILED(hr))
-		return hr;
+	// Create the new samples
+	for (; m_lAllocated < m_lCount; m_lAllocated++) {
+		hr = NOERROR;
+		CParserReferenceSample *pSample = new CParserReferenceSample(this, &hr);
+		if (pSample == NULL)
+			return E_OUTOFMEMORY;
+		if (FAILED(hr)) {
+			delete pSample;
+			return hr;
+		}
+		m_lFree.Add(pSample);
+	}
 
-	// Perform the base-class NewSegment
-	return CBaseInputPin::NewSegment(tStart, tStop, dRate);
+	m_bChanged = FALSE;
+
+	return NOERROR;
 }
 
-STDMETHODIMP CParserInputPin::EndOfStream(void)
+void CParserReferenceAllocator::Free(void)
 {
-	CAutoLock lock(m_pReceiveLock);
+	// The samples are kept until the allocator is deleted
+	// (or its properties are changed)
+}
 
-	// Check if we can accept end of stream message
-	HRESULT hr = CheckStreaming();
-	if (hr != S_OK)
-		return hr;
+void CParserReferenceAllocator::ReallyFree(void)
+{
+	// All samples should be on the free list
+	ASSERT(m_lAllocated == m_lFree.GetCount());
 
-	// Delegate the call to the parent filter
-	hr = ((CBaseParserFilter*)m_pFilter)->EndOfStream();
-	if (FAILED(hr))
-		return hr;
-	
-	// Perform the base-class EndOfStream
-	return CBaseInputPin::EndOfStream();
+	// Delete the samples
+	CMediaSample *pSample;
+	while ((pSample = m_lFree.RemoveHead()) != NULL)
+		delete pSample;
+
+	m_lAllocated = 0;
 }
 
 //==========================================================================
@@ -383,7 +2003,10 @@ CParserOutputPin::CParserOutputPin(
 	m_bIsDiscontinuity(TRUE),
 	m_pMediaType(pmt),
 	m_pAllocatorProperties(pap),
-	m_pOutputQueue(NULL)
+	m_pOutputQueue(NULL),
+	m_cbBuffer(0),					// No allocator at this time
+	m_pOversizeAllocator(NULL),		// No oversize chunks yet
+	m_cbOversizeBuffer(0)
 {
 	ASSERT(pFilter);
 	ASSERT(pFilterLock);
@@ -391,6 +2014,9 @@ CParserOutputPin::CParserOutputPin(
 	ASSERT(pap);
 	ASSERT(phr);
 
+	// No statistics yet
+	ZeroMemory(&m_Statistics, sizeof(GMF_PIN_STATISTICS));
+
 	{
 		// Protect the filter options
 		CAutoLock optionlock(&m_csOptions);
@@ -537,6 +2163,9 @@ CParserOutputPin::~CParserOutputPin()
 
 	// Output queue should already have been destroyed
 	ASSERT(m_pOutputQueue == NULL);
+
+	// Release the oversize allocator (if it's still there)
+	FreeOversizeAllocator();
 }
 
 STDMETHODIMP CParserOutputPin::NonDelegatingQueryInterface(REFIID riid, void **ppv)
@@ -653,6 +2282,9 @@ HRESULT CParserOutputPin::DecideBufferSize(
 	)
 		return E_FAIL;
 
+	// Remember the buffer size to tell the chunks which do not fit
+	m_cbBuffer = apActual.cbBuffer;
+
 	return NOERROR;
 }
 
@@ -666,29 +2298,32 @@ HRESULT CParserOutputPin::Active(void)
 	if (!IsConnected())
 		return NOERROR;
 
-	// Create the output queue if we have to
-	if (m_pOutputQueue == NULL) {
+	// Create the output queue if we have to. The queue is not visible 
+	// to Deliver() until NewSegment() is queued, as the queue takes one
+	// producer at a time (and the input pin is already streaming)
+	CParserOutputQueue *pOutputQueue = m_pOutputQueue;
+	if (pOutputQueue == NULL) {
 
 		{
 			// Protect the filter options
 			CAutoLock optionlock(&m_csOptions);
 
-			m_pOutputQueue = new COutputQueue(
+			pOutputQueue = new CParserOutputQueue(
 				m_Connected,
 				&hr,
 				m_bAutoQueue,
 				m_bQueue,
 				m_lBatchSize,
-				m_bBatchExact
+				m_bBatchExact,
+				Name()
 			);
 		}
-		if (m_pOutputQueue == NULL)
+		if (pOutputQueue == NULL)
 			return E_OUTOFMEMORY;
 
 		// Make sure that the constructor did not return any error
 		if (FAILED(hr)) {
-			delete m_pOutputQueue;
-			m_pOutputQueue = NULL;
+			delete pOutputQueue;
 			return hr;
 		}
 	}
@@ -713,10 +2348,14 @@ HRESULT CParserOutputPin::Active(void)
 			NewSegment(rtStart, rtStop, dRate);
 
 			// Deliver NewSegment() downstream
-			DeliverNewSegment(rtStart, rtStop, dRate);
+			pOutputQueue->NewSegment(rtStart, rtStop, dRate);
 		}
 	}
 
+	// Let Deliver() use the queue
+	if (m_pOutputQueue == NULL)
+		InterlockedExchangePointer((PVOID*)&m_pOutputQueue, pOutputQueue);
+
 	// Pass the call on to the base class
 	return CBaseOutputPin::Active();
 }
@@ -732,6 +2371,10 @@ HRESULT CParserOutputPin::Inactive(void)
 		m_pOutputQueue = NULL;
 	}
 
+	// Release the oversize allocator (that also makes the streaming 
+	// thread return if it waits for the oversize buffer)
+	FreeOversizeAllocator();
+
 	// Reset the stream and media times to zeros
 	m_rtStreamTime	= 0;
 	m_llMediaTime	= 0;
@@ -795,14 +2438,80 @@ HRESULT CParserOutputPin::Deliver(
 	return NOERROR;
 }
 
+HRESULT CParserOutputPin::Skip(
+	REFERENCE_TIME rtDelta,
+	LONGLONG llDelta
+)
+{
+	if (m_pParserSeeking) {
+		// Get the current rate (see Deliver() above)
+		double dRate = 1.0;
+		if (SUCCEEDED(m_pParserSeeking->GetRate(&dRate))) {
+			// Adjust time delta according to the current rate
+			if (dRate > 0)
+				rtDelta /= dRate;
+		}
+	}
+
+	// Update the stream and media times as if 
+	// the sample has been delivered
+	m_rtStreamTime += rtDelta;
+	m_llMediaTime += llDelta;
+
+	// Advance the seeker's position (the failure is ignored 
+	// for the same reason as in Deliver())
+	if (m_pParserSeeking)
+		m_pParserSeeking->AdvanceCurrentPosition(llDelta);
+
+	// There's a gap before the next delivered sample
+	m_bIsDiscontinuity = TRUE;
+
+	return NOERROR;
+}
+
 HRESULT CParserOutputPin::Deliver(IMediaSample *pMediaSample)
 {
 	// Make sure that we have an output queue
 	if (m_pOutputQueue == NULL)
 		return NOERROR;
 
-	pMediaSample->AddRef();
-	return m_pOutputQueue->Receive(pMediaSample);
+	LONG lDataLength = pMediaSample->GetActualDataLength();
+
+	LONGLONG llStartTime = GetStatisticsTime();
+
+	HRESULT hr;
+
+	// Let the filter index the sample
+	((CBaseParserFilter*)m_pFilter)->RecordIndexSample(this, pMediaSample);
+
+	// Scope for the tracing
+	{
+		CTraceSpan span("OutputPin::Deliver", Name(), "time", GetTraceSampleTime(pMediaSample));
+
+		pMediaSample->AddRef();
+		hr = m_pOutputQueue->Receive(pMediaSample);
+	}
+
+	LONGLONG llDeliveryTime = GetStatisticsTime() - llStartTime;
+	LONG lQueueDepth = m_pOutputQueue->GetQueueDepth();
+
+	// Scope for the locking
+	{
+		// Protect the statistics
+		CAutoLock statlock(&m_csStatistics);
+
+		// Update the delivery counters
+		if (SUCCEEDED(hr)) {
+			m_Statistics.llSamplesDelivered++;
+			m_Statistics.llBytesDelivered += lDataLength;
+		}
+		m_Statistics.llDeliveryTime	+= llDeliveryTime;
+		m_Statistics.lQueueDepth	= lQueueDepth;
+		if (lQueueDepth > m_Statistics.lMaxQueueDepth)
+			m_Statistics.lMaxQueueDepth = lQueueDepth;
+	}
+
+	return hr;
 }
 
 HRESULT CParserOutputPin::DeliverEndOfStream(void)
@@ -875,11 +2584,173 @@ HRESULT CParserOutputPin::GetDeliveryBuffer(
 	DWORD dwFlags
 )
 {
+	LONGLONG llStartTime = GetStatisticsTime();
+
 	// Call the base class method (which actually retrieves the buffer)
 	HRESULT hr = CBaseOutputPin::GetDeliveryBuffer(ppSample, pStartTime, pEndTime, dwFlags);
+
+	LONGLONG llWaitTime = GetStatisticsTime() - llStartTime;
+
+	// Scope for the locking
+	{
+		// Protect the statistics
+		CAutoLock statlock(&m_csStatistics);
+
+		// Update the allocator wait counters
+		m_Statistics.llAllocatorWaitTime += llWaitTime;
+		if (llWaitTime > GMF_STATISTICS_WAIT_THRESHOLD)
+			m_Statistics.llAllocatorWaits++;
+	}
+
+	if (FAILED(hr))
+		return hr;
+
+	// Set the default sample properties
+	hr = InitializeSample(*ppSample);
+	if (FAILED(hr)) {
+		(*ppSample)->Release();
+		return hr;
+	}
+
+	return NOERROR;
+}
+
+HRESULT CParserOutputPin::GetReferenceBuffer(
+	IMediaSample **ppSample,
+	LONGLONG llPosition,
+	LONG lDataSize
+)
+{
+	// Check the pointer
+	CheckPointer(ppSample, E_POINTER);
+
+	// Ask the filter for the sample referencing the input data
+	HRESULT hr = ((CBaseParserFilter*)m_pFilter)->GetReferenceSample(llPosition, lDataSize, ppSample);
+	if (hr != S_OK)
+		return hr;
+
+	// Set the default sample properties
+	hr = InitializeSample(*ppSample);
+	if (FAILED(hr)) {
+		(*ppSample)->Release();
+		*ppSample = NULL;
+		return hr;
+	}
+
+	return NOERROR;
+}
+
+HRESULT CParserOutputPin::GetChunkBuffer(
+	IMediaSample **ppSample,
+	LONG lDataSize
+)
+{
+	// Check the pointer
+	CheckPointer(ppSample, E_POINTER);
+
+	// Use the regular buffer if the data fits (or we do not know 
+	// the buffer size yet)
+	if ((m_cbBuffer == 0) || (lDataSize <= m_cbBuffer))
+		return GetDeliveryBuffer(ppSample, NULL, NULL, 0);
+
+	IMemAllocator *pAllocator = NULL;
+	HRESULT hr = NOERROR;
+
+	// Scope for the locking
+	{
+		// Protect the oversize allocator
+		CAutoLock lock(&m_csOversize);
+
+		// Grow the allocator if its buffers are too small
+		if (lDataSize > m_cbOversizeBuffer) {
+
+			FreeOversizeAllocator();
+
+			// Create the allocator
+			CMemAllocator *pMemAllocator = new CMemAllocator(NAME("Parser Oversize Allocator"), NULL, &hr);
+			if (pMemAllocator == NULL)
+				return E_OUTOFMEMORY;
+			pMemAllocator->AddRef();
+			if (FAILED(hr)) {
+				pMemAllocator->Release();
+				return hr;
+			}
+
+			// Round the buffer size up to the granularity
+			ALLOCATOR_PROPERTIES apRequest, apActual;
+			apRequest.cBuffers	= PARSER_OVERSIZE_BUFFERS;
+			apRequest.cbBuffer	= (lDataSize + PARSER_OVERSIZE_GRANULARITY - 1) & ~(PARSER_OVERSIZE_GRANULARITY - 1);
+			apRequest.cbAlign	= 1;
+			apRequest.cbPrefix	= 0;
+
+			// Set the properties and commit the allocator
+			hr = pMemAllocator->SetProperties(&apRequest, &apActual);
+			if (SUCCEEDED(hr))
+				hr = pMemAllocator->Commit();
+			if (FAILED(hr)) {
+				pMemAllocator->Release();
+				return hr;
+			}
+
+			m_pOversizeAllocator	= pMemAllocator;
+			m_cbOversizeBuffer		= apActual.cbBuffer;
+		}
+
+		// Hold the allocator while waiting for the buffer (the pin 
+		// may let go of it in the meantime)
+		pAllocator = m_pOversizeAllocator;
+		pAllocator->AddRef();
+	}
+
+	LONGLONG llStartTime = GetStatisticsTime();
+
+	// Get the buffer
+	hr = pAllocator->GetBuffer(ppSample, NULL, NULL, 0);
+	pAllocator->Release();
+
+	LONGLONG llWaitTime = GetStatisticsTime() - llStartTime;
+
+	// Scope for the locking
+	{
+		// Protect the statistics
+		CAutoLock statlock(&m_csStatistics);
+
+		// Update the allocator wait counters
+		m_Statistics.llAllocatorWaitTime += llWaitTime;
+		if (llWaitTime > GMF_STATISTICS_WAIT_THRESHOLD)
+			m_Statistics.llAllocatorWaits++;
+	}
+
 	if (FAILED(hr))
 		return hr;
 
+	// Set the default sample properties
+	hr = InitializeSample(*ppSample);
+	if (FAILED(hr)) {
+		(*ppSample)->Release();
+		return hr;
+	}
+
+	return NOERROR;
+}
+
+void CParserOutputPin::FreeOversizeAllocator(void)
+{
+	// Protect the oversize allocator
+	CAutoLock lock(&m_csOversize);
+
+	// Decommit the allocator and let go of it. The allocator
+	// holds itself until its outstanding samples are released
+	if (m_pOversizeAllocator) {
+		m_pOversizeAllocator->Decommit();
+		m_pOversizeAllocator->Release();
+		m_pOversizeAllocator = NULL;
+	}
+	m_cbOversizeBuffer = 0;
+}
+
+HRESULT CParserOutputPin::InitializeSample(IMediaSample *pSample)
+{
 	// If bTemporalCompression is TRUE, set syncpoint to TRUE 
 	// only for the first sample 
 	BOOL bSyncPoint;
@@ -889,27 +2760,17 @@ HRESULT CParserOutputPin::GetDeliveryBuffer(
 		bSyncPoint = TRUE;
 
 	// Set the syncpoint property
-	hr = (*ppSample)->SetSyncPoint(bSyncPoint);
-	if (FAILED(hr)) {
-		(*ppSample)->Release();
+	HRESULT hr = pSample->SetSyncPoint(bSyncPoint);
+	if (FAILED(hr))
 		return hr;
-	}
 
 	// No preroll samples by default
-	hr = (*ppSample)->SetPreroll(FALSE);
-	if (FAILED(hr)) {
-		(*ppSample)->Release();
+	hr = pSample->SetPreroll(FALSE);
+	if (FAILED(hr))
 		return hr;
-	}
 
 	// Set the discontinuity property
-	hr = (*ppSample)->SetDiscontinuity(m_bIsDiscontinuity);
-	if (FAILED(hr)) {
-		(*ppSample)->Release();
-		return hr;
-	}
-
-	return NOERROR;
+	return pSample->SetDiscontinuity(m_bIsDiscontinuity);
 }
 
 long CParserOutputPin::get_BuffersNumber(void)
@@ -992,6 +2853,22 @@ void CParserOutputPin::put_BatchExact(BOOL bBatchExact)
 	m_bBatchExact = bBatchExact;
 }
 
+void CParserOutputPin::GetStatistics(GMF_PIN_STATISTICS *pStatistics)
+{
+	// Protect the statistics
+	CAutoLock statlock(&m_csStatistics);
+
+	*pStatistics = m_Statistics;
+}
+
+void CParserOutputPin::ResetStatistics(void)
+{
+	// Protect the statistics
+	CAutoLock statlock(&m_csStatistics);
+
+	ZeroMemory(&m_Statistics, sizeof(GMF_PIN_STATISTICS));
+}
+
 //==========================================================================
 // CBaseChunkParser methods
 //==========================================================================
@@ -1059,8 +2936,12 @@ HRESULT CBaseChunkParser::Receive(
 	// Check the pointer
 	CheckPointer(pbData, E_POINTER);
 
+	CTraceSpan span("ChunkParser::Receive", m_pFilter->Name(), "position", llStartPosition);
+
 	HRESULT hr = NOERROR;
 	LONG lLength, lRemainder, lCorrection;
+	DWORD dwChunkType;
+	BOOL bCountChunk;
 
 	// Process data buffer until the data is exhausted
 	while (lDataSize > 0) {
@@ -1104,13 +2985,20 @@ HRESULT CBaseChunkParser::Receive(
 					m_State = CPS_HEADER_PARTIAL;
 				} else {
 					// We've got complete header: parse it and change state
+					bCountChunk = GetChunkType(pbData, &dwChunkType);
+					m_pFilter->UpdateChunkIndex(llStartPosition, bCountChunk, dwChunkType);
 					m_lChunkDataSize = 0;
-					hr = ParseChunkHeader(llStartPosition, pbData, &m_lChunkDataSize);
+					{
+						CTraceSpan headerspan("ChunkParser::ParseChunkHeader", m_pFilter->Name(), "position", llStartPosition);
+						hr = ParseChunkHeader(llStartPosition, pbData, &m_lChunkDataSize);
+					}
 					m_State = CPS_HEADER_COMPLETE;
 					if (FAILED(hr))
 						return hr;
 					if (m_lChunkDataSize < 0)
 						return E_UNEXPECTED;
+					if (bCountChunk)
+						m_pFilter->UpdateChunkStatistics(dwChunkType, m_lHeaderSize + m_lChunkDataSize);
 				}
 
 				// Advance data pointer and remained data size
@@ -1130,13 +3018,20 @@ HRESULT CBaseChunkParser::Receive(
 				m_lHeaderLength	+= lLength;
 				if (m_lHeaderLength == m_lHeaderSize) {
 					// We've completed the header: parse it and change state
+					bCountChunk = GetChunkType(m_pbHeader, &dwChunkType);
+					m_pFilter->UpdateChunkIndex(llStartPosition - m_lHeaderSize, bCountChunk, dwChunkType);
 					m_lChunkDataSize = 0;
-					hr = ParseChunkHeader(llStartPosition - m_lHeaderSize, m_pbHeader, &m_lChunkDataSize);
+					{
+						CTraceSpan headerspan("ChunkParser::ParseChunkHeader", m_pFilter->Name(), "position", llStartPosition - m_lHeaderSize);
+						hr = ParseChunkHeader(llStartPosition - m_lHeaderSize, m_pbHeader, &m_lChunkDataSize);
+					}
 					m_State = CPS_HEADER_COMPLETE;
 					if (FAILED(hr))
 						return hr;
 					if (m_lChunkDataSize < 0)
 						return E_UNEXPECTED;
+					if (bCountChunk)
+						m_pFilter->UpdateChunkStatistics(dwChunkType, m_lHeaderSize + m_lChunkDataSize);
 				}
 
 				// Advance data pointer and remained data size
@@ -1150,7 +3045,9 @@ HRESULT CBaseChunkParser::Receive(
 				
 				// Parse available data
 				lLength = min(lDataSize, m_lChunkDataSize);
+				m_pFilter->EnterChunkData();
 				hr = ParseChunkData(llStartPosition, pbData, lLength);
+				m_pFilter->LeaveChunkData();
 				if (FAILED(hr))
 					return hr;
 
@@ -1162,7 +3059,10 @@ HRESULT CBaseChunkParser::Receive(
 				
 				// If the chunk data size is exhausted, change state
 				if (!m_lChunkDataSize) {
-					ParseChunkEnd();
+					{
+						CTraceSpan endspan("ChunkParser::ParseChunkEnd", m_pFilter->Name(), "position", llStartPosition);
+						ParseChunkEnd();
+					}
 					m_State = CPS_CHUNK_COMPLETE;
 				}
 
@@ -1178,6 +3078,81 @@ HRESULT CBaseChunkParser::Receive(
 	return NOERROR;
 }
 
+HRESULT CBaseChunkParser::GetChunkSample(
+	CParserOutputPin *pPin,
+	LONGLONG llPosition,
+	LONG lDataSize,
+	IMediaSample **ppSample
+)
+{
+	// Check the pointers
+	CheckPointer(pPin, E_POINTER);
+	CheckPointer(ppSample, E_POINTER);
+
+	// Try to reference the data in the input sample first. If the 
+	// header has been received partially, it's been put together in 
+	// the header storage, so don't reference it (the sample may
+	// include the part of the header)
+	HRESULT hr = S_FALSE;
+	if (m_State != CPS_HEADER_PARTIAL) {
+		hr = pPin->GetReferenceBuffer(ppSample, llPosition, lDataSize);
+		if (hr == S_OK)
+			return NOERROR;
+	}
+
+	// Get an empty sample large enough for the data from the output pin
+	hr = pPin->GetChunkBuffer(ppSample, lDataSize);
+	if (FAILED(hr)) {
+		*ppSample = NULL;
+		return hr;
+	}
+
+	// Reset the sample's actual data length
+	hr = (*ppSample)->SetActualDataLength(0);
+	if (FAILED(hr)) {
+		(*ppSample)->Release();
+		*ppSample = NULL;
+		return hr;
+	}
+
+	return NOERROR;
+}
+
+HRESULT CBaseChunkParser::AppendChunkData(
+	IMediaSample *pSample,
+	const BYTE *pbData,
+	LONG lDataSize
+)
+{
+	// Check the pointers
+	CheckPointer(pSample, E_POINTER);
+	CheckPointer(pbData, E_POINTER);
+
+	// Get the sample's buffer
+	BYTE *pbBuffer = NULL;
+	HRESULT hr = pSample->GetPointer(&pbBuffer);
+	if (FAILED(hr))
+		return hr;
+
+	// Find out how many bytes we can append
+	LONG lBufferSize = pSample->GetSize();
+	LONG lActualDataLength = pSample->GetActualDataLength();
+	LONG lDataToCopy = min(lDataSize, lBufferSize - lActualDataLength);
+
+	// Copy data to buffer (unless the sample references 
+	// the input buffer and the data is already there)
+	if (pbBuffer + lActualDataLength != pbData)
+		CopyMemory(pbBuffer + lActualDataLength, pbData, lDataToCopy);
+	lActualDataLength += lDataToCopy;
+
+	// Update buffer's actual data length
+	hr = pSample->SetActualDataLength(lActualDataLength);
+	if (FAILED(hr))
+		return hr;
+
+	return (lDataToCopy < lDataSize) ? VFW_E_BUFFER_OVERFLOW : NOERROR;
+}
+
 //==========================================================================
 // CBaseParserFilter methods
 //==========================================================================
@@ -1211,6 +3186,13 @@ CBaseParserFilter::CBaseParserFilter(
 	m_llDefaultStop(MAXLONGLONG),	// Default is file end
 	m_cbInputBuffer(0),				// We cannot guess at this time
 	m_cbInputAlign(1),				// We cannot guess at this time
+	m_bScrub(FALSE),				// No scrub at this time
+	m_dRate(1.0),					// Default is normal rate
+	m_pReferenceAllocator(NULL),	// No reference allocator at this time
+	m_pInputSample(NULL),			// No input sample at this time
+	m_pbInputData(NULL),			// |
+	m_llInputStart(0),				// |-- No input sample data at this time
+	m_llInputStop(0),				// |
 	m_InputPin(
 		NAME("Parser Input Pin"),
 		this,
@@ -1220,11 +3202,21 @@ CBaseParserFilter::CBaseParserFilter(
 		L"Input"
 	),
 	m_nOutputPins(0),				// No output pins at this time
-	m_ppOutputPin(NULL)				// No output pins at this time
+	m_ppOutputPin(NULL),			// No output pins at this time
+	m_nChunkTypes(0),				// No chunks counted at this time
+	m_nChunkDepth(0),				// Not parsing at this time
+	m_llIndexPosition(-1),			// No chunk parsed at this time
+	m_dwIndexChunkType(0)			// No chunk parsed at this time
 {
 	ASSERT(wszFilterName);
 	ASSERT(phr);
 
+	// No statistics yet
+	ZeroMemory(&m_Statistics, sizeof(GMF_FILTER_STATISTICS));
+
+	// Start the stream trace (if it's enabled)
+	StartStreamTrace();
+
 	{
 		// Protect the filter options
 		CAutoLock optionlock(&m_csOptions);
@@ -1246,7 +3238,76 @@ CBaseParserFilter::CBaseParserFilter(
 		);
 		if (FAILED(hr))
 			*phr = hr;
+		m_bZeroCopy = TRUE; // Default value
+		hr = RegGetFilterOptionDWORD(
+			m_wszFilterName,
+			TEXT("Zero-Copy Delivery"),
+			(DWORD*)&m_bZeroCopy
+		);
+		if (FAILED(hr))
+			*phr = hr;
+		m_bMappedInput = TRUE; // Default value
+		hr = RegGetFilterOptionDWORD(
+			m_wszFilterName,
+			TEXT("Memory-Mapped Input"),
+			(DWORD*)&m_bMappedInput
+		);
+		if (FAILED(hr))
+			*phr = hr;
+		m_bReadAhead = TRUE; // Default value
+		hr = RegGetFilterOptionDWORD(
+			m_wszFilterName,
+			TEXT("Adaptive Read-Ahead"),
+			(DWORD*)&m_bReadAhead
+		);
+		if (FAILED(hr))
+			*phr = hr;
+		m_bChunkIndex = FALSE; // Default value
+		hr = RegGetFilterOptionDWORD(
+			m_wszFilterName,
+			TEXT("Chunk Index"),
+			(DWORD*)&m_bChunkIndex
+		);
+		if (FAILED(hr))
+			*phr = hr;
+		m_nTrickPlayRate = PARSER_TRICKPLAY_RATE; // Default value
+		hr = RegGetFilterOptionDWORD(
+			m_wszFilterName,
+			TEXT("Trick-Play Rate"),
+			(DWORD*)&m_nTrickPlayRate
+		);
+		if (FAILED(hr))
+			*phr = hr;
+
+		// The index directory is optional, so it's not an 
+		// error if it's absent (the sidecar index is used then)
+		TCHAR szIndexDirectory[MAX_PATH];
+		DWORD dwType = 0, cbIndexDirectory = sizeof(szIndexDirectory) - sizeof(TCHAR);
+		ZeroMemory(szIndexDirectory, sizeof(szIndexDirectory));
+		m_wszIndexDirectory[0] = 0;
+		hr = RegGetFilterOptionValue(
+			m_wszFilterName,
+			TEXT("Index Directory"),
+			&dwType,
+			(LPBYTE)szIndexDirectory,
+			&cbIndexDirectory
+		);
+		if (SUCCEEDED(hr) && (dwType == REG_SZ) && (szIndexDirectory[0] != 0)) {
+#ifdef UNICODE
+			lstrcpynW(m_wszIndexDirectory, szIndexDirectory, MAX_PATH);
+#else
+			if (!MultiByteToWideChar(CP_ACP, 0, szIndexDirectory, -1, m_wszIndexDirectory, MAX_PATH))
+				m_wszIndexDirectory[0] = 0;
+#endif
+		}
 	}
+
+	// Create the reference allocator
+	m_pReferenceAllocator = new CParserReferenceAllocator(phr);
+	if (m_pReferenceAllocator == NULL)
+		*phr = E_OUTOFMEMORY;
+	else
+		m_pReferenceAllocator->AddRef();
 }
 
 CBaseParserFilter::~CBaseParserFilter()
@@ -1273,7 +3334,52 @@ CBaseParserFilter::~CBaseParserFilter()
 			(LPBYTE)&m_nInputBuffers,
 			sizeof(long)
 		);
+		RegSetFilterOptionValue(
+			m_wszFilterName,
+			TEXT("Zero-Copy Delivery"),
+			REG_DWORD,
+			(LPBYTE)&m_bZeroCopy,
+			sizeof(BOOL)
+		);
+		RegSetFilterOptionValue(
+			m_wszFilterName,
+			TEXT("Memory-Mapped Input"),
+			REG_DWORD,
+			(LPBYTE)&m_bMappedInput,
+			sizeof(BOOL)
+		);
+		RegSetFilterOptionValue(
+			m_wszFilterName,
+			TEXT("Adaptive Read-Ahead"),
+			REG_DWORD,
+			(LPBYTE)&m_bReadAhead,
+			sizeof(BOOL)
+		);
+		RegSetFilterOptionValue(
+			m_wszFilterName,
+			TEXT("Chunk Index"),
+			REG_DWORD,
+			(LPBYTE)&m_bChunkIndex,
+			sizeof(BOOL)
+		);
+		RegSetFilterOptionValue(
+			m_wszFilterName,
+			TEXT("Trick-Play Rate"),
+			REG_DWORD,
+			(LPBYTE)&m_nTrickPlayRate,
+			sizeof(long)
+		);
+	}
+
+	// Release the reference allocator (the reference samples still 
+	// held downstream keep it alive until they're released)
+	if (m_pReferenceAllocator) {
+		m_pReferenceAllocator->Release();
+		m_pReferenceAllocator = NULL;
 	}
+
+	// Stop the stream trace (if this is the last filter)
+	StopStreamTrace();
 }
 
 STDMETHODIMP CBaseParserFilter::NonDelegatingQueryInterface(REFIID riid, void **ppv)
@@ -1282,12 +3388,17 @@ STDMETHODIMP CBaseParserFilter::NonDelegatingQueryInterface(REFIID riid, void **
 	CheckPointer(ppv, E_POINTER);
 	ValidateReadWritePtr(ppv, sizeof(PVOID));
 
-	// Expose IAMMediaContent, IConfigBaseParser, ISpecifyPropertyPages 
-	// (and the base-class interfaces)
+	// Expose IAMMediaContent, IConfigBaseParser, IConfigTrickPlay,
+	// IFilterStatistics, ISpecifyPropertyPages (and the base-class 
+	// interfaces)
 	if (riid == IID_IAMMediaContent)
 		return GetInterface((IAMMediaContent*)this, ppv);
 	else if (riid == IID_IConfigBaseParser)
 		return GetInterface((IConfigBaseParser*)this, ppv);
+	else if (riid == IID_IConfigTrickPlay)
+		return GetInterface((IConfigTrickPlay*)this, ppv);
+	else if (riid == IID_IFilterStatistics)
+		return GetInterface((IFilterStatistics*)this, ppv);
 	else if (riid == IID_ISpecifyPropertyPages)
 		return GetInterface((ISpecifyPropertyPages*)this, ppv);
 	else
@@ -1697,6 +3808,9 @@ HRESULT CBaseParserFilter::Shutdown(void)
 		m_cbInputBuffer		= 0;
 		m_cbInputAlign		= 1;
 	}
+
+	// Forget the chunk index of the file
+	m_ChunkIndex.Close();
 	
 	return NOERROR;
 }
@@ -1743,6 +3857,19 @@ CBasePin* CBaseParserFilter::GetPin(int n)
 	}
 }
 
+int CBaseParserFilter::GetOutputPinIndex(LPCWSTR pPinName)
+{
+	// Protect the output pins state
+	CAutoLock pinlock(&m_csPins);
+
+	for (int i = 0; i < m_nOutputPins; i++) {
+		if ((m_ppOutputPin[i]) && (!lstrcmpW(pPinName, m_ppOutputPin[i]->Name())))
+			return i;
+	}
+
+	return -1;
+}
+
 BOOL CBaseParserFilter::IsFlushing(void)
 {
 	return m_InputPin.IsFlushing();
@@ -1778,6 +3905,102 @@ HRESULT CBaseParserFilter::AlterQuality(LPCWSTR pPinName, Quality q)
 	return S_FALSE;
 }
 
+HRESULT CBaseParserFilter::ConvertPosition(
+	LONGLONG *pllTarget,
+	LPCWSTR pPinName,
+	const GUID *pSourceFormat,
+	LONGLONG *pllSource,
+	DWORD dwSourceFlags
+)
+{
+	// Without the chunk index we cannot convert anything
+	int iStream = GetOutputPinIndex(pPinName);
+	PARSER_INDEX_ENTRY entry;
+	HRESULT hr = m_ChunkIndex.GetEndEntry(iStream, &entry);
+	if (FAILED(hr))
+		return E_NOTIMPL;
+
+	// The positions at or beyond the stream end (e.g. the default 
+	// stop position) are converted to the default stop position
+	LONGLONG llEnd = 0;
+	hr = ConvertTimeFormat(
+		pPinName,
+		&llEnd,
+		pSourceFormat,
+		entry.rtTime,
+		&TIME_FORMAT_MEDIA_TIME
+	);
+	if (FAILED(hr))
+		return hr;
+	if (*pllSource >= llEnd) {
+		*pllTarget = m_llDefaultStop;
+		return NOERROR;
+	}
+
+	// Convert the position to the stream time
+	REFERENCE_TIME rtSource = 0;
+	hr = ConvertTimeFormat(
+		pPinName,
+		&rtSource,
+		&TIME_FORMAT_MEDIA_TIME,
+		*pllSource,
+		pSourceFormat
+	);
+	if (FAILED(hr))
+		return hr;
+
+	// Without the keyframe requirement (that's usually the stop 
+	// position) take the chunk of the first sample at or after 
+	// the position -- all the preceding samples are parsed then
+	if (!(dwSourceFlags & AM_SEEKING_SeekToKeyFrame)) {
+		hr = m_ChunkIndex.FindEntry(iStream, rtSource, &entry);
+		if (FAILED(hr))
+			return hr;
+		*pllTarget = entry.llPosition;
+		return NOERROR;
+	}
+
+	// Find the keyframe to start from
+	hr = m_ChunkIndex.FindKeyEntry(iStream, rtSource, &entry);
+	if (FAILED(hr))
+		return hr;
+
+	// Return the file position of the keyframe chunk
+	*pllTarget = entry.llPosition;
+
+	// Convert the keyframe time to source time format
+	// so that the caller knows actual seek point
+	hr = ConvertTimeFormat(
+		pPinName,
+		pllSource,
+		pSourceFormat,
+		entry.rtTime,
+		&TIME_FORMAT_MEDIA_TIME
+	);
+	if (FAILED(hr))
+		return hr;
+
+	// Protect the output pins state
+	CAutoLock pinlock(&m_csPins);
+
+	// The other streams continue from their first samples in the 
+	// keyframe chunk or after it, so their stream times are set 
+	// relative to the keyframe to keep them in sync
+	for (int i = 0; i < m_nOutputPins; i++) {
+		PARSER_INDEX_ENTRY other;
+		if (
+			(i == iStream)	||
+			(FAILED(m_ChunkIndex.FindPositionEntry(i, entry.llPosition, &other)))
+		)
+			continue;
+		m_ppOutputPin[i]->SetTime(other.rtTime - entry.rtTime);
+		m_ppOutputPin[i]->SetMediaTime(other.llMediaTime);
+		m_ppOutputPin[i]->SetDiscontinuity(TRUE);
+	}
+
+	return NOERROR;
+}
+
 HRESULT CBaseParserFilter::SetPositions(
 	LPCWSTR pPinName,
 	const GUID *pCurrentFormat,
@@ -1800,14 +4023,15 @@ HRESULT CBaseParserFilter::SetPositions(
 			return E_NOTIMPL;
 	}
 
-	// Convert the current position to file position
+	// Convert the current position to file position (the 
+	// playback should start from a keyframe)
 	LONGLONG llCurrent = 0;
 	HRESULT hr = ConvertPosition(
 		&llCurrent,
 		pPinName,
 		pCurrentFormat,
 		pllCurrent,
-		dwCurrentFlags
+		dwCurrentFlags | AM_SEEKING_SeekToKeyFrame
 	);
 	if (FAILED(hr))
 		return hr;
@@ -1870,7 +4094,41 @@ HRESULT CBaseParserFilter::SetRate(
 
 	// Deliver NewSegment() downstream and set rate for the 
 	// filter's output pins
-	return NewSegment(rtCurrent, rtStop, dRate);
+	HRESULT hr = NewSegment(rtCurrent, rtStop, dRate);
+	if (FAILED(hr))
+		return hr;
+
+	// Scope for the locking
+	{
+		// Protect the filter data
+		CAutoLock datalock(&m_csData);
+
+		// Remember the rate for the trick-play mode
+		m_dRate = dRate;
+	}
+
+	return NOERROR;
+}
+
+HRESULT CBaseParserFilter::GetDuration(
+	LPCWSTR pPinName,
+	const GUID *pCurrentFormat,
+	LONGLONG *pDuration
+)
+{
+	// The stream end entry of the chunk index holds the duration
+	PARSER_INDEX_ENTRY entry;
+	HRESULT hr = m_ChunkIndex.GetEndEntry(GetOutputPinIndex(pPinName), &entry);
+	if (FAILED(hr))
+		return E_NOTIMPL;
+
+	return ConvertTimeFormat(
+		pPinName,
+		pDuration,
+		pCurrentFormat,
+		entry.rtTime,
+		&TIME_FORMAT_MEDIA_TIME
+	);
 }
 
 HRESULT CBaseParserFilter::GetPreroll(
@@ -1936,12 +4194,42 @@ HRESULT CBaseParserFilter::Receive(IMediaSample *pSample)
 	if (llDataStart >= llDataStop)
 		return NOERROR;
 
+	LONGLONG llStartTime = GetStatisticsTime();
+
+	// Let the output pins reference the input sample data
+	m_pInputSample	= pSample;
+	m_pbInputData	= pbData;
+	m_llInputStart	= llStart;
+	m_llInputStop	= llStop;
+
 	// Delegate actual parsing to another Receive()
-	return Receive(
+	hr = Receive(
 		llDataStart,
 		pbData + llDataStart - llStart,
 		(LONG)(llDataStop - llDataStart)
 	);
+
+	// The input sample is not parsed any more
+	m_pInputSample	= NULL;
+	m_pbInputData	= NULL;
+
+	LONGLONG llProcessingTime = GetStatisticsTime() - llStartTime;
+
+	// Scope for the locking
+	{
+		// Protect the statistics
+		CAutoLock statlock(&m_csStatistics);
+
+		// Update the input counters. S_FALSE means that the 
+		// parser has rejected (the rest of) the data
+		m_Statistics.llSamplesReceived++;
+		m_Statistics.llBytesReceived	+= llDataStop - llDataStart;
+		m_Statistics.llProcessingTime	+= llProcessingTime;
+		if (hr == S_FALSE)
+			m_Statistics.llSamplesRejected++;
+	}
+
+	return hr;
 }
 
 STDMETHODIMP CBaseParserFilter::Stop(void)
@@ -1976,6 +4264,10 @@ STDMETHODIMP CBaseParserFilter::Stop(void)
 
 HRESULT CBaseParserFilter::BeginFlush(void)
 {
+	// The flush breaks the full pass over the file, 
+	// so the chunk index cannot be recorded
+	m_ChunkIndex.CancelRecording();
+
 	// Protect the output pins state
 	CAutoLock pinlock(&m_csPins);
 
@@ -2029,6 +4321,10 @@ HRESULT CBaseParserFilter::NewSegment(
 	// we should lock it
 	CAutoLock lock(&m_csReceive);
 
+	// The chunk index is recorded at the normal rate only
+	if (dRate != 1.0)
+		m_ChunkIndex.CancelRecording();
+
 	// Protect the output pins state
 	CAutoLock pinlock(&m_csPins);
 
@@ -2053,26 +4349,87 @@ HRESULT CBaseParserFilter::NewSegment(
 
 HRESULT CBaseParserFilter::EndOfStream(void)
 {
+	BOOL bComplete;
+	LONGLONG llEndPosition;
+
+	// Scope for the locking
+	{
+		// Protect the filter data
+		CAutoLock datalock(&m_csData);
+
+		bComplete		= (m_llStopPosition >= m_llDefaultStop);
+		llEndPosition	= m_llDefaultStop;
+	}
+
+	// If the whole file has been parsed, the chunk index is 
+	// complete (the failure to save it is not an error)
+	if (bComplete)
+		m_ChunkIndex.FinishRecording(llEndPosition);
+	else
+		m_ChunkIndex.CancelRecording();
+
 	// Protect the output pins state
 	CAutoLock pinlock(&m_csPins);
 
-	// Loop through all output pins and deliver EndOfStream() downstream
-	for (int i = 0; i < m_nOutputPins; i++) {
-		ASSERT(m_ppOutputPin[i]);
-		HRESULT hr = m_ppOutputPin[i]->DeliverEndOfStream();
-		if (FAILED(hr))
-			return hr;
+	// Loop through all output pins and deliver EndOfStream() downstream
+	for (int i = 0; i < m_nOutputPins; i++) {
+		ASSERT(m_ppOutputPin[i]);
+		HRESULT hr = m_ppOutputPin[i]->DeliverEndOfStream();
+		if (FAILED(hr))
+			return hr;
+	}
+
+	return NOERROR;
+}
+
+BOOL CBaseParserFilter::IsSyncInput(void)
+{
+	// Protect the filter options
+	CAutoLock optionlock(&m_csOptions);
+
+	return m_bSyncInput;
+}
+
+BOOL CBaseParserFilter::IsMappedInput(void)
+{
+	// Protect the filter options
+	CAutoLock optionlock(&m_csOptions);
+
+	return m_bMappedInput;
+}
+
+BOOL CBaseParserFilter::IsAdaptiveReadAhead(void)
+{
+	// Protect the filter options
+	CAutoLock optionlock(&m_csOptions);
+
+	return m_bReadAhead;
+}
+
+BOOL CBaseParserFilter::IsTrickPlay(void)
+{
+	long nTrickPlayRate;
+
+	// Scope for the locking
+	{
+		// Protect the filter options
+		CAutoLock optionlock(&m_csOptions);
+
+		// The scrub turns the trick-play mode on at any rate
+		if (m_bScrub)
+			return TRUE;
+
+		nTrickPlayRate = m_nTrickPlayRate;
 	}
 
-	return NOERROR;
-}
+	// Check if the rate-triggered trick-play mode is disabled
+	if (nTrickPlayRate <= 0)
+		return FALSE;
 
-BOOL CBaseParserFilter::IsSyncInput(void)
-{
-	// Protect the filter options
-	CAutoLock optionlock(&m_csOptions);
+	// Protect the filter data
+	CAutoLock datalock(&m_csData);
 
-	return m_bSyncInput;
+	return (m_dRate * 100. >= (double)nTrickPlayRate);
 }
 
 HRESULT CBaseParserFilter::GetInputAllocatorProperties(ALLOCATOR_PROPERTIES *pRequest)
@@ -2084,15 +4441,88 @@ HRESULT CBaseParserFilter::GetInputAllocatorProperties(ALLOCATOR_PROPERTIES *pRe
 	// Protect the filter options
 	CAutoLock optionlock(&m_csOptions);
 
-	// Fill the properties by the stored values
+	// Fill the properties by the stored values. For the zero-copy
+	// delivery request more buffers, so that they can be lent to 
+	// the reference samples
 	pRequest->cbAlign	= m_cbInputAlign;
-	pRequest->cBuffers	= m_nInputBuffers;
+	pRequest->cBuffers	= m_nInputBuffers + ((m_bZeroCopy) ? PARSER_LOANED_BUFFERS : 0);
 	pRequest->cbBuffer	= m_cbInputBuffer;
 	pRequest->cbPrefix	= 0;
 
 	return NOERROR;
 }
 
+HRESULT CBaseParserFilter::ActivateReferenceAllocator(IMemAllocator *pInputAllocator)
+{
+	// Check the pointer
+	CheckPointer(pInputAllocator, E_POINTER);
+
+	// Scope for the locking
+	{
+		// Protect the filter options
+		CAutoLock optionlock(&m_csOptions);
+
+		// Check if the zero-copy delivery is enabled
+		if (!m_bZeroCopy)
+			return NOERROR;
+	}
+
+	if (m_pReferenceAllocator == NULL)
+		return NOERROR;
+
+	// Get the number of the input buffers
+	ALLOCATOR_PROPERTIES apInput;
+	HRESULT hr = pInputAllocator->GetProperties(&apInput);
+	if (FAILED(hr))
+		return hr;
+
+	// The pullpin needs two buffers for itself (the one being read 
+	// and the one being parsed), the rest of them can be lent. The
+	// mapped reader needs just one, but keep it the same
+	LONG nMaxLoans = apInput.cBuffers - 2;
+	if (nMaxLoans <= 0)
+		return NOERROR;
+
+	return m_pReferenceAllocator->Activate(PARSER_REFERENCE_SAMPLES, nMaxLoans);
+}
+
+HRESULT CBaseParserFilter::DeactivateReferenceAllocator(void)
+{
+	if (m_pReferenceAllocator == NULL)
+		return NOERROR;
+
+	// The reference samples still held downstream complete the 
+	// decommit when they're released
+	return m_pReferenceAllocator->Decommit();
+}
+
+HRESULT CBaseParserFilter::GetReferenceSample(
+	LONGLONG llPosition,
+	LONG lDataSize,
+	IMediaSample **ppSample
+)
+{
+	// Only the data lying completely within the input 
+	// sample being parsed can be referenced
+	if (
+		(m_pInputSample			== NULL)			||
+		(m_pReferenceAllocator	== NULL)			||
+		(lDataSize				<= 0)				||
+		(llPosition				< m_llInputStart)	||
+		(llPosition + lDataSize	> m_llInputStop)
+	)
+		return S_FALSE;
+
+	// The allocator returns S_FALSE if it's not active 
+	// or there's no reference sample available
+	return m_pReferenceAllocator->GetReferenceSample(
+		m_pInputSample,
+		m_pbInputData + (llPosition - m_llInputStart),
+		lDataSize,
+		ppSample
+	);
+}
+
 STDMETHODIMP CBaseParserFilter::GetOutputPinCount(int *pnCount)
 {
 	// Check and validate the pointer
@@ -2332,6 +4762,369 @@ STDMETHODIMP CBaseParserFilter::put_BatchExact(int iPin, BOOL bBatchExact)
 	return NOERROR;
 }
 
+STDMETHODIMP CBaseParserFilter::get_TrickPlayRate(long *pnPercent)
+{
+	// Check and validate the pointer
+	CheckPointer(pnPercent, E_POINTER);
+	ValidateWritePtr(pnPercent, sizeof(long));
+
+	// Protect the filter options
+	CAutoLock optionlock(&m_csOptions);
+
+	*pnPercent = m_nTrickPlayRate;
+
+	return NOERROR;
+}
+
+STDMETHODIMP CBaseParserFilter::get_Scrub(BOOL *pbScrub)
+{
+	// Check and validate the pointer
+	CheckPointer(pbScrub, E_POINTER);
+	ValidateWritePtr(pbScrub, sizeof(BOOL));
+
+	// Protect the filter options
+	CAutoLock optionlock(&m_csOptions);
+
+	*pbScrub = m_bScrub;
+
+	return NOERROR;
+}
+
+STDMETHODIMP CBaseParserFilter::put_TrickPlayRate(long nPercent)
+{
+	// Check if the rate is acceptable
+	if (nPercent < 0)
+		return E_INVALIDARG;
+
+	// Protect the filter options
+	CAutoLock optionlock(&m_csOptions);
+
+	m_nTrickPlayRate = nPercent;
+
+	return NOERROR;
+}
+
+STDMETHODIMP CBaseParserFilter::put_Scrub(BOOL bScrub)
+{
+	// The frames skipped during the scrub would be missing 
+	// from the chunk index, so give up the recording
+	if (bScrub)
+		m_ChunkIndex.CancelRecording();
+
+	// Protect the filter options
+	CAutoLock optionlock(&m_csOptions);
+
+	m_bScrub = bScrub;
+
+	return NOERROR;
+}
+
+STDMETHODIMP CBaseParserFilter::GetStatistics(GMF_FILTER_STATISTICS *pStatistics)
+{
+	// Check and validate the pointer
+	CheckPointer(pStatistics, E_POINTER);
+	ValidateWritePtr(pStatistics, sizeof(GMF_FILTER_STATISTICS));
+
+	// Scope for the locking
+	{
+		// Protect the statistics
+		CAutoLock statlock(&m_csStatistics);
+
+		*pStatistics = m_Statistics;
+	}
+
+	// Protect the output pins state
+	CAutoLock pinlock(&m_csPins);
+
+	// Sum up the output pin counters
+	for (int i = 0; i < m_nOutputPins; i++) {
+
+		ASSERT(m_ppOutputPin[i]);
+
+		GMF_PIN_STATISTICS PinStatistics;
+		m_ppOutputPin[i]->GetStatistics(&PinStatistics);
+
+		pStatistics->llSamplesDelivered		+= PinStatistics.llSamplesDelivered;
+		pStatistics->llDeliveryTime			+= PinStatistics.llDeliveryTime;
+		pStatistics->llAllocatorWaits		+= PinStatistics.llAllocatorWaits;
+		pStatistics->llAllocatorWaitTime	+= PinStatistics.llAllocatorWaitTime;
+	}
+
+	return NOERROR;
+}
+
+STDMETHODIMP CBaseParserFilter::GetOutputPinStatistics(int iPin, GMF_PIN_STATISTICS *pStatistics)
+{
+	// Check and validate the pointer
+	CheckPointer(pStatistics, E_POINTER);
+	ValidateWritePtr(pStatistics, sizeof(GMF_PIN_STATISTICS));
+
+	// Protect the output pins state
+	CAutoLock pinlock(&m_csPins);
+
+	// Check if the pin index is acceptable
+	if ((iPin < 0) || (iPin >= m_nOutputPins))
+		return E_INVALIDARG;
+
+	m_ppOutputPin[iPin]->GetStatistics(pStatistics);
+
+	return NOERROR;
+}
+
+STDMETHODIMP CBaseParserFilter::GetChunkTypeCount(int *pnCount)
+{
+	// Check and validate the pointer
+	CheckPointer(pnCount, E_POINTER);
+	ValidateWritePtr(pnCount, sizeof(int));
+
+	// Protect the statistics
+	CAutoLock statlock(&m_csStatistics);
+
+	*pnCount = m_nChunkTypes;
+
+	return NOERROR;
+}
+
+STDMETHODIMP CBaseParserFilter::GetChunkStatistics(int iType, GMF_CHUNK_STATISTICS *pStatistics)
+{
+	// Check and validate the pointer
+	CheckPointer(pStatistics, E_POINTER);
+	ValidateWritePtr(pStatistics, sizeof(GMF_CHUNK_STATISTICS));
+
+	// Protect the statistics
+	CAutoLock statlock(&m_csStatistics);
+
+	// Check if the chunk type index is acceptable
+	if ((iType < 0) || (iType >= m_nChunkTypes))
+		return E_INVALIDARG;
+
+	*pStatistics = m_ChunkStatistics[iType];
+
+	return NOERROR;
+}
+
+STDMETHODIMP CBaseParserFilter::ResetStatistics(void)
+{
+	// Scope for the locking
+	{
+		// Protect the statistics
+		CAutoLock statlock(&m_csStatistics);
+
+		ZeroMemory(&m_Statistics, sizeof(GMF_FILTER_STATISTICS));
+		m_nChunkTypes = 0;
+	}
+
+	// Protect the output pins state
+	CAutoLock pinlock(&m_csPins);
+
+	// Reset the output pin counters
+	for (int i = 0; i < m_nOutputPins; i++) {
+		ASSERT(m_ppOutputPin[i]);
+		m_ppOutputPin[i]->ResetStatistics();
+	}
+
+	return NOERROR;
+}
+
+void CBaseParserFilter::UpdateChunkStatistics(DWORD dwChunkType, LONGLONG llBytes)
+{
+	// Protect the statistics
+	CAutoLock statlock(&m_csStatistics);
+
+	// Look up the chunk type in the table
+	int i;
+	for (i = 0; i < m_nChunkTypes; i++) {
+		if (m_ChunkStatistics[i].dwChunkType == dwChunkType)
+			break;
+	}
+
+	// Add the new chunk type if there's room for it
+	if (i == m_nChunkTypes) {
+		if (m_nChunkTypes == GMF_STATISTICS_MAX_CHUNK_TYPES)
+			return;
+		m_ChunkStatistics[i].dwChunkType	= dwChunkType;
+		m_ChunkStatistics[i].llChunks		= 0;
+		m_ChunkStatistics[i].llBytes		= 0;
+		m_nChunkTypes++;
+	}
+
+	m_ChunkStatistics[i].llChunks++;
+	m_ChunkStatistics[i].llBytes += llBytes;
+}
+
+LONG CBaseParserFilter::GetAverageChunkSize(void)
+{
+	// Protect the statistics
+	CAutoLock statlock(&m_csStatistics);
+
+	// Sum up the chunks of all types
+	LONGLONG llChunks = 0, llBytes = 0;
+	for (int i = 0; i < m_nChunkTypes; i++) {
+		llChunks	+= m_ChunkStatistics[i].llChunks;
+		llBytes		+= m_ChunkStatistics[i].llBytes;
+	}
+
+	return (llChunks > 0) ? (LONG)(llBytes / llChunks) : 0;
+}
+
+void CBaseParserFilter::UpdateStallStatistics(LONGLONG llStallTime)
+{
+	// Protect the statistics
+	CAutoLock statlock(&m_csStatistics);
+
+	m_Statistics.llInputStallTime += llStallTime;
+	if (llStallTime > GMF_STATISTICS_WAIT_THRESHOLD)
+		m_Statistics.llInputStalls++;
+}
+
+HRESULT CBaseParserFilter::OpenChunkIndex(IPin *pPin)
+{
+	// Check the pointer
+	CheckPointer(pPin, E_POINTER);
+
+	WCHAR wszIndexDirectory[MAX_PATH];
+
+	// Scope for the locking
+	{
+		// Protect the filter options
+		CAutoLock optionlock(&m_csOptions);
+
+		if (!m_bChunkIndex)
+			return S_FALSE;
+
+		lstrcpynW(wszIndexDirectory, m_wszIndexDirectory, MAX_PATH);
+	}
+
+	// Find out the file the upstream filter reads
+	LPOLESTR pszFileName = NULL;
+	HRESULT hr = GetSourceFileName(pPin, &pszFileName);
+	if (hr != S_OK)
+		return S_FALSE;
+
+	// Load the index or get ready to record it
+	hr = m_ChunkIndex.Open(pszFileName, wszIndexDirectory, m_clsid);
+	CoTaskMemFree(pszFileName);
+
+	return hr;
+}
+
+void CBaseParserFilter::CloseChunkIndex(void)
+{
+	m_ChunkIndex.Close();
+}
+
+LONG CBaseParserFilter::GetIndexMaxChunkSize(void)
+{
+	return m_ChunkIndex.GetMaxChunkSize();
+}
+
+void CBaseParserFilter::StartIndexRecording(void)
+{
+	// Scope for the locking
+	{
+		// Protect the filter data
+		CAutoLock datalock(&m_csData);
+
+		// The index is recorded along the full pass over the file only
+		if (m_llStartPosition != m_llDefaultStart)
+			return;
+	}
+
+	// Scope for the locking
+	{
+		// Protect the output pins state
+		CAutoLock pinlock(&m_csPins);
+
+		// The sample times are scaled at the rates other than normal
+		if ((m_nOutputPins > 0) && (m_ppOutputPin[0]->CurrentRate() != 1.0))
+			return;
+	}
+
+	// No chunk parsed yet
+	m_nChunkDepth		= 0;
+	m_llIndexPosition	= -1;
+	m_dwIndexChunkType	= 0;
+
+	m_ChunkIndex.StartRecording();
+}
+
+void CBaseParserFilter::StopIndexRecording(void)
+{
+	m_ChunkIndex.CancelRecording();
+}
+
+void CBaseParserFilter::UpdateChunkIndex(LONGLONG llPosition, BOOL bCountChunk, DWORD dwChunkType)
+{
+	// Only the outer chunks are the points to resume parsing from
+	if (m_nChunkDepth == 0) {
+		m_llIndexPosition = llPosition;
+		m_ChunkIndex.RecordChunk(llPosition);
+	}
+
+	// The samples are attributed to the innermost counted chunk
+	if (bCountChunk)
+		m_dwIndexChunkType = dwChunkType;
+}
+
+void CBaseParserFilter::RecordIndexSample(CParserOutputPin *pPin, IMediaSample *pSample)
+{
+	// The samples not parsed from the chunks cannot be indexed
+	if (m_llIndexPosition < 0)
+		return;
+
+	// The output pins do not change while the filter is active,
+	// so there's no need to lock the pins state here
+	for (int i = 0; i < m_nOutputPins; i++) {
+		if (m_ppOutputPin[i] == pPin) {
+			m_ChunkIndex.RecordSample(i, m_llIndexPosition, m_dwIndexChunkType, pSample);
+			break;
+		}
+	}
+}
+
+BOOL CBaseParserFilter::IsIndexRecording(void)
+{
+	return m_ChunkIndex.IsRecording();
+}
+
+void CBaseParserFilter::MarkIndexKeyFrame(CParserOutputPin *pPin, LONGLONG llPosition)
+{
+	// Take the current outer chunk if the position is not given
+	if (llPosition < 0)
+		llPosition = m_llIndexPosition;
+	if (llPosition < 0)
+		return;
+
+	// The output pins do not change while the filter is active,
+	// so there's no need to lock the pins state here
+	for (int i = 0; i < m_nOutputPins; i++) {
+		if (m_ppOutputPin[i] == pPin) {
+			m_ChunkIndex.MarkKeyEntry(i, llPosition);
+			break;
+		}
+	}
+}
+
+DWORD CBaseParserFilter::GetIndexCapabilities(LPCWSTR pPinName)
+{
+	int iStream = GetOutputPinIndex(pPinName);
+
+	// The index knows the duration of each stream it has
+	PARSER_INDEX_ENTRY entry;
+	if (FAILED(m_ChunkIndex.GetEndEntry(iStream, &entry)))
+		return 0;
+	DWORD dwCapabilities = AM_SEEKING_CanGetDuration;
+
+	// Seeking is done on the first pin and it's of any use only 
+	// if there are keyframes to seek to besides the first one
+	if ((iStream == 0) && (m_ChunkIndex.IsSeekable(0)))
+		dwCapabilities |=	AM_SEEKING_CanSeekAbsolute	|
+							AM_SEEKING_CanSeekForwards	|
+							AM_SEEKING_CanSeekBackwards;
+
+	return dwCapabilities;
+}
+
 STDMETHODIMP CBaseParserFilter::GetPages(CAUUID *pPages)
 {
 	// Check and validate the pointer
@@ -3597,7 +6390,8 @@ STDMETHODIMP CParserSeeking::GetCapabilities(DWORD *pCapabilities)
 	CheckPointer(pCapabilities, E_POINTER);
 	ValidateWritePtr(pCapabilities, sizeof(DWORD));
 
-	*pCapabilities = m_dwCapabilities;
+	// Add the capabilities the chunk index provides
+	*pCapabilities = m_dwCapabilities | m_pFilter->GetIndexCapabilities(m_pPin->Name());
 
 	return NOERROR;
 }
@@ -3610,7 +6404,7 @@ STDMETHODIMP CParserSeeking::CheckCapabilities(DWORD *pCapabilities)
 
 	// Test the requested capabilities against the available ones
 	DWORD dwRequestedCaps = *pCapabilities;
-	*pCapabilities &= m_dwCapabilities;
+	*pCapabilities &= m_dwCapabilities | m_pFilter->GetIndexCapabilities(m_pPin->Name());
 
 	// Work out a return value
 	if (*pCapabilities == dwRequestedCaps) {
@@ -33,8 +33,60 @@
 #include <tchar.h>
 
 #include "BaseParserConfig.h"
+#include "FilterStatistics.h"
+#include "StreamTrace.h"
+#include "ChunkIndex.h"
+#include "FileTypePatterns.h"
 
 class CParserInputPin;
+class CBaseParserFilter;
+
+// Number of reference samples (see CParserReferenceAllocator)
+#define PARSER_REFERENCE_SAMPLES	64
+
+// Maximum number of input samples lent to the reference samples
+#define PARSER_MAX_LOANS			16
+
+// Number of input buffers requested additionally to the configured
+// ones when the zero-copy delivery is enabled (these are the buffers 
+// which can be lent to the reference samples)
+#define PARSER_LOANED_BUFFERS		4
+
+// Maximum size of the file which is mapped as a whole for the
+// memory-mapped input (larger files are read by the pullpin)
+#define PARSER_MAX_MAPPED_SIZE		0x10000000
+
+// Maximum number of the read requests kept in flight by the read-ahead
+#define PARSER_MAX_REQUESTS			32
+
+// Number of average chunks the read-ahead puts into one request
+#define PARSER_CHUNKS_PER_REQUEST	4
+
+// Minimum size of a read-ahead request
+#define PARSER_MIN_REQUEST_SIZE		0x4000
+
+// Number of requests collected without a stall after which 
+// the read-ahead halves the request size grown by the stalls
+#define PARSER_QUIET_REQUESTS		16
+
+// Number of entries in the output queue ring (must be a power of two).
+// That's more than the samples a pin can have outstanding (the pin's
+// own buffers plus the reference samples), so the producer blocks on
+// a full ring only if the control packets pile up
+#define PARSER_QUEUE_SIZE			256
+
+// Number of buffers of the output pin's oversize allocator (see 
+// CParserOutputPin::GetChunkBuffer())
+#define PARSER_OVERSIZE_BUFFERS		2
+
+// Granularity of the oversize allocator buffer size (the size is 
+// rounded up, so that a slightly larger chunk does not make the
+// allocator grow once again)
+#define PARSER_OVERSIZE_GRANULARITY	0x10000
+
+// Default playback rate (in percent) from which the trick-play
+// mode is on (see CBaseParserFilter::IsTrickPlay())
+#define PARSER_TRICKPLAY_RATE		200
 
 //==========================================================================
 // Helper class for pulling input pin
@@ -65,12 +117,248 @@ protected:
 	CParserInputPin *m_pParentPin; // Parent pin using this pullpin
 };
 
-class CBaseParserFilter;
+//==========================================================================
+// Mapped file allocator class
+//
+// Allocator of the samples pointing into the view of the whole input 
+// file. The view is mapped when the allocator is committed and unmapped
+// when it's decommitted and all its samples are back (the samples lent
+// to the reference samples may well outlive the decommit)
+//==========================================================================
+
+class CParserMappedAllocator : public CBaseAllocator
+{
+
+	HANDLE m_hMapping;		// File mapping object
+	BYTE *m_pbView;			// View of the whole file (NULL if not mapped)
+	LONGLONG m_llFileSize;	// File size
+
+public:
+
+	CParserMappedAllocator(HRESULT *phr);
+	~CParserMappedAllocator();
+
+	// Create the mapping object for the file. The file size should 
+	// match the one reported by the upstream filter, otherwise it's 
+	// not the file the upstream filter reads
+	HRESULT Open(LPCWSTR pszFileName, LONGLONG llFileSize);
+
+	// Close the mapping object (the view stays valid until unmapped)
+	void Close(void);
+
+	// Get the sample pointing to the file data. Waits for a free 
+	// sample just as GetBuffer() does
+	HRESULT GetSlice(
+		LONGLONG llPosition,		// File position of the data
+		LONG lDataSize,				// Size of the data
+		IMediaSample **ppSample		// Sample pointing to the data
+	);
+
+protected:
+
+	// Create the sample objects and map the view (Alloc()), unmap 
+	// the view (Free()) and delete the sample objects (ReallyFree())
+	HRESULT Alloc(void);
+	void Free(void);
+	void ReallyFree(void);
+
+};
+
+//==========================================================================
+// Base input reader thread class
+//
+// Alternative to the pullpin's worker thread. The thread control and 
+// the sample times are the same as those of CPullPin, but the derived
+// class decides how the data is obtained (see Process()). The input 
+// pin uses a reader thread instead of the pullpin's one when it's 
+// connected (the pullpin is still used to connect to the upstream 
+// IAsyncReader and decide on the allocator)
+//==========================================================================
+
+class CParserReaderThread : public CAMThread
+{
+
+public:
+
+	CParserReaderThread(CParserInputPin *pParentPin);
+	virtual ~CParserReaderThread();
+
+	// Is the reader used instead of the pullpin?
+	virtual BOOL IsConnected(void) PURE;
+
+	// Allocator of the samples delivered by the reader
+	virtual IMemAllocator* GetAllocator(void) PURE;
+
+	// Set the start and stop positions (in reference units)
+	HRESULT Seek(REFERENCE_TIME tStart, REFERENCE_TIME tStop);
+
+	// Start/stop delivering the samples
+	HRESULT Active(void);
+	HRESULT Inactive(void);
+
+protected:
+
+	enum ThreadMsg {
+		TM_Pause,	// Stop delivering and wait for next message
+		TM_Start,	// Start delivering
+		TM_Exit		// Stop and exit
+	};
+
+	// Thread control (see CPullPin)
+	DWORD ThreadProc(void);
+	HRESULT StartThread(void);
+	HRESULT PauseThread(void);
+	HRESULT StopThread(void);
+
+	// Make sure the thread is not blocked in Process() while it's
+	// asked to pause or exit (BeginUnblock()) and let it go on after
+	// that (EndUnblock()). Both are called on the controlling thread
+	virtual void BeginUnblock(void) PURE;
+	virtual void EndUnblock(void) PURE;
+
+	// Deliver the samples from the start to the stop position
+	// and the end of stream after them. Should return without
+	// the end of stream if the thread is asked to do something 
+	// else (CheckRequest()) or the parent pin fails the sample
+	virtual void Process(void) PURE;
+
+	// Clean up after Process() has returned (called on the thread)
+	virtual void Cleanup(void) {};
+
+	CParserInputPin *m_pParentPin;		// Parent pin using this reader
+	CCritSec m_csAccess;				// Thread control protection
+	ThreadMsg m_State;					// Thread state
+	REFERENCE_TIME m_tStart;			// Start position
+	REFERENCE_TIME m_tStop;				// Stop position
+};
+
+//==========================================================================
+// Helper class for memory-mapped input
+//
+// Reader thread for the files which can be mapped as a whole. Instead
+// of the read requests to peer's IAsyncReader the thread hands the 
+// slices of the file view (of the input buffer size) to the parent pin
+//==========================================================================
+
+class CParserMappedReader : public CParserReaderThread
+{
+
+public:
+
+	CParserMappedReader(CParserInputPin *pParentPin);
+	~CParserMappedReader();
+
+	// Map the file read by the upstream filter. The slice size and 
+	// count are taken from the pullpin's allocator properties. Returns 
+	// S_FALSE if the upstream filter does not read a file which can 
+	// be mapped (so the pullpin should be used)
+	HRESULT Connect(
+		IPin *pPin,						// Upstream output pin
+		IAsyncReader *pReader,			// Upstream IAsyncReader
+		ALLOCATOR_PROPERTIES *pProps	// Input allocator properties
+	);
+	HRESULT Disconnect(void);
+
+	// Is the file mapped?
+	BOOL IsConnected(void) { return (m_pAlloc != NULL); };
+
+	IMemAllocator* GetAllocator(void) { return m_pAlloc; };
+
+protected:
+
+	// The thread may only be blocked waiting for a free sample,
+	// so decommit the allocator to unblock it (StartThread() 
+	// commits it again)
+	void BeginUnblock(void);
+	void EndUnblock(void) {};
+
+	void Process(void);
+
+	CParserMappedAllocator *m_pAlloc;	// Allocator of the slices
+	LONGLONG m_llFileSize;				// File size
+	LONG m_cbSlice;						// Slice size
+};
+
+//==========================================================================
+// Helper class for adaptive read-ahead
+//
+// Reader thread which reads the data through peer's IAsyncReader 
+// (into the pullpin's allocator buffers) just as the pullpin does in 
+// the asynchronous mode, but keeps as many requests in flight as 
+// there are free input buffers and adapts the request size. The size 
+// follows the average chunk size reported by the parser (so that a 
+// request holds several chunks) and grows when the parser has to wait
+// for the data (to cut down the number of the requests on the slow 
+// media). The waits are reported as the input stalls
+//==========================================================================
+
+class CParserPrefetchReader : public CParserReaderThread
+{
+
+public:
+
+	CParserPrefetchReader(
+		CParserInputPin *pParentPin,	// Parent input pin
+		CBaseParserFilter *pFilter		// Parent filter (for the statistics)
+	);
+	~CParserPrefetchReader();
+
+	// Use the pullpin's reader and allocator
+	HRESULT Connect(IAsyncReader *pReader, IMemAllocator *pAlloc);
+	HRESULT Disconnect(void);
+
+	BOOL IsConnected(void) { return (m_pReader != NULL); };
+
+	IMemAllocator* GetAllocator(void) { return m_pAlloc; };
+
+protected:
+
+	// Flush the upstream reader, so that the thread is 
+	// not blocked in WaitForNext() (see CPullPin)
+	void BeginUnblock(void);
+	void EndUnblock(void);
+
+	void Process(void);
+
+	// Collect the requests cancelled by the flush
+	void Cleanup(void);
+
+	// Work out the size of the next request
+	LONG GetRequestSize(void);
+
+	// Queue the request for the next portion of the data
+	HRESULT QueueRequest(
+		IMediaSample *pSample,		// Empty sample to read into
+		LONGLONG *pllCurrent,		// Request position (advanced by the request size)
+		LONGLONG llAlignStop,		// Aligned stop position
+		BOOL bDiscontinuity			// Discontinuity flag for the sample
+	);
+
+	// Collect the oldest request (the requests may be completed 
+	// out of order, so the later ones are kept until it's done)
+	HRESULT CollectRequest(IMediaSample **ppSample);
+
+	CBaseParserFilter *m_pFilter;	// Parent filter
+	IAsyncReader *m_pReader;		// Upstream reader
+	IMemAllocator *m_pAlloc;		// Input allocator
+	LONGLONG m_llLength;			// File length
+	LONG m_cbAlign;					// Request alignment
+	LONG m_cbMaxRequest;			// Maximum request size (the buffer size)
+	LONG m_cbStallRequest;			// Request size grown by the stalls
+	int m_nQuietRequests;			// Requests collected since the last stall
+
+	// Requests in flight. The requests are numbered in the order 
+	// they're queued and collected in the same order
+	DWORD m_dwNextRequest;			// Number of the next request to queue
+	DWORD m_dwNextCollect;			// Number of the next request to collect
+	IMediaSample *m_pCompleted[PARSER_MAX_REQUESTS];	// Completed requests
+};
 
 //==========================================================================
 // Parser input pin class
 // 
-// Uses CParserPullPin to pull data from the upstream output pin,
+// Uses CParserPullPin to pull data from the upstream output pin
+// (or one of the reader threads instead of the pullpin's thread),
 // delegates Receive() to the parent filter and delivers streaming 
 // messages to all downstream output pins
 //==========================================================================
@@ -122,9 +410,29 @@ public:
 
 protected:
 
+	// Allocator of the samples delivered by the pullpin or 
+	// by the mapped reader (whichever is used)
+	IMemAllocator* GetInputAllocator(void);
+
 	CCritSec *m_pReceiveLock;	// Critical section protecting streaming state
 
 	CParserPullPin m_PullPin;	// Pullpin used by this input pin
+
+	// Reader thread used instead of the pullpin's one 
+	// (NULL if the pullpin's thread is used)
+	CParserReaderThread* GetReaderThread(void);
+
+	// Mapped reader used instead of the pullpin 
+	// if the input file has been mapped
+	CParserMappedReader m_MappedReader;
+
+	// Decommit the mapped reader's allocator when the activation 
+	// fails (so that the view is unmapped)
+	void DecommitMappedAllocator(void);
+
+	// Read-ahead reader used instead of the pullpin 
+	// in the asynchronous mode
+	CParserPrefetchReader m_PrefetchReader;
 };
 
 class CParserOutputPin;
@@ -228,10 +536,223 @@ protected:
 
 };
 
+//==========================================================================
+// Parser output queue class
+//
+// Replacement for COutputQueue which passes the samples from the
+// streaming thread to the queue thread through a single-producer/
+// single-consumer ring instead of the list guarded by the queue lock.
+// The producer (the streaming thread) and the consumer (the queue 
+// thread) only exchange the ring indices with the interlocked 
+// operations and signal each other through the events only when the 
+// other side is waiting, so handing a sample over costs no lock and 
+// (with a busy queue thread) no kernel call. The queue thread pops 
+// the samples in batches of up to lBatchSize and delivers them with
+// ReceiveMultiple(). The auto queue, batch size and batch exact 
+// semantics are the same as of COutputQueue.
+//
+// The producer calls (Receive(), EOS(), NewSegment() and EndFlush())
+// should be serialized by the caller; BeginFlush() can be called on 
+// any thread. When the stream trace is enabled, the downstream pin 
+// is wrapped to trace the deliveries done by the queue thread
+//==========================================================================
+
+class CParserOutputQueue
+{
+
+public:
+
+	CParserOutputQueue(
+		IPin *pInputPin,		// Pin to send stuff to
+		HRESULT *phr,			// Success or error code
+		BOOL bAuto,				// Ask pin if queue or not
+		BOOL bQueue,			// Send through queue
+		LONG lBatchSize,		// Batch size
+		BOOL bBatchExact,		// Batch exactly to BatchSize
+		LPCWSTR pName			// Output pin name (for the trace)
+	);
+	~CParserOutputQueue();
+
+	// Streaming methods (same as of COutputQueue)
+	HRESULT Receive(IMediaSample *pSample);
+	void EOS(void);
+	void BeginFlush(void);
+	void EndFlush(void);
+	void NewSegment(
+		REFERENCE_TIME tStart,
+		REFERENCE_TIME tStop,
+		double dRate
+	);
+
+	// Is the queue thread used?
+	BOOL IsQueued(void);
+
+	// Number of samples queued or batched but not yet delivered
+	LONG GetQueueDepth(void);
+
+protected:
+
+	// Ring entry types
+	enum {
+		QUEUE_SAMPLE,			// Media sample
+		QUEUE_EOS,				// End of stream
+		QUEUE_NEW_SEGMENT,		// New segment
+		QUEUE_FLUSH				// End of flush (acknowledged by the thread)
+	};
+
+	// Ring entry
+	typedef struct {
+		DWORD			dwType;		// QUEUE_XXX
+		IMediaSample	*pSample;	// Sample (QUEUE_SAMPLE)
+		REFERENCE_TIME	tStart;		// Segment parameters (QUEUE_NEW_SEGMENT)
+		REFERENCE_TIME	tStop;
+		double			dRate;
+	} QUEUE_ENTRY;
+
+	// Downstream pin
+	IPin *m_pPin;
+	IMemInputPin *m_pInputPin;
+
+	// Batching
+	LONG m_lBatchSize;			// Batch size
+	BOOL m_bBatchExact;			// Batch exactly to m_lBatchSize
+	IMediaSample **m_ppSamples;	// Batched samples (owned by the consumer)
+	volatile LONG m_nBatched;	// Number of batched samples
+
+	// Ring. The producer only advances m_lTail and the consumer only
+	// advances m_lHead (both are free-running counters)
+	QUEUE_ENTRY *m_pRing;
+	volatile LONG m_lHead;		// Next entry to pop
+	volatile LONG m_lTail;		// Next entry to push
+
+	// Signaling (the flags tell that the side is about to wait)
+	HANDLE m_hDataEvent;		// Something pushed (auto-reset)
+	HANDLE m_hSpaceEvent;		// Something popped (auto-reset)
+	HANDLE m_hFlushEvent;		// Flush acknowledged by the thread (auto-reset)
+	volatile LONG m_lConsumerWaiting;
+	volatile LONG m_lProducerWaiting;
+
+	// Queue thread
+	HANDLE m_hThread;
+	volatile LONG m_bTerminate;	// Thread should exit
+
+	// State
+	volatile LONG m_bFlushing;	// Between BeginFlush() and EndFlush()
+	volatile LONG m_hr;			// Sticky result of the delivery (S_FALSE when flushing)
+
+	// Number of entries in the ring
+	LONG GetRingCount(void);
+
+	// Set the sticky result if it's still S_OK
+	void SetResult(HRESULT hr);
+
+	// Deliver the batched samples downstream and release them (or
+	// just release them if the delivery is not possible)
+	void SendBatch(void);
+
+	// Release the batched samples
+	void ReleaseBatch(void);
+
+	// Producer side: push the entry into the ring (blocks while the ring is full)
+	void PushEntry(const QUEUE_ENTRY *pEntry);
+	void PushControl(DWORD dwType);
+
+	// Consumer side: wait until there's something to pop
+	void WaitForData(void);
+
+	// Queue thread procedure
+	static DWORD WINAPI InitialThreadProc(LPVOID pv);
+	DWORD ThreadProc(void);
+
+};
+
+class CParserReferenceAllocator;
+
+//==========================================================================
+// Parser reference sample class
+//
+// Media sample which has no buffer of its own and points into the 
+// buffer of the input sample instead. The sample holds the input
+// sample (via the allocator loan) until it's released itself
+//==========================================================================
+
+class CParserReferenceSample : public CMediaSample
+{
+
+	friend class CParserReferenceAllocator;
+
+	IMediaSample *m_pInputSample;	// Input sample referenced by this one
+
+public:
+
+	CParserReferenceSample(
+		CParserReferenceAllocator *pAllocator,	// Owner allocator
+		HRESULT *phr							// Success or error code
+	);
+
+};
+
+//==========================================================================
+// Parser reference allocator class
+//
+// Allocator of the reference samples, used by the output pins to 
+// deliver the chunk data lying completely within the input sample 
+// without copying it. The allocator lends at most the specified 
+// number of input samples at a time, so that the pullpin always has 
+// the buffers to read into. The samples are handed out without 
+// waiting: if there's no free sample or the input sample cannot be 
+// lent, the caller should fall back to copying the data into the 
+// regular output buffer
+//==========================================================================
+
+class CParserReferenceAllocator : public CBaseAllocator
+{
+
+	// Input samples lent to the reference samples
+	typedef struct tagPARSER_LOAN {
+		IMediaSample	*pSample;	// Input sample (NULL if the entry is free)
+		LONG			nSamples;	// Number of reference samples using it
+	} PARSER_LOAN;
+
+	PARSER_LOAN m_Loan[PARSER_MAX_LOANS];
+	LONG m_nMaxLoans;		// Number of input samples which can be lent
+
+public:
+
+	CParserReferenceAllocator(HRESULT *phr);
+	~CParserReferenceAllocator();
+
+	// Set the number of the reference samples and the input samples
+	// to lend and commit the allocator
+	HRESULT Activate(LONG nSamples, LONG nMaxLoans);
+
+	// Get the sample referencing the data in the input sample buffer.
+	// The sample is returned with zero actual data length, so that 
+	// the data is "appended" to it just as it's done with the regular
+	// samples. Returns S_FALSE if no reference sample is available
+	HRESULT GetReferenceSample(
+		IMediaSample *pInputSample,	// Input sample
+		BYTE *pbData,				// Data in the input sample buffer
+		LONG lDataSize,				// Size of the data
+		IMediaSample **ppSample		// Reference sample
+	);
+
+	// Overridden to return the input sample loan
+	STDMETHODIMP ReleaseBuffer(IMediaSample *pSample);
+
+protected:
+
+	// Create and delete the sample objects (there's no buffer memory)
+	HRESULT Alloc(void);
+	void Free(void);
+	void ReallyFree(void);
+
+};
+
 //==========================================================================
 // Parser output pin class
 // 
-// Delivers media samples downstream (using COutputQueue).
+// Delivers media samples downstream (using CParserOutputQueue).
 // Media type is assigned by the parent filter at construction time
 // and never changes during the lifetime of the pin
 //==========================================================================
@@ -297,6 +818,15 @@ public:
 		LONGLONG llDelta
 	);
 
+	// Skip the sample instead of delivering it (used in the trick-play
+	// mode). The stream and media times and the seeker's position are 
+	// advanced just as Deliver() does, and the next delivered sample 
+	// is marked as a discontinuity
+	HRESULT Skip(
+		REFERENCE_TIME rtDelta,
+		LONGLONG llDelta
+	);
+
 	// Overridden to pass data to the output queue
 	HRESULT Deliver(IMediaSample *pMediaSample);
 	HRESULT DeliverEndOfStream(void);
@@ -339,6 +869,29 @@ public:
 		DWORD dwFlags
 	);
 
+	// Get the sample which references the data at the specified file 
+	// position in the input sample being parsed (instead of the empty 
+	// buffer from the pin's allocator). The sample properties are set 
+	// in the same way as GetDeliveryBuffer() does. Returns S_FALSE if 
+	// the data cannot be referenced
+	HRESULT GetReferenceBuffer(
+		IMediaSample **ppSample,
+		LONGLONG llPosition,
+		LONG lDataSize
+	);
+
+	// Get the empty sample which holds at least the specified number 
+	// of bytes. If the data does not fit into the buffers negotiated 
+	// with the peer pin (the allocator properties set by the filter 
+	// are only an estimate for some formats), the sample comes from 
+	// the pin's own oversize allocator which grows on demand, so that
+	// the chunk is not truncated. The sample properties are set in the
+	// same way as GetDeliveryBuffer() does
+	HRESULT GetChunkBuffer(
+		IMediaSample **ppSample,
+		LONG lDataSize
+	);
+
 	// Pin options access methods
 	long get_BuffersNumber(void);
 	BOOL get_AutoQueue(void);
@@ -351,6 +904,10 @@ public:
 	void put_BatchSize(LONG lBatchSize);
 	void put_BatchExact(BOOL bBatchExact);
 
+	// Pin statistics access methods
+	void GetStatistics(GMF_PIN_STATISTICS *pStatistics);
+	void ResetStatistics(void);
+
 protected:
 
 	// Pin options
@@ -368,6 +925,9 @@ protected:
 	// Is the next sample a discontinuity?
 	BOOL m_bIsDiscontinuity;
 
+	// Set the default sample properties (see GetDeliveryBuffer())
+	HRESULT InitializeSample(IMediaSample *pSample);
+
 	// Media type assigned to the pin
 	CMediaType *m_pMediaType;
 
@@ -378,7 +938,24 @@ protected:
 	CParserSeeking *m_pParserSeeking;
 
 	// Streams data to the peer pin
-	COutputQueue *m_pOutputQueue;
+	CParserOutputQueue *m_pOutputQueue;
+
+	// Size of the buffers negotiated with the peer pin
+	LONG m_cbBuffer;
+
+	// Allocator of the samples larger than the negotiated buffers
+	// (created and grown on demand by GetChunkBuffer())
+	IMemAllocator *m_pOversizeAllocator;
+	LONG m_cbOversizeBuffer;	// Buffer size of the oversize allocator
+	CCritSec m_csOversize;		// Oversize allocator protection
+
+	// Let go of the oversize allocator (its samples still held 
+	// downstream are freed when they are released)
+	void FreeOversizeAllocator(void);
+
+	// Pin statistics
+	GMF_PIN_STATISTICS m_Statistics;
+	CCritSec m_csStatistics;	// Statistics protection
 
 };
 
@@ -634,23 +1211,44 @@ protected:
 	// ParseChunkEnd() of the nested (contained) parser object
 	virtual HRESULT ParseChunkEnd(void) PURE;
 
+	// Get the chunk type for the filter statistics (called from 
+	// within Receive() before ParseChunkHeader()). The base-class 
+	// method returns FALSE which means the chunk is not counted.
+	// The outer parsers of nested chunks usually leave it alone
+	// and let the inner parser count the chunks
+	virtual BOOL GetChunkType(const BYTE *pbHeader, DWORD *pdwType) { return FALSE; };
+
+	// Get the output sample for the chunk data stored in the file at 
+	// the specified position (called from within ParseChunkHeader()).
+	// If the data lies completely within the input sample being parsed,
+	// the output sample references the input buffer, otherwise it's an 
+	// empty sample from the pin's allocator. Either way, the sample has 
+	// zero actual data length and the data should be added to it with
+	// AppendChunkData(). Note that the reference sample is read-only,
+	// so use it only for the data which is delivered as it's stored 
+	// in the file (including the part of the header, if needed)
+	HRESULT GetChunkSample(
+		CParserOutputPin *pPin,		// Output pin to deliver the sample through
+		LONGLONG llPosition,		// File position of the sample data
+		LONG lDataSize,				// Size of the sample data
+		IMediaSample **ppSample		// Output sample
+	);
+
+	// Append the data to the output sample. If the sample references 
+	// the input buffer and the data is already in place, nothing is 
+	// copied. Returns VFW_E_BUFFER_OVERFLOW if the data does not fit
+	HRESULT AppendChunkData(
+		IMediaSample *pSample,		// Output sample
+		const BYTE *pbData,			// Data buffer
+		LONG lDataSize				// Size of data in the buffer
+	);
+
 };
 
 //==========================================================================
 // Patterns and extensions registration stuff
 //==========================================================================
 
-typedef struct tagGMF_FILETYPE_PATTERN {
-	LONG	lOffset;	// Pattern offset
-	LONG	cbPattern;	// Pattern length
-	LPCSTR	szValue;	// Pattern value
-} GMF_FILETYPE_PATTERN;
-
-typedef struct tagGMF_FILETYPE_ENTRY {
-	UINT nPatterns;							// Number of patterns
-	const GMF_FILETYPE_PATTERN *pPattern;	// Array of patterns
-} GMF_FILETYPE_ENTRY;
-
 typedef struct tagGMF_FILETYPE_REGINFO {
 	LPCTSTR szTypeName;
 	const CLSID *clsMajorType;			// Media type CLSID
@@ -765,6 +1363,8 @@ STDMETHODIMP ClassName::RegisterFileTypeExtensions(							\
 class CBaseParserFilter :	public CBaseFilter,
 							public IAMMediaContent,
 							public IConfigBaseParser,
+							public IConfigTrickPlay,
+							public IFilterStatistics,
 							public ISpecifyPropertyPages
 {
 	
@@ -774,8 +1374,8 @@ public:
 
 	DECLARE_IUNKNOWN
 
-	// Overriden to expose IAMMediaContent, IConfigBaseParser and 
-	// ISpecifyPropertyPages
+	// Overriden to expose IAMMediaContent, IConfigBaseParser,
+	// IConfigTrickPlay, IFilterStatistics and ISpecifyPropertyPages
 	STDMETHODIMP NonDelegatingQueryInterface(REFIID riid, void **ppv);
 
 	// ---- IDispatch methods ----
@@ -901,14 +1501,15 @@ public:
 	// implemented if you introduce the flags responsible for cancelling
 	// EndOfStream() and BeginFlush()/EndFlush() delivery downstream 
 	// when the pullpin calls these methods (but that's NOT done here).
-	// The base-class implementation returns E_NOTIMPL
+	// The base-class implementation looks the position up in the chunk
+	// index (if it's loaded) or returns E_NOTIMPL otherwise
 	virtual HRESULT ConvertPosition(
 		LONGLONG *pllTarget,
 		LPCWSTR pPinName,
 		const GUID *pSourceFormat,
 		LONGLONG *pllSource,
 		DWORD dwSourceFlags
-	) { return E_NOTIMPL; };
+	);
 
 	// Set start/stop positions (called from the seeker's SetPositions()).
 	// The base-class method calls ConvertPosition() to get file 
@@ -922,7 +1523,9 @@ public:
 	// first (zero index) output pin. You can change this behavior in 
 	// your implementation by providing the base-class method with the 
 	// name of the first pin even for the request that came from the 
-	// different pin.
+	// different pin. The current position is always converted with
+	// AM_SEEKING_SeekToKeyFrame flag, so that the playback starts
+	// from a keyframe.
 	// Note also that if you use the input pin's Seek() method to set 
 	// the file positions, you don't need to call BeginFlush()/EndFlush()
 	// because the pullpin's Seek() does that for you in a proper way
@@ -950,12 +1553,13 @@ public:
 		double dRate
 	);
 
-	// The base-class implementation returns E_NOTIMPL
+	// The base-class implementation takes the duration from the chunk
+	// index (if it's loaded) or returns E_NOTIMPL otherwise
 	virtual HRESULT GetDuration(
 		LPCWSTR pPinName,
 		const GUID *pCurrentFormat,
 		LONGLONG *pDuration
-	) { return E_NOTIMPL; };
+	);
 
 	// The base-class implementation returns E_NOTIMPL
 	virtual HRESULT GetAvailable(
@@ -996,11 +1600,32 @@ public:
 
 	// The following methods provide access to the input pin options
 	BOOL IsSyncInput(void);
+	BOOL IsMappedInput(void);
+	BOOL IsAdaptiveReadAhead(void);
 	HRESULT GetInputAllocatorProperties(ALLOCATOR_PROPERTIES *pRequest);
 
+	// Is the trick-play mode on? That's the case when the playback
+	// rate reaches the trick-play rate option or the scrub is active.
+	// In the trick-play mode the chunk parsers deliver only the video
+	// frames which can be decoded independently and skip the rest 
+	// (see CParserOutputPin::Skip())
+	BOOL IsTrickPlay(void);
+
 	// Filter name access method
 	LPCWSTR Name(void) { return m_wszFilterName; };
 
+	// Reference sample stuff (see CParserReferenceAllocator).
+	// The reference allocator is activated by the input pin (with the
+	// input allocator to find out how many input buffers can be 
+	// lent) and the reference samples are requested by the output pins
+	HRESULT ActivateReferenceAllocator(IMemAllocator *pInputAllocator);
+	HRESULT DeactivateReferenceAllocator(void);
+	HRESULT GetReferenceSample(
+		LONGLONG llPosition,
+		LONG lDataSize,
+		IMediaSample **ppSample
+	);
+
 	// IConfigBaseParser methods
 	STDMETHODIMP GetOutputPinCount(int *pnCount);
 	STDMETHODIMP GetOutputPinName(int iPin, LPWSTR wszName);
@@ -1024,6 +1649,79 @@ public:
 	virtual STDMETHODIMP RegisterFileTypePatterns(int iType, BOOL bRegister) PURE;
 	virtual STDMETHODIMP RegisterFileTypeExtensions(int iType, BOOL bRegister) PURE;
 
+	// IConfigTrickPlay methods
+	STDMETHODIMP get_TrickPlayRate(long *pnPercent);
+	STDMETHODIMP get_Scrub(BOOL *pbScrub);
+	STDMETHODIMP put_TrickPlayRate(long nPercent);
+	STDMETHODIMP put_Scrub(BOOL bScrub);
+
+	// IFilterStatistics methods
+	STDMETHODIMP GetStatistics(GMF_FILTER_STATISTICS *pStatistics);
+	STDMETHODIMP GetOutputPinStatistics(int iPin, GMF_PIN_STATISTICS *pStatistics);
+	STDMETHODIMP GetChunkTypeCount(int *pnCount);
+	STDMETHODIMP GetChunkStatistics(int iType, GMF_CHUNK_STATISTICS *pStatistics);
+	STDMETHODIMP ResetStatistics(void);
+
+	// Count the parsed chunk of the specified type (called by the 
+	// chunk parsers). Chunk types beyond the table capacity are 
+	// silently ignored
+	void UpdateChunkStatistics(DWORD dwChunkType, LONGLONG llBytes);
+
+	// Average size of the parsed chunks (zero if none 
+	// is counted), used to adapt the input read-ahead
+	LONG GetAverageChunkSize(void);
+
+	// Count the time spent waiting for the input data 
+	// (called by the input read-ahead)
+	void UpdateStallStatistics(LONGLONG llStallTime);
+
+	// ---- Chunk index stuff (see CParserChunkIndex) ----
+
+	// Open the index of the file read by the upstream filter
+	// (called by the input pin before Initialize(), so that the 
+	// filter may skip the file walks the index makes needless). 
+	// Returns S_FALSE if the index is disabled or the file is 
+	// unknown. The index is closed by Shutdown() or CloseChunkIndex()
+	HRESULT OpenChunkIndex(IPin *pPin);
+	void CloseChunkIndex(void);
+
+	// Size of the largest outer chunk of the file known from the 
+	// loaded index (zero if there's no index)
+	LONG GetIndexMaxChunkSize(void);
+
+	// Start recording the index if the playback starts from the 
+	// default start position at the normal rate and stop (give up)
+	// the recording (called by the input pin on activation and 
+	// deactivation). The recording is completed in EndOfStream()
+	void StartIndexRecording(void);
+	void StopIndexRecording(void);
+
+	// Chunk data nesting (called by the chunk parsers around
+	// ParseChunkData(), so that only the outermost chunks are
+	// indexed -- the parser can resume only at their positions)
+	void EnterChunkData(void) { m_nChunkDepth++; };
+	void LeaveChunkData(void) { m_nChunkDepth--; };
+
+	// Note the position of the chunk header being parsed and the
+	// chunk type (called by the chunk parsers)
+	void UpdateChunkIndex(LONGLONG llPosition, BOOL bCountChunk, DWORD dwChunkType);
+
+	// Record the sample delivered by the output pin 
+	// (called by the output pins)
+	void RecordIndexSample(CParserOutputPin *pPin, IMediaSample *pSample);
+
+	// Is the index being recorded? The parsers which can tell the 
+	// independent frames themselves (their samples are not marked 
+	// as sync points) should mark them with MarkIndexKeyFrame() 
+	// then. The position is the one of the outer chunk the frame 
+	// decoding should start from (-1 for the current one)
+	BOOL IsIndexRecording(void);
+	void MarkIndexKeyFrame(CParserOutputPin *pPin, LONGLONG llPosition);
+
+	// Seeking capabilities provided by the chunk index for the output
+	// pin (the seekers add them to the capabilities they're given)
+	DWORD GetIndexCapabilities(LPCWSTR pPinName);
+
 	// ISpecifyPropertyPages method.
 	// The base-class implemenation creates an array consisting of a
 	// base filter property page CLSID. If your derived filter has no 
@@ -1048,12 +1746,15 @@ protected:
 	// (3) Hold pin state section when changing/reading output pins
 	// state (number of pins, adding/removing pins, etc);
 	// (4) Hold options section when changing/reading option values
+	// (5) Hold statistics section when changing/reading statistics
+	// counters
 	CCritSec m_csFilter;	// Filter state protection
 	CCritSec m_csReceive;	// Streaming state protection
 	CCritSec m_csData;		// Filter data protection
 	CCritSec m_csInfo;		// Media content information protection
 	CCritSec m_csPins;		// Output pins state protection
 	CCritSec m_csOptions;	// Option values protectiion
+	CCritSec m_csStatistics;	// Statistics protection
 
 	// ---- Media content information ----
 
@@ -1078,6 +1779,32 @@ protected:
 	long m_nInputBuffers;	// Number of input buffers
 	long m_cbInputBuffer;	// Size of each input buffer (determined in Initialize())
 	long m_cbInputAlign;	// Alignment for input buffers (determined in Initialize())
+	BOOL m_bZeroCopy;		// Deliver the chunk data without copying if possible
+	BOOL m_bMappedInput;	// Map the input file instead of reading it if possible
+	BOOL m_bReadAhead;		// Adapt the read-ahead in the asynchronous mode
+
+	// Chunk index options
+	BOOL m_bChunkIndex;		// Record and use the chunk index
+	WCHAR m_wszIndexDirectory[MAX_PATH];	// Index directory (empty for the sidecar index)
+
+	// Trick-play options
+	long m_nTrickPlayRate;	// Rate (in percent) to switch to the trick-play mode at (zero to disable)
+	BOOL m_bScrub;			// Scrub is active (not stored in the registry)
+
+	// Current playback rate (set by SetRate())
+	double m_dRate;
+
+	// ---- Reference samples stuff ----
+
+	// Allocator of the samples referencing the input buffers
+	CParserReferenceAllocator *m_pReferenceAllocator;
+
+	// Input sample being parsed (set by Receive() on the streaming 
+	// thread only, so no locking is required)
+	IMediaSample *m_pInputSample;	// Input sample
+	BYTE *m_pbInputData;			// Input sample data
+	LONGLONG m_llInputStart;		// File position of the input sample data
+	LONGLONG m_llInputStop;			// File position of the input sample data end
 
 	// ---- Input & output pins of the filter ----
 
@@ -1093,6 +1820,29 @@ protected:
 	LONGLONG m_llDefaultStart;	// Default start position (set in Initialize())
 	LONGLONG m_llDefaultStop;	// Default stop position (set in Initialize())
 
+	// ---- Chunk index ----
+
+	CParserChunkIndex m_ChunkIndex;	// Chunk index of the file
+
+	// Indexing state (set on the streaming thread only, 
+	// so no locking is required)
+	int m_nChunkDepth;				// Chunk data nesting depth
+	LONGLONG m_llIndexPosition;		// Position of the outer chunk being parsed
+	DWORD m_dwIndexChunkType;		// Type of the last counted chunk
+
+	// Find the output pin index by its name (-1 if there's no such pin)
+	int GetOutputPinIndex(LPCWSTR pPinName);
+
+	// ---- Statistics ----
+
+	// Filter-wide counters (the output sample and buffer wait
+	// counters are collected by the output pins)
+	GMF_FILTER_STATISTICS m_Statistics;
+
+	// Per-chunk-type counters
+	int m_nChunkTypes;
+	GMF_CHUNK_STATISTICS m_ChunkStatistics[GMF_STATISTICS_MAX_CHUNK_TYPES];
+
 	// Construction/destruction
 	CBaseParserFilter(
 		TCHAR *pName,				// Object name
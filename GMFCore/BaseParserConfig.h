@@ -43,6 +43,13 @@ DEFINE_GUID(CLSID_BaseParserPage,
 DEFINE_GUID(IID_IConfigBaseParser, 
 0x1f910bd6, 0xa562, 0x4262, 0xbc, 0x6e, 0x12, 0x5f, 0x65, 0xf5, 0x1f, 0x82);
 
+//
+// Base parser trick-play configuration interface
+//
+// {6391ADCD-0368-4328-B829-742F164D4928}
+DEFINE_GUID(IID_IConfigTrickPlay, 
+0x6391adcd, 0x368, 0x4328, 0xb8, 0x29, 0x74, 0x2f, 0x16, 0x4d, 0x49, 0x28);
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -77,6 +84,17 @@ DECLARE_INTERFACE_(IConfigBaseParser, IUnknown)
 	STDMETHOD(RegisterFileTypeExtensions) (THIS_ int iType, BOOL bRegister) PURE;
 };
 
+DECLARE_INTERFACE_(IConfigTrickPlay, IUnknown)
+{
+	// Trick-play getting/setting methods. The rate is in percent
+	// (zero disables the rate-triggered trick-play mode) and the scrub
+	// turns the trick-play mode on regardless of the rate
+	STDMETHOD(get_TrickPlayRate) (THIS_ long *pnPercent) PURE;
+	STDMETHOD(get_Scrub) (THIS_ BOOL *pbScrub) PURE;
+	STDMETHOD(put_TrickPlayRate) (THIS_ long nPercent) PURE;
+	STDMETHOD(put_Scrub) (THIS_ BOOL bScrub) PURE;
+};
+
 #ifdef __cplusplus
 }
 #endif
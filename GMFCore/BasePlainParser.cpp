@@ -237,99 +237,110 @@ HRESULT CBasePlainParserFilter::Receive(
 	if (!m_ppOutputPin[0]->IsConnected())
 		return NOERROR;
 
-	// Get an empty media sample
-	IMediaSample *pSample = NULL;
-	HRESULT hr = m_ppOutputPin[0]->GetDeliveryBuffer(&pSample, NULL, NULL, 0);
-	if (FAILED(hr))
-		return hr;
-
-	// Set the actual data length to zero
-	hr = pSample->SetActualDataLength(0);
-	if (FAILED(hr)) {
-		pSample->Release();
-		return hr;
-	}
+	// Only whole packets are delivered. Find out how many bytes of 
+	// incoming data are left for the packet storage (that's less than
+	// the incoming data as we've got at least one packet here)
+	LONG	lDataToStore	= (m_lPacketLength + lDataSize) % m_lPacketSize,
+			lDataToCopy		= lDataSize - lDataToStore;
 
-	// Pre-process the sample
-	hr = PreProcess(pSample);
-	if (FAILED(hr)) {
-		pSample->Release();
-		return hr;
-	}
+	// Spread the collected packet data and the incoming data over as 
+	// many samples as needed, filling each sample up to its capacity
+	HRESULT hr = NOERROR;
+	while ((m_lPacketLength > 0) || (lDataToCopy > 0)) {
 
-	// Get the sample's buffer
-	BYTE *pbBuffer = NULL;
-	hr = pSample->GetPointer(&pbBuffer);
-	if (FAILED(hr)) {
-		pSample->Release();
-		return hr;
-	}
-
-	// Get the sample's buffer size
-	LONG lBufferSize = pSample->GetSize();
+		// Get an empty media sample
+		IMediaSample *pSample = NULL;
+		hr = m_ppOutputPin[0]->GetDeliveryBuffer(&pSample, NULL, NULL, 0);
+		if (FAILED(hr))
+			return hr;
 
-	// Get the current sample data length
-	LONG lActualDataLength = pSample->GetActualDataLength();
+		// Set the actual data length to zero
+		hr = pSample->SetActualDataLength(0);
+		if (FAILED(hr)) {
+			pSample->Release();
+			return hr;
+		}
 
-	// Check if we can copy packet data to the buffer
-	// If not, we're stuck with the sample and should reject it
-	if (lActualDataLength + m_lPacketLength > lBufferSize) {
-		pSample->Release();
-		return S_FALSE;
-	}
+		// Pre-process the sample
+		hr = PreProcess(pSample);
+		if (FAILED(hr)) {
+			pSample->Release();
+			return hr;
+		}
 
-	// Copy collected packet data to the buffer.
-	CopyMemory(pbBuffer + lActualDataLength, m_pbPacketStorage, m_lPacketLength);
-	lActualDataLength += m_lPacketLength;
+		// Get the sample's buffer
+		BYTE *pbBuffer = NULL;
+		hr = pSample->GetPointer(&pbBuffer);
+		if (FAILED(hr)) {
+			pSample->Release();
+			return hr;
+		}
 
-	// Determine how many bytes of incoming data we should copy
-	// and how many bytes we should save into packet storage
-	LONG	lDataToStore	= (m_lPacketLength + lDataSize) % m_lPacketSize,
-			lDataToCopy		= lDataSize - lDataToStore;
+		// Get the sample's buffer size
+		LONG lBufferSize = pSample->GetSize();
 
-	// Check if we can copy incoming data to the buffer
-	// If not, we're stuck with the sample again and should reject it
-	if (lActualDataLength + lDataToCopy > lBufferSize) {
-		pSample->Release();
-		return S_FALSE;
-	}
+		// Get the current sample data length
+		LONG lActualDataLength = pSample->GetActualDataLength();
 
-	// Copy incoming data to the buffer
-	CopyMemory(pbBuffer + lActualDataLength, pbData, lDataToCopy);
-	lActualDataLength += lDataToCopy;
+		// Find out how many whole packets the sample can take.
+		// If not even one, we're stuck with the sample and should 
+		// reject it
+		LONG lSpace = lBufferSize - lActualDataLength;
+		lSpace -= lSpace % m_lPacketSize;
+		if (lSpace <= 0) {
+			pSample->Release();
+			return S_FALSE;
+		}
 
-	// Set the data length
-	hr = pSample->SetActualDataLength(lActualDataLength);
-	if (FAILED(hr)) {
-		pSample->Release();
-		return hr;
-	}
+		// Copy collected packet data to the buffer (it's less than 
+		// one packet, so it always goes to the first sample)
+		CopyMemory(pbBuffer + lActualDataLength, m_pbPacketStorage, m_lPacketLength);
+		lActualDataLength	+= m_lPacketLength;
+		lSpace				-= m_lPacketLength;
+		m_lPacketLength		= 0;
+
+		// Copy as much incoming data as fits. The collected packet 
+		// data completes the packet, so the copied data still ends 
+		// at the packet boundary
+		LONG lChunk = min(lSpace, lDataToCopy);
+		CopyMemory(pbBuffer + lActualDataLength, pbData, lChunk);
+		lActualDataLength	+= lChunk;
+		pbData				+= lChunk;
+		lDataToCopy			-= lChunk;
+
+		// Set the data length
+		hr = pSample->SetActualDataLength(lActualDataLength);
+		if (FAILED(hr)) {
+			pSample->Release();
+			return hr;
+		}
 
-	// Store the remainder of the incoming data in the packet storage
-	CopyMemory(m_pbPacketStorage, pbData + lDataToCopy, lDataToStore);
-	m_lPacketLength = lDataToStore;
+		// Calculate the size of the filled sample
+		REFERENCE_TIME rtDelta = 0;
+		LONGLONG llDelta = 0;
+		GetSampleDelta(lActualDataLength, &rtDelta, &llDelta);
 
-	// Calculate the size of the filled sample
-	REFERENCE_TIME rtDelta = 0;
-	LONGLONG llDelta = 0;
-	GetSampleDelta(lActualDataLength, &rtDelta, &llDelta);
+		// Post-process the sample (set various properties, etc)
+		hr = PostProcess(pSample);
+		if (FAILED(hr)) {
+			pSample->Release();
+			return hr;
+		}
 
-	// Post-process the sample (set various properties, etc)
-	hr = PostProcess(pSample);
-	if (FAILED(hr)) {
-		pSample->Release();
-		return hr;
-	}
+		// Deliver the sample
+		hr = m_ppOutputPin[0]->Deliver(pSample, rtDelta, llDelta);
+		if (FAILED(hr)) {
+			pSample->Release();
+			return hr;
+		}
 
-	// Deliver the sample
-	hr = m_ppOutputPin[0]->Deliver(pSample, rtDelta, llDelta);
-	if (FAILED(hr)) {
+		// Finally release the sample
 		pSample->Release();
-		return hr;
 	}
 
-	// Finally release the sample
-	pSample->Release();
+	// Store the remainder of the incoming data in the packet storage
+	CopyMemory(m_pbPacketStorage, pbData, lDataToStore);
+	m_lPacketLength = lDataToStore;
 
 	return NOERROR;
 }
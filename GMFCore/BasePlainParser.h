@@ -103,14 +103,15 @@ protected:
 	// perform sophisticated parsing in this class anyway. Also, you can 
 	// force dummy parser seeking creation by setting its capabilities, 
 	// number of time formats and time formats array to zero.
-	// In the implementation of Receive() we assume that the output 
-	// media sample's buffer is large enough to receive pre-processing 
-	// data, input sample data (possibly plus one packet from the 
-	// previous input media sample) and post-processing data. Otherwise 
-	// we're not able to deliver a sample to the output pin. Be sure 
-	// to reserve necessary output buffer size -- take into account
-	// the input buffer size and pre-/post-processing data (the size of 
-	// one additional packet is added by the base class Initialize())
+	// Receive() spreads the input sample data (possibly plus one packet
+	// from the previous input media sample) over as many output samples
+	// as needed, filling each of them with whole packets up to its 
+	// capacity. The output media sample's buffer should be large enough
+	// to receive pre-processing data and at least one packet. It's best
+	// to set the output buffer size equal to the input buffer size plus
+	// pre-processing data (the size of one additional packet is added 
+	// by the base class Initialize()), so that one input sample goes
+	// to one output sample
 	virtual HRESULT Initialize(
 		IPin *pPin,
 		IAsyncReader *pReader,
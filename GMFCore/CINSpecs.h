@@ -27,7 +27,7 @@
 #ifndef __GMF_CIN_SPECS_H__
 #define __GMF_CIN_SPECS_H__
 
-#include <windows.h>
+#include "CodecTypes.h"
 
 //==========================================================================
 // Constants
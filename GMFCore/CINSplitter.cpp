@@ -336,33 +336,14 @@ HRESULT CCINChunkParser::ParseChunkData(
 	if (m_bEndOfFile)
 		return NOERROR;
 
-	// Get the sample's buffer
-	BYTE *pbBuffer = NULL;
-	HRESULT hr = m_pSample->GetPointer(&pbBuffer);
-	if (FAILED(hr)) {
+	// Append data to the sample
+	HRESULT hr = AppendChunkData(m_pSample, pbData, lDataSize);
+	if (FAILED(hr) && (hr != VFW_E_BUFFER_OVERFLOW)) {
 		m_pSample->Release();
 		m_pSample = NULL;
-		return hr;
-	}
-
-	// Find out how many bytes we can copy
-	LONG lBufferSize = m_pSample->GetSize();
-	LONG lActualDataLength = m_pSample->GetActualDataLength();
-	LONG lDataToCopy = min(lDataSize, lBufferSize - lActualDataLength);
-
-	// Copy data to buffer
-	CopyMemory(pbBuffer + lActualDataLength, pbData, lDataToCopy);
-	lActualDataLength += lDataToCopy;
-
-	// Update buffer's actual data length
-	hr = m_pSample->SetActualDataLength(lActualDataLength);
-	if (FAILED(hr)) {
-		m_pSample->Release();
-		m_pSample = NULL;
-		return hr;
 	}
 
-	return (lDataToCopy < lDataSize) ? VFW_E_BUFFER_OVERFLOW : NOERROR;
+	return hr;
 }
 
 HRESULT CCINChunkParser::ParseChunkEnd(void)
@@ -428,6 +409,16 @@ HRESULT CCINChunkParser::ParseChunkEnd(void)
 	return NOERROR;
 }
 
+BOOL CCINChunkParser::GetChunkType(const BYTE *pbHeader, DWORD *pdwType)
+{
+	// There are no chunk IDs, so count the chunks by the 
+	// parser state which tells the chunk type
+	*pdwType = (DWORD)m_ChunkType;
+
+	// Do not count anything past end-of-file chunk
+	return !m_bEndOfFile;
+}
+
 //==========================================================================
 // CCINSplitterFilter methods
 //==========================================================================
@@ -547,7 +538,7 @@ HRESULT CCINSplitterFilter::Initialize(IPin *pPin, IAsyncReader *pReader)
 	// Set the video allocator properties
 	papVideo->cbAlign	= 0;	// No matter
 	papVideo->cbPrefix	= 0;	// No matter
-	papVideo->cBuffers	= 4;	// TEMP: No need to set larger value?
+	papVideo->cBuffers	= 4;	// Default (the pin option may override it)
 	papVideo->cbBuffer	= cbMaxVideo;
 
 	// Allocate time formats array. If we fail here, it's not an error, 
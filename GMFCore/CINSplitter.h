@@ -83,6 +83,9 @@ protected:
 	);
 	HRESULT ParseChunkEnd(void);
 
+	// Get the chunk type for the filter statistics
+	BOOL GetChunkType(const BYTE *pbHeader, DWORD *pdwType);
+
 };
 
 //==========================================================================
@@ -86,23 +86,18 @@ CCINVideoDecompressor::CCINVideoDecompressor(
 	LPUNKNOWN pUnk,
 	HRESULT *phr
 ) :
-	CTransformFilter(
+	CBaseDecompressorFilter(
 		NAME("CIN Video Decompressor"),
 		pUnk,
 		CLSID_CINVideoDecompressor
-	),
-	m_pFormat(NULL)	// No format block at this time
+	)
 {
 	ASSERT(phr);
 }
 
 CCINVideoDecompressor::~CCINVideoDecompressor()
 {
-	// Free the format block
-	if (m_pFormat) {
-		CoTaskMemFree(m_pFormat);
-		m_pFormat = NULL;
-	}
+	// The decoder frees its format block itself
 }
 
 CUnknown* WINAPI CCINVideoDecompressor::CreateInstance(
@@ -126,7 +121,7 @@ STDMETHODIMP CCINVideoDecompressor::NonDelegatingQueryInterface(REFIID riid, voi
 	if (riid == IID_ISpecifyPropertyPages)
 		return GetInterface((ISpecifyPropertyPages*)this, ppv);
 	else
-		return CTransformFilter::NonDelegatingQueryInterface(riid, ppv);
+		return CBaseDecompressorFilter::NonDelegatingQueryInterface(riid, ppv);
 }
 
 HRESULT CCINVideoDecompressor::Transform(
@@ -146,22 +141,35 @@ HRESULT CCINVideoDecompressor::Transform(
 	if (FAILED(hr))
 		return hr;
 
-	// Check if the frame contains new palette
-	BYTE *pbHuffmanData = NULL;
-	if (*((DWORD*)pbInBuffer) == CIN_COMMAND_PALETTE) {
+	// Get the output sample's buffer
+	BYTE *pbOutBuffer = NULL;
+	hr = pOut->GetPointer(&pbOutBuffer);
+	if (FAILED(hr))
+		return hr;
+
+	// Set up the output frame descriptor
+	GMF_FRAME frame;
+	ZeroMemory(&frame, sizeof(GMF_FRAME));
+	frame.pbBuffer	= pbOutBuffer;
+	frame.cbBuffer	= (DWORD)pOut->GetSize();
 
-		// Get the palette pointer from the input data
-		BYTE *pbPalette = pbInBuffer + 4;
+	// Call the decoder to decompress the frame
+	hr = m_Decoder.Decode(pbInBuffer, (DWORD)pIn->GetActualDataLength(), frame);
+	if (FAILED(hr))
+		return hr;
+
+	// Check if the frame contains new palette
+	if (frame.nPaletteEntries != 0) {
 
 		// Get the output media type format
 		CMediaType mt((AM_MEDIA_TYPE)m_pOutput->CurrentMediaType());
 		VIDEOINFO *pVideoInfo = (VIDEOINFO*)mt.Format();
 
 		// Fill in the output media type format palette
-		for (int i = 0; i < 256; i++) {
-			pVideoInfo->bmiColors[i].rgbRed			= *pbPalette++;
-			pVideoInfo->bmiColors[i].rgbGreen		= *pbPalette++;
-			pVideoInfo->bmiColors[i].rgbBlue		= *pbPalette++;
+		for (int i = frame.iPaletteStart; i < frame.iPaletteStart + frame.nPaletteEntries; i++) {
+			pVideoInfo->bmiColors[i].rgbRed			= frame.pPalette[i].bRed;
+			pVideoInfo->bmiColors[i].rgbGreen		= frame.pPalette[i].bGreen;
+			pVideoInfo->bmiColors[i].rgbBlue		= frame.pPalette[i].bBlue;
 			pVideoInfo->bmiColors[i].rgbReserved	= 0;
 		}
 
@@ -169,31 +177,11 @@ HRESULT CCINVideoDecompressor::Transform(
 		hr = pOut->SetMediaType(&mt);
 		if (FAILED(hr))
 			return hr;
-
-		// Set up Huffman data pointer
-		pbHuffmanData = pbPalette;
-
-	} else
-		pbHuffmanData = pbInBuffer + 4;
-
-	// Set up Huffman count
-	LONG lHuffmanCount = pIn->GetActualDataLength();
-	lHuffmanCount -= (LONG)(pbHuffmanData - pbInBuffer);
-
-	// Get the output sample's buffer
-	BYTE *pbOutBuffer = NULL;
-	hr = pOut->GetPointer(&pbOutBuffer);
-	if (FAILED(hr))
-		return hr;
-
-	// Call the decoder function to decompress the frame
-	if (!HuffmanDecode(pbHuffmanData, lHuffmanCount, pbOutBuffer))
-		return E_FAIL;
+	}
 
 	// Set the data length for the output sample. 
 	// The data length is the uncompressed frame size
-	LONG lOutDataLength = m_pFormat->dwVideoWidth * m_pFormat->dwVideoHeight;
-	hr = pOut->SetActualDataLength(lOutDataLength);
+	hr = pOut->SetActualDataLength((LONG)frame.cbData);
 	if (FAILED(hr))
 		return hr;
 
@@ -244,22 +232,9 @@ HRESULT CCINVideoDecompressor::SetMediaType(
 		CheckPointer(pmt, E_POINTER);
 		ValidateReadPtr(pmt, sizeof(CMediaType));
 
-		// Free the old format block and allocate a new one
-		if (m_pFormat)
-			CoTaskMemFree(m_pFormat);
-		m_pFormat = (CIN_HEADER*)CoTaskMemAlloc(pmt->FormatLength());
-		if (m_pFormat == NULL)
-			return E_OUTOFMEMORY;
-
-		// Copy format block to the allocated storage
-		CopyMemory(m_pFormat, pmt->Format(), pmt->FormatLength());
-
-		// Set up Huffman nodes and tree
-		for (int i = 0; i < 256; i++) {
-			for (int j = 0; j < HUFFMAN_TOKENS; j++)
-				m_HuffmanNodes[i][j].iCount = (int)m_pFormat->bHuffmanTable[i][j];
-			HuffmanBuildTree(i);
-		}
+		// Pass the format block to the decoder 
+		// (it sets up Huffman nodes and tree)
+		return m_Decoder.SetFormat((CIN_HEADER*)pmt->Format(), pmt->FormatLength());
 	}
 
 	return NOERROR;
@@ -271,10 +246,7 @@ HRESULT CCINVideoDecompressor::BreakConnect(PIN_DIRECTION dir)
 	if (dir == PINDIR_INPUT) {
 
 		// Free the format block
-		if (m_pFormat) {
-			CoTaskMemFree(m_pFormat);
-			m_pFormat = NULL;
-		}
+		m_Decoder.ResetFormat();
 	}
 
 	return NOERROR;
@@ -337,7 +309,8 @@ HRESULT CCINVideoDecompressor::GetMediaType(
 	ValidateWritePtr(pMediaType, sizeof(CMediaType));
 
 	// At this time we should have the format block
-	if (!m_pFormat)
+	const CIN_HEADER *pFormat = m_Decoder.GetFormat();
+	if (!pFormat)
 		return E_UNEXPECTED;
 
 	if (iPosition < 0)
@@ -358,8 +331,8 @@ HRESULT CCINVideoDecompressor::GetMediaType(
 		SetRectEmpty(&pVideoInfo->rcSource);
 		SetRectEmpty(&pVideoInfo->rcTarget);
 		pVideoInfo->bmiHeader.biSize			= sizeof(BITMAPINFOHEADER);
-		pVideoInfo->bmiHeader.biWidth			= (LONG)m_pFormat->dwVideoWidth;
-		pVideoInfo->bmiHeader.biHeight			= -(LONG)m_pFormat->dwVideoHeight;
+		pVideoInfo->bmiHeader.biWidth			= (LONG)pFormat->dwVideoWidth;
+		pVideoInfo->bmiHeader.biHeight			= -(LONG)pFormat->dwVideoHeight;
 		pVideoInfo->bmiHeader.biPlanes			= 1;
 		pVideoInfo->bmiHeader.biBitCount		= 8;
 		pVideoInfo->bmiHeader.biCompression		= BI_RGB;
@@ -402,7 +375,8 @@ HRESULT CCINVideoDecompressor::DecideBufferSize(
 		return E_UNEXPECTED;
 
 	// At this time we should have the format block
-	if (!m_pFormat)
+	const CIN_HEADER *pFormat = m_Decoder.GetFormat();
+	if (!pFormat)
 		return E_UNEXPECTED;
 
 	// Get the input pin's allocator
@@ -425,7 +399,7 @@ HRESULT CCINVideoDecompressor::DecideBufferSize(
 	// Set the properties: output buffer's size is frame size, 
 	// the buffers amount is the same as for the input pin and 
 	// we don't care about alignment and prefix
-	LONG cbFrame = m_pFormat->dwVideoWidth * m_pFormat->dwVideoHeight;
+	LONG cbFrame = (LONG)m_Decoder.GetFrameSize();
 	pProperties->cbBuffer = max(pProperties->cbBuffer, cbFrame);
 	pProperties->cBuffers = max(pProperties->cBuffers, apInput.cBuffers);
 	ALLOCATOR_PROPERTIES apActual;
@@ -456,126 +430,6 @@ STDMETHODIMP CCINVideoDecompressor::GetPages(CAUUID *pPages)
 	return NOERROR;
 }
 
-//==========================================================================
-// Huffman decoder methods implementation.
-// Source code taken from xcinplay program 
-// by Dr. Tim Ferguson (timf@csse.monash.edu.au)
-//==========================================================================
-
-/* -------------------------------------------------------------------------
- *  Decodes input Huffman data using the Huffman table.
- *
- *  Input:   data = encoded data to be decoded.
- *           len = length of encoded data.
- *           image = a buffer for the decoded image data.
- */
-BOOL CCINVideoDecompressor::HuffmanDecode(BYTE *data, long len, BYTE *image)
-{
-	CIN_HUFFMAN_NODE *hnodes;
-	long i, dec_len;
-	int prev;
-	register BYTE v = 0;
-	register int bit_pos, node_num, dat_pos;
-
-	/* read count */
-	dec_len  = (*data++ & 0xff);
-	dec_len |= (*data++ & 0xff) << 8;
-	dec_len |= (*data++ & 0xff) << 16;
-	dec_len |= (*data++ & 0xff) << 24;
-
-	prev = bit_pos = dat_pos = 0;
-	for (i = 0; i < dec_len; i++) {
-
-		node_num = m_nHuffmanNodes[prev];
-		hnodes = m_HuffmanNodes[prev];
-
-		while (node_num >= HUFFMAN_TOKENS) {
-
-			if (!bit_pos) {
-				if (dat_pos > len) {
-					// Huffman decode error
-					return FALSE;
-				}
-				bit_pos = 8;
-				v = data[dat_pos++];
-			}
-
-			node_num = hnodes[node_num].iChildren[v & 0x01];
-			v = v >> 1;
-			bit_pos--;
-		}
-
-		*image++ = prev = node_num;
-	}
-
-	return TRUE;
-}
-
-/* -------------------------------------------------------------------------
- *  Find the lowest probability node in a Huffman table, and mark it as
- *  being assigned to a higher probability.
- *  Returns the node index of the lowest unused node, or -1 if all nodes
- *  are used.
- */
-int CCINVideoDecompressor::HuffmanSmallestNode(CIN_HUFFMAN_NODE *hnodes, int num_hnodes)
-{
-	int i;
-	int best, best_node;
-
-	best = 99999999;
-	best_node = -1;
-	for (i = 0; i < num_hnodes; i++) {
-
-		if (hnodes[i].bUsed) continue;
-		if (!hnodes[i].iCount) continue;
-		if (hnodes[i].iCount < best) {
-			best = hnodes[i].iCount;
-			best_node = i;
-		}
-	}
-
-	if (best_node == -1) return -1;
-	hnodes[best_node].bUsed = 1;
-	return best_node;
-}
-
-/* -------------------------------------------------------------------------
- *  Build the Huffman tree using the generated/loaded probabilities histogram.
- *
- *  On completion:
- *   m_HuffmanNodes[prev][i < HUFFMAN_TOKENS] - are the nodes at the base of the tree.
- *   m_HuffmanNodes[prev][i >= HUFFMAN_TOKENS] - are used to construct the tree.
- *   m_nHuffmanNodes[prev] - contains the index to the root node of the tree.
- *     That is: m_HuffmanNodes[prev][m_nHuffmanNodes[prev]] is the root node.
- */
-void CCINVideoDecompressor::HuffmanBuildTree(int prev)
-{
-	CIN_HUFFMAN_NODE *node, *hnodes;
-	int num_hnodes, i;
-
-	num_hnodes = HUFFMAN_TOKENS;
-	hnodes = m_HuffmanNodes[prev];
-	for (i = 0; i < HUFFMAN_TOKENS * 2; i++) hnodes[i].bUsed = 0;
-
-	while (1) {
-
-		node = &hnodes[num_hnodes];	/* next free node */
-
-		/* pick two lowest counts */
-		node->iChildren[0] = HuffmanSmallestNode(hnodes, num_hnodes);
-		if (node->iChildren[0] == -1) break;	/* reached the root node */
-
-		node->iChildren[1] = HuffmanSmallestNode(hnodes, num_hnodes);
-		if (node->iChildren[1] == -1) break;	/* reached the root node */
-
-		/* combine nodes probability for new node */
-		node->iCount = hnodes[node->iChildren[0]].iCount + hnodes[node->iChildren[1]].iCount;
-		num_hnodes++;
-	}
-
-	m_nHuffmanNodes[prev] = num_hnodes - 1;
-}
-
 //==========================================================================
 // CCINVideoDecompressorPage methods
 //==========================================================================
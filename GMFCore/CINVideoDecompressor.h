@@ -27,43 +27,25 @@
 
 #include <streams.h>
 
+#include "BaseDecompressor.h"
 #include "CINSpecs.h"
+#include "CINVideoDecoder.h"
 
 //==========================================================================
 // CIN video decompressor filter class
 //==========================================================================
 
-class CCINVideoDecompressor :	public CTransformFilter,
+class CCINVideoDecompressor :	public CBaseDecompressorFilter,
 								public ISpecifyPropertyPages
 {
 
-	// ---- Huffman decoder stuff ----
-	// Source code taken from xcinplay program 
-	// by Dr. Tim Ferguson (timf@csse.monash.edu.au)
-
-	typedef struct tagCIN_HUFFMAN_NODE {
-		int iCount;
-		BYTE bUsed;
-		int iChildren[2];
-	} CIN_HUFFMAN_NODE;
-
-	CIN_HUFFMAN_NODE m_HuffmanNodes[256][HUFFMAN_TOKENS * 2];
-	int m_nHuffmanNodes[256];
-
-	// Format block
-	CIN_HEADER *m_pFormat;
+	// Platform-neutral CIN video decoder
+	CCINVideoDecoder m_Decoder;
 
 	// Constructor/destructor
 	CCINVideoDecompressor(LPUNKNOWN pUnk, HRESULT *phr);
 	~CCINVideoDecompressor();
 
-	// ---- Huffman decoder methods ----
-	// Source code taken from xcinplay program 
-	// by Dr. Tim Ferguson (timf@csse.monash.edu.au)
-	BOOL HuffmanDecode(BYTE *data, long len, BYTE *image);
-	int HuffmanSmallestNode(CIN_HUFFMAN_NODE *hnodes, int num_hnodes);
-	void HuffmanBuildTree(int prev);
-
 public:
 
 	static CUnknown * WINAPI CreateInstance(LPUNKNOWN pUnk, HRESULT *phr);
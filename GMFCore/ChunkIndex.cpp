@@ -0,0 +1,648 @@
+//==========================================================================
+//
+// File: ChunkIndex.cpp
+//
+// Desc: Game Media Formats - Implementation of persistent chunk index
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#include <stdlib.h>
+#include <wchar.h>
+
+#include "ChunkIndex.h"
+
+// Compare the index entries by stream, time and position (for qsort())
+static int __cdecl CompareIndexEntries(const void *pElem1, const void *pElem2)
+{
+	const PARSER_INDEX_ENTRY *pEntry1 = (const PARSER_INDEX_ENTRY*)pElem1;
+	const PARSER_INDEX_ENTRY *pEntry2 = (const PARSER_INDEX_ENTRY*)pElem2;
+
+	if (pEntry1->wStream != pEntry2->wStream)
+		return (pEntry1->wStream < pEntry2->wStream) ? -1 : 1;
+	if (pEntry1->rtTime != pEntry2->rtTime)
+		return (pEntry1->rtTime < pEntry2->rtTime) ? -1 : 1;
+	if (pEntry1->llPosition != pEntry2->llPosition)
+		return (pEntry1->llPosition < pEntry2->llPosition) ? -1 : 1;
+
+	return 0;
+}
+
+//==========================================================================
+// CParserChunkIndex methods
+//==========================================================================
+
+CParserChunkIndex::CParserChunkIndex() :
+	m_clsFilter(GUID_NULL),
+	m_llFileSize(0),
+	m_bLoaded(FALSE),
+	m_bRecording(FALSE),
+	m_pEntries(NULL),
+	m_nEntries(0),
+	m_nMaxEntries(0),
+	m_cbMaxChunk(0),
+	m_llLastChunk(-1)
+{
+	m_wszIndexFile[0] = 0;
+	ZeroMemory(&m_ftLastWrite, sizeof(FILETIME));
+	ZeroMemory(m_iStreamFirst, sizeof(m_iStreamFirst));
+}
+
+CParserChunkIndex::~CParserChunkIndex()
+{
+	Close();
+}
+
+HRESULT CParserChunkIndex::Open(
+	LPCWSTR pszFileName,
+	LPCWSTR pszIndexDirectory,
+	REFCLSID clsFilter
+)
+{
+	// Check the pointer
+	CheckPointer(pszFileName, E_POINTER);
+
+	CAutoLock lock(&m_csIndex);
+
+	Close();
+
+	// Get the file identity
+	WIN32_FILE_ATTRIBUTE_DATA fad;
+	if (!GetFileAttributesExW(pszFileName, GetFileExInfoStandard, &fad))
+		return HRESULT_FROM_WIN32(GetLastError());
+
+	// Work out the index file name
+	int nLength;
+	if ((pszIndexDirectory) && (pszIndexDirectory[0])) {
+
+		// Hash the file path (FNV-1a) so that the same file gets the
+		// same index file in the directory whatever the case of its path
+		ULONGLONG ullHash = 0xCBF29CE484222325;
+		for (LPCWSTR pch = pszFileName; *pch; pch++) {
+			ullHash ^= (ULONGLONG)towupper(*pch);
+			ullHash *= 0x00000100000001B3;
+		}
+
+		nLength = _snwprintf(
+			m_wszIndexFile,
+			MAX_PATH,
+			L"%s\\%016I64X%s",
+			pszIndexDirectory,
+			ullHash,
+			PARSER_INDEX_EXTENSION
+		);
+
+	} else {
+
+		// The index file is the sidecar of the indexed file
+		nLength = _snwprintf(
+			m_wszIndexFile,
+			MAX_PATH,
+			L"%s%s",
+			pszFileName,
+			PARSER_INDEX_EXTENSION
+		);
+	}
+	if ((nLength < 0) || (nLength >= MAX_PATH)) {
+		m_wszIndexFile[0] = 0;
+		return E_INVALIDARG;
+	}
+
+	m_clsFilter		= clsFilter;
+	m_llFileSize	= ((LONGLONG)fad.nFileSizeHigh << 32) | fad.nFileSizeLow;
+	m_ftLastWrite	= fad.ftLastWriteTime;
+
+	// Load the index (if we cannot, it's not an error --
+	// the index will be recorded then)
+	return (SUCCEEDED(LoadIndex())) ? S_OK : S_FALSE;
+}
+
+void CParserChunkIndex::Close(void)
+{
+	CAutoLock lock(&m_csIndex);
+
+	FreeEntries();
+
+	m_wszIndexFile[0]	= 0;
+	m_clsFilter			= GUID_NULL;
+	m_llFileSize		= 0;
+	ZeroMemory(&m_ftLastWrite, sizeof(FILETIME));
+}
+
+BOOL CParserChunkIndex::IsLoaded(void)
+{
+	CAutoLock lock(&m_csIndex);
+
+	return m_bLoaded;
+}
+
+BOOL CParserChunkIndex::IsRecording(void)
+{
+	CAutoLock lock(&m_csIndex);
+
+	return m_bRecording;
+}
+
+BOOL CParserChunkIndex::IsSeekable(int iStream)
+{
+	CAutoLock lock(&m_csIndex);
+
+	DWORD iFirst, iLast;
+	if (!GetStreamRange(iStream, &iFirst, &iLast))
+		return FALSE;
+
+	// The key entry of the last entry should not be the first one
+	DWORD iKeyEntry = m_pEntries[iLast].iKeyEntry;
+	return (iKeyEntry != PARSER_INDEX_NO_KEY) && (iKeyEntry > iFirst);
+}
+
+void CParserChunkIndex::StartRecording(void)
+{
+	CAutoLock lock(&m_csIndex);
+
+	// No need to record the loaded index and nowhere to save it
+	// if no file is open
+	if ((m_bLoaded) || (m_wszIndexFile[0] == 0))
+		return;
+
+	FreeEntries();
+
+	for (int i = 0; i < PARSER_INDEX_MAX_STREAMS; i++) {
+		m_llLastPosition[i]	= -1;
+		m_rtStreamEnd[i]	= 0;
+		m_llMediaEnd[i]		= 0;
+		m_iLastEntry[i]		= 0;
+		m_llKeyPosition[i]	= -1;
+	}
+	m_llLastChunk = -1;
+
+	m_bRecording = TRUE;
+}
+
+void CParserChunkIndex::CancelRecording(void)
+{
+	CAutoLock lock(&m_csIndex);
+
+	if (!m_bRecording)
+		return;
+
+	FreeEntries();
+}
+
+void CParserChunkIndex::RecordSample(
+	int iStream,
+	LONGLONG llPosition,
+	DWORD dwChunkType,
+	IMediaSample *pSample
+)
+{
+	CAutoLock lock(&m_csIndex);
+
+	if (!m_bRecording)
+		return;
+
+	// Streams beyond the index capacity are not recorded
+	if ((iStream < 0) || (iStream >= PARSER_INDEX_MAX_STREAMS))
+		return;
+
+	// The sample should be timestamped
+	REFERENCE_TIME rtStart = 0, rtStop = 0;
+	if (FAILED(pSample->GetTime(&rtStart, &rtStop)))
+		return;
+	LONGLONG llMediaStart = 0, llMediaStop = 0;
+	if (pSample->GetMediaTime(&llMediaStart, &llMediaStop) != S_OK)
+		llMediaStart = llMediaStop = 0;
+
+	// Keep track of the stream end
+	if (rtStop > m_rtStreamEnd[iStream])
+		m_rtStreamEnd[iStream] = rtStop;
+	if (llMediaStop > m_llMediaEnd[iStream])
+		m_llMediaEnd[iStream] = llMediaStop;
+
+	// Only the first sample parsed from the chunk is recorded
+	if (llPosition == m_llLastPosition[iStream])
+		return;
+	m_llLastPosition[iStream] = llPosition;
+
+	PARSER_INDEX_ENTRY entry;
+	ZeroMemory(&entry, sizeof(PARSER_INDEX_ENTRY));
+	entry.llPosition	= llPosition;
+	entry.rtTime		= rtStart;
+	entry.llMediaTime	= llMediaStart;
+	entry.dwChunkType	= dwChunkType;
+	entry.wStream		= (WORD)iStream;
+	entry.wFlags		= (
+		(pSample->IsSyncPoint() == S_OK) ||
+		(llPosition == m_llKeyPosition[iStream])
+	) ? PARSER_INDEX_KEYFRAME : 0;
+
+	// Give up the recording if the index cannot grow
+	if (FAILED(AddEntry(&entry))) {
+		FreeEntries();
+		return;
+	}
+	m_iLastEntry[iStream] = m_nEntries - 1;
+}
+
+void CParserChunkIndex::RecordChunk(LONGLONG llPosition)
+{
+	CAutoLock lock(&m_csIndex);
+
+	if (!m_bRecording)
+		return;
+
+	// The chunk ends where the next one starts
+	if ((m_llLastChunk >= 0) && (llPosition - m_llLastChunk > (LONGLONG)m_cbMaxChunk))
+		m_cbMaxChunk = (DWORD)min(llPosition - m_llLastChunk, (LONGLONG)MAXLONG);
+	m_llLastChunk = llPosition;
+}
+
+void CParserChunkIndex::MarkKeyEntry(int iStream, LONGLONG llPosition)
+{
+	CAutoLock lock(&m_csIndex);
+
+	if ((!m_bRecording) || (iStream < 0) || (iStream >= PARSER_INDEX_MAX_STREAMS))
+		return;
+
+	// Flag the entry if it's been recorded already, otherwise 
+	// the entry is flagged when it's recorded
+	if (llPosition == m_llLastPosition[iStream])
+		m_pEntries[m_iLastEntry[iStream]].wFlags |= PARSER_INDEX_KEYFRAME;
+	else
+		m_llKeyPosition[iStream] = llPosition;
+}
+
+HRESULT CParserChunkIndex::FinishRecording(LONGLONG llEndPosition)
+{
+	CAutoLock lock(&m_csIndex);
+
+	if (!m_bRecording)
+		return S_FALSE;
+
+	// The last chunk ends at the file end (the default stop 
+	// position is usually not set)
+	RecordChunk(min(llEndPosition, m_llFileSize));
+
+	// Terminate the recorded streams with the stream end entries
+	for (int i = 0; i < PARSER_INDEX_MAX_STREAMS; i++) {
+
+		if (m_llLastPosition[i] < 0)
+			continue;
+
+		PARSER_INDEX_ENTRY entry;
+		ZeroMemory(&entry, sizeof(PARSER_INDEX_ENTRY));
+		entry.llPosition	= llEndPosition;
+		entry.rtTime		= m_rtStreamEnd[i];
+		entry.llMediaTime	= m_llMediaEnd[i];
+		entry.dwChunkType	= PARSER_INDEX_STREAM_END;
+		entry.wStream		= (WORD)i;
+
+		HRESULT hr = AddEntry(&entry);
+		if (FAILED(hr)) {
+			FreeEntries();
+			return hr;
+		}
+	}
+
+	// Sort and link the entries
+	HRESULT hr = BuildIndex();
+	if (FAILED(hr)) {
+		FreeEntries();
+		return hr;
+	}
+
+	m_bRecording	= FALSE;
+	m_bLoaded		= TRUE;
+
+	// The index is usable even if it cannot be saved
+	return SaveIndex();
+}
+
+HRESULT CParserChunkIndex::FindKeyEntry(
+	int iStream,
+	REFERENCE_TIME rtTime,
+	PARSER_INDEX_ENTRY *pEntry
+)
+{
+	// Check the pointer
+	CheckPointer(pEntry, E_POINTER);
+
+	CAutoLock lock(&m_csIndex);
+
+	DWORD iFirst, iLast;
+	if (!GetStreamRange(iStream, &iFirst, &iLast))
+		return E_FAIL;
+
+	// Find the last entry at or before the time
+	DWORD iLow = iFirst, iHigh = iLast + 1;
+	while (iLow < iHigh) {
+		DWORD iMiddle = iLow + (iHigh - iLow) / 2;
+		if (m_pEntries[iMiddle].rtTime <= rtTime)
+			iLow = iMiddle + 1;
+		else
+			iHigh = iMiddle;
+	}
+	DWORD iEntry = (iLow > iFirst) ? iLow - 1 : iFirst;
+
+	// Take the key entry of the found one
+	DWORD iKeyEntry = m_pEntries[iEntry].iKeyEntry;
+	if (iKeyEntry == PARSER_INDEX_NO_KEY)
+		return E_FAIL;
+
+	*pEntry = m_pEntries[iKeyEntry];
+
+	return NOERROR;
+}
+
+HRESULT CParserChunkIndex::FindEntry(
+	int iStream,
+	REFERENCE_TIME rtTime,
+	PARSER_INDEX_ENTRY *pEntry
+)
+{
+	// Check the pointer
+	CheckPointer(pEntry, E_POINTER);
+
+	CAutoLock lock(&m_csIndex);
+
+	DWORD iFirst, iLast;
+	if (!GetStreamRange(iStream, &iFirst, &iLast))
+		return E_FAIL;
+
+	// Find the first entry at or after the time (the stream
+	// end entry is the last resort)
+	DWORD iLow = iFirst, iHigh = iLast;
+	while (iLow < iHigh) {
+		DWORD iMiddle = iLow + (iHigh - iLow) / 2;
+		if (m_pEntries[iMiddle].rtTime < rtTime)
+			iLow = iMiddle + 1;
+		else
+			iHigh = iMiddle;
+	}
+
+	*pEntry = m_pEntries[iLow];
+
+	return NOERROR;
+}
+
+HRESULT CParserChunkIndex::FindPositionEntry(
+	int iStream,
+	LONGLONG llPosition,
+	PARSER_INDEX_ENTRY *pEntry
+)
+{
+	// Check the pointer
+	CheckPointer(pEntry, E_POINTER);
+
+	CAutoLock lock(&m_csIndex);
+
+	DWORD iFirst, iLast;
+	if (!GetStreamRange(iStream, &iFirst, &iLast))
+		return E_FAIL;
+
+	// The positions grow along with the times within the
+	// stream, so the same search works for them
+	DWORD iLow = iFirst, iHigh = iLast;
+	while (iLow < iHigh) {
+		DWORD iMiddle = iLow + (iHigh - iLow) / 2;
+		if (m_pEntries[iMiddle].llPosition < llPosition)
+			iLow = iMiddle + 1;
+		else
+			iHigh = iMiddle;
+	}
+
+	*pEntry = m_pEntries[iLow];
+
+	return NOERROR;
+}
+
+LONG CParserChunkIndex::GetMaxChunkSize(void)
+{
+	CAutoLock lock(&m_csIndex);
+
+	return (m_bLoaded) ? (LONG)m_cbMaxChunk : 0;
+}
+
+HRESULT CParserChunkIndex::GetEndEntry(int iStream, PARSER_INDEX_ENTRY *pEntry)
+{
+	// Check the pointer
+	CheckPointer(pEntry, E_POINTER);
+
+	CAutoLock lock(&m_csIndex);
+
+	DWORD iFirst, iLast;
+	if (!GetStreamRange(iStream, &iFirst, &iLast))
+		return E_FAIL;
+
+	*pEntry = m_pEntries[iLast];
+
+	return NOERROR;
+}
+
+void CParserChunkIndex::FreeEntries(void)
+{
+	if (m_pEntries) {
+		CoTaskMemFree(m_pEntries);
+		m_pEntries = NULL;
+	}
+	m_nEntries		= 0;
+	m_nMaxEntries	= 0;
+	m_cbMaxChunk	= 0;
+	ZeroMemory(m_iStreamFirst, sizeof(m_iStreamFirst));
+
+	m_bLoaded		= FALSE;
+	m_bRecording	= FALSE;
+}
+
+HRESULT CParserChunkIndex::AddEntry(const PARSER_INDEX_ENTRY *pEntry)
+{
+	// Grow the array if it's full
+	if (m_nEntries == m_nMaxEntries) {
+
+		if (m_nMaxEntries >= PARSER_INDEX_MAX_ENTRIES)
+			return E_OUTOFMEMORY;
+
+		DWORD nMaxEntries = (m_nMaxEntries) ? 2 * m_nMaxEntries : 1024;
+		PARSER_INDEX_ENTRY *pEntries = (PARSER_INDEX_ENTRY*)CoTaskMemRealloc(
+			m_pEntries,
+			nMaxEntries * sizeof(PARSER_INDEX_ENTRY)
+		);
+		if (pEntries == NULL)
+			return E_OUTOFMEMORY;
+
+		m_pEntries		= pEntries;
+		m_nMaxEntries	= nMaxEntries;
+	}
+
+	m_pEntries[m_nEntries++] = *pEntry;
+
+	return NOERROR;
+}
+
+HRESULT CParserChunkIndex::BuildIndex(void)
+{
+	if (m_nEntries == 0)
+		return E_FAIL;
+
+	// Sort the entries by stream and time
+	qsort(m_pEntries, m_nEntries, sizeof(PARSER_INDEX_ENTRY), CompareIndexEntries);
+
+	// Find out the stream ranges
+	DWORD iEntry = 0;
+	for (int i = 0; i <= PARSER_INDEX_MAX_STREAMS; i++) {
+		while ((iEntry < m_nEntries) && (m_pEntries[iEntry].wStream < i))
+			iEntry++;
+		m_iStreamFirst[i] = iEntry;
+	}
+
+	// Every entry should belong to a known stream
+	if (m_iStreamFirst[PARSER_INDEX_MAX_STREAMS] != m_nEntries)
+		return E_UNEXPECTED;
+
+	// Link the entries to their key entries
+	for (iEntry = 0; iEntry < m_nEntries; iEntry++) {
+		PARSER_INDEX_ENTRY *pEntry = &m_pEntries[iEntry];
+		if (pEntry->wFlags & PARSER_INDEX_KEYFRAME)
+			pEntry->iKeyEntry = iEntry;
+		else if (
+			(iEntry > 0) &&
+			(m_pEntries[iEntry - 1].wStream == pEntry->wStream)
+		)
+			pEntry->iKeyEntry = m_pEntries[iEntry - 1].iKeyEntry;
+		else
+			pEntry->iKeyEntry = PARSER_INDEX_NO_KEY;
+	}
+
+	return NOERROR;
+}
+
+HRESULT CParserChunkIndex::LoadIndex(void)
+{
+	HANDLE hFile = CreateFileW(
+		m_wszIndexFile,
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		NULL,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+		NULL
+	);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return HRESULT_FROM_WIN32(GetLastError());
+
+	// Read and check the header
+	PARSER_INDEX_HEADER header;
+	DWORD cbRead = 0;
+	if (
+		(!ReadFile(hFile, &header, sizeof(PARSER_INDEX_HEADER), &cbRead, NULL))	||
+		(cbRead								!= sizeof(PARSER_INDEX_HEADER))		||
+		(header.dwSignature					!= PARSER_INDEX_SIGNATURE)			||
+		(header.dwVersion					!= PARSER_INDEX_VERSION)			||
+		(!IsEqualCLSID(header.clsFilter, m_clsFilter))							||
+		(header.llFileSize					!= m_llFileSize)					||
+		(CompareFileTime(&header.ftLastWrite, &m_ftLastWrite) != 0)				||
+		(header.nEntries					== 0)								||
+		(header.nEntries					> PARSER_INDEX_MAX_ENTRIES)			||
+		(header.cbMaxChunk					> MAXLONG)
+	) {
+		CloseHandle(hFile);
+		return VFW_E_INVALID_FILE_FORMAT;
+	}
+
+	// Read the entries
+	DWORD cbEntries = header.nEntries * sizeof(PARSER_INDEX_ENTRY);
+	m_pEntries = (PARSER_INDEX_ENTRY*)CoTaskMemAlloc(cbEntries);
+	if (m_pEntries == NULL) {
+		CloseHandle(hFile);
+		return E_OUTOFMEMORY;
+	}
+	m_nEntries		= header.nEntries;
+	m_nMaxEntries	= header.nEntries;
+	m_cbMaxChunk	= header.cbMaxChunk;
+	BOOL bRead = ReadFile(hFile, m_pEntries, cbEntries, &cbRead, NULL);
+	CloseHandle(hFile);
+	if ((!bRead) || (cbRead != cbEntries)) {
+		FreeEntries();
+		return VFW_E_INVALID_FILE_FORMAT;
+	}
+
+	// Rebuild the stream ranges and the key entry links
+	HRESULT hr = BuildIndex();
+	if (FAILED(hr)) {
+		FreeEntries();
+		return hr;
+	}
+
+	m_bLoaded = TRUE;
+
+	return NOERROR;
+}
+
+HRESULT CParserChunkIndex::SaveIndex(void)
+{
+	// Overwrite the stale index (if any)
+	HANDLE hFile = CreateFileW(
+		m_wszIndexFile,
+		GENERIC_WRITE,
+		0,
+		NULL,
+		CREATE_ALWAYS,
+		FILE_ATTRIBUTE_NORMAL,
+		NULL
+	);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return HRESULT_FROM_WIN32(GetLastError());
+
+	PARSER_INDEX_HEADER header;
+	ZeroMemory(&header, sizeof(PARSER_INDEX_HEADER));
+	header.dwSignature	= PARSER_INDEX_SIGNATURE;
+	header.dwVersion	= PARSER_INDEX_VERSION;
+	header.clsFilter	= m_clsFilter;
+	header.llFileSize	= m_llFileSize;
+	header.ftLastWrite	= m_ftLastWrite;
+	header.nEntries		= m_nEntries;
+	header.cbMaxChunk	= m_cbMaxChunk;
+
+	// A partially written index file is rejected by LoadIndex(),
+	// so there's no need to clean it up on failure
+	DWORD cbEntries = m_nEntries * sizeof(PARSER_INDEX_ENTRY);
+	DWORD cbWritten = 0;
+	BOOL bWritten = (
+		(WriteFile(hFile, &header, sizeof(PARSER_INDEX_HEADER), &cbWritten, NULL))	&&
+		(cbWritten == sizeof(PARSER_INDEX_HEADER))									&&
+		(WriteFile(hFile, m_pEntries, cbEntries, &cbWritten, NULL))					&&
+		(cbWritten == cbEntries)
+	);
+	CloseHandle(hFile);
+
+	return (bWritten) ? NOERROR : E_FAIL;
+}
+
+BOOL CParserChunkIndex::GetStreamRange(int iStream, DWORD *piFirst, DWORD *piLast)
+{
+	if ((!m_bLoaded) || (iStream < 0) || (iStream >= PARSER_INDEX_MAX_STREAMS))
+		return FALSE;
+
+	if (m_iStreamFirst[iStream] == m_iStreamFirst[iStream + 1])
+		return FALSE;
+
+	*piFirst	= m_iStreamFirst[iStream];
+	*piLast		= m_iStreamFirst[iStream + 1] - 1;
+
+	return TRUE;
+}
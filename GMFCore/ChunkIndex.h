@@ -0,0 +1,244 @@
+//==========================================================================
+//
+// File: ChunkIndex.h
+//
+// Desc: Game Media Formats - Header file for persistent chunk index
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#ifndef __GMF_CHUNK_INDEX_H__
+#define __GMF_CHUNK_INDEX_H__
+
+#include <streams.h>
+
+// Index file signature ("GMFI") and version
+#define PARSER_INDEX_SIGNATURE		0x49464D47
+#define PARSER_INDEX_VERSION		1
+
+// Extension of the index file
+#define PARSER_INDEX_EXTENSION		L".gmfidx"
+
+// Maximum number of streams (output pins) the index keeps track of
+#define PARSER_INDEX_MAX_STREAMS	8
+
+// Maximum number of the index entries (the recording is given
+// up if the file has more chunks than that)
+#define PARSER_INDEX_MAX_ENTRIES	0x100000
+
+// Chunk type of the entry marking the stream end
+#define PARSER_INDEX_STREAM_END		0xFFFFFFFF
+
+// Index entry flags
+#define PARSER_INDEX_KEYFRAME		0x0001
+
+// No key entry before the entry
+#define PARSER_INDEX_NO_KEY			0xFFFFFFFF
+
+//==========================================================================
+// Index file structures
+//==========================================================================
+
+#pragma pack(1)
+
+typedef struct tagPARSER_INDEX_HEADER {
+	DWORD		dwSignature;	// PARSER_INDEX_SIGNATURE
+	DWORD		dwVersion;		// PARSER_INDEX_VERSION
+	CLSID		clsFilter;		// CLSID of the filter which made the index
+	LONGLONG	llFileSize;		// Size of the indexed file
+	FILETIME	ftLastWrite;	// Last write time of the indexed file
+	DWORD		nEntries;		// Number of entries following the header
+	DWORD		cbMaxChunk;		// Size of the largest outer chunk (zero if unknown)
+} PARSER_INDEX_HEADER;
+
+typedef struct tagPARSER_INDEX_ENTRY {
+	LONGLONG		llPosition;		// File position of the outer chunk the sample is parsed from
+	REFERENCE_TIME	rtTime;			// Stream time of the sample
+	LONGLONG		llMediaTime;	// Media time of the sample
+	DWORD			dwChunkType;	// Type of the (inner) chunk the sample is parsed from
+	WORD			wStream;		// Index of the output pin delivering the sample
+	WORD			wFlags;			// PARSER_INDEX_XXX flags
+	DWORD			iKeyEntry;		// Nearest key entry at or before this one (saved, but recomputed on load)
+	DWORD			dwReserved;		// Reserved (zero)
+} PARSER_INDEX_ENTRY;
+
+#pragma pack()
+
+//==========================================================================
+// Chunk index class
+//
+// Keeps the positions of the chunks the samples are parsed from along
+// with the sample times and keyframe flags, so that the filter can
+// seek in O(log n) without scanning the file. The index is recorded
+// by the filter during the first full pass over the file and saved
+// either next to the file (in "<file>.gmfidx") or in the index
+// directory set in the filter options (in "<hash>.gmfidx" where the
+// hash is taken from the file path). The index file is keyed by the
+// filter CLSID and the size and last write time of the indexed file,
+// so the index of a changed file is discarded and recorded again.
+// The entries are sorted by stream and time; one entry is kept per
+// stream per outer chunk (for the first sample parsed from the chunk)
+// and each stream ends with PARSER_INDEX_STREAM_END entry holding
+// the stream end time and the default stop position. The entries are
+// key ones if their samples are sync points or if the parser marks
+// them (the parsers which can tell the independent frames themselves)
+//==========================================================================
+
+class CParserChunkIndex
+{
+
+public:
+
+	CParserChunkIndex();
+	~CParserChunkIndex();
+
+	// Locate the index of the file and load it (if it's there and up
+	// to date). Returns S_OK if the index is loaded and S_FALSE if it
+	// should be recorded
+	HRESULT Open(
+		LPCWSTR pszFileName,		// Indexed file
+		LPCWSTR pszIndexDirectory,	// Index directory (empty or NULL for the sidecar)
+		REFCLSID clsFilter			// CLSID of the filter
+	);
+
+	// Free the index and forget the file
+	void Close(void);
+
+	// Is the index loaded (or completely recorded)?
+	BOOL IsLoaded(void);
+
+	// Is the index being recorded?
+	BOOL IsRecording(void);
+
+	// Does the stream have a key entry after the first one (so that
+	// the index is of any use for the seeking)?
+	BOOL IsSeekable(int iStream);
+
+	// ---- Recording ----
+
+	// Start recording the index (does nothing if the index is loaded
+	// or no file is open)
+	void StartRecording(void);
+
+	// Give up the recording (the recorded entries are discarded)
+	void CancelRecording(void);
+
+	// Record the delivered sample. Only the first sample of the stream
+	// parsed from the outer chunk at the specified position is recorded
+	void RecordSample(
+		int iStream,				// Index of the output pin
+		LONGLONG llPosition,		// Position of the outer chunk
+		DWORD dwChunkType,			// Type of the chunk
+		IMediaSample *pSample		// Delivered sample
+	);
+
+	// Record the position of the outer chunk header (the index keeps
+	// the largest chunk size, so that the filter can size its input 
+	// buffers without walking the file)
+	void RecordChunk(LONGLONG llPosition);
+
+	// Mark the entry of the stream at the outer chunk position as 
+	// a key one. The entry may be recorded before or after the call
+	void MarkKeyEntry(int iStream, LONGLONG llPosition);
+
+	// Complete the recording and save the index
+	HRESULT FinishRecording(LONGLONG llEndPosition);
+
+	// ---- Lookup ----
+
+	// Find the last key entry of the stream at or before the time
+	HRESULT FindKeyEntry(
+		int iStream,
+		REFERENCE_TIME rtTime,
+		PARSER_INDEX_ENTRY *pEntry
+	);
+
+	// Find the first entry of the stream at or after the time (that's
+	// the stream end entry if the time is beyond the last sample)
+	HRESULT FindEntry(
+		int iStream,
+		REFERENCE_TIME rtTime,
+		PARSER_INDEX_ENTRY *pEntry
+	);
+
+	// Find the first entry of the stream at or after the position
+	HRESULT FindPositionEntry(
+		int iStream,
+		LONGLONG llPosition,
+		PARSER_INDEX_ENTRY *pEntry
+	);
+
+	// Get the stream end entry
+	HRESULT GetEndEntry(int iStream, PARSER_INDEX_ENTRY *pEntry);
+
+	// Size of the largest outer chunk (zero if the index 
+	// is not loaded or the size is unknown)
+	LONG GetMaxChunkSize(void);
+
+protected:
+
+	CCritSec m_csIndex;				// Index state protection
+
+	// Indexed file identity
+	WCHAR m_wszIndexFile[MAX_PATH];	// Index file name (empty if no file is open)
+	CLSID m_clsFilter;				// CLSID of the filter
+	LONGLONG m_llFileSize;			// Size of the indexed file
+	FILETIME m_ftLastWrite;			// Last write time of the indexed file
+
+	// Index state
+	BOOL m_bLoaded;					// Is the index complete?
+	BOOL m_bRecording;				// Is the index being recorded?
+
+	// Entries
+	PARSER_INDEX_ENTRY *m_pEntries;	// Entries array
+	DWORD m_nEntries;				// Number of entries
+	DWORD m_nMaxEntries;			// Size of the entries array
+	DWORD m_cbMaxChunk;				// Size of the largest outer chunk
+
+	// Ranges of the sorted entries belonging to the streams
+	DWORD m_iStreamFirst[PARSER_INDEX_MAX_STREAMS + 1];
+
+	// Recording state of the streams
+	LONGLONG m_llLastPosition[PARSER_INDEX_MAX_STREAMS];	// Position of the last recorded entry
+	REFERENCE_TIME m_rtStreamEnd[PARSER_INDEX_MAX_STREAMS];	// Stream end time
+	LONGLONG m_llMediaEnd[PARSER_INDEX_MAX_STREAMS];		// Stream end media time
+	DWORD m_iLastEntry[PARSER_INDEX_MAX_STREAMS];			// Last recorded entry
+	LONGLONG m_llKeyPosition[PARSER_INDEX_MAX_STREAMS];		// Position of the key entry to come (-1 if none)
+	LONGLONG m_llLastChunk;									// Position of the last outer chunk (-1 if none)
+
+	// Free the entries
+	void FreeEntries(void);
+
+	// Append the entry to the array
+	HRESULT AddEntry(const PARSER_INDEX_ENTRY *pEntry);
+
+	// Sort the entries, find out the stream ranges and link the
+	// entries to their key entries (the lock should be held)
+	HRESULT BuildIndex(void);
+
+	// Load/save the index file (the lock should be held)
+	HRESULT LoadIndex(void);
+	HRESULT SaveIndex(void);
+
+	// Get the stream range (the lock should be held). Returns
+	// FALSE if the stream has no entries
+	BOOL GetStreamRange(int iStream, DWORD *piFirst, DWORD *piLast);
+
+};
+
+#endif
@@ -25,8 +25,11 @@
 #ifndef __GMF_CONTINUOUS_IMA_ADPCM_H__
 #define __GMF_CONTINUOUS_IMA_ADPCM_H__
 
-#include <windows.h>
+#include "CodecTypes.h"
+
+#ifdef _WIN32
 #include <initguid.h>
+#endif
 
 //==========================================================================
 // Structures
@@ -55,6 +58,8 @@ typedef struct tagCIMAADPCMWAVEFORMAT {
 
 #pragma pack()
 
+#ifdef _WIN32
+
 //==========================================================================
 // GUIDs
 //==========================================================================
@@ -88,3 +93,5 @@ DEFINE_GUID(CLSID_CIMAADPCMDecompressorPage,
 0x1b25d0bb, 0x83be, 0x4a43, 0xbb, 0x19, 0xd8, 0xb7, 0xb6, 0x66, 0xfc, 0x6e);
 
 #endif
+
+#endif
@@ -28,30 +28,6 @@
 #include "ContinuousIMAADPCMDecompressor.h"
 #include "resource.h"
 
-//==========================================================================
-// IMA ADPCM decompression macros and tables
-//==========================================================================
-
-// Extract the nibble (upper nibble for TRUE, lower one for FALSE)
-#define NIBBLE(b,n) ((n) ? (((b) & 0xF0) >> 4) : ((b) & 0x0F))
-
-const CHAR CCIMAADPCMDecompressor::g_chIndexAdjust[]=
-{ -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8 };
-
-const LONG CCIMAADPCMDecompressor::g_lStepTable[]=
-{
-	7,		8,		9,		10,		11,		12,		13,		14,		16,
-	17,		19,		21,		23,		25,		28,		31,		34,		37,
-	41,		45,		50,		55,		60,		66,		73,		80,		88,
-	97,		107,	118,	130,	143,	157,	173,	190,	209,
-	230,	253,	279,	307,	337,	371,	408,	449,	494,
-	544,	598,	658,	724,	796,	876,	963,	1060,	1166,
-	1282,	1411,	1552,	1707,	1878,	2066,	2272,	2499,	2749,
-	3024,	3327,	3660,	4026,	4428,	4871,	5358,	5894,	6484,
-	7132,	7845,	8630,	9493,	10442,	11487,	12635,	13899,	15289,
-	16818,	18500,	20350,	22385,	24623,	27086,	29794,	32767
-};
-
 //==========================================================================
 // Continuous IMA ADPCM decompressor setup data
 //==========================================================================
@@ -110,99 +86,18 @@ CCIMAADPCMDecompressor::CCIMAADPCMDecompressor(
 	LPUNKNOWN pUnk,
 	HRESULT *phr
 ) :
-	CTransformFilter(
+	CBaseDecompressorFilter(
 		NAME("Continuous IMA ADPCM Decompressor"),
 		pUnk,
 		CLSID_CIMAADPCMDecompressor
-	),
-	m_pFormat(NULL),	// No format block at this time
-	m_pInfo(NULL)		// No info array at this time
+	)
 {
 	ASSERT(phr);
 }
 
 CCIMAADPCMDecompressor::~CCIMAADPCMDecompressor()
 {
-	// Free the format block
-	if (m_pFormat) {
-		CoTaskMemFree(m_pFormat);
-		m_pFormat = NULL;
-	}
-
-	// Free the info blocks array
-	if (m_pInfo) {
-		CoTaskMemFree(m_pInfo);
-		m_pInfo = NULL;
-	}
-}
-
-void CCIMAADPCMDecompressor::DecompressNibble(
-	BYTE bCode,
-	LONG *plSample,
-	CHAR *pchIndex
-)
-{
-	// Compose sample delta
-	LONG			lDelta  = g_lStepTable[*pchIndex] >> 3; 
-	if (bCode & 1)	lDelta += g_lStepTable[*pchIndex] >> 2;
-	if (bCode & 2)	lDelta += g_lStepTable[*pchIndex] >> 1;
-	if (bCode & 4)	lDelta += g_lStepTable[*pchIndex];
-
-	// Update the current sample value
-	if (bCode & 8)
-		*plSample -= lDelta;
-	else
-		*plSample += lDelta;
-
-	// Clip the sample value (if needed)
-	if		(*plSample > 32767)		*plSample = 32767;
-    else if	(*plSample < -32768)	*plSample = -32768;
-
-	// Update the current index value
-	*pchIndex += g_chIndexAdjust[bCode];
-
-	// Clip the index value (if needed)
-	if		(*pchIndex < 0)		*pchIndex = 0;
-    else if	(*pchIndex > 88)	*pchIndex = 88;
-}
-
-void CCIMAADPCMDecompressor::Decompress(
-	BYTE *pbInput,
-	LONG lInputLength,
-	SHORT *piOutput
-)
-{
-	// Set up the first nibble to be processed
-	BOOL bIsCurrentNibbleHigh = m_pFormat->bIsHiNibbleFirst;
-
-	// Walk the input buffer until its length is exhausted
-	while (lInputLength > 0) {
-
-		// Process a nibble per channel for all channels
-		for (WORD i = 0; i < m_pFormat->nChannels; i++) {
-
-			// Decompress the current nibble code
-			DecompressNibble(
-				NIBBLE(*pbInput, bIsCurrentNibbleHigh),
-				&(m_pInfo[i].lSample),
-				&(m_pInfo[i].chIndex)
-			);
-
-			// Place the sample into the output buffer
-			*piOutput = (SHORT)m_pInfo[i].lSample;
-			piOutput++;
-
-			// Advance the current nibble
-			bIsCurrentNibbleHigh = !bIsCurrentNibbleHigh;
-			
-			// If the next nibble is what the first nibble should be
-			// then we have to advance to the next byte
-			if (bIsCurrentNibbleHigh == m_pFormat->bIsHiNibbleFirst) {
-				pbInput++;
-				lInputLength--;
-			}
-		}
-	}
+	// The decoder frees its format block and info blocks itself
 }
 
 CUnknown* WINAPI CCIMAADPCMDecompressor::CreateInstance(
@@ -226,7 +121,7 @@ STDMETHODIMP CCIMAADPCMDecompressor::NonDelegatingQueryInterface(REFIID riid, vo
 	if (riid == IID_ISpecifyPropertyPages)
 		return GetInterface((ISpecifyPropertyPages*)this, ppv);
 	else
-		return CTransformFilter::NonDelegatingQueryInterface(riid, ppv);
+		return CBaseDecompressorFilter::NonDelegatingQueryInterface(riid, ppv);
 }
 
 HRESULT CCIMAADPCMDecompressor::Transform(
@@ -264,23 +159,27 @@ HRESULT CCIMAADPCMDecompressor::Transform(
 		CIMAADPCMWAVEFORMAT *pFormat = (CIMAADPCMWAVEFORMAT*)pmt->pbFormat;
 
 		// Set the new initial parameters
-		for (WORD i = 0; i < m_pFormat->nChannels; i++) {
-			m_pInfo[i].lSample = pFormat->pInit[i].lSample;
-			m_pInfo[i].chIndex = pFormat->pInit[i].chIndex;
-		}
+		m_Decoder.SetInitialState(pFormat->pInit);
 
 		// Delete media type
 		DeleteMediaType(pmt);
 	}
 
+	// Set up the output frame descriptor
+	GMF_FRAME frame;
+	ZeroMemory(&frame, sizeof(GMF_FRAME));
+	frame.pbBuffer	= pbOutBuffer;
+	frame.cbBuffer	= (DWORD)pOut->GetSize();
+
 	// Decompress the input buffer to the output one
-	Decompress(pbInBuffer, lInDataLength, (SHORT*)pbOutBuffer);
+	hr = m_Decoder.Decode(pbInBuffer, (DWORD)lInDataLength, frame);
+	if (FAILED(hr))
+		return hr;
 
 	// Set the data length for the output sample.
 	// Output samples's data length is four times 
 	// larger the input's one
-	LONG lOutDataLength = lInDataLength * 4;
-	hr = pOut->SetActualDataLength(lOutDataLength);
+	hr = pOut->SetActualDataLength((LONG)frame.cbData);
 	if (FAILED(hr))
 		return hr;
 
@@ -333,15 +232,8 @@ HRESULT CCIMAADPCMDecompressor::SetMediaType(
 		CheckPointer(pmt, E_POINTER);
 		ValidateReadPtr(pmt, sizeof(CMediaType));
 
-		// Free the old format block and allocate a new one
-		if (m_pFormat)
-			CoTaskMemFree(m_pFormat);
-		m_pFormat = (CIMAADPCMWAVEFORMAT*)CoTaskMemAlloc(pmt->FormatLength());
-		if (m_pFormat == NULL)
-			return E_OUTOFMEMORY;
-
-		// Copy format block to the allocated storage
-		CopyMemory(m_pFormat, pmt->Format(), pmt->FormatLength());
+		// Pass the format block to the decoder
+		return m_Decoder.SetFormat((CIMAADPCMWAVEFORMAT*)pmt->Format(), pmt->FormatLength());
 	}
 
 	return NOERROR;
@@ -352,10 +244,7 @@ HRESULT CCIMAADPCMDecompressor::BreakConnect(PIN_DIRECTION dir)
 	// Catch only the input pin disconnection
 	if (dir == PINDIR_INPUT) {
 		// Free the format block
-		if (m_pFormat) {
-			CoTaskMemFree(m_pFormat);
-			m_pFormat = NULL;
-		}
+		m_Decoder.ResetFormat();
 	}
 
 	return NOERROR;
@@ -410,7 +299,8 @@ HRESULT CCIMAADPCMDecompressor::GetMediaType(
 	ValidateWritePtr(pMediaType, sizeof(CMediaType));
 
 	// At this time we should have the format block
-	if (!m_pFormat)
+	const CIMAADPCMWAVEFORMAT *pFormat = m_Decoder.GetFormat();
+	if (!pFormat)
 		return E_UNEXPECTED;
 
 	if (iPosition < 0)
@@ -421,9 +311,9 @@ HRESULT CCIMAADPCMDecompressor::GetMediaType(
 		// Prepare the format block
 		WAVEFORMATEX wfex		= {0};
 		wfex.wFormatTag			= WAVE_FORMAT_PCM;
-		wfex.nChannels			= m_pFormat->nChannels;
-		wfex.nSamplesPerSec		= m_pFormat->nSamplesPerSec;
-		wfex.wBitsPerSample		= m_pFormat->wBitsPerSample;
+		wfex.nChannels			= pFormat->nChannels;
+		wfex.nSamplesPerSec		= pFormat->nSamplesPerSec;
+		wfex.wBitsPerSample		= pFormat->wBitsPerSample;
 		wfex.nBlockAlign		= (wfex.nChannels * wfex.wBitsPerSample) / 8;
 		wfex.nAvgBytesPerSec	= wfex.nSamplesPerSec * wfex.nBlockAlign;
 		wfex.cbSize				= 0;
@@ -479,7 +369,7 @@ HRESULT CCIMAADPCMDecompressor::DecideBufferSize(
 	// Set the properties: output buffer is four times larger 
 	// then the input one, the buffers amount is the same and 
 	// we don't care about alignment and prefix
-	pProperties->cbBuffer = max(pProperties->cbBuffer, apInput.cbBuffer * 4);
+	pProperties->cbBuffer = max(pProperties->cbBuffer, (LONG)m_Decoder.GetMaxOutputSize((DWORD)apInput.cbBuffer));
 	pProperties->cBuffers = max(pProperties->cBuffers, apInput.cBuffers);
 	ALLOCATOR_PROPERTIES apActual;
 	hr = pAlloc->SetProperties(pProperties, &apActual);
@@ -495,32 +385,32 @@ HRESULT CCIMAADPCMDecompressor::DecideBufferSize(
 
 HRESULT CCIMAADPCMDecompressor::StartStreaming(void)
 {
-	// We should have the format block at this time
-	if (m_pFormat == NULL)
-		return E_UNEXPECTED;
-
-	// Allocate info blocks array
-	m_pInfo = (CIMAADPCMINFO*)CoTaskMemAlloc(m_pFormat->nChannels * sizeof(CIMAADPCMINFO));
-	if (m_pInfo == NULL)
-		return E_OUTOFMEMORY;
-
-	// Set the initial sample and index values
-	CopyMemory(m_pInfo, m_pFormat->pInit, m_pFormat->nChannels * sizeof(CIMAADPCMINFO));
-
-	return NOERROR;
+	// Allocate info blocks array and set 
+	// the initial sample and index values
+	return m_Decoder.Initialize();
 }
 
 HRESULT CCIMAADPCMDecompressor::StopStreaming(void)
 {
 	// Free the info blocks array
-	if (m_pInfo) {
-		CoTaskMemFree(m_pInfo);
-		m_pInfo = NULL;
-	}
+	m_Decoder.Cleanup();
 
 	return NOERROR;
 }
 
+HRESULT CCIMAADPCMDecompressor::EndFlush(void)
+{
+	// The flush is usually caused by the seek, so the samples to 
+	// come do not continue the decoded ones. Restart the decoder 
+	// from the initial sample and index values
+	const CIMAADPCMWAVEFORMAT *pFormat = m_Decoder.GetFormat();
+	if (pFormat != NULL)
+		m_Decoder.SetInitialState(pFormat->pInit);
+
+	// Call the base-class method
+	return CTransformFilter::EndFlush();
+}
+
 STDMETHODIMP CCIMAADPCMDecompressor::GetPages(CAUUID *pPages)
 {
 	// Check and validate the pointer
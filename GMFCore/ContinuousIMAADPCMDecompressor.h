@@ -30,26 +30,20 @@
 
 #include <streams.h>
 
+#include "BaseDecompressor.h"
 #include "ContinuousIMAADPCM.h"
+#include "ContinuousIMAADPCMDecoder.h"
 
 //==========================================================================
 // Continuous IMA ADPCM decompressor filter class
 //==========================================================================
 
-class CCIMAADPCMDecompressor :	public CTransformFilter,
+class CCIMAADPCMDecompressor :	public CBaseDecompressorFilter,
 								public ISpecifyPropertyPages
 {
 
-	// ---- IMA ADPCM decompression tables ----
-
-	static const CHAR g_chIndexAdjust[];
-	static const LONG g_lStepTable[];
-
-	// Format block
-	CIMAADPCMWAVEFORMAT *m_pFormat;
-
-	// Current decompressor state (array of info blocks)
-	CIMAADPCMINFO *m_pInfo;
+	// Platform-neutral Continuous IMA ADPCM decoder
+	CCIMAADPCMDecoder m_Decoder;
 
 	// Constructor
 	CCIMAADPCMDecompressor(LPUNKNOWN pUnk, HRESULT *phr);
@@ -57,17 +51,6 @@ class CCIMAADPCMDecompressor :	public CTransformFilter,
 	// Destructor
 	~CCIMAADPCMDecompressor();
 
-	// Utility decompression method. Note that this method relies
-	// on the pointers' validity and does not check them
-	void DecompressNibble(BYTE bCode, LONG *plSample, CHAR *pchIndex);
-
-	// Actual decompression method. Note that you should supply 
-	// to this method the compressed data block containing the 
-	// integral number of (uncompressed) samples. That means 
-	// the compressed data block should have the length being
-	// the multiple of ((nChannels * 2) / 4) bytes
-	void Decompress(BYTE *pbInput, LONG lInputLength, SHORT *piOutput);
-
 public:
 
 	static CUnknown* WINAPI CreateInstance(LPUNKNOWN pUnk, HRESULT *phr);
@@ -87,6 +70,7 @@ public:
 	HRESULT DecideBufferSize(IMemAllocator *pAlloc, ALLOCATOR_PROPERTIES *pProperties);
 	HRESULT StartStreaming(void);
 	HRESULT StopStreaming(void);
+	HRESULT EndFlush(void);
 
 	// ISpecifyPropertyPages method
     STDMETHODIMP GetPages(CAUUID *pPages);
@@ -25,8 +25,7 @@
 #ifndef __GMF_FST_SPECS_H__
 #define __GMF_FST_SPECS_H__
 
-#include <windows.h>
-#include <mmsystem.h>
+#include "CodecTypes.h"
 
 //==========================================================================
 // Constants
@@ -105,14 +105,6 @@ const AMOVIESETUP_FILTER g_sudFSTSplitter = {
 // FST splitter file type setup data
 //==========================================================================
 
-const GMF_FILETYPE_PATTERN sudFSTPatterns[] = {
-	{ 0,	4,	FST_IDSTR_2TSF	}
-};
-
-const GMF_FILETYPE_ENTRY sudFSTEntries[] = {
-	{ 1, sudFSTPatterns } 
-};
-
 const TCHAR *sudFSTExtensions[] = {
 	TEXT(".fst")
 };
@@ -210,6 +202,9 @@ HRESULT CFSTChunkParser::ParseChunkHeader(
 	m_pSample = NULL;
 	m_rtDelta = 0;
 	m_llDelta = 0;
+
+	// Chunks have no headers, so the data is right at the start position
+	LONGLONG llDataPosition = llStartPosition;
 	
 	// Adjust data start position to video/audio stream start
 	llStartPosition -= sizeof(FST_HEADER) + m_nVideoFrames * sizeof(FST_FRAME_ENTRY);
@@ -284,21 +279,8 @@ HRESULT CFSTChunkParser::ParseChunkHeader(
 		return NOERROR;
 	}
 
-	// Get an empty sample from the output pin
-	HRESULT hr = m_pPin->GetDeliveryBuffer(&m_pSample, NULL, NULL, 0);
-	if (FAILED(hr)) {
-		m_pSample = NULL;
-		return hr;
-	}
-
-	hr = m_pSample->SetActualDataLength(0);
-	if (FAILED(hr)) {
-		m_pSample->Release();
-		m_pSample = NULL;
-		return hr;
-	}
-
-	return NOERROR;
+	// Get an empty sample for the chunk data
+	return GetChunkSample(m_pPin, llDataPosition, *plDataSize, &m_pSample);
 }
 
 HRESULT CFSTChunkParser::ParseChunkData(
@@ -314,33 +296,14 @@ HRESULT CFSTChunkParser::ParseChunkData(
 	if (!m_pSample)
 		return NOERROR;
 
-	// Get the sample's buffer
-	BYTE *pbBuffer = NULL;
-	HRESULT hr = m_pSample->GetPointer(&pbBuffer);
-	if (FAILED(hr)) {
+	// Append data to the sample
+	HRESULT hr = AppendChunkData(m_pSample, pbData, lDataSize);
+	if (FAILED(hr) && (hr != VFW_E_BUFFER_OVERFLOW)) {
 		m_pSample->Release();
 		m_pSample = NULL;
-		return hr;
-	}
-
-	// Find out how many bytes we can copy
-	LONG lBufferSize = m_pSample->GetSize();
-	LONG lActualDataLength = m_pSample->GetActualDataLength();
-	LONG lDataToCopy = min(lDataSize, lBufferSize - lActualDataLength);
-
-	// Copy data to buffer
-	CopyMemory(pbBuffer + lActualDataLength, pbData, lDataToCopy);
-	lActualDataLength += lDataToCopy;
-
-	// Update buffer's actual data length
-	hr = m_pSample->SetActualDataLength(lActualDataLength);
-	if (FAILED(hr)) {
-		m_pSample->Release();
-		m_pSample = NULL;
-		return hr;
 	}
 
-	return (lDataToCopy < lDataSize) ? VFW_E_BUFFER_OVERFLOW : NOERROR;
+	return hr;
 }
 
 HRESULT CFSTChunkParser::ParseChunkEnd(void)
@@ -524,7 +487,7 @@ HRESULT CFSTSplitterFilter::Initialize(IPin *pPin, IAsyncReader *pReader)
 	// Set the video allocator properties
 	papVideo->cbAlign	= 0;	// No matter
 	papVideo->cbPrefix	= 0;	// No matter
-	papVideo->cBuffers	= 4;	// TEMP: No need to set larger value?
+	papVideo->cBuffers	= 4;	// Default (the pin option may override it)
 	papVideo->cbBuffer	= cbMaxImage;
 
 	// Allocate time formats array. If we fail here, it's not an error, 
@@ -0,0 +1,164 @@
+//==========================================================================
+//
+// File: FileTypePatterns.cpp
+//
+// Desc: Game Media Formats - File type patterns of the parsers & splitters
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#include "FileTypePatterns.h"
+#include "APCSpecs.h"
+#include "FSTSpecs.h"
+#include "HNMSpecs.h"
+#include "MVESpecs.h"
+#include "ROQSpecs.h"
+#include "VMDSpecs.h"
+#include "VQASpecs.h"
+
+//==========================================================================
+// APC parser file type patterns
+//==========================================================================
+
+const GMF_FILETYPE_PATTERN sudAPCPatterns[] = {
+	{ 0,	4,	APC_IDSTR_CRYO	},
+	{ 4,	4,	APC_IDSTR_APC	},
+	{ 8,	4,	APC_IDSTR_VER	}
+};
+
+const GMF_FILETYPE_ENTRY sudAPCEntries[] = {
+	{ 3, sudAPCPatterns }
+};
+
+//==========================================================================
+// FST splitter file type patterns
+//==========================================================================
+
+const GMF_FILETYPE_PATTERN sudFSTPatterns[] = {
+	{ 0,	4,	FST_IDSTR_2TSF	}
+};
+
+const GMF_FILETYPE_ENTRY sudFSTEntries[] = {
+	{ 1, sudFSTPatterns }
+};
+
+//==========================================================================
+// HNM splitter file type patterns
+//==========================================================================
+
+const GMF_FILETYPE_PATTERN sudHNMPatterns[] = {
+	{ 0,	4,	HNM_IDSTR_HNM6		},
+	{ 0x20,	16,	HNM_IDSTR_RND		},
+	{ 0x30,	16,	HNM_IDSTR_COPYRIGHT	}
+};
+
+const GMF_FILETYPE_ENTRY sudHNMEntries[] = {
+	{ 3, sudHNMPatterns }
+};
+
+//==========================================================================
+// MVE splitter file type patterns
+//==========================================================================
+
+const GMF_FILETYPE_PATTERN sudMVEPatterns[] = {
+	{ 0,	20,	MVE_IDSTR_MVE		},
+	{ 20,	2,	MVE_IDSTR_MAGIC1	},
+	{ 22,	2,	MVE_IDSTR_MAGIC2	},
+	{ 24,	2,	MVE_IDSTR_MAGIC3	}
+};
+
+const GMF_FILETYPE_ENTRY sudMVEEntries[] = {
+	{ 4, sudMVEPatterns }
+};
+
+//==========================================================================
+// ROQ splitter file type patterns
+//==========================================================================
+
+const GMF_FILETYPE_PATTERN sudROQPatterns[] = {
+	{ 0,	2,	ROQ_IDSTR_ID		},
+	{ 2,	4,	ROQ_IDSTR_SIZE		}
+};
+
+const GMF_FILETYPE_ENTRY sudROQEntries[] = {
+	{ 2, sudROQPatterns }
+};
+
+//==========================================================================
+// VMD splitter file type patterns
+//==========================================================================
+
+const GMF_FILETYPE_PATTERN sudVMDPatterns[] = {
+	{ 0,	2,	VMD_IDSTR_HEADERSIZE	}
+};
+
+const GMF_FILETYPE_ENTRY sudVMDEntries[] = {
+	{ 1, sudVMDPatterns }
+};
+
+//==========================================================================
+// VQA splitter file type patterns
+//==========================================================================
+
+const GMF_FILETYPE_PATTERN sudVQAPatterns[] = {
+	{ 0,	4,	VQA_IDSTR_FORM	},
+	{ 8,	4,	VQA_IDSTR_WVQA	}
+};
+
+const GMF_FILETYPE_ENTRY sudVQAEntries[] = {
+	{ 2, sudVQAPatterns }
+};
+
+//==========================================================================
+// Formats list
+//==========================================================================
+
+const GMF_FILETYPE_FORMAT g_FileTypeFormats[] = {
+	{ "APC",	1,	sudAPCEntries	},
+	{ "FST",	1,	sudFSTEntries	},
+	{ "HNM",	1,	sudHNMEntries	},
+	{ "MVE",	1,	sudMVEEntries	},
+	{ "ROQ",	1,	sudROQEntries	},
+	{ "VMD",	1,	sudVMDEntries	},
+	{ "VQA",	1,	sudVQAEntries	}
+};
+
+const int g_nFileTypeFormats = sizeof(g_FileTypeFormats) / sizeof(g_FileTypeFormats[0]);
+
+//==========================================================================
+// Pattern matching
+//==========================================================================
+
+BOOL MatchFileTypeEntry(
+	const GMF_FILETYPE_ENTRY *pEntry,
+	const BYTE *pbData,
+	LONG cbData
+)
+{
+	for (UINT i = 0; i < pEntry->nPatterns; i++) {
+
+		const GMF_FILETYPE_PATTERN *pPattern = &pEntry->pPattern[i];
+
+		if (pPattern->lOffset + pPattern->cbPattern > cbData)
+			return FALSE;
+		if (memcmp(pbData + pPattern->lOffset, pPattern->szValue, pPattern->cbPattern) != 0)
+			return FALSE;
+	}
+
+	return TRUE;
+}
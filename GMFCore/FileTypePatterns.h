@@ -0,0 +1,80 @@
+//==========================================================================
+//
+// File: FileTypePatterns.h
+//
+// Desc: Game Media Formats - Header file for file type patterns
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#ifndef __GMF_FILETYPE_PATTERNS_H__
+#define __GMF_FILETYPE_PATTERNS_H__
+
+// The patterns are shared by the filters registration (where they go
+// to the Media Type\Extensions registry key) and the standalone format
+// probe, so this header does not depend on DirectShow
+#include "CodecTypes.h"
+
+//==========================================================================
+// File type pattern structures
+//==========================================================================
+
+typedef struct tagGMF_FILETYPE_PATTERN {
+	LONG		lOffset;	// Pattern offset
+	LONG		cbPattern;	// Pattern length
+	const char	*szValue;	// Pattern value
+} GMF_FILETYPE_PATTERN;
+
+typedef struct tagGMF_FILETYPE_ENTRY {
+	UINT nPatterns;							// Number of patterns
+	const GMF_FILETYPE_PATTERN *pPattern;	// Array of patterns
+} GMF_FILETYPE_ENTRY;
+
+// Format detected by a set of entries (used by the probe which
+// does not know about the filters registration info)
+typedef struct tagGMF_FILETYPE_FORMAT {
+	const char *szName;					// Short format name
+	UINT nEntries;						// Number of entries
+	const GMF_FILETYPE_ENTRY *pEntry;	// Array of entries
+} GMF_FILETYPE_FORMAT;
+
+//==========================================================================
+// File type patterns of the parsers & splitters
+//==========================================================================
+
+extern const GMF_FILETYPE_ENTRY sudAPCEntries[];
+extern const GMF_FILETYPE_ENTRY sudFSTEntries[];
+extern const GMF_FILETYPE_ENTRY sudHNMEntries[];
+extern const GMF_FILETYPE_ENTRY sudMVEEntries[];
+extern const GMF_FILETYPE_ENTRY sudROQEntries[];
+extern const GMF_FILETYPE_ENTRY sudVMDEntries[];
+extern const GMF_FILETYPE_ENTRY sudVQAEntries[];
+
+// All formats having patterns (CIN files have no signature,
+// so CIN is not on the list)
+extern const GMF_FILETYPE_FORMAT g_FileTypeFormats[];
+extern const int g_nFileTypeFormats;
+
+// Does the data (the file starting bytes) match all patterns of the entry?
+BOOL MatchFileTypeEntry(
+	const GMF_FILETYPE_ENTRY *pEntry,
+	const BYTE *pbData,
+	LONG cbData
+);
+
+#endif
@@ -0,0 +1,120 @@
+//==========================================================================
+//
+// File: FilterStatistics.h
+//
+// Desc: Game Media Formats - Interface to query filter performance counters
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#ifndef __GMF_FILTER_STATISTICS_H__
+#define __GMF_FILTER_STATISTICS_H__
+
+#include <windows.h>
+#include <initguid.h>
+#include <basetyps.h>
+
+//
+// Filter statistics interface
+//
+// {6B1D3C52-8E0A-4F7B-A1C4-3D9E52F07B18}
+DEFINE_GUID(IID_IFilterStatistics,
+0x6b1d3c52, 0x8e0a, 0x4f7b, 0xa1, 0xc4, 0x3d, 0x9e, 0x52, 0xf0, 0x7b, 0x18);
+
+// Buffer request taking longer than this (in 100 ns units)
+// is counted as an allocator wait
+#define GMF_STATISTICS_WAIT_THRESHOLD	10000
+
+// Maximum number of chunk types counted by a parser
+#define GMF_STATISTICS_MAX_CHUNK_TYPES	32
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Filter-wide counters. All times are in 100 ns units.
+// The processing time is the time spent in Receive() of the
+// parser (which includes the buffer waits and delivery to the
+// output queues) or in Transform() of the decompressor. The input
+// stalls are counted by the parser's read-ahead only
+typedef struct tagGMF_FILTER_STATISTICS {
+	LONGLONG	llBytesReceived;		// Input data bytes parsed/decoded
+	LONGLONG	llSamplesReceived;		// Input samples received
+	LONGLONG	llSamplesRejected;		// Input samples rejected (or skipped)
+	LONGLONG	llSamplesDelivered;		// Output samples delivered (all pins)
+	LONGLONG	llProcessingTime;		// Time spent in Receive()/Transform()
+	LONGLONG	llDeliveryTime;			// Time spent delivering downstream
+	LONGLONG	llAllocatorWaits;		// Number of waits for output buffers
+	LONGLONG	llAllocatorWaitTime;	// Time spent getting output buffers
+	LONGLONG	llInputStalls;			// Number of waits for input data
+	LONGLONG	llInputStallTime;		// Time spent waiting for input data
+} GMF_FILTER_STATISTICS;
+
+// Output pin counters
+typedef struct tagGMF_PIN_STATISTICS {
+	LONGLONG	llSamplesDelivered;		// Samples delivered
+	LONGLONG	llBytesDelivered;		// Data bytes delivered
+	LONGLONG	llDeliveryTime;			// Time spent delivering downstream
+	LONGLONG	llAllocatorWaits;		// Number of waits for output buffers
+	LONGLONG	llAllocatorWaitTime;	// Time spent getting output buffers
+	LONG		lQueueDepth;			// Samples currently in the output queue
+	LONG		lMaxQueueDepth;			// Maximum output queue depth seen
+} GMF_PIN_STATISTICS;
+
+// Per-chunk-type counters. The chunk type values are
+// format-specific (chunk IDs as they're stored in the file)
+typedef struct tagGMF_CHUNK_STATISTICS {
+	DWORD		dwChunkType;			// Chunk type
+	LONGLONG	llChunks;				// Number of chunks parsed
+	LONGLONG	llBytes;				// Chunk bytes parsed (with headers)
+} GMF_CHUNK_STATISTICS;
+
+DECLARE_INTERFACE_(IFilterStatistics, IUnknown)
+{
+	STDMETHOD(GetStatistics) (THIS_ GMF_FILTER_STATISTICS *pStatistics) PURE;
+	STDMETHOD(GetOutputPinStatistics) (THIS_ int iPin, GMF_PIN_STATISTICS *pStatistics) PURE;
+	STDMETHOD(GetChunkTypeCount) (THIS_ int *pnCount) PURE;
+	STDMETHOD(GetChunkStatistics) (THIS_ int iType, GMF_CHUNK_STATISTICS *pStatistics) PURE;
+	STDMETHOD(ResetStatistics) (THIS) PURE;
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+// Current time for the statistics counters (in 100 ns units)
+inline LONGLONG GetStatisticsTime(void)
+{
+	static LONGLONG llFrequency = 0;
+
+	LARGE_INTEGER liCounter;
+	if (llFrequency == 0) {
+		LARGE_INTEGER liFrequency;
+		if (!QueryPerformanceFrequency(&liFrequency))
+			return 0;
+		llFrequency = liFrequency.QuadPart;
+	}
+	QueryPerformanceCounter(&liCounter);
+
+	// Split the conversion to avoid the overflow
+	return
+		(liCounter.QuadPart / llFrequency) * 10000000 +
+		(liCounter.QuadPart % llFrequency) * 10000000 / llFrequency;
+}
+
+#endif
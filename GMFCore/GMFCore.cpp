@@ -69,6 +69,10 @@
 #include "H263GUID.h"
 #include "H263Parser.h"
 
+// Archive source headers
+#include "ArchiveGUID.h"
+#include "ArchiveSource.h"
+
 //==========================================================================
 // DirectShow server registration
 //==========================================================================
@@ -289,6 +293,13 @@ CFactoryTemplate g_Templates[] = {
 		CH263ParserFilter::CreateInstance,			// Creation function
 		NULL,										// Init function
 		&g_sudH263Parser							// Setup data
+	},
+	{	// Archive source
+		g_wszArchiveSourceName,						// Name
+		&CLSID_ArchiveSource,						// CLSID
+		CArchiveSourceFilter::CreateInstance,		// Creation function
+		NULL,										// Init function
+		&g_sudArchiveSource							// Setup data
 	}
 };
 
@@ -359,6 +370,13 @@ STDAPI DllRegisterServer(void)
 		return hr;
 	}
 
+	// Register protocol for archive source
+	hr = CArchiveSourceFilter::RegisterProtocol(TRUE);
+	if (FAILED(hr)) {
+		DllUnregisterServer();
+		return hr;
+	}
+
 	return NOERROR;
 }
 
@@ -454,5 +472,10 @@ STDAPI DllUnregisterServer(void)
 	if (FAILED(hr))
 		return hr;
 
+	// Unregister protocol for archive source
+	hr = CArchiveSourceFilter::RegisterProtocol(FALSE);
+	if (FAILED(hr))
+		return hr;
+
 	return NOERROR;
 }
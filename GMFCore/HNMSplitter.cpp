@@ -114,16 +114,6 @@ const AMOVIESETUP_FILTER g_sudHNMSplitter = {
 // HNM splitter file type setup data
 //==========================================================================
 
-const GMF_FILETYPE_PATTERN sudHNMPatterns[] = {
-	{ 0,	4,	HNM_IDSTR_HNM6		},
-	{ 0x20,	16,	HNM_IDSTR_RND		},
-	{ 0x30,	16,	HNM_IDSTR_COPYRIGHT	}
-};
-
-const GMF_FILETYPE_ENTRY sudHNMEntries[] = {
-	{ 3, sudHNMPatterns } 
-};
-
 const TCHAR *sudHNMExtensions[] = {
 	TEXT(".hnm"),
 	TEXT(".hns")
@@ -320,22 +310,13 @@ HRESULT CHNMInnerChunkParser::ParseChunkHeader(
 		return NOERROR;
 	}
 
-	// Get an empty sample from the output pin
-	HRESULT hr = m_pPin->GetDeliveryBuffer(&m_pSample, NULL, NULL, 0);
-	if (FAILED(hr)) {
-		m_pSample = NULL;
-		return hr;
-	}
-
-	// Initialize actual data length to zero
-	hr = m_pSample->SetActualDataLength(0);
-	if (FAILED(hr)) {
-		m_pSample->Release();
-		m_pSample = NULL;
-		return hr;
-	}
-
-	return NOERROR;
+	// Get an empty sample for the block data (except the skipped part)
+	return GetChunkSample(
+		m_pPin,
+		llStartPosition + m_lHeaderSize + m_lSkipLength,
+		*plDataSize - m_lSkipLength,
+		&m_pSample
+	);
 }
 
 HRESULT CHNMInnerChunkParser::ParseChunkData(
@@ -351,42 +332,22 @@ HRESULT CHNMInnerChunkParser::ParseChunkData(
 	if (!m_pSample)
 		return NOERROR;
 
-	// Get the sample's buffer
-	BYTE *pbBuffer = NULL;
-	HRESULT hr = m_pSample->GetPointer(&pbBuffer);
-	if (FAILED(hr)) {
-		m_pSample->Release();
-		m_pSample = NULL;
-		return hr;
-	}
-
-	// Find out how many bytes we can copy
-	LONG lBufferSize = m_pSample->GetSize();
-	LONG lActualDataLength = m_pSample->GetActualDataLength();
-	LONG lDataToCopy = min(lDataSize, lBufferSize - lActualDataLength);
-
 	// Find out how many bytes we're to ignore
-	LONG lSkip = min(m_lSkipLength, lDataToCopy);
+	LONG lSkip = min(m_lSkipLength, lDataSize);
 
-	// Update all the lengths and pointers according to skip length
+	// Update the length and pointer according to skip length
 	m_lSkipLength	-= lSkip;
 	pbData			+= lSkip;
-	lDataToCopy		-= lSkip;
 	lDataSize		-= lSkip;
 
-	// Copy data to buffer
-	CopyMemory(pbBuffer + lActualDataLength, pbData, lDataToCopy);
-	lActualDataLength += lDataToCopy;
-
-	// Update buffer's actual data length
-	hr = m_pSample->SetActualDataLength(lActualDataLength);
-	if (FAILED(hr)) {
+	// Append data to the sample
+	HRESULT hr = AppendChunkData(m_pSample, pbData, lDataSize);
+	if (FAILED(hr) && (hr != VFW_E_BUFFER_OVERFLOW)) {
 		m_pSample->Release();
 		m_pSample = NULL;
-		return hr;
 	}
 
-	return (lDataToCopy < lDataSize) ? VFW_E_BUFFER_OVERFLOW : NOERROR;
+	return hr;
 }
 
 HRESULT CHNMInnerChunkParser::ParseChunkEnd(void)
@@ -421,6 +382,15 @@ HRESULT CHNMInnerChunkParser::ParseChunkEnd(void)
 
 }
 
+BOOL CHNMInnerChunkParser::GetChunkType(const BYTE *pbHeader, DWORD *pdwType)
+{
+	// Count the blocks by their IDs (the outer chunks 
+	// are not counted)
+	*pdwType = ((HNM_BLOCK_HEADER*)pbHeader)->wBlockID;
+
+	return TRUE;
+}
+
 //==========================================================================
 // CHNMOuterChunkParser methods
 //==========================================================================
@@ -779,6 +749,42 @@ HRESULT CHNMSplitterFilter::Initialize(IPin *pPin, IAsyncReader *pReader)
 		llSeekPos += cbChunk;
 	}
 
+	// Walk the chunk headers to find out the real maximum chunk size
+	// (the one in the file header seems to be underestimated). That
+	// takes one small read per frame, so the size recorded in the 
+	// chunk index is taken instead if the index is loaded
+	DWORD cbMaxChunk = (DWORD)GetIndexMaxChunkSize();
+	DWORD iFrame = (cbMaxChunk > 0) ? videohdr.nFrames : 0;
+	llSeekPos = sizeof(HNM_HEADER);
+	for (; iFrame < videohdr.nFrames; iFrame++) {
+
+		// Align seek position
+		if (llSeekPos % 4)
+			llSeekPos += 4 - (llSeekPos % 4);
+
+		// Read chunk header
+		DWORD cbChunk = 0;
+		hr = pReader->SyncRead(llSeekPos, sizeof(DWORD), (BYTE*)&cbChunk);
+		if (
+			(hr != S_OK) ||
+			(cbChunk < sizeof(DWORD)) ||
+			(llSeekPos + cbChunk > llTotal)
+		)
+			break;
+
+		if (cbChunk > cbMaxChunk)
+			cbMaxChunk = cbChunk;
+
+		// Advance seek position
+		llSeekPos += cbChunk;
+	}
+
+	// If the walk has not reached the last frame, the header value
+	// is the best guess we have for the rest of the file (the output
+	// pins grow their buffers on demand if it's not enough)
+	if (iFrame < videohdr.nFrames)
+		cbMaxChunk = max(cbMaxChunk, videohdr.cbMaxChunk);
+
 	// Protect the filter data
 	CAutoLock datalock(&m_csData);
 
@@ -818,7 +824,7 @@ HRESULT CHNMSplitterFilter::Initialize(IPin *pPin, IAsyncReader *pReader)
 
 	// Decide on the input pin properties
 	m_cbInputAlign	= 1; // TEMP: maybe we should use actual alignment?
-	m_cbInputBuffer	= videohdr.cbMaxChunk; // TEMP: maybe we should use 0x40000 instead?
+	m_cbInputBuffer	= cbMaxChunk; // The largest chunk fits in one buffer
 
 	// Set the video stream duration
 	m_nVideoFrames = videohdr.nFrames;
@@ -876,8 +882,8 @@ HRESULT CHNMSplitterFilter::Initialize(IPin *pPin, IAsyncReader *pReader)
 	// Set the video allocator properties
 	papVideo->cbAlign	= 0;		// No matter
 	papVideo->cbPrefix	= 0;		// No matter
-	papVideo->cBuffers	= 4;		// TEMP: small value
-	papVideo->cbBuffer	= 0x40000;	// TEMP: mere guess
+	papVideo->cBuffers	= 4;			// Default (the pin option may override it)
+	papVideo->cbBuffer	= cbMaxChunk;	// Video block is never larger than its chunk
 
 	// Allocate time formats array. If we fail here, it's not an error, 
 	// we'll just set zero seeker parameters and may proceed
@@ -1022,7 +1028,7 @@ HRESULT CHNMSplitterFilter::Initialize(IPin *pPin, IAsyncReader *pReader)
 		papAudio->cbAlign	= 0;	// No matter
 		papAudio->cbPrefix	= 0;	// No matter
 		papAudio->cBuffers	= cAudioBuffers;
-		papAudio->cbBuffer	= videohdr.cbMaxChunk;	// DANGER: this might be not enough
+		papAudio->cbBuffer	= cbMaxChunk;	// Audio block is never larger than its chunk
 
 		// Set the wave format parameters needed for the calculation
 		// of sample stream and media duration
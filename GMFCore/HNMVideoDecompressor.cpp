@@ -94,7 +94,7 @@ CHNMVideoDecompressor::CHNMVideoDecompressor(
 	LPUNKNOWN pUnk,
 	HRESULT *phr
 ) :
-	CTransformFilter(
+	CBaseDecompressorFilter(
 		NAME("HNM Video Decompressor"),
 		pUnk,
 		CLSID_HNMVideoDecompressor
@@ -197,7 +197,7 @@ STDMETHODIMP CHNMVideoDecompressor::NonDelegatingQueryInterface(REFIID riid, voi
 	else if (riid == IID_ISpecifyPropertyPages)
 		return GetInterface((ISpecifyPropertyPages*)this, ppv);
 	else
-		return CTransformFilter::NonDelegatingQueryInterface(riid, ppv);
+		return CBaseDecompressorFilter::NonDelegatingQueryInterface(riid, ppv);
 }
 
 HRESULT CHNMVideoDecompressor::Transform(
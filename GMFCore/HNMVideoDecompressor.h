@@ -27,6 +27,7 @@
 
 #include <streams.h>
 
+#include "BaseDecompressor.h"
 #include "HNMSpecs.h"
 #include "HNMVideoDecompressorConfig.h"
 
@@ -34,7 +35,7 @@
 // HNM video decompressor filter class
 //==========================================================================
 
-class CHNMVideoDecompressor :	public CTransformFilter,
+class CHNMVideoDecompressor :	public CBaseDecompressorFilter,
 								public IConfigHNMVideoDecompressor,
 								public ISpecifyPropertyPages
 {
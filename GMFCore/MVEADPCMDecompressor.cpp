@@ -25,46 +25,6 @@
 #include "MVEADPCMDecompressor.h"
 #include "resource.h"
 
-//==========================================================================
-// MVE ADPCM decompression table
-//==========================================================================
-
-const SHORT CMVEADPCMDecompressor::g_iStepTable[] =
-{
-         0,      1,      2,      3,      4,      5,      6,      7,
-         8,      9,     10,     11,     12,     13,     14,     15,
-        16,     17,     18,     19,     20,     21,     22,     23,
-        24,     25,     26,     27,     28,     29,     30,     31,
-        32,     33,     34,     35,     36,     37,     38,     39,
-        40,     41,     42,     43,     47,     51,     56,     61,
-        66,     72,     79,     86,     94,    102,    112,    122,
-       133,    145,    158,    173,    189,    206,    225,    245,
-       267,    292,    318,    348,    379,    414,    452,    493,
-       538,    587,    640,    699,    763,    832,    908,    991,
-      1081,   1180,   1288,   1405,   1534,   1673,   1826,   1993,
-      2175,   2373,   2590,   2826,   3084,   3365,   3672,   4008,
-      4373,   4772,   5208,   5683,   6202,   6767,   7385,   8059,
-      8794,   9597,  10472,  11428,  12471,  13609,  14851,  16206,
-     17685,  19298,  21060,  22981,  25078,  27367,  29864,  32589,
-    -29973, -26728, -23186, -19322, -15105, -10503,  -5481,     -1,
-         1,      1,   5481,  10503,  15105,  19322,  23186,  26728,
-     29973, -32589, -29864, -27367, -25078, -22981, -21060, -19298,
-    -17685, -16206, -14851, -13609, -12471, -11428, -10472,  -9597,
-     -8794,  -8059,  -7385,  -6767,  -6202,  -5683,  -5208,  -4772,
-     -4373,  -4008,  -3672,  -3365,  -3084,  -2826,  -2590,  -2373,
-     -2175,  -1993,  -1826,  -1673,  -1534,  -1405,  -1288,  -1180,
-     -1081,   -991,   -908,   -832,   -763,   -699,   -640,   -587,
-      -538,   -493,   -452,   -414,   -379,   -348,   -318,   -292,
-      -267,   -245,   -225,   -206,   -189,   -173,   -158,   -145,
-      -133,   -122,   -112,   -102,    -94,    -86,    -79,    -72,
-       -66,    -61,    -56,    -51,    -47,    -43,    -42,    -41,
-       -40,    -39,    -38,    -37,    -36,    -35,    -34,    -33,
-       -32,    -31,    -30,    -29,    -28,    -27,    -26,    -25,
-       -24,    -23,    -22,    -21,    -20,    -19,    -18,    -17,
-       -16,    -15,    -14,    -13,    -12,    -11,    -10,     -9,
-        -8,     -7,     -6,     -5,     -4,     -3,     -2,     -1
-};
-
 //==========================================================================
 // MVE ADPCM decompressor setup data
 //==========================================================================
@@ -123,23 +83,18 @@ CMVEADPCMDecompressor::CMVEADPCMDecompressor(
 	LPUNKNOWN pUnk,
 	HRESULT *phr
 ) :
-	CTransformFilter(
+	CBaseDecompressorFilter(
 		NAME("MVE ADPCM Decompressor"),
 		pUnk,
 		CLSID_MVEADPCMDecompressor
-	),
-	m_pFormat(NULL)	// No format block at this time
+	)
 {
 	ASSERT(phr);
 }
 
 CMVEADPCMDecompressor::~CMVEADPCMDecompressor()
 {
-	// Free the format block
-	if (m_pFormat) {
-		CoTaskMemFree(m_pFormat);
-		m_pFormat = NULL;
-	}
+	// The decoder frees its format block itself
 }
 
 CUnknown* WINAPI CMVEADPCMDecompressor::CreateInstance(
@@ -163,7 +118,7 @@ STDMETHODIMP CMVEADPCMDecompressor::NonDelegatingQueryInterface(REFIID riid, voi
 	if (riid == IID_ISpecifyPropertyPages)
 		return GetInterface((ISpecifyPropertyPages*)this, ppv);
 	else
-		return CTransformFilter::NonDelegatingQueryInterface(riid, ppv);
+		return CBaseDecompressorFilter::NonDelegatingQueryInterface(riid, ppv);
 }
 
 HRESULT CMVEADPCMDecompressor::Transform(
@@ -187,56 +142,24 @@ HRESULT CMVEADPCMDecompressor::Transform(
 	LONG lInDataLength = pIn->GetActualDataLength();
 
 	// Get the output sample's buffer
-	SHORT *piOutBuffer = NULL;
-	hr = pOut->GetPointer((BYTE**)&piOutBuffer);
+	BYTE *pbOutBuffer = NULL;
+	hr = pOut->GetPointer(&pbOutBuffer);
 	if (FAILED(hr))
 		return hr;
 
-	// Set up the number of channels
-	WORD nChannels = (m_pFormat->wFlags & MVE_AUDIO_STEREO) ? 2 : 1;
-
-	// Allocate the array for current sample values
-	SHORT *piSample = new SHORT[nChannels];
-	if (piSample == NULL)
-		return E_OUTOFMEMORY;
-
-	LONG lOutDataLength = 0;
+	// Set up the output frame descriptor
+	GMF_FRAME frame;
+	ZeroMemory(&frame, sizeof(GMF_FRAME));
+	frame.pbBuffer	= pbOutBuffer;
+	frame.cbBuffer	= (DWORD)pOut->GetSize();
 
-	// Initialize sample values
-	for (WORD i = 0; i < nChannels; i++) {
-		piSample[i] = *((SHORT*)pbInBuffer);
-		pbInBuffer += 2;
-		lInDataLength -= 2;
-		*piOutBuffer++ = piSample[i];
-		lOutDataLength += 2;
-	}
-
-	// Walk the input buffer until its length is exhausted
-	while (lInDataLength > 0) {
-
-		// Process a byte per channel for all channels
-		int i = 0;
-		for (i = 0; i < nChannels; i++) {
-
-			// Calculate the current sample
-			piSample[i] += g_iStepTable[*pbInBuffer++];
-			lInDataLength--;
-
-			// Clip the sample value (if needed)
-			if		(piSample[i] > 32767)	piSample[i] = 32767;
-			else if	(piSample[i] < -32768)	piSample[i] = -32768;
-
-			// Place the sample into the output buffer
-			*piOutBuffer++ = piSample[i];
-			lOutDataLength += 2;
-		}
-	}
-
-	// Free the current sample values array
-	delete[] piSample;
+	// Decompress the input buffer to the output one
+	hr = m_Decoder.Decode(pbInBuffer, (DWORD)lInDataLength, frame);
+	if (FAILED(hr))
+		return hr;
 
 	// Set the data length for the output sample
-	hr = pOut->SetActualDataLength(lOutDataLength);
+	hr = pOut->SetActualDataLength((LONG)frame.cbData);
 	if (FAILED(hr))
 		return hr;
 
@@ -289,15 +212,8 @@ HRESULT CMVEADPCMDecompressor::SetMediaType(
 		CheckPointer(pmt, E_POINTER);
 		ValidateReadPtr(pmt, sizeof(CMediaType));
 
-		// Free the old format block and allocate a new one
-		if (m_pFormat)
-			CoTaskMemFree(m_pFormat);
-		m_pFormat = (MVE_AUDIO_INFO*)CoTaskMemAlloc(pmt->FormatLength());
-		if (m_pFormat == NULL)
-			return E_OUTOFMEMORY;
-
-		// Copy format block to the allocated storage
-		CopyMemory(m_pFormat, pmt->Format(), pmt->FormatLength());
+		// Pass the format block to the decoder
+		return m_Decoder.SetFormat((MVE_AUDIO_INFO*)pmt->Format(), pmt->FormatLength());
 	}
 
 	return NOERROR;
@@ -308,10 +224,7 @@ HRESULT CMVEADPCMDecompressor::BreakConnect(PIN_DIRECTION dir)
 	// Catch only the input pin disconnection
 	if (dir == PINDIR_INPUT) {
 		// Free the format block
-		if (m_pFormat) {
-			CoTaskMemFree(m_pFormat);
-			m_pFormat = NULL;
-		}
+		m_Decoder.ResetFormat();
 	}
 
 	return NOERROR;
@@ -366,7 +279,8 @@ HRESULT CMVEADPCMDecompressor::GetMediaType(
 	ValidateWritePtr(pMediaType, sizeof(CMediaType));
 
 	// At this time we should have the format block
-	if (!m_pFormat)
+	const MVE_AUDIO_INFO *pFormat = m_Decoder.GetFormat();
+	if (!pFormat)
 		return E_UNEXPECTED;
 
 	if (iPosition < 0)
@@ -377,9 +291,9 @@ HRESULT CMVEADPCMDecompressor::GetMediaType(
 		// Prepare the format block
 		WAVEFORMATEX wfex		= {0};
 		wfex.wFormatTag			= WAVE_FORMAT_PCM;
-		wfex.nChannels			= (m_pFormat->wFlags & MVE_AUDIO_STEREO) ? 2 : 1;
-		wfex.nSamplesPerSec		= m_pFormat->wSampleRate;
-		wfex.wBitsPerSample		= (m_pFormat->wFlags & MVE_AUDIO_16BIT) ? 16 : 8;
+		wfex.nChannels			= (pFormat->wFlags & MVE_AUDIO_STEREO) ? 2 : 1;
+		wfex.nSamplesPerSec		= pFormat->wSampleRate;
+		wfex.wBitsPerSample		= (pFormat->wFlags & MVE_AUDIO_16BIT) ? 16 : 8;
 		wfex.nBlockAlign		= (wfex.nChannels * wfex.wBitsPerSample) / 8;
 		wfex.nAvgBytesPerSec	= wfex.nSamplesPerSec * wfex.nBlockAlign;
 		wfex.cbSize				= 0;
@@ -435,7 +349,7 @@ HRESULT CMVEADPCMDecompressor::DecideBufferSize(
 	// Set the properties: output buffer is two times larger 
 	// then the input one, the buffers amount is the same and 
 	// we don't care about alignment and prefix
-	pProperties->cbBuffer = max(pProperties->cbBuffer, apInput.cbBuffer * 2);
+	pProperties->cbBuffer = max(pProperties->cbBuffer, (LONG)m_Decoder.GetMaxOutputSize((DWORD)apInput.cbBuffer));
 	pProperties->cBuffers = max(pProperties->cBuffers, apInput.cBuffers);
 	ALLOCATOR_PROPERTIES apActual;
 	hr = pAlloc->SetProperties(pProperties, &apActual);
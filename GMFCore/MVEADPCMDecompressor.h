@@ -27,21 +27,21 @@
 
 #include <streams.h>
 
+#include "BaseDecompressor.h"
 #include "MVEGUID.h"
 #include "MVESpecs.h"
+#include "MVEADPCMDecoder.h"
 
 //==========================================================================
 // MVE ADPCM decompressor filter class
 //==========================================================================
 
-class CMVEADPCMDecompressor :	public CTransformFilter,
+class CMVEADPCMDecompressor :	public CBaseDecompressorFilter,
 								public ISpecifyPropertyPages
 {
-	// Decoding step table
-	static const SHORT g_iStepTable[];
 
-	// Format block
-	MVE_AUDIO_INFO *m_pFormat;
+	// Platform-neutral MVE ADPCM decoder
+	CMVEADPCMDecoder m_Decoder;
 
 	// Constructor/destructor
 	CMVEADPCMDecompressor(LPUNKNOWN pUnk, HRESULT *phr);
@@ -27,8 +27,7 @@
 #ifndef __GMF_MVE_SPECS_H__
 #define __GMF_MVE_SPECS_H__
 
-#include <windows.h>
-#include <mmsystem.h>
+#include "CodecTypes.h"
 
 //==========================================================================
 // Constants
@@ -114,17 +114,6 @@ const AMOVIESETUP_FILTER g_sudMVESplitter = {
 // MVE splitter file type setup data
 //==========================================================================
 
-const GMF_FILETYPE_PATTERN sudMVEPatterns[] = {
-	{ 0,	20,	MVE_IDSTR_MVE		},
-	{ 20,	2,	MVE_IDSTR_MAGIC1	},
-	{ 22,	2,	MVE_IDSTR_MAGIC2	},
-	{ 24,	2,	MVE_IDSTR_MAGIC3	}
-};
-
-const GMF_FILETYPE_ENTRY sudMVEEntries[] = {
-	{ 4, sudMVEPatterns } 
-};
-
 const TCHAR *sudMVEExtensions[] = {
 	TEXT(".mve"),
 	TEXT(".mv8")
@@ -173,6 +162,7 @@ CMVEInnerChunkParser::CMVEInnerChunkParser(
 	m_llDelta(0),
 	m_bCurrentSubchunkType(0xFF),
 	m_bCurrentSubchunkSubtype(0xFF),
+	m_bSkipFrame(FALSE),
 	m_rtFrameDelta(rtFrameDelta),
 	m_nSampleSize(nSampleSize),
 	m_nAvgBytesPerSec(nAvgBytesPerSec),
@@ -296,16 +286,53 @@ HRESULT CMVEInnerChunkParser::ParseChunkHeader(
 		return NOERROR;
 	}
 
-	// Get an empty sample from the output pin
-	HRESULT hr = m_pPin->GetDeliveryBuffer(&m_pSample, NULL, NULL, 0);
-	if (FAILED(hr)) {
+	// The video data of the skipped frame is not even copied
+	// (see ParseChunkEnd())
+	if ((pHeader->bType == MVE_SUBCHUNK_VIDEODATA) && (m_bSkipFrame)) {
+		m_pPin = NULL;
 		m_pSample = NULL;
-		return hr;
+		return NOERROR;
+	}
+
+	HRESULT hr = NOERROR;
+	if (m_pPin == m_ppOutputPin[0]) {
+
+		// Video subchunks (except the timer one) are delivered with 
+		// their type/subtype, which are the last header fields, so
+		// the sample data is stored in the file as it is
+		LONG lPrefixSize = (pHeader->bType == MVE_SUBCHUNK_TIMER) ? 0 : 2;
+
+		// Get an empty sample for the subchunk data
+		hr = GetChunkSample(
+			m_pPin,
+			llStartPosition + sizeof(MVE_CHUNK_HEADER) - lPrefixSize,
+			lPrefixSize + *plDataSize,
+			&m_pSample
+		);
+		if (FAILED(hr))
+			return hr;
+
+	} else {
+
+		// Audio subchunks are post-processed in place (see 
+		// ParseChunkEnd()), so they need a buffer of their own.
+		// Get an empty sample large enough for the subchunk
+		hr = m_pPin->GetChunkBuffer(&m_pSample, *plDataSize);
+		if (FAILED(hr)) {
+			m_pSample = NULL;
+			return hr;
+		}
+
+		// Initialize actual data length
+		hr = m_pSample->SetActualDataLength(0);
+		if (FAILED(hr)) {
+			m_pSample->Release();
+			m_pSample = NULL;
+			return hr;
+		}
 	}
 
 	// Prepare the sample buffer
-	LONG cbDataLength = 0;
-	BYTE *pbBuffer = NULL;
 	switch (pHeader->bType) {
 
 		// Whatever pertains to video
@@ -317,18 +344,13 @@ HRESULT CMVEInnerChunkParser::ParseChunkHeader(
 		case MVE_SUBCHUNK_VIDEODATA:
 		case MVE_SUBCHUNK_VIDEOCMD:
 
-			// Get the sample's buffer
-			hr = m_pSample->GetPointer(&pbBuffer);
+			// Put subchunk type/subtype
+			hr = AppendChunkData(m_pSample, &pHeader->bType, 2);
 			if (FAILED(hr)) {
 				m_pSample->Release();
 				m_pSample = NULL;
 				return hr;
 			}
-
-			// Put subchunk type/subtype
-			*pbBuffer++ = pHeader->bType;
-			*pbBuffer = pHeader->bSubtype;
-			cbDataLength = 2;
 			break;
 
 		default:
@@ -337,14 +359,6 @@ HRESULT CMVEInnerChunkParser::ParseChunkHeader(
 			break;
 	}
 
-	// Initialize actual data length
-	hr = m_pSample->SetActualDataLength(cbDataLength);
-	if (FAILED(hr)) {
-		m_pSample->Release();
-		m_pSample = NULL;
-		return hr;
-	}
-
 	return NOERROR;
 }
 
@@ -361,33 +375,14 @@ HRESULT CMVEInnerChunkParser::ParseChunkData(
 	if (!m_pSample)
 		return NOERROR;
 
-	// Get the sample's buffer
-	BYTE *pbBuffer = NULL;
-	HRESULT hr = m_pSample->GetPointer(&pbBuffer);
-	if (FAILED(hr)) {
+	// Append data to the sample
+	HRESULT hr = AppendChunkData(m_pSample, pbData, lDataSize);
+	if (FAILED(hr) && (hr != VFW_E_BUFFER_OVERFLOW)) {
 		m_pSample->Release();
 		m_pSample = NULL;
-		return hr;
 	}
 
-	// Find out how many bytes we can copy
-	LONG lBufferSize = m_pSample->GetSize();
-	LONG lActualDataLength = m_pSample->GetActualDataLength();
-	LONG lDataToCopy = min(lDataSize, lBufferSize - lActualDataLength);
-
-	// Copy data to buffer
-	CopyMemory(pbBuffer + lActualDataLength, pbData, lDataToCopy);
-	lActualDataLength += lDataToCopy;
-
-	// Update buffer's actual data length
-	hr = m_pSample->SetActualDataLength(lActualDataLength);
-	if (FAILED(hr)) {
-		m_pSample->Release();
-		m_pSample = NULL;
-		return hr;
-	}
-
-	return (lDataToCopy < lDataSize) ? VFW_E_BUFFER_OVERFLOW : NOERROR;
+	return hr;
 }
 
 HRESULT CMVEInnerChunkParser::ParseChunkEnd(void)
@@ -430,6 +425,56 @@ HRESULT CMVEInnerChunkParser::ParseChunkEnd(void)
 			m_pPin = NULL;
 			return NOERROR;
 
+		// Video decoding map
+		case MVE_SUBCHUNK_VIDEOMAP:
+
+			// In the trick-play mode deliver only the frames which 
+			// do not refer to the previous ones. The decoding map 
+			// (which precedes the video data) tells whether the frame 
+			// is such one, so the decision is made here. The same 
+			// frames are the key entries of the chunk index
+			{
+				BOOL bIsTrickPlay = m_pFilter->IsTrickPlay();
+				BOOL bIsRecording = m_pFilter->IsIndexRecording();
+				BOOL bIsIndependent = (
+					((bIsTrickPlay) || (bIsRecording)) &&
+					(IsIndependentFrame(pbBuffer + 2, m_pSample->GetActualDataLength() - 2))
+				);
+				if ((bIsRecording) && (bIsIndependent))
+					m_pFilter->MarkIndexKeyFrame(m_pPin, -1);
+				m_bSkipFrame = (bIsTrickPlay) && (!bIsIndependent);
+			}
+			if (m_bSkipFrame) {
+				m_pSample->Release();
+				m_pSample = NULL;
+				m_pPin = NULL;
+				return NOERROR;
+			}
+			break;
+
+		// "Send buffer" video command
+		case MVE_SUBCHUNK_VIDEOCMD:
+
+			// Skip the frame unless the command installs the palette 
+			// entries (the decoder would lose them otherwise, so the 
+			// last delivered frame is shown once again instead)
+			if (m_bSkipFrame) {
+				m_bSkipFrame = FALSE;
+				if (
+					(m_pSample->GetActualDataLength() < 2 + (LONG)sizeof(MVE_VIDEO_CMD)) ||
+					(((MVE_VIDEO_CMD*)(pbBuffer + 2))->nPaletteEntries == 0)
+				) {
+					m_pSample->Release();
+					m_pSample = NULL;
+					hr = m_pPin->Skip(m_rtDelta, m_llDelta);
+					m_pPin = NULL;
+					m_rtDelta = 0;
+					m_llDelta = 0;
+					return hr;
+				}
+			}
+			break;
+
 		case MVE_SUBCHUNK_AUDIODATA:
 		case MVE_SUBCHUNK_AUDIOSILENCE:
 
@@ -528,6 +573,36 @@ HRESULT CMVEInnerChunkParser::ParseChunkEnd(void)
 
 }
 
+BOOL CMVEInnerChunkParser::IsIndependentFrame(const BYTE *pbMap, LONG cbMap)
+{
+	// The map holds a 4-bit encoding per 8x8 block. The encodings 
+	// 0x0 and 0x1 leave the block from the back buffers, 0x4 and 0x5
+	// copy it from the previous frame and 0x6 skips the blocks
+	for (LONG i = 0; i < cbMap; i++) {
+		for (int iShift = 0; iShift < 8; iShift += 4) {
+			switch ((pbMap[i] >> iShift) & 0xF) {
+				case 0x0:
+				case 0x1:
+				case 0x4:
+				case 0x5:
+				case 0x6:
+					return FALSE;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+BOOL CMVEInnerChunkParser::GetChunkType(const BYTE *pbHeader, DWORD *pdwType)
+{
+	// Count the subchunks by their types (the outer chunks 
+	// are not counted)
+	*pdwType = ((MVE_CHUNK_HEADER*)pbHeader)->bType;
+
+	return TRUE;
+}
+
 //==========================================================================
 // CMVEOuterChunkParser methods
 //==========================================================================
@@ -705,6 +780,7 @@ HRESULT CMVESplitterFilter::Initialize(IPin *pPin, IAsyncReader *pReader)
 	int iFirstVideoFrame = -1;
 	int iAudioData = 0;
 	WORD cbAudioData[2] = { 0, 0 };
+	LONG cbMaxChunk = 0;
 	for (int i = 0; i < MVE_CHUNKS_TO_SCAN; i++) {
 
 		// Read chunk header
@@ -713,6 +789,9 @@ HRESULT CMVESplitterFilter::Initialize(IPin *pPin, IAsyncReader *pReader)
 		if (hr != S_OK)
 			break;
 
+		// Keep track of the largest chunk
+		cbMaxChunk = max(cbMaxChunk, (LONG)sizeof(chunkheader) + chunkheader.cbData);
+
 		llSeekPos += sizeof(chunkheader);
 
 		// Walk subchunks of this chunk
@@ -794,7 +873,7 @@ HRESULT CMVESplitterFilter::Initialize(IPin *pPin, IAsyncReader *pReader)
 
 	// Decide on the input pin properties
 	m_cbInputAlign	= 1;
-	m_cbInputBuffer	= 0x40000; // TEMP: some reasonably large value
+	m_cbInputBuffer	= max(cbMaxChunk, PARSER_MIN_REQUEST_SIZE); // The largest of the scanned chunks
 
 	// Protect the output pins state
 	CAutoLock pinlock(&m_csPins);
@@ -860,7 +939,7 @@ HRESULT CMVESplitterFilter::Initialize(IPin *pPin, IAsyncReader *pReader)
 	// Set the video allocator properties
 	papVideo->cbAlign	= 0;		// No matter
 	papVideo->cbPrefix	= 0;		// No matter
-	papVideo->cBuffers	= 4;		// TEMP: small value
+	papVideo->cBuffers	= 4;		// Default (the pin option may override it)
 	papVideo->cbBuffer	= max(
 		2 + 4 + 800,											// Type + subtype + palette header + full (RLE) palette
 		max(
@@ -869,6 +948,9 @@ HRESULT CMVESplitterFilter::Initialize(IPin *pPin, IAsyncReader *pReader)
 		)
 	);
 
+	// The subchunk size is a WORD, so no video sample is larger than that
+	papVideo->cbBuffer	= min(papVideo->cbBuffer, 2 + 0xFFFF);
+
 	// Allocate time formats array. If we fail here, it's not an error, 
 	// we'll just set zero seeker parameters and may proceed
 	DWORD dwVideoCapabilities = 0;
@@ -1002,7 +1084,7 @@ HRESULT CMVESplitterFilter::Initialize(IPin *pPin, IAsyncReader *pReader)
 		papAudio->cbAlign	= 0;	// No matter
 		papAudio->cbPrefix	= 0;	// No matter
 		papAudio->cBuffers	= (iFirstVideoFrame != -1) ? (iFirstVideoFrame + 1) : 32;	// All pre-video audio chunks plus one
-		papAudio->cbBuffer	= max(cbAudioData[0], cbAudioData[1]);
+		papAudio->cbBuffer	= max(cbAudioData[0], cbAudioData[1]);	// The pin grows its buffers if a later chunk is larger
 		if (papAudio->cbBuffer == 0)
 			papAudio->cbBuffer = 0x10000;
 
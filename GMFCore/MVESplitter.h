@@ -45,6 +45,17 @@ class CMVEInnerChunkParser : public CBaseChunkParser
 
 	BYTE m_bCurrentSubchunkType;	// Current subchunk type
 	BYTE m_bCurrentSubchunkSubtype;	// Current subchunk subtype
+
+	// Is the current video frame skipped in the trick-play mode? 
+	// The decision is made on the decoding map and holds for the 
+	// following video data and "send buffer" subchunks. Note that the
+	// flag is not cleared by ResetParser() as the frame subchunks may
+	// span the outer chunks -- the next decoding map sets it anyway
+	BOOL m_bSkipFrame;
+
+	// Can the frame be decoded without the previous ones (i.e. are
+	// there no blocks copied from or left in the back buffers)?
+	BOOL IsIndependentFrame(const BYTE *pbMap, LONG cbMap);
 	
 	// Audio & video format parameters (used by ParseChunkHeader() when 
 	// calculating sample stream and media times)
@@ -84,6 +95,9 @@ protected:
 	);
 	HRESULT ParseChunkEnd(void);
 
+	// Get the chunk type for the filter statistics
+	BOOL GetChunkType(const BYTE *pbHeader, DWORD *pdwType);
+
 };
 
 //==========================================================================
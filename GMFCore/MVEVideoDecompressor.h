@@ -27,175 +27,25 @@
 
 #include <streams.h>
 
+#include "BaseDecompressor.h"
 #include "MVESpecs.h"
+#include "MVEVideoDecoder.h"
 
 //==========================================================================
 // MVE video decompressor filter class
 //==========================================================================
 
-class CMVEVideoDecompressor :	public CTransformFilter,
+class CMVEVideoDecompressor :	public CBaseDecompressorFilter,
 								public ISpecifyPropertyPages
 {
 
-	// Video decoder buffers
-	BYTE *m_pVideoMap;		// Latest video decoding map
-	DWORD m_cbVideoMap;		// Video map size
-	BYTE *m_pCurrentFrame;	// Current frame buffer
-	BYTE *m_pPreviousFrame;	// Previous frame buffer
-
-	// Current palette
-	struct tagRGBTriple {
-		BYTE bRed;
-		BYTE bGreen;
-		BYTE bBlue;
-	} m_Palette[256];
-	WORD m_iPaletteStart;
-	WORD m_nPaletteEntries;
-
-	// Format block
-	MVE_VIDEO_INFO *m_pFormat;
-	DWORD m_cbFormat;
-	DWORD m_dwVideoWidth, m_dwVideoHeight;
-	BOOL m_bVideoModeChanged;
+	// Platform-neutral MVE video decoder
+	CMVEVideoDecoder m_Decoder;
 
 	// Constructor/destructor
 	CMVEVideoDecompressor(LPUNKNOWN pUnk, HRESULT *phr);
 	~CMVEVideoDecompressor();
 
-	// Internal video buffers setup/allocation/freeing methods
-	void SetVideoParameters(WORD wWidth, WORD wHeight);
-	HRESULT AllocateVideoBuffers(void);
-	void FreeVideoBuffers(void);
-
-	// ---- MVE decoder methods ----
-	// Source code taken from libmve library
-	// by <don't-know-whom> (<don't-know-email>)
-
-	int close_table[512];
-	int far_p_table[512];
-	int far_n_table[512];
-	int lookup_initialized;
-	void GenLoopkupTable();
-	void RelClose(int i, int *x, int *y);
-	void RelFar(int i, int sign, int *x, int *y);
-
-	void DecodeFrame8(
-		unsigned char *pFrame,
-		unsigned char *pMap,
-		int mapRemain,
-		unsigned char *pData,
-		int dataRemain
-	);
-	void CopyFrame8(unsigned char *pDest, unsigned char *pSrc);
-	void PatternRow4Pixels8(
-		unsigned char *pFrame,
-		unsigned char pat0,
-		unsigned char pat1,
-		unsigned char *p
-	);
-	void PatternRow4Pixels2_8(
-		unsigned char *pFrame,
-		unsigned char pat0,
-		unsigned char *p
-	);
-	void PatternRow4Pixels2x1_8(
-		unsigned char *pFrame,
-		unsigned char pat,
-		unsigned char *p
-	);
-	void PatternQuadrant4Pixels8(
-		unsigned char *pFrame,
-		unsigned char pat0,
-		unsigned char pat1,
-		unsigned char pat2,
-		unsigned char pat3,
-		unsigned char *p
-	);
-	void PatternRow2Pixels8(
-		unsigned char *pFrame,
-		unsigned char pat,
-		unsigned char *p
-	);
-	void PatternRow2Pixels2_8(
-		unsigned char *pFrame,
-		unsigned char pat,
-		unsigned char *p
-	);
-	void PatternQuadrant2Pixels8(
-		unsigned char *pFrame,
-		unsigned char pat0,
-		unsigned char pat1,
-		unsigned char *p
-	);
-	void DispatchDecoder8(
-		unsigned char **pFrame,
-		unsigned char codeType,
-		unsigned char **pData,
-		int *pDataRemain,
-		int *curXb,
-		int *curYb
-	);
-
-	void DecodeFrame16(
-		unsigned char *pFrame,
-		unsigned char *pMap,
-		int mapRemain,
-		unsigned char *pData,
-		int dataRemain
-	);
-	unsigned short GETPIXEL(unsigned char **buf, int off);
-	unsigned short GETPIXELI(unsigned char **buf, int off);
-	void CopyFrame16(unsigned short *pDest, unsigned short *pSrc);
-	void PatternRow4Pixels16(
-		unsigned short *pFrame,
-		unsigned char pat0,
-		unsigned char pat1,
-		unsigned short *p
-	);
-	void PatternRow4Pixels2_16(
-		unsigned short *pFrame,
-		unsigned char pat0,
-		unsigned short *p
-	);
-	void PatternRow4Pixels2x1_16(
-		unsigned short *pFrame,
-		unsigned char pat,
-		unsigned short *p
-	);
-	void PatternQuadrant4Pixels16(
-		unsigned short *pFrame,
-		unsigned char pat0,
-		unsigned char pat1,
-		unsigned char pat2,
-		unsigned char pat3,
-		unsigned short *p
-	);
-	void PatternRow2Pixels16(
-		unsigned short *pFrame,
-		unsigned char pat,
-		unsigned short *p
-	);
-	void PatternRow2Pixels2_16(
-		unsigned short *pFrame,
-		unsigned char pat,
-		unsigned short *p
-	);
-	void PatternQuadrant2Pixels16(
-		unsigned short *pFrame,
-		unsigned char pat0,
-		unsigned char pat1,
-		unsigned short *p
-	);
-	void DispatchDecoder16(
-		unsigned short **pFrame,
-		unsigned char codeType,
-		unsigned char **pData,
-		unsigned char **pOffData,
-		int *pDataRemain,
-		int *curXb,
-		int *curYb
-	);
-
 public:
 
 	static CUnknown * WINAPI CreateInstance(LPUNKNOWN pUnk, HRESULT *phr);
@@ -83,76 +83,18 @@ CROQADPCMDecompressor::CROQADPCMDecompressor(
 	LPUNKNOWN pUnk,
 	HRESULT *phr
 ) :
-	CTransformFilter(
+	CBaseDecompressorFilter(
 		NAME("ROQ ADPCM Decompressor"),
 		pUnk,
 		CLSID_ROQADPCMDecompressor
-	),
-	m_pFormat(NULL)	// No format block at this time
+	)
 {
 	ASSERT(phr);
 }
 
 CROQADPCMDecompressor::~CROQADPCMDecompressor()
 {
-	// Free the format block
-	if (m_pFormat) {
-		CoTaskMemFree(m_pFormat);
-		m_pFormat = NULL;
-	}
-}
-
-void CROQADPCMDecompressor::Decompress(
-	WORD wInitialPrediction,
-	BYTE *pbInput,
-	LONG lInputLength,
-	SHORT *piOutput
-)
-{
-	// Allocate the array for current sample values
-	SHORT *piSample = new SHORT[m_pFormat->nChannels];
-	if (piSample == NULL)
-		return;
-
-	// Initialize sample values
-	if (m_pFormat->nChannels == 1)
-		piSample[0] = (SHORT)wInitialPrediction;
-	else if (m_pFormat->nChannels == 2) {
-		piSample[0] = (SHORT)((WORD)HIBYTE(wInitialPrediction) << 8);
-		piSample[1] = (SHORT)((WORD)LOBYTE(wInitialPrediction) << 8);
-	} else
-		ASSERT(false); // We support only mono or stereo sound
-
-	// Walk the input buffer until its length is exhausted
-	while (lInputLength > 0) {
-
-		// Process a byte per channel for all channels
-		for (WORD i = 0; i < m_pFormat->nChannels; i++) {
-
-			// Calculate the predition error
-			SHORT iPredictionError;
-			if (*pbInput < 128)
-				iPredictionError = (*pbInput) * (*pbInput);
-			else
-				iPredictionError = - (*pbInput - 128) * (*pbInput - 128);
-			pbInput++;
-			lInputLength--;
-
-			// Calculate the current sample
-			piSample[i] += iPredictionError;
-
-			// Clip the sample value (if needed)
-			if		(piSample[i] > 32767)	piSample[i] = 32767;
-			else if	(piSample[i] < -32768)	piSample[i] = -32768;
-
-			// Place the sample into the output buffer
-			*piOutput = piSample[i];
-			piOutput++;
-		}
-	}
-
-	// Free the current sample values array
-	delete[] piSample;
+	// The decoder frees its format block itself
 }
 
 CUnknown* WINAPI CROQADPCMDecompressor::CreateInstance(
@@ -176,7 +118,7 @@ STDMETHODIMP CROQADPCMDecompressor::NonDelegatingQueryInterface(REFIID riid, voi
 	if (riid == IID_ISpecifyPropertyPages)
 		return GetInterface((ISpecifyPropertyPages*)this, ppv);
 	else
-		return CTransformFilter::NonDelegatingQueryInterface(riid, ppv);
+		return CBaseDecompressorFilter::NonDelegatingQueryInterface(riid, ppv);
 }
 
 HRESULT CROQADPCMDecompressor::Transform(
@@ -205,17 +147,19 @@ HRESULT CROQADPCMDecompressor::Transform(
 	if (FAILED(hr))
 		return hr;
 
+	// Set up the output frame descriptor
+	GMF_FRAME frame;
+	ZeroMemory(&frame, sizeof(GMF_FRAME));
+	frame.pbBuffer	= pbOutBuffer;
+	frame.cbBuffer	= (DWORD)pOut->GetSize();
+
 	// Decompress the input buffer to the output one
-	Decompress(
-		*((WORD*)pbInBuffer),
-		pbInBuffer + sizeof(WORD),
-		lInDataLength - sizeof(WORD),
-		(SHORT*)pbOutBuffer
-	);
+	hr = m_Decoder.Decode(pbInBuffer, (DWORD)lInDataLength, frame);
+	if (FAILED(hr))
+		return hr;
 
 	// Set the data length for the output sample
-	LONG lOutDataLength = (lInDataLength - sizeof(WORD)) * 2;
-	hr = pOut->SetActualDataLength(lOutDataLength);
+	hr = pOut->SetActualDataLength((LONG)frame.cbData);
 	if (FAILED(hr))
 		return hr;
 
@@ -266,15 +210,8 @@ HRESULT CROQADPCMDecompressor::SetMediaType(
 		CheckPointer(pmt, E_POINTER);
 		ValidateReadPtr(pmt, sizeof(CMediaType));
 
-		// Free the old format block and allocate a new one
-		if (m_pFormat)
-			CoTaskMemFree(m_pFormat);
-		m_pFormat = (ROQADPCMWAVEFORMAT*)CoTaskMemAlloc(pmt->FormatLength());
-		if (m_pFormat == NULL)
-			return E_OUTOFMEMORY;
-
-		// Copy format block to the allocated storage
-		CopyMemory(m_pFormat, pmt->Format(), pmt->FormatLength());
+		// Pass the format block to the decoder
+		return m_Decoder.SetFormat((ROQADPCMWAVEFORMAT*)pmt->Format(), pmt->FormatLength());
 	}
 
 	return NOERROR;
@@ -285,10 +222,7 @@ HRESULT CROQADPCMDecompressor::BreakConnect(PIN_DIRECTION dir)
 	// Catch only the input pin disconnection
 	if (dir == PINDIR_INPUT) {
 		// Free the format block
-		if (m_pFormat) {
-			CoTaskMemFree(m_pFormat);
-			m_pFormat = NULL;
-		}
+		m_Decoder.ResetFormat();
 	}
 
 	return NOERROR;
@@ -343,7 +277,8 @@ HRESULT CROQADPCMDecompressor::GetMediaType(
 	ValidateWritePtr(pMediaType, sizeof(CMediaType));
 
 	// At this time we should have the format block
-	if (!m_pFormat)
+	const ROQADPCMWAVEFORMAT *pFormat = m_Decoder.GetFormat();
+	if (!pFormat)
 		return E_UNEXPECTED;
 
 	if (iPosition < 0)
@@ -354,9 +289,9 @@ HRESULT CROQADPCMDecompressor::GetMediaType(
 		// Prepare the format block
 		WAVEFORMATEX wfex		= {0};
 		wfex.wFormatTag			= WAVE_FORMAT_PCM;
-		wfex.nChannels			= m_pFormat->nChannels;
-		wfex.nSamplesPerSec		= m_pFormat->nSamplesPerSec;
-		wfex.wBitsPerSample		= m_pFormat->wBitsPerSample;
+		wfex.nChannels			= pFormat->nChannels;
+		wfex.nSamplesPerSec		= pFormat->nSamplesPerSec;
+		wfex.wBitsPerSample		= pFormat->wBitsPerSample;
 		wfex.nBlockAlign		= (wfex.nChannels * wfex.wBitsPerSample) / 8;
 		wfex.nAvgBytesPerSec	= wfex.nSamplesPerSec * wfex.nBlockAlign;
 		wfex.cbSize				= 0;
@@ -412,7 +347,7 @@ HRESULT CROQADPCMDecompressor::DecideBufferSize(
 	// Set the properties: output buffer is two times larger 
 	// then the input one, the buffers amount is the same and 
 	// we don't care about alignment and prefix
-	pProperties->cbBuffer = max(pProperties->cbBuffer, apInput.cbBuffer * 2);
+	pProperties->cbBuffer = max(pProperties->cbBuffer, (LONG)m_Decoder.GetMaxOutputSize((DWORD)apInput.cbBuffer));
 	pProperties->cBuffers = max(pProperties->cBuffers, apInput.cBuffers);
 	ALLOCATOR_PROPERTIES apActual;
 	hr = pAlloc->SetProperties(pProperties, &apActual);
@@ -27,32 +27,26 @@
 
 #include <streams.h>
 
+#include "BaseDecompressor.h"
 #include "ROQGUID.h"
 #include "ROQSpecs.h"
+#include "ROQADPCMDecoder.h"
 
 //==========================================================================
 // ROQ ADPCM decompressor filter class
 //==========================================================================
 
-class CROQADPCMDecompressor :	public CTransformFilter,
+class CROQADPCMDecompressor :	public CBaseDecompressorFilter,
 								public ISpecifyPropertyPages
 {
 
-	// Format block
-	ROQADPCMWAVEFORMAT *m_pFormat;
+	// Platform-neutral ROQ ADPCM decoder
+	CROQADPCMDecoder m_Decoder;
 
 	// Constructor/destructor
 	CROQADPCMDecompressor(LPUNKNOWN pUnk, HRESULT *phr);
 	~CROQADPCMDecompressor();
 
-	// Decompression method
-	void Decompress(
-		WORD wInitialPrediction,
-		BYTE *pbInput,
-		LONG lInputLength,
-		SHORT *piOutput
-	);
-
 public:
 
 	static CUnknown* WINAPI CreateInstance(LPUNKNOWN pUnk, HRESULT *phr);
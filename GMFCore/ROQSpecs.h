@@ -27,8 +27,7 @@
 #ifndef __GMF_ROQ_SPECS_H__
 #define __GMF_ROQ_SPECS_H__
 
-#include <windows.h>
-#include <mmsystem.h>
+#include "CodecTypes.h"
 
 //==========================================================================
 // Constants
@@ -50,6 +49,12 @@
 #define ROQ_CHUNK_SOUND_MONO		0x1020
 #define ROQ_CHUNK_SOUND_STEREO		0x1021
 
+// Video frame block codes
+#define ROQ_CODE_MOT				0x00	// Unchanged block
+#define ROQ_CODE_FCC				0x01	// Motion compensated block
+#define ROQ_CODE_SLD				0x02	// Vector quantized block
+#define ROQ_CODE_CCC				0x03	// Subdivided block
+
 //==========================================================================
 // Structures
 //==========================================================================
@@ -108,15 +108,6 @@ const AMOVIESETUP_FILTER g_sudROQSplitter = {
 // ROQ splitter file type setup data
 //==========================================================================
 
-const GMF_FILETYPE_PATTERN sudROQPatterns[] = {
-	{ 0,	2,	ROQ_IDSTR_ID		},
-	{ 2,	4,	ROQ_IDSTR_SIZE		}
-};
-
-const GMF_FILETYPE_ENTRY sudROQEntries[] = {
-	{ 2, sudROQPatterns } 
-};
-
 const TCHAR *sudROQExtensions[] = {
 	TEXT(".roq")
 };
@@ -146,6 +137,8 @@ CROQChunkParser::CROQChunkParser(
 	WORD nFramesPerSecond,
 	WORD nSampleSize,
 	DWORD nAvgBytesPerSec,
+	WORD wWidth,
+	WORD wHeight,
 	HRESULT *phr
 ) :
 	CBaseChunkParser(
@@ -162,7 +155,10 @@ CROQChunkParser::CROQChunkParser(
 	m_llDelta(0),
 	m_nFramesPerSecond(nFramesPerSecond),
 	m_nSampleSize(nSampleSize),
-	m_nAvgBytesPerSec(nAvgBytesPerSec)
+	m_nAvgBytesPerSec(nAvgBytesPerSec),
+	m_wWidth(wWidth),
+	m_wHeight(wHeight),
+	m_llCodebookPosition(-1)
 {
 }
 
@@ -191,6 +187,9 @@ HRESULT CROQChunkParser::ResetParser(void)
 	m_rtDelta = 0;
 	m_llDelta = 0;
 
+	// No codebook parsed yet
+	m_llCodebookPosition = -1;
+
 	// Call base-class method to reset parser state
 	return CBaseChunkParser::ResetParser();
 }
@@ -231,6 +230,9 @@ HRESULT CROQChunkParser::ParseChunkHeader(
 			m_rtDelta = 0;				// Codebook has no duration
 			m_llDelta = 0;				// Codebook has no duration
 
+			// The frame decoding can start from here
+			m_llCodebookPosition = llStartPosition;
+
 			break;
 
 		// Video frame data
@@ -291,67 +293,46 @@ HRESULT CROQChunkParser::ParseChunkHeader(
 		return NOERROR;
 	}
 
-	// Get an empty sample from the output pin
-	HRESULT hr = m_pPin->GetDeliveryBuffer(&m_pSample, NULL, NULL, 0);
-	if (FAILED(hr)) {
-		m_pSample = NULL;
-		return hr;
-	}
-
-	// Get the sample's buffer
-	BYTE *pbBuffer = NULL;
-	hr = m_pSample->GetPointer(&pbBuffer);
-	if (FAILED(hr)) {
-		m_pSample->Release();
-		m_pSample = NULL;
-		return hr;
-	}
-
-	// Prepare the sample
+	// Video samples start with the chunk header and audio samples 
+	// start with the chunk argument (which is the last header field),
+	// so the sample data is stored in the file as it is
+	LONG lPrefixSize;
 	switch (pChunkHeader->wID) {
 
 		// Video codebook and frame data
 		case ROQ_CHUNK_VIDEO_CODEBOOK:
 		case ROQ_CHUNK_VIDEO_FRAME:
 
-			// Store the chunk header in the buffer
-			CopyMemory(
-				pbBuffer,
-				pbHeader,
-				sizeof(ROQ_CHUNK_HEADER)
-			);
-
-			// Set the actual data length
-			hr = m_pSample->SetActualDataLength(sizeof(ROQ_CHUNK_HEADER));
-			if (FAILED(hr)) {
-				m_pSample->Release();
-				m_pSample = NULL;
-				return hr;
-			}
-
+			lPrefixSize = sizeof(ROQ_CHUNK_HEADER);
 			break;
 
 		// Audio data
-		case ROQ_CHUNK_SOUND_MONO:
-		case ROQ_CHUNK_SOUND_STEREO:
-
-			// Store the chunk argument in the buffer
-			*((WORD*)pbBuffer) = pChunkHeader->wArgument;
+		default:
 
-			// Set the actual data length
-			hr = m_pSample->SetActualDataLength(sizeof(WORD));
-			if (FAILED(hr)) {
-				m_pSample->Release();
-				m_pSample = NULL;
-				return hr;
-			}
-			
+			lPrefixSize = sizeof(WORD);
 			break;
+	}
 
-		default:
+	// Get an empty sample for the chunk data
+	HRESULT hr = GetChunkSample(
+		m_pPin,
+		llStartPosition + sizeof(ROQ_CHUNK_HEADER) - lPrefixSize,
+		lPrefixSize + *plDataSize,
+		&m_pSample
+	);
+	if (FAILED(hr))
+		return hr;
 
-			// Is it possible?
-			break;
+	// Put the chunk header (or the chunk argument) to the sample
+	hr = AppendChunkData(
+		m_pSample,
+		pbHeader + sizeof(ROQ_CHUNK_HEADER) - lPrefixSize,
+		lPrefixSize
+	);
+	if (FAILED(hr)) {
+		m_pSample->Release();
+		m_pSample = NULL;
+		return hr;
 	}
 
 	return NOERROR;
@@ -370,33 +351,14 @@ HRESULT CROQChunkParser::ParseChunkData(
 	if (!m_pSample)
 		return NOERROR;
 
-	// Get the sample's buffer
-	BYTE *pbBuffer = NULL;
-	HRESULT hr = m_pSample->GetPointer(&pbBuffer);
-	if (FAILED(hr)) {
+	// Append data to the sample
+	HRESULT hr = AppendChunkData(m_pSample, pbData, lDataSize);
+	if (FAILED(hr) && (hr != VFW_E_BUFFER_OVERFLOW)) {
 		m_pSample->Release();
 		m_pSample = NULL;
-		return hr;
-	}
-
-	// Find out how many bytes we can copy
-	LONG lBufferSize = m_pSample->GetSize();
-	LONG lActualDataLength = m_pSample->GetActualDataLength();
-	LONG lDataToCopy = min(lDataSize, lBufferSize - lActualDataLength);
-
-	// Copy data to buffer
-	CopyMemory(pbBuffer + lActualDataLength, pbData, lDataToCopy);
-	lActualDataLength += lDataToCopy;
-
-	// Update buffer's actual data length
-	hr = m_pSample->SetActualDataLength(lActualDataLength);
-	if (FAILED(hr)) {
-		m_pSample->Release();
-		m_pSample = NULL;
-		return hr;
 	}
 
-	return (lDataToCopy < lDataSize) ? VFW_E_BUFFER_OVERFLOW : NOERROR;
+	return hr;
 }
 
 HRESULT CROQChunkParser::ParseChunkEnd(void)
@@ -407,9 +369,61 @@ HRESULT CROQChunkParser::ParseChunkEnd(void)
 
 	// If we've got media sample there should be the output pin
 	ASSERT(m_pPin);
+
+	HRESULT hr = NOERROR;
+
+	// In the trick-play mode deliver only the frames which do not 
+	// refer to the previous one. The codebooks are always delivered, 
+	// as the frames to come may depend on them. Only the block codes 
+	// of the frame tell whether it's independent, so the check cannot
+	// be done before the frame data is collected. The independent 
+	// frames right after their codebooks are the key entries of the 
+	// chunk index (at the codebook position)
+	BOOL bIsFrame = (m_llDelta != 0) && (m_pPin == m_ppOutputPin[0]);
+	LONGLONG llCodebookPosition = m_llCodebookPosition;
+	if (bIsFrame)
+		m_llCodebookPosition = -1;
+	BOOL bIsTrickPlay = (bIsFrame) && (m_pFilter->IsTrickPlay());
+	BOOL bIsRecording = (
+		(bIsFrame)					&&
+		(llCodebookPosition >= 0)	&&
+		(m_pFilter->IsIndexRecording())
+	);
+	if ((bIsTrickPlay) || (bIsRecording)) {
+
+		// Get the sample's buffer
+		BYTE *pbBuffer = NULL;
+		hr = m_pSample->GetPointer(&pbBuffer);
+		if (FAILED(hr)) {
+			m_pSample->Release();
+			m_pSample = NULL;
+			return hr;
+		}
+
+		// The sample data starts with the chunk header
+		LONG lDataSize = m_pSample->GetActualDataLength() - sizeof(ROQ_CHUNK_HEADER);
+		BOOL bIsIndependent = IsIndependentFrame(pbBuffer + sizeof(ROQ_CHUNK_HEADER), lDataSize);
+		if ((bIsRecording) && (bIsIndependent))
+			m_pFilter->MarkIndexKeyFrame(m_pPin, llCodebookPosition);
+
+		if ((bIsTrickPlay) && (!bIsIndependent)) {
+
+			// Release the sample instead of delivering it
+			m_pSample->Release();
+			m_pSample = NULL;
+
+			hr = m_pPin->Skip(m_rtDelta, m_llDelta);
+
+			m_pPin = NULL;
+			m_rtDelta = 0;
+			m_llDelta = 0;
+
+			return hr;
+		}
+	}
 	
 	// Deliver the sample
-	HRESULT hr = m_pPin->Deliver(m_pSample, m_rtDelta, m_llDelta);
+	hr = m_pPin->Deliver(m_pSample, m_rtDelta, m_llDelta);
 	if (FAILED(hr)) {
 		m_pSample->Release();
 		m_pSample = NULL;
@@ -430,6 +444,105 @@ HRESULT CROQChunkParser::ParseChunkEnd(void)
 	return NOERROR;
 }
 
+// Get the next block code of the video frame. The codes come in 16-bit
+// words of 8 codes each, interleaved with the block arguments. Returns 
+// FALSE if the frame data is over
+static BOOL GetROQBlockCode(
+	const BYTE *pbData,
+	LONG lDataSize,
+	LONG *plPosition,
+	WORD *pwCodes,
+	int *pnCodes,
+	int *piCode
+)
+{
+	// Read the next word of codes if we have to
+	if (*pnCodes == 0) {
+		if (*plPosition + 2 > lDataSize)
+			return FALSE;
+		*pwCodes = (WORD)(pbData[*plPosition] | (pbData[*plPosition + 1] << 8));
+		*plPosition += 2;
+		*pnCodes = 8;
+	}
+
+	// The codes are taken from the most significant bits
+	(*pnCodes)--;
+	*piCode = (*pwCodes >> (*pnCodes * 2)) & 0x3;
+
+	return TRUE;
+}
+
+BOOL CROQChunkParser::IsIndependentFrame(const BYTE *pbData, LONG lDataSize)
+{
+	// Without the video dimensions we cannot walk the frame
+	if ((m_wWidth == 0) || (m_wHeight == 0))
+		return TRUE;
+
+	// Each 16x16 macroblock consists of four 8x8 blocks
+	LONG nBlocks = 4 * (LONG)(m_wWidth / 16) * (LONG)(m_wHeight / 16);
+
+	LONG lPosition = 0;
+	WORD wCodes = 0;
+	int nCodes = 0;
+	int iCode;
+
+	// Walk the block codes (in the same way the decoder does) 
+	// until the first block referring to the previous frame
+	for (LONG iBlock = 0; iBlock < nBlocks; iBlock++) {
+
+		// If the data is over, the rest of the 
+		// blocks is left from the previous frame
+		if (!GetROQBlockCode(pbData, lDataSize, &lPosition, &wCodes, &nCodes, &iCode))
+			return FALSE;
+
+		switch (iCode) {
+
+			case ROQ_CODE_MOT:
+			case ROQ_CODE_FCC:
+				return FALSE;
+
+			case ROQ_CODE_SLD:
+				lPosition++;
+				break;
+
+			case ROQ_CODE_CCC:
+
+				// Walk the four 4x4 subblocks
+				for (int i = 0; i < 4; i++) {
+
+					if (!GetROQBlockCode(pbData, lDataSize, &lPosition, &wCodes, &nCodes, &iCode))
+						return FALSE;
+
+					switch (iCode) {
+
+						case ROQ_CODE_MOT:
+						case ROQ_CODE_FCC:
+							return FALSE;
+
+						case ROQ_CODE_SLD:
+							lPosition++;
+							break;
+
+						case ROQ_CODE_CCC:
+							lPosition += 4;
+							break;
+					}
+				}
+				break;
+		}
+	}
+
+	return TRUE;
+}
+
+BOOL CROQChunkParser::GetChunkType(const BYTE *pbHeader, DWORD *pdwType)
+{
+	// Count the chunks by their IDs
+	*pdwType = ((ROQ_CHUNK_HEADER*)pbHeader)->wID;
+
+	return TRUE;
+}
+
 //==========================================================================
 // CROQSplitterFilter methods
 //==========================================================================
@@ -446,6 +559,8 @@ CROQSplitterFilter::CROQSplitterFilter(LPUNKNOWN pUnk, HRESULT *phr) :
 	),
 	m_nSampleSize(0),			// No audio sample size at this time
 	m_nAvgBytesPerSec(0),		// No audio data rate at this time
+	m_wWidth(0),				// No video dimensions at this time
+	m_wHeight(0),				// No video dimensions at this time
 	m_pMP3Source(NULL),			// |
 	m_pMPEGSplitter(NULL),		// |
 	m_pMP3Decoder(NULL),		// |-- No MP3 stuff at this time
@@ -632,7 +747,7 @@ HRESULT CROQSplitterFilter::Initialize(IPin *pPin, IAsyncReader *pReader)
 
 	// Decide on the input pin properties
 	m_cbInputAlign	= 1;
-	m_cbInputBuffer	= 0x40000; // TEMP: Some reasonable value
+	m_cbInputBuffer	= 0; // The largest output buffer (set below)
 
 	// Set the frame rate
 	m_nFramesPerSecond = header.wArgument;
@@ -677,12 +792,12 @@ HRESULT CROQSplitterFilter::Initialize(IPin *pPin, IAsyncReader *pReader)
 		} else if (header.wID == ROQ_CHUNK_SOUND_MONO) {
 
 			nChannels = 1;
-			cbMaxAudioChunk = header.cbSize;
+			cbMaxAudioChunk = max(cbMaxAudioChunk, header.cbSize);
 
 		} else if (header.wID == ROQ_CHUNK_SOUND_STEREO) {
 
 			nChannels = 2;
-			cbMaxAudioChunk = header.cbSize;
+			cbMaxAudioChunk = max(cbMaxAudioChunk, header.cbSize);
 
 		}
 
@@ -742,6 +857,10 @@ HRESULT CROQSplitterFilter::Initialize(IPin *pPin, IAsyncReader *pReader)
 	videoformat.nFramesPerSecond	= m_nFramesPerSecond;
 	videoformat.wWidth				= videoinfo.wWidth;
 	videoformat.wHeight				= videoinfo.wHeight;
+
+	// Set the video dimensions
+	m_wWidth	= videoinfo.wWidth;
+	m_wHeight	= videoinfo.wHeight;
 	videoformat.wBlockDimension		= videoinfo.wBlockDimension;
 	videoformat.wSubBlockDimension	= videoinfo.wSubBlockDimension;
 
@@ -776,7 +895,7 @@ HRESULT CROQSplitterFilter::Initialize(IPin *pPin, IAsyncReader *pReader)
 	// Set the video allocator properties
 	papVideo->cbAlign	= 0;		// No matter
 	papVideo->cbPrefix	= 0;		// No matter
-	papVideo->cBuffers	= 4;		// TEMP: No need to set larger value?
+	papVideo->cBuffers	= 4;		// Default (the pin option may override it)
 	papVideo->cbBuffer	= max(		// Set this to the max of the codebook and frame sizes
 		sizeof(ROQ_CHUNK_HEADER) +	//          | Codebook header
 		256 * wHalfSubBlockCell +	// Codebook | Codebook for half-sub-block
@@ -784,6 +903,7 @@ HRESULT CROQSplitterFilter::Initialize(IPin *pPin, IAsyncReader *pReader)
 		sizeof(ROQ_CHUNK_HEADER) +	//          + Frame header
 		dwMaxFrameSize				// Frame    + Maximal frame size
 	);
+	m_cbInputBuffer = papVideo->cbBuffer;
 
 	// Allocate time formats array. If we fail here, it's not an error, 
 	// we'll just set zero seeker parameters and may proceed
@@ -906,7 +1026,8 @@ HRESULT CROQSplitterFilter::Initialize(IPin *pPin, IAsyncReader *pReader)
 		papAudio->cbAlign	= 0;	// No matter
 		papAudio->cbPrefix	= 0;	// No matter
 		papAudio->cBuffers	= 8;	// The first audio chunk contains sound for 8 frames
-		papAudio->cbBuffer	= 2 + cbMaxAudioChunk; // TEMP: we assume the first chunk is the largest one
+		papAudio->cbBuffer	= 2 + cbMaxAudioChunk; // The first chunk is normally the largest one (the pin grows its buffers if not)
+		m_cbInputBuffer		= max(m_cbInputBuffer, papAudio->cbBuffer);
 
 		// Allocate time formats array. If we fail here, it's not an error, 
 		// we'll just set zero seeker parameters and may proceed
@@ -1341,6 +1462,8 @@ HRESULT CROQSplitterFilter::Shutdown(void)
 		m_nFramesPerSecond	= 0;
 		m_nSampleSize		= 0;
 		m_nAvgBytesPerSec	= 0;
+		m_wWidth			= 0;
+		m_wHeight			= 0;
 	}
 
 	// Call the base-class implementation
@@ -1363,6 +1486,8 @@ HRESULT CROQSplitterFilter::InitializeParser(void)
 			m_nFramesPerSecond,
 			m_nSampleSize,
 			m_nAvgBytesPerSec,
+			m_wWidth,
+			m_wHeight,
 			&hr
 		);
 		if (
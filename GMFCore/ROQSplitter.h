@@ -47,6 +47,19 @@ class CROQChunkParser : public CBaseChunkParser
 	WORD	m_nSampleSize;			// (Uncompressed) audio sample size in bytes
 	DWORD	m_nAvgBytesPerSec;		// Audio data rate
 
+	// Video dimensions (used by the trick-play mode to walk the 
+	// frame data)
+	WORD	m_wWidth;				// Video width
+	WORD	m_wHeight;				// Video height
+
+	// Position of the codebook chunk preceding the frame (-1 if none). 
+	// The independent frame is a key entry of the chunk index then
+	LONGLONG m_llCodebookPosition;
+
+	// Can the frame be decoded without the previous one (i.e. are
+	// there no unchanged and motion compensated blocks in it)?
+	BOOL IsIndependentFrame(const BYTE *pbData, LONG lDataSize);
+
 public:
 
 	CROQChunkParser(
@@ -55,6 +68,8 @@ public:
 		WORD nFramesPerSecond,			// Number of frames per second
 		WORD nSampleSize,				// (Uncompressed) audio sample size in bytes
 		DWORD nAvgBytesPerSec,			// Audio data rate
+		WORD wWidth,					// Video width
+		WORD wHeight,					// Video height
 		HRESULT *phr					// Success or error code
 	);
 	~CROQChunkParser();
@@ -75,6 +90,9 @@ protected:
 	);
 	HRESULT ParseChunkEnd(void);
 
+	// Get the chunk type for the filter statistics
+	BOOL GetChunkType(const BYTE *pbHeader, DWORD *pdwType);
+
 };
 
 //==========================================================================
@@ -96,6 +114,10 @@ class CROQSplitterFilter :	public CBaseParserFilter,
 	WORD	m_nSampleSize;			// (Uncompressed) audio sample size in bytes
 	DWORD	m_nAvgBytesPerSec;		// Audio data rate
 
+	// Video dimensions (used by the parser in the trick-play mode)
+	WORD	m_wWidth;				// Video width
+	WORD	m_wHeight;				// Video height
+
 	// External soundtrack (MP3) options
 	BOOL m_bUseExternalMP3;					// Should we use external MP3 file?
 	OLECHAR m_szExternalMP3Path[MAX_PATH];	// Path (relative) to the MP3 files
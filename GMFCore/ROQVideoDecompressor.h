@@ -27,57 +27,25 @@
 
 #include <streams.h>
 
+#include "BaseDecompressor.h"
 #include "ROQSpecs.h"
+#include "ROQVideoDecoder.h"
 
 //==========================================================================
 // ROQ video decompressor filter class
 //==========================================================================
 
-class CROQVideoDecompressor :	public CTransformFilter,
+class CROQVideoDecompressor :	public CBaseDecompressorFilter,
 								public ISpecifyPropertyPages
 {
 
-	// ---- ROQ video decoder stuff ----
-	// Source code taken from roqvideo.c
-	// by Dr. Tim Ferguson (timf@csse.monash.edu.au)
-
-	// Previous frame data
-	BYTE *m_pPreviousFrame, *m_pCurrentFrame;
-
-	// Strides for Y and Cb/Cr planes
-	WORD m_wYStride;
-	WORD m_wCStride;
-
-	// 2x2 and 4x4 codebooks
-	ROQ_CELL m_Cells[256];
-	ROQ_QCELL m_QCells[256];
-
-	// Format block
-	ROQ_VIDEO_FORMAT *m_pFormat;
+	// Platform-neutral ROQ video decoder
+	CROQVideoDecoder m_Decoder;
 
 	// Constructor/destructor
 	CROQVideoDecompressor(LPUNKNOWN pUnk, HRESULT *phr);
 	~CROQVideoDecompressor();
 
-	// ---- ROQ video decoder methods ----
-	// Source code taken from roqvideo.c 
-	// by Dr. Tim Ferguson (timf@csse.monash.edu.au)
-	void ApplyVector2x2(int x, int y, ROQ_CELL *cell);
-	void ApplyVector4x4(int x, int y, ROQ_CELL *cell);
-	void ApplyMotion4x4(int x, int y, unsigned char mv, char mean_x, char mean_y);
-	void ApplyMotion8x8(int x, int y, unsigned char mv, char mean_x, char mean_y);
-	void ROQVideoDecodeFrame(BYTE *pbData, DWORD dwSize, WORD wArgument);
-
-	// Utility YUV plane pointers methods
-	inline BYTE* GetYPlane(BYTE *pbImage) { return pbImage; };
-	/* inline BYTE* GetUPlane(BYTE *pbImage) { return pbImage + 5 * m_pFormat->wWidth * m_pFormat->wHeight / 4; }; */
-	inline BYTE* GetUPlane(BYTE *pbImage) { return pbImage + 2 * m_pFormat->wWidth * m_pFormat->wHeight; };
-	inline BYTE* GetVPlane(BYTE *pbImage) { return pbImage + m_pFormat->wWidth * m_pFormat->wHeight; };
-
-	// Utility method to downsample upsampled U/V planes
-	// and put the result to the output buffer
-	void DownsampleColorPlanes(BYTE *pbInImage, BYTE *pbOutImage);
-
 public:
 
 	static CUnknown * WINAPI CreateInstance(LPUNKNOWN pUnk, HRESULT *phr);
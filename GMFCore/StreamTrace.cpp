@@ -0,0 +1,362 @@
+//==========================================================================
+//
+// File: StreamTrace.cpp
+//
+// Desc: Game Media Formats - Implementation of streaming path tracer
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#include <stdio.h>
+
+#include "StreamTrace.h"
+#include "FilterOptions.h"
+
+//==========================================================================
+// Tracer state
+//==========================================================================
+
+const WCHAR g_wszStreamTraceName[] = L"Stream Trace";
+
+// Size of the event buffer. The buffer is written to the file
+// when it's full (that's done on the streaming thread, so keep
+// the buffer large enough not to produce the hitches of its own)
+#define TRACE_BUFFER_SIZE	0x40000
+
+// Maximum size of an event record
+#define TRACE_EVENT_SIZE	512
+
+static CCritSec g_csTrace;				// Tracer state protection
+static LONG g_nTraceRefs = 0;			// Number of filters alive
+static HANDLE g_hTraceFile = INVALID_HANDLE_VALUE;	// Trace file
+static volatile BOOL g_bTraceEnabled = FALSE;		// Is the trace being recorded?
+static LONGLONG g_llTraceStart = 0;		// Trace start time
+static DWORD g_nTraceEvents = 0;		// Events recorded so far
+static char g_szTraceBuffer[TRACE_BUFFER_SIZE];	// Event buffer
+static DWORD g_cbTraceBuffer = 0;		// Event buffer data size
+
+// Write out the event buffer (the tracer lock should be held)
+static void FlushStreamTrace(void)
+{
+	if ((g_hTraceFile != INVALID_HANDLE_VALUE) && (g_cbTraceBuffer > 0)) {
+		DWORD cbWritten = 0;
+		WriteFile(g_hTraceFile, g_szTraceBuffer, g_cbTraceBuffer, &cbWritten, NULL);
+	}
+	g_cbTraceBuffer = 0;
+}
+
+// Write the character escaped for a JSON string (quotes, backslashes,
+// control and non-ASCII characters are escaped). Returns the size of 
+// the escaped character (the buffer should hold 7 bytes)
+static int EscapeTraceChar(char *pszChar, WCHAR wc)
+{
+	if ((wc == L'"') || (wc == L'\\')) {
+		pszChar[0] = '\\';
+		pszChar[1] = (char)wc;
+		return 2;
+	} else if ((wc < 0x20) || (wc >= 0x7F)) {
+		wsprintfA(pszChar, "\\u%04x", (int)wc);
+		return 6;
+	} else {
+		pszChar[0] = (char)wc;
+		return 1;
+	}
+}
+
+// Write the string as the contents of a JSON string into the buffer. 
+// The string is cut short if the buffer is too small for it
+static void EscapeTraceString(char *pszBuffer, int cbBuffer, LPCWSTR pszString)
+{
+	ASSERT(pszBuffer);
+	ASSERT(cbBuffer > 0);
+
+	int cbData = 0;
+	for (; (pszString) && (*pszString); pszString++) {
+
+		// Leave room for the terminating zero
+		char szChar[8];
+		int cbChar = EscapeTraceChar(szChar, *pszString);
+		if (cbData + cbChar >= cbBuffer)
+			break;
+		CopyMemory(pszBuffer + cbData, szChar, cbChar);
+		cbData += cbChar;
+	}
+	pszBuffer[cbData] = 0;
+}
+
+static void EscapeTraceString(char *pszBuffer, int cbBuffer, LPCSTR pszString)
+{
+	ASSERT(pszBuffer);
+	ASSERT(cbBuffer > 0);
+
+	int cbData = 0;
+	for (; (pszString) && (*pszString); pszString++) {
+
+		// Leave room for the terminating zero
+		char szChar[8];
+		int cbChar = EscapeTraceChar(szChar, (WCHAR)(BYTE)*pszString);
+		if (cbData + cbChar >= cbBuffer)
+			break;
+		CopyMemory(pszBuffer + cbData, szChar, cbChar);
+		cbData += cbChar;
+	}
+	pszBuffer[cbData] = 0;
+}
+
+//==========================================================================
+// Tracer functions
+//==========================================================================
+
+void StartStreamTrace(void)
+{
+	// Protect the tracer state
+	CAutoLock lock(&g_csTrace);
+
+	// Only the first filter starts the trace
+	if (g_nTraceRefs++ > 0)
+		return;
+
+	// Get the trace file name. No trace file -- no tracing
+	TCHAR szFileName[MAX_PATH];
+	DWORD dwType = 0, cbFileName = sizeof(szFileName) - sizeof(TCHAR);
+	ZeroMemory(szFileName, sizeof(szFileName));
+	HRESULT hr = RegGetFilterOptionValue(
+		g_wszStreamTraceName,
+		TEXT("Trace File"),
+		&dwType,
+		(LPBYTE)szFileName,
+		&cbFileName
+	);
+	if (FAILED(hr) || (dwType != REG_SZ) || (szFileName[0] == 0))
+		return;
+
+	// Create the trace file
+	g_hTraceFile = CreateFile(
+		szFileName,
+		GENERIC_WRITE,
+		FILE_SHARE_READ,
+		NULL,
+		CREATE_ALWAYS,
+		FILE_ATTRIBUTE_NORMAL,
+		NULL
+	);
+	if (g_hTraceFile == INVALID_HANDLE_VALUE)
+		return;
+
+	g_llTraceStart	= GetStatisticsTime();
+	g_nTraceEvents	= 0;
+	g_cbTraceBuffer	= 0;
+	g_bTraceEnabled	= TRUE;
+}
+
+void StopStreamTrace(void)
+{
+	// Protect the tracer state
+	CAutoLock lock(&g_csTrace);
+
+	// Only the last filter stops the trace
+	ASSERT(g_nTraceRefs > 0);
+	if (--g_nTraceRefs > 0)
+		return;
+
+	if (g_hTraceFile == INVALID_HANDLE_VALUE)
+		return;
+
+	g_bTraceEnabled = FALSE;
+
+	FlushStreamTrace();
+
+	// Close the event array (the opening bracket is written with
+	// the first event, so an empty trace is an empty array)
+	const char *pszEnd = (g_nTraceEvents > 0) ? "\n]\n" : "[]\n";
+	DWORD cbWritten = 0;
+	WriteFile(g_hTraceFile, pszEnd, lstrlenA(pszEnd), &cbWritten, NULL);
+
+	CloseHandle(g_hTraceFile);
+	g_hTraceFile = INVALID_HANDLE_VALUE;
+}
+
+BOOL IsStreamTraceEnabled(void)
+{
+	return g_bTraceEnabled;
+}
+
+void TraceStreamSpan(
+	LPCSTR pszName,
+	LPCWSTR pszStream,
+	LPCSTR pszArg,
+	LONGLONG llArg,
+	LONGLONG llStartTime,
+	LONGLONG llStopTime
+)
+{
+	// Protect the tracer state
+	CAutoLock lock(&g_csTrace);
+
+	// The trace may have been stopped while the span was recorded
+	if (!g_bTraceEnabled)
+		return;
+
+	// Make sure there's room for the event
+	if (TRACE_BUFFER_SIZE - g_cbTraceBuffer < TRACE_EVENT_SIZE)
+		FlushStreamTrace();
+
+	// Chrome trace times are in microseconds
+	LONGLONG llStart = llStartTime - g_llTraceStart;
+	LONGLONG llDuration = llStopTime - llStartTime;
+
+	// The span and stream names (the latter is the pin name, 
+	// which may contain anything) should be valid JSON strings
+	char szName[128], szStream[128];
+	EscapeTraceString(szName, sizeof(szName), pszName);
+	EscapeTraceString(szStream, sizeof(szStream), pszStream);
+
+	// Format the complete ("X") event
+	char *pszEvent = g_szTraceBuffer + g_cbTraceBuffer;
+	int nLength = _snprintf(
+		pszEvent,
+		TRACE_EVENT_SIZE,
+		"%s{\"name\":\"%s\",\"cat\":\"gmf\",\"ph\":\"X\",\"pid\":%lu,\"tid\":%lu,"
+		"\"ts\":%I64d.%d,\"dur\":%I64d.%d,\"args\":{\"stream\":\"%s\"",
+		(g_nTraceEvents == 0) ? "[\n" : ",\n",
+		szName,
+		GetCurrentProcessId(),
+		GetCurrentThreadId(),
+		llStart / 10, (int)(llStart % 10),
+		llDuration / 10, (int)(llDuration % 10),
+		szStream
+	);
+	if ((nLength < 0) || (nLength >= TRACE_EVENT_SIZE - 64))
+		return;
+
+	// Add the argument (if any) and close the event
+	int nArgLength = (pszArg) ?
+		_snprintf(pszEvent + nLength, TRACE_EVENT_SIZE - nLength, ",\"%s\":%I64d}}", pszArg, llArg) :
+		_snprintf(pszEvent + nLength, TRACE_EVENT_SIZE - nLength, "}}");
+	if (nArgLength < 0)
+		return;
+
+	g_cbTraceBuffer += nLength + nArgLength;
+	g_nTraceEvents++;
+}
+
+LONGLONG GetTraceSampleTime(IMediaSample *pSample)
+{
+	REFERENCE_TIME rtStart = 0, rtStop = 0;
+	if (pSample && SUCCEEDED(pSample->GetTime(&rtStart, &rtStop)))
+		return rtStart;
+
+	return -1;
+}
+
+//==========================================================================
+// CTraceMemInputPin methods
+//==========================================================================
+
+CTraceMemInputPin::CTraceMemInputPin(
+	IMemInputPin *pPin,
+	LPCWSTR pszStream
+) :
+	m_cRef(1),
+	m_pPin(pPin),
+	m_pszStream(pszStream)
+{
+	ASSERT(pPin);
+
+	// Hold a reference on the wrapped pin
+	m_pPin->AddRef();
+}
+
+CTraceMemInputPin::~CTraceMemInputPin()
+{
+	m_pPin->Release();
+}
+
+STDMETHODIMP CTraceMemInputPin::QueryInterface(REFIID riid, void **ppv)
+{
+	// Check the pointer
+	CheckPointer(ppv, E_POINTER);
+
+	// Only IMemInputPin is wrapped, the rest goes to the wrapped pin 
+	// (including IUnknown, so that the pin's COM identity is kept)
+	if (riid == IID_IMemInputPin) {
+		*ppv = (IMemInputPin*)this;
+		AddRef();
+		return NOERROR;
+	}
+
+	return m_pPin->QueryInterface(riid, ppv);
+}
+
+STDMETHODIMP_(ULONG) CTraceMemInputPin::AddRef(void)
+{
+	return (ULONG)InterlockedIncrement(&m_cRef);
+}
+
+STDMETHODIMP_(ULONG) CTraceMemInputPin::Release(void)
+{
+	LONG cRef = InterlockedDecrement(&m_cRef);
+	if (cRef == 0)
+		delete this;
+
+	return (ULONG)cRef;
+}
+
+STDMETHODIMP CTraceMemInputPin::GetAllocator(IMemAllocator **ppAllocator)
+{
+	return m_pPin->GetAllocator(ppAllocator);
+}
+
+STDMETHODIMP CTraceMemInputPin::NotifyAllocator(IMemAllocator *pAllocator, BOOL bReadOnly)
+{
+	return m_pPin->NotifyAllocator(pAllocator, bReadOnly);
+}
+
+STDMETHODIMP CTraceMemInputPin::GetAllocatorRequirements(ALLOCATOR_PROPERTIES *pProps)
+{
+	return m_pPin->GetAllocatorRequirements(pProps);
+}
+
+STDMETHODIMP CTraceMemInputPin::Receive(IMediaSample *pSample)
+{
+	CTraceSpan span("OutputQueue::Deliver", m_pszStream, "time", GetTraceSampleTime(pSample));
+
+	return m_pPin->Receive(pSample);
+}
+
+STDMETHODIMP CTraceMemInputPin::ReceiveMultiple(
+	IMediaSample **pSamples,
+	long nSamples,
+	long *nSamplesProcessed
+)
+{
+	// The span gets the time of the first sample in the batch
+	CTraceSpan span(
+		"OutputQueue::Deliver",
+		m_pszStream,
+		"time",
+		(nSamples > 0) ? GetTraceSampleTime(pSamples[0]) : -1
+	);
+
+	return m_pPin->ReceiveMultiple(pSamples, nSamples, nSamplesProcessed);
+}
+
+STDMETHODIMP CTraceMemInputPin::ReceiveCanBlock(void)
+{
+	return m_pPin->ReceiveCanBlock();
+}
@@ -0,0 +1,148 @@
+//==========================================================================
+//
+// File: StreamTrace.h
+//
+// Desc: Game Media Formats - Header file for streaming path tracer
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#ifndef __GMF_STREAM_TRACE_H__
+#define __GMF_STREAM_TRACE_H__
+
+#include <streams.h>
+
+#include "FilterStatistics.h"
+
+//==========================================================================
+// Streaming path tracer
+//
+// Opt-in tracer which records the spans of the streaming methods
+// (with the thread, pin/stream name and sample time or file position)
+// in the Chrome trace event format, so that the trace file can be
+// loaded into chrome://tracing or Perfetto to see how the pull thread,
+// the output queue threads and the decoders interact.
+// Tracing is enabled by setting the "Trace File" string value in the
+// "Stream Trace" section of the filter options to the trace file path.
+// The trace is started when the first filter is created and written
+// out when the last filter is destroyed (the file is overwritten
+// on each start)
+//==========================================================================
+
+// Filter options section name for the tracer options
+extern const WCHAR g_wszStreamTraceName[];
+
+// Trace session reference counting. Every filter calls
+// StartStreamTrace() in its constructor and StopStreamTrace()
+// in its destructor
+void StartStreamTrace(void);
+void StopStreamTrace(void);
+
+// Is the trace being recorded?
+BOOL IsStreamTraceEnabled(void);
+
+// Record a complete span. The times are the GetStatisticsTime()
+// values, the stream name and the argument name may be NULL
+void TraceStreamSpan(
+	LPCSTR pszName,			// Span name
+	LPCWSTR pszStream,		// Pin or stream name
+	LPCSTR pszArg,			// Argument name
+	LONGLONG llArg,			// Argument value
+	LONGLONG llStartTime,	// Span start time
+	LONGLONG llStopTime		// Span stop time
+);
+
+//==========================================================================
+// Trace span class
+//
+// Records the span from its construction to its destruction
+// (much like CAutoLock holds the lock). Does nothing if the
+// tracing is disabled
+//==========================================================================
+
+class CTraceSpan
+{
+	LPCSTR		m_pszName;		// Span name
+	LPCWSTR		m_pszStream;	// Pin or stream name
+	LPCSTR		m_pszArg;		// Argument name
+	LONGLONG	m_llArg;		// Argument value
+	LONGLONG	m_llStartTime;	// Span start time (zero if not tracing)
+
+public:
+
+	CTraceSpan(
+		LPCSTR pszName,
+		LPCWSTR pszStream,
+		LPCSTR pszArg = NULL,
+		LONGLONG llArg = 0
+	) :
+		m_pszName(pszName),
+		m_pszStream(pszStream),
+		m_pszArg(pszArg),
+		m_llArg(llArg),
+		m_llStartTime(IsStreamTraceEnabled() ? GetStatisticsTime() : 0)
+	{};
+
+	~CTraceSpan()
+	{
+		if (m_llStartTime)
+			TraceStreamSpan(m_pszName, m_pszStream, m_pszArg, m_llArg, m_llStartTime, GetStatisticsTime());
+	};
+};
+
+//==========================================================================
+// Tracing memory input pin class
+//
+// IMemInputPin wrapper which records the spans of Receive() and
+// ReceiveMultiple() calls made on the wrapped pin. It's used to
+// trace the deliveries done by the output queue threads
+//==========================================================================
+
+class CTraceMemInputPin : public IMemInputPin
+{
+	LONG			m_cRef;			// Reference count
+	IMemInputPin	*m_pPin;		// Wrapped pin
+	LPCWSTR			m_pszStream;	// Stream name (outlives the wrapper)
+
+public:
+
+	CTraceMemInputPin(IMemInputPin *pPin, LPCWSTR pszStream);
+	virtual ~CTraceMemInputPin();
+
+	// ---- IUnknown methods ----
+	STDMETHODIMP QueryInterface(REFIID riid, void **ppv);
+	STDMETHODIMP_(ULONG) AddRef(void);
+	STDMETHODIMP_(ULONG) Release(void);
+
+	// ---- IMemInputPin methods ----
+	STDMETHODIMP GetAllocator(IMemAllocator **ppAllocator);
+	STDMETHODIMP NotifyAllocator(IMemAllocator *pAllocator, BOOL bReadOnly);
+	STDMETHODIMP GetAllocatorRequirements(ALLOCATOR_PROPERTIES *pProps);
+	STDMETHODIMP Receive(IMediaSample *pSample);
+	STDMETHODIMP ReceiveMultiple(
+		IMediaSample **pSamples,
+		long nSamples,
+		long *nSamplesProcessed
+	);
+	STDMETHODIMP ReceiveCanBlock(void);
+};
+
+// Get the sample start time for the trace argument (-1 if not set)
+LONGLONG GetTraceSampleTime(IMediaSample *pSample);
+
+#endif
@@ -28,7 +28,7 @@
 #ifndef __GMF_VMD_SPECS_H__
 #define __GMF_VMD_SPECS_H__
 
-#include <windows.h>
+#include "CodecTypes.h"
 
 //==========================================================================
 // Constants
@@ -87,12 +87,12 @@ typedef struct tagVMD_FRAME_ENTRY {
 
 	union {
 
-	struct tagAudioFrame {
+	struct {
 		BYTE	bAudioFlags;	// Audio flags
 		BYTE	bUnknown2[9];	// ???
 	};
 
-	struct tagVideoFrame {
+	struct {
 		WORD	wImageLeft;		// Left coordinate of video frame
 		WORD	wImageTop;		// Top coordinate of video frame
 		WORD	wImageRight;	// Right coordinate of video frame
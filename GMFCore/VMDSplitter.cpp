@@ -105,14 +105,6 @@ const AMOVIESETUP_FILTER g_sudVMDSplitter = {
 // VMD splitter file type setup data
 //==========================================================================
 
-const GMF_FILETYPE_PATTERN sudVMDPatterns[] = {
-	{ 0,	2,	VMD_IDSTR_HEADERSIZE	}
-};
-
-const GMF_FILETYPE_ENTRY sudVMDEntries[] = {
-	{ 1, sudVMDPatterns } 
-};
-
 const TCHAR *sudVMDExtensions[] = {
 	TEXT(".vmd")
 };
@@ -332,33 +324,14 @@ HRESULT CVMDChunkParser::ParseChunkData(
 	if (!m_pSample)
 		return NOERROR;
 
-	// Get the sample's buffer
-	BYTE *pbBuffer = NULL;
-	HRESULT hr = m_pSample->GetPointer(&pbBuffer);
-	if (FAILED(hr)) {
-		m_pSample->Release();
-		m_pSample = NULL;
-		return hr;
-	}
-
-	// Find out how many bytes we can copy
-	LONG lBufferSize = m_pSample->GetSize();
-	LONG lActualDataLength = m_pSample->GetActualDataLength();
-	LONG lDataToCopy = min(lDataSize, lBufferSize - lActualDataLength);
-
-	// Copy data to buffer
-	CopyMemory(pbBuffer + lActualDataLength, pbData, lDataToCopy);
-	lActualDataLength += lDataToCopy;
-
-	// Update buffer's actual data length
-	hr = m_pSample->SetActualDataLength(lActualDataLength);
-	if (FAILED(hr)) {
+	// Append data to the sample
+	HRESULT hr = AppendChunkData(m_pSample, pbData, lDataSize);
+	if (FAILED(hr) && (hr != VFW_E_BUFFER_OVERFLOW)) {
 		m_pSample->Release();
 		m_pSample = NULL;
-		return hr;
 	}
 
-	return (lDataToCopy < lDataSize) ? VFW_E_BUFFER_OVERFLOW : NOERROR;
+	return hr;
 }
 
 HRESULT CVMDChunkParser::ParseChunkEnd(void)
@@ -542,7 +515,7 @@ HRESULT CVMDSplitterFilter::Initialize(IPin *pPin, IAsyncReader *pReader)
 	// Set the video allocator properties
 	papVideo->cbAlign	= 0;	// No matter
 	papVideo->cbPrefix	= 0;	// No matter
-	papVideo->cBuffers	= 4;	// TEMP: No need to set larger value?
+	papVideo->cBuffers	= 4;	// Default (the pin option may override it)
 	papVideo->cbBuffer	= cbMaxImage;
 
 	// Allocate time formats array. If we fail here, it's not an error, 
@@ -27,8 +27,7 @@
 #ifndef __GMF_VQA_SPECS_H__
 #define __GMF_VQA_SPECS_H__
 
-#include <windows.h>
-#include <mmsystem.h>
+#include "CodecTypes.h"
 
 // Utility macro: convert DWORD from big-endian to little-endian
 #define SWAPDWORD(x) (			\
@@ -29,6 +29,14 @@
 #include "WSADPCM.h"
 #include "resource.h"
 
+// File position of the frame from the frame table entry
+#define CORRPOS(x)							\
+(											\
+	((x) >= VQA_PALETTE_MARKER)				\
+	? (2 * ((x) - VQA_PALETTE_MARKER))		\
+	: (2 * (x))								\
+)
+
 //==========================================================================
 // VQA splitter setup data
 //==========================================================================
@@ -117,15 +125,6 @@ const AMOVIESETUP_FILTER g_sudVQASplitter = {
 // VQA splitter file type setup data
 //==========================================================================
 
-const GMF_FILETYPE_PATTERN sudVQAPatterns[] = {
-	{ 0,	4,	VQA_IDSTR_FORM	},
-	{ 8,	4,	VQA_IDSTR_WVQA	}
-};
-
-const GMF_FILETYPE_ENTRY sudVQAEntries[] = {
-	{ 2, sudVQAPatterns } 
-};
-
 const TCHAR *sudVQAExtensions[] = {
 	TEXT(".vqa")
 };
@@ -156,6 +155,11 @@ CVQAChunkParser::CVQAChunkParser(
 	WORD wCompressionRatio,
 	WORD nSampleSize,
 	DWORD nAvgBytesPerSec,
+	const DWORD *pFrameTable,
+	DWORD nFrameEntries,
+	const VQA_CIND_ENTRY *pCodebookTable,
+	DWORD nCodebooks,
+	BOOL bIsHiColor,
 	HRESULT *phr
 ) :
 	CBaseChunkParser(
@@ -173,8 +177,30 @@ CVQAChunkParser::CVQAChunkParser(
 	m_nFramesPerSecond(nFramesPerSecond),
 	m_wCompressionRatio(wCompressionRatio),
 	m_nSampleSize(nSampleSize),
-	m_nAvgBytesPerSec(nAvgBytesPerSec)
+	m_nAvgBytesPerSec(nAvgBytesPerSec),
+	m_pFrameTable(pFrameTable),
+	m_nFrameEntries(nFrameEntries),
+	m_pCodebookTable(pCodebookTable),
+	m_nCodebooks(nCodebooks),
+	m_bCheckCodebook(FALSE),
+	m_bSkipFrame(FALSE),
+	m_llSeekStart(-1),
+	m_llSeekTarget(-1),
+	m_iSeekFrame(0),
+	m_iTargetFrame(0),
+	m_pbSeekPalette(NULL),
+	m_cbSeekPalette(0),
+	m_bIsHiColor(bIsHiColor),
+	m_bIsPreroll(FALSE),
+	m_iPrerollFrame(-1)
 {
+	// The tables are of no use unless we've got both of them
+	if ((m_pFrameTable == NULL) || (m_pCodebookTable == NULL)) {
+		m_pFrameTable		= NULL;
+		m_nFrameEntries		= 0;
+		m_pCodebookTable	= NULL;
+		m_nCodebooks		= 0;
+	}
 }
 
 CVQAChunkParser::~CVQAChunkParser()
@@ -200,10 +226,263 @@ HRESULT CVQAChunkParser::ResetParser(void)
 	m_rtDelta = 0;
 	m_llDelta = 0;
 
+	// No frame to check or skip
+	m_bCheckCodebook = FALSE;
+	m_bSkipFrame = FALSE;
+
+	// No seek to carry out
+	CancelSeek();
+
 	// Call base-class method to reset parser state
 	return CBaseChunkParser::ResetParser();
 }
 
+HRESULT CVQAChunkParser::SetSeekState(
+	LONGLONG llStart,
+	LONG iStartFrame,
+	LONGLONG llTarget,
+	LONG iTargetFrame,
+	const BYTE *pbPalette,
+	LONG cbPalette
+)
+{
+	CAutoLock lock(&m_csLock);
+
+	// Forget the previous seek
+	CancelSeek();
+
+	// Copy the palette subchunk
+	if ((pbPalette != NULL) && (cbPalette > 0)) {
+		m_pbSeekPalette = (BYTE*)CoTaskMemAlloc(cbPalette);
+		if (m_pbSeekPalette == NULL)
+			return E_OUTOFMEMORY;
+		CopyMemory(m_pbSeekPalette, pbPalette, cbPalette);
+		m_cbSeekPalette = cbPalette;
+	}
+
+	m_llSeekStart	= llStart;
+	m_llSeekTarget	= llTarget;
+	m_iSeekFrame	= iStartFrame;
+	m_iTargetFrame	= iTargetFrame;
+
+	return NOERROR;
+}
+
+void CVQAChunkParser::CancelSeek(void)
+{
+	m_llSeekStart	= -1;
+	m_llSeekTarget	= -1;
+	m_iSeekFrame	= 0;
+	m_iTargetFrame	= 0;
+	m_bIsPreroll	= FALSE;
+	m_iPrerollFrame	= -1;
+	if (m_pbSeekPalette) {
+		CoTaskMemFree(m_pbSeekPalette);
+		m_pbSeekPalette = NULL;
+	}
+	m_cbSeekPalette = 0;
+}
+
+HRESULT CVQAChunkParser::DeliverSeekPalette(void)
+{
+	CParserOutputPin *pPin = m_ppOutputPin[0];
+
+	// Get an empty sample for the palette subchunk
+	IMediaSample *pSample = NULL;
+	HRESULT hr = pPin->GetChunkBuffer(&pSample, m_cbSeekPalette);
+	if (FAILED(hr))
+		return hr;
+
+	// Get the sample's buffer
+	BYTE *pbBuffer = NULL;
+	hr = pSample->GetPointer(&pbBuffer);
+	if (FAILED(hr)) {
+		pSample->Release();
+		return hr;
+	}
+
+	// Copy the subchunk
+	if (pSample->GetSize() < m_cbSeekPalette) {
+		pSample->Release();
+		return VFW_E_BUFFER_OVERFLOW;
+	}
+	CopyMemory(pbBuffer, m_pbSeekPalette, m_cbSeekPalette);
+	pSample->SetActualDataLength(m_cbSeekPalette);
+
+	// The palette belongs to no frame, so the sample has no times
+	// (the decoder keeps it till the target frame)
+	pSample->SetPreroll(TRUE);
+	pSample->SetTime(NULL, NULL);
+	pSample->SetMediaTime(NULL, NULL);
+
+	// Deliver the sample
+	hr = pPin->Deliver(pSample);
+	pSample->Release();
+
+	return hr;
+}
+
+LONG CVQAChunkParser::StripFrame(BYTE *pbData, LONG lDataSize)
+{
+	BYTE *pbOutput = pbData;
+	LONG lOutputSize = 0;
+
+	// Walk the frame subchunks
+	while (lDataSize >= (LONG)sizeof(VQA_CHUNK_HEADER)) {
+
+		const VQA_CHUNK_HEADER *pHeader = (const VQA_CHUNK_HEADER*)pbData;
+
+		// Get the subchunk size (aligned to even boundary)
+		DWORD cbChunk = SWAPDWORD(pHeader->cbSize);
+		if (cbChunk % 2)
+			cbChunk++;
+		if (cbChunk > (DWORD)lDataSize - sizeof(VQA_CHUNK_HEADER))
+			cbChunk = (DWORD)lDataSize - sizeof(VQA_CHUNK_HEADER);
+		LONG lChunkSize = sizeof(VQA_CHUNK_HEADER) + (LONG)cbChunk;
+
+		// Keep the codebook and palette subchunks
+		switch (pHeader->dwID) {
+			case VQA_ID_CBF0:
+			case VQA_ID_CBFZ:
+			case VQA_ID_CBP0:
+			case VQA_ID_CBPZ:
+			case VQA_ID_CPL0:
+			case VQA_ID_CPLZ:
+				MoveMemory(pbOutput + lOutputSize, pbData, lChunkSize);
+				lOutputSize += lChunkSize;
+				break;
+			default:
+				break;
+		}
+
+		pbData		+= lChunkSize;
+		lDataSize	-= lChunkSize;
+	}
+
+	return lOutputSize;
+}
+
+HRESULT CVQAChunkParser::DeliverPreroll(void)
+{
+	HRESULT hr = NOERROR;
+
+	// The 8-bit frames are complete images, so the decoder needs
+	// only their codebook and palette data
+	if (!m_bIsHiColor) {
+
+		// Get the sample's buffer
+		BYTE *pbBuffer = NULL;
+		hr = m_pSample->GetPointer(&pbBuffer);
+		if (FAILED(hr))
+			return hr;
+
+		// Nothing to deliver if no such data is left, unless the 
+		// frame switches to the new codebook (the decoder looks the 
+		// frame up in the codebook table, so it needs the sample even
+		// if it's empty)
+		LONG lDataSize = StripFrame(pbBuffer, m_pSample->GetActualDataLength());
+		if (
+			(lDataSize == 0) &&
+			((m_iPrerollFrame < 0) || (!IsCodebookFrame((DWORD)m_iPrerollFrame)))
+		)
+			return NOERROR;
+		m_pSample->SetActualDataLength(lDataSize);
+	}
+
+	// Set the sample times relative to the target frame (the 
+	// full codebook chunks belong to no frame). The frame skipped 
+	// in the trick-play mode keeps its place in the stream (the 
+	// decoder looks the frame up in the codebook table)
+	m_pSample->SetPreroll(TRUE);
+	if (m_iPrerollFrame >= 0) {
+		REFERENCE_TIME rtStart	= ((REFERENCE_TIME)(m_iPrerollFrame - m_iTargetFrame) * UNITS) / m_nFramesPerSecond;
+		REFERENCE_TIME rtStop	= rtStart + UNITS / m_nFramesPerSecond;
+		LONGLONG llStart		= m_iPrerollFrame;
+		LONGLONG llStop			= llStart + 1;
+		m_pSample->SetTime(&rtStart, &rtStop);
+		m_pSample->SetMediaTime(&llStart, &llStop);
+	} else if (m_bSkipFrame) {
+		REFERENCE_TIME rtStart	= m_pPin->GetTime();
+		REFERENCE_TIME rtStop	= rtStart + m_rtDelta;
+		LONGLONG llStart		= m_pPin->GetMediaTime();
+		LONGLONG llStop			= llStart + m_llDelta;
+		m_pSample->SetTime(&rtStart, &rtStop);
+		m_pSample->SetMediaTime(&llStart, &llStop);
+	} else {
+		m_pSample->SetTime(NULL, NULL);
+		m_pSample->SetMediaTime(NULL, NULL);
+	}
+
+	// Deliver the sample (the pin times stay at the target frame)
+	return m_pPin->Deliver(m_pSample);
+}
+
+BOOL CVQAChunkParser::IsKeyFrame(LONGLONG llPosition)
+{
+	// Without the tables any frame is taken for the key one
+	if ((m_pFrameTable == NULL) || (m_nFrameEntries == 0))
+		return TRUE;
+
+	// Find the last frame starting at or before the position
+	// (the frame offsets are ascending)
+	DWORD iLow = 0, iHigh = m_nFrameEntries;
+	while (iHigh - iLow > 1) {
+		DWORD iMiddle = (iLow + iHigh) / 2;
+		if (CORRPOS((LONGLONG)m_pFrameTable[iMiddle]) <= llPosition)
+			iLow = iMiddle;
+		else
+			iHigh = iMiddle;
+	}
+
+	return IsCodebookFrame(iLow);
+}
+
+BOOL CVQAChunkParser::IsCodebookFrame(DWORD iFrame)
+{
+	// Without the tables no frame can be found
+	if ((m_pCodebookTable == NULL) || (m_nCodebooks == 0))
+		return FALSE;
+
+	// Look the frame up in the codebook table (which is
+	// sorted by the frame index)
+	DWORD iFirst = 0, iLast = m_nCodebooks;
+	while (iFirst < iLast) {
+		DWORD iMiddle = (iFirst + iLast) / 2;
+		if (m_pCodebookTable[iMiddle].iFrame < iFrame)
+			iFirst = iMiddle + 1;
+		else
+			iLast = iMiddle;
+	}
+
+	return (
+		(iFirst < m_nCodebooks) &&
+		(m_pCodebookTable[iFirst].iFrame == iFrame) &&
+		(m_pCodebookTable[iFirst].cbSize != 0)
+	);
+}
+
+BOOL CVQAChunkParser::HasFullCodebook(const BYTE *pbData, LONG lDataSize)
+{
+	// Walk the frame subchunks
+	while (lDataSize >= (LONG)sizeof(VQA_CHUNK_HEADER)) {
+
+		const VQA_CHUNK_HEADER *pHeader = (const VQA_CHUNK_HEADER*)pbData;
+		if ((pHeader->dwID == VQA_ID_CBF0) || (pHeader->dwID == VQA_ID_CBFZ))
+			return TRUE;
+
+		// Skip over the subchunk (aligned to even boundary)
+		DWORD cbChunk = SWAPDWORD(pHeader->cbSize);
+		if (cbChunk % 2)
+			cbChunk++;
+		if (cbChunk > (DWORD)lDataSize - sizeof(VQA_CHUNK_HEADER))
+			break;
+		pbData		+= sizeof(VQA_CHUNK_HEADER) + cbChunk;
+		lDataSize	-= sizeof(VQA_CHUNK_HEADER) + cbChunk;
+	}
+
+	return FALSE;
+}
+
 HRESULT CVQAChunkParser::ParseChunkHeader(
 	LONGLONG llStartPosition,
 	BYTE *pbHeader,
@@ -224,6 +503,33 @@ HRESULT CVQAChunkParser::ParseChunkHeader(
 	m_pSample = NULL;
 	m_rtDelta = 0;
 	m_llDelta = 0;
+	m_bIsPreroll = FALSE;
+	m_iPrerollFrame = -1;
+	m_bCheckCodebook = FALSE;
+	m_bSkipFrame = FALSE;
+
+	// The seek state is of use only if the parsing has started from 
+	// the seek start (the playback may well restart from elsewhere)
+	if (m_llSeekStart >= 0) {
+		if (llStartPosition != m_llSeekStart)
+			CancelSeek();
+		m_llSeekStart = -1;
+	}
+
+	// The chunks before the target frame only bring the decoder 
+	// up to date, so the audio ones are of no use
+	BOOL bIsPreroll = FALSE;
+	if (m_llSeekTarget >= 0) {
+		if (llStartPosition < m_llSeekTarget) {
+			if (
+				(pHeader->dwID != VQA_ID_VQFR) &&
+				(pHeader->dwID != VQA_ID_VQFL)
+			)
+				return NOERROR;
+			bIsPreroll = TRUE;
+		} else
+			m_llSeekTarget = -1;
+	}
 
 	LONG lUnpackedDataLength = 0;
 
@@ -310,22 +616,82 @@ HRESULT CVQAChunkParser::ParseChunkHeader(
 		return NOERROR;
 	}
 
-	// Get an empty sample from the output pin
-	HRESULT hr = m_pPin->GetDeliveryBuffer(&m_pSample, NULL, NULL, 0);
-	if (FAILED(hr)) {
-		m_pSample = NULL;
-		return hr;
+	// After the seek the palette in effect at the target frame 
+	// goes before any frame data
+	if ((m_pPin == m_ppOutputPin[0]) && (m_pbSeekPalette != NULL)) {
+		HRESULT hr = DeliverSeekPalette();
+		CoTaskMemFree(m_pbSeekPalette);
+		m_pbSeekPalette = NULL;
+		m_cbSeekPalette = 0;
+		if (FAILED(hr)) {
+			m_pPin = NULL;
+			return hr;
+		}
 	}
 
-	// Reset the sample's actual data length
-	hr = m_pSample->SetActualDataLength(0);
-	if (FAILED(hr)) {
-		m_pSample->Release();
-		m_pSample = NULL;
+	// The preroll frame data is copied to the sample of our own, 
+	// since the 8-bit frame data is stripped in place
+	if (bIsPreroll) {
+		m_bIsPreroll = TRUE;
+		if (pHeader->dwID == VQA_ID_VQFR)
+			m_iPrerollFrame = m_iSeekFrame++;
+		HRESULT hr = m_pPin->GetChunkBuffer(&m_pSample, *plDataSize);
+		if (FAILED(hr)) {
+			m_pPin = NULL;
+			m_pSample = NULL;
+			return hr;
+		}
+		hr = m_pSample->SetActualDataLength(0);
+		if (FAILED(hr)) {
+			m_pSample->Release();
+			m_pPin = NULL;
+			m_pSample = NULL;
+		}
 		return hr;
 	}
 
-	return NOERROR;
+	// In the trick-play mode deliver only the frames with full
+	// codebook. The rest are stripped to their codebook parts and 
+	// palette changes, which are delivered as preroll (the next frame
+	// with full codebook needs them), so only the vector pointers are
+	// skipped. The info tables tell which frames those are; without 
+	// the tables the frame data is checked in ParseChunkEnd(). Either
+	// way the data is stripped in place, so it goes to the sample of 
+	// our own. The HiColor frames keep the blocks of the previous 
+	// ones, so none of them can be skipped
+	if (
+		(pHeader->dwID == VQA_ID_VQFR) &&
+		(!m_bIsHiColor) &&
+		(m_pFilter->IsTrickPlay())
+	) {
+		if (m_pFrameTable == NULL)
+			m_bCheckCodebook = TRUE;
+		else
+			m_bSkipFrame = !IsKeyFrame(llStartPosition);
+		if ((m_bCheckCodebook) || (m_bSkipFrame)) {
+			HRESULT hr = m_pPin->GetChunkBuffer(&m_pSample, *plDataSize);
+			if (FAILED(hr)) {
+				m_pPin = NULL;
+				m_pSample = NULL;
+				return hr;
+			}
+			hr = m_pSample->SetActualDataLength(0);
+			if (FAILED(hr)) {
+				m_pSample->Release();
+				m_pPin = NULL;
+				m_pSample = NULL;
+			}
+			return hr;
+		}
+	}
+
+	// Get an empty sample for the chunk data
+	return GetChunkSample(
+		m_pPin,
+		llStartPosition + m_lHeaderSize,
+		*plDataSize,
+		&m_pSample
+	);
 }
 
 HRESULT CVQAChunkParser::ParseChunkData(
@@ -341,33 +707,14 @@ HRESULT CVQAChunkParser::ParseChunkData(
 	if (!m_pSample)
 		return NOERROR;
 
-	// Get the sample's buffer
-	BYTE *pbBuffer = NULL;
-	HRESULT hr = m_pSample->GetPointer(&pbBuffer);
-	if (FAILED(hr)) {
+	// Append data to the sample
+	HRESULT hr = AppendChunkData(m_pSample, pbData, lDataSize);
+	if (FAILED(hr) && (hr != VFW_E_BUFFER_OVERFLOW)) {
 		m_pSample->Release();
 		m_pSample = NULL;
-		return hr;
 	}
 
-	// Find out how many bytes we can copy
-	LONG lBufferSize = m_pSample->GetSize();
-	LONG lActualDataLength = m_pSample->GetActualDataLength();
-	LONG lDataToCopy = min(lDataSize, lBufferSize - lActualDataLength);
-
-	// Copy data to buffer
-	CopyMemory(pbBuffer + lActualDataLength, pbData, lDataToCopy);
-	lActualDataLength += lDataToCopy;
-
-	// Update buffer's actual data length
-	hr = m_pSample->SetActualDataLength(lActualDataLength);
-	if (FAILED(hr)) {
-		m_pSample->Release();
-		m_pSample = NULL;
-		return hr;
-	}
-
-	return (lDataToCopy < lDataSize) ? VFW_E_BUFFER_OVERFLOW : NOERROR;
+	return hr;
 }
 
 HRESULT CVQAChunkParser::ParseChunkEnd(void)
@@ -404,14 +751,59 @@ HRESULT CVQAChunkParser::ParseChunkEnd(void)
 		if (
 			(m_nSampleSize		== 0) ||
 			(m_nAvgBytesPerSec	== 0)
-		)
+		) {
+			m_pSample->Release();
+			m_pSample = NULL;
 			return E_UNEXPECTED;
+		}
 
 		// Calculate the stream and media deltas
 		m_rtDelta	= ((REFERENCE_TIME)pInfo->wOutSize * UNITS) / m_nAvgBytesPerSec;
 		m_llDelta	= (LONGLONG)pInfo->wOutSize / m_nSampleSize;
 	}
 
+	// Skip the frame without full codebook (see ParseChunkHeader())
+	if (m_bCheckCodebook) {
+
+		m_bCheckCodebook = FALSE;
+
+		// Get the sample's buffer
+		BYTE *pbBuffer = NULL;
+		hr = m_pSample->GetPointer(&pbBuffer);
+		if (FAILED(hr)) {
+			m_pSample->Release();
+			m_pSample = NULL;
+			return hr;
+		}
+
+		m_bSkipFrame = !HasFullCodebook(pbBuffer, m_pSample->GetActualDataLength());
+	}
+
+	// Deliver the frame before the seek target or the codebook and 
+	// palette data of the skipped one (see ParseChunkHeader())
+	if ((m_bIsPreroll) || (m_bSkipFrame)) {
+
+		m_bIsPreroll = FALSE;
+
+		hr = DeliverPreroll();
+
+		// Advance the pin times past the skipped frame
+		if ((m_bSkipFrame) && (SUCCEEDED(hr)))
+			hr = m_pPin->Skip(m_rtDelta, m_llDelta);
+		m_bSkipFrame = FALSE;
+
+		// Release the sample
+		m_pSample->Release();
+		m_pSample = NULL;
+
+		// We're done with this output pin
+		m_pPin = NULL;
+		m_rtDelta = 0;
+		m_llDelta = 0;
+
+		return hr;
+	}
+
 	// Deliver the sample
 	hr = m_pPin->Deliver(m_pSample, m_rtDelta, m_llDelta);
 	if (FAILED(hr)) {
@@ -434,6 +826,14 @@ HRESULT CVQAChunkParser::ParseChunkEnd(void)
 	return NOERROR;
 }
 
+BOOL CVQAChunkParser::GetChunkType(const BYTE *pbHeader, DWORD *pdwType)
+{
+	// Count the chunks by their IDs
+	*pdwType = ((VQA_CHUNK_HEADER*)pbHeader)->dwID;
+
+	return TRUE;
+}
+
 //==========================================================================
 // CVQASplitterFilter methods
 //==========================================================================
@@ -457,7 +857,15 @@ CVQASplitterFilter::CVQASplitterFilter(LPUNKNOWN pUnk, HRESULT *phr) :
 	m_cbFrameTable(0),		// No frame table at this time
 	m_pCodebookTable(NULL),	// No codebook info at this time
 	m_nCodebooks(0),		// No codebook info at this time
-	//m_nCBParts(0),		// No codebook info at this time
+	m_nCBParts(0),			// No codebook info at this time
+	m_bIsHiColor(FALSE),	// No video format at this time
+	m_llSeekStart(-1),		// No seek at this time
+	m_iSeekStartFrame(0),	// No seek at this time
+	m_llSeekTarget(-1),		// No seek at this time
+	m_iSeekTargetFrame(0),	// No seek at this time
+	m_pbSeekPalette(NULL),	// No seek at this time
+	m_cbSeekPalette(0),		// No seek at this time
+	m_llSeekAudioTime(-1),	// No seek at this time
 	m_pParser(NULL)			// No chunk parser at this time
 {
 	ASSERT(phr);
@@ -505,7 +913,7 @@ HRESULT CVQASplitterFilter::Initialize(IPin *pPin, IAsyncReader *pReader)
 
 	// Decide on the input pin properties
 	m_cbInputAlign	= 1;
-	m_cbInputBuffer	= 0x40000; // TEMP: Some reasonable value
+	m_cbInputBuffer	= 0; // The largest frame (set below)
 
 	// Scan the chunks for audio and video info
 	LONGLONG llSeekPos = m_llDefaultStart, llSubSeekPos;
@@ -694,9 +1102,8 @@ HRESULT CVQASplitterFilter::Initialize(IPin *pPin, IAsyncReader *pReader)
 	m_nVideoFrames		= info.nVideoFrames;
 	m_nFramesPerSecond	= info.nFramesPerSecond;
 	m_nCodebooks		= cbCodebookInfo / sizeof(VQA_CIND_ENTRY);
-	/* TEMP: Seeking stuff (not working)
 	m_nCBParts			= info.nCBParts;
-	*/
+	m_bIsHiColor		= (info.nColors == 0);
 
 	// Protect the output pins state
 	CAutoLock pinlock(&m_csPins);
@@ -773,11 +1180,37 @@ HRESULT CVQASplitterFilter::Initialize(IPin *pPin, IAsyncReader *pReader)
 		sizeof(VQA_CHUNK_HEADER) +		// VPT? header
 		cbMaxVPTR;						// VPT? size
 
+	// Find out the largest frame from the frame table. The frame 
+	// chunks (the video chunk along with the audio one) lie between 
+	// the frame position and the next one, so that's the real bound
+	// of the video chunk size
+	long cbMaxFrame = 0;
+	if (m_pFrameTable) {
+
+		// Get the file size (for the last frame)
+		LONGLONG llTotal = 0, llAvail = 0;
+		pReader->Length(&llTotal, &llAvail);
+
+		DWORD nFrames = m_cbFrameTable / sizeof(DWORD);
+		for (DWORD iFrame = 0; iFrame < nFrames; iFrame++) {
+			LONGLONG llStart	= CORRPOS((LONGLONG)m_pFrameTable[iFrame]);
+			LONGLONG llEnd		= (iFrame + 1 < nFrames) ? CORRPOS((LONGLONG)m_pFrameTable[iFrame + 1]) : llTotal;
+			if ((llEnd > llStart) && (llEnd - llStart > cbMaxFrame))
+				cbMaxFrame = (long)min(llEnd - llStart, (LONGLONG)MAXLONG);
+		}
+	}
+
 	// Set the video allocator properties
 	papVideo->cbAlign	= 0;	// No matter
 	papVideo->cbPrefix	= 0;	// No matter
-	papVideo->cBuffers	= 4;	// TEMP: No need to set larger value?
-	papVideo->cbBuffer	= max((long)cbMaxVideoChunk, cbThMaxVideoChunk); // TEMP: we assume the first chunk is the largest one
+	papVideo->cBuffers	= 4;	// Default (the pin option may override it)
+	papVideo->cbBuffer	= max(	// The scanned chunk and the frame table bound (if it's tighter than the theoretical one)
+		(long)cbMaxVideoChunk,
+		(cbMaxFrame > 0) ? min(cbMaxFrame, cbThMaxVideoChunk) : cbThMaxVideoChunk
+	);
+
+	// Read the whole frame at once
+	m_cbInputBuffer = max(cbMaxFrame, papVideo->cbBuffer);
 
 	// Allocate time formats array. If we fail here, it's not an error, 
 	// we'll just set zero seeker parameters and may proceed
@@ -793,11 +1226,14 @@ HRESULT CVQASplitterFilter::Initialize(IPin *pPin, IAsyncReader *pReader)
 		pVideoTimeFormats[1] = TIME_FORMAT_FRAME;
 		pVideoTimeFormats[2] = TIME_FORMAT_SAMPLE;
 
+		// To seek we need the frame table and a way to find out where
+		// the codebook of the frame comes from (see GetSeekStartFrame())
 		DWORD dwSeekFlags = (
-			(info.nColors		== 0)		&&
-			(m_pFrameTable		!= NULL)	&&
-			(m_pCodebookTable	!= NULL)	&&
-			(dwAudioType		!= VQA_ID_SND2)
+			(m_pFrameTable != NULL) &&
+			(
+				(m_pCodebookTable != NULL) ||
+				((!m_bIsHiColor) && (m_nCBParts != 0))
+			)
 		) ? (
 			AM_SEEKING_CanSeekAbsolute	|
 			AM_SEEKING_CanSeekForwards	|
@@ -1020,7 +1456,7 @@ HRESULT CVQASplitterFilter::Initialize(IPin *pPin, IAsyncReader *pReader)
 		papAudio->cbAlign	= 0;	// No matter
 		papAudio->cbPrefix	= 0;	// No matter
 		papAudio->cBuffers	= 4;	// No use to set different from video value
-		papAudio->cbBuffer	= cbAudioChunk[0];
+		papAudio->cbBuffer	= max(cbAudioChunk[0], cbAudioChunk[1]);	// The pin grows its buffers if a later chunk is larger
 
 		// Allocate time formats array. If we fail here, it's not an error, 
 		// we'll just set zero seeker parameters and may proceed
@@ -1117,7 +1553,9 @@ HRESULT CVQASplitterFilter::Shutdown(void)
 		m_nSampleSize		= 0;
 		m_nAvgBytesPerSec	= 0;
 		m_nVideoFrames		= 0;
-		//m_nCBParts		= 0;
+		m_nCBParts			= 0;
+		m_bIsHiColor		= FALSE;
+		FreeSeekState();
 		if (m_pFrameTable) {
 			CoTaskMemFree(m_pFrameTable);
 			m_pFrameTable = NULL;
@@ -1136,45 +1574,61 @@ HRESULT CVQASplitterFilter::Shutdown(void)
 
 HRESULT CVQASplitterFilter::InitializeParser(void)
 {
-	// Protect the filter data
-	CAutoLock datalock(&m_csData);
-
 	HRESULT hr = NOERROR;
 
-	// Create chunk parser if we have to
-	if (m_pParser == NULL) {
+	// Scope for the locking
+	{
+		// Protect the filter data
+		CAutoLock datalock(&m_csData);
 
-		m_pParser = new CVQAChunkParser(
-			this,
-			m_ppOutputPin,
-			m_nFramesPerSecond,
-			m_wCompressionRatio,
-			m_nSampleSize,
-			m_nAvgBytesPerSec,
-			&hr
-		);
-		if (
-			(FAILED(hr)) ||
-			(m_pParser == NULL)
-		) {
+		// Create chunk parser if we have to
+		if (m_pParser == NULL) {
+
+			m_pParser = new CVQAChunkParser(
+				this,
+				m_ppOutputPin,
+				m_nFramesPerSecond,
+				m_wCompressionRatio,
+				m_nSampleSize,
+				m_nAvgBytesPerSec,
+				m_pFrameTable,
+				m_cbFrameTable / sizeof(DWORD),
+				m_pCodebookTable,
+				m_nCodebooks,
+				m_bIsHiColor,
+				&hr
+			);
+			if (
+				(FAILED(hr)) ||
+				(m_pParser == NULL)
+			) {
 			
-			if (m_pParser)
-				delete m_pParser;
-			m_pParser = NULL;
+				if (m_pParser)
+					delete m_pParser;
+				m_pParser = NULL;
 	
-			if (FAILED(hr))
-				return hr;
-			else
-				return E_OUTOFMEMORY;
+				if (FAILED(hr))
+					return hr;
+				else
+					return E_OUTOFMEMORY;
+			}
 		}
-	}
 
-	ASSERT(m_pParser);
+		ASSERT(m_pParser);
 
-	// Reset the parser
-	hr = m_pParser->ResetParser();
-	if (FAILED(hr))
-		return hr;
+		// Reset the parser
+		hr = m_pParser->ResetParser();
+		if (FAILED(hr))
+			return hr;
+
+		// Carry out the pending seek (if any)
+		hr = SetParserSeekState();
+		if (FAILED(hr))
+			return hr;
+	}
+
+	// Set the audio times of the seek made before the streaming
+	RestartSeekAudio();
 
 	return NOERROR;
 }
@@ -1201,19 +1655,88 @@ HRESULT CVQASplitterFilter::ShutdownParser(void)
 
 HRESULT CVQASplitterFilter::ResetParser(void)
 {
-	// Protect the filter data
-	CAutoLock datalock(&m_csData);
+	// Scope for the locking
+	{
+		// Protect the filter data
+		CAutoLock datalock(&m_csData);
 
-	// Reset the chunk parser
-	if (m_pParser) {
+		// Nothing to reset without the chunk parser
+		if (m_pParser == NULL)
+			return NOERROR;
+
+		// Reset the chunk parser
 		HRESULT hr = m_pParser->ResetParser();
 		if (FAILED(hr))
 			return hr;
+
+		// Carry out the pending seek (if any)
+		hr = SetParserSeekState();
+		if (FAILED(hr))
+			return hr;
 	}
 
+	// The streaming has stopped by now (the parser gets reset after 
+	// the flush), so the audio times of the seek can be set
+	RestartSeekAudio();
+
 	return NOERROR;
 }
 
+HRESULT CVQASplitterFilter::SetParserSeekState(void)
+{
+	// No seek -- nothing to do
+	if ((m_pParser == NULL) || (m_llSeekStart < 0))
+		return NOERROR;
+
+	return m_pParser->SetSeekState(
+		m_llSeekStart,
+		m_iSeekStartFrame,
+		m_llSeekTarget,
+		m_iSeekTargetFrame,
+		m_pbSeekPalette,
+		m_cbSeekPalette
+	);
+}
+
+void CVQASplitterFilter::FreeSeekState(void)
+{
+	m_llSeekStart		= -1;
+	m_iSeekStartFrame	= 0;
+	m_llSeekTarget		= -1;
+	m_iSeekTargetFrame	= 0;
+	if (m_pbSeekPalette) {
+		CoTaskMemFree(m_pbSeekPalette);
+		m_pbSeekPalette = NULL;
+	}
+	m_cbSeekPalette = 0;
+	m_llSeekAudioTime = -1;
+}
+
+void CVQASplitterFilter::RestartSeekAudio(void)
+{
+	// Take the audio media time of the seek (it's set only once)
+	LONGLONG llAudioTime = -1;
+	{
+		// Protect the filter data
+		CAutoLock datalock(&m_csData);
+
+		llAudioTime = m_llSeekAudioTime;
+		m_llSeekAudioTime = -1;
+	}
+	if (llAudioTime < 0)
+		return;
+
+	// The audio chunks before the target frame are not delivered, so 
+	// the audio stream goes on from the target frame time (the video 
+	// output pin times are set by the seeker)
+	CAutoLock pinlock(&m_csPins);
+	if (m_nOutputPins > 1) {
+		m_ppOutputPin[1]->SetTime(0);
+		m_ppOutputPin[1]->SetMediaTime(llAudioTime);
+		m_ppOutputPin[1]->SetDiscontinuity(TRUE);
+	}
+}
+
 HRESULT CVQASplitterFilter::CheckInputType(const CMediaType* pmt)
 {
 	// Check and validate the pointer
@@ -1389,120 +1912,153 @@ HRESULT CVQASplitterFilter::GetDuration(
 	);
 }
 
-/* TEMP: Seeking stuff (not working)
-HRESULT CVQASplitterFilter::DeliverChunk(
-	CParserOutputPin *pPin,
-	LONGLONG llStart,
-	LONGLONG llStop,
-	DWORD dwID,
-	DWORD dwMask
+#define FRAMEPOS(i)							\
+(											\
+	((i) * sizeof(DWORD) < m_cbFrameTable)	\
+	? CORRPOS(m_pFrameTable[(i)])			\
+	: m_llDefaultStop						\
 )
+
+LONG CVQASplitterFilter::GetSeekStartFrame(LONG iFrame)
 {
-	HRESULT hr = NOERROR;
+	// Find the last frame with full codebook at or before our frame
+	// and the one before it (the codebook table is sorted by frames)
+	LONG iKeyFrame = 0, iPrevKeyFrame = 0;
+	for (DWORD i = 0; (m_pCodebookTable != NULL) && (i < m_nCodebooks); i++) {
+		if ((LONG)m_pCodebookTable[i].iFrame > iFrame)
+			break;
+		if (m_pCodebookTable[i].cbSize != 0) {
+			iPrevKeyFrame	= iKeyFrame;
+			iKeyFrame		= m_pCodebookTable[i].iFrame;
+		}
+	}
+
+	// HiColor frames keep the blocks of the previous frame, so all 
+	// the frames from the one with full codebook are to be decoded. 
+	// The codebook parts are counted from the start of the group the 
+	// frame belongs to
+	if (m_bIsHiColor)
+		return (m_nCBParts != 0) ? iKeyFrame - iKeyFrame % m_nCBParts : iKeyFrame;
+
+	// 8-bit frames are complete images, but the codebook the frame 
+	// uses is put together from the parts coming with the previous 
+	// group of frames (the first frame has full codebook though). 
+	// The parts coming with the frames of the current group up to
+	// our frame are needed as well to go on from our frame
+	if (m_nCBParts != 0) {
+		LONG iGroupFrame = iFrame - iFrame % m_nCBParts;
+		return max(iGroupFrame - (LONG)m_nCBParts, 0);
+	}
+
+	// Without the parts count the decoder switches to the new 
+	// codebook at the frames listed in the codebook table, so the 
+	// parts come with the frames since the previous switch
+	return iPrevKeyFrame;
+}
+
+LONG CVQASplitterFilter::GetPaletteFrame(LONG iFrame)
+{
+	// The frames with palette are marked in the frame table
+	for (LONG i = iFrame; i > 0; i--)
+		if (m_pFrameTable[i] >= VQA_PALETTE_MARKER)
+			return i;
+
+	// The first frame has palette anyway
+	return 0;
+}
+
+HRESULT CVQASplitterFilter::ReadFramePalette(LONG iFrame, BYTE **ppbPalette, LONG *pcbPalette)
+{
+	*ppbPalette = NULL;
+	*pcbPalette = 0;
 
 	// Get async reader from the input pin
 	IAsyncReader *pReader = m_InputPin.GetReader();
 	if (pReader == NULL)
 		return E_UNEXPECTED;
 
-	// Scan the file until the chunk is found or stop position is reached
-	DWORD cbData = 0;
-	while (llStart < llStop) {
+	// Scan the frame chunks for the video one
+	HRESULT hr = S_FALSE;
+	LONGLONG llPosition = FRAMEPOS(iFrame), llStop = FRAMEPOS(iFrame + 1);
+	while (llPosition < llStop) {
 
 		// Align the seek position
-		if (llStart % 2)
-			llStart++;
+		if (llPosition % 2)
+			llPosition++;
 
 		// Read the chunk header
 		VQA_CHUNK_HEADER header;
-		hr = pReader->SyncRead(llStart, sizeof(header), (BYTE*)&header);
-		if (hr != S_OK)
+		if (pReader->SyncRead(llPosition, sizeof(header), (BYTE*)&header) != S_OK)
 			break;
 
-		llStart += sizeof(header);
+		// Update the seek position
+		llPosition += sizeof(header);
 
 		DWORD cbChunk = SWAPDWORD(header.cbSize);
 
-		// Parse chunk ID
-		if ((header.dwID & dwMask) == (dwID & dwMask)) {
-			llStart -= sizeof(header);
-			cbData = sizeof(header) + cbChunk;
-			break;
-		} else if (
-			(header.dwID != VQA_ID_VQFR) && 
-			(header.dwID != VQA_ID_VQFL)
-		)
-			llStart += cbChunk;
-	}
+		if (header.dwID == VQA_ID_VQFR) {
 
-	// Check if we found the requested chunk
-	if (cbData == 0) {
-		pReader->Release();
-		return VFW_E_NOT_FOUND;
-	}
+			// Walk through the frame subchunks
+			LONGLONG llSubPosition = llPosition;
+			while (llSubPosition < llPosition + cbChunk) {
 
-	// Get the empty media sample from the video output pin
-	IMediaSample *pSample = NULL;
-	hr = pPin->GetDeliveryBuffer(&pSample, NULL, NULL, 0);
-	if (FAILED(hr)) {
-		pReader->Release();
-		return hr;
-	}
+				// Align the seek position
+				if (llSubPosition % 2)
+					llSubPosition++;
 
-	// Find out how many bytes we can copy
-	LONG cbBuffer = pSample->GetSize();
+				// Read the subchunk header
+				VQA_CHUNK_HEADER subheader;
+				if (pReader->SyncRead(llSubPosition, sizeof(subheader), (BYTE*)&subheader) != S_OK)
+					break;
 
-	// Check that the buffer size is large enough
-	if (cbData > cbBuffer) {
-		pReader->Release();
-		pSample->Release();
-		return VFW_E_BUFFER_OVERFLOW;
-	}
+				DWORD cbSubChunk = SWAPDWORD(subheader.cbSize);
 
-	// Get the sample's buffer
-	BYTE *pbBuffer = NULL;
-	hr = pSample->GetPointer(&pbBuffer);
-	if (FAILED(hr)) {
-		pReader->Release();
-		pSample->Release();
-		return hr;
-	}
+				if (
+					(subheader.dwID == VQA_ID_CPL0) ||
+					(subheader.dwID == VQA_ID_CPLZ)
+				) {
 
-	// Read in the chunk
-	hr = pReader->SyncRead(llStart, cbData, pbBuffer);
-	pReader->Release();
-	if (hr != S_OK) {
-		pSample->Release();
-		return hr;
-	}
+					// Sanity check of the palette size (the compressed
+					// one may be a bit larger than the plain one)
+					if (cbSubChunk > 2 * MAX_PALETTE_SIZE)
+						break;
 
-	// Set the sample's actual data length
-	hr = pSample->SetActualDataLength(cbData);
-	if (FAILED(hr)) {
-		pSample->Release();
-		return hr;
-	}
+					// Read the subchunk along with its header
+					LONG cbPalette = sizeof(subheader) + cbSubChunk;
+					BYTE *pbPalette = (BYTE*)CoTaskMemAlloc(cbPalette);
+					if (pbPalette == NULL) {
+						hr = E_OUTOFMEMORY;
+						break;
+					}
+					hr = pReader->SyncRead(llSubPosition, cbPalette, pbPalette);
+					if (hr != S_OK) {
+						CoTaskMemFree(pbPalette);
+						if (SUCCEEDED(hr))
+							hr = S_FALSE;
+						break;
+					}
 
-	// Deliver the sample
-	hr = pPin->Deliver(pSample, 0, 0);
-	pSample->Release();
+					*ppbPalette = pbPalette;
+					*pcbPalette = cbPalette;
+					break;
+				}
 
-	return hr;
-}*/
+				// Advance the seek position
+				llSubPosition += sizeof(subheader) + cbSubChunk;
+			}
 
-#define CORRPOS(x)							\
-(											\
-	((x) >= VQA_PALETTE_MARKER)				\
-	? (2 * ((x) - VQA_PALETTE_MARKER))		\
-	: (2 * (x))								\
-)
+			// There's one video chunk per frame
+			break;
+		}
 
-#define FRAMEPOS(i)							\
-(											\
-	((i) * sizeof(DWORD) < m_cbFrameTable)	\
-	? CORRPOS(m_pFrameTable[(i)])			\
-	: m_llDefaultStop						\
-)
+		// Advance the seek position
+		llPosition += cbChunk;
+	}
+
+	pReader->Release();
+
+	return hr;
+}
 
 HRESULT CVQASplitterFilter::ConvertPosition(
 	LONGLONG *pllTarget,
@@ -1512,12 +2068,10 @@ HRESULT CVQASplitterFilter::ConvertPosition(
 	DWORD dwSourceFlags
 )
 {
-	// Sanity check of the frame and codebook info tables
+	// Sanity check of the frame info table
 	if (
-		(m_pFrameTable		== NULL)	||
-		(m_cbFrameTable		== 0)		||
-		(m_pCodebookTable	== NULL)	||
-		(m_nCodebooks		== 0)
+		(m_pFrameTable	== NULL)	||
+		(m_cbFrameTable	== 0)
 	)
 		return E_UNEXPECTED;
 
@@ -1533,159 +2087,77 @@ HRESULT CVQASplitterFilter::ConvertPosition(
 	if (FAILED(hr))
 		return hr;
 
-	// Find the last frame with full codebook before our frame
-	int i = (int)m_nCodebooks - 1;
-	for (i = (int)m_nCodebooks - 1; i >= 0; i--) {
-		if (
-			(m_pCodebookTable[i].iFrame <= llFrame) &&
-			(m_pCodebookTable[i].cbSize != 0)
-		)
-			break;
-	}
-
-	// Check if we found proper codebook
-	if (
-		(i < 0) ||
-		(m_pCodebookTable[i].cbSize == 0)
-	)
-		return E_FAIL;
-
-	// We should seek to the the frame with full codebook
-	llFrame = m_pCodebookTable[i].iFrame;
-
-	// Sanity check of the frame index
-	if (
-		(llFrame >= m_nVideoFrames) || 
-		(llFrame * sizeof(DWORD) >= m_cbFrameTable)
-	)
-		return E_INVALIDARG;
-
-	// Return the file position correspondent to the found frame
-	*pllTarget = FRAMEPOS(llFrame);
+	// Number of frames we know the positions of
+	LONGLONG nFrames = min((LONGLONG)m_nVideoFrames, (LONGLONG)(m_cbFrameTable / sizeof(DWORD)));
 
-	// Convert the frame index to source time format
-	// so that the caller knows actual seek point
-	hr = ConvertTimeFormat(
-		wszVQAVideoOutputName,
-		pllSource,
-		pSourceFormat,
-		llFrame,
-		&TIME_FORMAT_FRAME
-	);
-	if (FAILED(hr))
-		return hr;
-
-	// Reset the stream and media times on the output pins
-	if (m_nOutputPins > 0) {
-		m_ppOutputPin[0]->SetTime(0);
-		m_ppOutputPin[0]->SetMediaTime(0);
-	}
-	if (m_nOutputPins > 1) {
-		m_ppOutputPin[1]->SetTime(0);
-		m_ppOutputPin[1]->SetMediaTime(0);
+	// The stop position is the start of the first frame not to play 
+	// (the positions beyond the last frame stand for the file end)
+	if (!(dwSourceFlags & AM_SEEKING_SeekToKeyFrame)) {
+		*pllTarget = ((llFrame >= 0) && (llFrame < nFrames)) ? FRAMEPOS(llFrame) : m_llDefaultStop;
+		return NOERROR;
 	}
 
-	return NOERROR;
-}
-
-/* TEMP: Seeking stuff (not working)
-HRESULT CVQASplitterFilter::ConvertPosition(
-	LONGLONG *pllTarget,
-	LPCWSTR pPinName,
-	const GUID *pSourceFormat,
-	LONGLONG *pllSource,
-	DWORD dwSourceFlags
-)
-{
-	// Sanity check for frame info table
-	if (m_pFrameTable == NULL)
-		return E_UNEXPECTED;
-
-	// Convert seek position to frames
-	LONGLONG llFrame;
-	HRESULT hr = ConvertTimeFormat(
-		wszVQAVideoOutputName,
-		&llFrame,
-		&TIME_FORMAT_FRAME,
-		*pllSource,
-		pSourceFormat
-	);
-	if (FAILED(hr))
-		return hr;
-
 	// Sanity check of the frame index
-	if (
-		(llFrame >= m_nVideoFrames) || 
-		(llFrame * sizeof(DWORD) >= m_cbFrameTable)
-	)
+	if (llFrame < 0)
+		llFrame = 0;
+	if (llFrame >= nFrames)
 		return E_INVALIDARG;
 
-	// Find the last frame with palette before our frame
-	for (int i = (int)llFrame; i >= 0; i--) {
-		if (m_pFrameTable[i] >= VQA_PALETTE_MARKER)
-			break;
+	LONG iFrame = (LONG)llFrame;
+
+	// Find out the frame the decoder should start from to get 
+	// our frame right. The frames from there on are delivered 
+	// as preroll ones up to our frame (see CVQAChunkParser)
+	LONG iStartFrame = GetSeekStartFrame(iFrame);
+
+	// The palettes of the frames from the start one on reach the 
+	// decoder anyway, the earlier one should be re-fed though
+	BYTE *pbPalette = NULL;
+	LONG cbPalette = 0;
+	if (!m_bIsHiColor) {
+		LONG iPaletteFrame = GetPaletteFrame(iFrame);
+		if (iPaletteFrame < iStartFrame) {
+			hr = ReadFramePalette(iPaletteFrame, &pbPalette, &cbPalette);
+			if (FAILED(hr))
+				return hr;
+		}
 	}
 
-	// Send the palette downstream
-	hr = DeliverChunk(
-		m_ppOutputPin[0],
-		FRAMEPOS(i),
-		FRAMEPOS(i + 1),
-		VQA_ID_CPL0,
-		0x00FFFFFF
+	// The audio stream goes on from our frame time (see 
+	// RestartSeekAudio())
+	LONGLONG llAudioTime = 0;
+	hr = ConvertTimeFormat(
+		wszVQAAudioOutputName,
+		&llAudioTime,
+		&TIME_FORMAT_SAMPLE,
+		(llFrame * UNITS) / m_nFramesPerSecond,
+		&TIME_FORMAT_MEDIA_TIME
 	);
-	if (hr != S_OK)
-		return hr;
-
-	// Find out from which frame we should collect the current codebook
-	int iKeyFrame = ((int)llFrame / m_nCBParts) * m_nCBParts;
-	if (iKeyFrame == 0) {
-
-		// We should take the first (full) codebook
-		hr = DeliverChunk(
-			m_ppOutputPin[0],
-			FRAMEPOS(0),
-			FRAMEPOS(1),
-			VQA_ID_CBF0,
-			0x00FFFFFF
-		);
-		if (hr != S_OK)
-			return hr;
-
-	} else {
-
-		// We should walk nCBParts chunks to collect the entire codebook
-		for (i = iKeyFrame - m_nCBParts; i < iKeyFrame; i++) {
-			hr = DeliverChunk(
-				m_ppOutputPin[0],
-				FRAMEPOS(i),
-				FRAMEPOS(i + 1),
-				VQA_ID_CBP0,
-				0x00FFFFFF
-			);
-			if (hr != S_OK)
-				return hr;
-		}
+	if (FAILED(hr))
+		llAudioTime = 0;
 
-	}
+	// Scope for the locking
+	{
+		// Protect the filter data
+		CAutoLock datalock(&m_csData);
 
-	// Now collect the next codebook parts preceding our frame
-	for (i = iKeyFrame; i < llFrame; i++) {
-		hr = DeliverChunk(
-			m_ppOutputPin[0],
-			FRAMEPOS(i),
-			FRAMEPOS(i + 1),
-			VQA_ID_CBP0,
-			0x00FFFFFF
-		);
-		if (hr != S_OK)
-			return hr;
+		// Store the seek state for the parser (the audio times are 
+		// set once the streaming has stopped, since the parser may 
+		// be still delivering the samples)
+		FreeSeekState();
+		m_llSeekStart		= FRAMEPOS(iStartFrame);
+		m_iSeekStartFrame	= iStartFrame;
+		m_llSeekTarget		= FRAMEPOS(iFrame);
+		m_iSeekTargetFrame	= iFrame;
+		m_pbSeekPalette		= pbPalette;
+		m_cbSeekPalette		= cbPalette;
+		m_llSeekAudioTime	= llAudioTime;
 	}
 
-	// Return the file position correspondent to our frame
-	*pllTarget = FRAMEPOS(llFrame);
+	// Return the file position of the start frame
+	*pllTarget = FRAMEPOS(iStartFrame);
 
-	// Convert our frame index to source time format
+	// Convert our frame index to source time format 
 	// so that the caller knows actual seek point
 	hr = ConvertTimeFormat(
 		wszVQAVideoOutputName,
@@ -1699,7 +2171,6 @@ HRESULT CVQASplitterFilter::ConvertPosition(
 
 	return NOERROR;
 }
-*/
 
 STDMETHODIMP CVQASplitterFilter::GetPages(CAUUID *pPages)
 {
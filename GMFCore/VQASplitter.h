@@ -48,6 +48,56 @@ class CVQAChunkParser : public CBaseChunkParser
 	WORD	m_nSampleSize;			// (Uncompressed) audio sample size in bytes
 	DWORD	m_nAvgBytesPerSec;		// Audio data rate
 
+	// Frame and codebook info tables (owned by the filter and used by
+	// the trick-play mode to find the frames with full codebook)
+	const DWORD				*m_pFrameTable;		// Table of frame offsets
+	DWORD					m_nFrameEntries;	// Number of frame table entries
+	const VQA_CIND_ENTRY	*m_pCodebookTable;	// Full codebook descriptor table
+	DWORD					m_nCodebooks;		// Number of full codebook descriptors
+
+	// Should the frame be checked for full codebook in ParseChunkEnd()?
+	// (that's done in the trick-play mode if there are no info tables)
+	BOOL m_bCheckCodebook;
+
+	// Is the current 8-bit frame skipped in the trick-play mode? (its
+	// codebook and palette data is still delivered as preroll)
+	BOOL m_bSkipFrame;
+
+	// Frame-accurate seek state (see SetSeekState()). The frames from 
+	// the seek start up to the target one are delivered as preroll
+	LONGLONG	m_llSeekStart;		// File position the parsing should start from (-1 once checked)
+	LONGLONG	m_llSeekTarget;		// File position of the target frame (-1 if there's no seek)
+	LONG		m_iSeekFrame;		// Index of the next frame before the target one
+	LONG		m_iTargetFrame;		// Index of the target frame
+	BYTE		*m_pbSeekPalette;	// Palette subchunk to deliver first (NULL if none)
+	LONG		m_cbSeekPalette;	// Size of the palette subchunk
+	BOOL		m_bIsHiColor;		// Are the frames HiColor ones?
+	BOOL		m_bIsPreroll;		// Is the current sample a preroll one?
+	LONG		m_iPrerollFrame;	// Frame index of the current preroll sample (-1 if none)
+
+	// Forget the seek state
+	void CancelSeek(void);
+
+	// Deliver the palette subchunk of the seek state
+	HRESULT DeliverSeekPalette(void);
+
+	// Deliver the current sample as preroll one
+	HRESULT DeliverPreroll(void);
+
+	// Leave only the codebook and palette subchunks in the 8-bit 
+	// frame data. Returns the size of the data left
+	static LONG StripFrame(BYTE *pbData, LONG lDataSize);
+
+	// Does the frame starting at the specified position (in the frame
+	// table) have full codebook?
+	BOOL IsKeyFrame(LONGLONG llPosition);
+
+	// Is the frame with the specified index in the codebook table?
+	BOOL IsCodebookFrame(DWORD iFrame);
+
+	// Does the frame data contain full codebook?
+	BOOL HasFullCodebook(const BYTE *pbData, LONG lDataSize);
+
 public:
 
 	CVQAChunkParser(
@@ -57,12 +107,31 @@ public:
 		WORD wCompressionRatio,			// IMA ADPCM compression ratio
 		WORD nSampleSize,				// (Uncompressed) audio sample size in bytes
 		DWORD nAvgBytesPerSec,			// Audio data rate
+		const DWORD *pFrameTable,		// Table of frame offsets (may be NULL)
+		DWORD nFrameEntries,			// Number of frame table entries
+		const VQA_CIND_ENTRY *pCodebookTable,	// Full codebook descriptor table (may be NULL)
+		DWORD nCodebooks,				// Number of full codebook descriptors
+		BOOL bIsHiColor,				// Are the frames HiColor ones?
 		HRESULT *phr					// Success or error code
 	);
 	~CVQAChunkParser();
 
 	HRESULT ResetParser(void);
 
+	// Set the frame-accurate seek state (after ResetParser()). If the 
+	// parsing starts from llStart, the frames up to the one at llTarget 
+	// are delivered as preroll samples (only their codebook and palette 
+	// data for the 8-bit frames). The palette subchunk (if any) is 
+	// delivered before them. The palette data is copied
+	HRESULT SetSeekState(
+		LONGLONG llStart,				// File position of the start frame
+		LONG iStartFrame,				// Index of the start frame
+		LONGLONG llTarget,				// File position of the target frame
+		LONG iTargetFrame,				// Index of the target frame
+		const BYTE *pbPalette,			// Palette subchunk (may be NULL)
+		LONG cbPalette					// Size of the palette subchunk
+	);
+
 protected:
 
 	HRESULT ParseChunkHeader(
@@ -77,6 +146,9 @@ protected:
 	);
 	HRESULT ParseChunkEnd(void);
 
+	// Get the chunk type for the filter statistics
+	BOOL GetChunkType(const BYTE *pbHeader, DWORD *pdwType);
+
 };
 
 //==========================================================================
@@ -106,7 +178,18 @@ class CVQASplitterFilter : public CBaseParserFilter
 	DWORD m_cbFrameTable;				// Size of the frame table
 	VQA_CIND_ENTRY *m_pCodebookTable;	// Full codebook descriptor table
 	DWORD m_nCodebooks;					// Number of full codebook descriptors
-	//BYTE m_nCBParts;					// Number of codebooks parts
+	BYTE m_nCBParts;					// Number of codebooks parts
+	BOOL m_bIsHiColor;					// Are the frames HiColor ones?
+
+	// Frame-accurate seek state (set by ConvertPosition() and handed 
+	// to the parser whenever it's reset)
+	LONGLONG	m_llSeekStart;		// File position of the start frame (-1 if there's no seek)
+	LONG		m_iSeekStartFrame;	// Index of the start frame
+	LONGLONG	m_llSeekTarget;		// File position of the target frame
+	LONG		m_iSeekTargetFrame;	// Index of the target frame
+	BYTE		*m_pbSeekPalette;	// Palette subchunk in effect at the target frame (NULL if none)
+	LONG		m_cbSeekPalette;	// Size of the palette subchunk
+	LONGLONG	m_llSeekAudioTime;	// Audio media time to go on from (-1 once set on the pin)
 
 	// Actual data parser
 	CVQAChunkParser *m_pParser;
@@ -114,16 +197,26 @@ class CVQASplitterFilter : public CBaseParserFilter
 	CVQASplitterFilter(LPUNKNOWN pUnk, HRESULT *phr);
 	~CVQASplitterFilter();
 
-	/* TEMP: Seeking stuff (not working)
-	// Utility method used for seeking
-	HRESULT DeliverChunk(
-		CParserOutputPin *pPin,	// Output pin to deliver chunk through
-		LONGLONG llStart,		// File position to start scanning
-		LONGLONG llStop,		// File position to stop scanning
-		DWORD dwID,				// Chunk ID
-		DWORD dwMask			// Chunk ID mask
-	);
-	*/
+	// First frame to parse for the decoder to get the codebook 
+	// (and the image for HiColor) of the frame right
+	LONG GetSeekStartFrame(LONG iFrame);
+
+	// Last frame at or before the specified one changing the palette
+	LONG GetPaletteFrame(LONG iFrame);
+
+	// Read the palette subchunk (with its header) of the frame. 
+	// Returns S_FALSE if the frame has no palette
+	HRESULT ReadFramePalette(LONG iFrame, BYTE **ppbPalette, LONG *pcbPalette);
+
+	// Forget the seek state
+	void FreeSeekState(void);
+
+	// Hand the seek state to the parser
+	HRESULT SetParserSeekState(void);
+
+	// Set the audio output pin times of the seek (once the streaming 
+	// has stopped or before it starts)
+	void RestartSeekAudio(void);
 
 public:
 
@@ -32,10 +32,6 @@
 
 #include <cguid.h>
 
-#define SWAPWORD(x) ((((x) & 0xFF) << 8) | ((x) >> 8))
-#define LE_16(x) (*((WORD*)(x)))
-#define BE_16(x) SWAPWORD(*((WORD*)(x)))
-
 //==========================================================================
 // VQA video decompressor setup data
 //==========================================================================
@@ -99,45 +95,22 @@ CVQAVideoDecompressor::CVQAVideoDecompressor(
 	LPUNKNOWN pUnk,
 	HRESULT *phr
 ) :
-	CTransformFilter(
+	CBaseDecompressorFilter(
 		NAME("VQA Video Decompressor"),
 		pUnk,
 		CLSID_VQAVideoDecompressor
-	),
-	m_pCurrentFrame(NULL),				// No frame buffer at this time
-	m_cbPalette(0),						// No palette data at this time
-	m_pDecodeBuffer(NULL),				// No decode buffer at this time
-	m_cbMaxDecodeBuffer(0),				// No decode buffer size at this time
-	m_pCodebook(NULL),					// No current codebook at this time
-	m_pNextCodebook(NULL),				// No next codebook at this time
-	m_cbNextCodebook(0),				// No next codebook parts at this time
-	m_nNextCodebookParts(0),			// No next codebook parts at this time
-	m_bIsNextCodebookCompressed(FALSE),	// Default: non-compressed codebook
-	m_bSolidColorMarker(0),				// No solid color marker at this time
-	m_pFormat(NULL),					// No format block at this time
-	m_pCodebookTable(NULL),				// No codebook descriptor table
-	m_nCodebooks(0),					// No codebook descriptor table
-	m_nBlocksX(0),						// |
-	m_nBlocksY(0),						// |
-	m_nBlocks(0),						// |
-	m_cbBlock(0),						// |-- No image/block parameters at this time
-	m_cbBlockStride(0),					// |
-	m_cbImageXStride(0),				// |
-	m_cbImageYStride(0)					// |
+	)
 {
 	ASSERT(phr);
+
+	// Let the decoder split the large 8-bit frames between 
+	// all the processors
+	m_Decoder.SetThreadCount(0);
 }
 
 CVQAVideoDecompressor::~CVQAVideoDecompressor()
 {
-	// Perform decoder clean-up
-	Cleanup();
-
-	// Free the format block
-	if (m_pFormat) {
-		CoTaskMemFree(m_pFormat);
-		m_pFormat = NULL;
-	}
+	// The decoder frees its buffers and format block itself
 }
 
 CUnknown* WINAPI CVQAVideoDecompressor::CreateInstance(
@@ -161,194 +134,7 @@ STDMETHODIMP CVQAVideoDecompressor::NonDelegatingQueryInterface(REFIID riid, voi
 	if (riid == IID_ISpecifyPropertyPages)
 		return GetInterface((ISpecifyPropertyPages*)this, ppv);
 	else
-		return CTransformFilter::NonDelegatingQueryInterface(riid, ppv);
-}
-
-void CVQAVideoDecompressor::FillBlock(BYTE *pbImage, WORD wIndex)
-{
-	// Sanity check of the index
-	if (wIndex * m_cbBlock >= MAX_CODEBOOK_SIZE)
-		return;
-
-	BYTE *pbBlock = m_pCodebook + wIndex * m_cbBlock;
-	for (WORD i = 0; i < m_pFormat->bBlockHeight; i++) {
-		CopyMemory(pbImage, pbBlock, m_cbBlockStride);
-		pbImage += m_cbImageXStride;
-		pbBlock += m_cbBlockStride;
-	}
-}
-
-void CVQAVideoDecompressor::FillBlockSolid(BYTE *pbImage, BYTE bColor)
-{
-	for (WORD i = 0; i < m_pFormat->bBlockHeight; i++) {
-		FillMemory(pbImage, m_cbBlockStride, bColor);
-		pbImage += m_cbImageXStride;
-	}
-}
-
-#define VALIDATEREAD(p,n,t,e) if ((p) + (n) > (t)) return (e);
-
-HRESULT CVQAVideoDecompressor::DecodeVPTR(BYTE *pbData, DWORD cbData, BYTE *pbImage)
-{
-	// There should be format block
-	ASSERT(m_pFormat);
-
-	// Set up the data threshold
-	BYTE *pbDataThreshould = pbData + cbData;
-
-	// Set up lo/hi value data pointers and their increment (for 8-bit video)
-	BYTE *pbLoVal = pbData;
-	BYTE *pbHiVal = (m_pFormat->wVersion == 1) ? (pbData + 1) : (pbData + m_nBlocks);
-	int iIncrement = (m_pFormat->wVersion == 1) ? 2 : 1;
-	
-	// Command completion flag (for HiColor video)
-	BOOL bIsCommandComplete = TRUE;
-
-	// First block done flag (for VQA_CODE_PUT_ARRAY)
-	BOOL bIsFirstBlockDone;
-
-	// Command code, block index and count (for HiColor video)
-	WORD wCode, wIndex, wCount;
-
-	// Cycle through all blocks
-	for (WORD y = 0; y < m_nBlocksY; y++) {
-		for (WORD x = 0; x < m_nBlocksX; x++) {
-		
-			// HiColor video
-			if (m_pFormat->nColors == 0) {
-
-				if (bIsCommandComplete) {
-
-					// Get the next value from the input buffer
-					VALIDATEREAD(pbData, 2, pbDataThreshould, E_UNEXPECTED);
-					WORD wValue = LE_16(pbData);
-					pbData += 2;
-
-					// Get command code
-					wCode = (wValue >> 13) & 7;
-
-					// Parse command code
-					switch (wCode) {
-
-						case VQA_CODE_SKIP:
-							wCount = wValue & 0x1FFF;
-							break;
-						case VQA_CODE_REPEAT_SHORT:
-							wIndex = wValue & 0xFF;
-							wCount = (((wValue >> 8) & 0x1F) + 1) * 2;
-							break;
-						case VQA_CODE_PUT_ARRAY:
-							wIndex = wValue & 0xFF;
-							wCount = (((wValue >> 8) & 0x1F) + 1) * 2;
-							bIsFirstBlockDone = FALSE;
-							break;
-						case VQA_CODE_PUT:
-							wIndex = wValue & 0x1FFF;
-							break;
-						case VQA_CODE_REPEAT_LONG:
-							wIndex = wValue & 0x1FFF;
-							VALIDATEREAD(pbData, 1, pbDataThreshould, E_UNEXPECTED);
-							wCount = *pbData++;
-							break;
-						default:
-							// Unknown command code
-							break;
-					}
-
-					// Reset command completion flag
-					bIsCommandComplete = FALSE;
-				}
-
-				// Execute command code
-				switch (wCode) {
-
-					case VQA_CODE_SKIP:
-						wCount--;
-						bIsCommandComplete = (wCount == 0);
-						break;
-					case VQA_CODE_REPEAT_SHORT:
-						FillBlock(pbImage, wIndex);
-						wCount--;
-						bIsCommandComplete = (wCount == 0);
-						break;
-					case VQA_CODE_PUT_ARRAY:
-						if (bIsFirstBlockDone) {
-							VALIDATEREAD(pbData, 1, pbDataThreshould, E_UNEXPECTED);
-							FillBlock(pbImage, *pbData++);
-							wCount--;
-							bIsCommandComplete = (wCount == 0);
-						} else {
-							FillBlock(pbImage, wIndex);
-							bIsFirstBlockDone = TRUE;
-						}
-						break;
-					case VQA_CODE_PUT:
-						FillBlock(pbImage, wIndex);
-						bIsCommandComplete = TRUE;
-						break;
-					case VQA_CODE_REPEAT_LONG:
-						FillBlock(pbImage, wIndex);
-						wCount--;
-						bIsCommandComplete = (wCount == 0);
-						break;
-					default:
-						// Unknown command code
-						break;
-				}
-
-			} else {
-
-				// Validate read pointers
-				VALIDATEREAD(pbHiVal, 1, pbDataThreshould, E_UNEXPECTED);
-				VALIDATEREAD(pbLoVal, 1, pbDataThreshould, E_UNEXPECTED);
-
-				// Parse values and fill the block
-				if (*pbHiVal == m_bSolidColorMarker)
-					FillBlockSolid(
-						pbImage,
-						(m_pFormat->wVersion == 1)
-						? (~(*pbLoVal))
-						: (*pbLoVal)
-					);
-				else
-					FillBlock(
-						pbImage,
-						(((*pbHiVal) << 8) + (*pbLoVal)) >>
-						((m_pFormat->wVersion == 1) ? 3 : 0)
-					);
-
-				// Advance pointers
-				pbLoVal += iIncrement;
-				pbHiVal += iIncrement;
-			}
-			pbImage += m_cbBlockStride;
-		}
-		pbImage += m_cbImageYStride;
-	}
-
-	return NOERROR;
-}
-
-void CVQAVideoDecompressor::PutNewCodebook(void)
-{
-	if (m_bIsNextCodebookCompressed) {
-
-		// Decompress the codebook
-		int cbCodebook = MAX_CODEBOOK_SIZE;
-		DecodeFormat80(m_pNextCodebook, m_cbNextCodebook, m_pCodebook, cbCodebook);
-
-	} else {
-
-		// Swap the codebook pointers
-		BYTE *pTemp = m_pCodebook;
-		m_pCodebook = m_pNextCodebook;
-		m_pNextCodebook = pTemp;
-
-	}
-
-	// Reset the accumulation stuff
-	m_cbNextCodebook = 0;
-	m_nNextCodebookParts = 0;
+		return CBaseDecompressorFilter::NonDelegatingQueryInterface(riid, ppv);
 }
 
 HRESULT CVQAVideoDecompressor::Transform(
@@ -377,195 +163,44 @@ HRESULT CVQAVideoDecompressor::Transform(
 	if (FAILED(hr))
 		return hr;
 
+	// Get the frame number (the decoder uses it to look up 
+	// the full codebook table). If the media time is not set, 
+	// use the index no codebook table entry can match
+	LONGLONG llStart = 0, llEnd = 0;
+	if (FAILED(pIn->GetMediaTime(&llStart, &llEnd)))
+		llStart = -1;
+
+	// Set up the output frame descriptor
+	GMF_FRAME frame;
+	ZeroMemory(&frame, sizeof(GMF_FRAME));
+	frame.pbBuffer	= pbOutBuffer;
+	frame.cbBuffer	= (DWORD)pOut->GetSize();
+	frame.iFrame	= (DWORD)llStart;
+
+	// Call the decoder to decompress the frame. If there's 
+	// no frame prepared, quit with S_FALSE
+	hr = m_Decoder.Decode(pbInBuffer, (DWORD)lInDataLength, frame);
+	if (hr != S_OK)
+		return hr;
+
 	// Set the data length for the output sample. 
 	// The data length is the uncompressed frame size
-	LONG lOutDataLength = m_pFormat->wVideoWidth * m_pFormat->wVideoHeight * ((m_pFormat->nColors == 0) ? 2 : 1);
-	hr = pOut->SetActualDataLength(lOutDataLength);
+	hr = pOut->SetActualDataLength((LONG)frame.cbData);
 	if (FAILED(hr))
 		return hr;
 
-	// Check if we have accumulated the full codebook
-	if (m_pFormat->nCBParts == 0) {
-
-		if (m_pFormat->nColors != 0) {
-
-			// Get the frame number
-			LONGLONG llStart = 0, llEnd = 0;
-			hr = pIn->GetMediaTime(&llStart, &llEnd);
-			if (FAILED(hr))
-				return hr;
-
-			// Search the codebook table for an entry using our frame 
-			DWORD i = 0;
-			for (i = 0; i < m_nCodebooks; i++)
-				if (m_pCodebookTable[i].iFrame == (DWORD)llStart)
-					break;
-
-			// Check if this frame should use new full codebook
-			if (
-				(i < m_nCodebooks) &&
-				(m_pCodebookTable[i].cbSize != 0)
-			)
-				PutNewCodebook();
-		}
-
-	} else if (m_nNextCodebookParts == m_pFormat->nCBParts)
-		PutNewCodebook();
-
-	// Reset the flag indicating we've found and processed frame data
-	BOOL bIsFramePrepared = FALSE;
-
-	// Parse incoming data
-	while (lInDataLength > 0) {
-
-		// Check if we have enough data for chunk header
-		if (lInDataLength < sizeof(VQA_CHUNK_HEADER))
-			break;
-
-		// Get the chunk header
-		VQA_CHUNK_HEADER *pHeader = (VQA_CHUNK_HEADER*)pbInBuffer;
-		pbInBuffer += sizeof(VQA_CHUNK_HEADER);
-		lInDataLength -= sizeof(VQA_CHUNK_HEADER);
-
-		DWORD cbChunk = SWAPDWORD(pHeader->cbSize);
-
-		// Check that the chunk does not exceed incoming data threshold
-		if ((DWORD)lInDataLength < cbChunk)
-			break;
-
-		int cbCodebook;
-		int cbDecodeBuffer;
-
-		// Check the chunk type
-		switch (pHeader->dwID) {
-
-			// Full codebook (compressed)
-			case VQA_ID_CBFZ:
-
-				// Decompress the codebook
-				cbCodebook = MAX_CODEBOOK_SIZE;
-				DecodeFormat80(pbInBuffer, cbChunk, m_pCodebook, cbCodebook);
-				break;
-
-			// Full codebook (non-compressed)
-			case VQA_ID_CBF0:
-
-				// Copy the codebook
-				if (cbChunk > MAX_CODEBOOK_SIZE)
-					return E_UNEXPECTED;
-				CopyMemory(m_pCodebook, pbInBuffer, cbChunk);
-				break;
-
-			// Codebook part
-			case VQA_ID_CBPZ:
-			case VQA_ID_CBP0:
-
-				m_bIsNextCodebookCompressed = pHeader->dwID == VQA_ID_CBPZ;
-
-				// Sanity check of the codebook size
-				if (m_cbNextCodebook + cbChunk > MAX_CODEBOOK_SIZE)
-					return E_UNEXPECTED;
-
-				// Append this part to the next codebook
-				CopyMemory(m_pNextCodebook + m_cbNextCodebook, pbInBuffer, cbChunk);
-				m_cbNextCodebook += cbChunk;
-				m_nNextCodebookParts++;
-				break;
-
-			// Palette (compressed)
-			case VQA_ID_CPLZ:
-
-				// Decompress the palette
-				m_cbPalette = MAX_PALETTE_SIZE;
-				DecodeFormat80(pbInBuffer, cbChunk, m_pPalette, m_cbPalette);
-				break;
-
-			// Palette (non-compressed)
-			case VQA_ID_CPL0:
-
-				// Copy the palette data and set its size
-				CopyMemory(m_pPalette, pbInBuffer, m_cbPalette = (int)cbChunk);
-				break;
-
-			// Vector pointer data (non-compressed)
-			case VQA_ID_VPTR:
-
-				// Decode frame data
-				DecodeVPTR(
-					pbInBuffer,
-					cbChunk,
-					(m_pFormat->nColors == 0) ? m_pCurrentFrame : pbOutBuffer
-				);
-
-				// Copy image data to output sample (if needed)
-				if (m_pFormat->nColors == 0)
-					CopyMemory(pbOutBuffer, m_pCurrentFrame, lOutDataLength);
-
-				// We've processed the frame data, so set the flag
-				bIsFramePrepared = TRUE;
-				break;
-
-			// Vector pointer data (compressed)
-			case VQA_ID_VPTZ:
-			case VQA_ID_VPRZ:
-
-				// Decompress the data
-				cbDecodeBuffer = m_cbMaxDecodeBuffer;
-				hr = DecodeFormat80(pbInBuffer, cbChunk, m_pDecodeBuffer, cbDecodeBuffer);
-				if (FAILED(hr))
-					break;
-
-				// Decode frame data
-				DecodeVPTR(
-					m_pDecodeBuffer,
-					(DWORD)cbDecodeBuffer,
-					(m_pFormat->nColors == 0) ? m_pCurrentFrame : pbOutBuffer
-				);
-
-				// Copy image data to output sample (if needed)
-				if (m_pFormat->nColors == 0)
-					CopyMemory(pbOutBuffer, m_pCurrentFrame, lOutDataLength);
-
-				// We've processed the frame data, so set the flag
-				bIsFramePrepared = TRUE;
-				break;
-
-			default:
-
-				// Just skip over this chunk
-				break;
-		}
-
-		// Align to even boundary
-		if (cbChunk % 2)
-			cbChunk++;
-
-		// Advance data pointer and data size
-		pbInBuffer += cbChunk;
-		lInDataLength -= cbChunk;
-	}
-
-	// If there's no frame prepared, quit with no error
-	if (!bIsFramePrepared)
-		return S_FALSE;
-
-	// If we've booked palette change previously, do it now
-	if (m_cbPalette > 0) {
-
-		// Sanity check of the palette size
-		if (m_cbPalette > MAX_PALETTE_SIZE)
-			return E_UNEXPECTED;
+	// If the palette has changed, do it now
+	if (frame.nPaletteEntries > 0) {
 
 		// Get the output media type format
 		CMediaType mt((AM_MEDIA_TYPE)m_pOutput->CurrentMediaType());
 		VIDEOINFO *pVideoInfo = (VIDEOINFO*)mt.Format();
 
 		// Fill in the output media type format palette
-		BYTE *pbPalette = m_pPalette;
-		for (int i = 0; i < m_cbPalette / 3; i++) {
-			pVideoInfo->bmiColors[i].rgbRed			= (*pbPalette++) << 2;
-			pVideoInfo->bmiColors[i].rgbGreen		= (*pbPalette++) << 2;
-			pVideoInfo->bmiColors[i].rgbBlue		= (*pbPalette++) << 2;
+		for (int i = frame.iPaletteStart; i < frame.iPaletteStart + frame.nPaletteEntries; i++) {
+			pVideoInfo->bmiColors[i].rgbRed			= frame.pPalette[i].bRed;
+			pVideoInfo->bmiColors[i].rgbGreen		= frame.pPalette[i].bGreen;
+			pVideoInfo->bmiColors[i].rgbBlue		= frame.pPalette[i].bBlue;
 			pVideoInfo->bmiColors[i].rgbReserved	= 0;
 		}
 
@@ -573,9 +208,6 @@ HRESULT CVQAVideoDecompressor::Transform(
 		hr = pOut->SetMediaType(&mt);
 		if (FAILED(hr))
 			return hr;
-
-		// Reset the stored palette size
-		m_cbPalette = 0;
 	}
 
 	// Each RGB frame is a sync point
@@ -628,36 +260,10 @@ HRESULT CVQAVideoDecompressor::SetMediaType(
 		CheckPointer(pmt, E_POINTER);
 		ValidateReadPtr(pmt, sizeof(CMediaType));
 
-		// Free the old format block and allocate a new one
-		if (m_pFormat)
-			CoTaskMemFree(m_pFormat);
-		m_pFormat = (VQA_INFO*)CoTaskMemAlloc(pmt->FormatLength());
-		if (m_pFormat == NULL)
-			return E_OUTOFMEMORY;
-
-		// Copy format block to the allocated storage
-		CopyMemory(m_pFormat, pmt->Format(), pmt->FormatLength());
-
-		// Set up full codebook table
-		m_nCodebooks = (pmt->FormatLength() - sizeof(VQA_INFO)) / sizeof(VQA_CIND_ENTRY);
-		if (m_nCodebooks > 0)
-			m_pCodebookTable = (VQA_CIND_ENTRY*)((BYTE*)m_pFormat + sizeof(VQA_INFO));
-
-		// Set up the solid color marker byte
-		m_bSolidColorMarker = (
-								(m_pFormat->bBlockHeight == 4) || 
-								(m_pFormat->wVersion == 1)
-							) ? 0xFF : 0x0F;
-
-		// Set up block/image parameters
-		WORD cbPixel = ((m_pFormat->nColors == 0) ? 2 : 1);
-		m_nBlocksX = m_pFormat->wVideoWidth / m_pFormat->bBlockWidth;
-		m_nBlocksY = m_pFormat->wVideoHeight / m_pFormat->bBlockHeight;
-		m_nBlocks = m_nBlocksX * m_nBlocksY;
-		m_cbBlock = m_pFormat->bBlockWidth * m_pFormat->bBlockHeight * cbPixel;
-		m_cbBlockStride = m_pFormat->bBlockWidth * cbPixel;
-		m_cbImageXStride = m_pFormat->wVideoWidth * cbPixel;
-		m_cbImageYStride = m_cbImageXStride * (m_pFormat->bBlockHeight - 1);
+		// Pass the format block to the decoder. It will copy
+		// the block and set up the codebook table and 
+		// block/image parameters
+		return m_Decoder.SetFormat((VQA_INFO*)pmt->Format(), pmt->FormatLength());
 	}
 
 	return NOERROR;
@@ -669,29 +275,10 @@ HRESULT CVQAVideoDecompressor::BreakConnect(PIN_DIRECTION dir)
 	if (dir == PINDIR_INPUT) {
 
 		// Perform decoder clean-up
-		Cleanup();
+		m_Decoder.Cleanup();
 
 		// Free the format block
-		if (m_pFormat) {
-			CoTaskMemFree(m_pFormat);
-			m_pFormat = NULL;
-		}
-
-		// Reset codebook descriptor table
-		if (m_pCodebookTable) {
-			m_pCodebookTable = NULL;
-			m_nCodebooks = 0;
-		}
-
-		// Reset format-specific parameters
-		m_bSolidColorMarker = 0;
-		m_nBlocksX = 0;
-		m_nBlocksY = 0;
-		m_nBlocks = 0;
-		m_cbBlock = 0;
-		m_cbBlockStride = 0;
-		m_cbImageXStride = 0;
-		m_cbImageYStride = 0;
+		m_Decoder.ResetFormat();
 	}
 
 	return NOERROR;
@@ -758,7 +345,8 @@ HRESULT CVQAVideoDecompressor::GetMediaType(
 	ValidateWritePtr(pMediaType, sizeof(CMediaType));
 
 	// At this time we should have the format block
-	if (!m_pFormat)
+	const VQA_INFO *pFormat = m_Decoder.GetFormat();
+	if (!pFormat)
 		return E_UNEXPECTED;
 
 	if (iPosition < 0)
@@ -779,19 +367,19 @@ HRESULT CVQAVideoDecompressor::GetMediaType(
 		SetRectEmpty(&pVideoInfo->rcSource);
 		SetRectEmpty(&pVideoInfo->rcTarget);
 		pVideoInfo->bmiHeader.biSize			= sizeof(BITMAPINFOHEADER);
-		pVideoInfo->bmiHeader.biWidth			= (LONG)m_pFormat->wVideoWidth;
-		pVideoInfo->bmiHeader.biHeight			= -(LONG)m_pFormat->wVideoHeight;
+		pVideoInfo->bmiHeader.biWidth			= (LONG)pFormat->wVideoWidth;
+		pVideoInfo->bmiHeader.biHeight			= -(LONG)pFormat->wVideoHeight;
 		pVideoInfo->bmiHeader.biPlanes			= 1;
-		pVideoInfo->bmiHeader.biBitCount		= (m_pFormat->nColors == 0) ? 16 : 8;
+		pVideoInfo->bmiHeader.biBitCount		= (pFormat->nColors == 0) ? 16 : 8;
 		pVideoInfo->bmiHeader.biCompression		= BI_RGB;
 		pVideoInfo->bmiHeader.biSizeImage		= GetBitmapSize(&pVideoInfo->bmiHeader);
 		pVideoInfo->bmiHeader.biXPelsPerMeter	= 0;
 		pVideoInfo->bmiHeader.biYPelsPerMeter	= 0;
-		pVideoInfo->bmiHeader.biClrUsed			= m_pFormat->nColors;
+		pVideoInfo->bmiHeader.biClrUsed			= pFormat->nColors;
 		pVideoInfo->bmiHeader.biClrImportant	= 0;
-		pVideoInfo->dwBitRate					= pVideoInfo->bmiHeader.biSizeImage * 8 * m_pFormat->nFramesPerSecond;
+		pVideoInfo->dwBitRate					= pVideoInfo->bmiHeader.biSizeImage * 8 * pFormat->nFramesPerSecond;
 		pVideoInfo->dwBitErrorRate				= 0;
-		pVideoInfo->AvgTimePerFrame				= UNITS / m_pFormat->nFramesPerSecond;
+		pVideoInfo->AvgTimePerFrame				= UNITS / pFormat->nFramesPerSecond;
 
 		// Set media type fields
 		pMediaType->SetType(&MEDIATYPE_Video);
@@ -825,7 +413,8 @@ HRESULT CVQAVideoDecompressor::DecideBufferSize(
 		return E_UNEXPECTED;
 
 	// At this time we should have the format block
-	if (!m_pFormat)
+	const VQA_INFO *pFormat = m_Decoder.GetFormat();
+	if (!pFormat)
 		return E_UNEXPECTED;
 
 	// Get the input pin's allocator
@@ -848,7 +437,7 @@ HRESULT CVQAVideoDecompressor::DecideBufferSize(
 	// Set the properties: output buffer's size is frame size, 
 	// the buffers amount is the same as for the input pin and 
 	// we don't care about alignment and prefix
-	LONG cbFrame = m_pFormat->wVideoWidth * m_pFormat->wVideoHeight * ((m_pFormat->nColors == 0) ? 2 : 1);
+	LONG cbFrame = (LONG)m_Decoder.GetFrameSize();
 	pProperties->cbBuffer = max(pProperties->cbBuffer, cbFrame);
 	pProperties->cBuffers = max(pProperties->cBuffers, apInput.cBuffers);
 	ALLOCATOR_PROPERTIES apActual;
@@ -863,91 +452,16 @@ HRESULT CVQAVideoDecompressor::DecideBufferSize(
 	) ? E_FAIL : NOERROR;
 }
 
-void CVQAVideoDecompressor::Cleanup(void)
-{
-	if (m_pCurrentFrame) {
-		CoTaskMemFree(m_pCurrentFrame);
-		m_pCurrentFrame = NULL;
-	}
-
-	m_cbPalette = 0;
-
-	if (m_pDecodeBuffer) {
-		CoTaskMemFree(m_pDecodeBuffer);
-		m_pDecodeBuffer = NULL;
-		m_cbMaxDecodeBuffer = 0;
-	}
-
-	if (m_pCodebook) {
-		CoTaskMemFree(m_pCodebook);
-		m_pCodebook = NULL;
-	}
-
-	if (m_pNextCodebook) {
-		CoTaskMemFree(m_pNextCodebook);
-		m_pNextCodebook = NULL;
-		m_cbNextCodebook = 0;
-		m_nNextCodebookParts = 0;
-		m_bIsNextCodebookCompressed = FALSE;
-	}
-}
-
 HRESULT CVQAVideoDecompressor::StartStreaming(void)
 {
-	// We should have the format block at this time
-	if (m_pFormat == NULL)
-		return E_UNEXPECTED;
-
-	// Allocate frame buffer (for HiColor video only)
-	if (m_pFormat->nColors == 0) {
-		DWORD cbFrame = m_pFormat->wVideoWidth * m_pFormat->wVideoHeight * ((m_pFormat->nColors == 0) ? 2 : 1);
-		m_pCurrentFrame = (BYTE*)CoTaskMemAlloc(cbFrame);
-		if (m_pCurrentFrame == NULL) {
-			Cleanup();
-			return E_OUTOFMEMORY;
-		}
-		ZeroMemory(m_pCurrentFrame, cbFrame);
-	}
-
-	// Reset palette data size
-	m_cbPalette = 0;
-
-	// Allocate decode buffer
-	m_cbMaxDecodeBuffer = 3 * (m_pFormat->wVideoWidth / m_pFormat->bBlockWidth) *
-						(m_pFormat->wVideoHeight / m_pFormat->bBlockHeight); // Maximum 3 bytes per block
-	m_pDecodeBuffer = (BYTE*)CoTaskMemAlloc((ULONG)m_cbMaxDecodeBuffer);
-	if (m_pDecodeBuffer == NULL) {
-		Cleanup();
-		return E_OUTOFMEMORY;
-	}
-
-	// Allocate codebooks
-	m_pCodebook = (BYTE*)CoTaskMemAlloc(MAX_CODEBOOK_SIZE);
-	if (m_pCodebook == NULL) {
-		Cleanup();
-		return E_OUTOFMEMORY;
-	}
-	m_pNextCodebook = (BYTE*)CoTaskMemAlloc(MAX_CODEBOOK_SIZE);
-	if (m_pNextCodebook == NULL) {
-		Cleanup();
-		return E_OUTOFMEMORY;
-	}
-	m_cbNextCodebook = 0;
-	m_nNextCodebookParts = 0;
-	m_bIsNextCodebookCompressed = FALSE;
-
-	// Zero palette and the codebooks
-	ZeroMemory(m_pPalette, MAX_PALETTE_SIZE);
-	ZeroMemory(m_pCodebook, MAX_CODEBOOK_SIZE);
-	ZeroMemory(m_pNextCodebook, MAX_CODEBOOK_SIZE);
-
-	return NOERROR;
+	// Allocate the decoder buffers
+	return m_Decoder.Initialize();
 }
 
 HRESULT CVQAVideoDecompressor::StopStreaming(void)
 {
 	// Perform decoder clean-up
-	Cleanup();
+	m_Decoder.Cleanup();
 
 	return NOERROR;
 }
@@ -956,8 +470,7 @@ HRESULT CVQAVideoDecompressor::EndFlush(void)
 {
 	// Reset codebook accumulation stuff so that after flush we will 
 	// be able to receive codebook parts from the scratch
-	m_cbNextCodebook = 0;
-	m_nNextCodebookParts = 0;
+	m_Decoder.Reset();
 
 	// Call the base-class method
 	return CTransformFilter::EndFlush();
@@ -979,120 +492,6 @@ STDMETHODIMP CVQAVideoDecompressor::GetPages(CAUUID *pPages)
 	return NOERROR;
 }
 
-//==========================================================================
-// Format80 decoder source code taken from vqavideo.c
-// by Mike Melanson (melanson@pcisys.net)
-//==========================================================================
-
-#define CHECK_COUNT() if (dest_index + count > dest_size) return VFW_E_BUFFER_OVERFLOW;
-
-HRESULT CVQAVideoDecompressor::DecodeFormat80(
-	unsigned char *src,
-	int src_size,
-	unsigned char *dest,
-	int& dest_size
-)
-{
-    int src_index = 0;
-    int dest_index = 0;
-    int count;
-    int src_pos;
-    unsigned char color;
-    int i;
-
-	// Set up the data threshold
-	unsigned char *src_threshold = src + src_size;
-	unsigned char *dest_threshold = dest + dest_size;
-
-	// Set up modification flag
-	VALIDATEREAD(src, 1, src_threshold, E_UNEXPECTED);
-	int mod = src[0] == 0x00;
-	if (mod)
-		src_index++;
-
-    while (src_index < src_size) {
-
-        /* 0x80 means that frame is finished */
-        if (src[src_index] == 0x80) {
-			dest_size = dest_index;
-            return NOERROR;
-		}
-
-        if (dest_index >= dest_size)
-            return VFW_E_BUFFER_OVERFLOW;
-
-        if (src[src_index] == 0xFF) {
-
-            src_index++;
-			VALIDATEREAD(src + src_index, 2, src_threshold, E_UNEXPECTED);
-            count = LE_16(&src[src_index]);
-            src_index += 2;
-			VALIDATEREAD(src + src_index, 2, src_threshold, E_UNEXPECTED);
-            src_pos = (mod) ? (dest_index - LE_16(&src[src_index])) : LE_16(&src[src_index]);
-            src_index += 2;
-            CHECK_COUNT();
-			VALIDATEREAD(dest + src_pos, count, dest_threshold, E_UNEXPECTED);
-			if (src_pos < 0)
-				return E_UNEXPECTED;
-            for (i = 0; i < count; i++)
-                dest[dest_index + i] = dest[src_pos + i];
-            dest_index += count;
-
-        } else if (src[src_index] == 0xFE) {
-
-            src_index++;
-			VALIDATEREAD(src + src_index, 2, src_threshold, E_UNEXPECTED);
-            count = LE_16(&src[src_index]);
-            src_index += 2;
-			VALIDATEREAD(src + src_index, 1, src_threshold, E_UNEXPECTED);
-            color = src[src_index++];
-            CHECK_COUNT();
-            memset(&dest[dest_index], color, count);
-            dest_index += count;
-
-        } else if ((src[src_index] & 0xC0) == 0xC0) {
-
-            count = (src[src_index++] & 0x3F) + 3;
-			VALIDATEREAD(src + src_index, 2, src_threshold, E_UNEXPECTED);
-            src_pos = (mod) ? (dest_index - LE_16(&src[src_index])) : LE_16(&src[src_index]);
-            src_index += 2;
-            CHECK_COUNT();
-			VALIDATEREAD(dest + src_pos, count, dest_threshold, E_UNEXPECTED);
-			if (src_pos < 0)
-				return E_UNEXPECTED;
-            for (i = 0; i < count; i++)
-                dest[dest_index + i] = dest[src_pos + i];
-            dest_index += count;
-
-        } else if (src[src_index] > 0x80) {
-
-            count = src[src_index++] & 0x3F;
-            CHECK_COUNT();
-			VALIDATEREAD(src + src_index, count, src_threshold, E_UNEXPECTED);
-            memcpy(&dest[dest_index], &src[src_index], count);
-            src_index += count;
-            dest_index += count;
-
-        } else {
-
-            count = ((src[src_index] & 0x70) >> 4) + 3;
-			VALIDATEREAD(src + src_index, 2, src_threshold, E_UNEXPECTED);
-            src_pos = BE_16(&src[src_index]) & 0x0FFF;
-            src_index += 2;
-            CHECK_COUNT();
-			VALIDATEREAD(dest + dest_index - src_pos, count, dest_threshold, E_UNEXPECTED);
-			if (dest_index - src_pos < 0)
-				return E_UNEXPECTED;
-            for (i = 0; i < count; i++)
-                dest[dest_index + i] = dest[dest_index - src_pos + i];
-            dest_index += count;
-        }
-    }
-
-	dest_size = dest_index;
-	return NOERROR;
-}
-
 //==========================================================================
 // CVQAVideoDecompressorPage methods
 //==========================================================================
@@ -28,65 +28,24 @@
 
 #include <streams.h>
 
+#include "BaseDecompressor.h"
 #include "VQASpecs.h"
+#include "VQAVideoDecoder.h"
 
 //==========================================================================
 // VQA video decompressor filter class
 //==========================================================================
 
-class CVQAVideoDecompressor :	public CTransformFilter,
+class CVQAVideoDecompressor :	public CBaseDecompressorFilter,
 								public ISpecifyPropertyPages
 {
-	// ---- Decoder data ----
-
-	BYTE *m_pCurrentFrame;				// Current frame buffer
-	BYTE m_pPalette[MAX_PALETTE_SIZE];	// Decompressed palette buffer
-	int m_cbPalette;					// Size of palette data
-	BYTE *m_pDecodeBuffer;				// Decompressed VPTR buffer
-	int m_cbMaxDecodeBuffer;			// Size of decompressed VPTR buffer
-	BYTE *m_pCodebook;					// Current codebook
-	BYTE *m_pNextCodebook;				// Next codebook buffer
-	DWORD m_cbNextCodebook;				// Size of the accumulated codebook parts
-	BYTE m_nNextCodebookParts;			// Number of the accumulated codebook parts
-	BOOL m_bIsNextCodebookCompressed;	// Is the next codebook compressed?
-	BYTE m_bSolidColorMarker;			// Byte value indicating solid color block
-
-	// Format block
-	VQA_INFO *m_pFormat;				// Video info
-	VQA_CIND_ENTRY *m_pCodebookTable;	// Full codebook descriptor table
-	DWORD m_nCodebooks;					// Number of full codebook descriptors
-
-	// Pre-calculated values
-	DWORD m_nBlocksX;					// Number of blocks along X axis
-	DWORD m_nBlocksY;					// Number of blocks along Y axis
-	DWORD m_nBlocks;					// Total number of blocks in the image
-	DWORD m_cbBlock;					// Size of the block
-	DWORD m_cbBlockStride;				// Block stride
-	DWORD m_cbImageXStride;				// Image stride along X axis
-	DWORD m_cbImageYStride;				// Image stride along Y axis
+	// Platform-neutral VQA video decoder
+	CVQAVideoDecoder m_Decoder;
 
 	// Constructor/destructor
 	CVQAVideoDecompressor(LPUNKNOWN pUnk, HRESULT *phr);
 	~CVQAVideoDecompressor();
 
-	// Internal clean-up method
-	void Cleanup(void);
-
-	// Video decoder methods
-	HRESULT DecodeVPTR(BYTE *pbData, DWORD cbData, BYTE *pbImage);
-	void FillBlock(BYTE *pbImage, WORD wIndex);
-	void FillBlockSolid(BYTE *pbImage, BYTE bColor);
-	void PutNewCodebook(void);
-
-	// Format80 decoder source code taken from vqavideo.c
-	// by Mike Melanson (melanson@pcisys.net)
-	HRESULT DecodeFormat80(
-		unsigned char *src,
-		int src_size,
-		unsigned char *dest,
-		int& dest_size
-	);
-
 public:
 
 	static CUnknown * WINAPI CreateInstance(LPUNKNOWN pUnk, HRESULT *phr);
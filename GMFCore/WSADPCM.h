@@ -25,8 +25,11 @@
 #ifndef __GMF_WSADPCM_H__
 #define __GMF_WSADPCM_H__
 
-#include <windows.h>
+#include "CodecTypes.h"
+
+#ifdef _WIN32
 #include <initguid.h>
+#endif
 
 //==========================================================================
 // Structures
@@ -47,6 +50,8 @@ typedef struct tagWSADPCMINFO {
 
 #pragma pack()
 
+#ifdef _WIN32
+
 //==========================================================================
 // GUIDs
 //==========================================================================
@@ -80,3 +85,5 @@ DEFINE_GUID(CLSID_WSADPCMDecompressorPage,
 0x215eb724, 0x32d5, 0x4f94, 0xa6, 0x43, 0x65, 0x6e, 0xbc, 0x52, 0xd4, 0x7d);
 
 #endif
+
+#endif
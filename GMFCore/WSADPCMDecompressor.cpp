@@ -25,16 +25,6 @@
 #include "WSADPCMDecompressor.h"
 #include "resource.h"
 
-//==========================================================================
-// WS ADPCM decompression tables
-//==========================================================================
-
-const CHAR CWSADPCMDecompressor::g_chWSTable2bit[]=
-{ -2, -1, 0, 1 };
-
-const CHAR CWSADPCMDecompressor::g_chWSTable4bit[]=
-{ -9, -8, -6, -5, -4, -3, -2, -1, 0, 1, 2, 3, 4, 5, 6, 8 };
-
 //==========================================================================
 // WS ADPCM decompressor setup data
 //==========================================================================
@@ -93,123 +83,18 @@ CWSADPCMDecompressor::CWSADPCMDecompressor(
 	LPUNKNOWN pUnk,
 	HRESULT *phr
 ) :
-	CTransformFilter(
+	CBaseDecompressorFilter(
 		NAME("WS ADPCM Decompressor"),
 		pUnk,
 		CLSID_WSADPCMDecompressor
-	),
-	m_pFormat(NULL)	// No format block at this time
+	)
 {
 	ASSERT(phr);
 }
 
 CWSADPCMDecompressor::~CWSADPCMDecompressor()
 {
-	// Free the format block
-	if (m_pFormat) {
-		CoTaskMemFree(m_pFormat);
-		m_pFormat = NULL;
-	}
-}
-
-void CWSADPCMDecompressor::Clip8BitSample(SHORT *piSample)
-{
-	if (*piSample > 0xFF)	*piSample = 0xFF;
-	if (*piSample < 0)		*piSample = 0;
-}
-
-void CWSADPCMDecompressor::Decompress(
-	WORD wInSize,
-	BYTE *pbInput,
-	WORD wOutSize,
-	BYTE *pbOutput
-)
-{
-	BYTE	bCode;
-	CHAR	chCount;
-	WORD	wIn;
-	SHORT	iOut;
-
-	// Initialize sample value
-	iOut = 0x80;
-
-	// Non-compressed block
-	if (wInSize == wOutSize) {
-		for (; wOutSize > 0; wOutSize--)
-			*pbOutput++ = *pbInput++;
-		return;
-	}
-
-	// Process data until it's exhausted
-	while (wOutSize > 0) {
-
-		wIn = *pbInput++;
-		wIn <<= 2;
-		bCode = HIBYTE(wIn);
-		chCount = LOBYTE(wIn) >> 2;
-		switch (bCode) {
-
-			case 2:
-				if (chCount & 0x20) {
-					chCount <<= 3;
-					iOut += chCount >> 3;
-					*pbOutput++ = (BYTE)iOut;
-					wOutSize--;
-				} else {
-					for (chCount++; chCount > 0; chCount--, wOutSize--)
-						*pbOutput++ = *pbInput++;
-					iOut = pbOutput[-1];
-				}
-				break;
-
-			case 1:
-				for (chCount++; chCount > 0; chCount--) {
-
-					bCode = *pbInput++;
-
-					iOut += g_chWSTable4bit[bCode & 0x0F];
-					Clip8BitSample(&iOut);
-					*pbOutput++ = (BYTE)iOut;
-
-					iOut += g_chWSTable4bit[bCode >> 4];
-					Clip8BitSample(&iOut);
-					*pbOutput++ = (BYTE)iOut;
-
-					wOutSize -= 2;
-				}
-				break;
-
-			case 0:
-				for (chCount++; chCount > 0; chCount--) {
-
-					bCode = *pbInput++;
-
-					iOut += g_chWSTable2bit[bCode & 0x03];
-					Clip8BitSample(&iOut);
-					*pbOutput++ = (BYTE)iOut;
-
-					iOut += g_chWSTable2bit[(bCode >> 2) & 0x03];
-					Clip8BitSample(&iOut);
-					*pbOutput++ =(BYTE)iOut;
-
-					iOut += g_chWSTable2bit[(bCode >> 4) & 0x03];
-					Clip8BitSample(&iOut);
-					*pbOutput++ = (BYTE)iOut;
-
-					iOut += g_chWSTable2bit[(bCode >> 6) & 0x03];
-					Clip8BitSample(&iOut);
-					*pbOutput++ = (BYTE)iOut;
-
-					wOutSize -= 4;
-				}
-				break;
-
-			default:
-				for (chCount++; chCount > 0; chCount--, wOutSize--)
-					*pbOutput++ = (BYTE)iOut;
-				break;
-		}
-	}
+	// The decoder frees its format block itself
 }
 
 CUnknown* WINAPI CWSADPCMDecompressor::CreateInstance(
@@ -233,7 +118,7 @@ STDMETHODIMP CWSADPCMDecompressor::NonDelegatingQueryInterface(REFIID riid, void
 	if (riid == IID_ISpecifyPropertyPages)
 		return GetInterface((ISpecifyPropertyPages*)this, ppv);
 	else
-		return CTransformFilter::NonDelegatingQueryInterface(riid, ppv);
+		return CBaseDecompressorFilter::NonDelegatingQueryInterface(riid, ppv);
 }
 
 HRESULT CWSADPCMDecompressor::Transform(
@@ -262,17 +147,19 @@ HRESULT CWSADPCMDecompressor::Transform(
 	if (FAILED(hr))
 		return hr;
 
+	// Set up the output frame descriptor
+	GMF_FRAME frame;
+	ZeroMemory(&frame, sizeof(GMF_FRAME));
+	frame.pbBuffer	= pbOutBuffer;
+	frame.cbBuffer	= (DWORD)pOut->GetSize();
+
 	// Decompress the input buffer to the output one
-	WSADPCMINFO *pInfo = (WSADPCMINFO*)pbInBuffer;
-	Decompress(
-		pInfo->wInSize,
-		pbInBuffer + sizeof(WSADPCMINFO),
-		pInfo->wOutSize,
-		pbOutBuffer
-	);
+	hr = m_Decoder.Decode(pbInBuffer, (DWORD)lInDataLength, frame);
+	if (FAILED(hr))
+		return hr;
 
 	// Set the data length for the output sample
-	hr = pOut->SetActualDataLength(pInfo->wOutSize);
+	hr = pOut->SetActualDataLength((LONG)frame.cbData);
 	if (FAILED(hr))
 		return hr;
 
@@ -325,15 +212,8 @@ HRESULT CWSADPCMDecompressor::SetMediaType(
 		CheckPointer(pmt, E_POINTER);
 		ValidateReadPtr(pmt, sizeof(CMediaType));
 
-		// Free the old format block and allocate a new one
-		if (m_pFormat)
-			CoTaskMemFree(m_pFormat);
-		m_pFormat = (WSADPCMWAVEFORMAT*)CoTaskMemAlloc(pmt->FormatLength());
-		if (m_pFormat == NULL)
-			return E_OUTOFMEMORY;
-
-		// Copy format block to the allocated storage
-		CopyMemory(m_pFormat, pmt->Format(), pmt->FormatLength());
+		// Pass the format block to the decoder
+		return m_Decoder.SetFormat((WSADPCMWAVEFORMAT*)pmt->Format(), pmt->FormatLength());
 	}
 
 	return NOERROR;
@@ -344,10 +224,7 @@ HRESULT CWSADPCMDecompressor::BreakConnect(PIN_DIRECTION dir)
 	// Catch only the input pin disconnection
 	if (dir == PINDIR_INPUT) {
 		// Free the format block
-		if (m_pFormat) {
-			CoTaskMemFree(m_pFormat);
-			m_pFormat = NULL;
-		}
+		m_Decoder.ResetFormat();
 	}
 
 	return NOERROR;
@@ -402,7 +279,8 @@ HRESULT CWSADPCMDecompressor::GetMediaType(
 	ValidateWritePtr(pMediaType, sizeof(CMediaType));
 
 	// At this time we should have the format block
-	if (!m_pFormat)
+	const WSADPCMWAVEFORMAT *pFormat = m_Decoder.GetFormat();
+	if (!pFormat)
 		return E_UNEXPECTED;
 
 	if (iPosition < 0)
@@ -413,9 +291,9 @@ HRESULT CWSADPCMDecompressor::GetMediaType(
 		// Prepare the format block
 		WAVEFORMATEX wfex		= {0};
 		wfex.wFormatTag			= WAVE_FORMAT_PCM;
-		wfex.nChannels			= m_pFormat->nChannels;
-		wfex.nSamplesPerSec		= m_pFormat->nSamplesPerSec;
-		wfex.wBitsPerSample		= m_pFormat->wBitsPerSample;
+		wfex.nChannels			= pFormat->nChannels;
+		wfex.nSamplesPerSec		= pFormat->nSamplesPerSec;
+		wfex.wBitsPerSample		= pFormat->wBitsPerSample;
 		wfex.nBlockAlign		= (wfex.nChannels * wfex.wBitsPerSample) / 8;
 		wfex.nAvgBytesPerSec	= wfex.nSamplesPerSec * wfex.nBlockAlign;
 		wfex.cbSize				= 0;
@@ -471,7 +349,7 @@ HRESULT CWSADPCMDecompressor::DecideBufferSize(
 	// Set the properties: output buffer is four times larger 
 	// then the input one, the buffers amount is the same and 
 	// we don't care about alignment and prefix
-	pProperties->cbBuffer = max(pProperties->cbBuffer, apInput.cbBuffer * 64);
+	pProperties->cbBuffer = max(pProperties->cbBuffer, (LONG)m_Decoder.GetMaxOutputSize((DWORD)apInput.cbBuffer));
 	pProperties->cBuffers = max(pProperties->cBuffers, apInput.cBuffers);
 	ALLOCATOR_PROPERTIES apActual;
 	hr = pAlloc->SetProperties(pProperties, &apActual);
@@ -27,34 +27,25 @@
 
 #include <streams.h>
 
+#include "BaseDecompressor.h"
 #include "WSADPCM.h"
+#include "WSADPCMDecoder.h"
 
 //==========================================================================
 // WS ADPCM decompressor filter class
 //==========================================================================
 
-class CWSADPCMDecompressor :	public CTransformFilter,
+class CWSADPCMDecompressor :	public CBaseDecompressorFilter,
 								public ISpecifyPropertyPages
 {
 
-	// ---- WS ADPDCM decompression tables ----
-
-	static const CHAR g_chWSTable2bit[];
-	static const CHAR g_chWSTable4bit[];
-
-	// Format block
-	WSADPCMWAVEFORMAT *m_pFormat;
+	// Platform-neutral WS ADPCM decoder
+	CWSADPCMDecoder m_Decoder;
 
 	// Constructor/destructor
 	CWSADPCMDecompressor(LPUNKNOWN pUnk, HRESULT *phr);
 	~CWSADPCMDecompressor();
 
-	// Utility method (sample clipping)
-	static void Clip8BitSample(SHORT *iSample);
-
-	// Decompression method
-	void Decompress(WORD wInSize, BYTE *pbInput, WORD wOutSize, BYTE *pbOutput);
-
 public:
 
 	static CUnknown* WINAPI CreateInstance(LPUNKNOWN pUnk, HRESULT *phr);
@@ -0,0 +1,233 @@
+//==========================================================================
+//
+// File: GMFGen.cpp
+//
+// Desc: Game Media Formats - Synthetic test file generator
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#include <stdio.h>
+
+#include "StreamGenerators.h"
+#include "StreamWriters.h"
+
+//==========================================================================
+// Formats table
+//==========================================================================
+
+typedef HRESULT (*PFN_GENERATE_STREAM)(CGenStream *pStream, const GEN_PARAMS *pParams);
+typedef HRESULT (*PFN_WRITE_FILE)(const CGenStream *pStream, const char *pszFileName);
+
+typedef struct tagGEN_FORMAT {
+	const char			*pszName;		// Format name (as given in the command line)
+	const char			*pszDesc;		// Format description
+	PFN_GENERATE_STREAM	pfnGenerate;	// Stream generator
+	PFN_WRITE_FILE		pfnWrite;		// File writer
+} GEN_FORMAT;
+
+static const GEN_FORMAT g_Formats[] = {
+	{ "vqa8",	"VQA v2 8-bit, 4x2 blocks",			GenerateVQA8Stream,		WriteVQAFile	},
+	{ "vqa16",	"VQA v3 hi-color, 4x4 blocks",		GenerateVQA16Stream,	WriteVQAFile	},
+	{ "roq",	"ROQ video",						GenerateROQStream,		WriteROQFile	},
+	{ "mve8",	"MVE 8-bit video",					GenerateMVE8Stream,		WriteMVEFile	},
+	{ "mve16",	"MVE hi-color video",				GenerateMVE16Stream,	WriteMVEFile	},
+	{ "cin",	"CIN Huffman video, silent audio",	GenerateCINStream,		WriteCINFile	}
+};
+
+#define GEN_FORMATS (sizeof(g_Formats) / sizeof(g_Formats[0]))
+
+//==========================================================================
+// Command line
+//==========================================================================
+
+static void PrintUsage(void)
+{
+	printf(
+		"Usage: gmfgen [options] format file\n"
+		"\n"
+		"Options:\n"
+		"  -r WxH    video resolution (default: 320x200)\n"
+		"  -n N      frames (default: 60)\n"
+		"  -c N      codebook/palette refresh period in frames, 0 = never (default: 8)\n"
+		"  -k N      send each refreshed VQA codebook in N parts, 0 = whole (default: 0)\n"
+		"  -s N      random seed (default: 1)\n"
+		"  -u        store VQA codebooks and vector pointers uncompressed\n"
+		"            (CBF0/VPTR instead of CBFZ/VPTZ/VPRZ)\n"
+		"  -l        list formats\n"
+		"\n"
+		"The resolution is rounded down to the format block size.\n"
+	);
+}
+
+static BOOL ParseNumber(const char *psz, DWORD *pdwValue)
+{
+	char *pszEnd = NULL;
+	unsigned long ulValue = strtoul(psz, &pszEnd, 10);
+	if ((pszEnd == psz) || (*pszEnd != '\0'))
+		return FALSE;
+	*pdwValue = (DWORD)ulValue;
+	return TRUE;
+}
+
+static const GEN_FORMAT* FindFormat(const char *pszName)
+{
+	for (DWORD i = 0; i < GEN_FORMATS; i++)
+		if (strcmp(g_Formats[i].pszName, pszName) == 0)
+			return &g_Formats[i];
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	GEN_PARAMS params;
+	params.dwWidth			= 320;
+	params.dwHeight			= 200;
+	params.nFrames			= 60;
+	params.nChurnFrames		= 8;
+	params.nCodebookParts	= 0;
+	params.cbAudioBlock		= 4096;
+	params.dwSeed			= 1;
+	params.bUncompressed	= FALSE;
+
+	const GEN_FORMAT *pFormat = NULL;
+	const char *pszFileName = NULL;
+
+	// Parse the command line
+	for (int i = 1; i < argc; i++) {
+
+		const char *pszArg = argv[i];
+		BOOL bIsValid = TRUE;
+
+		if ((pszArg[0] == '-') && (pszArg[1] != '\0') && (pszArg[2] == '\0')) {
+
+			if ((pszArg[1] == 'h') || (pszArg[1] == '?')) {
+				PrintUsage();
+				return 0;
+			}
+			if (pszArg[1] == 'l') {
+				for (DWORD j = 0; j < GEN_FORMATS; j++)
+					printf("%-6s %s\n", g_Formats[j].pszName, g_Formats[j].pszDesc);
+				return 0;
+			}
+			if (pszArg[1] == 'u') {
+				params.bUncompressed = TRUE;
+				continue;
+			}
+
+			// All other options take a value
+			if (i + 1 >= argc) {
+				fprintf(stderr, "Option %s requires a value\n", pszArg);
+				return 2;
+			}
+			const char *pszValue = argv[++i];
+
+			switch (pszArg[1]) {
+				case 'r':
+					{
+						unsigned long ulWidth = 0, ulHeight = 0;
+						bIsValid =
+							(sscanf(pszValue, "%lux%lu", &ulWidth, &ulHeight) == 2) &&
+							(ulWidth > 0) && (ulHeight > 0);
+						params.dwWidth	= (DWORD)ulWidth;
+						params.dwHeight	= (DWORD)ulHeight;
+					}
+					break;
+				case 'n':
+					bIsValid = ParseNumber(pszValue, &params.nFrames) && (params.nFrames > 0);
+					break;
+				case 'c':
+					bIsValid = ParseNumber(pszValue, &params.nChurnFrames);
+					break;
+				case 'k':
+					bIsValid = ParseNumber(pszValue, &params.nCodebookParts);
+					break;
+				case 's':
+					bIsValid = ParseNumber(pszValue, &params.dwSeed);
+					break;
+				default:
+					bIsValid = FALSE;
+					break;
+			}
+
+		} else if (pFormat == NULL) {
+
+			pFormat = FindFormat(pszArg);
+			bIsValid = (pFormat != NULL);
+
+		} else if (pszFileName == NULL) {
+
+			pszFileName = pszArg;
+
+		} else
+			bIsValid = FALSE;
+
+		if (!bIsValid) {
+			fprintf(stderr, "Invalid argument: %s\n", pszArg);
+			PrintUsage();
+			return 2;
+		}
+	}
+
+	if ((pFormat == NULL) || (pszFileName == NULL)) {
+		PrintUsage();
+		return 2;
+	}
+
+	// Generate the stream and wrap it into the file
+	CGenStream stream;
+	HRESULT hr = pFormat->pfnGenerate(&stream, &params);
+	if (FAILED(hr)) {
+		fprintf(
+			stderr,
+			"%s %lux%lu: stream generation failed (0x%08lX)\n",
+			pFormat->pszName,
+			(unsigned long)params.dwWidth,
+			(unsigned long)params.dwHeight,
+			(unsigned long)hr
+		);
+		return 1;
+	}
+
+	hr = pFormat->pfnWrite(&stream, pszFileName);
+	if (hr == E_INVALIDARG) {
+		fprintf(
+			stderr,
+			"%s %lux%lu: the stream does not fit the container limits\n",
+			pFormat->pszName,
+			(unsigned long)stream.GetWidth(),
+			(unsigned long)stream.GetHeight()
+		);
+		return 1;
+	} else if (FAILED(hr)) {
+		fprintf(stderr, "%s: cannot write the file (0x%08lX)\n", pszFileName, (unsigned long)hr);
+		return 1;
+	}
+
+	printf(
+		"%s: %s %lux%lu, %lu frames, %lu bytes of stream data\n",
+		pszFileName,
+		pFormat->pszName,
+		(unsigned long)stream.GetWidth(),
+		(unsigned long)stream.GetHeight(),
+		(unsigned long)params.nFrames,
+		(unsigned long)stream.GetDataSize()
+	);
+
+	return 0;
+}
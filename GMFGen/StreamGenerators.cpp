@@ -0,0 +1,1290 @@
+//==========================================================================
+//
+// File: StreamGenerators.cpp
+//
+// Desc: Game Media Formats - Implementation of synthetic stream generators
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#include "StreamGenerators.h"
+#include "VQASpecs.h"
+#include "ROQSpecs.h"
+#include "MVESpecs.h"
+#include "CINSpecs.h"
+#include "ContinuousIMAADPCM.h"
+#include "WSADPCM.h"
+
+//==========================================================================
+// CGenStream methods
+//==========================================================================
+
+CGenStream::CGenStream() :
+	m_pbFormat(NULL),
+	m_cbFormat(0),
+	m_pbData(NULL),
+	m_cbData(0),
+	m_cbMaxData(0),
+	m_pdwOffsets(NULL),
+	m_nBlocks(0),
+	m_nMaxBlocks(0),
+	m_dwWidth(0),
+	m_dwHeight(0)
+{
+}
+
+CGenStream::~CGenStream()
+{
+	// Free the stream data
+	Free();
+}
+
+void CGenStream::Free(void)
+{
+	if (m_pbFormat) {
+		free(m_pbFormat);
+		m_pbFormat = NULL;
+	}
+	m_cbFormat = 0;
+
+	if (m_pbData) {
+		free(m_pbData);
+		m_pbData = NULL;
+	}
+	m_cbData = 0;
+	m_cbMaxData = 0;
+
+	if (m_pdwOffsets) {
+		free(m_pdwOffsets);
+		m_pdwOffsets = NULL;
+	}
+	m_nBlocks = 0;
+	m_nMaxBlocks = 0;
+
+	m_dwWidth = 0;
+	m_dwHeight = 0;
+}
+
+HRESULT CGenStream::SetFormat(const void *pFormat, DWORD cbFormat)
+{
+	// Check the pointer
+	if (pFormat == NULL)
+		return E_POINTER;
+
+	// Free the old format block and allocate a new one
+	if (m_pbFormat)
+		free(m_pbFormat);
+	m_pbFormat = (BYTE*)malloc(cbFormat);
+	if (m_pbFormat == NULL) {
+		m_cbFormat = 0;
+		return E_OUTOFMEMORY;
+	}
+
+	// Copy format block to the allocated storage
+	CopyMemory(m_pbFormat, pFormat, cbFormat);
+	m_cbFormat = cbFormat;
+
+	return NOERROR;
+}
+
+BYTE* CGenStream::BeginBlock(DWORD cbMaxBlock)
+{
+	// Grow the data storage (if needed)
+	if (m_cbData + cbMaxBlock > m_cbMaxData) {
+		DWORD cbNewMax = (m_cbMaxData > 0) ? m_cbMaxData : 65536;
+		while (m_cbData + cbMaxBlock > cbNewMax)
+			cbNewMax *= 2;
+		BYTE *pbNewData = (BYTE*)realloc(m_pbData, cbNewMax);
+		if (pbNewData == NULL)
+			return NULL;
+		m_pbData = pbNewData;
+		m_cbMaxData = cbNewMax;
+	}
+
+	// Grow the offsets table (if needed)
+	if ((m_pdwOffsets == NULL) || (m_nBlocks == m_nMaxBlocks)) {
+		DWORD nNewMax = (m_nMaxBlocks > 0) ? m_nMaxBlocks * 2 : 256;
+		DWORD *pdwNewOffsets = (DWORD*)realloc(m_pdwOffsets, (nNewMax + 1) * sizeof(DWORD));
+		if (pdwNewOffsets == NULL)
+			return NULL;
+		m_pdwOffsets = pdwNewOffsets;
+		m_nMaxBlocks = nNewMax;
+		if (m_nBlocks == 0)
+			m_pdwOffsets[0] = 0;
+	}
+
+	return m_pbData + m_cbData;
+}
+
+HRESULT CGenStream::EndBlock(DWORD cbBlock)
+{
+	// The block should have been started
+	if ((m_pdwOffsets == NULL) || (m_cbData + cbBlock > m_cbMaxData))
+		return E_UNEXPECTED;
+
+	m_cbData += cbBlock;
+	m_nBlocks++;
+	m_pdwOffsets[m_nBlocks] = m_cbData;
+
+	return NOERROR;
+}
+
+//==========================================================================
+// Helper functions
+//==========================================================================
+
+static void PutWord(BYTE *pb, WORD wValue)
+{
+	pb[0] = LOBYTE(wValue);
+	pb[1] = HIBYTE(wValue);
+}
+
+static void PutDword(BYTE *pb, DWORD dwValue)
+{
+	PutWord(pb, (WORD)(dwValue & 0xFFFF));
+	PutWord(pb + 2, (WORD)(dwValue >> 16));
+}
+
+// Smallest of two values
+static DWORD MinValue(DWORD dwA, DWORD dwB)
+{
+	return (dwA < dwB) ? dwA : dwB;
+}
+
+// Worst case size of Format80 data for the input of the specified size
+static DWORD GetMaxFormat80Size(DWORD cbData)
+{
+	return cbData + cbData / 63 + 2;
+}
+
+// Encode data with Format80 using literal runs and fills only
+static DWORD EncodeFormat80(const BYTE *pbIn, DWORD cbIn, BYTE *pbOut)
+{
+	DWORD iIn = 0, iOut = 0, iLiteral = 0;
+
+	while (iIn <= cbIn) {
+
+		// Measure the run of identical bytes
+		DWORD cbRun = 0;
+		if (iIn < cbIn)
+			for (cbRun = 1; (iIn + cbRun < cbIn) && (cbRun < 0xFFFF); cbRun++)
+				if (pbIn[iIn + cbRun] != pbIn[iIn])
+					break;
+
+		// Flush pending literals before the fill or at the end of data
+		if ((cbRun >= 4) || (iIn == cbIn)) {
+			while (iLiteral < iIn) {
+				DWORD cbLiteral = MinValue(iIn - iLiteral, 63);
+				pbOut[iOut++] = (BYTE)(0x80 | cbLiteral);
+				CopyMemory(pbOut + iOut, pbIn + iLiteral, cbLiteral);
+				iOut += cbLiteral;
+				iLiteral += cbLiteral;
+			}
+		}
+
+		// End of data
+		if (iIn == cbIn)
+			break;
+
+		// Emit the fill command or keep the byte in the literal run
+		if (cbRun >= 4) {
+			pbOut[iOut++] = 0xFE;
+			PutWord(pbOut + iOut, (WORD)cbRun);
+			iOut += 2;
+			pbOut[iOut++] = pbIn[iIn];
+			iIn += cbRun;
+			iLiteral = iIn;
+		} else
+			iIn++;
+	}
+
+	// End of data marker
+	pbOut[iOut++] = 0x80;
+
+	return iOut;
+}
+
+//==========================================================================
+// VQA streams
+//==========================================================================
+
+#define VQA8_VECTORS	0x0F00	// Indices below the solid color marker
+#define VQA16_VECTORS	0x1000
+
+// Write VQA subchunk (the size is big-endian, data is padded to even size)
+static DWORD PutVQAChunk(BYTE *pb, DWORD dwID, const BYTE *pbData, DWORD cbData)
+{
+	VQA_CHUNK_HEADER header;
+	header.dwID		= dwID;
+	header.cbSize	= SWAPDWORD(cbData);
+	CopyMemory(pb, &header, sizeof(header));
+	CopyMemory(pb + sizeof(header), pbData, cbData);
+	if (cbData % 2)
+		pb[sizeof(header) + cbData++] = 0;
+	return sizeof(header) + cbData;
+}
+
+// Fill the codebook with the blocks of close values (some of them solid)
+static void FillVQACodebook(CGenRandom& rnd, BYTE *pbCodebook, DWORD nVectors, DWORD cbBlock, WORD wMask)
+{
+	for (DWORD i = 0; i < nVectors; i++) {
+		WORD wBase = (WORD)rnd.Next();
+		BOOL bIsSolid = rnd.Chance(25);
+		for (DWORD j = 0; j < cbBlock; j++) {
+			WORD wValue = (wBase + (bIsSolid ? 0 : rnd.Range(8))) & wMask;
+			pbCodebook[j] = LOBYTE(wValue);
+			if (wMask > 0xFF)
+				pbCodebook[++j] = HIBYTE(wValue);
+		}
+		pbCodebook += cbBlock;
+	}
+}
+
+// Number of the parts the refreshed codebook is split into
+static DWORD GetVQACodebookParts(const GEN_PARAMS *pParams)
+{
+	if (pParams->nChurnFrames == 0)
+		return 0;
+	return MinValue(MinValue(pParams->nCodebookParts, pParams->nChurnFrames), 0xFF);
+}
+
+// Put the codebook part for the frame, if any (the parts of the next
+// codebook go in the frames just before the refresh, one per frame, 
+// and the decoder switches to the codebook after the last one). The
+// first part generates the codebook. Returns the chunk size
+static DWORD PutVQACodebookPart(
+	BYTE *pb,
+	CGenRandom& rnd,
+	const GEN_PARAMS *pParams,
+	DWORD iFrame,
+	BYTE *pbCodebook,
+	DWORD nVectors,
+	DWORD cbBlock,
+	WORD wMask,
+	BYTE *pbParts,
+	DWORD *pcbParts
+)
+{
+	DWORD nParts = GetVQACodebookParts(pParams);
+	DWORD iPart = iFrame % pParams->nChurnFrames;
+	if ((nParts == 0) || (iPart < pParams->nChurnFrames - nParts))
+		return 0;
+	iPart -= pParams->nChurnFrames - nParts;
+
+	if (iPart == 0) {
+		DWORD cbCodebook = nVectors * cbBlock;
+		FillVQACodebook(rnd, pbCodebook, nVectors, cbBlock, wMask);
+		if (pParams->bUncompressed) {
+			CopyMemory(pbParts, pbCodebook, cbCodebook);
+			*pcbParts = cbCodebook;
+		} else
+			*pcbParts = EncodeFormat80(pbCodebook, cbCodebook, pbParts);
+	}
+
+	DWORD iStart = *pcbParts * iPart / nParts;
+	DWORD iEnd = *pcbParts * (iPart + 1) / nParts;
+	return PutVQAChunk(
+		pb,
+		(pParams->bUncompressed) ? VQA_ID_CBP0 : VQA_ID_CBPZ,
+		pbParts + iStart,
+		iEnd - iStart
+	);
+}
+
+HRESULT GenerateVQA8Stream(CGenStream *pStream, const GEN_PARAMS *pParams)
+{
+	// Version 2 8-bit video with 4x2 blocks
+	WORD wWidth = (WORD)(MinValue(pParams->dwWidth, 0xFFFC) & ~3);
+	WORD wHeight = (WORD)(MinValue(pParams->dwHeight, 0xFFFE) & ~1);
+	if ((wWidth == 0) || (wHeight == 0))
+		return E_INVALIDARG;
+
+	VQA_INFO info;
+	ZeroMemory(&info, sizeof(info));
+	info.wVersion			= 2;
+	info.nVideoFrames		= (WORD)MinValue(pParams->nFrames, 0xFFFF);
+	info.wVideoWidth		= wWidth;
+	info.wVideoHeight		= wHeight;
+	info.bBlockWidth		= 4;
+	info.bBlockHeight		= 2;
+	info.nFramesPerSecond	= 15;
+	info.nColors			= 256;
+	info.nCBParts			= (BYTE)GetVQACodebookParts(pParams);
+
+	DWORD nBlocks = (wWidth / 4) * (wHeight / 2);
+	info.nMaxBlocks = (WORD)MinValue(nBlocks, 0xFFFF);
+
+	pStream->Free();
+	HRESULT hr = pStream->SetFormat(&info, sizeof(info));
+	if (FAILED(hr))
+		return hr;
+	pStream->SetDimensions(wWidth, wHeight);
+
+	// Allocate work buffers
+	DWORD cbCodebook = VQA8_VECTORS * 8;
+	BYTE *pbCodebook = (BYTE*)malloc(cbCodebook);
+	BYTE *pbVPTR = (BYTE*)malloc(nBlocks * 2);
+	BYTE *pbPacked = (BYTE*)malloc(GetMaxFormat80Size(cbCodebook + nBlocks * 2));
+	BYTE *pbParts = (BYTE*)malloc(GetMaxFormat80Size(cbCodebook));
+	DWORD cbParts = 0;
+	if ((pbCodebook == NULL) || (pbVPTR == NULL) || (pbPacked == NULL) || (pbParts == NULL)) {
+		free(pbCodebook);
+		free(pbVPTR);
+		free(pbPacked);
+		free(pbParts);
+		return E_OUTOFMEMORY;
+	}
+
+	CGenRandom rnd(pParams->dwSeed);
+
+	for (DWORD iFrame = 0; iFrame < pParams->nFrames; iFrame++) {
+
+		DWORD cbMaxBlock =
+			4 * sizeof(VQA_CHUNK_HEADER) + 4 +
+			2 * GetMaxFormat80Size(cbCodebook) +
+			MAX_PALETTE_SIZE +
+			GetMaxFormat80Size(nBlocks * 2);
+		BYTE *pb = pStream->BeginBlock(cbMaxBlock);
+		if (pb == NULL) {
+			hr = E_OUTOFMEMORY;
+			break;
+		}
+		DWORD cb = 0;
+
+		if (iFrame == 0) {
+
+			// The first frame carries the raw codebook and the palette
+			FillVQACodebook(rnd, pbCodebook, VQA8_VECTORS, 8, 0xFF);
+			cb += PutVQAChunk(pb + cb, VQA_ID_CBF0, pbCodebook, cbCodebook);
+
+			BYTE pbPalette[MAX_PALETTE_SIZE];
+			for (int i = 0; i < MAX_PALETTE_SIZE; i++)
+				pbPalette[i] = (BYTE)rnd.Range(64);
+			cb += PutVQAChunk(pb + cb, VQA_ID_CPL0, pbPalette, MAX_PALETTE_SIZE);
+
+		} else if (
+			(pParams->nChurnFrames > 0) &&
+			(iFrame % pParams->nChurnFrames == 0) &&
+			(GetVQACodebookParts(pParams) == 0)
+		) {
+
+			// Periodic codebook refresh
+			FillVQACodebook(rnd, pbCodebook, VQA8_VECTORS, 8, 0xFF);
+			if (pParams->bUncompressed)
+				cb += PutVQAChunk(pb + cb, VQA_ID_CBF0, pbCodebook, cbCodebook);
+			else {
+				DWORD cbPacked = EncodeFormat80(pbCodebook, cbCodebook, pbPacked);
+				cb += PutVQAChunk(pb + cb, VQA_ID_CBFZ, pbPacked, cbPacked);
+			}
+		}
+
+		// Periodic codebook refresh in parts
+		cb += PutVQACodebookPart(pb + cb, rnd, pParams, iFrame, pbCodebook, VQA8_VECTORS, 8, 0xFF, pbParts, &cbParts);
+
+		// Vector pointers: low bytes go first, high bytes follow.
+		// Runs of the same block imitate flat image areas
+		WORD wIndex = 0;
+		DWORD nRun = 0;
+		for (DWORD i = 0; i < nBlocks; i++) {
+			if (nRun == 0) {
+				if (rnd.Chance(10))
+					wIndex = 0x0F00 | (WORD)rnd.Range(256);
+				else
+					wIndex = (WORD)rnd.Range(VQA8_VECTORS);
+				nRun = rnd.Chance(25) ? 4 + rnd.Range(13) : 1;
+			}
+			pbVPTR[i] = LOBYTE(wIndex);
+			pbVPTR[nBlocks + i] = HIBYTE(wIndex);
+			nRun--;
+		}
+		if (pParams->bUncompressed)
+			cb += PutVQAChunk(pb + cb, VQA_ID_VPTR, pbVPTR, nBlocks * 2);
+		else {
+			DWORD cbPacked = EncodeFormat80(pbVPTR, nBlocks * 2, pbPacked);
+			cb += PutVQAChunk(pb + cb, VQA_ID_VPTZ, pbPacked, cbPacked);
+		}
+
+		hr = pStream->EndBlock(cb);
+		if (FAILED(hr))
+			break;
+	}
+
+	free(pbCodebook);
+	free(pbVPTR);
+	free(pbPacked);
+	free(pbParts);
+
+	return hr;
+}
+
+HRESULT GenerateVQA16Stream(CGenStream *pStream, const GEN_PARAMS *pParams)
+{
+	// Version 3 hi-color video with 4x4 blocks
+	WORD wWidth = (WORD)(MinValue(pParams->dwWidth, 0xFFFC) & ~3);
+	WORD wHeight = (WORD)(MinValue(pParams->dwHeight, 0xFFFC) & ~3);
+	if ((wWidth == 0) || (wHeight == 0))
+		return E_INVALIDARG;
+
+	VQA_INFO info;
+	ZeroMemory(&info, sizeof(info));
+	info.wVersion			= 3;
+	info.nVideoFrames		= (WORD)MinValue(pParams->nFrames, 0xFFFF);
+	info.wVideoWidth		= wWidth;
+	info.wVideoHeight		= wHeight;
+	info.bBlockWidth		= 4;
+	info.bBlockHeight		= 4;
+	info.nFramesPerSecond	= 15;
+	info.nColors			= 0;
+	info.wUnknown4			= 4;
+	info.nCBParts			= (BYTE)GetVQACodebookParts(pParams);
+
+	DWORD nBlocks = (wWidth / 4) * (wHeight / 4);
+	info.nMaxBlocks = (WORD)MinValue(nBlocks, 0xFFFF);
+
+	pStream->Free();
+	HRESULT hr = pStream->SetFormat(&info, sizeof(info));
+	if (FAILED(hr))
+		return hr;
+	pStream->SetDimensions(wWidth, wHeight);
+
+	// Allocate work buffers. The commands never take more
+	// than 2 bytes per block (the decoder allows 3)
+	DWORD cbCodebook = VQA16_VECTORS * 32;
+	BYTE *pbCodebook = (BYTE*)malloc(cbCodebook);
+	BYTE *pbVPTR = (BYTE*)malloc(nBlocks * 2 + 2);
+	BYTE *pbPacked = (BYTE*)malloc(GetMaxFormat80Size(cbCodebook + nBlocks * 2 + 2));
+	BYTE *pbParts = (BYTE*)malloc(GetMaxFormat80Size(cbCodebook));
+	DWORD cbParts = 0;
+	if ((pbCodebook == NULL) || (pbVPTR == NULL) || (pbPacked == NULL) || (pbParts == NULL)) {
+		free(pbCodebook);
+		free(pbVPTR);
+		free(pbPacked);
+		free(pbParts);
+		return E_OUTOFMEMORY;
+	}
+
+	CGenRandom rnd(pParams->dwSeed);
+
+	for (DWORD iFrame = 0; iFrame < pParams->nFrames; iFrame++) {
+
+		DWORD cbMaxBlock =
+			3 * sizeof(VQA_CHUNK_HEADER) + 3 +
+			2 * GetMaxFormat80Size(cbCodebook) +
+			GetMaxFormat80Size(nBlocks * 2 + 2);
+		BYTE *pb = pStream->BeginBlock(cbMaxBlock);
+		if (pb == NULL) {
+			hr = E_OUTOFMEMORY;
+			break;
+		}
+		DWORD cb = 0;
+
+		// Codebook in the first frame and periodically after
+		// (unless the refreshed codebooks come in parts)
+		if (
+			(iFrame == 0) ||
+			(
+				(pParams->nChurnFrames > 0) &&
+				(iFrame % pParams->nChurnFrames == 0) &&
+				(GetVQACodebookParts(pParams) == 0)
+			)
+		) {
+			FillVQACodebook(rnd, pbCodebook, VQA16_VECTORS, 32, 0x7FFF);
+			if (pParams->bUncompressed)
+				cb += PutVQAChunk(pb + cb, VQA_ID_CBF0, pbCodebook, cbCodebook);
+			else {
+				DWORD cbPacked = EncodeFormat80(pbCodebook, cbCodebook, pbPacked);
+				cb += PutVQAChunk(pb + cb, VQA_ID_CBFZ, pbPacked, cbPacked);
+			}
+		}
+
+		// Periodic codebook refresh in parts
+		cb += PutVQACodebookPart(pb + cb, rnd, pParams, iFrame, pbCodebook, VQA16_VECTORS, 32, 0x7FFF, pbParts, &cbParts);
+
+		// Block commands covering exactly all the blocks of the frame
+		DWORD cbVPTR = 0;
+		DWORD nLeft = nBlocks;
+		while (nLeft > 0) {
+
+			DWORD nCount, i;
+			DWORD dwType = rnd.Range(10);
+
+			if ((dwType == 0) && (iFrame > 0)) {
+
+				// Skip (keep the previous frame blocks)
+				nCount = 1 + rnd.Range(MinValue(nLeft, 32));
+				PutWord(pbVPTR + cbVPTR, (WORD)((VQA_CODE_SKIP << 13) | nCount));
+				cbVPTR += 2;
+
+			} else if ((dwType <= 2) && (nLeft >= 2)) {
+
+				// Repeat the block (even count)
+				nCount = 1 + rnd.Range(MinValue(nLeft / 2, 32));
+				PutWord(pbVPTR + cbVPTR, (WORD)((VQA_CODE_REPEAT_SHORT << 13) | ((nCount - 1) << 8) | rnd.Range(256)));
+				cbVPTR += 2;
+				nCount *= 2;
+
+			} else if ((dwType <= 5) && (nLeft >= 3)) {
+
+				// The block followed by the array of block indices
+				nCount = 1 + rnd.Range(MinValue((nLeft - 1) / 2, 32));
+				PutWord(pbVPTR + cbVPTR, (WORD)((VQA_CODE_PUT_ARRAY << 13) | ((nCount - 1) << 8) | rnd.Range(256)));
+				cbVPTR += 2;
+				for (i = 0; i < nCount * 2; i++)
+					pbVPTR[cbVPTR++] = (BYTE)rnd.Range(256);
+				nCount = nCount * 2 + 1;
+
+			} else if ((dwType == 6) && (nLeft >= 2)) {
+
+				// Repeat the block (long count)
+				nCount = 2 + rnd.Range(MinValue(nLeft - 1, 254));
+				PutWord(pbVPTR + cbVPTR, (WORD)((VQA_CODE_REPEAT_LONG << 13) | rnd.Range(VQA16_VECTORS)));
+				cbVPTR += 2;
+				pbVPTR[cbVPTR++] = (BYTE)nCount;
+
+			} else {
+
+				// Single block
+				nCount = 1;
+				PutWord(pbVPTR + cbVPTR, (WORD)((VQA_CODE_PUT << 13) | rnd.Range(VQA16_VECTORS)));
+				cbVPTR += 2;
+			}
+
+			nLeft -= nCount;
+		}
+		if (pParams->bUncompressed)
+			cb += PutVQAChunk(pb + cb, VQA_ID_VPTR, pbVPTR, cbVPTR);
+		else {
+			DWORD cbPacked = EncodeFormat80(pbVPTR, cbVPTR, pbPacked);
+			cb += PutVQAChunk(pb + cb, VQA_ID_VPRZ, pbPacked, cbPacked);
+		}
+
+		hr = pStream->EndBlock(cb);
+		if (FAILED(hr))
+			break;
+	}
+
+	free(pbCodebook);
+	free(pbVPTR);
+	free(pbPacked);
+	free(pbParts);
+
+	return hr;
+}
+
+//==========================================================================
+// ROQ stream
+//==========================================================================
+
+#define RoQ_ID_MOT	0x00
+#define RoQ_ID_FCC	0x01
+#define RoQ_ID_SLD	0x02
+#define RoQ_ID_CCC	0x03
+
+// ROQ frame writer state. The 2-bit codes are packed into 16-bit
+// flag words which are placed in the stream right before the data
+// of the first code they carry
+typedef struct tagROQ_WRITER {
+	BYTE	*pbData;		// Frame data
+	DWORD	cbData;			// Frame data size
+	DWORD	iFlags;			// Offset of the current flag word
+	int		nFlagsLeft;		// Free codes in the current flag word
+	WORD	wFlags;			// Current flag word
+} ROQ_WRITER;
+
+static void PutROQCode(ROQ_WRITER *pWriter, int iCode)
+{
+	if (pWriter->nFlagsLeft == 0) {
+		pWriter->iFlags = pWriter->cbData;
+		pWriter->cbData += 2;
+		pWriter->nFlagsLeft = 8;
+		pWriter->wFlags = 0;
+	}
+	pWriter->nFlagsLeft--;
+	pWriter->wFlags |= (WORD)(iCode << (pWriter->nFlagsLeft * 2));
+	PutWord(pWriter->pbData + pWriter->iFlags, pWriter->wFlags);
+}
+
+// Motion vector byte for the block which keeps the source in the frame
+static BYTE GetROQMotion(CGenRandom& rnd, int x, int y, int iSize, int iWidth, int iHeight)
+{
+	int iMinX = (x < 7) ? -x : -7;
+	int iMaxX = (iWidth - iSize - x < 8) ? iWidth - iSize - x : 8;
+	int iMinY = (y < 7) ? -y : -7;
+	int iMaxY = (iHeight - iSize - y < 8) ? iHeight - iSize - y : 8;
+	int dx = iMinX + (int)rnd.Range(iMaxX - iMinX + 1);
+	int dy = iMinY + (int)rnd.Range(iMaxY - iMinY + 1);
+	return (BYTE)(((8 - dx) << 4) | (8 - dy));
+}
+
+HRESULT GenerateROQStream(CGenStream *pStream, const GEN_PARAMS *pParams)
+{
+	// Dimensions are multiples of the macroblock size
+	WORD wWidth = (WORD)(MinValue(pParams->dwWidth, 0xFFF0) & ~15);
+	WORD wHeight = (WORD)(MinValue(pParams->dwHeight, 0xFFF0) & ~15);
+	if ((wWidth == 0) || (wHeight == 0))
+		return E_INVALIDARG;
+
+	ROQ_VIDEO_FORMAT format;
+	format.nFramesPerSecond		= 30;
+	format.wWidth				= wWidth;
+	format.wHeight				= wHeight;
+	format.wBlockDimension		= 8;
+	format.wSubBlockDimension	= 4;
+
+	pStream->Free();
+	HRESULT hr = pStream->SetFormat(&format, sizeof(format));
+	if (FAILED(hr))
+		return hr;
+	pStream->SetDimensions(wWidth, wHeight);
+
+	CGenRandom rnd(pParams->dwSeed);
+
+	// Worst case is 4 subblocks with 4 cells each per 8x8 block
+	// plus the flag words (at most 5 codes per block)
+	DWORD cbMaxFrame = (wWidth / 8) * (wHeight / 8) * 18 + 16;
+
+	for (DWORD iFrame = 0; iFrame < pParams->nFrames; iFrame++) {
+
+		ROQ_CHUNK_HEADER header;
+		BYTE *pb;
+
+		// Codebook in the first frame and periodically after
+		if (
+			(iFrame == 0) ||
+			((pParams->nChurnFrames > 0) && (iFrame % pParams->nChurnFrames == 0))
+		) {
+			DWORD cbCodebook = 256 * sizeof(ROQ_CELL) + 256 * sizeof(ROQ_QCELL);
+			pb = pStream->BeginBlock(sizeof(header) + cbCodebook);
+			if (pb == NULL)
+				return E_OUTOFMEMORY;
+
+			header.wID			= ROQ_CHUNK_VIDEO_CODEBOOK;
+			header.cbSize		= cbCodebook;
+			header.wArgument	= 0; // 256 cells and 256 quad cells
+			CopyMemory(pb, &header, sizeof(header));
+
+			BYTE *pbCells = pb + sizeof(header);
+			for (int i = 0; i < 256; i++) {
+				BYTE bBase = (BYTE)rnd.Range(224);
+				for (int j = 0; j < 4; j++)
+					*pbCells++ = bBase + (BYTE)rnd.Range(32);
+				*pbCells++ = (BYTE)(112 + rnd.Range(32));
+				*pbCells++ = (BYTE)(112 + rnd.Range(32));
+			}
+			for (int i = 0; i < 256 * 4; i++)
+				*pbCells++ = (BYTE)rnd.Range(256);
+
+			hr = pStream->EndBlock(sizeof(header) + cbCodebook);
+			if (FAILED(hr))
+				return hr;
+		}
+
+		pb = pStream->BeginBlock(sizeof(header) + cbMaxFrame);
+		if (pb == NULL)
+			return E_OUTOFMEMORY;
+
+		ROQ_WRITER writer;
+		writer.pbData		= pb + sizeof(header);
+		writer.cbData		= 0;
+		writer.iFlags		= 0;
+		writer.nFlagsLeft	= 0;
+		writer.wFlags		= 0;
+
+		// Macroblocks in raster order, 8x8 blocks within them
+		for (int ypos = 0; ypos < wHeight; ypos += 16)
+			for (int xpos = 0; xpos < wWidth; xpos += 16)
+				for (int yp = ypos; yp < ypos + 16; yp += 8)
+					for (int xp = xpos; xp < xpos + 16; xp += 8) {
+
+						DWORD dwType = rnd.Range(100);
+						if (dwType < 25)
+							PutROQCode(&writer, RoQ_ID_MOT);
+						else if (dwType < 45) {
+							PutROQCode(&writer, RoQ_ID_FCC);
+							writer.pbData[writer.cbData++] = GetROQMotion(rnd, xp, yp, 8, wWidth, wHeight);
+						} else if (dwType < 75) {
+							PutROQCode(&writer, RoQ_ID_SLD);
+							writer.pbData[writer.cbData++] = (BYTE)rnd.Range(256);
+						} else {
+							PutROQCode(&writer, RoQ_ID_CCC);
+							for (int k = 0; k < 4; k++) {
+								int x = xp + ((k & 1) ? 4 : 0);
+								int y = yp + ((k & 2) ? 4 : 0);
+								dwType = rnd.Range(100);
+								if (dwType < 20)
+									PutROQCode(&writer, RoQ_ID_MOT);
+								else if (dwType < 40) {
+									PutROQCode(&writer, RoQ_ID_FCC);
+									writer.pbData[writer.cbData++] = GetROQMotion(rnd, x, y, 4, wWidth, wHeight);
+								} else if (dwType < 70) {
+									PutROQCode(&writer, RoQ_ID_SLD);
+									writer.pbData[writer.cbData++] = (BYTE)rnd.Range(256);
+								} else {
+									PutROQCode(&writer, RoQ_ID_CCC);
+									for (int i = 0; i < 4; i++)
+										writer.pbData[writer.cbData++] = (BYTE)rnd.Range(256);
+								}
+							}
+						}
+					}
+
+		header.wID			= ROQ_CHUNK_VIDEO_FRAME;
+		header.cbSize		= writer.cbData;
+		header.wArgument	= 0; // Zero mean motion
+		CopyMemory(pb, &header, sizeof(header));
+
+		hr = pStream->EndBlock(sizeof(header) + writer.cbData);
+		if (FAILED(hr))
+			return hr;
+	}
+
+	return NOERROR;
+}
+
+//==========================================================================
+// MVE streams
+//==========================================================================
+
+// Largest frame data that fits in the data subchunk along with the
+// video header (the chunk also holds the end subchunk)
+#define MVE_MAX_FRAME_DATA (0xFFFF - 2 * sizeof(MVE_CHUNK_HEADER) - sizeof(MVE_VIDEO_HEADER))
+
+// Put MVE subchunk type/subtype bytes
+static DWORD PutMVESubchunk(BYTE *pb, BYTE bType)
+{
+	pb[0] = bType;
+	pb[1] = 0;
+	return 2;
+}
+
+// Generate MVE stream. The opcodes used are the ones which do not need
+// the motion search: previous frame copy, no change, close motion,
+// two-color pattern, raw, 2x2 and 4x4 subsampled, solid and dither
+static HRESULT GenerateMVEStream(CGenStream *pStream, const GEN_PARAMS *pParams, BOOL bIsHiColor)
+{
+	// Width is a multiple of two blocks (a map byte covers two blocks)
+	WORD wWidth = (WORD)(MinValue(pParams->dwWidth, 0x7FF0) & ~15);
+	WORD wHeight = (WORD)(MinValue(pParams->dwHeight, 0x7FF8) & ~7);
+	if ((wWidth == 0) || (wHeight == 0))
+		return E_INVALIDARG;
+
+	MVE_VIDEO_INFO info;
+	info.wWidth		= wWidth / 8;
+	info.wHeight	= wHeight / 8;
+	info.nBuffers	= 1;
+	info.wHiColor	= (bIsHiColor) ? 1 : 0;
+
+	pStream->Free();
+	HRESULT hr = pStream->SetFormat(&info, sizeof(info));
+	if (FAILED(hr))
+		return hr;
+	pStream->SetDimensions(wWidth, wHeight);
+
+	DWORD nBlocksX = info.wWidth, nBlocksY = info.wHeight;
+	DWORD nBlocks = nBlocksX * nBlocksY;
+	DWORD cbMap = nBlocks / 2;
+	WORD cbPixel = (bIsHiColor) ? 2 : 1;
+
+	// Allocate work buffers: the map, the opcode data and the second
+	// data stream (hi-color motion bytes go there)
+	DWORD cbMaxData = 2 + nBlocks * (64 * cbPixel + 2);
+	BYTE *pbMap = (BYTE*)malloc(cbMap);
+	BYTE *pbData = (BYTE*)malloc(cbMaxData);
+	BYTE *pbOffData = (BYTE*)malloc(nBlocks);
+	if ((pbMap == NULL) || (pbData == NULL) || (pbOffData == NULL)) {
+		free(pbMap);
+		free(pbData);
+		free(pbOffData);
+		return E_OUTOFMEMORY;
+	}
+
+	CGenRandom rnd(pParams->dwSeed);
+
+	for (DWORD iFrame = 0; iFrame < pParams->nFrames; iFrame++) {
+
+		static const BYTE pbOpcodes[] = {
+			0x0, 0x1, 0x4, 0x7, 0x7, 0xB, 0xC, 0xD, 0xE, 0xE, 0xF
+		};
+		static const DWORD pnRawPixels[] = { 64, 16, 4, 1, 2 };
+
+		BYTE *pb;
+		DWORD cb, i, j;
+
+		// Palette in the first frame (8-bit video only)
+		if ((iFrame == 0) && (!bIsHiColor)) {
+			pb = pStream->BeginBlock(2 + sizeof(MVE_PALETTE_HEADER) + 3 * 256);
+			if (pb == NULL) {
+				hr = E_OUTOFMEMORY;
+				break;
+			}
+			cb = PutMVESubchunk(pb, MVE_SUBCHUNK_PALETTE);
+			MVE_PALETTE_HEADER palette;
+			palette.iStart		= 0;
+			palette.nEntries	= 256;
+			CopyMemory(pb + cb, &palette, sizeof(palette));
+			cb += sizeof(palette);
+			for (i = 0; i < 3 * 256; i++)
+				pb[cb++] = (BYTE)rnd.Range(64);
+			hr = pStream->EndBlock(cb);
+			if (FAILED(hr))
+				break;
+		}
+
+		// Choose the opcodes and emit their data. The data subchunk size
+		// is 16-bit (as is the hi-color second stream offset the data
+		// starts with), so large frames run out of space and fall back
+		// to no change
+		ZeroMemory(pbMap, cbMap);
+		DWORD cbData = (bIsHiColor) ? 2 : 0, cbOffData = 0;
+
+		for (i = 0; i < nBlocks; i++) {
+
+			DWORD x = i % nBlocksX, y = i / nBlocksX;
+			BYTE bOpcode = pbOpcodes[rnd.Range(sizeof(pbOpcodes))];
+
+			// Close motion source should be within the frame
+			if (
+				(bOpcode == 0x4) &&
+				((x == 0) || (y == 0) || (x == nBlocksX - 1) || (y == nBlocksY - 1))
+			)
+				bOpcode = 0xE;
+			if (cbData + cbOffData + 64 * cbPixel + 2 > MVE_MAX_FRAME_DATA)
+				bOpcode = 0x1;
+
+			switch (bOpcode) {
+
+				case 0x4:
+					// Close motion from the previous frame
+					if (bIsHiColor)
+						pbOffData[cbOffData++] = (BYTE)rnd.Range(256);
+					else
+						pbData[cbData++] = (BYTE)rnd.Range(256);
+					break;
+
+				case 0x7:
+					// Two-color pattern (per pixel or per 2x2)
+					if (bIsHiColor) {
+						WORD wP0 = (WORD)rnd.Next();
+						PutWord(pbData + cbData, wP0);
+						PutWord(pbData + cbData + 2, (WORD)(rnd.Next() & 0x7FFF));
+						cbData += 4;
+						for (j = 0; j < ((wP0 & 0x8000) ? 2u : 8u); j++)
+							pbData[cbData++] = (BYTE)rnd.Range(256);
+					} else {
+						BYTE bP0 = (BYTE)rnd.Range(256), bP1 = (BYTE)rnd.Range(256);
+						pbData[cbData++] = bP0;
+						pbData[cbData++] = bP1;
+						for (j = 0; j < ((bP0 <= bP1) ? 8u : 2u); j++)
+							pbData[cbData++] = (BYTE)rnd.Range(256);
+					}
+					break;
+
+				case 0xB:
+				case 0xC:
+				case 0xD:
+				case 0xE:
+				case 0xF:
+					// Raw pixels: 64, 16 (2x2), 4 (4x4), 1 (solid) and 2 (dither)
+					for (j = 0; j < pnRawPixels[bOpcode - 0xB] * cbPixel; j++)
+						pbData[cbData++] = (BYTE)rnd.Range(((bIsHiColor) && (j % 2)) ? 128 : 256);
+					break;
+
+				default:
+					// No data for the copy opcodes
+					break;
+			}
+
+			pbMap[i / 2] |= (i % 2) ? (bOpcode << 4) : bOpcode;
+		}
+
+		// Hi-color: the second stream goes after the first one
+		if (bIsHiColor) {
+			PutWord(pbData, (WORD)cbData);
+			CopyMemory(pbData + cbData, pbOffData, cbOffData);
+			cbData += cbOffData;
+		}
+
+		// Video map
+		pb = pStream->BeginBlock(2 + cbMap);
+		if (pb == NULL) {
+			hr = E_OUTOFMEMORY;
+			break;
+		}
+		cb = PutMVESubchunk(pb, MVE_SUBCHUNK_VIDEOMAP);
+		CopyMemory(pb + cb, pbMap, cbMap);
+		hr = pStream->EndBlock(cb + cbMap);
+		if (FAILED(hr))
+			break;
+
+		// Video data
+		pb = pStream->BeginBlock(2 + sizeof(MVE_VIDEO_HEADER) + cbData);
+		if (pb == NULL) {
+			hr = E_OUTOFMEMORY;
+			break;
+		}
+		cb = PutMVESubchunk(pb, MVE_SUBCHUNK_VIDEODATA);
+		MVE_VIDEO_HEADER header;
+		ZeroMemory(&header, sizeof(header));
+		header.wXSize	= info.wWidth;
+		header.wYSize	= info.wHeight;
+		header.wFlags	= 1; // Swap the buffers
+		CopyMemory(pb + cb, &header, sizeof(header));
+		cb += sizeof(header);
+		CopyMemory(pb + cb, pbData, cbData);
+		hr = pStream->EndBlock(cb + cbData);
+		if (FAILED(hr))
+			break;
+
+		// Send buffer command
+		pb = pStream->BeginBlock(2 + sizeof(MVE_VIDEO_CMD));
+		if (pb == NULL) {
+			hr = E_OUTOFMEMORY;
+			break;
+		}
+		cb = PutMVESubchunk(pb, MVE_SUBCHUNK_VIDEOCMD);
+		MVE_VIDEO_CMD cmd;
+		cmd.iPaletteStart	= 0;
+		cmd.nPaletteEntries	= 0;
+		cmd.wUnknown		= 0;
+		CopyMemory(pb + cb, &cmd, sizeof(cmd));
+		hr = pStream->EndBlock(cb + sizeof(cmd));
+		if (FAILED(hr))
+			break;
+	}
+
+	free(pbMap);
+	free(pbData);
+	free(pbOffData);
+
+	return hr;
+}
+
+HRESULT GenerateMVE8Stream(CGenStream *pStream, const GEN_PARAMS *pParams)
+{
+	return GenerateMVEStream(pStream, pParams, FALSE);
+}
+
+HRESULT GenerateMVE16Stream(CGenStream *pStream, const GEN_PARAMS *pParams)
+{
+	return GenerateMVEStream(pStream, pParams, TRUE);
+}
+
+//==========================================================================
+// CIN stream
+//==========================================================================
+
+// Huffman tree node (the same layout as the decoder builds)
+typedef struct tagGEN_HUFFMAN_NODE {
+	int		iCount;
+	BOOL	bUsed;
+	int		iChildren[2];
+} GEN_HUFFMAN_NODE;
+
+// Huffman code (bits are stored in the order they are read)
+typedef struct tagGEN_HUFFMAN_CODE {
+	DWORD	dwBits;
+	int		nBits;
+} GEN_HUFFMAN_CODE;
+
+// Find the lowest count unused node (exactly as the decoder does)
+static int HuffmanSmallestNode(GEN_HUFFMAN_NODE *pNodes, int nNodes)
+{
+	int iBest = 99999999, iBestNode = -1;
+	for (int i = 0; i < nNodes; i++) {
+		if (pNodes[i].bUsed || (pNodes[i].iCount == 0))
+			continue;
+		if (pNodes[i].iCount < iBest) {
+			iBest = pNodes[i].iCount;
+			iBestNode = i;
+		}
+	}
+	if (iBestNode == -1)
+		return -1;
+	pNodes[iBestNode].bUsed = TRUE;
+	return iBestNode;
+}
+
+// Assign the codes walking the tree from the specified node
+static void HuffmanAssignCodes(
+	const GEN_HUFFMAN_NODE *pNodes,
+	int iNode,
+	DWORD dwBits,
+	int nBits,
+	GEN_HUFFMAN_CODE *pCodes
+)
+{
+	if (iNode < HUFFMAN_TOKENS) {
+		pCodes[iNode].dwBits = dwBits;
+		pCodes[iNode].nBits = nBits;
+		return;
+	}
+	ASSERT(nBits < 32);
+	HuffmanAssignCodes(pNodes, pNodes[iNode].iChildren[0], dwBits, nBits + 1, pCodes);
+	HuffmanAssignCodes(pNodes, pNodes[iNode].iChildren[1], dwBits | ((DWORD)1 << nBits), nBits + 1, pCodes);
+}
+
+// Build the Huffman codes for the context from the counts table row
+static void HuffmanBuildCodes(const BYTE *pbCounts, GEN_HUFFMAN_CODE *pCodes)
+{
+	GEN_HUFFMAN_NODE nodes[HUFFMAN_TOKENS * 2];
+	int nNodes = HUFFMAN_TOKENS;
+
+	for (int i = 0; i < HUFFMAN_TOKENS * 2; i++) {
+		nodes[i].iCount = (i < HUFFMAN_TOKENS) ? pbCounts[i] : 0;
+		nodes[i].bUsed = FALSE;
+	}
+
+	for (;;) {
+		GEN_HUFFMAN_NODE *pNode = &nodes[nNodes];
+		pNode->iChildren[0] = HuffmanSmallestNode(nodes, nNodes);
+		if (pNode->iChildren[0] == -1)
+			break;
+		pNode->iChildren[1] = HuffmanSmallestNode(nodes, nNodes);
+		if (pNode->iChildren[1] == -1)
+			break;
+		pNode->iCount = nodes[pNode->iChildren[0]].iCount + nodes[pNode->iChildren[1]].iCount;
+		nNodes++;
+	}
+
+	ZeroMemory(pCodes, HUFFMAN_TOKENS * sizeof(GEN_HUFFMAN_CODE));
+	HuffmanAssignCodes(nodes, nNodes - 1, 0, 0, pCodes);
+}
+
+HRESULT GenerateCINStream(CGenStream *pStream, const GEN_PARAMS *pParams)
+{
+	DWORD dwWidth = pParams->dwWidth, dwHeight = pParams->dwHeight;
+	if ((dwWidth == 0) || (dwHeight == 0))
+		return E_INVALIDARG;
+
+	// The header is too large for the stack
+	CIN_HEADER *pHeader = (CIN_HEADER*)malloc(sizeof(CIN_HEADER));
+	GEN_HUFFMAN_CODE *pCodes = (GEN_HUFFMAN_CODE*)malloc(256 * HUFFMAN_TOKENS * sizeof(GEN_HUFFMAN_CODE));
+	if ((pHeader == NULL) || (pCodes == NULL)) {
+		free(pHeader);
+		free(pCodes);
+		return E_OUTOFMEMORY;
+	}
+
+	ZeroMemory(pHeader, sizeof(CIN_HEADER));
+	pHeader->dwVideoWidth		= dwWidth;
+	pHeader->dwVideoHeight		= dwHeight;
+	pHeader->dwAudioSampleRate	= 22050;
+	pHeader->dwAudioSampleWidth	= 2;
+	pHeader->nAudioChannels		= 1;
+
+	// The symbols close to the previous one are the most probable
+	for (int iPrev = 0; iPrev < 256; iPrev++) {
+		for (int i = 0; i < HUFFMAN_TOKENS; i++) {
+			int iDelta = (BYTE)(i - iPrev);
+			if (iDelta > 128)
+				iDelta = 256 - iDelta;
+			pHeader->bHuffmanTable[iPrev][i] = (iDelta < 16) ? (BYTE)(255 >> (iDelta / 2)) : 1;
+		}
+		HuffmanBuildCodes(pHeader->bHuffmanTable[iPrev], pCodes + iPrev * HUFFMAN_TOKENS);
+	}
+
+	pStream->Free();
+	HRESULT hr = pStream->SetFormat(pHeader, sizeof(CIN_HEADER));
+	free(pHeader);
+	if (FAILED(hr)) {
+		free(pCodes);
+		return hr;
+	}
+	pStream->SetDimensions(dwWidth, dwHeight);
+
+	CGenRandom rnd(pParams->dwSeed);
+
+	DWORD nPixels = dwWidth * dwHeight;
+	for (DWORD iFrame = 0; iFrame < pParams->nFrames; iFrame++) {
+
+		// Each symbol takes 32 bits at most
+		BYTE *pb = pStream->BeginBlock(4 + 3 * 256 + 4 + nPixels * 4 + 1);
+		if (pb == NULL) {
+			hr = E_OUTOFMEMORY;
+			break;
+		}
+		DWORD cb = 0;
+
+		// Palette in the first frame and periodically after
+		if (
+			(iFrame == 0) ||
+			((pParams->nChurnFrames > 0) && (iFrame % pParams->nChurnFrames == 0))
+		) {
+			PutDword(pb, CIN_COMMAND_PALETTE);
+			cb += 4;
+			for (int i = 0; i < 3 * 256; i++)
+				pb[cb++] = (BYTE)rnd.Range(256);
+		} else {
+			PutDword(pb, 0);
+			cb += 4;
+		}
+
+		// Decoded data length
+		PutDword(pb + cb, nPixels);
+		cb += 4;
+
+		// Smooth image with some noise, the bits are written LSB first
+		BYTE bPrev = 0;
+		DWORD dwAccum = 0;
+		int nAccumBits = 0;
+		for (DWORD i = 0; i < nPixels; i++) {
+			BYTE bPixel = (rnd.Chance(5)) ? (BYTE)rnd.Range(256) : (BYTE)(bPrev + rnd.Range(7) - 3);
+			const GEN_HUFFMAN_CODE *pCode = pCodes + bPrev * HUFFMAN_TOKENS + bPixel;
+			for (int j = 0; j < pCode->nBits; j++) {
+				dwAccum |= ((pCode->dwBits >> j) & 1) << nAccumBits;
+				if (++nAccumBits == 8) {
+					pb[cb++] = (BYTE)dwAccum;
+					dwAccum = 0;
+					nAccumBits = 0;
+				}
+			}
+			bPrev = bPixel;
+		}
+		if (nAccumBits > 0)
+			pb[cb++] = (BYTE)dwAccum;
+
+		hr = pStream->EndBlock(cb);
+		if (FAILED(hr))
+			break;
+	}
+
+	free(pCodes);
+
+	return hr;
+}
+
+//==========================================================================
+// ADPCM streams (random data is a valid input for these decoders)
+//==========================================================================
+
+// Generate the audio stream of random blocks with the specified header size
+static HRESULT GenerateRandomAudioStream(
+	CGenStream *pStream,
+	const GEN_PARAMS *pParams,
+	const void *pFormat,
+	DWORD cbFormat,
+	DWORD cbHeader
+)
+{
+	pStream->Free();
+	HRESULT hr = pStream->SetFormat(pFormat, cbFormat);
+	if (FAILED(hr))
+		return hr;
+
+	CGenRandom rnd(pParams->dwSeed);
+
+	for (DWORD iBlock = 0; iBlock < pParams->nFrames; iBlock++) {
+		DWORD cbBlock = cbHeader + pParams->cbAudioBlock;
+		BYTE *pb = pStream->BeginBlock(cbBlock);
+		if (pb == NULL)
+			return E_OUTOFMEMORY;
+		for (DWORD i = 0; i < cbBlock; i++)
+			pb[i] = (BYTE)rnd.Range(256);
+		hr = pStream->EndBlock(cbBlock);
+		if (FAILED(hr))
+			return hr;
+	}
+
+	return NOERROR;
+}
+
+HRESULT GenerateCIMAADPCMStream(CGenStream *pStream, const GEN_PARAMS *pParams)
+{
+	// Stereo format block with both channels initial values
+	BYTE pbFormat[sizeof(CIMAADPCMWAVEFORMAT) + sizeof(CIMAADPCMINFO)];
+	ZeroMemory(pbFormat, sizeof(pbFormat));
+	CIMAADPCMWAVEFORMAT *pFormat = (CIMAADPCMWAVEFORMAT*)pbFormat;
+	pFormat->nChannels			= 2;
+	pFormat->nSamplesPerSec		= 22050;
+	pFormat->wBitsPerSample		= 16;
+	pFormat->bIsHiNibbleFirst	= FALSE;
+
+	return GenerateRandomAudioStream(pStream, pParams, pbFormat, sizeof(pbFormat), 0);
+}
+
+HRESULT GenerateROQADPCMStream(CGenStream *pStream, const GEN_PARAMS *pParams)
+{
+	ROQADPCMWAVEFORMAT format;
+	format.nChannels		= 2;
+	format.nSamplesPerSec	= ROQ_SAMPLE_RATE;
+	format.wBitsPerSample	= ROQ_SAMPLE_BITS;
+
+	// Each block starts with the initial prediction word
+	return GenerateRandomAudioStream(pStream, pParams, &format, sizeof(format), sizeof(WORD));
+}
+
+HRESULT GenerateMVEADPCMStream(CGenStream *pStream, const GEN_PARAMS *pParams)
+{
+	MVE_AUDIO_INFO info;
+	ZeroMemory(&info, sizeof(info));
+	info.wFlags			= MVE_AUDIO_STEREO | MVE_AUDIO_16BIT | MVE_AUDIO_COMPRESSED;
+	info.wSampleRate	= 22050;
+	info.cbBufferV0		= (WORD)MinValue(pParams->cbAudioBlock * 2, 0xFFFF);
+
+	// Each block starts with the initial sample values for both channels
+	return GenerateRandomAudioStream(pStream, pParams, &info, sizeof(info), 2 * sizeof(SHORT));
+}
+
+HRESULT GenerateWSADPCMStream(CGenStream *pStream, const GEN_PARAMS *pParams)
+{
+	WSADPCMWAVEFORMAT format;
+	format.nChannels		= 1;
+	format.nSamplesPerSec	= 22050;
+	format.wBitsPerSample	= 8;
+
+	pStream->Free();
+	HRESULT hr = pStream->SetFormat(&format, sizeof(format));
+	if (FAILED(hr))
+		return hr;
+
+	CGenRandom rnd(pParams->dwSeed);
+
+	// The output size is 16-bit, so 2-bit codes (4 samples per byte)
+	// limit the compressed block size
+	DWORD cbMaxIn = MinValue(pParams->cbAudioBlock, 0x3FFF - 64);
+
+	for (DWORD iBlock = 0; iBlock < pParams->nFrames; iBlock++) {
+
+		BYTE *pb = pStream->BeginBlock(sizeof(WSADPCMINFO) + cbMaxIn + 65);
+		if (pb == NULL)
+			return E_OUTOFMEMORY;
+		BYTE *pbCodes = pb + sizeof(WSADPCMINFO);
+		DWORD cbIn = 0, cbOut = 0;
+
+		// Runs of 4-bit and 2-bit codes
+		while (cbIn < cbMaxIn) {
+			DWORD nCount = 1 + rnd.Range(64);
+			BOOL bIs4Bit = rnd.Chance(50);
+			pbCodes[cbIn++] = (BYTE)(((bIs4Bit) ? 0x40 : 0x00) | (nCount - 1));
+			for (DWORD i = 0; i < nCount; i++)
+				pbCodes[cbIn++] = (BYTE)rnd.Range(256);
+			cbOut += nCount * ((bIs4Bit) ? 2 : 4);
+		}
+
+		WSADPCMINFO info;
+		info.wOutSize	= (WORD)cbOut;
+		info.wInSize	= (WORD)cbIn;
+		CopyMemory(pb, &info, sizeof(info));
+
+		hr = pStream->EndBlock(sizeof(WSADPCMINFO) + cbIn);
+		if (FAILED(hr))
+			return hr;
+	}
+
+	return NOERROR;
+}
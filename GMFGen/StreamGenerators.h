@@ -0,0 +1,144 @@
+//==========================================================================
+//
+// File: StreamGenerators.h
+//
+// Desc: Game Media Formats - Header file for synthetic stream generators
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#ifndef __GMF_STREAM_GENERATORS_H__
+#define __GMF_STREAM_GENERATORS_H__
+
+#include "CodecTypes.h"
+
+//==========================================================================
+// Synthetic stream parameters
+//==========================================================================
+
+typedef struct tagGEN_PARAMS {
+	DWORD	dwWidth;		// Requested frame width (video only)
+	DWORD	dwHeight;		// Requested frame height (video only)
+	DWORD	nFrames;		// Number of frames (or audio blocks)
+	DWORD	nChurnFrames;	// Codebook/palette refresh period (frames)
+	DWORD	cbAudioBlock;	// Compressed audio block size
+	DWORD	dwSeed;			// Random generator seed
+	BOOL	bUncompressed;	// Store VQA codebooks and vector pointers as is
+	DWORD	nCodebookParts;	// Parts of the refreshed VQA codebook (0: in one chunk)
+} GEN_PARAMS;
+
+//==========================================================================
+// Deterministic random number generator (the same sequence on every
+// platform, so that the streams are reproducible between runs)
+//==========================================================================
+
+class CGenRandom {
+
+	DWORD m_dwState;
+
+public:
+
+	CGenRandom(DWORD dwSeed) : m_dwState(dwSeed) {}
+
+	// Next 16-bit random value
+	DWORD Next(void) {
+		m_dwState = m_dwState * 1103515245 + 12345;
+		return (m_dwState >> 16) & 0xFFFF;
+	};
+
+	// Random value in range [0, dwRange)
+	DWORD Range(DWORD dwRange) {
+		return (dwRange > 0) ? ((Next() << 16 | Next()) % dwRange) : 0;
+	};
+
+	// TRUE with the probability of nPercent / 100
+	BOOL Chance(DWORD nPercent) { return Range(100) < nPercent; };
+};
+
+//==========================================================================
+// Synthetic stream class. The stream consists of the format block and
+// the sequence of data blocks exactly as a splitter would deliver them
+// to the decompressor (so that the decoder gets one block per Decode()).
+// The stream writers wrap the blocks back into the container files
+//==========================================================================
+
+class CGenStream {
+
+	BYTE	*m_pbFormat;	// Format block
+	DWORD	m_cbFormat;		// Format block size
+
+	BYTE	*m_pbData;		// All data blocks stored back to back
+	DWORD	m_cbData;		// Total size of the data blocks
+	DWORD	m_cbMaxData;	// Allocated size of the data storage
+
+	DWORD	*m_pdwOffsets;	// Data block start offsets (one extra at the end)
+	DWORD	m_nBlocks;		// Number of data blocks
+	DWORD	m_nMaxBlocks;	// Allocated size of the offsets table
+
+	DWORD	m_dwWidth;		// Actual frame width (0 for audio)
+	DWORD	m_dwHeight;		// Actual frame height (0 for audio)
+
+public:
+
+	// Constructor/destructor
+	CGenStream();
+	~CGenStream();
+
+	// Release all the stream data
+	void Free(void);
+
+	// Stream building methods
+	HRESULT SetFormat(const void *pFormat, DWORD cbFormat);
+	void SetDimensions(DWORD dwWidth, DWORD dwHeight) {
+		m_dwWidth	= dwWidth;
+		m_dwHeight	= dwHeight;
+	};
+	BYTE* BeginBlock(DWORD cbMaxBlock);
+	HRESULT EndBlock(DWORD cbBlock);
+
+	// Stream access methods
+	const BYTE* GetFormat(void) const { return m_pbFormat; };
+	DWORD GetFormatSize(void) const { return m_cbFormat; };
+	DWORD GetWidth(void) const { return m_dwWidth; };
+	DWORD GetHeight(void) const { return m_dwHeight; };
+	DWORD GetBlockCount(void) const { return m_nBlocks; };
+	DWORD GetDataSize(void) const { return m_cbData; };
+	const BYTE* GetBlock(DWORD iBlock) const { return m_pbData + m_pdwOffsets[iBlock]; };
+	DWORD GetBlockSize(DWORD iBlock) const {
+		return m_pdwOffsets[iBlock + 1] - m_pdwOffsets[iBlock];
+	};
+};
+
+//==========================================================================
+// Stream generators. Each generator produces a valid stream for the
+// corresponding decoder; video dimensions are rounded down to the codec
+// block size (the actual values are stored in the stream)
+//==========================================================================
+
+HRESULT GenerateVQA8Stream(CGenStream *pStream, const GEN_PARAMS *pParams);
+HRESULT GenerateVQA16Stream(CGenStream *pStream, const GEN_PARAMS *pParams);
+HRESULT GenerateROQStream(CGenStream *pStream, const GEN_PARAMS *pParams);
+HRESULT GenerateMVE8Stream(CGenStream *pStream, const GEN_PARAMS *pParams);
+HRESULT GenerateMVE16Stream(CGenStream *pStream, const GEN_PARAMS *pParams);
+HRESULT GenerateCINStream(CGenStream *pStream, const GEN_PARAMS *pParams);
+HRESULT GenerateCIMAADPCMStream(CGenStream *pStream, const GEN_PARAMS *pParams);
+HRESULT GenerateROQADPCMStream(CGenStream *pStream, const GEN_PARAMS *pParams);
+HRESULT GenerateMVEADPCMStream(CGenStream *pStream, const GEN_PARAMS *pParams);
+HRESULT GenerateWSADPCMStream(CGenStream *pStream, const GEN_PARAMS *pParams);
+
+#endif
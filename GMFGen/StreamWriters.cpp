@@ -0,0 +1,423 @@
+//==========================================================================
+//
+// File: StreamWriters.cpp
+//
+// Desc: Game Media Formats - Implementation of synthetic stream file writers
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#include <stdio.h>
+
+#include "StreamWriters.h"
+#include "VQASpecs.h"
+#include "ROQSpecs.h"
+#include "MVESpecs.h"
+#include "CINSpecs.h"
+
+//==========================================================================
+// File helpers
+//==========================================================================
+
+static HRESULT WriteData(FILE *pFile, const void *pData, DWORD cbData)
+{
+	if (cbData == 0)
+		return S_OK;
+	return (fwrite(pData, 1, cbData, pFile) == cbData) ? S_OK : E_FAIL;
+}
+
+static HRESULT WriteDword(FILE *pFile, DWORD dwValue)
+{
+	BYTE pb[4];
+	pb[0] = (BYTE)dwValue;
+	pb[1] = (BYTE)(dwValue >> 8);
+	pb[2] = (BYTE)(dwValue >> 16);
+	pb[3] = (BYTE)(dwValue >> 24);
+	return WriteData(pFile, pb, 4);
+}
+
+// Close the file and remove it if it has not been written completely
+static HRESULT CloseFile(FILE *pFile, const char *pszFileName, HRESULT hr)
+{
+	if ((fclose(pFile) != 0) && SUCCEEDED(hr))
+		hr = E_FAIL;
+	if (FAILED(hr))
+		remove(pszFileName);
+	return hr;
+}
+
+//==========================================================================
+// VQA file
+//==========================================================================
+
+// Check if the frame data contains the subchunk with the given ID
+static BOOL HasVQASubchunk(const BYTE *pbData, DWORD cbData, DWORD dwID)
+{
+	while (cbData >= sizeof(VQA_CHUNK_HEADER)) {
+
+		const VQA_CHUNK_HEADER *pHeader = (const VQA_CHUNK_HEADER*)pbData;
+		if (pHeader->dwID == dwID)
+			return TRUE;
+
+		DWORD cbChunk = sizeof(VQA_CHUNK_HEADER) + SWAPDWORD(pHeader->cbSize);
+		cbChunk += cbChunk & 1;
+		if (cbChunk > cbData)
+			break;
+
+		pbData += cbChunk;
+		cbData -= cbChunk;
+	}
+
+	return FALSE;
+}
+
+HRESULT WriteVQAFile(const CGenStream *pStream, const char *pszFileName)
+{
+	DWORD nFrames = pStream->GetBlockCount();
+	if ((pStream->GetFormatSize() < sizeof(VQA_INFO)) || (nFrames == 0))
+		return E_INVALIDARG;
+
+	DWORD *pdwFrameTable = (DWORD*)malloc(nFrames * sizeof(DWORD));
+	if (pdwFrameTable == NULL)
+		return E_OUTOFMEMORY;
+
+	// Frame positions are stored halved, the frames carrying
+	// the palette are marked (the splitter seeks to them first)
+	LONGLONG llPos =
+		sizeof(VQA_FILE_HEADER) +
+		sizeof(VQA_CHUNK_HEADER) + sizeof(VQA_INFO) +
+		sizeof(VQA_CHUNK_HEADER) + nFrames * sizeof(DWORD);
+	for (DWORD iFrame = 0; iFrame < nFrames; iFrame++) {
+
+		const BYTE *pbFrame = pStream->GetBlock(iFrame);
+		DWORD cbFrame = pStream->GetBlockSize(iFrame);
+
+		pdwFrameTable[iFrame] = (DWORD)(llPos / 2);
+		if (
+			HasVQASubchunk(pbFrame, cbFrame, VQA_ID_CPL0) ||
+			HasVQASubchunk(pbFrame, cbFrame, VQA_ID_CPLZ)
+		)
+			pdwFrameTable[iFrame] += VQA_PALETTE_MARKER;
+
+		llPos += sizeof(VQA_CHUNK_HEADER) + cbFrame + (cbFrame & 1);
+
+		// The halved positions should not reach the palette marker
+		if (llPos >= 2 * (LONGLONG)VQA_PALETTE_MARKER) {
+			free(pdwFrameTable);
+			return E_INVALIDARG;
+		}
+	}
+
+	FILE *pFile = fopen(pszFileName, "wb");
+	if (pFile == NULL) {
+		free(pdwFrameTable);
+		return E_FAIL;
+	}
+
+	// File header
+	VQA_FILE_HEADER header;
+	header.dwFileID		= VQA_ID_FORM;
+	header.cbFileSize	= SWAPDWORD((DWORD)(llPos - 8));
+	header.dwFormatID	= VQA_ID_WVQA;
+	HRESULT hr = WriteData(pFile, &header, sizeof(header));
+
+	// Video info and frame positions
+	VQA_CHUNK_HEADER chunkheader;
+	if (SUCCEEDED(hr)) {
+		chunkheader.dwID	= VQA_ID_VQHD;
+		chunkheader.cbSize	= SWAPDWORD((DWORD)sizeof(VQA_INFO));
+		hr = WriteData(pFile, &chunkheader, sizeof(chunkheader));
+	}
+	if (SUCCEEDED(hr))
+		hr = WriteData(pFile, pStream->GetFormat(), sizeof(VQA_INFO));
+	if (SUCCEEDED(hr)) {
+		chunkheader.dwID	= VQA_ID_FINF;
+		chunkheader.cbSize	= SWAPDWORD(nFrames * (DWORD)sizeof(DWORD));
+		hr = WriteData(pFile, &chunkheader, sizeof(chunkheader));
+	}
+	for (DWORD i = 0; (i < nFrames) && SUCCEEDED(hr); i++)
+		hr = WriteDword(pFile, pdwFrameTable[i]);
+
+	// Frame chunks (padded to even size)
+	for (DWORD iFrame = 0; (iFrame < nFrames) && SUCCEEDED(hr); iFrame++) {
+
+		DWORD cbFrame = pStream->GetBlockSize(iFrame);
+
+		chunkheader.dwID	= VQA_ID_VQFR;
+		chunkheader.cbSize	= SWAPDWORD(cbFrame);
+		hr = WriteData(pFile, &chunkheader, sizeof(chunkheader));
+		if (SUCCEEDED(hr))
+			hr = WriteData(pFile, pStream->GetBlock(iFrame), cbFrame);
+		if (SUCCEEDED(hr) && (cbFrame & 1)) {
+			BYTE bPad = 0;
+			hr = WriteData(pFile, &bPad, 1);
+		}
+	}
+
+	free(pdwFrameTable);
+
+	return CloseFile(pFile, pszFileName, hr);
+}
+
+//==========================================================================
+// ROQ file
+//==========================================================================
+
+HRESULT WriteROQFile(const CGenStream *pStream, const char *pszFileName)
+{
+	if (pStream->GetFormatSize() < sizeof(ROQ_VIDEO_FORMAT))
+		return E_INVALIDARG;
+
+	const ROQ_VIDEO_FORMAT *pFormat = (const ROQ_VIDEO_FORMAT*)pStream->GetFormat();
+
+	FILE *pFile = fopen(pszFileName, "wb");
+	if (pFile == NULL)
+		return E_FAIL;
+
+	// File header (its argument is the frame rate)
+	ROQ_CHUNK_HEADER header;
+	header.wID			= ROQ_ID_ID;
+	header.cbSize		= ROQ_ID_SIZE;
+	header.wArgument	= pFormat->nFramesPerSecond;
+	HRESULT hr = WriteData(pFile, &header, sizeof(header));
+
+	// Video info chunk
+	if (SUCCEEDED(hr)) {
+		ROQ_VIDEO_INFO info;
+		info.wWidth				= pFormat->wWidth;
+		info.wHeight			= pFormat->wHeight;
+		info.wBlockDimension	= pFormat->wBlockDimension;
+		info.wSubBlockDimension	= pFormat->wSubBlockDimension;
+
+		header.wID			= ROQ_CHUNK_VIDEO_INFO;
+		header.cbSize		= sizeof(info);
+		header.wArgument	= 0;
+		hr = WriteData(pFile, &header, sizeof(header));
+		if (SUCCEEDED(hr))
+			hr = WriteData(pFile, &info, sizeof(info));
+	}
+
+	// The codebook and frame blocks are complete chunks already
+	for (DWORD i = 0; (i < pStream->GetBlockCount()) && SUCCEEDED(hr); i++)
+		hr = WriteData(pFile, pStream->GetBlock(i), pStream->GetBlockSize(i));
+
+	return CloseFile(pFile, pszFileName, hr);
+}
+
+//==========================================================================
+// MVE file
+//==========================================================================
+
+#define MVE_MAX_CHUNK_SIZE	0xFFFF
+
+// Frame rate of the generated files: 8333 * 8 microseconds (15 fps)
+#define MVE_TIMER_RATE			8333
+#define MVE_TIMER_SUBDIVISION	8
+
+static DWORD PutMVESubchunk(BYTE *pb, BYTE bType, BYTE bSubtype, const void *pData, DWORD cbData)
+{
+	MVE_CHUNK_HEADER *pHeader = (MVE_CHUNK_HEADER*)pb;
+	pHeader->cbData		= (WORD)cbData;
+	pHeader->bType		= bType;
+	pHeader->bSubtype	= bSubtype;
+	if (cbData > 0)
+		CopyMemory(pb + sizeof(MVE_CHUNK_HEADER), pData, cbData);
+	return sizeof(MVE_CHUNK_HEADER) + cbData;
+}
+
+// Terminate the chunk with the end subchunk and write it to the file
+static HRESULT WriteMVEChunk(FILE *pFile, BYTE bType, BYTE *pbChunk, DWORD cbChunk)
+{
+	cbChunk += PutMVESubchunk(pbChunk + cbChunk, MVE_SUBCHUNK_END, 0, NULL, 0);
+
+	MVE_CHUNK_HEADER header;
+	header.cbData	= (WORD)cbChunk;
+	header.bType	= bType;
+	header.bSubtype	= 0;
+	HRESULT hr = WriteData(pFile, &header, sizeof(header));
+	if (SUCCEEDED(hr))
+		hr = WriteData(pFile, pbChunk, cbChunk);
+
+	return hr;
+}
+
+HRESULT WriteMVEFile(const CGenStream *pStream, const char *pszFileName)
+{
+	if (pStream->GetFormatSize() < sizeof(MVE_VIDEO_INFO))
+		return E_INVALIDARG;
+
+	const MVE_VIDEO_INFO *pInfo = (const MVE_VIDEO_INFO*)pStream->GetFormat();
+
+	// Every subchunk should fit in a chunk along with the end subchunk
+	DWORD i = 0;
+	for (i = 0; i < pStream->GetBlockCount(); i++) {
+		DWORD cbBlock = pStream->GetBlockSize(i);
+		if (
+			(cbBlock < 2) ||
+			(cbBlock - 2 + 2 * sizeof(MVE_CHUNK_HEADER) > MVE_MAX_CHUNK_SIZE)
+		)
+			return E_INVALIDARG;
+	}
+
+	BYTE *pbChunk = (BYTE*)malloc(MVE_MAX_CHUNK_SIZE);
+	if (pbChunk == NULL)
+		return E_OUTOFMEMORY;
+
+	FILE *pFile = fopen(pszFileName, "wb");
+	if (pFile == NULL) {
+		free(pbChunk);
+		return E_FAIL;
+	}
+
+	// File header
+	MVE_HEADER header;
+	CopyMemory(header.szID, MVE_IDSTR_MVE, sizeof(header.szID));
+	header.wMagic1	= MVE_ID_MAGIC1;
+	header.wMagic2	= MVE_ID_MAGIC2;
+	header.wMagic3	= MVE_ID_MAGIC3;
+	HRESULT hr = WriteData(pFile, &header, sizeof(header));
+
+	// Video setup chunk: the timer, the buffers and the video mode
+	DWORD cbChunk = 0;
+	if (SUCCEEDED(hr)) {
+		MVE_TIMER_DATA timer;
+		timer.dwRate		= MVE_TIMER_RATE;
+		timer.wSubdivision	= MVE_TIMER_SUBDIVISION;
+		cbChunk += PutMVESubchunk(pbChunk + cbChunk, MVE_SUBCHUNK_TIMER, 0, &timer, sizeof(timer));
+
+		cbChunk += PutMVESubchunk(pbChunk + cbChunk, MVE_SUBCHUNK_VIDEOINFO, 2, pInfo, sizeof(MVE_VIDEO_INFO));
+
+		MVE_VIDEO_MODE_INFO mode;
+		mode.wWidth		= pInfo->wWidth * 8;
+		mode.wHeight	= pInfo->wHeight * 8;
+		mode.wFlags		= 0;
+		cbChunk += PutMVESubchunk(pbChunk + cbChunk, MVE_SUBCHUNK_VIDEOMODE, 0, &mode, sizeof(mode));
+
+		hr = WriteMVEChunk(pFile, MVE_CHUNK_VIDEOINFO, pbChunk, cbChunk);
+	}
+
+	// Video data chunks. A chunk is closed after the "send buffer"
+	// command or when the next subchunk does not fit in it
+	cbChunk = 0;
+	for (i = 0; (i < pStream->GetBlockCount()) && SUCCEEDED(hr); i++) {
+
+		const BYTE *pbBlock = pStream->GetBlock(i);
+		DWORD cbData = pStream->GetBlockSize(i) - 2;
+
+		if (cbChunk + cbData + 2 * sizeof(MVE_CHUNK_HEADER) > MVE_MAX_CHUNK_SIZE) {
+			hr = WriteMVEChunk(pFile, MVE_CHUNK_VIDEODATA, pbChunk, cbChunk);
+			cbChunk = 0;
+			if (FAILED(hr))
+				break;
+		}
+
+		cbChunk += PutMVESubchunk(pbChunk + cbChunk, pbBlock[0], pbBlock[1], pbBlock + 2, cbData);
+
+		if (pbBlock[0] == MVE_SUBCHUNK_VIDEOCMD) {
+			hr = WriteMVEChunk(pFile, MVE_CHUNK_VIDEODATA, pbChunk, cbChunk);
+			cbChunk = 0;
+		}
+	}
+	if (SUCCEEDED(hr) && (cbChunk > 0))
+		hr = WriteMVEChunk(pFile, MVE_CHUNK_VIDEODATA, pbChunk, cbChunk);
+
+	// End chunk
+	if (SUCCEEDED(hr)) {
+		cbChunk = PutMVESubchunk(pbChunk, MVE_SUBCHUNK_STOP, 0, NULL, 0);
+		hr = WriteMVEChunk(pFile, MVE_CHUNK_END, pbChunk, cbChunk);
+	}
+
+	free(pbChunk);
+
+	return CloseFile(pFile, pszFileName, hr);
+}
+
+//==========================================================================
+// CIN file
+//==========================================================================
+
+HRESULT WriteCINFile(const CGenStream *pStream, const char *pszFileName)
+{
+	if (pStream->GetFormatSize() < sizeof(CIN_HEADER))
+		return E_INVALIDARG;
+
+	const CIN_HEADER *pHeader = (const CIN_HEADER*)pStream->GetFormat();
+
+	// The splitter takes 1/14 of second of audio after each frame,
+	// spreading the remainder (if any) over the odd frames
+	DWORD nAvgBytesPerSec =
+		pHeader->dwAudioSampleRate *
+		pHeader->dwAudioSampleWidth *
+		pHeader->nAudioChannels;
+	DWORD cbMaxAudio = nAvgBytesPerSec / CIN_FPS + 1;
+	if (cbMaxAudio < 4 + 1)
+		return E_INVALIDARG;
+
+	BYTE *pbSilence = (BYTE*)malloc(cbMaxAudio);
+	if (pbSilence == NULL)
+		return E_OUTOFMEMORY;
+	ZeroMemory(pbSilence, cbMaxAudio);
+
+	FILE *pFile = fopen(pszFileName, "wb");
+	if (pFile == NULL) {
+		free(pbSilence);
+		return E_FAIL;
+	}
+
+	HRESULT hr = WriteData(pFile, pHeader, sizeof(CIN_HEADER));
+
+	BOOL bDoCorrection = FALSE;
+	for (DWORD i = 0; (i < pStream->GetBlockCount()) && SUCCEEDED(hr); i++) {
+
+		// The block is the command (with the optional palette)
+		// followed by the Huffman data
+		const BYTE *pbBlock = pStream->GetBlock(i);
+		DWORD cbBlock = pStream->GetBlockSize(i);
+		DWORD dwCommand = 0;
+		if (cbBlock >= 4)
+			CopyMemory(&dwCommand, pbBlock, 4);
+		DWORD cbCommand = (dwCommand == CIN_COMMAND_PALETTE) ? 4 + 3 * 256 : 4;
+		if (cbBlock < cbCommand + 4) {
+			hr = E_INVALIDARG;
+			break;
+		}
+
+		hr = WriteData(pFile, pbBlock, cbCommand);
+		if (SUCCEEDED(hr))
+			hr = WriteDword(pFile, cbBlock - cbCommand);
+		if (SUCCEEDED(hr))
+			hr = WriteData(pFile, pbBlock + cbCommand, cbBlock - cbCommand);
+
+		// Silent audio chunk
+		DWORD cbAudio = nAvgBytesPerSec / CIN_FPS;
+		if (nAvgBytesPerSec % CIN_FPS) {
+			if (bDoCorrection)
+				cbAudio++;
+			bDoCorrection = !bDoCorrection;
+		}
+		if (SUCCEEDED(hr))
+			hr = WriteData(pFile, pbSilence, cbAudio);
+	}
+
+	if (SUCCEEDED(hr))
+		hr = WriteDword(pFile, CIN_COMMAND_EOF);
+
+	free(pbSilence);
+
+	return CloseFile(pFile, pszFileName, hr);
+}
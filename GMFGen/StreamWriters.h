@@ -0,0 +1,49 @@
+//==========================================================================
+//
+// File: StreamWriters.h
+//
+// Desc: Game Media Formats - Header file for synthetic stream file writers
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#ifndef __GMF_STREAM_WRITERS_H__
+#define __GMF_STREAM_WRITERS_H__
+
+#include "StreamGenerators.h"
+
+//==========================================================================
+// Stream writers. Each writer wraps the data blocks of the generated
+// stream into the container the corresponding splitter expects:
+//
+// VQA	- FORM/WVQA file with VQHD and FINF chunks and a VQFR chunk per frame
+// ROQ	- RoQ file with the video info chunk followed by the stream chunks
+// MVE	- Interplay MVE file with the video setup chunk and a chunk per frame
+//		  (the subchunk sizes are 16-bit, so large frames do not fit)
+// CIN	- Id CIN file with a silent mono 16-bit 22050 Hz soundtrack
+//
+// The writers return E_INVALIDARG if the stream cannot be represented
+// in the container and E_FAIL if the file cannot be written
+//==========================================================================
+
+HRESULT WriteVQAFile(const CGenStream *pStream, const char *pszFileName);
+HRESULT WriteROQFile(const CGenStream *pStream, const char *pszFileName);
+HRESULT WriteMVEFile(const CGenStream *pStream, const char *pszFileName);
+HRESULT WriteCINFile(const CGenStream *pStream, const char *pszFileName);
+
+#endif
@@ -0,0 +1,629 @@
+//==========================================================================
+//
+// File: GMFLCW.cpp
+//
+// Desc: Game Media Formats - Format80 (LCW) decoder fuzz and benchmark
+//       harness
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#include <stdio.h>
+
+#ifndef _WIN32
+#include <time.h>
+#endif
+
+#include "StreamGenerators.h"
+#include "VQAVideoDecoder.h"
+
+#define LE_16(x) (*((WORD*)(x)))
+
+//==========================================================================
+// Timer
+//==========================================================================
+
+static double GetTime(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER liCounter, liFrequency;
+	QueryPerformanceCounter(&liCounter);
+	QueryPerformanceFrequency(&liFrequency);
+	return (double)liCounter.QuadPart / (double)liFrequency.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+//==========================================================================
+// Reference decoder. That's the byte-at-a-time decoder the filters used
+// before (taken from vqavideo.c by Mike Melanson), kept here to check
+// the decoder against it
+//==========================================================================
+
+#define VALIDATEREAD(p,n,t,e) if ((p) + (n) > (t)) return (e);
+#define CHECK_COUNT() if (dest_index + count > dest_size) return VFW_E_BUFFER_OVERFLOW;
+
+static HRESULT DecodeFormat80Reference(
+	const unsigned char *src,
+	int src_size,
+	unsigned char *dest,
+	int& dest_size
+)
+{
+	int src_index = 0;
+	int dest_index = 0;
+	int count;
+	int src_pos;
+	unsigned char color;
+	int i;
+
+	const unsigned char *src_threshold = src + src_size;
+
+	VALIDATEREAD(src, 1, src_threshold, E_UNEXPECTED);
+	int mod = src[0] == 0x00;
+	if (mod)
+		src_index++;
+
+	while (src_index < src_size) {
+
+		if (src[src_index] == 0x80) {
+			dest_size = dest_index;
+			return NOERROR;
+		}
+
+		if (dest_index >= dest_size)
+			return VFW_E_BUFFER_OVERFLOW;
+
+		if (src[src_index] == 0xFF) {
+
+			src_index++;
+			VALIDATEREAD(src + src_index, 2, src_threshold, E_UNEXPECTED);
+			count = LE_16(&src[src_index]);
+			src_index += 2;
+			VALIDATEREAD(src + src_index, 2, src_threshold, E_UNEXPECTED);
+			src_pos = (mod) ? (dest_index - LE_16(&src[src_index])) : LE_16(&src[src_index]);
+			src_index += 2;
+			CHECK_COUNT();
+			if ((src_pos < 0) || (src_pos + count > dest_size))
+				return E_UNEXPECTED;
+			for (i = 0; i < count; i++)
+				dest[dest_index + i] = dest[src_pos + i];
+			dest_index += count;
+
+		} else if (src[src_index] == 0xFE) {
+
+			src_index++;
+			VALIDATEREAD(src + src_index, 2, src_threshold, E_UNEXPECTED);
+			count = LE_16(&src[src_index]);
+			src_index += 2;
+			VALIDATEREAD(src + src_index, 1, src_threshold, E_UNEXPECTED);
+			color = src[src_index++];
+			CHECK_COUNT();
+			memset(&dest[dest_index], color, count);
+			dest_index += count;
+
+		} else if ((src[src_index] & 0xC0) == 0xC0) {
+
+			count = (src[src_index++] & 0x3F) + 3;
+			VALIDATEREAD(src + src_index, 2, src_threshold, E_UNEXPECTED);
+			src_pos = (mod) ? (dest_index - LE_16(&src[src_index])) : LE_16(&src[src_index]);
+			src_index += 2;
+			CHECK_COUNT();
+			if ((src_pos < 0) || (src_pos + count > dest_size))
+				return E_UNEXPECTED;
+			for (i = 0; i < count; i++)
+				dest[dest_index + i] = dest[src_pos + i];
+			dest_index += count;
+
+		} else if (src[src_index] > 0x80) {
+
+			count = src[src_index++] & 0x3F;
+			CHECK_COUNT();
+			VALIDATEREAD(src + src_index, count, src_threshold, E_UNEXPECTED);
+			memcpy(&dest[dest_index], &src[src_index], count);
+			src_index += count;
+			dest_index += count;
+
+		} else {
+
+			count = ((src[src_index] & 0x70) >> 4) + 3;
+			VALIDATEREAD(src + src_index, 2, src_threshold, E_UNEXPECTED);
+			src_pos = ((src[src_index] & 0x0F) << 8) | src[src_index + 1];
+			src_index += 2;
+			CHECK_COUNT();
+			if ((dest_index - src_pos < 0) || (dest_index - src_pos + count > dest_size))
+				return E_UNEXPECTED;
+			for (i = 0; i < count; i++)
+				dest[dest_index + i] = dest[dest_index - src_pos + i];
+			dest_index += count;
+		}
+	}
+
+	dest_size = dest_index;
+	return NOERROR;
+}
+
+//==========================================================================
+// Encoder. It's a plain greedy one, but it emits all the commands, so
+// the decoded data exercises every path of the decoder
+//==========================================================================
+
+#define LCW_HASH_BITS	12
+#define LCW_HASH_SIZE	(1 << LCW_HASH_BITS)
+#define LCW_MAX_LITERAL	63
+
+static void PutWord(BYTE **ppbOut, DWORD dwValue)
+{
+	(*ppbOut)[0] = (BYTE)(dwValue & 0xFF);
+	(*ppbOut)[1] = (BYTE)(dwValue >> 8);
+	*ppbOut += 2;
+}
+
+static void FlushLiterals(BYTE **ppbOut, const BYTE *pbLiterals, DWORD *pcLiterals)
+{
+	if (*pcLiterals == 0)
+		return;
+	*(*ppbOut)++ = (BYTE)(0x80 | *pcLiterals);
+	memcpy(*ppbOut, pbLiterals, *pcLiterals);
+	*ppbOut += *pcLiterals;
+	*pcLiterals = 0;
+}
+
+// Encode the data. The relative mode takes the offsets of the long
+// copies relative to the current position (as HiColor VQAs do)
+static DWORD EncodeFormat80(const BYTE *pbIn, DWORD cbIn, BYTE *pbOut, BOOL bIsRelative)
+{
+	BYTE *pbStart = pbOut;
+	if (bIsRelative)
+		*pbOut++ = 0x00;
+
+	LONG plHash[LCW_HASH_SIZE];
+	for (DWORD i = 0; i < LCW_HASH_SIZE; i++)
+		plHash[i] = -1;
+
+	DWORD iPos = 0, cLiterals = 0;
+	const BYTE *pbLiterals = pbIn;
+	while (iPos < cbIn) {
+
+		// Run of the same byte
+		DWORD cRun = 1;
+		while ((iPos + cRun < cbIn) && (cRun < 0xFFFF) && (pbIn[iPos + cRun] == pbIn[iPos]))
+			cRun++;
+
+		// Earlier occurrence of the next bytes (the offsets
+		// should fit in 16 bits in both modes)
+		DWORD cMatch = 0, iMatch = 0;
+		if (iPos + 3 <= cbIn) {
+			DWORD dwHash = ((pbIn[iPos] << 8) ^ (pbIn[iPos + 1] << 4) ^ pbIn[iPos + 2]) & (LCW_HASH_SIZE - 1);
+			LONG lCandidate = plHash[dwHash];
+			plHash[dwHash] = (LONG)iPos;
+			if (
+				(lCandidate >= 0) &&
+				(iPos - (DWORD)lCandidate <= 0xFFFF) &&
+				((bIsRelative) || ((DWORD)lCandidate <= 0xFFFF))
+			) {
+				while (
+					(iPos + cMatch < cbIn) &&
+					(cMatch < 0xFFFF) &&
+					(pbIn[lCandidate + cMatch] == pbIn[iPos + cMatch])
+				)
+					cMatch++;
+				iMatch = (DWORD)lCandidate;
+			}
+		}
+
+		if ((cRun >= 4) && (cRun >= cMatch)) {
+
+			// Fill
+			FlushLiterals(&pbOut, pbLiterals, &cLiterals);
+			*pbOut++ = 0xFE;
+			PutWord(&pbOut, cRun);
+			*pbOut++ = pbIn[iPos];
+			iPos += cRun;
+			pbLiterals = pbIn + iPos;
+
+		} else if (cMatch >= 3) {
+
+			// Copy (the short one if the distance and length allow)
+			FlushLiterals(&pbOut, pbLiterals, &cLiterals);
+			DWORD dwDistance = iPos - iMatch;
+			if ((dwDistance <= 0x0FFF) && (cMatch <= 10)) {
+				*pbOut++ = (BYTE)(((cMatch - 3) << 4) | (dwDistance >> 8));
+				*pbOut++ = (BYTE)(dwDistance & 0xFF);
+			} else if (cMatch <= 64) {
+				// (0xFE and 0xFF are the fill and the long copy)
+				*pbOut++ = (BYTE)(0xC0 | (cMatch - 3));
+				PutWord(&pbOut, (bIsRelative) ? dwDistance : iMatch);
+			} else {
+				*pbOut++ = 0xFF;
+				PutWord(&pbOut, cMatch);
+				PutWord(&pbOut, (bIsRelative) ? dwDistance : iMatch);
+			}
+			iPos += cMatch;
+			pbLiterals = pbIn + iPos;
+
+		} else {
+
+			// Literal
+			cLiterals++;
+			iPos++;
+			if (cLiterals == LCW_MAX_LITERAL) {
+				FlushLiterals(&pbOut, pbLiterals, &cLiterals);
+				pbLiterals = pbIn + iPos;
+			}
+		}
+	}
+	FlushLiterals(&pbOut, pbLiterals, &cLiterals);
+
+	// End marker
+	*pbOut++ = 0x80;
+
+	return (DWORD)(pbOut - pbStart);
+}
+
+//==========================================================================
+// Test data. The kinds of data VQAs compress with Format80
+//==========================================================================
+
+typedef enum {
+	LCW_DATA_CODEBOOK8,		// 8-bit codebook (4x2 blocks)
+	LCW_DATA_CODEBOOK16,	// HiColor codebook (4x4 blocks)
+	LCW_DATA_PALETTE,		// Palette
+	LCW_DATA_VPTR,			// Vector pointers
+	LCW_DATA_KINDS
+} LCW_DATA_KIND;
+
+static const char *g_pszDataNames[LCW_DATA_KINDS] = {
+	"codebook8",
+	"codebook16",
+	"palette",
+	"vptr"
+};
+
+// Fill in the buffer with the data of the kind. Returns the data size
+static DWORD GenerateData(LCW_DATA_KIND kind, BYTE *pbData, DWORD cbMax, CGenRandom *pRandom)
+{
+	DWORD cbData = 0, i = 0;
+
+	switch (kind) {
+
+		case LCW_DATA_CODEBOOK8:
+		case LCW_DATA_CODEBOOK16:
+			{
+				// Blocks of smooth gradients, some of them repeated
+				DWORD cbBlock = (kind == LCW_DATA_CODEBOOK8) ? 8 : 32;
+				cbData = ((cbMax < MAX_CODEBOOK_SIZE) ? cbMax : MAX_CODEBOOK_SIZE) / cbBlock * cbBlock;
+				for (i = 0; i < cbData; i += cbBlock) {
+					if ((i >= cbBlock) && (pRandom->Chance(30))) {
+						DWORD iBlock = pRandom->Range(i / cbBlock);
+						memcpy(pbData + i, pbData + iBlock * cbBlock, cbBlock);
+						continue;
+					}
+					BYTE bBase = (BYTE)pRandom->Range(256), bStep = (BYTE)pRandom->Range(4);
+					for (DWORD j = 0; j < cbBlock; j++)
+						pbData[i + j] = (BYTE)(bBase + bStep * (j % 4) + (pRandom->Chance(3) ? pRandom->Range(3) : 0));
+				}
+			}
+			break;
+
+		case LCW_DATA_PALETTE:
+			// 6-bit gradients with solid spans
+			cbData = (cbMax < MAX_PALETTE_SIZE) ? cbMax : MAX_PALETTE_SIZE;
+			for (i = 0; i < cbData; i++)
+				pbData[i] = (BYTE)(((i / 3) / 4 + ((i % 3 == 0) ? 0 : pRandom->Range(2))) & 0x3F);
+			break;
+
+		case LCW_DATA_VPTR:
+			// Block indices with runs of the same index
+			cbData = (cbMax < 2 * 80 * 100) ? cbMax : 2 * 80 * 100;
+			while (i < cbData) {
+				BYTE bIndex = (BYTE)pRandom->Range(256);
+				DWORD cRun = pRandom->Chance(30) ? 1 + pRandom->Range(40) : 1;
+				for (; (cRun > 0) && (i < cbData); cRun--)
+					pbData[i++] = bIndex;
+			}
+			break;
+
+		default:
+			break;
+	}
+
+	return cbData;
+}
+
+//==========================================================================
+// Fuzzing. Each case is the encoded test data (mutated at times) or
+// the random bytes. The decoder and the reference one should agree on
+// the result and the output, and neither should write past the output.
+// The data split into random parts should decode the same way as well
+//==========================================================================
+
+#define LCW_GUARD_SIZE		64
+#define LCW_MAX_FUZZ_DATA	0x20000
+
+static BOOL RunFuzzCase(DWORD dwSeed, BOOL bIsVerbose)
+{
+	CGenRandom random(dwSeed);
+
+	static BYTE pbData[LCW_MAX_FUZZ_DATA];
+	static BYTE pbInput[LCW_MAX_FUZZ_DATA * 2 + 16];
+	static BYTE pbOutput[3][LCW_MAX_FUZZ_DATA + LCW_GUARD_SIZE];
+	static BYTE pbInitial[LCW_MAX_FUZZ_DATA + LCW_GUARD_SIZE];
+
+	// Make up the input
+	LCW_DATA_KIND kind = (LCW_DATA_KIND)random.Range(LCW_DATA_KINDS);
+	DWORD cbData = GenerateData(kind, pbData, 1 + random.Range((random.Chance(80)) ? 0x1000 : LCW_MAX_FUZZ_DATA), &random);
+	DWORD cbInput = 0;
+	DWORD dwMode = random.Range(10);
+	if (dwMode == 0) {
+
+		// Random bytes
+		cbInput = random.Range(4096);
+		for (DWORD i = 0; i < cbInput; i++)
+			pbInput[i] = (BYTE)random.Range(256);
+
+	} else {
+
+		cbInput = EncodeFormat80(pbData, cbData, pbInput, random.Chance(50));
+
+		// Flip some bytes or cut the data
+		if (dwMode <= 4) {
+			DWORD nFlips = 1 + random.Range(8);
+			for (DWORD i = 0; i < nFlips; i++)
+				pbInput[random.Range(cbInput)] = (BYTE)random.Range(256);
+		} else if (dwMode <= 6)
+			cbInput = random.Range(cbInput + 1);
+	}
+
+	// Output buffer size (enough or not)
+	int cbOutput = (random.Chance(80)) ? (int)cbData : (int)random.Range(cbData + 1);
+
+	// The absolute copies may read the bytes not written yet, so
+	// both outputs start with the same contents
+	DWORD cbInitial = (DWORD)cbOutput + LCW_GUARD_SIZE;
+	for (DWORD i = 0; i < cbInitial; i++)
+		pbInitial[i] = (BYTE)random.Range(256);
+	memcpy(pbOutput[0], pbInitial, cbInitial);
+	memcpy(pbOutput[1], pbInitial, cbInitial);
+	memcpy(pbOutput[2], pbInitial, cbInitial);
+
+	int cbDecoded = cbOutput, cbReference = cbOutput;
+	HRESULT hr = CVQAVideoDecoder::DecodeFormat80(pbInput, (int)cbInput, pbOutput[0], cbDecoded);
+	HRESULT hrReference = DecodeFormat80Reference(pbInput, (int)cbInput, pbOutput[1], cbReference);
+
+	// Decode the same data in parts
+	CVQAVideoDecoder::FORMAT80_STATE state;
+	CVQAVideoDecoder::InitFormat80State(state);
+	DWORD nParts = 1 + random.Range(16), cbReceived = 0;
+	HRESULT hrParts = S_FALSE;
+	for (DWORD i = 1; i <= nParts; i++) {
+		cbReceived = (i < nParts) ? cbReceived + random.Range(cbInput - cbReceived + 1) : cbInput;
+		hrParts = CVQAVideoDecoder::DecodeFormat80Part(pbInput, (int)cbReceived, pbOutput[2], cbOutput, state, i == nParts);
+	}
+
+	const char *pszError = NULL;
+	if (
+		(memcmp(pbOutput[0] + cbOutput, pbInitial + cbOutput, LCW_GUARD_SIZE) != 0) ||
+		(memcmp(pbOutput[2] + cbOutput, pbInitial + cbOutput, LCW_GUARD_SIZE) != 0)
+	)
+		pszError = "write past the output";
+	else if (hr != hrReference)
+		pszError = "result differs from the reference";
+	else if (cbDecoded != cbReference)
+		pszError = "output size differs from the reference";
+	else if (memcmp(pbOutput[0], pbOutput[1], cbOutput) != 0)
+		pszError = "output differs from the reference";
+	else if ((hrParts != hr) || ((SUCCEEDED(hr)) && (state.iDest != cbDecoded)))
+		pszError = "result in parts differs";
+	else if (memcmp(pbOutput[2], pbOutput[0], cbOutput) != 0)
+		pszError = "output in parts differs";
+	else if (
+		(dwMode > 6) &&
+		(cbOutput == (int)cbData) &&
+		((hr != NOERROR) || (cbDecoded != (int)cbData) || (memcmp(pbOutput[0], pbData, cbData) != 0))
+	)
+		pszError = "round trip failed";
+
+	if ((pszError != NULL) || (bIsVerbose))
+		printf(
+			"seed %lu: %s, %lu bytes in, %d bytes out, 0x%08lX%s%s\n",
+			(unsigned long)dwSeed,
+			g_pszDataNames[kind],
+			(unsigned long)cbInput,
+			cbOutput,
+			(unsigned long)(DWORD)hr,
+			(pszError) ? ": " : "",
+			(pszError) ? pszError : ""
+		);
+
+	return (pszError == NULL);
+}
+
+//==========================================================================
+// Benchmark. Each data kind is encoded once and decoded over and over.
+// The passes of both decoders take turns, so the machine load changes
+// hit them alike
+//==========================================================================
+
+#define LCW_BENCH_DATA	0x10000
+
+typedef HRESULT (*PFN_DECODE_FORMAT80)(const unsigned char*, int, unsigned char*, int&);
+
+// Time one pass of the decoder. Returns the time per decoding
+static double TimeDecoder(
+	PFN_DECODE_FORMAT80 pfnDecode,
+	const BYTE *pbInput,
+	DWORD cbInput,
+	BYTE *pbOutput,
+	DWORD cbOutput
+)
+{
+	// Each pass decodes about 4 MB
+	DWORD nLoops = (4 << 20) / cbOutput + 1;
+
+	double dStart = GetTime();
+	for (DWORD i = 0; i < nLoops; i++) {
+		int cbDecoded = (int)cbOutput;
+		pfnDecode(pbInput, (int)cbInput, pbOutput, cbDecoded);
+	}
+	return (GetTime() - dStart) / nLoops;
+}
+
+static BOOL RunBenchmark(DWORD dwSeed, DWORD nPasses)
+{
+	static BYTE pbData[LCW_BENCH_DATA];
+	static BYTE pbInput[LCW_BENCH_DATA * 2 + 16];
+	static BYTE pbOutput[LCW_BENCH_DATA];
+
+	BOOL bIsOK = TRUE;
+
+	printf(
+		"%-11s %8s %8s %10s %10s %8s\n",
+		"data", "bytes", "packed", "MB/s", "ref MB/s", "speedup"
+	);
+	for (int kind = 0; kind < LCW_DATA_KINDS; kind++) {
+
+		CGenRandom random(dwSeed);
+		DWORD cbData = GenerateData((LCW_DATA_KIND)kind, pbData, sizeof(pbData), &random);
+		DWORD cbInput = EncodeFormat80(pbData, cbData, pbInput, kind == LCW_DATA_CODEBOOK16);
+
+		// Check the decoded data before timing
+		int cbDecoded = (int)cbData;
+		HRESULT hr = CVQAVideoDecoder::DecodeFormat80(pbInput, (int)cbInput, pbOutput, cbDecoded);
+		if ((hr != NOERROR) || (cbDecoded != (int)cbData) || (memcmp(pbOutput, pbData, cbData) != 0)) {
+			fprintf(stderr, "%s: decoded data differs\n", g_pszDataNames[kind]);
+			bIsOK = FALSE;
+			continue;
+		}
+
+		// Keep the best pass of each decoder
+		double dTime = 0.0, dReference = 0.0;
+		for (DWORD iPass = 0; iPass < nPasses; iPass++) {
+			double dPass = TimeDecoder(CVQAVideoDecoder::DecodeFormat80, pbInput, cbInput, pbOutput, cbData);
+			if ((iPass == 0) || (dPass < dTime))
+				dTime = dPass;
+			dPass = TimeDecoder(DecodeFormat80Reference, pbInput, cbInput, pbOutput, cbData);
+			if ((iPass == 0) || (dPass < dReference))
+				dReference = dPass;
+		}
+
+		printf(
+			"%-11s %8lu %8lu %10.1f %10.1f %7.2fx\n",
+			g_pszDataNames[kind],
+			(unsigned long)cbData,
+			(unsigned long)cbInput,
+			(dTime > 0.0) ? cbData / dTime / 1e6 : 0.0,
+			(dReference > 0.0) ? cbData / dReference / 1e6 : 0.0,
+			(dTime > 0.0) ? dReference / dTime : 0.0
+		);
+	}
+
+	return bIsOK;
+}
+
+//==========================================================================
+// Command line
+//==========================================================================
+
+static void PrintUsage(void)
+{
+	printf(
+		"Usage: gmflcw bench [options]\n"
+		"       gmflcw fuzz [options]\n"
+		"\n"
+		"Options:\n"
+		"  -n N      fuzz cases (default: 20000)\n"
+		"  -p N      benchmark passes, the best one counts (default: 10)\n"
+		"  -s N      random seed (default: 1)\n"
+		"  -v        print every fuzz case\n"
+		"\n"
+		"The fuzzer checks the decoder against the byte-at-a-time reference\n"
+		"decoder. MB/s is 10^6 decoded bytes per second.\n"
+	);
+}
+
+static BOOL ParseNumber(const char *psz, DWORD *pdwValue)
+{
+	char *pszEnd = NULL;
+	unsigned long ulValue = strtoul(psz, &pszEnd, 10);
+	if ((pszEnd == psz) || (*pszEnd != '\0'))
+		return FALSE;
+	*pdwValue = (DWORD)ulValue;
+	return TRUE;
+}
+
+int main(int argc, char *argv[])
+{
+	if ((argc < 2) || ((strcmp(argv[1], "bench") != 0) && (strcmp(argv[1], "fuzz") != 0))) {
+		PrintUsage();
+		return 2;
+	}
+	BOOL bIsFuzz = (strcmp(argv[1], "fuzz") == 0);
+
+	DWORD nCases = 20000, nPasses = 10, dwSeed = 1;
+	BOOL bIsVerbose = FALSE;
+
+	// Parse the options
+	for (int i = 2; i < argc; i++) {
+
+		const char *pszArg = argv[i];
+		BOOL bIsValid = FALSE;
+
+		if (strcmp(pszArg, "-v") == 0) {
+			bIsVerbose = TRUE;
+			bIsValid = TRUE;
+		} else if ((pszArg[0] == '-') && (pszArg[1] != '\0') && (pszArg[2] == '\0') && (i + 1 < argc)) {
+			const char *pszValue = argv[++i];
+			switch (pszArg[1]) {
+				case 'n':
+					bIsValid = ParseNumber(pszValue, &nCases);
+					break;
+				case 'p':
+					bIsValid = ParseNumber(pszValue, &nPasses) && (nPasses > 0);
+					break;
+				case 's':
+					bIsValid = ParseNumber(pszValue, &dwSeed);
+					break;
+				default:
+					break;
+			}
+		}
+
+		if (!bIsValid) {
+			fprintf(stderr, "Invalid argument: %s\n", pszArg);
+			PrintUsage();
+			return 2;
+		}
+	}
+
+	if (!bIsFuzz)
+		return (RunBenchmark(dwSeed, nPasses)) ? 0 : 1;
+
+	// Each case has its own seed, so a failed one can be rerun alone
+	DWORD nFailed = 0;
+	for (DWORD i = 0; i < nCases; i++)
+		if (!RunFuzzCase(dwSeed + i, bIsVerbose))
+			nFailed++;
+
+	printf("%lu cases, %lu failed\n", (unsigned long)nCases, (unsigned long)nFailed);
+
+	return (nFailed == 0) ? 0 : 1;
+}
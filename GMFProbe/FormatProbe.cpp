@@ -0,0 +1,205 @@
+//==========================================================================
+//
+// File: FormatProbe.cpp
+//
+// Desc: Game Media Formats - Implementation of the format probe
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#include "FormatProbe.h"
+
+//==========================================================================
+// CFormatProbe methods
+//==========================================================================
+
+CFormatProbe::CFormatProbe() :
+	m_pCandidates(NULL),
+	m_nCandidates(0),
+	m_pAnchors(NULL),
+	m_nAnchors(0),
+	m_cbProbe(0)
+{
+}
+
+CFormatProbe::~CFormatProbe()
+{
+	Cleanup();
+}
+
+void CFormatProbe::Cleanup(void)
+{
+	free(m_pCandidates);
+	m_pCandidates	= NULL;
+	m_nCandidates	= 0;
+	free(m_pAnchors);
+	m_pAnchors		= NULL;
+	m_nAnchors		= 0;
+	m_cbProbe		= 0;
+}
+
+const GMF_FILETYPE_PATTERN* CFormatProbe::GetAnchorPattern(const GMF_FILETYPE_ENTRY *pEntry)
+{
+	const GMF_FILETYPE_PATTERN *pAnchor = NULL;
+
+	for (UINT i = 0; i < pEntry->nPatterns; i++) {
+
+		const GMF_FILETYPE_PATTERN *pPattern = &pEntry->pPattern[i];
+		if (pPattern->cbPattern <= 0)
+			continue;
+
+		if (
+			(pAnchor == NULL) ||
+			(pPattern->lOffset < pAnchor->lOffset) ||
+			((pPattern->lOffset == pAnchor->lOffset) && (pPattern->cbPattern > pAnchor->cbPattern))
+		)
+			pAnchor = pPattern;
+	}
+
+	return pAnchor;
+}
+
+HRESULT CFormatProbe::Compile(
+	const GMF_FILETYPE_FORMAT *pFormats,
+	int nFormats
+)
+{
+	Cleanup();
+
+	// Count the entries and check the patterns
+	UINT nEntries = 0;
+	for (int i = 0; i < nFormats; i++)
+		for (UINT j = 0; j < pFormats[i].nEntries; j++) {
+
+			const GMF_FILETYPE_ENTRY *pEntry = &pFormats[i].pEntry[j];
+			for (UINT k = 0; k < pEntry->nPatterns; k++)
+				if ((pEntry->pPattern[k].lOffset < 0) || (pEntry->pPattern[k].cbPattern < 0))
+					return E_INVALIDARG;
+
+			// An entry without patterns would match anything
+			if (GetAnchorPattern(pEntry) == NULL)
+				return E_INVALIDARG;
+
+			nEntries++;
+		}
+
+	m_pCandidates	= (PROBE_CANDIDATE*)malloc(nEntries * sizeof(PROBE_CANDIDATE) + 1);
+	m_pAnchors		= (PROBE_ANCHOR*)malloc(nEntries * sizeof(PROBE_ANCHOR) + 1);
+	if ((m_pCandidates == NULL) || (m_pAnchors == NULL)) {
+		Cleanup();
+		return E_OUTOFMEMORY;
+	}
+
+	// Collect the distinct anchor offsets (sorted, so that the
+	// candidates of the smaller offsets are checked first)
+	for (int i = 0; i < nFormats; i++)
+		for (UINT j = 0; j < pFormats[i].nEntries; j++) {
+
+			LONG lOffset = GetAnchorPattern(&pFormats[i].pEntry[j])->lOffset;
+
+			UINT iAnchor = 0;
+			while ((iAnchor < m_nAnchors) && (m_pAnchors[iAnchor].lOffset < lOffset))
+				iAnchor++;
+			if ((iAnchor < m_nAnchors) && (m_pAnchors[iAnchor].lOffset == lOffset))
+				continue;
+
+			memmove(&m_pAnchors[iAnchor + 1], &m_pAnchors[iAnchor], (m_nAnchors - iAnchor) * sizeof(PROBE_ANCHOR));
+			ZeroMemory(&m_pAnchors[iAnchor], sizeof(PROBE_ANCHOR));
+			m_pAnchors[iAnchor].lOffset = lOffset;
+			m_nAnchors++;
+		}
+
+	// Lay the candidates out anchor by anchor and byte value by byte
+	// value. Within a bucket the entries with longer patterns go first,
+	// so the first match is the most specific one
+	for (UINT iAnchor = 0; iAnchor < m_nAnchors; iAnchor++) {
+
+		PROBE_ANCHOR *pAnchor = &m_pAnchors[iAnchor];
+
+		for (int b = 0; b < 256; b++) {
+
+			pAnchor->iFirst[b] = m_nCandidates;
+
+			for (int i = 0; i < nFormats; i++)
+				for (UINT j = 0; j < pFormats[i].nEntries; j++) {
+
+					const GMF_FILETYPE_ENTRY *pEntry = &pFormats[i].pEntry[j];
+					const GMF_FILETYPE_PATTERN *pPattern = GetAnchorPattern(pEntry);
+					if (
+						(pPattern->lOffset != pAnchor->lOffset) ||
+						((BYTE)pPattern->szValue[0] != b)
+					)
+						continue;
+
+					PROBE_CANDIDATE candidate;
+					candidate.pFormat	= &pFormats[i];
+					candidate.pEntry	= pEntry;
+					candidate.cbMatch	= 0;
+					for (UINT k = 0; k < pEntry->nPatterns; k++) {
+						candidate.cbMatch += pEntry->pPattern[k].cbPattern;
+						if (pEntry->pPattern[k].lOffset + pEntry->pPattern[k].cbPattern > m_cbProbe)
+							m_cbProbe = pEntry->pPattern[k].lOffset + pEntry->pPattern[k].cbPattern;
+					}
+
+					UINT iCandidate = m_nCandidates;
+					while (
+						(iCandidate > pAnchor->iFirst[b]) &&
+						(m_pCandidates[iCandidate - 1].cbMatch < candidate.cbMatch)
+					) {
+						m_pCandidates[iCandidate] = m_pCandidates[iCandidate - 1];
+						iCandidate--;
+					}
+					m_pCandidates[iCandidate] = candidate;
+					m_nCandidates++;
+				}
+		}
+
+		pAnchor->iFirst[256] = m_nCandidates;
+	}
+
+	return NOERROR;
+}
+
+const GMF_FILETYPE_FORMAT* CFormatProbe::Identify(const BYTE *pbData, LONG cbData) const
+{
+	const PROBE_CANDIDATE *pBest = NULL;
+
+	for (UINT iAnchor = 0; iAnchor < m_nAnchors; iAnchor++) {
+
+		const PROBE_ANCHOR *pAnchor = &m_pAnchors[iAnchor];
+		if (pAnchor->lOffset >= cbData)
+			break;
+
+		BYTE b = pbData[pAnchor->lOffset];
+		for (UINT i = pAnchor->iFirst[b]; i < pAnchor->iFirst[b + 1]; i++) {
+
+			const PROBE_CANDIDATE *pCandidate = &m_pCandidates[i];
+
+			// The rest of the bucket has shorter patterns
+			if ((pBest) && (pCandidate->cbMatch <= pBest->cbMatch))
+				break;
+
+			if (MatchFileTypeEntry(pCandidate->pEntry, pbData, cbData)) {
+				pBest = pCandidate;
+				break;
+			}
+		}
+	}
+
+	return (pBest) ? pBest->pFormat : NULL;
+}
@@ -0,0 +1,95 @@
+//==========================================================================
+//
+// File: FormatProbe.h
+//
+// Desc: Game Media Formats - Header file for the format probe
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#ifndef __GMF_FORMAT_PROBE_H__
+#define __GMF_FORMAT_PROBE_H__
+
+#include "FileTypePatterns.h"
+
+//==========================================================================
+// Format probe class
+//
+// The probe compiles the file type patterns of all formats into one
+// matcher. Each entry is anchored on the first byte of its pattern
+// with the smallest offset, and the entries sharing the anchor offset
+// are bucketed by the anchor byte value. So identifying the data takes
+// one table lookup per distinct anchor offset (there is just one for
+// the current formats) and the full pattern check of the few entries
+// found in the bucket.
+//
+// Once compiled, the probe is read-only, so any number of threads
+// may use it at the same time.
+//==========================================================================
+
+class CFormatProbe
+{
+
+	// Entry to check
+	typedef struct tagPROBE_CANDIDATE {
+		const GMF_FILETYPE_FORMAT	*pFormat;	// Format detected by the entry
+		const GMF_FILETYPE_ENTRY	*pEntry;	// File type entry
+		LONG						cbMatch;	// Total length of the entry patterns
+	} PROBE_CANDIDATE;
+
+	// Entries anchored at the same offset
+	typedef struct tagPROBE_ANCHOR {
+		LONG	lOffset;		// Anchor offset
+		UINT	iFirst[257];	// Candidates of the byte value b are iFirst[b]..iFirst[b + 1] - 1
+	} PROBE_ANCHOR;
+
+	PROBE_CANDIDATE	*m_pCandidates;	// Candidates (bucketed by the anchor and byte value)
+	UINT			m_nCandidates;	// Number of candidates
+	PROBE_ANCHOR	*m_pAnchors;	// Anchors (sorted by offset)
+	UINT			m_nAnchors;		// Number of anchors
+	LONG			m_cbProbe;		// Number of bytes the patterns look at
+
+	// Pattern the entry is anchored on
+	static const GMF_FILETYPE_PATTERN* GetAnchorPattern(const GMF_FILETYPE_ENTRY *pEntry);
+
+public:
+
+	CFormatProbe();
+	~CFormatProbe();
+
+	// Compile the patterns of the formats
+	HRESULT Compile(
+		const GMF_FILETYPE_FORMAT *pFormats,	// Formats array
+		int nFormats							// Number of formats
+	);
+
+	// Release the compiled matcher
+	void Cleanup(void);
+
+	// Number of leading file bytes Identify() needs to see (the
+	// longer data is fine, the shorter one may miss some formats)
+	LONG GetProbeSize(void) const { return m_cbProbe; }
+
+	// Identify the format of the data (the file starting bytes).
+	// When several entries match, the one with the longest patterns
+	// wins. Returns NULL if no format matches
+	const GMF_FILETYPE_FORMAT* Identify(const BYTE *pbData, LONG cbData) const;
+
+};
+
+#endif
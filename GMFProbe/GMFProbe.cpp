@@ -0,0 +1,651 @@
+//==========================================================================
+//
+// File: GMFProbe.cpp
+//
+// Desc: Game Media Formats - Format probe command line tool
+//
+// Copyright (C) 2004 ANX Software.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//==========================================================================
+
+#include <stdio.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <process.h>
+#define stat _stat64
+#ifndef S_ISDIR
+#define S_ISDIR(m) (((m) & S_IFMT) == S_IFDIR)
+#define S_ISREG(m) (((m) & S_IFMT) == S_IFREG)
+#endif
+#else
+#include <pthread.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <time.h>
+#endif
+
+#include "FormatProbe.h"
+
+#ifdef _WIN32
+#define PATH_SEPARATOR '\\'
+#else
+#define PATH_SEPARATOR '/'
+#endif
+
+// Maximum length of a list file line
+#define MAX_LIST_LINE	4096
+
+// Number of the file names queued for the workers. The directory
+// scan waits when the queue is full, so the memory use does not
+// depend on the number of files
+#define PROBE_QUEUE_SIZE	4096
+
+// Largest probe read (the patterns look at the first 64 bytes now)
+#define PROBE_MAX_READ		4096
+
+//==========================================================================
+// Timer
+//==========================================================================
+
+static double GetTime(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER liCounter, liFrequency;
+	QueryPerformanceCounter(&liCounter);
+	QueryPerformanceFrequency(&liFrequency);
+	return (double)liCounter.QuadPart / (double)liFrequency.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+//==========================================================================
+// Lock, condition and thread wrappers
+//==========================================================================
+
+#ifdef _WIN32
+
+typedef CRITICAL_SECTION PROBE_LOCK;
+typedef CONDITION_VARIABLE PROBE_CONDITION;
+typedef HANDLE PROBE_THREAD;
+
+#define InitLock(p)				InitializeCriticalSection(p)
+#define DeleteLock(p)			DeleteCriticalSection(p)
+#define Lock(p)					EnterCriticalSection(p)
+#define Unlock(p)				LeaveCriticalSection(p)
+
+#define InitCondition(p)		InitializeConditionVariable(p)
+#define DeleteCondition(p)
+#define WaitCondition(p, l)		SleepConditionVariableCS((p), (l), INFINITE)
+#define Signal(p)				WakeConditionVariable(p)
+#define Broadcast(p)			WakeAllConditionVariable(p)
+
+#else
+
+typedef pthread_mutex_t PROBE_LOCK;
+typedef pthread_cond_t PROBE_CONDITION;
+typedef pthread_t PROBE_THREAD;
+
+#define InitLock(p)				pthread_mutex_init((p), NULL)
+#define DeleteLock(p)			pthread_mutex_destroy(p)
+#define Lock(p)					pthread_mutex_lock(p)
+#define Unlock(p)				pthread_mutex_unlock(p)
+
+#define InitCondition(p)		pthread_cond_init((p), NULL)
+#define DeleteCondition(p)		pthread_cond_destroy(p)
+#define WaitCondition(p, l)		pthread_cond_wait((p), (l))
+#define Signal(p)				pthread_cond_signal(p)
+#define Broadcast(p)			pthread_cond_broadcast(p)
+
+#endif
+
+static DWORD GetProcessorCount(void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	return (si.dwNumberOfProcessors > 0) ? si.dwNumberOfProcessors : 1;
+#else
+	long lCount = sysconf(_SC_NPROCESSORS_ONLN);
+	return (lCount > 0) ? (DWORD)lCount : 1;
+#endif
+}
+
+//==========================================================================
+// Probe context
+//
+// The calling thread scans the inputs and queues the file names, the
+// workers take them off the queue and probe the files. So the probing
+// starts with the first file found and the scan of a large tree is
+// overlapped with the file reads.
+//==========================================================================
+
+// Per-worker counters (summed up when the workers are done, so the
+// workers do not share them)
+typedef struct tagPROBE_COUNTERS {
+	DWORD	nFiles;			// Files probed
+	DWORD	nUnknown;		// Files of unknown format
+	DWORD	nFailed;		// Files failed to read
+	DWORD	*pnFormat;		// Files of each format
+} PROBE_COUNTERS;
+
+typedef struct tagPROBE_CONTEXT {
+	CFormatProbe	probe;			// Compiled matcher (shared read-only)
+	LONG			cbRead;			// Bytes to read from each file
+	BOOL			bQuiet;			// Print the summary only
+	BOOL			bUnknown;		// Print the files of unknown format too
+	PROBE_LOCK		lock;			// Guards the queue and the output
+	PROBE_CONDITION	condNotEmpty;	// Signalled when a name is queued
+	PROBE_CONDITION	condNotFull;	// Signalled when a name is taken
+	char			*pQueue[PROBE_QUEUE_SIZE];	// Queued file names
+	DWORD			iHead;			// Next name to take
+	DWORD			nQueued;		// Number of queued names
+	BOOL			bScanDone;		// No more names will be queued
+} PROBE_CONTEXT;
+
+typedef struct tagPROBE_WORKER {
+	PROBE_CONTEXT	*pContext;		// Shared context
+	PROBE_COUNTERS	counters;		// Worker's counters
+} PROBE_WORKER;
+
+static BOOL IsSeparator(char ch)
+{
+#ifdef _WIN32
+	return (ch == '\\') || (ch == '/');
+#else
+	return (ch == '/');
+#endif
+}
+
+// Queue the file name (the queue takes over the string)
+static void QueueFile(PROBE_CONTEXT *pContext, char *pszPath)
+{
+	Lock(&pContext->lock);
+	while (pContext->nQueued == PROBE_QUEUE_SIZE)
+		WaitCondition(&pContext->condNotFull, &pContext->lock);
+	pContext->pQueue[(pContext->iHead + pContext->nQueued) % PROBE_QUEUE_SIZE] = pszPath;
+	pContext->nQueued++;
+	Signal(&pContext->condNotEmpty);
+	Unlock(&pContext->lock);
+}
+
+// Take the next file name off the queue. Returns NULL when the scan
+// is done and the queue is empty
+static char* DequeueFile(PROBE_CONTEXT *pContext)
+{
+	Lock(&pContext->lock);
+	while ((pContext->nQueued == 0) && (!pContext->bScanDone))
+		WaitCondition(&pContext->condNotEmpty, &pContext->lock);
+
+	char *pszPath = NULL;
+	if (pContext->nQueued > 0) {
+		pszPath = pContext->pQueue[pContext->iHead];
+		pContext->iHead = (pContext->iHead + 1) % PROBE_QUEUE_SIZE;
+		pContext->nQueued--;
+		Signal(&pContext->condNotFull);
+	}
+	Unlock(&pContext->lock);
+
+	return pszPath;
+}
+
+static void FinishScan(PROBE_CONTEXT *pContext)
+{
+	Lock(&pContext->lock);
+	pContext->bScanDone = TRUE;
+	Broadcast(&pContext->condNotEmpty);
+	Unlock(&pContext->lock);
+}
+
+//==========================================================================
+// Input scan
+//==========================================================================
+
+static HRESULT QueuePath(PROBE_CONTEXT *pContext, const char *pszDir, const char *pszName)
+{
+	char *pszPath = (char*)malloc(strlen(pszDir) + 1 + strlen(pszName) + 1);
+	if (pszPath == NULL)
+		return E_OUTOFMEMORY;
+	if ((pszDir[0] != '\0') && (!IsSeparator(pszDir[strlen(pszDir) - 1])))
+		sprintf(pszPath, "%s%c%s", pszDir, PATH_SEPARATOR, pszName);
+	else
+		sprintf(pszPath, "%s%s", pszDir, pszName);
+
+	QueueFile(pContext, pszPath);
+	return NOERROR;
+}
+
+// Queue all files found in the directory tree. The directory entry
+// types are taken from the directory listing where the system gives
+// them, so that the scan does not stat every file
+static HRESULT ScanDirectory(PROBE_CONTEXT *pContext, const char *pszDir)
+{
+#ifdef _WIN32
+
+	char *pszPattern = (char*)malloc(strlen(pszDir) + 3);
+	if (pszPattern == NULL)
+		return E_OUTOFMEMORY;
+	sprintf(pszPattern, "%s\\*", pszDir);
+
+	WIN32_FIND_DATAA fd;
+	HANDLE hFind = FindFirstFileA(pszPattern, &fd);
+	free(pszPattern);
+	if (hFind == INVALID_HANDLE_VALUE)
+		return E_FAIL;
+
+	HRESULT hr = NOERROR;
+	do {
+		const char *pszName = fd.cFileName;
+		BOOL bIsDir = (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+		BOOL bIsFile = !bIsDir && !(fd.dwFileAttributes & FILE_ATTRIBUTE_DEVICE);
+
+#else
+
+	DIR *pDir = opendir(pszDir);
+	if (pDir == NULL)
+		return E_FAIL;
+
+	HRESULT hr = NOERROR;
+	struct dirent *pEntry;
+	while ((SUCCEEDED(hr)) && ((pEntry = readdir(pDir)) != NULL)) {
+		const char *pszName = pEntry->d_name;
+		BOOL bIsDir = FALSE, bIsFile = FALSE;
+
+#ifdef DT_DIR
+		bIsDir	= (pEntry->d_type == DT_DIR);
+		bIsFile	= (pEntry->d_type == DT_REG);
+		BOOL bIsKnown = (pEntry->d_type != DT_UNKNOWN) && (pEntry->d_type != DT_LNK);
+#else
+		BOOL bIsKnown = FALSE;
+#endif
+
+#endif
+
+		if ((strcmp(pszName, ".") == 0) || (strcmp(pszName, "..") == 0))
+			continue;
+
+#ifndef _WIN32
+		// Links and file systems not reporting the types need stat
+		if (!bIsKnown) {
+			char *pszPath = (char*)malloc(strlen(pszDir) + 1 + strlen(pszName) + 1);
+			if (pszPath == NULL) {
+				hr = E_OUTOFMEMORY;
+				break;
+			}
+			sprintf(pszPath, "%s%c%s", pszDir, PATH_SEPARATOR, pszName);
+			struct stat st;
+			if (stat(pszPath, &st) == 0) {
+				bIsDir	= S_ISDIR(st.st_mode);
+				bIsFile	= S_ISREG(st.st_mode);
+			}
+			free(pszPath);
+		}
+#endif
+
+		if (bIsDir) {
+			char *pszPath = (char*)malloc(strlen(pszDir) + 1 + strlen(pszName) + 1);
+			if (pszPath == NULL) {
+				hr = E_OUTOFMEMORY;
+				break;
+			}
+			sprintf(pszPath, "%s%c%s", pszDir, PATH_SEPARATOR, pszName);
+			if (FAILED(ScanDirectory(pContext, pszPath)))
+				fprintf(stderr, "%s: cannot read the directory\n", pszPath);
+			free(pszPath);
+		} else if (bIsFile)
+			hr = QueuePath(pContext, pszDir, pszName);
+
+#ifdef _WIN32
+	} while ((SUCCEEDED(hr)) && (FindNextFileA(hFind, &fd)));
+	FindClose(hFind);
+#else
+	}
+	closedir(pDir);
+#endif
+
+	return hr;
+}
+
+// Queue the command line input: a file, a directory or a list file (@name)
+static HRESULT AddInput(PROBE_CONTEXT *pContext, const char *pszInput)
+{
+	if (pszInput[0] == '@') {
+
+		FILE *pFile = fopen(pszInput + 1, "rt");
+		if (pFile == NULL) {
+			fprintf(stderr, "%s: cannot open the list file\n", pszInput + 1);
+			return E_FAIL;
+		}
+
+		HRESULT hr = NOERROR;
+		char szLine[MAX_LIST_LINE];
+		while ((SUCCEEDED(hr)) && (fgets(szLine, sizeof(szLine), pFile))) {
+			size_t cch = strlen(szLine);
+			while ((cch > 0) && ((szLine[cch - 1] == '\n') || (szLine[cch - 1] == '\r')))
+				szLine[--cch] = '\0';
+			if (cch > 0)
+				hr = AddInput(pContext, szLine);
+		}
+
+		fclose(pFile);
+		return hr;
+	}
+
+	struct stat st;
+	if (stat(pszInput, &st) != 0) {
+		fprintf(stderr, "%s: no such file or directory\n", pszInput);
+		return E_FAIL;
+	}
+
+	if (S_ISDIR(st.st_mode)) {
+		HRESULT hr = ScanDirectory(pContext, pszInput);
+		if (FAILED(hr))
+			fprintf(stderr, "%s: cannot read the directory\n", pszInput);
+		return hr;
+	}
+
+	return QueuePath(pContext, "", pszInput);
+}
+
+//==========================================================================
+// Worker pool
+//==========================================================================
+
+// Read the starting bytes of the file. Returns the number of bytes
+// read or -1 if the file cannot be read
+static LONG ReadFileStart(const char *pszPath, BYTE *pbBuffer, LONG cbBuffer)
+{
+	FILE *pFile = fopen(pszPath, "rb");
+	if (pFile == NULL)
+		return -1;
+
+	// No stdio buffering: it would read more than the probe needs
+	setvbuf(pFile, NULL, _IONBF, 0);
+
+	size_t cbRead = fread(pbBuffer, 1, cbBuffer, pFile);
+	BOOL bIsError = ferror(pFile);
+	fclose(pFile);
+
+	return (bIsError) ? -1 : (LONG)cbRead;
+}
+
+#ifdef _WIN32
+static unsigned __stdcall WorkerThread(void *pParam)
+#else
+static void* WorkerThread(void *pParam)
+#endif
+{
+	PROBE_WORKER *pWorker = (PROBE_WORKER*)pParam;
+	PROBE_CONTEXT *pContext = pWorker->pContext;
+	PROBE_COUNTERS *pCounters = &pWorker->counters;
+	BYTE bBuffer[PROBE_MAX_READ];
+
+	char *pszPath;
+	while ((pszPath = DequeueFile(pContext)) != NULL) {
+
+		pCounters->nFiles++;
+
+		LONG cbData = ReadFileStart(pszPath, bBuffer, pContext->cbRead);
+		if (cbData < 0) {
+			pCounters->nFailed++;
+			Lock(&pContext->lock);
+			fprintf(stderr, "%s: cannot read the file\n", pszPath);
+			Unlock(&pContext->lock);
+			free(pszPath);
+			continue;
+		}
+
+		const GMF_FILETYPE_FORMAT *pFormat = pContext->probe.Identify(bBuffer, cbData);
+		if (pFormat)
+			pCounters->pnFormat[pFormat - g_FileTypeFormats]++;
+		else
+			pCounters->nUnknown++;
+
+		if ((!pContext->bQuiet) && ((pFormat) || (pContext->bUnknown))) {
+			Lock(&pContext->lock);
+			printf("%s\t%s\n", (pFormat) ? pFormat->szName : "?", pszPath);
+			Unlock(&pContext->lock);
+		}
+
+		free(pszPath);
+	}
+
+	return 0;
+}
+
+//==========================================================================
+// Command line
+//==========================================================================
+
+static void PrintUsage(void)
+{
+	printf(
+		"Usage: gmfprobe [options] input...\n"
+		"\n"
+		"Identifies the format of the files by their signatures. Inputs are\n"
+		"files, directories (scanned recursively, all files are probed\n"
+		"whatever their extension is) and list files (@name, one input per\n"
+		"line).\n"
+		"\n"
+		"Each identified file is printed as FORMAT<tab>path; the summary goes\n"
+		"to stderr. Formats: APC, FST, HNM, MVE, ROQ, VMD, VQA (CIN files have\n"
+		"no signature and are not identified).\n"
+		"\n"
+		"Options:\n"
+		"  -j N  number of parallel probes (default: CPU count)\n"
+		"  -u    print the files of unknown format too (as ?<tab>path)\n"
+		"  -q    print the summary only\n"
+		"  -h    print this help (also --help)\n"
+		"  --    treat the rest of the arguments as inputs\n"
+	);
+}
+
+int main(int argc, char *argv[])
+{
+	PROBE_CONTEXT *pContext = new PROBE_CONTEXT;
+	pContext->bQuiet	= FALSE;
+	pContext->bUnknown	= FALSE;
+	pContext->iHead		= 0;
+	pContext->nQueued	= 0;
+	pContext->bScanDone	= FALSE;
+
+	DWORD nThreads = GetProcessorCount();
+	int iFirstInput = argc;
+
+	// Parse the options
+	for (int i = 1; i < argc; i++) {
+
+		const char *pszArg = argv[i];
+
+		// Long options: "--" ends the options (so that the inputs 
+		// may start with a dash), "--help" is the only other one
+		if ((pszArg[0] == '-') && (pszArg[1] == '-')) {
+			if (pszArg[2] == '\0') {
+				iFirstInput = i + 1;
+				break;
+			}
+			if (strcmp(pszArg, "--help") == 0) {
+				PrintUsage();
+				return 0;
+			}
+			fprintf(stderr, "Invalid argument: %s\n", pszArg);
+			PrintUsage();
+			return 2;
+		}
+
+		// The first argument which is not an option starts the inputs
+		if ((pszArg[0] != '-') || (pszArg[1] == '\0')) {
+			iFirstInput = i;
+			break;
+		}
+
+		// All other options are single letters
+		if (pszArg[2] != '\0') {
+			fprintf(stderr, "Invalid argument: %s\n", pszArg);
+			PrintUsage();
+			return 2;
+		}
+
+		if ((pszArg[1] == 'h') || (pszArg[1] == '?')) {
+			PrintUsage();
+			return 0;
+		}
+		if (pszArg[1] == 'q') {
+			pContext->bQuiet = TRUE;
+			continue;
+		}
+		if (pszArg[1] == 'u') {
+			pContext->bUnknown = TRUE;
+			continue;
+		}
+
+		// All other options take a value
+		if (i + 1 >= argc) {
+			fprintf(stderr, "Option %s requires a value\n", pszArg);
+			return 2;
+		}
+		const char *pszValue = argv[++i];
+
+		BOOL bIsValid = TRUE;
+		switch (pszArg[1]) {
+			case 'j':
+				{
+					char *pszEnd = NULL;
+					unsigned long ulValue = strtoul(pszValue, &pszEnd, 10);
+					bIsValid = (pszEnd != pszValue) && (*pszEnd == '\0') && (ulValue > 0);
+					nThreads = (DWORD)ulValue;
+				}
+				break;
+			default:
+				bIsValid = FALSE;
+				break;
+		}
+
+		if (!bIsValid) {
+			fprintf(stderr, "Invalid argument: %s %s\n", pszArg, pszValue);
+			PrintUsage();
+			return 2;
+		}
+	}
+
+	if (iFirstInput >= argc) {
+		PrintUsage();
+		return 2;
+	}
+
+	// Compile the matcher
+	if (FAILED(pContext->probe.Compile(g_FileTypeFormats, g_nFileTypeFormats))) {
+		fprintf(stderr, "Cannot compile the file type patterns\n");
+		return 1;
+	}
+	pContext->cbRead = pContext->probe.GetProbeSize();
+	if (pContext->cbRead > PROBE_MAX_READ)
+		pContext->cbRead = PROBE_MAX_READ;
+
+	// Start the workers
+	PROBE_THREAD *pThreads = (PROBE_THREAD*)malloc(nThreads * sizeof(PROBE_THREAD));
+	PROBE_WORKER *pWorkers = (PROBE_WORKER*)calloc(nThreads, sizeof(PROBE_WORKER));
+	DWORD *pnFormat = (DWORD*)calloc(nThreads * g_nFileTypeFormats, sizeof(DWORD));
+	if ((pThreads == NULL) || (pWorkers == NULL) || (pnFormat == NULL)) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	InitLock(&pContext->lock);
+	InitCondition(&pContext->condNotEmpty);
+	InitCondition(&pContext->condNotFull);
+
+	double dStart = GetTime();
+
+	DWORD nStarted = 0;
+	for (DWORD i = 0; i < nThreads; i++) {
+		pWorkers[nStarted].pContext				= pContext;
+		pWorkers[nStarted].counters.pnFormat	= pnFormat + nStarted * g_nFileTypeFormats;
+#ifdef _WIN32
+		pThreads[nStarted] = (HANDLE)_beginthreadex(NULL, 0, WorkerThread, &pWorkers[nStarted], 0, NULL);
+		if (pThreads[nStarted] != 0)
+			nStarted++;
+#else
+		if (pthread_create(&pThreads[nStarted], NULL, WorkerThread, &pWorkers[nStarted]) == 0)
+			nStarted++;
+#endif
+	}
+	if (nStarted == 0) {
+		fprintf(stderr, "Cannot start the probe\n");
+		return 1;
+	}
+
+	// Scan the inputs (the workers probe the files meanwhile)
+	BOOL bIsInputError = FALSE;
+	for (int i = iFirstInput; i < argc; i++)
+		if (FAILED(AddInput(pContext, argv[i])))
+			bIsInputError = TRUE;
+	FinishScan(pContext);
+
+	for (DWORD i = 0; i < nStarted; i++) {
+#ifdef _WIN32
+		WaitForSingleObject(pThreads[i], INFINITE);
+		CloseHandle(pThreads[i]);
+#else
+		pthread_join(pThreads[i], NULL);
+#endif
+	}
+
+	double dSeconds = GetTime() - dStart;
+
+	DeleteCondition(&pContext->condNotFull);
+	DeleteCondition(&pContext->condNotEmpty);
+	DeleteLock(&pContext->lock);
+
+	// Summary
+	PROBE_COUNTERS total;
+	ZeroMemory(&total, sizeof(total));
+	for (DWORD i = 0; i < nStarted; i++) {
+		total.nFiles	+= pWorkers[i].counters.nFiles;
+		total.nUnknown	+= pWorkers[i].counters.nUnknown;
+		total.nFailed	+= pWorkers[i].counters.nFailed;
+	}
+
+	fflush(stdout);
+	for (int j = 0; j < g_nFileTypeFormats; j++) {
+		DWORD nFiles = 0;
+		for (DWORD i = 0; i < nStarted; i++)
+			nFiles += pWorkers[i].counters.pnFormat[j];
+		if (nFiles > 0)
+			fprintf(stderr, "%s: %lu\n", g_FileTypeFormats[j].szName, (unsigned long)nFiles);
+	}
+	fprintf(
+		stderr,
+		"%lu files probed, %lu unknown, %lu failed in %.2f s (%.0f files/s, %lu threads)\n",
+		(unsigned long)total.nFiles,
+		(unsigned long)total.nUnknown,
+		(unsigned long)total.nFailed,
+		dSeconds,
+		(dSeconds > 0) ? total.nFiles / dSeconds : 0.0,
+		(unsigned long)nStarted
+	);
+
+	free(pnFormat);
+	free(pWorkers);
+	free(pThreads);
+	delete pContext;
+
+	return ((bIsInputError) || (total.nFailed > 0)) ? 1 : 0;
+}